@@ -26,7 +26,7 @@ Group: Applications/Communications
 Source0: %{sourcename}.zip
 
 BuildRoot: %{_topdir}/tmp/%{name}-%{Version}.${Release}
-BuildRequires: openssl-devel,curl-devel,openldap-devel,net-snmp-devel,libicu-devel,rpm-build,vim-common,gcc,gcc-c++,make,CUnit-devel,junit,boost-devel,dos2unix,ant,java-11-openjdk-devel,icu,javapackages-local
+BuildRequires: openssl-devel,curl-devel,openldap-devel,net-snmp-devel,libicu-devel,rpm-build,vim-common,gcc,gcc-c++,make,CUnit-devel,junit,boost-devel,dos2unix,ant,java-11-openjdk-devel,icu,javapackages-local,zlib-devel,lz4-devel,libzstd-devel
 Requires: gdb, net-tools, openssl, tar, perl, procps >= 3.3.9, libjansson.so.4()(64bit), logrotate, zip, bzip2, unzip
 Obsoletes: IBMIoTMessageSightServer < 6.0
 
@@ -234,7 +234,7 @@ const int32_t BloomFilterPublishTaskIntervalMillis_DEFVALUE = 100;
  * Optional property.
  *
  * Enumerated string, see below:
- * MURMUR3_x64_128_LC, MURMUR3_x64_128_CH, City64_LC, City64_CH
+ * MURMUR3_x64_128_LC, MURMUR3_x64_128_CH, City64_LC, City64_CH, MURMUR3_x64_128_BLK
  *
  * Default: City64_LC
  */
@@ -256,6 +256,11 @@ const std::string BloomFilterHashFunctionType_City64_LC_VALUE = "mcp.BloomFilter
  * CityHash (from Google) with seed chaining
  */
 const std::string BloomFilterHashFunctionType_City64_CH_VALUE = "mcp.BloomFilter.HashFunctionType.City64_CH";
+/**
+ * Murmur3 x64 128bit, cache line blocked: all the bins of a key are in one 64 byte block.
+ * Used only while every server in the cluster supports it, MURMUR3_x64_128_CH otherwise.
+ */
+const std::string BloomFilterHashFunctionType_MURMUR3_x64_128_BLK_VALUE = "mcp.BloomFilter.HashFunctionType.MURMUR3_x64_128_BLK";
 
 const std::string BloomFilterHashFunctionType_DEFVALUE = BloomFilterHashFunctionType_City64_LC_VALUE;
 
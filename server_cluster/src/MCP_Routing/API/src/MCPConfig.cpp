@@ -177,6 +177,10 @@ void MCPConfig::initProperties()
     {
         bloomFilterHashType = ISM_HASH_TYPE_MURMUR_x64_128_CH;
     }
+    else if ( hashType == BloomFilterHashFunctionType_MURMUR3_x64_128_BLK_VALUE)
+    {
+        bloomFilterHashType = ISM_HASH_TYPE_MURMUR_x64_128_BLK;
+    }
     else
     {
         std::ostringstream what;
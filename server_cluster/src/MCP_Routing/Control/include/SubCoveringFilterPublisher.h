@@ -134,6 +134,30 @@ public:
 	 */
 	virtual uint32_t getSizeBytesBloomFilterBase(const std::string& tag) const = 0;
 
+	/**
+	 * Replace all the Bloom filter updates since the base with a single
+	 * update that holds the last change of every bin, if it is considerably
+	 * smaller than the base.
+	 *
+	 * Receivers that applied some of the replaced updates reach the same BF by
+	 * applying the merged one, so this trims the attributes without sending a base.
+	 *
+	 * @param tag
+	 * @return sequence number of the merged update, 0 if a base should be published instead
+	 * 	(including on any error, which publishing the base will report)
+	 */
+	virtual uint64_t compactBloomFilterUpdates(const std::string& tag) = 0;
+
+	/**
+	 * Use run-length encoded bases and sparse delta encoded updates.
+	 *
+	 * Enabled only while every server in the cluster can read them.
+	 * Takes effect on the next base or update.
+	 *
+	 * @param enabled
+	 */
+	virtual void setCompactBloomFilterEncoding(bool enabled) = 0;
+
 
 	/* ********************************************************************/
 	/* Wild-card subscription patterns (SupscriptionPattern)            */
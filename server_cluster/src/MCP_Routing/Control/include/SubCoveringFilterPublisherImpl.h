@@ -77,6 +77,10 @@ public:
 
 	virtual uint32_t getSizeBytesBloomFilterBase(const std::string& tag) const;
 
+	virtual uint64_t compactBloomFilterUpdates(const std::string& tag);
+
+	virtual void setCompactBloomFilterEncoding(bool enabled);
+
 	/*
 	 * @see SubCoveringFilterPublisher
 	 */
@@ -168,6 +172,8 @@ private:
 
 	uint64_t sqn_restored_notin_view_;
 
+	bool compactEncoding_;
+
 	struct SqnInfo
 	{
 		uint64_t base;
@@ -188,6 +194,12 @@ private:
 	typedef std::map<std::string, SqnInfo > BFTagInfo_Map;
 	BFTagInfo_Map bfTagInfoMap;
 
+	//All the BF updates since the base, compacted; see SubCoveringFilterWireFormat::compactBloomFilterUpdates
+	typedef std::map<std::string, std::vector<int32_t> > BFMergedUpdates_Map;
+	BFMergedUpdates_Map bfMergedUpdatesMap;
+
+	void writeBloomFilterUpdate(const SqnInfo& info, const std::vector<int32_t>& compacted);
+
 	/* WC-P: Wild-card patterns
 	 * A map from the index to the sequence number
 	 */
@@ -14,6 +14,8 @@
 #ifndef SUBCOVERINGFILTERWIREFORMAT_H_
 #define SUBCOVERINGFILTERWIREFORMAT_H_
 
+#include <vector>
+
 #include "ByteBuffer.h"
 #include "SubscriptionPattern.h"
 #include "RemoteSubscriptionStats.h"
@@ -28,6 +30,29 @@ class SubCoveringFilterWireFormat
 public:
 	static const uint16_t ATTR_VERSION;
 	static const uint16_t STORE_VERSION;
+	/*
+	 * The highest attribute version this server can read; advertised as the
+	 * supported-version in the LocalServerInfo attribute.
+	 */
+	static const uint16_t ATTR_VERSION_SUPPORTED;
+	/*
+	 * The first supported-version that understands cache line blocked BFs
+	 * (ISM_HASH_TYPE_MURMUR_x64_128_BLK). The BF encoding itself is unchanged.
+	 */
+	static const uint16_t BLOCKED_BF_VERSION;
+	/*
+	 * The first supported-version that reads run-length encoded BF bases and
+	 * sparse delta encoded BF updates.
+	 */
+	static const uint16_t COMPACT_BF_VERSION;
+	/*
+	 * OR'ed into the bfType of a BF base whose bits are run-length encoded.
+	 */
+	static const int16_t BF_BASE_RLE_FLAG;
+	/*
+	 * Written in place of numUpdates in a sparse delta encoded BF update.
+	 */
+	static const int32_t BF_UPDATE_SPARSE_MARKER;
 
 	enum StoreRecordType
 	{
@@ -41,7 +66,46 @@ public:
 	static int writeSubscriptionStats(const uint32_t wireFormatVer, const RemoteSubscriptionStats& stats, ByteBuffer_SPtr buffer);
 	static int readSubscriptionStats(const uint32_t wireFormatVer, ByteBufferReadOnlyWrapper& buffer, RemoteSubscriptionStats* pStats);
 
+	/*
+	 * Run-length encode the zero bytes of a BF.
+	 *
+	 * @return false if the encoding is not smaller than the raw bits, in which
+	 * 	case the raw bits should be sent.
+	 */
+	static bool writeBloomFilterBitsRLE(const char* bits, std::size_t numBytes, ByteBuffer_SPtr buffer);
+	static int readBloomFilterBitsRLE(ByteBufferReadOnlyWrapper& buffer, std::size_t numBytes, std::vector<char>& bits);
+
+	/*
+	 * Reduce BF bin updates (1-indexing, positive = set, negative = clear) to
+	 * the last update of every bin, sorted by bin.
+	 *
+	 * Applying the result after any prefix of the original updates gives the
+	 * same BF as applying all of them.
+	 */
+	static void compactBloomFilterUpdates(const std::vector<int32_t>& binUpdates, std::vector<int32_t>& compacted);
+
+	/*
+	 * Merge compacted updates into compacted accumulated updates; the updates win.
+	 */
+	static void mergeBloomFilterUpdates(const std::vector<int32_t>& updates, std::vector<int32_t>& accumulated);
+
+	/*
+	 * Write compacted BF updates as: marker, base SQN, count, and a varint
+	 * per update holding the bin delta from the previous update and the set bit.
+	 */
+	static void writeBloomFilterUpdateSparse(uint64_t baseSqn, const std::vector<int32_t>& compacted, ByteBuffer_SPtr buffer);
+
+	/*
+	 * Read a BF update in either format, the buffer positioned after the SQN.
+	 *
+	 * @param baseSqn the base the update applies to, 0 if not carried
+	 */
+	static int readBloomFilterUpdate(ByteBufferReadOnlyWrapper& buffer, uint64_t& baseSqn, std::vector<int32_t>& binUpdates);
+
 private:
+	static void writeVarint(uint64_t value, ByteBuffer& buffer);
+	static uint64_t readVarint(ByteBuffer& buffer);
+
 	SubCoveringFilterWireFormat();
 	virtual ~SubCoveringFilterWireFormat();
 };
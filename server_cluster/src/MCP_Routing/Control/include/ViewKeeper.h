@@ -211,6 +211,11 @@ private:
 	boost::shared_array<char*> pSubs_array_;
 	std::size_t pSubs_array_length_;
 
+	/* Whether every known remote server can read cache line blocked BFs */
+	bool blockedBFSupported_;
+	/* Whether every known remote server can read RLE bases and sparse BF updates */
+	bool compactBFSupported_;
+
 	//=========================================================================
 
 	void onViewChangeEvent(spdr::event::MembershipEvent_SPtr event);
@@ -218,6 +223,22 @@ private:
 	void onNodeLeaveEvent(spdr::event::MembershipEvent_SPtr event);
 	void onChangeOfMetadataEvent(spdr::event::MembershipEvent_SPtr event);
 
+	/*
+	 * Re-evaluate blockedBFSupported_ and compactBFSupported_ from the
+	 * supported-version advertised by the remote servers, and tell the
+	 * LocalSubManager when they change.
+	 */
+	void updateRemoteVersionSupport();
+
+	/*
+	 * Re-deliver a BF base and all its updates from the attribute map, when an
+	 * update does not follow the base delivered before it.
+	 */
+	int redeliver_BF(
+			RemoteServerStatus_SPtr status,
+			const spdr::event::AttributeMap& attr_map,
+			const std::string& filterTag);
+
 
 	typedef std::map<uint64_t, spdr::event::AttributeValue> SortedBF_BaseUpdate_Map;
 
@@ -225,10 +246,16 @@ private:
 			ismCluster_RemoteServerHandle_t clusterHandle,
 			const spdr::event::AttributeValue& attrVal,
 			const std::string& filterTag);
+	/*
+	 * @param baseSqn the SQN of the base delivered last
+	 * @param gap set if the update applies to a different base, and was not delivered
+	 */
 	int deliver_BF_Update(
 			ismCluster_RemoteServerHandle_t clusterHandle,
 			const spdr::event::AttributeValue& attrVal,
-			const std::string& filterTag);
+			const std::string& filterTag,
+			uint64_t baseSqn,
+			bool& gap);
 
 	int deliver_RCF_Base(
 			RemoteServerStatus_SPtr status,
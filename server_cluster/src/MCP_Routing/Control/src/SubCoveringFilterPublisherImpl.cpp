@@ -36,7 +36,8 @@ SubCoveringFilterPublisherImpl::SubCoveringFilterPublisherImpl(const std::string
 		sqn_retained_stats_(0),
 		sqn_monitoring_status_(0),
 		sqn_removed_servers_(0),
-		sqn_restored_notin_view_(0)
+		sqn_restored_notin_view_(0),
+		compactEncoding_(false)
 {
 	byteBuffer = ByteBuffer::createByteBuffer((uint32_t) 1024);
 	permitted_BF_Tags.insert(FilterTags::BF_ExactSub);
@@ -107,21 +108,37 @@ uint64_t SubCoveringFilterPublisherImpl::publishBloomFilterBase(
 	ostringstream keyB;
 	keyB << tag << FilterTags::BF_Base_Suffix;
 
+	bfMergedUpdatesMap[tag].clear();
+
 	//the value wire format (network byte order / big-endian) :
 	// (uint64_t) sqnNum,
-	// (int16_t) bfType,
+	// (int16_t) bfType, (| BF_BASE_RLE_FLAG if the buffer is run-length encoded)
 	// (int16_t) numHash,
 	// (int32_t) numBins, (must be a multiple of 8)
 	// buffer
 
-	byteBuffer->reset();
-	byteBuffer->writeLong((int64_t) (base_sqn));
-	byteBuffer->writeShort(static_cast<int16_t>(bfType));
-	byteBuffer->writeShort(static_cast<int16_t>(numHash));
-	byteBuffer->writeInt(static_cast<int32_t>(numBins));
-	if (numBins>0)
+	bool rle = false;
+	if (compactEncoding_ && numBins > 0)
+	{
+		byteBuffer->reset();
+		byteBuffer->writeLong((int64_t) (base_sqn));
+		byteBuffer->writeShort(static_cast<int16_t>(bfType) | SubCoveringFilterWireFormat::BF_BASE_RLE_FLAG);
+		byteBuffer->writeShort(static_cast<int16_t>(numHash));
+		byteBuffer->writeInt(static_cast<int32_t>(numBins));
+		rle = SubCoveringFilterWireFormat::writeBloomFilterBitsRLE(buffer, static_cast<std::size_t>(numBins / 8), byteBuffer);
+	}
+
+	if (!rle)
 	{
-		byteBuffer->writeByteArray(buffer, static_cast<std::size_t>(numBins / 8));
+		byteBuffer->reset();
+		byteBuffer->writeLong((int64_t) (base_sqn));
+		byteBuffer->writeShort(static_cast<int16_t>(bfType));
+		byteBuffer->writeShort(static_cast<int16_t>(numHash));
+		byteBuffer->writeInt(static_cast<int32_t>(numBins));
+		if (numBins>0)
+		{
+			byteBuffer->writeByteArray(buffer, static_cast<std::size_t>(numBins / 8));
+		}
 	}
 
 	it->second.base_size_bytes = byteBuffer->getDataLength();
@@ -169,23 +186,16 @@ uint64_t SubCoveringFilterPublisherImpl::publishBloomFilterUpdate(
 	it->second.last_update = ++sqn_;
 	it->second.num_updates += 1;
 
+	//a bin that changed more than once since the last publish is sent once
+	vector<int32_t> compacted;
+	SubCoveringFilterWireFormat::compactBloomFilterUpdates(binUpdates, compacted);
+	SubCoveringFilterWireFormat::mergeBloomFilterUpdates(compacted, bfMergedUpdatesMap[tag]);
 
 	//updates are numbered 1:num_updates
 	ostringstream keyU;
 	keyU << tag << FilterTags::BF_Update_Suffix << dec << it->second.num_updates;
 
-	//the value wire format (network byte order / big-endian) :
-	// (uint64_t) sqnNum
-	// (int32_t) numUpdates,
-	// ((int32_t) update)  x numUpdates
-
-	byteBuffer->reset();
-	byteBuffer->writeLong(static_cast<int64_t>(it->second.last_update));
-	byteBuffer->writeInt(static_cast<int32_t>(binUpdates.size()));
-	for (size_t i = 0; i < binUpdates.size(); ++i)
-	{
-		byteBuffer->writeInt(binUpdates[i]);
-	}
+	writeBloomFilterUpdate(it->second, compacted);
 
 	it->second.updates_size_bytes += byteBuffer->getDataLength();
 
@@ -197,6 +207,106 @@ uint64_t SubCoveringFilterPublisherImpl::publishBloomFilterUpdate(
 	return it->second.last_update;
 }
 
+uint64_t SubCoveringFilterPublisherImpl::compactBloomFilterUpdates(
+		const std::string& tag)
+{
+	using namespace std;
+	using namespace spdr;
+	Trace_Entry(this,"compactBloomFilterUpdates()","tag",tag);
+
+	boost::mutex::scoped_lock lock(mutex);
+
+	BFTagInfo_Map::iterator it = bfTagInfoMap.find(tag);
+	if (it == bfTagInfoMap.end() || it->second.num_updates <= 1)
+	{
+		Trace_Exit(this,"compactBloomFilterUpdates()","nothing to compact");
+		return 0;
+	}
+
+	try
+	{
+		const vector<int32_t>& merged = bfMergedUpdatesMap[tag];
+		SqnInfo info = it->second;
+		info.last_update = sqn_ + 1;
+		writeBloomFilterUpdate(info, merged);
+
+		//a merged update close to the size of the base is better replaced by a base
+		if (byteBuffer->getDataLength() * 2 > it->second.base_size_bytes)
+		{
+			Trace_Exit(this,"compactBloomFilterUpdates()","merged too large, size",
+					boost::lexical_cast<std::string>(byteBuffer->getDataLength()));
+			return 0;
+		}
+
+		ostringstream keyU;
+		keyU << tag << FilterTags::BF_Update_Suffix << dec << 1;
+		membershipService.setAttribute(keyU.str(),
+				spdr::Const_Buffer(
+						static_cast<int32_t>(byteBuffer->getDataLength()),
+						byteBuffer->getBuffer()));
+
+		uint32_t num_updates = it->second.num_updates;
+		it->second.last_update = ++sqn_;
+		it->second.num_updates = 1;
+		it->second.updates_size_bytes = byteBuffer->getDataLength();
+
+		for (size_t k = 2; k <= num_updates; ++k)
+		{
+			ostringstream keyR;
+			keyR << tag << FilterTags::BF_Update_Suffix << dec << k;
+			membershipService.removeAttribute(keyR.str());
+		}
+	}
+	catch (std::exception& e)
+	{
+		Trace_Error(this,"compactBloomFilterUpdates()","Error: exception while compacting BF updates",
+				"what", e.what());
+		return 0;
+	}
+	catch (...)
+	{
+		Trace_Error(this,"compactBloomFilterUpdates()","Error: untyped exception while compacting BF updates");
+		return 0;
+	}
+
+	Trace_Exit<uint64_t>(this,"compactBloomFilterUpdates()",it->second.last_update);
+	return it->second.last_update;
+}
+
+void SubCoveringFilterPublisherImpl::setCompactBloomFilterEncoding(bool enabled)
+{
+	Trace_Event(this,"setCompactBloomFilterEncoding()","", "enabled", (enabled ? "true" : "false"));
+
+	boost::mutex::scoped_lock lock(mutex);
+	compactEncoding_ = enabled;
+}
+
+void SubCoveringFilterPublisherImpl::writeBloomFilterUpdate(const SqnInfo& info, const std::vector<int32_t>& compacted)
+{
+	//the value wire format (network byte order / big-endian) :
+	// (uint64_t) sqnNum
+	// (int32_t) numUpdates,
+	// ((int32_t) update)  x numUpdates
+	//or, with compact encoding:
+	// (uint64_t) sqnNum
+	// @see SubCoveringFilterWireFormat::writeBloomFilterUpdateSparse
+
+	byteBuffer->reset();
+	byteBuffer->writeLong(static_cast<int64_t>(info.last_update));
+	if (compactEncoding_)
+	{
+		SubCoveringFilterWireFormat::writeBloomFilterUpdateSparse(info.base, compacted, byteBuffer);
+	}
+	else
+	{
+		byteBuffer->writeInt(static_cast<int32_t>(compacted.size()));
+		for (size_t i = 0; i < compacted.size(); ++i)
+		{
+			byteBuffer->writeInt(compacted[i]);
+		}
+	}
+}
+
 uint64_t SubCoveringFilterPublisherImpl::removeBloomFilter(
 		const std::string& tag)
 {
@@ -873,7 +983,7 @@ void SubCoveringFilterPublisherImpl::publishLocalServerInfo(const std::string& s
 	 * String 		ServerName
 	 */
 	byteBuffer->reset();
-	byteBuffer->writeShort(static_cast<int16_t>(SubCoveringFilterWireFormat::ATTR_VERSION));
+	byteBuffer->writeShort(static_cast<int16_t>(SubCoveringFilterWireFormat::ATTR_VERSION_SUPPORTED));
 	byteBuffer->writeShort(static_cast<int16_t>(SubCoveringFilterWireFormat::ATTR_VERSION));
 	byteBuffer->writeString(serverName);
 
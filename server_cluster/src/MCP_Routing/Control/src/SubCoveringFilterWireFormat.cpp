@@ -11,6 +11,10 @@
  * SPDX-License-Identifier: EPL-2.0
  */
 
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
 #include <SubCoveringFilterWireFormat.h>
 
 namespace mcp
@@ -18,6 +22,25 @@ namespace mcp
 
 const uint16_t SubCoveringFilterWireFormat::ATTR_VERSION = 1;
 const uint16_t SubCoveringFilterWireFormat::STORE_VERSION = 1;
+const uint16_t SubCoveringFilterWireFormat::ATTR_VERSION_SUPPORTED = 3;
+const uint16_t SubCoveringFilterWireFormat::BLOCKED_BF_VERSION = 2;
+const uint16_t SubCoveringFilterWireFormat::COMPACT_BF_VERSION = 3;
+const int16_t SubCoveringFilterWireFormat::BF_BASE_RLE_FLAG = 0x4000;
+const int32_t SubCoveringFilterWireFormat::BF_UPDATE_SPARSE_MARKER = std::numeric_limits<int32_t>::min();
+
+namespace
+{
+//Zero runs shorter than this are cheaper to send as literals
+const std::size_t RLE_MIN_ZERO_RUN = 3;
+
+struct BinUpdateLess
+{
+	bool operator()(int32_t a, int32_t b) const
+	{
+		return std::abs(a) < std::abs(b);
+	}
+};
+}
 
 
 SubCoveringFilterWireFormat::SubCoveringFilterWireFormat()
@@ -120,4 +143,216 @@ int SubCoveringFilterWireFormat::readSubscriptionStats(const uint32_t wireFormat
 	return ISMRC_OK;
 }
 
+bool SubCoveringFilterWireFormat::writeBloomFilterBitsRLE(const char* bits, std::size_t numBytes, ByteBuffer_SPtr buffer)
+{
+	//  A sequence of segments, until numBytes are covered:
+	//  varint zero-run, varint literal-length, literal bytes
+
+	const std::size_t start = buffer->getPosition();
+	std::size_t i = 0;
+	while (i < numBytes)
+	{
+		std::size_t z = i;
+		while (z < numBytes && bits[z] == 0)
+		{
+			++z;
+		}
+
+		std::size_t end = z;
+		std::size_t zeros = 0;
+		while (end < numBytes)
+		{
+			if (bits[end] == 0)
+			{
+				if (++zeros == RLE_MIN_ZERO_RUN)
+				{
+					end -= (RLE_MIN_ZERO_RUN - 1);
+					break;
+				}
+			}
+			else
+			{
+				zeros = 0;
+			}
+			++end;
+		}
+
+		writeVarint(z - i, *buffer);
+		writeVarint(end - z, *buffer);
+		if (end > z)
+		{
+			buffer->writeByteArray(bits + z, end - z);
+		}
+		i = end;
+
+		if (buffer->getPosition() - start >= numBytes)
+		{
+			buffer->setPosition(start);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int SubCoveringFilterWireFormat::readBloomFilterBitsRLE(ByteBufferReadOnlyWrapper& buffer, std::size_t numBytes, std::vector<char>& bits)
+{
+	bits.assign(numBytes, 0);
+	std::size_t i = 0;
+	while (i < numBytes)
+	{
+		uint64_t zeroRun = readVarint(buffer);
+		uint64_t literal = readVarint(buffer);
+		if (zeroRun + literal > numBytes - i)
+		{
+			return ISMRC_Error;
+		}
+		i += zeroRun;
+		if (literal > 0)
+		{
+			buffer.readByteArray(&bits[i], literal);
+			i += literal;
+		}
+		else if (zeroRun == 0)
+		{
+			return ISMRC_Error;
+		}
+	}
+
+	return ISMRC_OK;
+}
+
+void SubCoveringFilterWireFormat::compactBloomFilterUpdates(const std::vector<int32_t>& binUpdates, std::vector<int32_t>& compacted)
+{
+	//stable sort keeps the updates to the same bin in order, the last one wins
+	compacted = binUpdates;
+	std::stable_sort(compacted.begin(), compacted.end(), BinUpdateLess());
+
+	std::size_t n = 0;
+	for (std::size_t i = 0; i < compacted.size(); ++i)
+	{
+		if (n > 0 && std::abs(compacted[n-1]) == std::abs(compacted[i]))
+		{
+			compacted[n-1] = compacted[i];
+		}
+		else
+		{
+			compacted[n++] = compacted[i];
+		}
+	}
+	compacted.resize(n);
+}
+
+void SubCoveringFilterWireFormat::mergeBloomFilterUpdates(const std::vector<int32_t>& updates, std::vector<int32_t>& accumulated)
+{
+	std::vector<int32_t> merged;
+	merged.reserve(accumulated.size() + updates.size());
+
+	std::vector<int32_t>::const_iterator a = accumulated.begin();
+	std::vector<int32_t>::const_iterator u = updates.begin();
+	while (a != accumulated.end() || u != updates.end())
+	{
+		if (u == updates.end() || (a != accumulated.end() && std::abs(*a) < std::abs(*u)))
+		{
+			merged.push_back(*a++);
+		}
+		else
+		{
+			if (a != accumulated.end() && std::abs(*a) == std::abs(*u))
+			{
+				++a;
+			}
+			merged.push_back(*u++);
+		}
+	}
+
+	accumulated.swap(merged);
+}
+
+void SubCoveringFilterWireFormat::writeBloomFilterUpdateSparse(uint64_t baseSqn, const std::vector<int32_t>& compacted, ByteBuffer_SPtr buffer)
+{
+	//  (int32_t) BF_UPDATE_SPARSE_MARKER
+	//  (uint64_t) base SQN
+	//  (int32_t) numUpdates
+	//  varint ((bin - previous-bin) << 1 | set) x numUpdates
+
+	buffer->writeInt(BF_UPDATE_SPARSE_MARKER);
+	buffer->writeLong(static_cast<int64_t>(baseSqn));
+	buffer->writeInt(static_cast<int32_t>(compacted.size()));
+	uint32_t prev = 0;
+	for (std::size_t i = 0; i < compacted.size(); ++i)
+	{
+		uint32_t bin = static_cast<uint32_t>(std::abs(compacted[i]));
+		writeVarint((static_cast<uint64_t>(bin - prev) << 1) | (compacted[i] > 0 ? 1 : 0), *buffer);
+		prev = bin;
+	}
+}
+
+int SubCoveringFilterWireFormat::readBloomFilterUpdate(ByteBufferReadOnlyWrapper& buffer, uint64_t& baseSqn, std::vector<int32_t>& binUpdates)
+{
+	int32_t numUpdates = buffer.readInt();
+	binUpdates.clear();
+	baseSqn = 0;
+
+	if (numUpdates != BF_UPDATE_SPARSE_MARKER)
+	{
+		if (numUpdates < 0)
+		{
+			return ISMRC_Error;
+		}
+		binUpdates.reserve(static_cast<std::size_t>(numUpdates));
+		for (int32_t i = 0; i < numUpdates; ++i)
+		{
+			binUpdates.push_back(buffer.readInt());
+		}
+		return ISMRC_OK;
+	}
+
+	baseSqn = static_cast<uint64_t>(buffer.readLong());
+	numUpdates = buffer.readInt();
+	if (numUpdates < 0)
+	{
+		return ISMRC_Error;
+	}
+	binUpdates.reserve(static_cast<std::size_t>(numUpdates));
+	uint64_t bin = 0;
+	for (int32_t i = 0; i < numUpdates; ++i)
+	{
+		uint64_t v = readVarint(buffer);
+		bin += (v >> 1);
+		if (bin == 0 || bin > static_cast<uint64_t>(std::numeric_limits<int32_t>::max()))
+		{
+			return ISMRC_Error;
+		}
+		binUpdates.push_back((v & 1) ? static_cast<int32_t>(bin) : -static_cast<int32_t>(bin));
+	}
+
+	return ISMRC_OK;
+}
+
+void SubCoveringFilterWireFormat::writeVarint(uint64_t value, ByteBuffer& buffer)
+{
+	while (value >= 0x80)
+	{
+		buffer.writeChar(static_cast<char>((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+	buffer.writeChar(static_cast<char>(value));
+}
+
+uint64_t SubCoveringFilterWireFormat::readVarint(ByteBuffer& buffer)
+{
+	uint64_t value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		uint8_t b = static_cast<uint8_t>(buffer.readChar());
+		value |= static_cast<uint64_t>(b & 0x7F) << shift;
+		if ((b & 0x80) == 0)
+		{
+			break;
+		}
+	}
+	return value;
+}
+
 } /* namespace spdr */
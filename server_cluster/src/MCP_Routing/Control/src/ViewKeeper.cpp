@@ -69,7 +69,9 @@ ViewKeeper::ViewKeeper(
 		selfNodePrev_UID_(),
 		selfNodePrev_Name_(),
 		pSubs_array_(),
-		pSubs_array_length_(0)
+		pSubs_array_length_(0),
+		blockedBFSupported_(false),
+		compactBFSupported_(false)
 {
 	selfNode_ClusterHandle_.index = 0;
 	selfNode_ClusterHandle_.engineHandle = NULL;
@@ -634,6 +636,8 @@ void ViewKeeper::onMembershipEvent(spdr::event::MembershipEvent_SPtr event)
 	        onFatalError(this->getMemberName(), "Fatal Error in cluster component. Local server will leave the cluster.", ISMRC_ClusterInternalError);
 	    }
 	    }
+
+	    updateRemoteVersionSupport();
 	}
 	else
 	{
@@ -2582,6 +2586,61 @@ int ViewKeeper::addToRemovedServersMap(const std::string& uid, int64_t incNum)
     return rc;
 }
 
+void ViewKeeper::updateRemoteVersionSupport()
+{
+    bool blocked = true;
+    bool compact = true;
+    bool blockedChanged = false;
+    bool compactChanged = false;
+
+    {
+        boost::recursive_mutex::scoped_lock lock(view_mutex);
+
+        //Blocked BFs are only used once every server is known to read them, a
+        //server that did not advertise its version yet (0) holds them back.
+        //For compact encoding such a server is not counted.
+        for (ServerRegistryMap::const_iterator it = serverRegistryMap.begin(); it != serverRegistryMap.end(); ++it)
+        {
+            uint32_t ver = it->second->protoVer_supported;
+            if (ver < SubCoveringFilterWireFormat::BLOCKED_BF_VERSION)
+            {
+                blocked = false;
+            }
+            if (ver != 0 && ver < SubCoveringFilterWireFormat::COMPACT_BF_VERSION)
+            {
+                compact = false;
+            }
+        }
+
+        blockedChanged = (blocked != blockedBFSupported_);
+        compactChanged = (compact != compactBFSupported_);
+        blockedBFSupported_ = blocked;
+        compactBFSupported_ = compact;
+    }
+
+    if (blockedChanged)
+    {
+        Trace_Event(this, "updateRemoteVersionSupport()", "Blocked BF support changed", "supported", (blocked ? "true" : "false"));
+
+        MCPReturnCode rc = subscriptionStatsListener.setBlockedBloomFilterSupport(blocked);
+        if (rc != ISMRC_OK && rc != ISMRC_ClusterNotAvailable)
+        {
+            Trace_Error(this, "updateRemoteVersionSupport()", "Error: calling setBlockedBloomFilterSupport()", "RC", rc);
+        }
+    }
+
+    if (compactChanged)
+    {
+        Trace_Event(this, "updateRemoteVersionSupport()", "Compact BF encoding support changed", "supported", (compact ? "true" : "false"));
+
+        MCPReturnCode rc = subscriptionStatsListener.setCompactBloomFilterEncoding(compact);
+        if (rc != ISMRC_OK && rc != ISMRC_ClusterNotAvailable)
+        {
+            Trace_Error(this, "updateRemoteVersionSupport()", "Error: calling setCompactBloomFilterEncoding()", "RC", rc);
+        }
+    }
+}
+
 void ViewKeeper::cleanDeletedNodesList()
 {
     boost::posix_time::ptime threshold =
@@ -3215,14 +3274,26 @@ int ViewKeeper::deliver_filter_changes(
 
 			    case VALUE_TYPE_BF_E_UPDT:
 			    {
+			        if (it->first <= status->sqn_bf_exact_last_update)
+			        {
+			            break; //covered by a re-delivered base
+			        }
 			        Trace_Debug(this, "deliver_filter_changes()","bf Exact Update");
-			        int rc = deliver_BF_Update(&(status->info), it->second.second, FilterTags::BF_ExactSub);
+			        bool gap = false;
+			        int rc = deliver_BF_Update(&(status->info), it->second.second, FilterTags::BF_ExactSub, status->sqn_bf_exact_base, gap);
+			        if (rc == ISMRC_OK && gap)
+			        {
+			            rc = redeliver_BF(status, *attr_map, FilterTags::BF_ExactSub);
+			        }
 			        if (rc != ISMRC_OK)
 			        {
 			            Trace_Error(this, "deliver_filter_changes()", "Error: calling deliver_BF_Update() Exact", "RC", rc);
 			            return rc;
 			        }
-			        status->sqn_bf_exact_last_update = it->first;
+			        if (!gap)
+			        {
+			            status->sqn_bf_exact_last_update = it->first;
+			        }
 			        break;
 			    }
 
@@ -3241,13 +3312,25 @@ int ViewKeeper::deliver_filter_changes(
 
 			    case VALUE_TYPE_BF_W_UPDT:
 			    {
-			        int rc = deliver_BF_Update(&(status->info), it->second.second, FilterTags::BF_WildcardSub);
+			        if (it->first <= status->sqn_bf_wildcard_last_update)
+			        {
+			            break; //covered by a re-delivered base
+			        }
+			        bool gap = false;
+			        int rc = deliver_BF_Update(&(status->info), it->second.second, FilterTags::BF_WildcardSub, status->sqn_bf_wildcard_base, gap);
+			        if (rc == ISMRC_OK && gap)
+			        {
+			            rc = redeliver_BF(status, *attr_map, FilterTags::BF_WildcardSub);
+			        }
 			        if (rc != ISMRC_OK)
 			        {
 			            Trace_Error(this, "deliver_filter_changes()", "Error: calling deliver_BF_Update() Wildcard", "RC", rc);
 			            return rc;
 			        }
-			        status->sqn_bf_wildcard_last_update = it->first;
+			        if (!gap)
+			        {
+			            status->sqn_bf_wildcard_last_update = it->first;
+			        }
 			        break;
 			    }
 
@@ -3337,18 +3420,30 @@ int ViewKeeper::deliver_BF_Base(ismCluster_RemoteServerHandle_t clusterHandle,
 	ByteBufferReadOnlyWrapper bb(attrVal.getBuffer().get(), attrVal.getLength());
 	//the value wire format (network byte order / big-endian) :
 	// (uint64_t) sqnNum
-	// (int16_t) bfType,
+	// (int16_t) bfType, (| BF_BASE_RLE_FLAG if the buffer is run-length encoded)
 	// (int16_t) numHash,
 	// (int32_t) numBins, (must be a multiple of 8)
 	// buffer
 
 	bb.setPosition(8); //skip the sqnNum
-	mcc_hash_HashType_t type = static_cast<mcc_hash_HashType_t>(bb.readShort());
+	int16_t typeFlags = bb.readShort();
+	mcc_hash_HashType_t type = static_cast<mcc_hash_HashType_t>(typeFlags & ~SubCoveringFilterWireFormat::BF_BASE_RLE_FLAG);
 	if (type != ISM_HASH_TYPE_NONE)
 	{
 		int16_t numHash = bb.readShort();
 		int32_t numBins = bb.readInt();
 		const char* buffp = (bb.getBuffer() + bb.getPosition());
+		std::vector<char> bits;
+		if ((typeFlags & SubCoveringFilterWireFormat::BF_BASE_RLE_FLAG) != 0)
+		{
+			int rc = (numBins > 0) ? SubCoveringFilterWireFormat::readBloomFilterBitsRLE(bb, static_cast<std::size_t>(numBins / 8), bits) : ISMRC_Error;
+			if (rc != ISMRC_OK)
+			{
+				Trace_Error(this, "deliver_BF_Base()", "Error: malformed run-length encoded base","RC", rc);
+				return rc;
+			}
+			buffp = &bits[0];
+		}
 		int rc = filterUpdatelistener.onBloomFilterBase(clusterHandle, filterTag,
 				type, numHash, numBins, buffp);
 		if (rc != ISMRC_OK)
@@ -3374,7 +3469,8 @@ int ViewKeeper::deliver_BF_Base(ismCluster_RemoteServerHandle_t clusterHandle,
 }
 
 int ViewKeeper::deliver_BF_Update(ismCluster_RemoteServerHandle_t clusterHandle,
-		const spdr::event::AttributeValue& attrVal, const std::string& filterTag)
+		const spdr::event::AttributeValue& attrVal, const std::string& filterTag,
+		uint64_t baseSqn, bool& gap)
 {
 	Trace_Entry(this,"deliver_BF_Update()");
 	//it is an update
@@ -3385,15 +3481,28 @@ int ViewKeeper::deliver_BF_Update(ismCluster_RemoteServerHandle_t clusterHandle,
 	// (uint64_t) sqnNum
 	// (int32_t) numUpdates,
 	// ((int32_t) update)  x numUpdates
-	int32_t numUpdates = bb.readInt();
+	//or sparse, @see SubCoveringFilterWireFormat::writeBloomFilterUpdateSparse
+	uint64_t updateBaseSqn = 0;
 	std::vector<int32_t> updates;
+	int rc = SubCoveringFilterWireFormat::readBloomFilterUpdate(bb, updateBaseSqn, updates);
+	if (rc != ISMRC_OK)
+	{
+	    Trace_Error(this, "deliver_BF_Update()", "Error: malformed update","RC", rc);
+		return rc;
+	}
 
-	for (int i = 0; i < numUpdates; ++i)
+	//the full update chain is in the attribute map, this is not expected
+	gap = (updateBaseSqn != 0 && baseSqn != 0 && updateBaseSqn != baseSqn);
+	if (gap)
 	{
-		updates.push_back(bb.readInt());
+		Trace_Event(this, "deliver_BF_Update()", "update does not follow the delivered base",
+				"base", boost::lexical_cast<std::string>(baseSqn),
+				"update-base", boost::lexical_cast<std::string>(updateBaseSqn));
+		Trace_Exit(this,"deliver_BF_Update()", "gap");
+		return ISMRC_OK;
 	}
 
-	int rc = filterUpdatelistener.onBloomFilterUpdate(clusterHandle,
+	rc = filterUpdatelistener.onBloomFilterUpdate(clusterHandle,
 			filterTag, updates);
 	if (rc != ISMRC_OK)
 	{
@@ -3405,6 +3514,83 @@ int ViewKeeper::deliver_BF_Update(ismCluster_RemoteServerHandle_t clusterHandle,
 	return ISMRC_OK;
 }
 
+int ViewKeeper::redeliver_BF(
+		RemoteServerStatus_SPtr status,
+		const spdr::event::AttributeMap& attr_map,
+		const std::string& filterTag)
+{
+	using namespace std;
+
+	Trace_Entry(this,"redeliver_BF()", "tag", filterTag);
+
+	const bool exact = (filterTag == FilterTags::BF_ExactSub);
+	const string& baseTag = (exact ? FilterTags::BF_ExactSub_Base : FilterTags::BF_WildcardSub_Base);
+	const string& updateTag = (exact ? FilterTags::BF_ExactSub_Update : FilterTags::BF_WildcardSub_Update);
+
+	uint64_t base_sqn = 0;
+	const spdr::event::AttributeValue* base = NULL;
+	SortedBF_BaseUpdate_Map updates;
+	for (spdr::event::AttributeMap::const_iterator it = attr_map.begin(); it != attr_map.end(); ++it)
+	{
+		if (boost::starts_with(it->first, baseTag))
+		{
+			uint64_t sqn = getSQN_from_BFAttVal(it->second);
+			if (sqn > base_sqn)
+			{
+				base_sqn = sqn;
+				base = &(it->second);
+			}
+		}
+		else if (boost::starts_with(it->first, updateTag))
+		{
+			updates[getSQN_from_BFAttVal(it->second)] = it->second;
+		}
+	}
+
+	if (base == NULL)
+	{
+		Trace_Error(this, "redeliver_BF()", "Error: no BF base in attribute map", "tag", filterTag);
+		return ISMRC_Error;
+	}
+
+	int rc = deliver_BF_Base(&(status->info), *base, filterTag);
+	if (rc != ISMRC_OK)
+	{
+		return rc;
+	}
+	uint64_t last_sqn = base_sqn;
+
+	for (SortedBF_BaseUpdate_Map::const_iterator it = updates.upper_bound(base_sqn); it != updates.end(); ++it)
+	{
+		bool gap = false;
+		rc = deliver_BF_Update(&(status->info), it->second, filterTag, base_sqn, gap);
+		if (rc == ISMRC_OK && gap)
+		{
+			rc = ISMRC_Error;
+		}
+		if (rc != ISMRC_OK)
+		{
+			Trace_Error(this, "redeliver_BF()", "Error: calling deliver_BF_Update()", "RC", rc);
+			return rc;
+		}
+		last_sqn = it->first;
+	}
+
+	if (exact)
+	{
+		status->sqn_bf_exact_base = base_sqn;
+		status->sqn_bf_exact_last_update = last_sqn;
+	}
+	else
+	{
+		status->sqn_bf_wildcard_base = base_sqn;
+		status->sqn_bf_wildcard_last_update = last_sqn;
+	}
+
+	Trace_Exit(this,"redeliver_BF()", "last", boost::lexical_cast<std::string>(last_sqn));
+	return ISMRC_OK;
+}
+
 //int ViewKeeper::deliver_RCF_Base(
 //		RemoteServerStatus_SPtr status,
 //		const spdr::event::AttributeValue& attrVal)
@@ -137,6 +137,11 @@ public:
 	MCPReturnCode lookupRetainedStats(const char *pServerUID,
 	            ismCluster_LookupRetainedStatsInfo_t **pLookupInfo);
 
+	/*
+	 * Route cache hit and miss counts of the lookup set, since start.
+	 */
+	MCPReturnCode getRouteCacheStats(uint64_t& hits, uint64_t& misses);
+
 
 private:
 	const MCPConfig& mcp_config;
@@ -53,6 +53,19 @@ public:
 
 	MCPReturnCode publishLocalExactBF();
 
+	/*
+	 * Takes effect on the next publishLocalExactBF().
+	 * @see LocalSubManager::setBlockedBloomFilterSupport
+	 */
+	void setBlockedBloomFilterSupport(bool supported);
+
+	/*
+	 * Sends a full BF base on the next publishLocalExactBF(), which also
+	 * removes the published updates; used when the wire encoding changes.
+	 * @see LocalSubManager::setCompactBloomFilterEncoding
+	 */
+	void republishBloomFilterBase();
+
 private:
 	const MCPConfig& config;
 	LocalSubManager& localSubManager;
@@ -77,8 +90,15 @@ private:
 
 	std::vector<int> m_bf_updates_vec;
 	bool m_republish_base;
+	bool m_blockedBFSupported;
 
 	MCPReturnCode pushBloomFilterBase();
+
+	/* The configured hash type, or its fallback if a remote server cannot read it */
+	mcc_hash_HashType_t bloomFilterHashType() const;
+
+	/* Replace the CBF with an empty one and re-add all topics; republishes the base */
+	MCPReturnCode rebuildCountingBloomFilter(size_t numCounters);
 };
 
 } /* namespace mcp */
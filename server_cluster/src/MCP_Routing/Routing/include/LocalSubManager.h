@@ -41,6 +41,27 @@ public:
 	virtual MCPReturnCode schedulePublishMonitoringTask(int delayMillis) = 0;
 
 	virtual MCPReturnCode restoreSubscriptionPatterns(const std::vector<SubscriptionPattern_SPtr>& patterns) = 0;
+
+	/**
+	 * Whether every remote server can read cache line blocked BFs. When the
+	 * configured hash type is blocked and support goes away (or comes back),
+	 * the local BFs are rebuilt with the fallback (or blocked) hash type and
+	 * a new BF base is published.
+	 *
+	 * @param supported
+	 * @return
+	 */
+	virtual MCPReturnCode setBlockedBloomFilterSupport(bool supported) = 0;
+
+	/**
+	 * Whether every remote server can read run-length encoded BF bases and
+	 * sparse delta encoded BF updates. When support changes, the local BFs
+	 * publish a new BF base in the new encoding, replacing the updates.
+	 *
+	 * @param supported
+	 * @return
+	 */
+	virtual MCPReturnCode setCompactBloomFilterEncoding(bool supported) = 0;
 };
 
 typedef boost::shared_ptr<LocalSubManager> LocalSubManager_SPtr;
@@ -145,6 +145,16 @@ public:
 	 */
 	virtual MCPReturnCode restoreSubscriptionPatterns(const std::vector<SubscriptionPattern_SPtr>& patterns);
 
+	/*
+	 * @see LocaSubManager
+	 */
+	virtual MCPReturnCode setBlockedBloomFilterSupport(bool supported);
+
+	/*
+	 * @see LocaSubManager
+	 */
+	virtual MCPReturnCode setCompactBloomFilterEncoding(bool supported);
+
 	MCPReturnCode recoveryCompleted();
 
 	/**
@@ -241,6 +251,9 @@ private:
 
 	FatalErrorHandler* fatalErrorHandler_;
 
+	SubCoveringFilterPublisher_SPtr filterPublisher_;
+	bool compactBFEncoding_;
+
 	std::deque<ismCluster_EngineStatistics_t> engineStatistics_;
 	const unsigned int engineStatsNumPeriods_;
 
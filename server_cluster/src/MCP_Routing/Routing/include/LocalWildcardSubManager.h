@@ -73,6 +73,19 @@ public:
 
 	MCPReturnCode publishLocalUpdates();
 
+	/*
+	 * Takes effect on the next publishLocalUpdates().
+	 * @see LocalSubManager::setBlockedBloomFilterSupport
+	 */
+	void setBlockedBloomFilterSupport(bool supported);
+
+	/*
+	 * Sends a full BF base on the next publishLocalUpdates(), which also
+	 * removes the published updates; used when the wire encoding changes.
+	 * @see LocalSubManager::setCompactBloomFilterEncoding
+	 */
+	void republishBloomFilterBase();
+
 
 	/*
 	 * @see RemoteSubscriptionStatsListener
@@ -200,6 +213,7 @@ private:
 
 	uint8_t *isConn ;
 	size_t isConnSize;
+	bool m_blockedBFSupported;
 	MCPReturnCode isConnMakeRoom(uint16_t index);
 	int isConnected(uint16_t index);
 
@@ -225,6 +239,9 @@ private:
 
 	MCPReturnCode storeSubscriptionPatterns();
 
+	/* The configured hash type, or its fallback if a remote server cannot read it */
+	mcc_hash_HashType_t bloomFilterHashType() const;
+
 };
 
 } /* namespace mcp */
@@ -179,6 +179,20 @@ XAPI ism_rc_t mcc_lus_setRouteAll(mcc_lus_LUSetHandle_t hLUSetHandle,
 XAPI ism_rc_t mcc_lus_lookup(mcc_lus_LUSetHandle_t hLUSetHandle,
                         ismCluster_LookupInfo_t *pLookupInfo);
 
+/*********************************************************************/
+/* Get the route cache counters of the LUSet                         */
+/*                                                                   */
+/* @param hLUSetHandle  Handle of the LUSet                          */
+/* @param pHits         Number of lookups served from the cache.     */
+/*                      Output parameter                             */
+/* @param pMisses       Number of lookups that went to the BF sets.  */
+/*                      Output parameter                             */
+/*                                                                   */
+/* @return ISMRC_OK on successful completion or an ISMRC_ value.     */
+/*********************************************************************/
+XAPI ism_rc_t mcc_lus_getRouteCacheStats(mcc_lus_LUSetHandle_t hLUSetHandle,
+                        uint64_t *pHits, uint64_t *pMisses);
+
 
 #ifdef __cplusplus
 }
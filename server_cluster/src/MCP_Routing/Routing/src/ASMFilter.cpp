@@ -50,6 +50,10 @@ void ASMFilter::assignHashFunction(mcc_hash_HashType_t type) throw (MCPIllegalAr
 		m_hashFunctionsPtr = &mcc_hash_getAllValues_city64_LC;
 		break;
 
+	case ISM_HASH_TYPE_MURMUR_x64_128_BLK:
+		m_hashFunctionsPtr = &mcc_hash_getAllValues_murmur3_x64_128_BLK;
+		break;
+
 
 	default:
 		throw MCPIllegalArgumentError("ASMFilter Illegal HashType");
@@ -539,6 +539,27 @@ double CountingBloomFilter::estimateFPP() const
     int32_t n = m_numElements;
     uint8_t k = m_numHashes;
 
+    if (m_hashType == ISM_HASH_TYPE_MURMUR_x64_128_BLK && m >= MCC_HASH_BLOCK_BITS)
+    {
+        /*
+         * All k bins of an element are in one block, so the number of elements
+         * per block is Poisson distributed, and a block with i elements behaves
+         * like a small standard BF of MCC_HASH_BLOCK_BITS bins (Putze et al.).
+         */
+        const double b = MCC_HASH_BLOCK_BITS;
+        const double lambda = b * n / m;
+        const int iMax = static_cast<int>(lambda + 10 * sqrt(lambda)) + 10;
+        double poisson = exp(-lambda);
+        double fpp = 0;
+        for (int i = 0; i <= iMax; i++)
+        {
+            if (i > 0)
+                poisson *= lambda / i;
+            fpp += poisson * pow(1 - pow(1 - 1.0 / b, k * i), k);
+        }
+        return fpp;
+    }
+
     return pow(1 - pow((double) (1 - 1.0 / m), k * n), k);
 }
 
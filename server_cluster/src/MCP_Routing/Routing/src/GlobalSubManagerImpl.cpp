@@ -607,4 +607,19 @@ MCPReturnCode GlobalSubManagerImpl::lookupRetainedStats(const char *pServerUID,
 
 }
 
+MCPReturnCode GlobalSubManagerImpl::getRouteCacheStats(uint64_t& hits, uint64_t& misses)
+{
+    MCPReturnCode rc = ISMRC_ClusterNotAvailable;
+
+    {
+        boost::shared_lock<boost::shared_mutex> read_lock(shared_mutex);
+        if (!closed && started)
+        {
+            rc = mcc_lus_getRouteCacheStats(lus, &hits, &misses);
+        }
+    }
+
+    return rc;
+}
+
 } /* namespace mcp */
@@ -38,7 +38,8 @@ LocalExactSubManager::LocalExactSubManager(
 				m_bf_base_sqn(0),
 				m_bf_last_sqn(0),
 				m_numUpdates(0),
-				m_republish_base(false)
+				m_republish_base(false),
+				m_blockedBFSupported(false)
 {
     Trace_Entry(this, "LocalExactSubManager()");
 	// Initialize CountingBloomFilter pointer from config
@@ -52,9 +53,9 @@ LocalExactSubManager::LocalExactSubManager(
 
 	m_cbf.reset(
 			new CountingBloomFilter(parameters.first, parameters.second,
-					static_cast<mcc_hash_HashType_t>(config.getBloomFilterHashType()), counterSize));
+					bloomFilterHashType(), counterSize));
 	m_bf.reset(
-			new BloomFilter(parameters.first, parameters.second, static_cast<mcc_hash_HashType_t>(config.getBloomFilterHashType())));
+			new BloomFilter(parameters.first, parameters.second, bloomFilterHashType()));
 
 }
 
@@ -187,8 +188,6 @@ MCPReturnCode LocalExactSubManager::subscribe(const char* topic)
 	if (m_cbf->estimateFPP() > config.getBloomFilterErrorRate())
 	{
 		size_t numCounters = 2 * m_cbf->getNumCounters();
-		uint8_t numHashes = m_cbf->getNumHashes();
-		uint8_t counterSize = m_cbf->getCounterSize();
 
 		if (ScTraceBuffer::isEventEnabled(tc_))
 		{
@@ -199,28 +198,11 @@ MCPReturnCode LocalExactSubManager::subscribe(const char* topic)
 			buffer->invoke();
 		}
 
-		m_cbf.reset(
-				new CountingBloomFilter(numCounters, numHashes, static_cast<mcc_hash_HashType_t>(config.getBloomFilterHashType()),
-						counterSize));
-
-		for (SubscribedTopicsSet::iterator it = m_subscribedTopics.begin();
-				it != m_subscribedTopics.end(); ++it)
+		MCPReturnCode rc = rebuildCountingBloomFilter(numCounters);
+		if (rc != ISMRC_OK)
 		{
-		    try
-		    {
-		        m_cbf->add(*it);
-		    }
-		    catch (std::exception& e)
-		    {
-		        Trace_Error(this, __FUNCTION__, "Error: failed to add to CBF while resizing",
-		                "topic", topic, "what", e.what(),
-		                "RC", boost::lexical_cast<string>(ISMRC_Error));
-		        return ISMRC_Error;
-		    }
+		    return rc;
 		}
-
-		m_republish_base = true;
-		m_bf_updates_vec.clear();
 	}
 
 	if (m_recovered)
@@ -305,6 +287,34 @@ MCPReturnCode LocalExactSubManager::publishLocalExactBF()
 
     MCPReturnCode rc = ISMRC_OK;
 
+    if (m_cbf->getHashType() != bloomFilterHashType())
+    {
+        Trace_Event(this, "publishLocalExactBF()", "hash type changed, rebuilding CBF",
+                "from", boost::lexical_cast<string>(m_cbf->getHashType()),
+                "to", boost::lexical_cast<string>(bloomFilterHashType()));
+        rc = rebuildCountingBloomFilter(m_cbf->getNumCounters());
+        if (rc != ISMRC_OK)
+        {
+            return rc;
+        }
+    }
+
+    //too many update attributes: merge them into one, or send a base if that is not much smaller
+    bool trim = false;
+    if (!m_republish_base && static_cast<int32_t>(filterPublisher->getNumBloomFilterUpdates(FilterTags::BF_ExactSub)) > config.getBloomFilterMaxAttributes())
+    {
+        uint64_t sqn = filterPublisher->compactBloomFilterUpdates(FilterTags::BF_ExactSub);
+        if (sqn != 0)
+        {
+            m_bf_last_sqn = sqn;
+            Trace_Event(this, "publishLocalExactBF()", "trimming attributes, merged BF updates", "SQN", boost::lexical_cast<string>(sqn));
+        }
+        else
+        {
+            trim = true;
+        }
+    }
+
     if (m_republish_base)
     {
         if (ScTraceBuffer::isEventEnabled(tc_))
@@ -316,7 +326,7 @@ MCPReturnCode LocalExactSubManager::publishLocalExactBF()
         }
         rc = pushBloomFilterBase(); //ignore ISMRC_Closed
     }
-    else if ( static_cast<int32_t>(filterPublisher->getNumBloomFilterUpdates(FilterTags::BF_ExactSub)) > config.getBloomFilterMaxAttributes() )
+    else if (trim)
     {
         if (ScTraceBuffer::isEventEnabled(tc_))
         {
@@ -403,6 +413,56 @@ MCPReturnCode LocalExactSubManager::publishLocalExactBF()
     return rc;
 }
 
+void LocalExactSubManager::setBlockedBloomFilterSupport(bool supported)
+{
+    m_blockedBFSupported = supported;
+}
+
+void LocalExactSubManager::republishBloomFilterBase()
+{
+    m_republish_base = true;
+    m_bf_updates_vec.clear();
+}
+
+mcc_hash_HashType_t LocalExactSubManager::bloomFilterHashType() const
+{
+    mcc_hash_HashType_t type = static_cast<mcc_hash_HashType_t>(config.getBloomFilterHashType());
+    if (type == ISM_HASH_TYPE_MURMUR_x64_128_BLK && !m_blockedBFSupported)
+    {
+        type = ISM_HASH_TYPE_MURMUR_x64_128_CH;
+    }
+    return type;
+}
+
+MCPReturnCode LocalExactSubManager::rebuildCountingBloomFilter(size_t numCounters)
+{
+    using namespace std;
+
+    m_cbf.reset(
+            new CountingBloomFilter(numCounters, m_cbf->getNumHashes(), bloomFilterHashType(),
+                    m_cbf->getCounterSize()));
+
+    for (SubscribedTopicsSet::iterator it = m_subscribedTopics.begin();
+            it != m_subscribedTopics.end(); ++it)
+    {
+        try
+        {
+            m_cbf->add(*it);
+        }
+        catch (std::exception& e)
+        {
+            Trace_Error(this, __FUNCTION__, "Error: failed to add to CBF while rebuilding",
+                    "topic", *it, "what", e.what(),
+                    "RC", boost::lexical_cast<string>(ISMRC_Error));
+            return ISMRC_Error;
+        }
+    }
+
+    m_republish_base = true;
+    m_bf_updates_vec.clear();
+    return ISMRC_OK;
+}
+
 MCPReturnCode LocalExactSubManager::pushBloomFilterBase()
 {
     using namespace spdr;
@@ -417,7 +477,7 @@ MCPReturnCode LocalExactSubManager::pushBloomFilterBase()
     try
     {
         m_bf_base_sqn = filterPublisher->publishBloomFilterBase(FilterTags::BF_ExactSub,
-                static_cast<mcc_hash_HashType_t>(config.getBloomFilterHashType()), m_bf->getNumHashes(),
+                m_bf->getHashType(), m_bf->getNumHashes(),
                 m_bf->getNumBits(), m_bf->buffer());
         m_bf_last_sqn = m_bf_base_sqn;
 
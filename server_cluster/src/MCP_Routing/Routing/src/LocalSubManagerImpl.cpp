@@ -47,6 +47,8 @@ LocalSubManagerImpl::LocalSubManagerImpl(
 		retainedManager( new LocalRetainedStatsManager(inst_ID,mcpConfig, dynamic_cast<LocalSubManager&>(*this))),
 		monitoringManager( new LocalMonitoringManager(inst_ID,mcpConfig, dynamic_cast<LocalSubManager&>(*this))),
 		fatalErrorHandler_(NULL),
+		filterPublisher_(),
+		compactBFEncoding_(false),
 		engineStatsNumPeriods_(30) //30*10s = 5min
 {
 	Trace_Entry(this, "LocalSubManagerImpl()");
@@ -254,6 +256,12 @@ MCPReturnCode LocalSubManagerImpl::setSubCoveringFilterPublisher(
     rc = monitoringManager->setSubCoveringFilterPublisher(
             subCoveringFilterPublisher);
 
+    filterPublisher_ = subCoveringFilterPublisher;
+    if (filterPublisher_)
+    {
+        filterPublisher_->setCompactBloomFilterEncoding(compactBFEncoding_);
+    }
+
     return rc;
 }
 
@@ -367,6 +375,69 @@ MCPReturnCode LocalSubManagerImpl::restoreSubscriptionPatterns(const std::vector
     return rc;
 }
 
+MCPReturnCode LocalSubManagerImpl::setBlockedBloomFilterSupport(bool supported)
+{
+    Trace_Entry(this, "setBlockedBloomFilterSupport()",
+            "supported", (supported ? "true" : "false"));
+
+    boost::recursive_mutex::scoped_lock lock(m_stateMutex);
+    if (m_closed)
+    {
+        Trace_Exit(this, "setBlockedBloomFilterSupport()", "closed");
+        return ISMRC_ClusterNotAvailable;
+    }
+
+    exactManager->setBlockedBloomFilterSupport(supported);
+    wildcardManager->setBlockedBloomFilterSupport(supported);
+
+    if (m_recovered)
+    {
+        schedulePublishLocalBFTask(config.getPublishLocalBFTaskIntervalMillis());
+    }
+
+    Trace_Exit(this, "setBlockedBloomFilterSupport()", ISMRC_OK);
+    return ISMRC_OK;
+}
+
+MCPReturnCode LocalSubManagerImpl::setCompactBloomFilterEncoding(bool supported)
+{
+    Trace_Entry(this, "setCompactBloomFilterEncoding()",
+            "supported", (supported ? "true" : "false"));
+
+    boost::recursive_mutex::scoped_lock lock(m_stateMutex);
+    if (m_closed)
+    {
+        Trace_Exit(this, "setCompactBloomFilterEncoding()", "closed");
+        return ISMRC_ClusterNotAvailable;
+    }
+
+    if (compactBFEncoding_ == supported)
+    {
+        Trace_Exit(this, "setCompactBloomFilterEncoding()", "unchanged");
+        return ISMRC_OK;
+    }
+
+    //applied when the publisher is set, if it is not yet
+    compactBFEncoding_ = supported;
+    if (filterPublisher_)
+    {
+        filterPublisher_->setCompactBloomFilterEncoding(supported);
+    }
+
+    //the published base and updates are in the old encoding, which a
+    //member that just joined may not read; replace them with a new base
+    exactManager->republishBloomFilterBase();
+    wildcardManager->republishBloomFilterBase();
+
+    if (m_recovered)
+    {
+        schedulePublishLocalBFTask(config.getPublishLocalBFTaskIntervalMillis());
+    }
+
+    Trace_Exit(this, "setCompactBloomFilterEncoding()", ISMRC_OK);
+    return ISMRC_OK;
+}
+
 MCPReturnCode LocalSubManagerImpl::recoveryCompleted()
 {
 	boost::recursive_mutex::scoped_lock lock(m_stateMutex);
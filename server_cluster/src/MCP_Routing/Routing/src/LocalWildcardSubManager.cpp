@@ -63,7 +63,8 @@ LocalWildcardSubManager::LocalWildcardSubManager(const std::string& inst_ID,
 		m_subscriptionPattern_Map(),
 		m_subscriptionPattern_publish_queue(),
 		isConn(NULL),
-		isConnSize(0)
+		isConnSize(0),
+		m_blockedBFSupported(false)
 {
     Trace_Entry(this, "LocalWildcardSubManager()");
 
@@ -77,9 +78,9 @@ LocalWildcardSubManager::LocalWildcardSubManager(const std::string& inst_ID,
 					config.getBloomFilterProjectedNumElements(), desiredFPP);
 	m_cbf_WC.reset(
 			new CountingBloomFilter(parameters.first, parameters.second,
-					static_cast<mcc_hash_HashType_t>(config.getBloomFilterHashType()), counterSize));
+					bloomFilterHashType(), counterSize));
 	m_bf_WC.reset(
-			new BloomFilter(parameters.first, parameters.second, static_cast<mcc_hash_HashType_t>(config.getBloomFilterHashType())));
+			new BloomFilter(parameters.first, parameters.second, bloomFilterHashType()));
 
 	myNameHash = (uint32_t)CityHash64(myName.c_str(), myName.size());
 }
@@ -825,6 +826,27 @@ MCPReturnCode LocalWildcardSubManager::publishLocalUpdates()
 	return rc;
 }
 
+void LocalWildcardSubManager::setBlockedBloomFilterSupport(bool supported)
+{
+    m_blockedBFSupported = supported;
+}
+
+void LocalWildcardSubManager::republishBloomFilterBase()
+{
+    m_republish_base_WC = true;
+    m_bf_WC_updates_vec.clear();
+}
+
+mcc_hash_HashType_t LocalWildcardSubManager::bloomFilterHashType() const
+{
+    mcc_hash_HashType_t type = static_cast<mcc_hash_HashType_t>(config.getBloomFilterHashType());
+    if (type == ISM_HASH_TYPE_MURMUR_x64_128_BLK && !m_blockedBFSupported)
+    {
+        type = ISM_HASH_TYPE_MURMUR_x64_128_CH;
+    }
+    return type;
+}
+
 MCPReturnCode LocalWildcardSubManager::publishAll()
 {
     MCPReturnCode rc = ISMRC_OK;
@@ -1021,22 +1043,28 @@ MCPReturnCode LocalWildcardSubManager::publishLocalWildcardBF()
 	{
 		m_republish_base_WC = true;
 	}
-	else if (m_cbf_WC->estimateFPP() > config.getBloomFilterErrorRate())
+	else if (m_cbf_WC->estimateFPP() > config.getBloomFilterErrorRate() || m_cbf_WC->getHashType() != bloomFilterHashType())
 	{
-		size_t numCounters = 2 * m_cbf_WC->getNumCounters();
+		size_t numCounters = m_cbf_WC->getNumCounters();
 		uint8_t numHashes = m_cbf_WC->getNumHashes();
 		uint8_t counterSize = m_cbf_WC->getCounterSize();
 
+		if (m_cbf_WC->estimateFPP() > config.getBloomFilterErrorRate())
+		{
+			numCounters *= 2;
+		}
+
 		if (ScTraceBuffer::isEventEnabled(tc_))
 		{
-			ScTraceBufferAPtr buffer = ScTraceBuffer::event(this, "publishLocalWildcardBF()", "wildcard CBF passed false positive threshold, resizing");
+			ScTraceBufferAPtr buffer = ScTraceBuffer::event(this, "publishLocalWildcardBF()", "wildcard CBF passed false positive threshold or changed hash type, rebuilding");
 			buffer->addProperty<double>("desired", config.getBloomFilterErrorRate());
 			buffer->addProperty("estimated", m_cbf_WC->estimateFPP());
 			buffer->addProperty("new-numBins", numCounters);
+			buffer->addProperty<int>("new-hashType", bloomFilterHashType());
 			buffer->invoke();
 		}
 
-		m_cbf_WC.reset(new CountingBloomFilter(numCounters, numHashes, static_cast<mcc_hash_HashType_t>(config.getBloomFilterHashType()),counterSize));
+		m_cbf_WC.reset(new CountingBloomFilter(numCounters, numHashes, bloomFilterHashType(),counterSize));
 
 		for(SubscriptionPatternMap::iterator jt= m_subscriptionPattern_Map.begin();
 				jt != m_subscriptionPattern_Map.end(); ++jt)
@@ -1074,14 +1102,24 @@ MCPReturnCode LocalWildcardSubManager::publishLocalWildcardBF()
 	}
 	else if ( static_cast<int32_t>(filterPublisher->getNumBloomFilterUpdates(FilterTags::BF_WildcardSub)) > config.getBloomFilterMaxAttributes() )
 	{
-		if (ScTraceBuffer::isEventEnabled(tc_))
+		//merge the update attributes into one, or send a base if that is not much smaller
+		uint64_t sqn = filterPublisher->compactBloomFilterUpdates(FilterTags::BF_WildcardSub);
+		if (sqn != 0)
 		{
-			ScTraceBufferAPtr buffer = ScTraceBuffer::event(this,__FUNCTION__, "trimming attributes, re-sending BF-Base");
-			buffer->addProperty("#attributes", filterPublisher->getNumBloomFilterUpdates(FilterTags::BF_WildcardSub));
-			buffer->addProperty("#updates", m_numUpdates_WC);
-			buffer->invoke();
+			m_bf_WC_last_sqn = sqn;
+			Trace_Event(this, __FUNCTION__, "trimming attributes, merged BF updates", "SQN", boost::lexical_cast<string>(sqn));
+		}
+		else
+		{
+			if (ScTraceBuffer::isEventEnabled(tc_))
+			{
+				ScTraceBufferAPtr buffer = ScTraceBuffer::event(this,__FUNCTION__, "trimming attributes, re-sending BF-Base");
+				buffer->addProperty("#attributes", filterPublisher->getNumBloomFilterUpdates(FilterTags::BF_WildcardSub));
+				buffer->addProperty("#updates", m_numUpdates_WC);
+				buffer->invoke();
+			}
+			m_republish_base_WC = true;
 		}
-		m_republish_base_WC = true;
 	}
 
 	if (m_republish_base_WC)
@@ -1099,7 +1137,7 @@ MCPReturnCode LocalWildcardSubManager::publishLocalWildcardBF()
 	    try
 	    {
 	        m_bf_WC_base_sqn = filterPublisher->publishBloomFilterBase(FilterTags::BF_WildcardSub,
-	                static_cast<mcc_hash_HashType_t>(config.getBloomFilterHashType()), m_bf_WC->getNumHashes(),
+	                m_bf_WC->getHashType(), m_bf_WC->getNumHashes(),
 	                m_bf_WC->getNumBits(), m_bf_WC->buffer());
 	        m_bf_WC_last_sqn = m_bf_WC_base_sqn;
 
@@ -942,6 +942,16 @@ void MCPRoutingImpl::engineStatisticsTask()
             }
             else
             {
+                uint64_t hits = 0, misses = 0;
+                if (globalSubManager_SPtr && globalSubManager_SPtr->getRouteCacheStats(hits, misses) == ISMRC_OK)
+                {
+                    uint64_t lookups = hits + misses;
+                    Trace_Event(this, "engineStatisticsTask()", "route cache",
+                            "hits", spdr::stringValueOf(hits),
+                            "misses", spdr::stringValueOf(misses),
+                            "hit-rate%", spdr::stringValueOf(lookups ? (hits * 100) / lookups : 0));
+                }
+
                 boost::recursive_mutex::scoped_lock lock(state_mutex);
                 if (state_ == STATE_ACTIVE || state_ == STATE_RECOVERED)
                 {
@@ -190,6 +190,9 @@ XAPI int mcc_bfs_createBFSet(mcc_bfs_BFSetHandle_t *phBFSetHandle, mcc_bfs_BFSet
     case ISM_HASH_TYPE_MURMUR_x64_128_CH :
       pbf->getHashValues = mcc_hash_getAllValues_murmur3_x64_128;
       break;
+    case ISM_HASH_TYPE_MURMUR_x64_128_BLK :
+      pbf->getHashValues = mcc_hash_getAllValues_murmur3_x64_128_BLK;
+      break;
     default :
       mcc_bfs_deleteBFSet(pbf) ;
       return ISMRC_Error ; 
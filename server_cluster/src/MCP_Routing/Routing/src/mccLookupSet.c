@@ -72,6 +72,32 @@ typedef struct
     int                               flags;
 } mcc_node_t ; 
 
+/*
+ * Route cache: a direct mapped table, indexed by a hash of the topic, that
+ * holds the servers matched by the BF sets for recently looked up topics.
+ * An entry is valid only while its generation equals the LUSet generation,
+ * which is bumped by every call that changes the BFs, patterns, servers or
+ * route-all settings, so a change invalidates the whole cache at once.
+ * Lookups run concurrently (the caller holds a shared lock), so each entry
+ * is guarded by a try-lock; a thread that finds an entry busy just goes to
+ * the BF sets instead of waiting.
+ */
+#define LUS_RC_SIZE       1024   /* Number of entries (power of 2)          */
+#define LUS_RC_TOPIC_LEN   120   /* Longest topic held in an entry          */
+#define LUS_RC_DESTS        16   /* Most matched servers held in an entry   */
+
+typedef struct
+{
+    volatile int                     busy ;
+    uint32_t                         hash ;
+    uint64_t                         generation ;
+    uint16_t                         topicLen ;
+    uint16_t                         numDests ;
+    int                              index[LUS_RC_DESTS] ;
+    ismEngine_RemoteServerHandle_t   dests[LUS_RC_DESTS] ;
+    char                             topic[LUS_RC_TOPIC_LEN] ;
+} mcc_rcEntry_t ;
+
 
 struct mcc_lus_LUSet_t
 {
@@ -84,6 +110,10 @@ struct mcc_lus_LUSet_t
     int                         numRA;
     int                         id ; 
     size_t                      dbg_cnt[4];
+    mcc_rcEntry_t              *rCache ;
+    uint64_t                    generation ;
+    volatile uint64_t           rcHits ;
+    volatile uint64_t           rcMisses ;
 };
 
 static uint8_t   mask1[8] = {0x01,0x02,0x04,0x08,0x10,0x20,0x40,0x80} ;
@@ -91,6 +121,25 @@ static int id;
 
 /*********************************************************************/
 
+static inline uint32_t lus_topicHash(const char *pTopic, size_t topicLen)
+{
+    uint32_t h = 2166136261u ;
+    size_t i;
+    for ( i=0 ; i<topicLen ; i++ )
+    {
+        h ^= (uint8_t)pTopic[i] ;
+        h *= 16777619u ;
+    }
+    return h ;
+}
+
+static inline void lus_invalidateRoutes(mcc_lus_LUSetHandle_t lus)
+{
+    lus->generation++ ;
+}
+
+/*********************************************************************/
+
 XAPI ism_rc_t mcc_lus_createLUSet(mcc_lus_LUSetHandle_t *phLUSetHandle)
 {
     struct mcc_lus_LUSet_t *lus ;
@@ -108,8 +157,18 @@ XAPI ism_rc_t mcc_lus_createLUSet(mcc_lus_LUSetHandle_t *phLUSetHandle)
     memset(lus,0,size) ;
     lus->id = __sync_add_and_fetch(&id,1);
 
+    size = LUS_RC_SIZE * sizeof(mcc_rcEntry_t) ;
+    if (!(lus->rCache = ism_common_malloc(ISM_MEM_PROBE(ism_memory_cluster_misc,47),size)) )
+    {
+        ism_common_free(ism_memory_cluster_misc,lus) ;
+        return ISMRC_AllocateError ;
+    }
+    memset(lus->rCache,0,size) ;
+    lus->generation = 1 ;
+
     if ( BFSet_rwlock_init(lus->lock,NULL) )
     {
+        ism_common_free(ism_memory_cluster_misc,lus->rCache) ;
         ism_common_free(ism_memory_cluster_misc,lus) ;
         return ISMRC_Error ;
     }
@@ -134,6 +193,7 @@ XAPI ism_rc_t mcc_lus_deleteLUSet(mcc_lus_LUSetHandle_t *phLUSetHandle)
 
     *phLUSetHandle = NULL ;
     BFSet_rwlock_wrlock(lus->lock) ;
+    lus_invalidateRoutes(lus) ;
     do
     {
         lus->state = 0 ;
@@ -148,6 +208,8 @@ XAPI ism_rc_t mcc_lus_deleteLUSet(mcc_lus_LUSetHandle_t *phLUSetHandle)
         }  
         if ( rc == ISMRC_OK && lus->wbfs )
             rc = mcc_wcbfs_deleteWCBFSet(lus->wbfs) ;
+        if ( lus->rCache )
+            ism_common_free(ism_memory_cluster_misc,lus->rCache) ;
     } while(0) ;
     BFSet_rwlock_unlock(lus->lock) ;
     BFSet_rwlock_destroy(lus->lock) ;
@@ -209,6 +271,7 @@ XAPI ism_rc_t mcc_lus_addBF(mcc_lus_LUSetHandle_t hLUSetHandle,
         return ISMRC_Error ;
 
     BFSet_rwlock_wrlock(lus->lock) ;
+    lus_invalidateRoutes(lus) ;
     do
     {
         mcc_hash_t hashParams[1] ;
@@ -297,6 +360,7 @@ XAPI ism_rc_t mcc_lus_updateBF(mcc_lus_LUSetHandle_t hLUSetHandle,
         return ISMRC_Error ;
 
     BFSet_rwlock_wrlock(lus->lock) ;
+    lus_invalidateRoutes(lus) ;
     do
     {
         mcc_node_t *pNode ;
@@ -339,6 +403,7 @@ XAPI ism_rc_t mcc_lus_deleteBF(mcc_lus_LUSetHandle_t hLUSetHandle,
         return ISMRC_Error ;
 
     BFSet_rwlock_wrlock(lus->lock) ;
+    lus_invalidateRoutes(lus) ;
     do
     {
         mcc_node_t *pNode ;
@@ -391,6 +456,7 @@ XAPI ism_rc_t mcc_lus_addPattern(mcc_lus_LUSetHandle_t hLUSetHandle,
         return ISMRC_Error ;
 
     BFSet_rwlock_wrlock(lus->lock) ;
+    lus_invalidateRoutes(lus) ;
     do
     {
         mcc_node_t *pNode ;
@@ -421,6 +487,7 @@ XAPI ism_rc_t mcc_lus_deletePattern(mcc_lus_LUSetHandle_t hLUSetHandle,
         return ISMRC_Error ;
 
     BFSet_rwlock_wrlock(lus->lock) ;
+    lus_invalidateRoutes(lus) ;
     do
     {
         mcc_node_t *pNode ;
@@ -454,6 +521,7 @@ XAPI ism_rc_t mcc_lus_deleteServer(mcc_lus_LUSetHandle_t hLUSetHandle,
         return ISMRC_Error ;
 
     BFSet_rwlock_wrlock(lus->lock) ;
+    lus_invalidateRoutes(lus) ;
     do
     {
         mcc_node_t *pNode ;
@@ -498,6 +566,7 @@ XAPI ism_rc_t mcc_lus_setRouteAll(mcc_lus_LUSetHandle_t hLUSetHandle,
         return ISMRC_Error ;
 
     BFSet_rwlock_wrlock(lus->lock) ;
+    lus_invalidateRoutes(lus) ;
     do
     {
         mcc_node_t *pNode ;
@@ -530,8 +599,11 @@ XAPI ism_rc_t mcc_lus_lookup(mcc_lus_LUSetHandle_t hLUSetHandle,
         ismCluster_LookupInfo_t *pLookupInfo)
 {
     mcc_lus_LUSetHandle_t lus=hLUSetHandle ;
-    int i,j,k,nr, rl ;
+    int i,j,k,nr, rl, n0, fCacheable ;
     uint8_t *skip ;
+    int *rIndex ;
+    uint32_t hash=0 ;
+    mcc_rcEntry_t *rce=NULL ;
     ismCluster_RemoteServerHandle_t *r ;
     int rc=ISMRC_OK ;
     //  int line=0 ;
@@ -550,6 +622,7 @@ XAPI ism_rc_t mcc_lus_lookup(mcc_lus_LUSetHandle_t hLUSetHandle,
         size_t size = lus->mapSize>>3 ;
         skip = alloca(size) ;
         memset(skip,0,size) ;
+        fCacheable = 1 ;
         for ( i=0 ; i<pLookupInfo->numDests ; i++ )
         {
             ismCluster_RemoteServerHandle_t p = pLookupInfo->phMatchedServers[i] ;
@@ -558,6 +631,7 @@ XAPI ism_rc_t mcc_lus_lookup(mcc_lus_LUSetHandle_t hLUSetHandle,
             j = p->index >> 3 ;
             k = p->index &  7 ;
             skip[j] |= mask1[k] ;
+            fCacheable = 0 ;
         }
         if ( lus->numRA )
         {
@@ -588,9 +662,54 @@ XAPI ism_rc_t mcc_lus_lookup(mcc_lus_LUSetHandle_t hLUSetHandle,
             if ( rc != ISMRC_OK )
                 break;
         }
+
+        /* Try the route cache.  A cached entry holds the BF matches      */
+        /* excluding the route-all servers, so the caller's skip map is   */
+        /* applied on the way out.                                        */
+        if ( lus->rCache && pLookupInfo->topicLen <= LUS_RC_TOPIC_LEN )
+        {
+            hash = lus_topicHash(pLookupInfo->pTopic, pLookupInfo->topicLen) ;
+            rce = lus->rCache + (hash & (LUS_RC_SIZE-1)) ;
+            if ( !__sync_lock_test_and_set(&rce->busy,1) )
+            {
+                int fHit = ( rce->generation == lus->generation &&
+                             rce->hash == hash &&
+                             rce->topicLen == pLookupInfo->topicLen &&
+                             !memcmp(rce->topic, pLookupInfo->pTopic, pLookupInfo->topicLen) ) ;
+                if ( fHit )
+                {
+                    for ( i=0 ; i<rce->numDests ; i++ )
+                    {
+                        j = rce->index[i] >> 3 ;
+                        k = rce->index[i] &  7 ;
+                        if ( skip[j]&mask1[k] )
+                            continue ;
+                        if ( pLookupInfo->numDests >= pLookupInfo->destsLen )
+                        {
+                            rc = ISMRC_ClusterArrayTooSmall ;
+                            pLookupInfo->numDests = -1 ;
+                            break ;
+                        }
+                        pLookupInfo->phDests[pLookupInfo->numDests++] = rce->dests[i] ;
+                    }
+                }
+                __sync_lock_release(&rce->busy) ;
+                if ( fHit )
+                {
+                    __sync_add_and_fetch(&lus->rcHits,1) ;
+                    break ;
+                }
+            }
+            __sync_add_and_fetch(&lus->rcMisses,1) ;
+        }
+        else
+            fCacheable = 0 ;
+
+        n0 = pLookupInfo->numDests ;
         rl = pLookupInfo->destsLen - pLookupInfo->numDests ;
         size = rl * sizeof(ismCluster_RemoteServerHandle_t *) ;
         r = alloca(size) ;
+        rIndex = alloca(rl * sizeof(int)) ;
         for ( eLL=lus->ebfs1st ; eLL && rc==ISMRC_OK ; eLL = eLL->next )
         {
             if ( (rc = mcc_bfs_lookup(eLL->ebfs, pLookupInfo->pTopic, pLookupInfo->topicLen, skip, r, rl, &nr)) != ISMRC_OK )
@@ -613,6 +732,7 @@ XAPI ism_rc_t mcc_lus_lookup(mcc_lus_LUSetHandle_t hLUSetHandle,
                     //          line = __LINE__ ;
                     break ;
                 }
+                rIndex[pLookupInfo->numDests-n0] = p->index ;
                 pLookupInfo->phDests[pLookupInfo->numDests++] = p->engineHandle ;
                 j = p->index >> 3 ;
                 k = p->index &  7 ;
@@ -621,28 +741,47 @@ XAPI ism_rc_t mcc_lus_lookup(mcc_lus_LUSetHandle_t hLUSetHandle,
         }
         if ( rc != ISMRC_OK )
             break ;
-        if (!lus->wbfs )
-            break ;
-        if ( (rc = mcc_wcbfs_lookup(lus->wbfs, pLookupInfo->pTopic, pLookupInfo->topicLen, skip, r, rl, &nr)) != ISMRC_OK )
+        if ( lus->wbfs )
         {
-            if ( rc == ISMRC_ClusterArrayTooSmall )
-                pLookupInfo->numDests = -1 ;
-            //      line = __LINE__ ;
-            break ;
-        }
-        for ( i=0 ; i<nr ; i++ )
-        {
-            ismCluster_RemoteServerHandle_t p = r[i] ;
-            //      if ( p->deletedFlag )
-            //        continue;
-            if ( pLookupInfo->numDests >= pLookupInfo->destsLen )
+            if ( (rc = mcc_wcbfs_lookup(lus->wbfs, pLookupInfo->pTopic, pLookupInfo->topicLen, skip, r, rl, &nr)) != ISMRC_OK )
             {
-                rc = ISMRC_ClusterArrayTooSmall ;
-                pLookupInfo->numDests = -1 ;
-                //        line = __LINE__ ;
+                if ( rc == ISMRC_ClusterArrayTooSmall )
+                    pLookupInfo->numDests = -1 ;
+                //      line = __LINE__ ;
                 break ;
             }
-            pLookupInfo->phDests[pLookupInfo->numDests++] = p->engineHandle ;
+            for ( i=0 ; i<nr ; i++ )
+            {
+                ismCluster_RemoteServerHandle_t p = r[i] ;
+                //      if ( p->deletedFlag )
+                //        continue;
+                if ( pLookupInfo->numDests >= pLookupInfo->destsLen )
+                {
+                    rc = ISMRC_ClusterArrayTooSmall ;
+                    pLookupInfo->numDests = -1 ;
+                    //        line = __LINE__ ;
+                    break ;
+                }
+                rIndex[pLookupInfo->numDests-n0] = p->index ;
+                pLookupInfo->phDests[pLookupInfo->numDests++] = p->engineHandle ;
+            }
+            if ( rc != ISMRC_OK )
+                break ;
+        }
+
+        /* Remember the result.  Only lookups that started without any    */
+        /* engine matched servers see the full BF match set.              */
+        nr = pLookupInfo->numDests - n0 ;
+        if ( fCacheable && nr <= LUS_RC_DESTS && !__sync_lock_test_and_set(&rce->busy,1) )
+        {
+            rce->hash = hash ;
+            rce->topicLen = pLookupInfo->topicLen ;
+            memcpy(rce->topic, pLookupInfo->pTopic, pLookupInfo->topicLen) ;
+            rce->numDests = nr ;
+            memcpy(rce->index, rIndex, nr*sizeof(int)) ;
+            memcpy(rce->dests, pLookupInfo->phDests+n0, nr*sizeof(ismEngine_RemoteServerHandle_t)) ;
+            rce->generation = lus->generation ;
+            __sync_lock_release(&rce->busy) ;
         }
     } while(0);
     BFSet_rwlock_unlock(lus->lock) ;
@@ -650,3 +789,18 @@ XAPI ism_rc_t mcc_lus_lookup(mcc_lus_LUSetHandle_t hLUSetHandle,
     //  if ( rc != ISMRC_OK ) printf("!!! %s: failed at %d\n",__FUNCTION__,line);
     return rc ;
 }
+
+/*********************************************************************/
+
+XAPI ism_rc_t mcc_lus_getRouteCacheStats(mcc_lus_LUSetHandle_t hLUSetHandle,
+        uint64_t *pHits, uint64_t *pMisses)
+{
+    mcc_lus_LUSetHandle_t lus=hLUSetHandle ;
+
+    if ( !(hLUSetHandle && pHits && pMisses) )
+        return ISMRC_Error ;
+
+    *pHits   = lus->rcHits ;
+    *pMisses = lus->rcMisses ;
+    return ISMRC_OK ;
+}
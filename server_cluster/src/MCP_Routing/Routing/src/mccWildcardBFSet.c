@@ -69,9 +69,23 @@ typedef struct
 } mcc_lus_Pattern_i;
 
 
+/*
+ * A distinct pattern shape (plus levels, hash level and length) shared by all
+ * the BFs that have a pattern of that shape.  The lookup topic is rewritten
+ * into each shape once and the result tested against every BF in 'users'.
+ */
+typedef struct sharedPat_
+{
+  struct sharedPat_ *next ; 
+  int                refCount ;      /* Number of patLL entries using this shape */
+  uint64_t          *users ;         /* Bitmap of the BF indexes using the shape */
+  mcc_lus_Pattern_i  pat[1] ;        /* The shape (patternId is not used)        */
+} sharedPat ; 
+
 typedef struct patLL_
 {
   struct patLL_     *next ; 
+  sharedPat         *shared ; 
   mcc_lus_Pattern_i  pat[1] ;
 } patLL ; 
 
@@ -92,6 +106,8 @@ struct mcc_wcbfs_WCBFSet_t
   mcc_wcbf_t                    *wcbf ; 
   int                            nextI ; 
   int                            maxBFs;
+  sharedPat                     *f1stShared ; 
+  int                            usersWords ;    /* Length of each sharedPat users bitmap */
   BFSet_rwlock_t                 lock[1];
 };
 
@@ -101,6 +117,174 @@ static int mcc_wcbfs_addPattern_(mcc_wcbfs_WCBFSetHandle_t hWCBFSetHandle, int B
 
 /*************************************************************************/
 
+/*
+ * Make sure the users bitmap of every shared pattern can hold maxBFs bits
+ */
+static int mcc_wcbfs_growUsers(mcc_wcbfs_WCBFSetHandle_t pbf, int maxBFs)
+{
+  int words = (maxBFs + 63) >> 6 ; 
+  sharedPat *sp ; 
+
+  if ( words <= pbf->usersWords )
+    return ISMRC_OK ; 
+  for ( sp=pbf->f1stShared ; sp ; sp=sp->next )
+  {
+    uint64_t *users = (uint64_t *)ism_common_realloc(ISM_MEM_PROBE(ism_memory_cluster_misc,44),sp->users,words*sizeof(uint64_t)) ; 
+    if ( !users )
+      return ISMRC_AllocateError ; 
+    memset(users+pbf->usersWords,0,(words-pbf->usersWords)*sizeof(uint64_t)) ; 
+    sp->users = users ; 
+  }
+  pbf->usersWords = words ; 
+  return ISMRC_OK ; 
+}
+
+/*
+ * Find the shared pattern with the same shape as pPattern, creating it if needed
+ */
+static sharedPat *mcc_wcbfs_getShared(mcc_wcbfs_WCBFSetHandle_t pbf, mcc_lus_Pattern_t *pPattern)
+{
+  sharedPat *sp ; 
+  size_t size ; 
+
+  for ( sp=pbf->f1stShared ; sp ; sp=sp->next )
+  {
+    if ( sp->pat->numPluses  == pPattern->numPluses &&
+         sp->pat->hashLevel  == pPattern->hashLevel &&
+         sp->pat->patternLen == pPattern->patternLen &&
+        !memcmp(sp->pat->pPlusLevels, pPattern->pPlusLevels, pPattern->numPluses * sizeof(uint16_t)) )
+      return sp ; 
+  }
+  if ( pbf->usersWords < ((pbf->maxBFs + 63) >> 6) )
+    pbf->usersWords = (pbf->maxBFs + 63) >> 6 ; 
+  size = sizeof(sharedPat) + pPattern->numPluses * sizeof(uint16_t) ;
+  if (!(sp = (sharedPat *)ism_common_malloc(ISM_MEM_PROBE(ism_memory_cluster_misc,45),size)) )
+    return NULL ; 
+  if (!(sp->users = (uint64_t *)ism_common_calloc(ISM_MEM_PROBE(ism_memory_cluster_misc,46),pbf->usersWords,sizeof(uint64_t))) )
+  {
+    ism_common_free(ism_memory_cluster_misc,sp) ; 
+    return NULL ; 
+  }
+  sp->refCount = 0 ; 
+  memcpy(sp->pat, pPattern, sizeof(mcc_lus_Pattern_t)) ; 
+  sp->pat->patternId = 0 ; 
+  sp->pat->pPlusLevels = (uint16_t *)((uintptr_t)sp + sizeof(sharedPat)) ; 
+  memcpy(sp->pat->pPlusLevels, pPattern->pPlusLevels, pPattern->numPluses * sizeof(uint16_t)) ; 
+  sp->next = pbf->f1stShared ; 
+  pbf->f1stShared = sp ; 
+  return sp ; 
+}
+
+/*
+ * Free a shared pattern that nothing uses any more
+ */
+static void mcc_wcbfs_freeShared(mcc_wcbfs_WCBFSetHandle_t pbf, sharedPat *sp)
+{
+  sharedPat *sq ; 
+
+  if ( pbf->f1stShared == sp )
+    pbf->f1stShared = sp->next ; 
+  else
+  {
+    for ( sq=pbf->f1stShared ; sq->next != sp ; sq=sq->next ) ; 
+    sq->next = sp->next ; 
+  }
+  ism_common_free(ism_memory_cluster_misc,sp->users) ; 
+  ism_common_free(ism_memory_cluster_misc,sp) ; 
+}
+
+/*
+ * Stop pattern pll of a BF using shared pattern sp.  pll is ignored when
+ * checking whether other patterns of the BF still have the same shape.
+ */
+static void mcc_wcbfs_releaseShared(mcc_wcbfs_WCBFSetHandle_t pbf, int BFIndex, sharedPat *sp, patLL *pll)
+{
+  patLL *qll ; 
+
+  if ( !sp )
+    return ; 
+  for ( qll=pbf->wcbf[BFIndex].f1stPat ; qll && (qll == pll || qll->shared != sp) ; qll=qll->next ) ; 
+  if ( !qll )
+    sp->users[BFIndex>>6] &= ~(1UL<<(BFIndex&63)) ; 
+  if ( --sp->refCount <= 0 )
+    mcc_wcbfs_freeShared(pbf, sp) ; 
+}
+
+/*
+ * Start a pattern (already linked into the BF's list) using a shared pattern
+ */
+static void mcc_wcbfs_useShared(int BFIndex, patLL *pll, sharedPat *sp)
+{
+  pll->shared = sp ; 
+  sp->refCount++ ; 
+  sp->users[BFIndex>>6] |= (1UL<<(BFIndex&63)) ; 
+}
+
+/*
+ * Rewrite a topic into the shape of a pattern, replacing the levels at the
+ * plus levels with '+' and the levels from the hash level on with '#'.
+ * Returns the length of the rewritten topic in t, or -1 if the topic cannot
+ * match the pattern shape.
+ */
+static int mcc_wcbfs_shapeTopic(mcc_lus_Pattern_i *pat, const char *pTopic, int topicLen, char *t)
+{
+  const char *p, *u2 ; 
+  char *q ; 
+  int j,l,m ; 
+
+  j = 0 ; 
+  l = 1 ; 
+  m = 0 ; 
+  p = pTopic ; 
+  u2= p + topicLen ; 
+  q = t ; 
+  while ( p < u2 )
+  {
+    if ( j < pat->numPluses && l == pat->pPlusLevels[j] )
+    {
+      j++ ; 
+      *q++ = '+' ; 
+      do
+      {
+        if ( *p++ == '/' )
+        {
+          l++ ; 
+          *q++ = '/' ; 
+          break ; 
+        }
+      } while ( p < u2 )  ; 
+    }
+    else
+    if ( l == pat->hashLevel )
+    {
+      *q++ = '#' ; 
+      break ; 
+    }
+    else
+    if ( l > pat->patternLen )
+    {
+      m++ ; 
+      break ; 
+    }
+    else
+    {
+      do
+      {
+        if ( (*q++ = *p++) == '/' )
+        {
+          l++ ; 
+          break ; 
+        }
+      } while ( p < u2 )  ; 
+    }
+  }
+  if ( m || j < pat->numPluses || l < pat->hashLevel )
+    return -1 ; 
+  return q - t ; 
+}
+
+/*************************************************************************/
+
 XAPI int mcc_wcbfs_createWCBFSet(mcc_wcbfs_WCBFSetHandle_t *phWCBFSetHandle)
 {
   mcc_wcbfs_WCBFSetHandle_t pbf ; 
@@ -158,6 +342,13 @@ XAPI int mcc_wcbfs_deleteWCBFSet(mcc_wcbfs_WCBFSetHandle_t hWCBFSetHandle)
         ism_common_free(ism_memory_cluster_misc,wcbf->BFBytes) ;
     }
   }
+  while ( pbf->f1stShared )
+  {
+    sharedPat *sp = pbf->f1stShared ; 
+    pbf->f1stShared = sp->next ; 
+    ism_common_free(ism_memory_cluster_misc,sp->users) ; 
+    ism_common_free(ism_memory_cluster_misc,sp) ; 
+  }
   ism_common_free(ism_memory_cluster_misc,pbf->wcbf) ; 
   BFSet_rwlock_destroy(pbf->lock) ; 
   ism_common_free(ism_memory_cluster_misc,pbf) ; 
@@ -193,6 +384,8 @@ XAPI int mcc_wcbfs_addBF(mcc_wcbfs_WCBFSetHandle_t hWCBFSetHandle, int BFIndex,
         }
         memset(wcbf+pbf->maxBFs,0,size/2) ; 
         pbf->wcbf = wcbf ; 
+        if ( (rc = mcc_wcbfs_growUsers(pbf, pbf->maxBFs * 2)) != ISMRC_OK )
+          break ; 
         pbf->maxBFs *= 2 ; 
       }
       pbf->nextI = i+1 ; 
@@ -246,6 +439,9 @@ XAPI int mcc_wcbfs_addBF(mcc_wcbfs_WCBFSetHandle_t hWCBFSetHandle, int BFIndex,
       case ISM_HASH_TYPE_MURMUR_x64_128_CH :
         wcbf->getHashValues = mcc_hash_getAllValues_murmur3_x64_128;
         break;
+      case ISM_HASH_TYPE_MURMUR_x64_128_BLK :
+        wcbf->getHashValues = mcc_hash_getAllValues_murmur3_x64_128_BLK;
+        break;
       default :
         return ISMRC_Error ; 
     }
@@ -334,6 +530,7 @@ XAPI int mcc_wcbfs_deleteBF(mcc_wcbfs_WCBFSetHandle_t hWCBFSetHandle, int BFInde
     {
       patLL *p = wcbf->f1stPat ; 
       wcbf->f1stPat = p->next ; 
+      mcc_wcbfs_releaseShared(pbf, i, p->shared, p) ; 
       ism_common_free(ism_memory_cluster_misc,p) ; 
     }
     ism_common_free(ism_memory_cluster_misc,wcbf->BFBytes) ; 
@@ -358,6 +555,7 @@ static int mcc_wcbfs_addPattern_(mcc_wcbfs_WCBFSetHandle_t hWCBFSetHandle, int B
   do
   {
     patLL *pll, *qll ; 
+    sharedPat *sp ; 
     size_t size ;
     i = BFIndex ;
     if ( i >= pbf->nextI )
@@ -372,6 +570,8 @@ static int mcc_wcbfs_addPattern_(mcc_wcbfs_WCBFSetHandle_t hWCBFSetHandle, int B
         }
         memset(wcbf+pbf->maxBFs,0,size/2) ;
         pbf->wcbf = wcbf ;
+        if ( (rc = mcc_wcbfs_growUsers(pbf, pbf->maxBFs * 2)) != ISMRC_OK )
+          break ;
         pbf->maxBFs *= 2 ;
       }
       pbf->nextI = i+1 ;
@@ -381,6 +581,11 @@ static int mcc_wcbfs_addPattern_(mcc_wcbfs_WCBFSetHandle_t hWCBFSetHandle, int B
     if (!wcbf->state )
       memset(wcbf,0,sizeof(mcc_wcbf_t)) ;
     wcbf->state |= 2 ;
+    if (!(sp = mcc_wcbfs_getShared(pbf, pPattern)) )
+    {
+      rc = ISMRC_AllocateError ; 
+      break ; 
+    }
     for ( pll=wcbf->f1stPat, qll=NULL ; pll ; qll=pll, pll=pll->next )
     {
       if ( pll->pat->patternId == pPattern->patternId )
@@ -403,6 +608,12 @@ static int mcc_wcbfs_addPattern_(mcc_wcbfs_WCBFSetHandle_t hWCBFSetHandle, int B
         memcpy(pll->pat, pPattern, sizeof(mcc_lus_Pattern_t)) ; 
         pll->pat->pPlusLevels = (uint16_t *)((uintptr_t)pll + sizeof(patLL)) ; 
         memcpy(pll->pat->pPlusLevels, pPattern->pPlusLevels, pPattern->numPluses * sizeof(uint16_t)) ; 
+        if ( pll->shared != sp )
+        {
+          sharedPat *old = pll->shared ; 
+          mcc_wcbfs_useShared(i, pll, sp) ; 
+          mcc_wcbfs_releaseShared(pbf, i, old, pll) ; 
+        }
         break ; 
       }
     }
@@ -412,14 +623,19 @@ static int mcc_wcbfs_addPattern_(mcc_wcbfs_WCBFSetHandle_t hWCBFSetHandle, int B
       if (!(pll = (patLL *)ism_common_malloc(ISM_MEM_PROBE(ism_memory_cluster_misc,17),size)) )
       {
         rc = ISMRC_AllocateError ; 
-        break ; 
       }
-      memcpy(pll->pat, pPattern, sizeof(mcc_lus_Pattern_t)) ; 
-      pll->pat->pPlusLevels = (uint16_t *)((uintptr_t)pll + sizeof(patLL)) ; 
-      memcpy(pll->pat->pPlusLevels, pPattern->pPlusLevels, pPattern->numPluses * sizeof(uint16_t)) ; 
-      pll->next = wcbf->f1stPat ; 
-      wcbf->f1stPat = pll ; 
+      else
+      {
+        memcpy(pll->pat, pPattern, sizeof(mcc_lus_Pattern_t)) ; 
+        pll->pat->pPlusLevels = (uint16_t *)((uintptr_t)pll + sizeof(patLL)) ; 
+        memcpy(pll->pat->pPlusLevels, pPattern->pPlusLevels, pPattern->numPluses * sizeof(uint16_t)) ; 
+        pll->next = wcbf->f1stPat ; 
+        wcbf->f1stPat = pll ; 
+        mcc_wcbfs_useShared(i, pll, sp) ; 
+      }
     }
+    if ( rc != ISMRC_OK && sp->refCount == 0 )
+      mcc_wcbfs_freeShared(pbf, sp) ; 
   } while(0);
   return rc ;
 }
@@ -466,6 +682,7 @@ XAPI int mcc_wcbfs_deletePattern(mcc_wcbfs_WCBFSetHandle_t hWCBFSetHandle, int B
           qll->next = pll->next ; 
         else
           wcbf->f1stPat = pll->next ;
+        mcc_wcbfs_releaseShared(pbf, i, pll->shared, pll) ; 
         ism_common_free(ism_memory_cluster_misc,pll) ; 
         break ; 
       }
@@ -482,6 +699,11 @@ XAPI int mcc_wcbfs_deletePattern(mcc_wcbfs_WCBFSetHandle_t hWCBFSetHandle, int B
 
 /*************************************************************************/
 
+/*
+ * The topic is rewritten and hashed once per distinct pattern shape (and hash
+ * configuration), rather than once per pattern of every BF, and the result is
+ * tested against each BF that has a pattern of that shape.
+ */
 XAPI int mcc_wcbfs_lookup(mcc_wcbfs_WCBFSetHandle_t hWCBFSetHandle, char *pTopic, int topicLen, uint8_t *skip, 
                         mcc_wcbfs_BFLookupHandle_t *phResults, int resultsLen, int *pNumResults)
 {
@@ -494,83 +716,64 @@ XAPI int mcc_wcbfs_lookup(mcc_wcbfs_WCBFSetHandle_t hWCBFSetHandle, char *pTopic
     return ISMRC_Error ; 
 
   BFSet_rwlock_rdlock(pbf->lock) ; 
+  n = 0 ; 
   do
   {
-    int j1,k1;
+    int nw = pbf->usersWords, maxNh = 0 ; 
+    sharedPat *sp ; 
+
+    if ( !pbf->f1stShared || !nw )
+      break ; 
+
+    uint64_t candidates[nw] ; 
+    memset(candidates,0,sizeof(candidates)) ; 
     wcbf = pbf->wcbf ; 
-    n = 0 ; 
-    for ( i=0 ; i<pbf->nextI && rc==ISMRC_OK ; i++,wcbf++ )
+    for ( i=0 ; i<pbf->nextI ; i++,wcbf++ )
     {
-      j1 = i >> 3 ; 
-      k1 = i &  7 ; 
-      if ( (wcbf->state&3)==3 && !(skip[j1]&mask1[k1]) )
+      if ( (wcbf->state&3)==3 && !(skip[i>>3]&mask1[i&7]) )
       {
-        patLL *pll ; 
-        int nl=0 , nh=wcbf->numHashValues ;
-        for ( pll=wcbf->f1stPat ; pll && rc==ISMRC_OK ; pll=pll->next )
+        candidates[i>>6] |= (1UL<<(i&63)) ; 
+        if ( maxNh < wcbf->numHashValues )
+          maxNh = wcbf->numHashValues ; 
+      }
+    }
+
+    char t[2*topicLen+2] ; 
+    uint32_t hashes[maxNh+1] ; 
+    for ( sp=pbf->f1stShared ; sp && rc==ISMRC_OK ; sp=sp->next )
+    {
+      mcc_hash_getAllValues_t hashFn = NULL ; 
+      int hashNh = 0 ; 
+      size_t hashPos = 0 ; 
+      int w, l = -2 ; 
+
+      for ( w=0 ; w<nw && rc==ISMRC_OK ; w++ )
+      {
+        uint64_t bits = sp->users[w] & candidates[w] ; 
+        while ( bits )
         {
-          char t[topicLen], *p, *q, *u2 ; 
-          uint32_t hashes[nh];
-          int j,k,l,m ; 
-          if ( nl > pll->pat->hashLevel  &&  pll->pat->hashLevel ) continue ; 
-          if ( nl > pll->pat->patternLen && !pll->pat->hashLevel ) continue ; 
-          j = k = 0 ; 
-          l = 1 ; 
-          m = 0 ; 
-          p = pTopic ; 
-          u2= p + topicLen ; 
-          q = t ; 
-          while ( p < u2 )
+          int m, nh ; 
+          i = (w<<6) + __builtin_ctzl(bits) ; 
+          bits &= bits - 1 ; 
+          if ( l == -2 )
           {
-            if ( j < pll->pat->numPluses && l == pll->pat->pPlusLevels[j] )
-            {
-              j++ ; 
-              *q++ = '+' ; 
-              do
-              {
-                if ( *p++ == '/' )
-                {
-                  l++ ; 
-                  *q++ = '/' ; 
-                  break ; 
-                }
-              } while ( p < u2 )  ; 
-            }
-            else
-            if ( l == pll->pat->hashLevel )
-            {
-              *q++ = '#' ; 
-              break ; 
-            }
-            else
-            if ( l > pll->pat->patternLen )
-            {
-              m++ ; 
-              break ; 
-            }
-            else
-            {
-              do
-              {
-                if ( (*q++ = *p++) == '/' )
-                {
-                  l++ ; 
-                  break ; 
-                }
-              } while ( p < u2 )  ; 
-            }
+            l = mcc_wcbfs_shapeTopic(sp->pat, pTopic, topicLen, t) ; 
+          }
+          if ( l < 0 )
+            break ; 
+          wcbf = pbf->wcbf + i ; 
+          nh = wcbf->numHashValues ; 
+          /* BFs created with the same hash parameters share the hash values */
+          if ( hashFn != wcbf->getHashValues || hashNh != nh || hashPos != wcbf->numPos )
+          {
+            wcbf->getHashValues(t,l, nh, wcbf->numPos, hashes);
+            hashFn = wcbf->getHashValues ; 
+            hashNh = nh ; 
+            hashPos = wcbf->numPos ; 
           }
-          if ( nl < l )
-               nl = l ;
-          if ( m || j < pll->pat->numPluses || l < pll->pat->hashLevel )
-            continue ; 
-          l = q - t ; 
-          wcbf->getHashValues(t,l, nh, wcbf->numPos, hashes);
           for ( m=0 ; m<nh ; m++ )
           {
-            j = hashes[m] & 7 ; 
-            k = hashes[m] >> 3 ; 
-            if ( !(wcbf->BFBytes[k] & mask1[j]) )
+            if ( !(wcbf->BFBytes[hashes[m] >> 3] & mask1[hashes[m] & 7]) )
               break ; 
           }
           if ( m>=nh )
@@ -581,9 +784,11 @@ XAPI int mcc_wcbfs_lookup(mcc_wcbfs_WCBFSetHandle_t hWCBFSetHandle, char *pTopic
               break ; 
             }
             phResults[n++] = wcbf->user ; 
-            break ; 
+            candidates[w] &= ~(1UL<<(i&63)) ; 
           }
         }
+        if ( l == -1 )
+          break ; 
       }
     }
   } while(0);
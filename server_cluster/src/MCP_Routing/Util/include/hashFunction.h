@@ -31,6 +31,7 @@ extern "C" {
 #define MCC_MAX_HASH_VALUES   26
 #define MCC_INITIAL_HASH_SEED 17
 #define MCC_MIN_INPUT_ARRAY_LEN 32
+#define MCC_HASH_BLOCK_BITS   512  /* Bits in a cache line (64 byte) block of a blocked BF */
 
 
 
@@ -40,7 +41,9 @@ typedef enum
    ISM_HASH_TYPE_CITY64_LC          = 1, /* City 64 bit, with linear combinations   */
    ISM_HASH_TYPE_CITY64_CH         	= 2, /* City 64 bit, seed chaining              */
    ISM_HASH_TYPE_MURMUR_x64_128_LC 	= 3, /* Murmur 64 bit, with linear combinations */
-   ISM_HASH_TYPE_MURMUR_x64_128_CH 	= 4  /* Murmur 64 bit, seed chaining            */
+   ISM_HASH_TYPE_MURMUR_x64_128_CH 	= 4, /* Murmur 64 bit, seed chaining            */
+   ISM_HASH_TYPE_MURMUR_x64_128_BLK	= 5  /* Murmur 64 bit, all values of a key in   */
+                                        /* one MCC_HASH_BLOCK_BITS block           */
 } mcc_hash_HashType_t;
 
 /*******************************************************************************/
@@ -81,6 +84,7 @@ void mcc_hash_getAllValues_murmur3_x86_32(const char *pKey, size_t keyLen, int n
 void mcc_hash_getAllValues_murmur3_x64_128(const char *pKey, size_t keyLen, int numValues, uint32_t maxValue, uint32_t *pResults);
 void mcc_hash_getAllValues_murmur3_x64_128_raw(const char *pKey, size_t keyLen, int numValues, uint32_t maxValue, uint32_t *pResults);
 void mcc_hash_getAllValues_murmur3_x64_128_LC(const char *pKey, size_t keyLen, int numValues, uint32_t maxValue, uint32_t *pResults);
+void mcc_hash_getAllValues_murmur3_x64_128_BLK(const char *pKey, size_t keyLen, int numValues, uint32_t maxValue, uint32_t *pResults);
 
 void mcc_hash_getSingleValue_city64_simple(const char *pKey, size_t keyLen, uint32_t maxValue, char *pInput, uint32_t *pResult);
 void mcc_hash_getSingleValue_murmur3_x86_32(const char *pKey, size_t keyLen, uint32_t maxValue, char *pInput, uint32_t *pResult);
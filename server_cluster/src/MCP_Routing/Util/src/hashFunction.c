@@ -164,6 +164,52 @@ void mcc_hash_getAllValues_murmur3_x64_128_LC(const char *pKey, size_t keyLen,
 	}
 }
 
+/* MurmurHash3 blocked: all values of a key fall in one MCC_HASH_BLOCK_BITS   */
+/* block, i.e. one cache line of the BF, chosen by the key. Within the block  */
+/* each value is a separate 9 bit slice of the hash, more hashes being        */
+/* chained as for the other types when the slices run out. A range that is   */
+/* not a multiple of the block size is treated as a single block, which keeps */
+/* the values consistent across BFs of different power of 2 lengths (a short  */
+/* BF replicated into a longer one still matches).                            */
+/* The pResults array need not have room for additional values.               */
+void mcc_hash_getAllValues_murmur3_x64_128_BLK(const char *pKey, size_t keyLen,
+		int numValues, uint32_t maxValue, uint32_t *pResults)
+{
+	int i = 0, w = 0, c, numWords = 3, slicesPerWord = 3;
+	uint32_t hv = MCC_INITIAL_HASH_SEED, out[4], base = 0, range = maxValue, word;
+	uint32_t mask = MCC_HASH_BLOCK_BITS - 1;
+
+	MurmurHash3_x64_128(pKey, keyLen, hv, out);
+	if (maxValue >= MCC_HASH_BLOCK_BITS && (maxValue % MCC_HASH_BLOCK_BITS) == 0)
+	{
+		base = (out[3] % (maxValue / MCC_HASH_BLOCK_BITS)) * MCC_HASH_BLOCK_BITS;
+		range = MCC_HASH_BLOCK_BITS;
+	}
+	else if (maxValue > MCC_HASH_BLOCK_BITS)
+	{
+		/* A 9 bit slice does not cover the range, use whole words */
+		slicesPerWord = 1;
+		mask = 0xFFFFFFFF;
+	}
+
+	while (i < numValues)
+	{
+		if (w == numWords)
+		{
+			hv = out[0];
+			MurmurHash3_x64_128(pKey, keyLen, hv, out);
+			w = 0;
+			numWords = 4;
+		}
+		word = out[w++];
+		for (c = 0; c < slicesPerWord && i < numValues; c++)
+		{
+			pResults[i++] = base + (word & mask) % range;
+			word >>= 9;
+		}
+	}
+}
+
 /*******************************************************************************/
 void mcc_hash_getSingleValue_city64_simple(const char *pKey, size_t keyLen,
 		uint32_t maxValue, char *pInput, uint32_t *pResult)
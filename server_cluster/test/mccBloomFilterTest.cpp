@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2015-2021 Contributors to the Eclipse Foundation
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+/*********************************************************************/
+/*                                                                   */
+/* Module Name: mccBloomFilterTest.cpp                               */
+/*                                                                   */
+/* Description: CUnit tests of the cache line blocked Bloom filter   */
+/*              (ISM_HASH_TYPE_MURMUR_x64_128_BLK).                  */
+/*                                                                   */
+/*  - hash values against known vectors                              */
+/*  - estimated false positive rate against known values             */
+/*                                                                   */
+/*********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <string>
+
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+
+#include "hashFunction.h"
+#include "CountingBloomFilter.h"
+
+using namespace mcp;
+
+namespace
+{
+
+const int NUM_VALUES = 7;
+
+struct HashVector
+{
+	const char * key;
+	uint32_t maxValue;
+	uint32_t values[NUM_VALUES];
+};
+
+/*
+ * Expected values of mcc_hash_getAllValues_murmur3_x64_128_BLK. These are
+ * part of the wire format, as every member must hash a topic to the same BF
+ * bins, so they must not change.
+ */
+const HashVector hashVectors[] = {
+	{ "sport/tennis", 8192,    { 955, 967, 865, 687, 554, 646, 547 } },
+	{ "sport/tennis", 1000,    { 235, 175, 491, 790, 524, 649, 516 } },
+	{ "sport/tennis", 512,     { 443, 455, 353, 175, 42, 134, 35 } },
+	{ "sport/tennis", 1048576, { 762811, 762823, 762721, 762543, 762410, 762502, 762403 } },
+	{ "", 8192,                { 1608, 1610, 1642, 1663, 1848, 1999, 1814 } },
+	{ "", 1000,                { 336, 287, 950, 956, 162, 477, 727 } },
+	{ "", 512,                 { 72, 74, 106, 127, 312, 463, 278 } },
+	{ "sensors/building1/floor2/temperature", 8192,    { 2998, 3020, 2975, 2922, 3013, 2908, 2948 } },
+	{ "sensors/building1/floor2/temperature", 1000,    { 814, 978, 412, 293, 928, 464, 809 } },
+	{ "sensors/building1/floor2/temperature", 512,     { 438, 460, 415, 362, 453, 348, 388 } },
+	{ "sensors/building1/floor2/temperature", 1048576, { 748470, 748492, 748447, 748394, 748485, 748380, 748420 } },
+};
+
+const size_t numHashVectors = sizeof(hashVectors) / sizeof(hashVectors[0]);
+
+void blockedHashTest(void)
+{
+	for (size_t v = 0; v < numHashVectors; v++)
+	{
+		const HashVector& vec = hashVectors[v];
+		uint32_t values[NUM_VALUES];
+
+		mcc_hash_getAllValues_murmur3_x64_128_BLK(vec.key, strlen(vec.key), NUM_VALUES, vec.maxValue, values);
+
+		for (int i = 0; i < NUM_VALUES; i++)
+		{
+			CU_ASSERT(values[i] == vec.values[i]);
+		}
+
+		//When the range is made of blocks, all the values of a key fall in a
+		//single block
+		for (int i = 0; i < NUM_VALUES; i++)
+		{
+			CU_ASSERT(values[i] < vec.maxValue);
+			if (vec.maxValue % MCC_HASH_BLOCK_BITS == 0)
+			{
+				CU_ASSERT(values[i] / MCC_HASH_BLOCK_BITS == values[0] / MCC_HASH_BLOCK_BITS);
+			}
+		}
+	}
+
+	//More values than the first hash has slices of, the first ones unchanged
+	uint32_t first[NUM_VALUES];
+	uint32_t values[MCC_MAX_HASH_VALUES];
+
+	mcc_hash_getAllValues_murmur3_x64_128_BLK("sport/tennis", 12, NUM_VALUES, 8192, first);
+	mcc_hash_getAllValues_murmur3_x64_128_BLK("sport/tennis", 12, MCC_MAX_HASH_VALUES, 8192, values);
+	for (int i = 0; i < MCC_MAX_HASH_VALUES; i++)
+	{
+		CU_ASSERT(values[i] / MCC_HASH_BLOCK_BITS == first[0] / MCC_HASH_BLOCK_BITS);
+		if (i < NUM_VALUES)
+		{
+			CU_ASSERT(values[i] == first[i]);
+		}
+	}
+}
+
+/*
+ * The offset within the block does not depend on the number of blocks, so a
+ * BF replicated into one of a larger power of 2 length still matches.
+ */
+void blockedHashResizeTest(void)
+{
+	const char * key = "sport/tennis";
+	uint32_t single[NUM_VALUES];
+
+	mcc_hash_getAllValues_murmur3_x64_128_BLK(key, strlen(key), NUM_VALUES, MCC_HASH_BLOCK_BITS, single);
+
+	for (uint32_t maxValue = 2 * MCC_HASH_BLOCK_BITS; maxValue <= (1 << 20); maxValue *= 2)
+	{
+		uint32_t values[NUM_VALUES];
+		mcc_hash_getAllValues_murmur3_x64_128_BLK(key, strlen(key), NUM_VALUES, maxValue, values);
+
+		for (int i = 0; i < NUM_VALUES; i++)
+		{
+			CU_ASSERT(values[i] % MCC_HASH_BLOCK_BITS == single[i]);
+		}
+	}
+}
+
+CountingBloomFilter * fillFilter(size_t numCounters, uint8_t numHashes, mcc_hash_HashType_t hashType, int numElements)
+{
+	CountingBloomFilter * cbf = new CountingBloomFilter(numCounters, numHashes, hashType);
+	char topic[64];
+
+	for (int i = 0; i < numElements; i++)
+	{
+		snprintf(topic, sizeof(topic), "topic/%d", i);
+		cbf->add(std::string(topic));
+	}
+	CU_ASSERT(cbf->getNumElements() == numElements);
+
+	return cbf;
+}
+
+/*
+ * Expected estimates, from the Poisson sum over blocks for blocked filters
+ * and from (1 - (1 - 1/m)^kn)^k otherwise.
+ */
+void blockedFPPTest(void)
+{
+	const double tolerance = 1e-12;
+	CountingBloomFilter * cbf;
+
+	cbf = fillFilter(8192, 7, ISM_HASH_TYPE_MURMUR_x64_128_BLK, 500);
+	CU_ASSERT(fabs(cbf->estimateFPP() - 0.0008761154803595325) < tolerance);
+	delete cbf;
+
+	//Depends only on the elements per block
+	cbf = fillFilter(65536, 7, ISM_HASH_TYPE_MURMUR_x64_128_BLK, 4000);
+	CU_ASSERT(fabs(cbf->estimateFPP() - 0.0008761154803595325) < tolerance);
+	delete cbf;
+
+	cbf = fillFilter(8192, 5, ISM_HASH_TYPE_MURMUR_x64_128_BLK, 1000);
+	CU_ASSERT(fabs(cbf->estimateFPP() - 0.02128568392201637) < tolerance);
+	delete cbf;
+
+	//The same filters without blocks have a lower rate
+	cbf = fillFilter(8192, 7, ISM_HASH_TYPE_MURMUR_x64_128_CH, 500);
+	CU_ASSERT(fabs(cbf->estimateFPP() - 0.0006145472732675149) < tolerance);
+	delete cbf;
+
+	cbf = fillFilter(8192, 5, ISM_HASH_TYPE_MURMUR_x64_128_CH, 1000);
+	CU_ASSERT(fabs(cbf->estimateFPP() - 0.019902945922302486) < tolerance);
+	delete cbf;
+
+	//A filter shorter than a block is a single standard filter
+	cbf = fillFilter(256, 7, ISM_HASH_TYPE_MURMUR_x64_128_BLK, 20);
+	CU_ASSERT(fabs(cbf->estimateFPP() - 0.0023779694344651416) < tolerance);
+	delete cbf;
+}
+
+/*
+ * The false positive rate seen with topics not in the filter is close to the
+ * estimate the filter resizing relies on.
+ */
+void blockedFPPMeasuredTest(void)
+{
+	const int numProbes = 100000;
+	CountingBloomFilter * cbf = fillFilter(8192, 7, ISM_HASH_TYPE_MURMUR_x64_128_BLK, 500);
+	char topic[64];
+	int falsePositives = 0;
+
+	for (int i = 0; i < 500; i++)
+	{
+		snprintf(topic, sizeof(topic), "topic/%d", i);
+		CU_ASSERT(cbf->contains(std::string(topic)));
+	}
+
+	for (int i = 0; i < numProbes; i++)
+	{
+		snprintf(topic, sizeof(topic), "other/%d", i);
+		if (cbf->contains(std::string(topic)))
+		{
+			falsePositives++;
+		}
+	}
+
+	double measured = (double) falsePositives / numProbes;
+	double estimate = cbf->estimateFPP();
+	printf("\n  blocked FPP measured %f estimated %f\n", measured, estimate);
+	CU_ASSERT(measured > estimate / 2);
+	CU_ASSERT(measured < estimate * 2);
+
+	delete cbf;
+}
+
+}
+
+CU_TestInfo ISM_Cluster_CUnit_BlockedBF[] = {
+    { "BlockedHash",       blockedHashTest },
+    { "BlockedHashResize", blockedHashResizeTest },
+    { "BlockedFPP",        blockedFPPTest },
+    { "BlockedFPPMeasured", blockedFPPMeasuredTest },
+    CU_TEST_INFO_NULL
+};
+
+CU_SuiteInfo ISM_Cluster_CUnit_suites[] = {
+    { "BlockedBloomFilter", NULL, NULL, ISM_Cluster_CUnit_BlockedBF },
+    CU_SUITE_INFO_NULL
+};
+
+int main(int argc, char * * argv)
+{
+	int failures = 0;
+	setvbuf(stdout, NULL, _IONBF, 0);
+	if (CU_initialize_registry() == CUE_SUCCESS)
+	{
+		if (CU_register_suites(ISM_Cluster_CUnit_suites) == CUE_SUCCESS)
+		{
+			CU_basic_set_mode(CU_BRM_VERBOSE);
+			CU_basic_run_tests();
+			failures = CU_get_number_of_tests_failed();
+		}
+		CU_cleanup_registry();
+	}
+	return failures;
+}
@@ -0,0 +1,414 @@
+/*
+ * Copyright (c) 2015-2021 Contributors to the Eclipse Foundation
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+/*********************************************************************/
+/*                                                                   */
+/* Module Name: mccLookupSetTest.cpp                                 */
+/*                                                                   */
+/* Description: CUnit tests of the route cache in front of the       */
+/*              lookup set BF search (mcc_lus_lookup).               */
+/*                                                                   */
+/*  - a repeated lookup is served from the cache with the same result*/
+/*  - the engine matched servers are skipped on a cache hit          */
+/*  - every routing change invalidates the cache                     */
+/*  - long topics and large results are not cached                   */
+/*                                                                   */
+/*********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+
+#include <ismutil.h>
+#include "hashFunction.h"
+#include "mccLookupSet.h"
+#include "RemoteServerInfo.h"
+#include "CountingBloomFilter.h"
+#include "SubscriptionPattern.h"
+
+using namespace mcp;
+
+namespace
+{
+
+const int NUM_SERVERS = 6;
+const int MANY_SERVERS = 20;    /* More than a cache entry holds */
+const int MAX_DESTS = 32;
+
+/*
+ * A remote server with an exact and a wildcard counting BF, sized so that
+ * the tests see no false positives
+ */
+struct TestServer
+{
+    struct ismCluster_RemoteServer_t handle;
+    CountingBloomFilter            * exactCBF;
+    CountingBloomFilter            * wildCBF;
+    uint64_t                         nextId;
+};
+
+ismEngine_RemoteServerHandle_t engineHandle(int index)
+{
+    return (ismEngine_RemoteServerHandle_t)(uintptr_t)(index + 1);
+}
+
+void initServer(TestServer & server, int index)
+{
+    memset(&server.handle, 0, sizeof(server.handle));
+    server.handle.index = index;
+    server.handle.engineHandle = engineHandle(index);
+    server.exactCBF = new CountingBloomFilter(8192, 7, ISM_HASH_TYPE_MURMUR_x64_128_CH);
+    server.wildCBF = new CountingBloomFilter(8192, 7, ISM_HASH_TYPE_MURMUR_x64_128_CH);
+    server.nextId = 0;
+}
+
+void freeServer(TestServer & server)
+{
+    delete server.exactCBF;
+    delete server.wildCBF;
+}
+
+int loadFilter(mcc_lus_LUSetHandle_t lus, TestServer & server, int fIsWildcard)
+{
+    CountingBloomFilter * cbf = fIsWildcard ? server.wildCBF : server.exactCBF;
+    BloomFilter_SPtr bf = cbf->produceBloomFilter();
+    return mcc_lus_addBF(lus, &server.handle, bf->buffer(), bf->getNumBits() >> 3,
+            bf->getHashType(), bf->getNumHashes(), fIsWildcard);
+}
+
+int updateFilter(mcc_lus_LUSetHandle_t lus, TestServer & server, int fIsWildcard, std::vector<int32_t> updates)
+{
+    return mcc_lus_updateBF(lus, &server.handle, fIsWildcard, updates.data(), updates.size());
+}
+
+int addWildcard(mcc_lus_LUSetHandle_t lus, TestServer & server, const std::string & sub)
+{
+    SubscriptionPattern pattern;
+    if (pattern.parseSubscription(sub) != ISMRC_OK || !pattern.isWildcard())
+        return ISMRC_Error;
+    server.wildCBF->add(sub);
+
+    mcc_lus_Pattern_t pat;
+    pat.patternId   = ++server.nextId;
+    pat.numPluses   = pattern.getPlusLocations().size();
+    pat.pPlusLevels = pattern.getPlusLocations().data();
+    pat.hashLevel   = pattern.getHashLocation();
+    pat.patternLen  = pattern.getLastLevel();
+    return mcc_lus_addPattern(lus, &server.handle, &pat);
+}
+
+/*
+ * Look up a topic, with the servers in 'matched' already matched by the
+ * engine, and return the engine handles found sorted
+ */
+std::vector<uintptr_t> lookup(mcc_lus_LUSetHandle_t lus, const std::string & topic,
+        std::vector<TestServer *> matched = std::vector<TestServer *>(), int destsLen = MAX_DESTS, int * pRC = NULL)
+{
+    ismEngine_RemoteServerHandle_t dests[MAX_DESTS];
+    ismCluster_RemoteServerHandle_t matchedServers[MAX_DESTS];
+    ismCluster_LookupInfo_t info;
+    std::vector<uintptr_t> result;
+
+    memset(&info, 0, sizeof(info));
+    info.pTopic = (char *)topic.data();
+    info.topicLen = topic.size();
+    info.phDests = dests;
+    info.destsLen = destsLen;
+    info.phMatchedServers = matchedServers;
+    for (size_t i = 0; i < matched.size(); i++)
+    {
+        dests[i] = matched[i]->handle.engineHandle;
+        matchedServers[i] = &matched[i]->handle;
+    }
+    info.numDests = matched.size();
+
+    int rc = mcc_lus_lookup(lus, &info);
+    if (pRC)
+        *pRC = rc;
+    else
+        CU_ASSERT(rc == ISMRC_OK);
+    for (int i = 0; i < info.numDests; i++)
+    {
+        result.push_back((uintptr_t)dests[i]);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::vector<uintptr_t> handles(std::vector<int> indexes)
+{
+    std::vector<uintptr_t> result;
+    for (size_t i = 0; i < indexes.size(); i++)
+    {
+        result.push_back((uintptr_t)engineHandle(indexes[i]));
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+/*
+ * Check the cache counters moved by the given amounts since the last check
+ */
+bool checkStats(mcc_lus_LUSetHandle_t lus, uint64_t & hits, uint64_t & misses, int newHits, int newMisses)
+{
+    uint64_t h = 0, m = 0;
+    CU_ASSERT(mcc_lus_getRouteCacheStats(lus, &h, &m) == ISMRC_OK);
+    bool good = (h == hits + newHits) && (m == misses + newMisses);
+    if (!good)
+    {
+        printf("\n  hits=%llu expected=%llu misses=%llu expected=%llu\n", (unsigned long long)h,
+                (unsigned long long)(hits + newHits), (unsigned long long)m, (unsigned long long)(misses + newMisses));
+    }
+    hits = h;
+    misses = m;
+    return good;
+}
+
+/*
+ * Servers:
+ *  0: exact a/b a/c
+ *  1: exact a/b
+ *  2: wildcard a/+
+ *  3: wildcard x/#
+ *  4: exact x/y
+ *  5: none, used for route all
+ */
+void setupServers(mcc_lus_LUSetHandle_t lus, TestServer * servers)
+{
+    for (int i = 0; i < NUM_SERVERS; i++)
+    {
+        initServer(servers[i], i);
+    }
+    servers[0].exactCBF->add("a/b");
+    servers[0].exactCBF->add("a/c");
+    servers[1].exactCBF->add("a/b");
+    servers[4].exactCBF->add("x/y");
+    for (int i = 0; i < NUM_SERVERS; i++)
+    {
+        CU_ASSERT(loadFilter(lus, servers[i], 0) == ISMRC_OK);
+        CU_ASSERT(loadFilter(lus, servers[i], 1) == ISMRC_OK);
+    }
+    CU_ASSERT(addWildcard(lus, servers[2], "a/+") == ISMRC_OK);
+    CU_ASSERT(addWildcard(lus, servers[3], "x/#") == ISMRC_OK);
+    CU_ASSERT(loadFilter(lus, servers[2], 1) == ISMRC_OK);
+    CU_ASSERT(loadFilter(lus, servers[3], 1) == ISMRC_OK);
+}
+
+void routeCacheHitTest(void)
+{
+    mcc_lus_LUSetHandle_t lus = NULL;
+    TestServer servers[NUM_SERVERS];
+    uint64_t hits = 0, misses = 0;
+    int rc;
+
+    CU_ASSERT_FATAL(mcc_lus_createLUSet(&lus) == ISMRC_OK);
+    setupServers(lus, servers);
+    CU_ASSERT(checkStats(lus, hits, misses, 0, 0));
+
+    /* The first lookup searches the BFs and the second is served from the cache */
+    CU_ASSERT(lookup(lus, "a/b") == handles({0, 1, 2}));
+    CU_ASSERT(checkStats(lus, hits, misses, 0, 1));
+    CU_ASSERT(lookup(lus, "a/b") == handles({0, 1, 2}));
+    CU_ASSERT(checkStats(lus, hits, misses, 1, 0));
+
+    CU_ASSERT(lookup(lus, "a/c") == handles({0, 2}));
+    CU_ASSERT(lookup(lus, "x/y/z") == handles({3}));
+    CU_ASSERT(lookup(lus, "b") == handles({}));
+    CU_ASSERT(checkStats(lus, hits, misses, 0, 3));
+    CU_ASSERT(lookup(lus, "a/c") == handles({0, 2}));
+    CU_ASSERT(lookup(lus, "x/y/z") == handles({3}));
+    CU_ASSERT(lookup(lus, "b") == handles({}));
+    CU_ASSERT(checkStats(lus, hits, misses, 3, 0));
+
+    /* A hit does not return the servers already matched by the engine */
+    CU_ASSERT(lookup(lus, "a/b", {&servers[1]}) == handles({0, 1, 2}));
+    CU_ASSERT(lookup(lus, "a/b", {&servers[0], &servers[2]}) == handles({0, 1, 2}));
+    CU_ASSERT(lookup(lus, "a/b", {&servers[4]}) == handles({0, 1, 2, 4}));
+    CU_ASSERT(checkStats(lus, hits, misses, 3, 0));
+
+    /* A lookup with engine matches does not replace the full result in the cache */
+    CU_ASSERT(lookup(lus, "a/c", {&servers[0]}) == handles({0, 2}));
+    CU_ASSERT(lookup(lus, "a/c") == handles({0, 2}));
+    CU_ASSERT(checkStats(lus, hits, misses, 2, 0));
+
+    /* A hit which does not fit in the array asks for a larger one */
+    std::vector<uintptr_t> small = lookup(lus, "a/b", std::vector<TestServer *>(), 2, &rc);
+    CU_ASSERT(rc == ISMRC_ClusterArrayTooSmall);
+    CU_ASSERT(small.empty());
+    CU_ASSERT(checkStats(lus, hits, misses, 1, 0));
+
+    CU_ASSERT(mcc_lus_deleteLUSet(&lus) == ISMRC_OK);
+    for (int i = 0; i < NUM_SERVERS; i++)
+    {
+        freeServer(servers[i]);
+    }
+}
+
+void routeCacheInvalidateTest(void)
+{
+    mcc_lus_LUSetHandle_t lus = NULL;
+    TestServer servers[NUM_SERVERS];
+    uint64_t hits = 0, misses = 0;
+
+    CU_ASSERT_FATAL(mcc_lus_createLUSet(&lus) == ISMRC_OK);
+    setupServers(lus, servers);
+
+    CU_ASSERT(lookup(lus, "a/b") == handles({0, 1, 2}));
+    CU_ASSERT(lookup(lus, "a/b") == handles({0, 1, 2}));
+    CU_ASSERT(checkStats(lus, hits, misses, 1, 1));
+
+    /* BF update */
+    CU_ASSERT(updateFilter(lus, servers[1], 0, servers[1].exactCBF->remove("a/b")) == ISMRC_OK);
+    CU_ASSERT(lookup(lus, "a/b") == handles({0, 2}));
+    CU_ASSERT(lookup(lus, "a/b") == handles({0, 2}));
+    CU_ASSERT(checkStats(lus, hits, misses, 1, 1));
+
+    /* BF add */
+    servers[5].exactCBF->add("a/b");
+    CU_ASSERT(loadFilter(lus, servers[5], 0) == ISMRC_OK);
+    CU_ASSERT(lookup(lus, "a/b") == handles({0, 2, 5}));
+    CU_ASSERT(checkStats(lus, hits, misses, 0, 1));
+
+    /* BF delete */
+    CU_ASSERT(mcc_lus_deleteBF(lus, &servers[5].handle, 0) == ISMRC_OK);
+    CU_ASSERT(lookup(lus, "a/b") == handles({0, 2}));
+    CU_ASSERT(checkStats(lus, hits, misses, 0, 1));
+
+    /* Pattern add, the BF is updated afterwards as the pattern arrives first */
+    CU_ASSERT(lookup(lus, "a/b") == handles({0, 2}));
+    CU_ASSERT(checkStats(lus, hits, misses, 1, 0));
+    CU_ASSERT(addWildcard(lus, servers[4], "+/b") == ISMRC_OK);
+    CU_ASSERT(lookup(lus, "a/b") == handles({0, 2}));
+    CU_ASSERT(checkStats(lus, hits, misses, 0, 1));
+    CU_ASSERT(loadFilter(lus, servers[4], 1) == ISMRC_OK);
+    CU_ASSERT(lookup(lus, "a/b") == handles({0, 2, 4}));
+    CU_ASSERT(checkStats(lus, hits, misses, 0, 1));
+
+    /* Pattern delete */
+    CU_ASSERT(mcc_lus_deletePattern(lus, &servers[4].handle, servers[4].nextId) == ISMRC_OK);
+    CU_ASSERT(lookup(lus, "a/b") == handles({0, 2}));
+    CU_ASSERT(checkStats(lus, hits, misses, 0, 1));
+
+    /* Route all, the route all servers are added on a hit too */
+    CU_ASSERT(mcc_lus_setRouteAll(lus, &servers[5].handle, 1) == ISMRC_OK);
+    CU_ASSERT(lookup(lus, "a/b") == handles({0, 2, 5}));
+    CU_ASSERT(lookup(lus, "a/b") == handles({0, 2, 5}));
+    CU_ASSERT(lookup(lus, "b") == handles({5}));
+    CU_ASSERT(checkStats(lus, hits, misses, 1, 2));
+    CU_ASSERT(mcc_lus_setRouteAll(lus, &servers[5].handle, 0) == ISMRC_OK);
+    CU_ASSERT(lookup(lus, "b") == handles({}));
+    CU_ASSERT(checkStats(lus, hits, misses, 0, 1));
+
+    /* Server delete */
+    CU_ASSERT(lookup(lus, "a/c") == handles({0, 2}));
+    CU_ASSERT(mcc_lus_deleteServer(lus, &servers[0].handle) == ISMRC_OK);
+    CU_ASSERT(lookup(lus, "a/c") == handles({2}));
+    CU_ASSERT(lookup(lus, "a/c") == handles({2}));
+    CU_ASSERT(checkStats(lus, hits, misses, 1, 2));
+
+    CU_ASSERT(mcc_lus_deleteLUSet(&lus) == ISMRC_OK);
+    for (int i = 0; i < NUM_SERVERS; i++)
+    {
+        freeServer(servers[i]);
+    }
+}
+
+void routeCacheLimitsTest(void)
+{
+    mcc_lus_LUSetHandle_t lus = NULL;
+    TestServer servers[MANY_SERVERS];
+    uint64_t hits = 0, misses = 0;
+    std::vector<int> all;
+    std::string longTopic;
+
+    CU_ASSERT_FATAL(mcc_lus_createLUSet(&lus) == ISMRC_OK);
+    for (int i = 0; i < 20; i++)
+    {
+        longTopic += "level/";
+    }
+    longTopic += "end";
+    CU_ASSERT(longTopic.size() > 120);
+
+    for (int i = 0; i < MANY_SERVERS; i++)
+    {
+        initServer(servers[i], i);
+        servers[i].exactCBF->add("all");
+        if (i < 2)
+            servers[i].exactCBF->add(longTopic);
+        CU_ASSERT(loadFilter(lus, servers[i], 0) == ISMRC_OK);
+        all.push_back(i);
+    }
+
+    /* A result with more servers than an entry holds is not cached */
+    CU_ASSERT(lookup(lus, "all") == handles(all));
+    CU_ASSERT(lookup(lus, "all") == handles(all));
+    CU_ASSERT(checkStats(lus, hits, misses, 0, 2));
+
+    /* A long topic is not cached and does not count as a miss */
+    CU_ASSERT(lookup(lus, longTopic) == handles({0, 1}));
+    CU_ASSERT(lookup(lus, longTopic) == handles({0, 1}));
+    CU_ASSERT(checkStats(lus, hits, misses, 0, 0));
+
+    /* Once fewer servers match it is cached */
+    for (int i = 2; i < MANY_SERVERS; i++)
+    {
+        CU_ASSERT(updateFilter(lus, servers[i], 0, servers[i].exactCBF->remove("all")) == ISMRC_OK);
+    }
+    CU_ASSERT(lookup(lus, "all") == handles({0, 1}));
+    CU_ASSERT(lookup(lus, "all") == handles({0, 1}));
+    CU_ASSERT(checkStats(lus, hits, misses, 1, 1));
+
+    CU_ASSERT(mcc_lus_deleteLUSet(&lus) == ISMRC_OK);
+    for (int i = 0; i < MANY_SERVERS; i++)
+    {
+        freeServer(servers[i]);
+    }
+}
+
+}
+
+CU_TestInfo ISM_Cluster_CUnit_RouteCache[] = {
+    { "RouteCacheHit",        routeCacheHitTest },
+    { "RouteCacheInvalidate", routeCacheInvalidateTest },
+    { "RouteCacheLimits",     routeCacheLimitsTest },
+    CU_TEST_INFO_NULL
+};
+
+CU_SuiteInfo ISM_Cluster_CUnit_suites[] = {
+    { "RouteCache", NULL, NULL, ISM_Cluster_CUnit_RouteCache },
+    CU_SUITE_INFO_NULL
+};
+
+int main(int argc, char * * argv)
+{
+    int failures = 0;
+    setvbuf(stdout, NULL, _IONBF, 0);
+    if (CU_initialize_registry() == CUE_SUCCESS)
+    {
+        if (CU_register_suites(ISM_Cluster_CUnit_suites) == CUE_SUCCESS)
+        {
+            CU_basic_set_mode(CU_BRM_VERBOSE);
+            CU_basic_run_tests();
+            failures = CU_get_number_of_tests_failed();
+        }
+        CU_cleanup_registry();
+    }
+    return failures;
+}
@@ -0,0 +1,550 @@
+/*
+ * Copyright (c) 2015-2021 Contributors to the Eclipse Foundation
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+/*********************************************************************/
+/*                                                                   */
+/* Module Name: mccRoutingBench.cpp                                  */
+/*                                                                   */
+/* Description: Standalone benchmark of the cluster routing data     */
+/*              structures.                                          */
+/*                                                                   */
+/* A synthetic subscription set is generated for a number of remote  */
+/* servers. Each server gets an exact and a wildcard counting Bloom  */
+/* filter, built the same way the local subscription managers build */
+/* them, and the derived Bloom filters and wildcard patterns are     */
+/* loaded into a lookup set just as the global subscription manager  */
+/* does when they arrive from the remote servers.                    */
+/*                                                                   */
+/* The benchmark then measures:                                      */
+/*  - lookup latency of mcc_lus_lookup for random topics             */
+/*  - update throughput (counting filter add/remove plus             */
+/*    mcc_lus_updateBF / mcc_lus_addPattern)                         */
+/*  - memory footprint of the filters                                */
+/*  - false positive rate against an exact ground truth              */
+/*                                                                   */
+/* Results are written to stdout as a single JSON object so that     */
+/* runs can be compared across builds.                               */
+/*                                                                   */
+/* Usage:                                                            */
+/*   mccRoutingBench [-s servers] [-n subsPerServer]                 */
+/*                   [-k exact|plus|hash|mixed] [-l lookups]         */
+/*                   [-t topicPool] [-d levels] [-v valuesPerLevel]  */
+/*                   [-u updates] [-f fpp] [-h hashType] [-r seed]   */
+/*                                                                   */
+/*********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <ismutil.h>
+#include "hashFunction.h"
+#include "mccLookupSet.h"
+#include "RemoteServerInfo.h"
+#include "CountingBloomFilter.h"
+#include "SubscriptionPattern.h"
+
+using namespace mcp;
+
+namespace
+{
+
+enum SubKind
+{
+    KIND_EXACT = 0,
+    KIND_PLUS  = 1,
+    KIND_HASH  = 2,
+    KIND_MIXED = 3
+};
+
+const char * const kindNames[] = { "exact", "plus", "hash", "mixed" };
+
+struct BenchConfig
+{
+    int      numServers;
+    int      subsPerServer;
+    int      kind;
+    int      numLookups;
+    int      topicPool;
+    int      levels;
+    int      valuesPerLevel;
+    int      numUpdates;
+    double   fpp;
+    int      hashType;
+    uint32_t seed;
+};
+
+/*
+ * A remote server as seen by the benchmark: the cluster handle that
+ * the lookup set keys on, the local filters that would live on that
+ * server, and the subscriptions that are used as ground truth.
+ */
+struct BenchServer
+{
+    struct ismCluster_RemoteServer_t   handle;
+    CountingBloomFilter              * exactCBF;
+    CountingBloomFilter              * wildCBF;
+    std::set<std::string>              exactSubs;
+    std::vector<std::string>           wildSubs;
+    std::map<std::string, uint64_t>    patterns;
+};
+
+/* Small xorshift generator so that runs are reproducible across libc versions */
+uint32_t rndState = 1;
+
+inline uint32_t rnd(void)
+{
+    uint32_t x = rndState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return (rndState = x);
+}
+
+inline uint64_t nowNanos(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+std::string makeTopic(const BenchConfig & cfg)
+{
+    std::string topic;
+    char level[32];
+    for (int i = 0; i < cfg.levels; i++)
+    {
+        snprintf(level, sizeof(level), "%sL%dV%u", (i ? "/" : ""), i, rnd() % cfg.valuesPerLevel);
+        topic += level;
+    }
+    return topic;
+}
+
+/*
+ * Build a subscription of the requested kind. A '+' subscription
+ * replaces one or two levels of a topic, a '#' subscription keeps a
+ * prefix of one to levels-1 levels.
+ */
+std::string makeSubscription(const BenchConfig & cfg, int kind)
+{
+    if (kind == KIND_MIXED)
+        kind = rnd() % 3;
+
+    std::string topic = makeTopic(cfg);
+    if (kind == KIND_EXACT || cfg.levels < 2)
+        return topic;
+
+    std::vector<std::string> levels;
+    size_t start = 0, pos;
+    while ((pos = topic.find('/', start)) != std::string::npos)
+    {
+        levels.push_back(topic.substr(start, pos - start));
+        start = pos + 1;
+    }
+    levels.push_back(topic.substr(start));
+
+    std::string sub;
+    if (kind == KIND_PLUS)
+    {
+        int p1 = rnd() % levels.size();
+        int p2 = (rnd() & 1) ? (int)(rnd() % levels.size()) : p1;
+        levels[p1] = "+";
+        levels[p2] = "+";
+        for (size_t i = 0; i < levels.size(); i++)
+        {
+            if (i)
+                sub += '/';
+            sub += levels[i];
+        }
+    }
+    else
+    {
+        int keep = 1 + rnd() % (levels.size() - 1);
+        for (int i = 0; i < keep; i++)
+        {
+            sub += levels[i];
+            sub += '/';
+        }
+        sub += '#';
+    }
+    return sub;
+}
+
+/* MQTT topic filter match, used only for the ground truth */
+bool topicMatches(const char * sub, const char * topic)
+{
+    for (;;)
+    {
+        if (*sub == '#')
+            return true;
+        if (*sub == '+')
+        {
+            sub++;
+            while (*topic && *topic != '/')
+                topic++;
+        }
+        else
+        {
+            while (*sub && *sub != '/')
+            {
+                if (*sub++ != *topic++)
+                    return false;
+            }
+            if (*topic && *topic != '/')
+                return false;
+        }
+        if (!*sub)
+            return !*topic;
+        if (!*topic)
+            return sub[0] == '/' && sub[1] == '#' && !sub[2];
+        sub++;
+        topic++;
+    }
+}
+
+bool serverMatches(const BenchServer & server, const std::string & topic)
+{
+    if (server.exactSubs.count(topic))
+        return true;
+    for (size_t i = 0; i < server.wildSubs.size(); i++)
+    {
+        if (topicMatches(server.wildSubs[i].c_str(), topic.c_str()))
+            return true;
+    }
+    return false;
+}
+
+int addPattern(mcc_lus_LUSetHandle_t lus, BenchServer & server, const std::string & sub, uint64_t & nextId)
+{
+    SubscriptionPattern pattern;
+    if (pattern.parseSubscription(sub) != ISMRC_OK || !pattern.isWildcard())
+        return ISMRC_Error;
+
+    std::string key = pattern.toString();
+    if (server.patterns.count(key))
+        return ISMRC_OK;
+    server.patterns[key] = ++nextId;
+
+    mcc_lus_Pattern_t pat;
+    pat.patternId   = nextId;
+    pat.numPluses   = pattern.getPlusLocations().size();
+    pat.pPlusLevels = pattern.getPlusLocations().data();
+    pat.hashLevel   = pattern.getHashLocation();
+    pat.patternLen  = pattern.getLastLevel();
+    return mcc_lus_addPattern(lus, &server.handle, &pat);
+}
+
+int applyUpdates(mcc_lus_LUSetHandle_t lus, BenchServer & server, int fIsWildcard, std::vector<int32_t> & updates)
+{
+    if (updates.empty())
+        return ISMRC_OK;
+    return mcc_lus_updateBF(lus, &server.handle, fIsWildcard, updates.data(), updates.size());
+}
+
+CountingBloomFilter * createCBF(const BenchConfig & cfg, int projected)
+{
+    std::pair<uint64_t, uint8_t> params =
+            CountingBloomFilter::computeOptimalParameters(std::max(projected, 64), cfg.fpp);
+    return new CountingBloomFilter(params.first, params.second, (mcc_hash_HashType_t)cfg.hashType);
+}
+
+int loadFilter(mcc_lus_LUSetHandle_t lus, BenchServer & server, CountingBloomFilter * cbf, int fIsWildcard, size_t & bytes)
+{
+    BloomFilter_SPtr bf = cbf->produceBloomFilter();
+    size_t len = bf->getNumBits() >> 3;
+    bytes += len;
+    return mcc_lus_addBF(lus, &server.handle, bf->buffer(), len, bf->getHashType(), bf->getNumHashes(), fIsWildcard);
+}
+
+int compareU64(const void * a, const void * b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+void usage(void)
+{
+    fprintf(stderr, "Usage: mccRoutingBench [-s servers] [-n subsPerServer] [-k exact|plus|hash|mixed]\n"
+                    "                       [-l lookups] [-t topicPool] [-d levels] [-v valuesPerLevel]\n"
+                    "                       [-u updates] [-f fpp] [-h hashType] [-r seed]\n");
+}
+
+} /* namespace */
+
+int main(int argc, char ** argv)
+{
+    BenchConfig cfg;
+    cfg.numServers     = 16;
+    cfg.subsPerServer  = 10000;
+    cfg.kind           = KIND_MIXED;
+    cfg.numLookups     = 200000;
+    cfg.topicPool      = 50000;
+    cfg.levels         = 4;
+    cfg.valuesPerLevel = 32;
+    cfg.numUpdates     = 20000;
+    cfg.fpp            = 0.01;
+    cfg.hashType       = ISM_HASH_TYPE_MURMUR_x64_128_BLK;
+    cfg.seed           = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:n:k:l:t:d:v:u:f:h:r:")) != -1)
+    {
+        switch (opt)
+        {
+        case 's': cfg.numServers     = atoi(optarg); break;
+        case 'n': cfg.subsPerServer  = atoi(optarg); break;
+        case 'l': cfg.numLookups     = atoi(optarg); break;
+        case 't': cfg.topicPool      = atoi(optarg); break;
+        case 'd': cfg.levels         = atoi(optarg); break;
+        case 'v': cfg.valuesPerLevel = atoi(optarg); break;
+        case 'u': cfg.numUpdates     = atoi(optarg); break;
+        case 'f': cfg.fpp            = atof(optarg); break;
+        case 'h': cfg.hashType       = atoi(optarg); break;
+        case 'r': cfg.seed           = strtoul(optarg, NULL, 0); break;
+        case 'k':
+            for (cfg.kind = KIND_EXACT; cfg.kind <= KIND_MIXED; cfg.kind++)
+            {
+                if (!strcmp(optarg, kindNames[cfg.kind]))
+                    break;
+            }
+            if (cfg.kind > KIND_MIXED)
+            {
+                usage();
+                return 1;
+            }
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+    if (cfg.numServers < 1 || cfg.numServers > 65535 || cfg.subsPerServer < 1 || cfg.numLookups < 1 ||
+        cfg.topicPool < 1 || cfg.levels < 1 || cfg.valuesPerLevel < 1 || cfg.numUpdates < 0 ||
+        cfg.fpp <= 0.0 || cfg.fpp >= 1.0 || cfg.hashType <= ISM_HASH_TYPE_NONE ||
+        cfg.hashType > ISM_HASH_TYPE_MURMUR_x64_128_BLK)
+    {
+        usage();
+        return 1;
+    }
+    rndState = cfg.seed ? cfg.seed : 1;
+
+    ism_common_initUtil();
+
+    mcc_lus_LUSetHandle_t lus = NULL;
+    int rc = mcc_lus_createLUSet(&lus);
+    if (rc != ISMRC_OK)
+    {
+        fprintf(stderr, "mcc_lus_createLUSet failed: rc=%d\n", rc);
+        return 1;
+    }
+
+    /*
+     * Build phase: generate the subscriptions, fill the counting filters
+     * and load the resulting Bloom filters and patterns into the LUSet.
+     */
+    std::vector<BenchServer> servers(cfg.numServers);
+    uint64_t nextPatternId = 0;
+    size_t bfBytes = 0, cbfBytes = 0;
+    size_t numExact = 0, numWild = 0;
+    uint64_t t0 = nowNanos();
+    for (int s = 0; s < cfg.numServers && rc == ISMRC_OK; s++)
+    {
+        BenchServer & server = servers[s];
+        memset(&server.handle, 0, sizeof(server.handle));
+        server.handle.index = s;
+        server.handle.engineHandle = (ismEngine_RemoteServerHandle_t)(uintptr_t)(s + 1);
+
+        std::vector<std::string> subs;
+        subs.reserve(cfg.subsPerServer);
+        int nWild = 0;
+        for (int i = 0; i < cfg.subsPerServer; i++)
+        {
+            subs.push_back(makeSubscription(cfg, cfg.kind));
+            if (subs.back().find_first_of("+#") != std::string::npos)
+                nWild++;
+        }
+        server.exactCBF = createCBF(cfg, cfg.subsPerServer - nWild);
+        server.wildCBF  = createCBF(cfg, nWild);
+
+        for (size_t i = 0; i < subs.size() && rc == ISMRC_OK; i++)
+        {
+            if (subs[i].find_first_of("+#") == std::string::npos)
+            {
+                server.exactCBF->add(subs[i]);
+                server.exactSubs.insert(subs[i]);
+            }
+            else
+            {
+                server.wildCBF->add(subs[i]);
+                server.wildSubs.push_back(subs[i]);
+                rc = addPattern(lus, server, subs[i], nextPatternId);
+            }
+        }
+        numExact += server.exactSubs.size();
+        numWild  += server.wildSubs.size();
+        cbfBytes += (server.exactCBF->getNumCounters() + server.wildCBF->getNumCounters()) / 2;
+        if (rc == ISMRC_OK)
+            rc = loadFilter(lus, server, server.exactCBF, 0, bfBytes);
+        if (rc == ISMRC_OK)
+            rc = loadFilter(lus, server, server.wildCBF, 1, bfBytes);
+    }
+    uint64_t buildNanos = nowNanos() - t0;
+    if (rc != ISMRC_OK)
+    {
+        fprintf(stderr, "Failed to build the lookup set: rc=%d\n", rc);
+        return 1;
+    }
+
+    /*
+     * Lookup phase. Topics come from a fixed pool so that the route
+     * cache sees a realistic amount of reuse. Ground truth is computed
+     * once per pool entry.
+     */
+    std::vector<std::string> pool(cfg.topicPool);
+    std::vector<std::vector<uint8_t> > truth(cfg.topicPool);
+    for (int i = 0; i < cfg.topicPool; i++)
+    {
+        pool[i] = makeTopic(cfg);
+        truth[i].resize(cfg.numServers);
+        for (int s = 0; s < cfg.numServers; s++)
+            truth[i][s] = serverMatches(servers[s], pool[i]);
+    }
+
+    std::vector<ismEngine_RemoteServerHandle_t> dests(cfg.numServers);
+    std::vector<ismCluster_RemoteServerHandle_t> matched(cfg.numServers);
+    uint64_t * lat = (uint64_t *)malloc(cfg.numLookups * sizeof(uint64_t));
+    uint64_t truePos = 0, falsePos = 0, falseNeg = 0, trueNeg = 0, totalDests = 0;
+    for (int i = 0; i < cfg.numLookups && rc == ISMRC_OK; i++)
+    {
+        int p = rnd() % cfg.topicPool;
+        ismCluster_LookupInfo_t info;
+        memset(&info, 0, sizeof(info));
+        info.pTopic = (char *)pool[p].c_str();
+        info.topicLen = pool[p].size();
+        info.phDests = dests.data();
+        info.destsLen = cfg.numServers;
+        info.numDests = 0;
+        info.phMatchedServers = matched.data();
+
+        uint64_t start = nowNanos();
+        rc = mcc_lus_lookup(lus, &info);
+        lat[i] = nowNanos() - start;
+
+        std::vector<uint8_t> hit(cfg.numServers, 0);
+        for (int d = 0; d < info.numDests; d++)
+            hit[(uintptr_t)dests[d] - 1] = 1;
+        for (int s = 0; s < cfg.numServers; s++)
+        {
+            if (hit[s])
+                truth[p][s] ? truePos++ : falsePos++;
+            else
+                truth[p][s] ? falseNeg++ : trueNeg++;
+        }
+        totalDests += info.numDests;
+    }
+    if (rc != ISMRC_OK)
+    {
+        fprintf(stderr, "mcc_lus_lookup failed: rc=%d\n", rc);
+        return 1;
+    }
+    uint64_t lookupNanos = 0;
+    for (int i = 0; i < cfg.numLookups; i++)
+        lookupNanos += lat[i];
+    qsort(lat, cfg.numLookups, sizeof(uint64_t), compareU64);
+    uint64_t cacheHits = 0, cacheMisses = 0;
+    mcc_lus_getRouteCacheStats(lus, &cacheHits, &cacheMisses);
+
+    /*
+     * Update phase: subscribe and then unsubscribe new filters on random
+     * servers, pushing each change to the LUSet as bin updates the way
+     * the remote subscription path does.
+     */
+    std::vector<std::pair<int, std::string> > added;
+    added.reserve(cfg.numUpdates);
+    for (int i = 0; i < cfg.numUpdates; i++)
+        added.push_back(std::make_pair((int)(rnd() % cfg.numServers), makeSubscription(cfg, cfg.kind)));
+
+    uint64_t binUpdates = 0;
+    t0 = nowNanos();
+    for (int pass = 0; pass < 2 && rc == ISMRC_OK; pass++)
+    {
+        for (size_t i = 0; i < added.size() && rc == ISMRC_OK; i++)
+        {
+            BenchServer & server = servers[added[i].first];
+            const std::string & sub = added[i].second;
+            int fIsWildcard = (sub.find_first_of("+#") != std::string::npos);
+            CountingBloomFilter * cbf = fIsWildcard ? server.wildCBF : server.exactCBF;
+            std::vector<int32_t> updates = pass ? cbf->remove(sub) : cbf->add(sub);
+            if (fIsWildcard && !pass)
+                rc = addPattern(lus, server, sub, nextPatternId);
+            if (rc == ISMRC_OK)
+                rc = applyUpdates(lus, server, fIsWildcard, updates);
+            binUpdates += updates.size();
+        }
+    }
+    uint64_t updateNanos = nowNanos() - t0;
+    if (rc != ISMRC_OK)
+    {
+        fprintf(stderr, "Update phase failed: rc=%d\n", rc);
+        return 1;
+    }
+    int numOps = 2 * cfg.numUpdates;
+
+    size_t numPatterns = 0;
+    for (int s = 0; s < cfg.numServers; s++)
+        numPatterns += servers[s].patterns.size();
+
+    printf("{\n");
+    printf("  \"Config\": { \"Servers\": %d, \"SubsPerServer\": %d, \"Kind\": \"%s\", \"Levels\": %d, "
+           "\"ValuesPerLevel\": %d, \"TopicPool\": %d, \"Lookups\": %d, \"Updates\": %d, "
+           "\"FPP\": %g, \"HashType\": %d, \"Seed\": %u },\n",
+           cfg.numServers, cfg.subsPerServer, kindNames[cfg.kind], cfg.levels, cfg.valuesPerLevel,
+           cfg.topicPool, cfg.numLookups, cfg.numUpdates, cfg.fpp, cfg.hashType, cfg.seed);
+    printf("  \"Build\": { \"ExactSubs\": %lu, \"WildcardSubs\": %lu, \"Patterns\": %lu, \"TimeMs\": %.3f },\n",
+           (unsigned long)numExact, (unsigned long)numWild, (unsigned long)numPatterns, buildNanos / 1e6);
+    printf("  \"Memory\": { \"BloomFilterBytes\": %lu, \"CountingFilterBytes\": %lu, \"BytesPerSub\": %.2f },\n",
+           (unsigned long)bfBytes, (unsigned long)cbfBytes,
+           (double)bfBytes / (numExact + numWild ? numExact + numWild : 1));
+    printf("  \"Lookup\": { \"AvgNs\": %.1f, \"P50Ns\": %lu, \"P90Ns\": %lu, \"P99Ns\": %lu, \"MaxNs\": %lu, "
+           "\"OpsPerSec\": %.0f, \"AvgDests\": %.3f, \"CacheHits\": %lu, \"CacheMisses\": %lu },\n",
+           (double)lookupNanos / cfg.numLookups,
+           (unsigned long)lat[cfg.numLookups / 2], (unsigned long)lat[(cfg.numLookups * 9) / 10],
+           (unsigned long)lat[(cfg.numLookups * 99) / 100], (unsigned long)lat[cfg.numLookups - 1],
+           lookupNanos ? cfg.numLookups * 1e9 / lookupNanos : 0.0,
+           (double)totalDests / cfg.numLookups, (unsigned long)cacheHits, (unsigned long)cacheMisses);
+    printf("  \"Accuracy\": { \"TruePositives\": %lu, \"FalsePositives\": %lu, \"FalseNegatives\": %lu, "
+           "\"FalsePositiveRate\": %.6f },\n",
+           (unsigned long)truePos, (unsigned long)falsePos, (unsigned long)falseNeg,
+           (falsePos + trueNeg) ? (double)falsePos / (falsePos + trueNeg) : 0.0);
+    printf("  \"Update\": { \"Ops\": %d, \"BinUpdates\": %lu, \"AvgNs\": %.1f, \"OpsPerSec\": %.0f }\n",
+           numOps, (unsigned long)binUpdates, numOps ? (double)updateNanos / numOps : 0.0,
+           updateNanos ? numOps * 1e9 / updateNanos : 0.0);
+    printf("}\n");
+
+    free(lat);
+    for (int s = 0; s < cfg.numServers; s++)
+    {
+        delete servers[s].exactCBF;
+        delete servers[s].wildCBF;
+    }
+    mcc_lus_deleteLUSet(&lus);
+    return falseNeg ? 2 : 0;
+}
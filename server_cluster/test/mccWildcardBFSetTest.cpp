@@ -0,0 +1,428 @@
+/*
+ * Copyright (c) 2015-2021 Contributors to the Eclipse Foundation
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+/*********************************************************************/
+/*                                                                   */
+/* Module Name: mccWildcardBFSetTest.cpp                             */
+/*                                                                   */
+/* Description: CUnit tests of the wildcard BF set lookup            */
+/*              (mcc_wcbfs_lookup).                                  */
+/*                                                                   */
+/*  - random servers, patterns and topics are looked up and the      */
+/*    result compared with an exhaustive check of every pattern of   */
+/*    every server, and with the per server lookup it replaced       */
+/*                                                                   */
+/*********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+
+#include <ismutil.h>
+#include "hashFunction.h"
+#include "mccWildcardBFSet.h"
+#include "RemoteServerInfo.h"
+#include "CountingBloomFilter.h"
+#include "SubscriptionPattern.h"
+
+using namespace mcp;
+
+namespace
+{
+
+const int NUM_SERVERS  = 80;    /* More than one word of the shape users bitmaps */
+const int MAX_SUBS     = 12;
+const int MAX_LEVELS   = 5;
+const int NUM_VALUES   = 3;
+const int NUM_LOOKUPS  = 3000;
+
+const uint8_t mask1[8] = {0x01,0x02,0x04,0x08,0x10,0x20,0x40,0x80};
+
+struct TestPattern
+{
+    uint64_t              id;
+    std::vector<uint16_t> plusLevels;
+    uint16_t              hashLevel;
+    uint16_t              patternLen;
+};
+
+/*
+ * A remote server as seen by the test: its BF and its patterns, newest
+ * first as in the lookup set.
+ */
+struct TestServer
+{
+    struct ismCluster_RemoteServer_t handle;
+    BloomFilter_SPtr                 bf;
+    mcc_hash_getAllValues_t          getHashValues;
+    std::vector<TestPattern>         patterns;
+    bool                             added;
+};
+
+/* Small xorshift generator so that runs are reproducible across libc versions */
+uint32_t rndState = 1;
+
+inline uint32_t rnd(void)
+{
+    uint32_t x = rndState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return (rndState = x);
+}
+
+std::string makeTopic(void)
+{
+    std::string topic;
+    int levels = 1 + rnd() % (MAX_LEVELS + 1);
+    for (int i = 0; i < levels; i++)
+    {
+        if (i)
+            topic += '/';
+        topic += (char)('a' + rnd() % NUM_VALUES);
+    }
+    return topic;
+}
+
+/*
+ * A subscription of one to MAX_LEVELS levels, each a value or '+', which
+ * may end with '#'
+ */
+std::string makeSubscription(void)
+{
+    std::string sub;
+    int levels = 1 + rnd() % MAX_LEVELS;
+    for (int i = 0; i < levels; i++)
+    {
+        if (i)
+            sub += '/';
+        if (i == levels - 1 && (rnd() % 3) == 0)
+            sub += '#';
+        else if ((rnd() % 3) == 0)
+            sub += '+';
+        else
+            sub += (char)('a' + rnd() % NUM_VALUES);
+    }
+    return sub;
+}
+
+mcc_hash_getAllValues_t getHashFunction(mcc_hash_HashType_t hashType)
+{
+    switch (hashType)
+    {
+    case ISM_HASH_TYPE_MURMUR_x64_128_CH:
+        return mcc_hash_getAllValues_murmur3_x64_128;
+    case ISM_HASH_TYPE_MURMUR_x64_128_BLK:
+        return mcc_hash_getAllValues_murmur3_x64_128_BLK;
+    default:
+        return mcc_hash_getAllValues_city64_simple;
+    }
+}
+
+/*
+ * The lookup of a single server as done before the pattern shapes were
+ * shared across servers. With fEarlyExit the patterns are skipped as they
+ * were then, when the topic was seen to have more levels than the pattern,
+ * which missed '#' patterns. Without it every pattern is checked.
+ */
+bool serverLookup(const TestServer & server, const std::string & topic, bool fEarlyExit)
+{
+    const char * pTopic = topic.data();
+    int topicLen = topic.size();
+    size_t numPos = server.bf->getNumBits();
+    int nh = server.bf->getNumHashes();
+    int nl = 0;
+
+    for (size_t i = 0; i < server.patterns.size(); i++)
+    {
+        const TestPattern & pat = server.patterns[i];
+        int numPluses = pat.plusLevels.size();
+        char t[2 * topicLen + 2];
+        const char * p, * u2;
+        char * q;
+        uint32_t hashes[nh];
+        int j, l, m;
+
+        if (fEarlyExit)
+        {
+            if (nl > pat.hashLevel && pat.hashLevel) continue;
+            if (nl > pat.patternLen && !pat.hashLevel) continue;
+        }
+        j = 0;
+        l = 1;
+        m = 0;
+        p = pTopic;
+        u2 = p + topicLen;
+        q = t;
+        while (p < u2)
+        {
+            if (j < numPluses && l == pat.plusLevels[j])
+            {
+                j++;
+                *q++ = '+';
+                do
+                {
+                    if (*p++ == '/')
+                    {
+                        l++;
+                        *q++ = '/';
+                        break;
+                    }
+                } while (p < u2);
+            }
+            else if (l == pat.hashLevel)
+            {
+                *q++ = '#';
+                break;
+            }
+            else if (l > pat.patternLen)
+            {
+                m++;
+                break;
+            }
+            else
+            {
+                do
+                {
+                    if ((*q++ = *p++) == '/')
+                    {
+                        l++;
+                        break;
+                    }
+                } while (p < u2);
+            }
+        }
+        if (nl < l)
+            nl = l;
+        if (m || j < numPluses || l < pat.hashLevel)
+            continue;
+        server.getHashValues(t, q - t, nh, numPos, hashes);
+        for (m = 0; m < nh; m++)
+        {
+            if (!(server.bf->buffer()[hashes[m] >> 3] & mask1[hashes[m] & 7]))
+                break;
+        }
+        if (m >= nh)
+            return true;
+    }
+    return false;
+}
+
+int addServer(mcc_wcbfs_WCBFSetHandle_t wcbfs, TestServer & server, int index, uint64_t & nextId)
+{
+    std::map<std::string, bool> shapes;
+    std::vector<std::string> subs;
+    int numSubs = 1 + rnd() % MAX_SUBS;
+
+    memset(&server.handle, 0, sizeof(server.handle));
+    server.handle.index = index;
+    server.added = true;
+
+    /* Small filters, so that false positives are compared too */
+    mcc_hash_HashType_t hashType = (index & 1) ? ISM_HASH_TYPE_MURMUR_x64_128_BLK : ISM_HASH_TYPE_MURMUR_x64_128_CH;
+    CountingBloomFilter cbf((index % 3) ? 1024 : 128, 3 + index % 3, hashType);
+
+    while ((int)subs.size() < numSubs)
+    {
+        std::string sub = makeSubscription();
+        SubscriptionPattern pattern;
+        if (pattern.parseSubscription(sub) != ISMRC_OK || !pattern.isWildcard())
+            continue;
+        subs.push_back(sub);
+        cbf.add(sub);
+        if (shapes.count(pattern.toString()))
+            continue;
+        shapes[pattern.toString()] = true;
+
+        TestPattern pat;
+        pat.id = ++nextId;
+        pat.plusLevels = pattern.getPlusLocations();
+        pat.hashLevel = pattern.getHashLocation();
+        pat.patternLen = pattern.getLastLevel();
+        server.patterns.insert(server.patterns.begin(), pat);
+    }
+
+    server.bf = cbf.produceBloomFilter();
+    server.getHashValues = getHashFunction(hashType);
+
+    mcc_hash_t hashParams;
+    hashParams.numHashValues = server.bf->getNumHashes();
+    hashParams.hashType = hashType;
+    int rc = mcc_wcbfs_addBF(wcbfs, index, &hashParams, server.bf->buffer(), server.bf->getNumBits() >> 3, &server.handle);
+    for (int i = server.patterns.size() - 1; i >= 0 && rc == ISMRC_OK; i--)
+    {
+        TestPattern & pat = server.patterns[i];
+        mcc_lus_Pattern_t lusPat;
+        lusPat.patternId = pat.id;
+        lusPat.numPluses = pat.plusLevels.size();
+        lusPat.pPlusLevels = pat.plusLevels.data();
+        lusPat.hashLevel = pat.hashLevel;
+        lusPat.patternLen = pat.patternLen;
+        rc = mcc_wcbfs_addPattern(wcbfs, index, &lusPat);
+    }
+    return rc;
+}
+
+/*
+ * Look up random topics, with some servers skipped, and compare the result
+ * with the exhaustive and the old per server lookup. Returns the number of
+ * servers found.
+ */
+int compareLookups(mcc_wcbfs_WCBFSetHandle_t wcbfs, std::vector<TestServer> & servers, int * pOldMissed)
+{
+    mcc_wcbfs_BFLookupHandle_t results[NUM_SERVERS];
+    uint8_t skip[(NUM_SERVERS + 7) / 8];
+    int found = 0;
+
+    for (int l = 0; l < NUM_LOOKUPS; l++)
+    {
+        std::string topic = makeTopic();
+        int numResults = -1;
+        bool inResults[NUM_SERVERS] = {false};
+
+        memset(skip, 0, sizeof(skip));
+        for (int i = 0; i < NUM_SERVERS; i++)
+        {
+            if ((rnd() % 10) == 0)
+                skip[i >> 3] |= mask1[i & 7];
+        }
+
+        int rc = mcc_wcbfs_lookup(wcbfs, (char *)topic.data(), topic.size(), skip, results, NUM_SERVERS, &numResults);
+        CU_ASSERT(rc == ISMRC_OK);
+        for (int r = 0; r < numResults; r++)
+        {
+            int index = results[r]->index;
+            CU_ASSERT(index >= 0 && index < NUM_SERVERS);
+            CU_ASSERT(!inResults[index]);
+            inResults[index] = true;
+        }
+        found += numResults;
+
+        for (int i = 0; i < NUM_SERVERS; i++)
+        {
+            bool skipped = (skip[i >> 3] & mask1[i & 7]) != 0;
+            bool expected = servers[i].added && !skipped && serverLookup(servers[i], topic, false);
+            bool old = servers[i].added && !skipped && serverLookup(servers[i], topic, true);
+            if (inResults[i] != expected)
+            {
+                printf("\n  topic=%s server=%d found=%d expected=%d\n", topic.c_str(), i, inResults[i], expected);
+            }
+            CU_ASSERT(inResults[i] == expected);
+
+            /* The old lookup could miss a server but never found one that is not */
+            CU_ASSERT(!old || inResults[i]);
+            if (inResults[i] && !old)
+                (*pOldMissed)++;
+        }
+    }
+    return found;
+}
+
+void wildcardLookupTest(void)
+{
+    mcc_wcbfs_WCBFSetHandle_t wcbfs = NULL;
+    std::vector<TestServer> servers(NUM_SERVERS);
+    uint64_t nextId = 0;
+    int oldMissed = 0;
+    int found;
+
+    rndState = 1;
+    CU_ASSERT_FATAL(mcc_wcbfs_createWCBFSet(&wcbfs) == ISMRC_OK);
+    for (int i = 0; i < NUM_SERVERS; i++)
+    {
+        CU_ASSERT(addServer(wcbfs, servers[i], i, nextId) == ISMRC_OK);
+    }
+
+    found = compareLookups(wcbfs, servers, &oldMissed);
+    printf("\n  found %d old missed %d\n", found, oldMissed);
+    CU_ASSERT(found > 0);
+
+    /* Remove some patterns and servers, the shapes they used are dropped or kept */
+    for (int i = 0; i < NUM_SERVERS; i++)
+    {
+        TestServer & server = servers[i];
+        if ((rnd() % 4) == 0)
+        {
+            CU_ASSERT(mcc_wcbfs_deleteBF(wcbfs, i) == ISMRC_OK);
+            server.added = false;
+            continue;
+        }
+        for (size_t p = 0; p < server.patterns.size(); )
+        {
+            if ((rnd() % 3) == 0)
+            {
+                CU_ASSERT(mcc_wcbfs_deletePattern(wcbfs, i, server.patterns[p].id) == ISMRC_OK);
+                server.patterns.erase(server.patterns.begin() + p);
+            }
+            else
+            {
+                p++;
+            }
+        }
+    }
+
+    found = compareLookups(wcbfs, servers, &oldMissed);
+    CU_ASSERT(found > 0);
+
+    /* Add the removed servers back with new patterns */
+    for (int i = 0; i < NUM_SERVERS; i++)
+    {
+        if (!servers[i].added)
+        {
+            servers[i].patterns.clear();
+            CU_ASSERT(addServer(wcbfs, servers[i], i, nextId) == ISMRC_OK);
+        }
+    }
+
+    found = compareLookups(wcbfs, servers, &oldMissed);
+    CU_ASSERT(found > 0);
+
+    CU_ASSERT(mcc_wcbfs_deleteWCBFSet(wcbfs) == ISMRC_OK);
+}
+
+}
+
+CU_TestInfo ISM_Cluster_CUnit_WildcardBFSet[] = {
+    { "WildcardLookup", wildcardLookupTest },
+    CU_TEST_INFO_NULL
+};
+
+CU_SuiteInfo ISM_Cluster_CUnit_suites[] = {
+    { "WildcardBFSet", NULL, NULL, ISM_Cluster_CUnit_WildcardBFSet },
+    CU_SUITE_INFO_NULL
+};
+
+int main(int argc, char * * argv)
+{
+    int failures = 0;
+    setvbuf(stdout, NULL, _IONBF, 0);
+    if (CU_initialize_registry() == CUE_SUCCESS)
+    {
+        if (CU_register_suites(ISM_Cluster_CUnit_suites) == CUE_SUCCESS)
+        {
+            CU_basic_set_mode(CU_BRM_VERBOSE);
+            CU_basic_run_tests();
+            failures = CU_get_number_of_tests_failed();
+        }
+        CU_cleanup_registry();
+    }
+    return failures;
+}
@@ -0,0 +1,554 @@
+/*
+ * Copyright (c) 2015-2021 Contributors to the Eclipse Foundation
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+/*********************************************************************/
+/*                                                                   */
+/* Module Name: mccWireFormatTest.cpp                                */
+/*                                                                   */
+/* Description: CUnit tests of the compact Bloom filter wire format  */
+/*              (COMPACT_BF_VERSION) used between cluster members.   */
+/*                                                                   */
+/*  - run-length encoded BF bases                                    */
+/*  - sparse delta encoded BF updates and the legacy update format   */
+/*  - compacting and merging of BF bin updates                       */
+/*  - republishing the BF base when the compact encoding is dropped  */
+/*                                                                   */
+/*********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <limits>
+#include <map>
+#include <vector>
+
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+
+#include <ismutil.h>
+#include "SubCoveringFilterWireFormat.h"
+#include "SubCoveringFilterPublisherImpl.h"
+#include "LocalExactSubManager.h"
+#include "FilterTags.h"
+#include "MembershipService.h"
+
+using namespace mcp;
+
+namespace
+{
+
+//Must match RLE_MIN_ZERO_RUN in SubCoveringFilterWireFormat.cpp
+const std::size_t RLE_MIN_ZERO_RUN = 3;
+
+/*
+ * Encode the bits, and if they were encoded, check the encoding reads back
+ * the same bits and is consumed exactly. Returns the encoded length, or 0 if
+ * the raw bits should be sent.
+ */
+std::size_t rleRoundTrip(const std::vector<char>& bits)
+{
+	ByteBuffer_SPtr buffer = ByteBuffer::createByteBuffer(64);
+	buffer->writeInt(12345);
+	const std::size_t start = buffer->getPosition();
+
+	bool encoded = SubCoveringFilterWireFormat::writeBloomFilterBitsRLE(bits.empty() ? NULL : &bits[0], bits.size(), buffer);
+	if (!encoded)
+	{
+		//The buffer is left as it was so the raw bits can be written instead
+		CU_ASSERT(buffer->getPosition() == start);
+		return 0;
+	}
+	std::size_t len = buffer->getPosition() - start;
+	CU_ASSERT(len < bits.size() || bits.empty());
+
+	ByteBufferReadOnlyWrapper reader(buffer->getBuffer() + start, len);
+	std::vector<char> out;
+	CU_ASSERT(SubCoveringFilterWireFormat::readBloomFilterBitsRLE(reader, bits.size(), out) == ISMRC_OK);
+	CU_ASSERT(out == bits);
+	CU_ASSERT(reader.getPosition() == len);
+	return len;
+}
+
+/*
+ * Check the encoding of the bits is exactly the expected bytes
+ */
+void rleExpect(const std::vector<char>& bits, const char* expect, std::size_t expectLen)
+{
+	ByteBuffer_SPtr buffer = ByteBuffer::createByteBuffer(64);
+	CU_ASSERT(SubCoveringFilterWireFormat::writeBloomFilterBitsRLE(&bits[0], bits.size(), buffer));
+	CU_ASSERT(buffer->getPosition() == expectLen);
+	CU_ASSERT(buffer->getPosition() == expectLen && !memcmp(buffer->getBuffer(), expect, expectLen));
+	CU_ASSERT(rleRoundTrip(bits) == expectLen);
+}
+
+/*
+ * Read an RLE encoding and return the rc
+ */
+int rleRead(const char* encoded, std::size_t len, std::size_t numBytes)
+{
+	ByteBufferReadOnlyWrapper reader(encoded, len);
+	std::vector<char> out;
+	return SubCoveringFilterWireFormat::readBloomFilterBitsRLE(reader, numBytes, out);
+}
+
+/*
+ * Write updates in the sparse format and read them back
+ */
+int sparseRoundTrip(uint64_t baseSqn, const std::vector<int32_t>& compacted, std::vector<int32_t>& out, uint64_t& outSqn)
+{
+	ByteBuffer_SPtr buffer = ByteBuffer::createByteBuffer(64);
+	SubCoveringFilterWireFormat::writeBloomFilterUpdateSparse(baseSqn, compacted, buffer);
+	std::size_t len = buffer->getPosition();
+
+	ByteBufferReadOnlyWrapper reader(buffer->getBuffer(), len);
+	int rc = SubCoveringFilterWireFormat::readBloomFilterUpdate(reader, outSqn, out);
+	if (rc == ISMRC_OK)
+	{
+		CU_ASSERT(reader.getPosition() == len);
+	}
+	return rc;
+}
+
+/*
+ * Apply bin updates (1-indexing, positive = set, negative = clear) to a BF
+ */
+void applyUpdates(const std::vector<int32_t>& updates, std::vector<char>& bf)
+{
+	for (std::size_t i = 0; i < updates.size(); ++i)
+	{
+		bf[abs(updates[i]) - 1] = updates[i] > 0 ? 1 : 0;
+	}
+}
+
+}
+
+/*
+ * Run-length encoded BF bases
+ */
+void rleTest(void)
+{
+	//Empty
+	std::vector<char> bits;
+	CU_ASSERT(rleRoundTrip(bits) == 0);
+	CU_ASSERT(rleRead("", 0, 0) == ISMRC_OK);
+
+	//All zero is one segment
+	bits.assign(4096, 0);
+	const char allZero[] = { (char)0x80, 0x20, 0x00 };
+	rleExpect(bits, allZero, sizeof allZero);
+
+	//All ones cannot be made smaller
+	bits.assign(4096, (char)0xff);
+	CU_ASSERT(rleRoundTrip(bits) == 0);
+
+	//A zero run one shorter than the threshold stays in the literal
+	bits.assign(104, 0);
+	bits[0] = 1;
+	bits[RLE_MIN_ZERO_RUN] = 1;
+	const char shortRun[] = { 0, 4, 1, 0, 0, 1, 100, 0 };
+	rleExpect(bits, shortRun, sizeof shortRun);
+
+	//A zero run exactly at the threshold ends the literal
+	bits.assign(105, 0);
+	bits[0] = 1;
+	bits[RLE_MIN_ZERO_RUN + 1] = 1;
+	const char thresholdRun[] = { 0, 1, 1, 3, 1, 1, 100, 0 };
+	rleExpect(bits, thresholdRun, sizeof thresholdRun);
+
+	//Short zero runs and a literal at the very end
+	bits.assign(200, 0);
+	bits[150] = 7;
+	bits[152] = 7;
+	bits[199] = 9;
+	CU_ASSERT(rleRoundTrip(bits) > 0);
+
+	//Sparse random BFs of many sizes
+	srand(1);
+	for (int n = 1; n < 600; n += 7)
+	{
+		bits.assign(n, 0);
+		for (int i = 0; i < n / 16; ++i)
+		{
+			bits[rand() % n] = (char)(1 << (rand() % 8));
+		}
+		std::size_t len = rleRoundTrip(bits);
+		CU_ASSERT(len > 0 || n < 8);
+	}
+
+	//A segment which runs past the end of the BF
+	const char tooLong[] = { 5, 1, 1 };
+	CU_ASSERT(rleRead(tooLong, sizeof tooLong, 5) == ISMRC_Error);
+	//An empty segment
+	const char empty[] = { 0, 0, 2, 0 };
+	CU_ASSERT(rleRead(empty, sizeof empty, 2) == ISMRC_Error);
+}
+
+/*
+ * Sparse and legacy BF updates
+ */
+void sparseUpdateTest(void)
+{
+	std::vector<int32_t> updates;
+	std::vector<int32_t> out;
+	uint64_t sqn = 0;
+
+	//Empty
+	CU_ASSERT(sparseRoundTrip(77, updates, out, sqn) == ISMRC_OK);
+	CU_ASSERT(sqn == 77);
+	CU_ASSERT(out.empty());
+
+	//Set and clear, including the first and the largest bin
+	updates.push_back(-1);
+	updates.push_back(2);
+	updates.push_back(-130);
+	updates.push_back(100000);
+	updates.push_back(std::numeric_limits<int32_t>::max());
+	CU_ASSERT(sparseRoundTrip(0x123456789ULL, updates, out, sqn) == ISMRC_OK);
+	CU_ASSERT(sqn == 0x123456789ULL);
+	CU_ASSERT(out == updates);
+
+	//The marker is written in place of the count
+	ByteBuffer_SPtr buffer = ByteBuffer::createByteBuffer(64);
+	SubCoveringFilterWireFormat::writeBloomFilterUpdateSparse(1, updates, buffer);
+	{
+		ByteBufferReadOnlyWrapper reader(buffer->getBuffer(), buffer->getPosition());
+		CU_ASSERT(reader.readInt() == std::numeric_limits<int32_t>::min());
+		CU_ASSERT(reader.readLong() == 1);
+		CU_ASSERT(reader.readInt() == (int32_t)updates.size());
+	}
+
+	//Bins out of order give a negative delta which must not wrap to a valid bin
+	updates.clear();
+	updates.push_back(5);
+	updates.push_back(-3);
+	CU_ASSERT(sparseRoundTrip(1, updates, out, sqn) == ISMRC_Error);
+
+	//Bin zero is not valid
+	buffer = ByteBuffer::createByteBuffer(64);
+	buffer->writeInt(SubCoveringFilterWireFormat::BF_UPDATE_SPARSE_MARKER);
+	buffer->writeLong(1);
+	buffer->writeInt(1);
+	buffer->writeChar(1);
+	{
+		ByteBufferReadOnlyWrapper reader(buffer->getBuffer(), buffer->getPosition());
+		CU_ASSERT(SubCoveringFilterWireFormat::readBloomFilterUpdate(reader, sqn, out) == ISMRC_Error);
+	}
+
+	//A negative count after the marker
+	buffer = ByteBuffer::createByteBuffer(64);
+	buffer->writeInt(SubCoveringFilterWireFormat::BF_UPDATE_SPARSE_MARKER);
+	buffer->writeLong(1);
+	buffer->writeInt(-1);
+	{
+		ByteBufferReadOnlyWrapper reader(buffer->getBuffer(), buffer->getPosition());
+		CU_ASSERT(SubCoveringFilterWireFormat::readBloomFilterUpdate(reader, sqn, out) == ISMRC_Error);
+	}
+
+	//The legacy format is a count and the updates, and carries no base
+	buffer = ByteBuffer::createByteBuffer(64);
+	buffer->writeInt(3);
+	buffer->writeInt(9);
+	buffer->writeInt(-4);
+	buffer->writeInt(9);
+	{
+		ByteBufferReadOnlyWrapper reader(buffer->getBuffer(), buffer->getPosition());
+		sqn = 5;
+		CU_ASSERT(SubCoveringFilterWireFormat::readBloomFilterUpdate(reader, sqn, out) == ISMRC_OK);
+		CU_ASSERT(sqn == 0);
+		CU_ASSERT(out.size() == 3 && out[0] == 9 && out[1] == -4 && out[2] == 9);
+		CU_ASSERT(reader.getPosition() == 16);
+	}
+
+	//A negative legacy count other than the marker
+	buffer = ByteBuffer::createByteBuffer(64);
+	buffer->writeInt(-2);
+	{
+		ByteBufferReadOnlyWrapper reader(buffer->getBuffer(), buffer->getPosition());
+		CU_ASSERT(SubCoveringFilterWireFormat::readBloomFilterUpdate(reader, sqn, out) == ISMRC_Error);
+	}
+}
+
+/*
+ * Compacting and merging of BF bin updates
+ */
+void compactMergeTest(void)
+{
+	std::vector<int32_t> updates;
+	std::vector<int32_t> compacted;
+	std::vector<int32_t> accumulated;
+
+	//Empty
+	SubCoveringFilterWireFormat::compactBloomFilterUpdates(updates, compacted);
+	CU_ASSERT(compacted.empty());
+	SubCoveringFilterWireFormat::mergeBloomFilterUpdates(compacted, accumulated);
+	CU_ASSERT(accumulated.empty());
+
+	//The last update of each bin, sorted by bin
+	int32_t u[] = { 3, -3, 5, 1, -5, 3 };
+	updates.assign(u, u + 6);
+	SubCoveringFilterWireFormat::compactBloomFilterUpdates(updates, compacted);
+	int32_t c[] = { 1, 3, -5 };
+	CU_ASSERT(compacted == std::vector<int32_t>(c, c + 3));
+
+	//Merge into empty accumulated updates
+	SubCoveringFilterWireFormat::mergeBloomFilterUpdates(compacted, accumulated);
+	CU_ASSERT(accumulated == compacted);
+
+	//The new updates win, and bins only in one side are kept
+	int32_t n[] = { -1, 4, 5 };
+	SubCoveringFilterWireFormat::mergeBloomFilterUpdates(std::vector<int32_t>(n, n + 3), accumulated);
+	int32_t m[] = { -1, 3, 4, 5 };
+	CU_ASSERT(accumulated == std::vector<int32_t>(m, m + 4));
+
+	//Merging nothing changes nothing
+	SubCoveringFilterWireFormat::mergeBloomFilterUpdates(std::vector<int32_t>(), accumulated);
+	CU_ASSERT(accumulated == std::vector<int32_t>(m, m + 4));
+
+	//Applying the compacted updates after any prefix gives the same BF as applying all of them,
+	//and so does applying the merged compacted updates of two halves
+	srand(2);
+	for (int loop = 0; loop < 50; ++loop)
+	{
+		const int bins = 40;
+		updates.clear();
+		int count = rand() % 200;
+		for (int i = 0; i < count; ++i)
+		{
+			int32_t bin = 1 + rand() % bins;
+			updates.push_back(rand() % 2 ? bin : -bin);
+		}
+		std::vector<char> expect(bins, 0);
+		applyUpdates(updates, expect);
+
+		SubCoveringFilterWireFormat::compactBloomFilterUpdates(updates, compacted);
+		for (std::size_t j = 1; j < compacted.size(); ++j)
+		{
+			CU_ASSERT(abs(compacted[j-1]) < abs(compacted[j]));
+		}
+		for (int prefix = 0; prefix <= count; prefix += 13)
+		{
+			std::vector<char> bf(bins, 0);
+			applyUpdates(std::vector<int32_t>(updates.begin(), updates.begin() + prefix), bf);
+			applyUpdates(compacted, bf);
+			CU_ASSERT(bf == expect);
+		}
+
+		std::vector<int32_t> first;
+		std::vector<int32_t> second;
+		SubCoveringFilterWireFormat::compactBloomFilterUpdates(std::vector<int32_t>(updates.begin(), updates.begin() + count / 2), first);
+		SubCoveringFilterWireFormat::compactBloomFilterUpdates(std::vector<int32_t>(updates.begin() + count / 2, updates.end()), second);
+		SubCoveringFilterWireFormat::mergeBloomFilterUpdates(second, first);
+		CU_ASSERT(first == compacted);
+
+		//And the compacted updates survive the sparse encoding
+		std::vector<int32_t> out;
+		uint64_t sqn = 0;
+		CU_ASSERT(sparseRoundTrip(loop + 1, compacted, out, sqn) == ISMRC_OK);
+		CU_ASSERT(out == compacted);
+	}
+}
+
+/*
+ * Keeps the attributes the filter publisher sets, as the view would see them.
+ */
+class TestMembershipService : public spdr::MembershipService
+{
+public:
+	std::map<std::string, std::string> attributes;
+
+	void close() {}
+	bool isClosed() { return false; }
+	bool setHighPriorityMonitor(bool value) { return false; }
+	bool isHighPriorityMonitor() { return false; }
+	bool setAttribute(const spdr::String& key, spdr::Const_Buffer value)
+	{
+		bool isNew = (attributes.count(key) == 0);
+		attributes[key] = std::string(value.second, value.first);
+		return isNew;
+	}
+	std::pair<spdr::event::AttributeValue,bool> getAttribute(const spdr::String& key)
+	{
+		std::map<std::string, std::string>::const_iterator it = attributes.find(key);
+		if (it == attributes.end())
+		{
+			return std::make_pair(spdr::event::AttributeValue(), false);
+		}
+		char* copy = new char[it->second.size()];
+		memcpy(copy, it->second.data(), it->second.size());
+		return std::make_pair(spdr::event::AttributeValue(static_cast<int32_t>(it->second.size()), copy), true);
+	}
+	bool removeAttribute(const spdr::String& key) { return attributes.erase(key) > 0; }
+	bool containsAttribute(const spdr::String& key) { return attributes.count(key) > 0; }
+	void clearAttributeMap() { attributes.clear(); }
+	bool isEmptyAttributeMap() { return attributes.empty(); }
+	size_t sizeOfAttributeMap() { return attributes.size(); }
+	spdr::StringSet getAttributeKeySet()
+	{
+		spdr::StringSet keys;
+		for (std::map<std::string, std::string>::const_iterator it = attributes.begin(); it != attributes.end(); ++it)
+		{
+			keys.insert(it->first);
+		}
+		return keys;
+	}
+	bool clearRemoteNodeRetainedAttributes(spdr::NodeID_SPtr target, int64_t incarnation) { return false; }
+	int64_t getForeignZoneMembership(const spdr::String& zoneBusName, bool includeAttributes)
+		throw(spdr::SpiderCastLogicError, spdr::SpiderCastRuntimeError) { return 0; }
+	int64_t getZoneCensus()
+		throw(spdr::SpiderCastLogicError, spdr::SpiderCastRuntimeError) { return 0; }
+};
+
+/*
+ * Publishing is driven by the test, so scheduling does nothing.
+ */
+class TestLocalSubManager : public LocalSubManager
+{
+public:
+	MCPReturnCode publishLocalBFTask() { return ISMRC_OK; }
+	MCPReturnCode publishRetainedTask() { return ISMRC_OK; }
+	MCPReturnCode publishMonitoringTask() { return ISMRC_OK; }
+	MCPReturnCode schedulePublishLocalBFTask(int delayMillis) { return ISMRC_OK; }
+	MCPReturnCode schedulePublishRetainedTask(int delayMillis) { return ISMRC_OK; }
+	MCPReturnCode schedulePublishMonitoringTask(int delayMillis) { return ISMRC_OK; }
+	MCPReturnCode restoreSubscriptionPatterns(const std::vector<SubscriptionPattern_SPtr>& patterns) { return ISMRC_OK; }
+	MCPReturnCode setBlockedBloomFilterSupport(bool supported) { return ISMRC_OK; }
+	MCPReturnCode setCompactBloomFilterEncoding(bool supported) { return ISMRC_OK; }
+	int update(ismCluster_RemoteServerHandle_t hClusterHandle, const char* pServerUID, const RemoteSubscriptionStats& stats) { return ISMRC_OK; }
+	int disconnected(ismCluster_RemoteServerHandle_t hClusterHandle, const char* pServerUID) { return ISMRC_OK; }
+	int connected(ismCluster_RemoteServerHandle_t hClusterHandle, const char* pServerUID) { return ISMRC_OK; }
+	int remove(ismCluster_RemoteServerHandle_t hClusterHandle, const char* pServerUID) { return ISMRC_OK; }
+};
+
+/*
+ * The bfType of the published exact BF base, or -1 if there is none.
+ */
+int16_t exactBaseType(TestMembershipService& memService)
+{
+	std::map<std::string, std::string>::const_iterator it = memService.attributes.find(FilterTags::BF_ExactSub_Base);
+	if (it == memService.attributes.end() || it->second.size() < 16)
+	{
+		return -1;
+	}
+	ByteBufferReadOnlyWrapper reader(it->second.data(), it->second.size());
+	reader.readLong(); //sqn
+	return reader.readShort();
+}
+
+/*
+ * Mirrors LocalSubManagerImpl::setCompactBloomFilterEncoding
+ */
+void setCompactEncoding(SubCoveringFilterPublisher_SPtr publisher, LocalExactSubManager& exact, bool supported)
+{
+	publisher->setCompactBloomFilterEncoding(supported);
+	exact.republishBloomFilterBase();
+}
+
+void compactFallbackTest(void)
+{
+	spdr::PropertyMap properties;
+	properties.setProperty(config::LocalServerUID_PROP_KEY, "WireFormatTestUID");
+	properties.setProperty(config::LocalServerName_PROP_KEY, "WireFormatTest");
+	properties.setProperty(config::ClusterName_PROP_KEY, "WireFormatTestCluster");
+	MCPConfig mcpConfig(properties);
+
+	TestMembershipService memService;
+	TestLocalSubManager localSubManager;
+	SubCoveringFilterPublisher_SPtr publisher(new SubCoveringFilterPublisherImpl("WireFormatTest", memService));
+	LocalExactSubManager exact("WireFormatTest", mcpConfig, localSubManager);
+
+	CU_ASSERT(exact.setSubCoveringFilterPublisher(publisher) == ISMRC_OK);
+	CU_ASSERT(exact.start() == ISMRC_OK);
+	CU_ASSERT(exact.recoveryCompleted() == ISMRC_OK);
+
+	//Every member reads the compact encoding: a mostly empty base is run-length encoded
+	setCompactEncoding(publisher, exact, true);
+	CU_ASSERT(exact.subscribe("wire/format/1") == ISMRC_OK);
+	CU_ASSERT(exact.publishLocalExactBF() == ISMRC_OK);
+	int16_t bfType = exactBaseType(memService);
+	CU_ASSERT(bfType != -1 && (bfType & SubCoveringFilterWireFormat::BF_BASE_RLE_FLAG) != 0);
+	std::size_t rleBaseSize = memService.attributes[FilterTags::BF_ExactSub_Base].size();
+
+	//...and so are the updates
+	CU_ASSERT(exact.subscribe("wire/format/2") == ISMRC_OK);
+	CU_ASSERT(exact.publishLocalExactBF() == ISMRC_OK);
+	const std::string update1 = FilterTags::BF_ExactSub_Update + "1";
+	CU_ASSERT(memService.attributes.count(update1) == 1);
+	if (memService.attributes.count(update1) == 1)
+	{
+		std::string& value = memService.attributes[update1];
+		ByteBufferReadOnlyWrapper reader(value.data(), value.size());
+		reader.readLong(); //sqn
+		CU_ASSERT(reader.readInt() == SubCoveringFilterWireFormat::BF_UPDATE_SPARSE_MARKER);
+	}
+
+	//A member that cannot read it joins: the base must be replaced in the old
+	//format and the sparse updates removed, with no new subscriptions
+	setCompactEncoding(publisher, exact, false);
+	CU_ASSERT(exact.publishLocalExactBF() == ISMRC_OK);
+	bfType = exactBaseType(memService);
+	CU_ASSERT(bfType != -1 && (bfType & SubCoveringFilterWireFormat::BF_BASE_RLE_FLAG) == 0);
+	CU_ASSERT(memService.attributes[FilterTags::BF_ExactSub_Base].size() > rleBaseSize);
+	CU_ASSERT(memService.attributes.count(update1) == 0);
+
+	//Later updates are in the old format again
+	CU_ASSERT(exact.subscribe("wire/format/3") == ISMRC_OK);
+	CU_ASSERT(exact.publishLocalExactBF() == ISMRC_OK);
+	CU_ASSERT(memService.attributes.count(update1) == 1);
+	if (memService.attributes.count(update1) == 1)
+	{
+		std::string& value = memService.attributes[update1];
+		ByteBufferReadOnlyWrapper reader(value.data(), value.size());
+		reader.readLong(); //sqn
+		CU_ASSERT(reader.readInt() != SubCoveringFilterWireFormat::BF_UPDATE_SPARSE_MARKER);
+	}
+
+	//Support comes back: the base is run-length encoded again
+	setCompactEncoding(publisher, exact, true);
+	CU_ASSERT(exact.publishLocalExactBF() == ISMRC_OK);
+	bfType = exactBaseType(memService);
+	CU_ASSERT(bfType != -1 && (bfType & SubCoveringFilterWireFormat::BF_BASE_RLE_FLAG) != 0);
+	CU_ASSERT(memService.attributes.count(update1) == 0);
+
+	CU_ASSERT(exact.close() == ISMRC_OK);
+}
+
+CU_TestInfo ISM_Cluster_CUnit_WireFormat[] = {
+    { "RLE",           rleTest },
+    { "SparseUpdate",  sparseUpdateTest },
+    { "CompactMerge",  compactMergeTest },
+    { "CompactFallback", compactFallbackTest },
+    CU_TEST_INFO_NULL
+};
+
+CU_SuiteInfo ISM_Cluster_CUnit_suites[] = {
+    { "WireFormat", NULL, NULL, ISM_Cluster_CUnit_WireFormat },
+    CU_SUITE_INFO_NULL
+};
+
+int main(int argc, char * * argv)
+{
+	int failures = 0;
+	setvbuf(stdout, NULL, _IONBF, 0);
+	if (CU_initialize_registry() == CUE_SUCCESS)
+	{
+		if (CU_register_suites(ISM_Cluster_CUnit_suites) == CUE_SUCCESS)
+		{
+			CU_basic_set_mode(CU_BRM_VERBOSE);
+			CU_basic_run_tests();
+			failures = CU_get_number_of_tests_failed();
+		}
+		CU_cleanup_registry();
+	}
+	return failures;
+}
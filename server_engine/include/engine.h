@@ -1044,6 +1044,64 @@ typedef bool (*ismEngine_MessageCallback_t)(
     ismEngine_DelivererContext_t *  delivererContext);
 
 
+/// Maximum number of messages passed to a single message-batch callback
+#define ismENGINE_MAX_MESSAGE_BATCH_SIZE 64
+
+//*********************************************************************
+/// @brief DeliveredMessage
+///
+/// Description of a single message within a batch passed to an
+/// ismEngine_MessageBatchCallback_t. The fields have the same meaning
+/// as the equivalent parameters of ismEngine_MessageCallback_t.
+//*********************************************************************
+typedef struct ismEngine_DeliveredMessage_t {
+    ismEngine_DeliveryHandle_t      hDelivery;      ///< Handle of the delivery to this consumer
+    ismEngine_MessageHandle_t       hMessage;       ///< Handle of the message
+    uint32_t                        deliveryId;     ///< Numeric identifier for confirming delivery
+    ismMessageState_t               state;          ///< State of the message
+    ismMessageHeader_t              msgHeader;      ///< Copy of the message header
+    uint8_t                         msgAreaCount;   ///< Number of message areas - may be 0
+    ismMessageAreaType_t *          areaTypes;      ///< Types of message areas
+    size_t *                        areaLengths;    ///< Array of area lengths
+    void **                         pAreaData;      ///< Pointers to area data
+} ismEngine_DeliveredMessage_t;
+
+//****************************************************************************
+/// @brief  Message-batch delivery callback
+///
+/// Callback used to deliver a batch of messages to a message consumer in a
+/// single call. The batch callback is used in place of the message-delivery
+/// callback for consumers whose message-delivery callback has a batch
+/// counterpart registered with ism_engine_registerMessageBatchCallback.
+///
+/// @param[in]     hConsumer        Handle of the consumer
+/// @param[in]     destinationOptions  Options used when creating the consumer.
+/// @param[in]     messageCount     Number of messages in the batch (> 0)
+/// @param[in]     pMessages        Array of messageCount message descriptions
+/// @param[in]     pConsumerContext Consumer context
+/// @param[in]     delivererContext Context from the deliverer that allows lock optimizations
+///
+/// @return As for ismEngine_MessageCallback_t, returning false stops further
+/// delivery to this consumer.
+///
+/// @remark All messages in the batch have been delivered to the consumer
+/// when the callback is called, the callback owns each hMessage and must
+/// process every message in the batch, even if it intends to return false.
+///
+/// The engine adapts the number of messages passed in each batch, growing it
+/// while the callback keeps accepting full batches and shrinking it when the
+/// callback reports backpressure by returning false or when the consumer's
+/// client is approaching its inflight message limit.
+//****************************************************************************
+typedef bool (*ismEngine_MessageBatchCallback_t)(
+    ismEngine_ConsumerHandle_t      hConsumer,
+    uint32_t                        destinationOptions,
+    uint32_t                        messageCount,
+    ismEngine_DeliveredMessage_t *  pMessages,
+    void *                          pConsumerContext,
+    ismEngine_DelivererContext_t *  delivererContext);
+
+
 //****************************************************************************
 /// @brief  Subscription callback
 ///
@@ -1385,6 +1443,24 @@ XAPI void ism_engine_registerRetainedForwardingCallback(
     ismEngine_RetainedForwardingCallback_t pRetainedForwardingFn);
 
 
+//****************************************************************************
+/// @brief  Register message-batch delivery callback
+///
+/// Consumers created with pMessageCallbackFn as their message-delivery
+/// callback will have messages delivered in batches to pBatchCallbackFn
+/// where the queue supports it. Other consumers (and browsers) continue to
+/// use their message-delivery callback.
+///
+/// @param[in]     pMessageCallbackFn  Message-delivery callback to replace
+/// @param[in]     pBatchCallbackFn    Message-batch delivery callback
+///
+/// @remark Only consumers created after this call are affected.
+//****************************************************************************
+XAPI void ism_engine_registerMessageBatchCallback(
+    ismEngine_MessageCallback_t      pMessageCallbackFn,
+    ismEngine_MessageBatchCallback_t pBatchCallbackFn);
+
+
 //****************************************************************************
 /// @brief  Create Client-State
 ///
@@ -58,7 +58,7 @@ typedef struct ismEngine_Message_t
     uint8_t                     Flags;                                ///< Engine Message flags
     uint8_t                     futureField1;                         ///< 1 byte available for future use
     uint8_t                     futureField2;                         ///< 1 byte available for future use
-    uint32_t                    futureField3;                         ///< 4 bytes available for future use
+    uint32_t                    putTimestamp;                         ///< Latency timestamp of message creation (0 if not recorded)
     ismMessageAreaType_t        AreaTypes[ismENGINE_MSG_AREAS_MAX];   ///< Types of message areas (see remarks)
     size_t                      AreaLengths[ismENGINE_MSG_AREAS_MAX]; ///< Lengths of message areas (see remarks)
     void                       *pAreaData[ismENGINE_MSG_AREAS_MAX];   ///< Ptrs to message areas (see remarks)
@@ -3309,7 +3309,7 @@ int32_t iecs_addClientState(ieutThreadData_t *pThreadData,
 
     ismEngine_AsyncData_t asyncData = {ismENGINE_ASYNCDATA_STRUCID,
                                        pClient,
-                                       IEAD_MAXARRAYENTRIES, 3, 0, true,  0, 0, asyncArray};
+                                       IEAD_MAXARRAYENTRIES, 3, 0, true,  0, 0, 0, asyncArray};
 
     // If this is a steal (either a Zombie takeover, or an Active steal) then we expect
     // the end of the steal process to call the engine caller, so we remove that entry
@@ -7759,6 +7759,17 @@ void iecs_getDeliveryStats( ieutThreadData_t *pThreadData
     return;
 }
 
+//Used to size delivery batches, so deliberately doesn't take the lock - the
+//values may be slightly stale but they only need to be a hint
+uint32_t iecs_getInflightHeadroom(iecsMessageDeliveryInfoHandle_t hMsgDelInfo)
+{
+    iecsMessageDeliveryInfo_t *pMsgDelInfo = hMsgDelInfo;
+    uint32_t inflight = pMsgDelInfo->NumDeliveryIds;
+    uint32_t inflightMax = pMsgDelInfo->MaxInflightMsgs;
+
+    return (inflight < inflightMax) ? (inflightMax - inflight) : 0;
+}
+
 //Some protocols (MQTT) need to have message delivery complete for a message once it is started
 //This function is called when the client has unsubbed so that the client can keep track of the queue
 //now that the topic tree will no longer do so
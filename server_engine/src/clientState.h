@@ -362,6 +362,10 @@ void iecs_getDeliveryStats( ieutThreadData_t *pThreadData
                            , uint32_t *pInflightMax
                            , uint32_t *pInflightReenable);
 
+//Approximate number of further messages that can be put inflight before
+//the limit is reached (read without locking, so only a hint)
+uint32_t iecs_getInflightHeadroom(iecsMessageDeliveryInfoHandle_t hMsgDelInfo);
+
 //For some protocol (of the ones we implement: MQTT) we need to complete
 //delivery of inflight messages even if they unsub. This call tells the
 //client this queue may need to be kept alive because of it and to keep a
@@ -167,6 +167,8 @@ int32_t ieds_publish(ieutThreadData_t *pThreadData,
     ismEngine_Message_t *pRetainMsg = NULL;
     ietrSavepoint_t *savepoint = NULL;
 
+    uint64_t publishStartNanos = ismEngine_serverGlobal.latencyHistogramsEnabled ? ieut_latencyTimeNanos() : 0;
+
     // Allow us to determine if this is a publish within a publish...
     pThreadData->publishDepth++;
 
@@ -671,6 +673,29 @@ int32_t ieds_publish(ieutThreadData_t *pThreadData,
                     delivererContext.lockStrategy.lock_persisted_counter = 0;
                     delivererContext.lockStrategy.lock_dropped_counter = 0;
 
+                    // Decode the message properties once for all of the selectors, and if there
+                    // are enough subscribers only look at those whose selector could match.
+                    if (subscriptionSelection == true)
+                    {
+                        uint32_t candidateCount;
+
+                        ism_common_startSelectCache(pMessage->AreaCount,
+                                                    pMessage->AreaTypes,
+                                                    pMessage->AreaLengths,
+                                                    pMessage->pAreaData);
+
+                        ismEngine_Subscription_t **candidates = iett_getSelectionCandidates(pThreadData,
+                                                                                            &sublist,
+                                                                                            pMessage,
+                                                                                            &candidateCount);
+
+                        if (candidates != NULL)
+                        {
+                            totalSkipped += subsCount - candidateCount;
+                            subscribers = (const ismEngine_Subscription_t **)candidates;
+                        }
+                    }
+
                     while ((pSubscription = *(subscribers++)) != NULL)
                     {
                         ismRule_t *selectionRule = NULL;
@@ -711,7 +736,9 @@ int32_t ieds_publish(ieutThreadData_t *pThreadData,
                                 continue;
                             }
 
-                            selectionRule = pSubscription->selectionRule;
+                            // Use the selection code compiled from the rule if there is any
+                            selectionRule = pSubscription->selectionCode ? pSubscription->selectionCode
+                                                                         : pSubscription->selectionRule;
                             selectionRuleLen = (size_t)pSubscription->selectionRuleLen;
                             cacheThisSelectionResult = false;
                         }
@@ -822,6 +849,8 @@ int32_t ieds_publish(ieutThreadData_t *pThreadData,
                     } 
 
                     delivererContext.lockStrategy.rlac = LS_NO_LOCK_HELD;
+
+                    if (subscriptionSelection == true) ism_common_endSelectCache();
                 }
 
                 subsSkipped = totalSkipped;
@@ -1183,6 +1212,11 @@ int32_t ieds_publish(ieutThreadData_t *pThreadData,
 
     pThreadData->publishDepth--;
 
+    if (publishStartNanos != 0)
+    {
+        ieut_recordLatency(pThreadData, ieutLATENCY_PUBLISH, ieut_latencyTimeNanos() - publishStartNanos);
+    }
+
     return rc;
 }
 
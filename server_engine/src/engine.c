@@ -418,6 +418,36 @@ XAPI int32_t WARN_CHECKRC ism_engine_start(void)
                    "Multiconsumer message batch size: %u\n", ismEngine_serverGlobal.multiConsumerBatchSize);
     }
 
+    //Find out whether consumers on shared subscriptions should claim runs of messages from the
+    //queue rather than one at a time (trading cross-consumer ordering for less get cursor contention)
+    ismEngine_serverGlobal.sharedSubDeliveryClaim = ism_common_getIntConfig(ismENGINE_CFGPROP_SHARED_SUB_DELIVERY_CLAIM
+                                                                           ,ismENGINE_DEFAULT_SHARED_SUB_DELIVERY_CLAIM);
+    if (ismEngine_serverGlobal.sharedSubDeliveryClaim != ismENGINE_DEFAULT_SHARED_SUB_DELIVERY_CLAIM)
+    {
+        ieutTRACEL(pThreadData, ismEngine_serverGlobal.sharedSubDeliveryClaim, ENGINE_INTERESTING_TRACE,
+                   "Shared subscription delivery claim size: %u\n", ismEngine_serverGlobal.sharedSubDeliveryClaim);
+    }
+
+    //Find out how many subscribers a topic needs before publish indexes the subscriptions by the
+    //property their selectors require to have a particular value
+    ismEngine_serverGlobal.selectionIndexMinimum = ism_common_getIntConfig(ismENGINE_CFGPROP_SELECTION_INDEX_MINIMUM
+                                                                          ,ismENGINE_DEFAULT_SELECTION_INDEX_MINIMUM);
+    if (ismEngine_serverGlobal.selectionIndexMinimum != ismENGINE_DEFAULT_SELECTION_INDEX_MINIMUM)
+    {
+        ieutTRACEL(pThreadData, ismEngine_serverGlobal.selectionIndexMinimum, ENGINE_INTERESTING_TRACE,
+                   "Selection index minimum subscribers: %u\n", ismEngine_serverGlobal.selectionIndexMinimum);
+    }
+
+    // Initialize whether latency histograms are recorded
+    ismEngine_serverGlobal.latencyHistogramsEnabled = ism_common_getBooleanConfig(ismENGINE_CFGPROP_LATENCY_HISTOGRAMS,
+                                                                                  ismENGINE_DEFAULT_LATENCY_HISTOGRAMS);
+
+    if (ismEngine_serverGlobal.latencyHistogramsEnabled != ismENGINE_DEFAULT_LATENCY_HISTOGRAMS)
+    {
+        ieutTRACEL(pThreadData, 0, ENGINE_INTERESTING_TRACE, "Latency histograms enabled: %d\n",
+                   (int)ismEngine_serverGlobal.latencyHistogramsEnabled);
+    }
+
     // Initialize whether automatic queue creation is disabled
     ismEngine_serverGlobal.disableAutoQueueCreation = ism_common_getBooleanConfig(ismENGINE_CFGPROP_DISABLE_AUTO_QUEUE_CREATION,
                                                                                   ismENGINE_DEFAULT_DISABLE_AUTO_QUEUE_CREATION);
@@ -1293,6 +1323,25 @@ XAPI void ism_engine_registerDeliveryFailureCallback(ismEngine_DeliveryFailureCa
 }
 
 
+//****************************************************************************
+/// @internal
+///
+/// @brief  Register message-batch delivery callback function
+///
+/// Registers the batch counterpart of a message-delivery callback
+//****************************************************************************
+XAPI void ism_engine_registerMessageBatchCallback(ismEngine_MessageCallback_t pMessageCallbackFn,
+                                                  ismEngine_MessageBatchCallback_t pBatchCallbackFn)
+{
+    TRACE(ENGINE_CEI_TRACE, FUNCTION_IDENT "Fn=%p BatchFn=%p\n", __func__, pMessageCallbackFn, pBatchCallbackFn);
+
+    ismEngine_serverGlobal.messageBatchReplacedFn = pMessageCallbackFn;
+    ismEngine_serverGlobal.messageBatchFn = pBatchCallbackFn;
+
+    return;
+}
+
+
 //****************************************************************************
 /// @brief  Create Client-State
 ///
@@ -1544,9 +1593,6 @@ static int32_t iecs_asyncDestroyClientStateCompletion(ieutThreadData_t *pThreadD
                     , pJobThread->jobQueue
                     , iecs_jobDestroyClientStateCompletion
                     , jobData
-#ifdef IEJQ_JOBQUEUE_PUTLOCK
-                    , true
-#endif
             );
 
             if (rc2 == OK)
@@ -1773,7 +1819,7 @@ XAPI int32_t WARN_CHECKRC ism_engine_destroyClientState(
 
             ismEngine_AsyncData_t asyncData = {ismENGINE_ASYNCDATA_STRUCID,
                                                pClient,
-                                               IEAD_MAXARRAYENTRIES, 2, 0, true,  0, 0, asyncArray};
+                                               IEAD_MAXARRAYENTRIES, 2, 0, true,  0, 0, 0, asyncArray};
 
             rc = iecs_updateLastConnectedTime(pThreadData, pClient, false, &asyncData);
         }
@@ -2967,7 +3013,7 @@ XAPI int32_t WARN_CHECKRC ism_engine_createLocalTransaction(
                             {ismENGINE_ASYNCDATAENTRY_STRUCID, EngineCaller,      pContext,   contextLength,     NULL, {.externalFn = pCallbackFn }}};
     ismEngine_AsyncData_t asyncData = {ismENGINE_ASYNCDATA_STRUCID,
                                        (pSession == NULL) ? NULL :pSession->pClient,
-                                       IEAD_MAXARRAYENTRIES, 1, 0, true,  0, 0, asyncArray};
+                                       IEAD_MAXARRAYENTRIES, 1, 0, true,  0, 0, 0, asyncArray};
 
     rc = ietr_createLocal(pThreadData, (ismEngine_Session_t *)hSession, true, false, &asyncData, &pTran);
 
@@ -3054,7 +3100,7 @@ XAPI int32_t WARN_CHECKRC ism_engine_createGlobalTransaction(
                             {ismENGINE_ASYNCDATAENTRY_STRUCID, EngineCaller,      pContext,   contextLength,     NULL, {.externalFn = pCallbackFn }}};
     ismEngine_AsyncData_t asyncData = {ismENGINE_ASYNCDATA_STRUCID,
                                       (pSession == NULL) ? NULL :pSession->pClient,
-                                       IEAD_MAXARRAYENTRIES, 1, 0, true,  0, 0, asyncArray};
+                                       IEAD_MAXARRAYENTRIES, 1, 0, true,  0, 0, 0, asyncArray};
 
     rc = ietr_createGlobal(pThreadData, (ismEngine_Session_t *)hSession, pXID, options, &asyncData, &pTran);
 
@@ -3194,7 +3240,7 @@ XAPI int32_t WARN_CHECKRC ism_engine_prepareTransaction(
     {
         ismEngine_AsyncDataEntry_t asyncArray[IEAD_MAXARRAYENTRIES] = {
                         {ismENGINE_ASYNCDATAENTRY_STRUCID, EngineCaller,      pContext,   contextLength,     NULL, {.externalFn = pCallbackFn }}};
-        ismEngine_AsyncData_t asyncData = {ismENGINE_ASYNCDATA_STRUCID, pSession->pClient, IEAD_MAXARRAYENTRIES, 1, 0, true,  0, 0, asyncArray};
+        ismEngine_AsyncData_t asyncData = {ismENGINE_ASYNCDATA_STRUCID, pSession->pClient, IEAD_MAXARRAYENTRIES, 1, 0, true,  0, 0, 0, asyncArray};
 
         rc = ietr_prepare(pThreadData, pTran, pSession, &asyncData);
     }
@@ -3278,7 +3324,7 @@ XAPI int32_t WARN_CHECKRC ism_engine_prepareGlobalTransaction(
             ismEngine_AsyncDataEntry_t asyncArray[IEAD_MAXARRAYENTRIES] = {
                 {ismENGINE_ASYNCDATAENTRY_STRUCID, EnginePrepareGlobal,   NULL, 0, pTran, {.internalFn = asyncPrepareGlobalTransaction } },
                 {ismENGINE_ASYNCDATAENTRY_STRUCID, EngineCaller,      pContext,   contextLength,     NULL, {.externalFn = pCallbackFn }}};
-            ismEngine_AsyncData_t asyncData = {ismENGINE_ASYNCDATA_STRUCID, pSession->pClient, IEAD_MAXARRAYENTRIES, 2, 0, true,  0, 0, asyncArray};
+            ismEngine_AsyncData_t asyncData = {ismENGINE_ASYNCDATA_STRUCID, pSession->pClient, IEAD_MAXARRAYENTRIES, 2, 0, true,  0, 0, 0, asyncArray};
 
             rc = ietr_prepare(pThreadData, pTran, pSession, &asyncData);
 
@@ -3939,7 +3985,7 @@ XAPI int32_t WARN_CHECKRC ism_engine_forgetGlobalTransaction(
         ismEngine_AsyncDataEntry_t asyncArray[IEAD_MAXARRAYENTRIES] = {
                 {ismENGINE_ASYNCDATAENTRY_STRUCID, EngineCaller,      pContext,   contextLength,     NULL, {.externalFn = pCallbackFn }},
                 {ismENGINE_ASYNCDATAENTRY_STRUCID, EngineTranForget,  NULL, 0, pTran, {.internalFn = asyncForgetGlobalTransaction } }};
-        ismEngine_AsyncData_t asyncData = {ismENGINE_ASYNCDATA_STRUCID, NULL, IEAD_MAXARRAYENTRIES, 2, 0, true,  0, 0, asyncArray};
+        ismEngine_AsyncData_t asyncData = {ismENGINE_ASYNCDATA_STRUCID, NULL, IEAD_MAXARRAYENTRIES, 2, 0, true,  0, 0, 0, asyncArray};
 
         rc = ietr_forget(pThreadData, pTran, &asyncData);
 
@@ -6072,7 +6118,7 @@ XAPI int32_t WARN_CHECKRC ism_engine_removeUnreleasedDeliveryId(
                 {ismENGINE_ASYNCDATAENTRY_STRUCID, EngineCaller, pContext,   contextLength, NULL,
                         {.externalFn = pCallbackFn }}};
 
-    ismEngine_AsyncData_t asyncInfo = {ismENGINE_ASYNCDATA_STRUCID, pClient, IEAD_MAXARRAYENTRIES, 2, 0, true,  0, 0, asyncArray};
+    ismEngine_AsyncData_t asyncInfo = {ismENGINE_ASYNCDATA_STRUCID, pClient, IEAD_MAXARRAYENTRIES, 2, 0, true,  0, 0, 0, asyncArray};
 
     rc = iecs_removeUnreleasedDelivery(pThreadData, pClient, pTran, unrelDeliveryId, &asyncInfo);
 
@@ -6361,6 +6407,15 @@ XAPI int32_t WARN_CHECKRC ism_engine_createConsumer(
                 pConsumer->pMsgCallbackContext = NULL;
             }
             pConsumer->pMsgCallbackFn = pMessageCallbackFn;
+            if ((pMessageCallbackFn == ismEngine_serverGlobal.messageBatchReplacedFn) && fDestructiveGet)
+            {
+                pConsumer->pMsgBatchCallbackFn = ismEngine_serverGlobal.messageBatchFn;
+            }
+            else
+            {
+                pConsumer->pMsgBatchCallbackFn = NULL;
+            }
+            pConsumer->msgBatchSize = 1;
             pConsumer->pPendingDestroyContext = NULL;
             pConsumer->pPendingDestroyCallbackFn = NULL;
             pConsumer->engineObject = NULL;
@@ -6867,6 +6922,8 @@ XAPI int32_t WARN_CHECKRC ism_engine_createRemoteServerConsumer(
                 pConsumer->pMsgCallbackContext = NULL;
             }
             pConsumer->pMsgCallbackFn = pMessageCallbackFn;
+            pConsumer->pMsgBatchCallbackFn = NULL;
+            pConsumer->msgBatchSize = 1;
             pConsumer->pPendingDestroyContext = NULL;
             pConsumer->pPendingDestroyCallbackFn = NULL;
             pConsumer->engineObject = NULL;
@@ -7781,6 +7838,7 @@ XAPI int32_t WARN_CHECKRC ism_engine_createMessage(
         pMessage->AreaCount = areaCount;
         pMessage->Flags = ismENGINE_MSGFLAGS_NONE;
         pMessage->MsgLength = MsgLength;
+        pMessage->putTimestamp = ieut_latencyTimestamp();
         pMessage->resourceSet = iereNO_RESOURCE_SET;
         pMessage->fullMemSize = (int64_t)iere_full_size(iemem_messageBody, pMessage);
         for (i = 0; i < areaCount; i++)
@@ -7883,7 +7941,7 @@ XAPI int32_t WARN_CHECKRC ism_engine_confirmMessageDelivery(
     ismEngine_AsyncDataEntry_t asyncArray[IEAD_MAXARRAYENTRIES] = {
             {ismENGINE_ASYNCDATAENTRY_STRUCID, EngineAcknowledge, &asyncInfo, sizeof(asyncInfo), NULL, {.internalFn = ism_engine_confirmMessageDeliveryCompleted } },
             {ismENGINE_ASYNCDATAENTRY_STRUCID, EngineCaller,      pContext,   contextLength,     NULL, {.externalFn = pCallbackFn }}};
-    ismEngine_AsyncData_t asyncData = {ismENGINE_ASYNCDATA_STRUCID, pSession->pClient, IEAD_MAXARRAYENTRIES, 2, 0, true,  0, 0, asyncArray};
+    ismEngine_AsyncData_t asyncData = {ismENGINE_ASYNCDATA_STRUCID, pSession->pClient, IEAD_MAXARRAYENTRIES, 2, 0, true,  0, 0, 0, asyncArray};
 
     ismQHandle_t QHandle = hTempHandle.Parts.Q;
     void *hDeliveryHandle = hTempHandle.Parts.Node;
@@ -8156,7 +8214,7 @@ int32_t ism_engine_processBatchAcks(
 #endif
         ismEngine_AsyncDataEntry_t unstoreMsgsAsyncArray[IEAD_MAXARRAYENTRIES];
         ismEngine_AsyncData_t unstoreMsgsAsyncInfo = {ismENGINE_ASYNCDATA_STRUCID, NULL,
-                                                      IEAD_MAXARRAYENTRIES, 0, 0, true,  0, 0,
+                                                      IEAD_MAXARRAYENTRIES, 0, 0, true,  0, 0, 0,
                                                       unstoreMsgsAsyncArray};
 
         DEBUG_ONLY int32_t rc2 =  iest_finishUnstoreMessages( pThreadData
@@ -8275,7 +8333,7 @@ XAPI int32_t WARN_CHECKRC ism_engine_confirmMessageDeliveryBatch(
                 {ismENGINE_ASYNCDATAENTRY_STRUCID, EngineProcessBatchAcks2,   &asyncProcessAcks,  sizeof(asyncProcessAcks), NULL,
                                                                                                            {.internalFn = ism_engine_processBatchAcks }}};
 
-    ismEngine_AsyncData_t asyncInfo = {ismENGINE_ASYNCDATA_STRUCID, pSession->pClient, IEAD_MAXARRAYENTRIES, 4, 0, true,  0, 0, asyncArray};
+    ismEngine_AsyncData_t asyncInfo = {ismENGINE_ASYNCDATA_STRUCID, pSession->pClient, IEAD_MAXARRAYENTRIES, 4, 0, true,  0, 0, 0, asyncArray};
 
 
     if (storeOps > 0)
@@ -245,6 +245,8 @@ void iead_completeAsyncData(int rc, void *context)
                FUNCTION_ENTRY "pAsyncData=%p, ieadACId=0x%016lx rc=%d\n",
                __func__, pAsyncData, pAsyncData->asyncId, rc);
 
+    ieut_recordLatencySince(pThreadData, ieutLATENCY_STORE_COMMIT, pAsyncData->commitTimestamp);
+
     //NB: We're counting down to 0 with an unsigned variable...careful!
     //http://stackoverflow.com/questions/804777/counting-down-in-for-loops/804893#804893
 
@@ -339,6 +341,8 @@ int32_t iead_store_asyncCommit( ieutThreadData_t *pThreadData
         ieutTRACEL(pThreadData, callbackData->asyncId, ENGINE_CEI_TRACE, FUNCTION_IDENT "ieadACId=0x%016lx\n",
                               __func__, callbackData->asyncId);
 
+        callbackData->commitTimestamp = ieut_latencyTimestamp();
+
         rc = iest_store_asyncCommit(pThreadData, commitReservation, iead_completeAsyncData, callbackData);
 
         if (rc == OK)
@@ -118,6 +118,7 @@ struct tag_ismEngine_AsyncData_t {
     bool                              fOnStack;
     uint64_t                          DataBufferAllocated; //Only used when fOnStack is false
     uint64_t                          DataBufferUsed;      //Only used when fOnStack is false
+    uint32_t                          commitTimestamp;     //Latency timestamp of the async commit (0 if not recorded)
     ismEngine_AsyncDataEntry_t       *entries;
 };
 
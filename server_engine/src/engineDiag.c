@@ -32,6 +32,7 @@
 #include "engineMonitoring.h"
 #include "resourceSetStats.h"
 #include "ismjson.h"
+#include "threadJobs.h"
 
 // Execution modes
 typedef enum tag_ediaExecMode_t
@@ -47,6 +48,8 @@ typedef enum tag_ediaExecMode_t
     execMode_RESOURCESETREPORT,
     execMode_MEMORYTRIM,
     execMode_ASYNCCBSTATS,
+    execMode_JOBQUEUESTATS,
+    execMode_LATENCYHISTOGRAMS,
     execMode_LAST // Add new entries above this
 } ediaExecMode_t;
 
@@ -731,6 +734,225 @@ mod_exit:
 }
 
 
+//****************************************************************************
+/// @brief  Add a job queue histogram to a JSON buffer as an object whose
+///         members are the value ranges covered by each bucket.
+//****************************************************************************
+static void edia_jsonAddJobQueueHistogram(ieutJSONBuffer_t *buffer,
+                                          char *name,
+                                          uint64_t *histogram)
+{
+    char bucketName[48];
+
+    ieut_jsonStartObject(buffer, name);
+
+    for (uint32_t i = 0; i < IEJQ_HISTOGRAM_BUCKETS; i++)
+    {
+        if (i < 2)
+        {
+            sprintf(bucketName, "%u", i);
+        }
+        else if (i < IEJQ_HISTOGRAM_BUCKETS-1)
+        {
+            sprintf(bucketName, "%lu-%lu", 1UL<<(i-1), (1UL<<i)-1);
+        }
+        else
+        {
+            sprintf(bucketName, "%lu+", 1UL<<(i-1));
+        }
+
+        ieut_jsonAddUInt64(buffer, bucketName, histogram[i]);
+    }
+
+    ieut_jsonEndObject(buffer);
+}
+
+//****************************************************************************
+/// @brief  edia_modeJobQueueStats
+///
+/// Report the depth and latency histograms for each per-thread job queue
+///
+/// @param[in]     mode               Type of diagnostics requested (currently ignored)
+/// @param[in]     args               Arguments to the diagnostics collection (currently ignored)
+/// @param[out]    diagnosticsOutput  If rc = OK, a diagnostic response string
+///                                       to be freed with ism_engine_freeDiagnosticsOutput()
+/// @param[in]     pContext           Optional context for completion callback
+/// @param[in]     contextLength      Length of data pointed to by pContext
+/// @param[in]     pCallbackFn        Operation-completion callback
+///
+/// @returns OK on successful completion
+///          or an ISMRC_ value if there is a problem
+//****************************************************************************
+int32_t edia_modeJobQueueStats(ieutThreadData_t *pThreadData,
+                               const char *mode,
+                               const char *args,
+                               char **pDiagnosticsOutput,
+                               void *pContext,
+                               size_t contextLength,
+                               ismEngine_CompletionCallback_t  pCallbackFn)
+{
+    int32_t rc = OK;
+    char xbuf[4096];
+    ieutJSONBuffer_t buffer = {true, {xbuf, sizeof(xbuf)}};
+    ietjThreadJobControl_t *threadJobControl = ismEngine_serverGlobal.threadJobControl;
+
+    ieutTRACEL(pThreadData, threadJobControl, ENGINE_FNC_TRACE, FUNCTION_ENTRY "\n", __func__);
+
+    ieut_jsonStartObject(&buffer, NULL);
+    ieut_jsonStartArray(&buffer, "JobQueues");
+
+    if (threadJobControl != NULL)
+    {
+        ismEngine_lockMutex(&(threadJobControl->scavengerListLock));
+
+        for (uint32_t i = 0; i < threadJobControl->scavengerListCount; i++)
+        {
+            ietjScavengerEntry *listEntry = &threadJobControl->scavengerList[i];
+            iejqJobQueueStats_t stats;
+
+            iejq_getStats(listEntry->jobQueue, &stats);
+
+            ieut_jsonStartObject(&buffer, NULL);
+            ieut_jsonAddPointer(&buffer, "JobQueue", listEntry->jobQueue);
+            ieut_jsonAddBool(&buffer, "RemovalRequested", listEntry->removalRequested);
+            ieut_jsonAddUInt64(&buffer, "ScavengedCount", listEntry->scavengedCount);
+            ieut_jsonAddUInt64(&buffer, "Drains", stats.drains);
+            ieut_jsonAddUInt64(&buffer, "ProcessedJobs", stats.processedJobs);
+            ieut_jsonAddUInt64(&buffer, "OverflowedJobs", stats.overflowedJobs);
+            edia_jsonAddJobQueueHistogram(&buffer, "DepthHistogram", stats.depthHistogram);
+            edia_jsonAddJobQueueHistogram(&buffer, "LatencyMicrosHistogram", stats.latencyHistogram);
+            ieut_jsonEndObject(&buffer);
+        }
+
+        ismEngine_unlockMutex(&(threadJobControl->scavengerListLock));
+    }
+
+    ieut_jsonEndArray(&buffer);
+    ieut_jsonEndObject(&buffer);
+
+    char *outbuf = ieut_jsonGenerateOutputBuffer(pThreadData, &buffer, iemem_diagnostics);
+
+    if (outbuf == NULL)
+    {
+        rc = ISMRC_AllocateError;
+        ism_common_setError(rc);
+        goto mod_exit;
+    }
+
+    *pDiagnosticsOutput = outbuf;
+
+mod_exit:
+
+    ieut_jsonReleaseJSONBuffer(&buffer);
+
+    ieutTRACEL(pThreadData, rc, ENGINE_FNC_TRACE, FUNCTION_EXIT "rc=%d\n", __func__, rc);
+    return rc;
+}
+
+//****************************************************************************
+/// @brief  edia_modeLatencyHistograms
+///
+/// Report the latency histograms for each measured point on the messaging path,
+/// merged across all threads
+///
+/// @param[in]     mode               Type of diagnostics requested (currently ignored)
+/// @param[in]     args               Arguments to the diagnostics collection (currently ignored)
+/// @param[out]    diagnosticsOutput  If rc = OK, a diagnostic response string
+///                                       to be freed with ism_engine_freeDiagnosticsOutput()
+/// @param[in]     pContext           Optional context for completion callback
+/// @param[in]     contextLength      Length of data pointed to by pContext
+/// @param[in]     pCallbackFn        Operation-completion callback
+///
+/// @returns OK on successful completion
+///          or an ISMRC_ value if there is a problem
+//****************************************************************************
+int32_t edia_modeLatencyHistograms(ieutThreadData_t *pThreadData,
+                                   const char *mode,
+                                   const char *args,
+                                   char **pDiagnosticsOutput,
+                                   void *pContext,
+                                   size_t contextLength,
+                                   ismEngine_CompletionCallback_t  pCallbackFn)
+{
+    int32_t rc = OK;
+    char xbuf[4096];
+    ieutJSONBuffer_t buffer = {true, {xbuf, sizeof(xbuf)}};
+    static const char *pointNames[ieutLATENCY_POINT_COUNT] = {"Publish", "StoreCommit", "PutToDelivery", "DeliveryToAck"};
+    char bucketName[24];
+
+    ieutTRACEL(pThreadData, contextLength, ENGINE_FNC_TRACE, FUNCTION_ENTRY "\n", __func__);
+
+    ieutLatencyHistogram_t *histograms = iemem_calloc(pThreadData,
+                                                      IEMEM_PROBE(iemem_diagnostics, 7),
+                                                      ieutLATENCY_POINT_COUNT,
+                                                      sizeof(ieutLatencyHistogram_t));
+
+    if (histograms == NULL)
+    {
+        rc = ISMRC_AllocateError;
+        ism_common_setError(rc);
+        goto mod_exit;
+    }
+
+    ieut_getLatencyHistograms(pThreadData, histograms);
+
+    ieut_jsonStartObject(&buffer, NULL);
+    ieut_jsonAddBool(&buffer, "Enabled", ismEngine_serverGlobal.latencyHistogramsEnabled);
+    ieut_jsonStartArray(&buffer, "Latency");
+
+    for (uint32_t point = 0; point < ieutLATENCY_POINT_COUNT; point++)
+    {
+        ieutLatencyHistogram_t *histogram = &histograms[point];
+
+        ieut_jsonStartObject(&buffer, NULL);
+        ieut_jsonAddString(&buffer, "Point", (char *)pointNames[point]);
+        ieut_jsonAddUInt64(&buffer, "Count", histogram->count);
+        ieut_jsonAddUInt64(&buffer, "MeanNanos", histogram->count ? histogram->totalNanos / histogram->count : 0);
+        ieut_jsonAddUInt64(&buffer, "MaxNanos", histogram->maxNanos);
+        ieut_jsonAddUInt64(&buffer, "P50Nanos", ieut_latencyPercentile(histogram, 50.0));
+        ieut_jsonAddUInt64(&buffer, "P90Nanos", ieut_latencyPercentile(histogram, 90.0));
+        ieut_jsonAddUInt64(&buffer, "P99Nanos", ieut_latencyPercentile(histogram, 99.0));
+        ieut_jsonAddUInt64(&buffer, "P999Nanos", ieut_latencyPercentile(histogram, 99.9));
+
+        // Only the non-empty buckets are reported, named by the lowest latency they count
+        ieut_jsonStartObject(&buffer, "Buckets");
+        for (uint32_t bucket = 0; bucket < ieutLATENCY_BUCKETS; bucket++)
+        {
+            if (histogram->buckets[bucket] != 0)
+            {
+                sprintf(bucketName, "%lu", ieut_latencyBucketLowerBound(bucket));
+                ieut_jsonAddUInt64(&buffer, bucketName, histogram->buckets[bucket]);
+            }
+        }
+        ieut_jsonEndObject(&buffer);
+
+        ieut_jsonEndObject(&buffer);
+    }
+
+    ieut_jsonEndArray(&buffer);
+    ieut_jsonEndObject(&buffer);
+
+    char *outbuf = ieut_jsonGenerateOutputBuffer(pThreadData, &buffer, iemem_diagnostics);
+
+    if (outbuf == NULL)
+    {
+        rc = ISMRC_AllocateError;
+        ism_common_setError(rc);
+        goto mod_exit;
+    }
+
+    *pDiagnosticsOutput = outbuf;
+
+mod_exit:
+
+    ieut_jsonReleaseJSONBuffer(&buffer);
+
+    if (histograms != NULL) iemem_free(pThreadData, iemem_diagnostics, histograms);
+
+    ieutTRACEL(pThreadData, rc, ENGINE_FNC_TRACE, FUNCTION_EXIT "rc=%d\n", __func__, rc);
+    return rc;
+}
+
 /// @brief Context passed to the client state traversal callback for each clientState
 typedef struct tag_ediaDumpClientStatesCallbackContext_t
 {
@@ -2240,6 +2462,16 @@ XAPI int32_t WARN_CHECKRC ism_engine_diagnostics(
     {
         execMode = execMode_ASYNCCBSTATS;
     }
+    else if (mode[0] == ediaVALUE_MODE_JOBQUEUESTATS[0] &&
+                strcmp(mode, ediaVALUE_MODE_JOBQUEUESTATS) == 0)
+    {
+        execMode = execMode_JOBQUEUESTATS;
+    }
+    else if (mode[0] == ediaVALUE_MODE_LATENCYHISTOGRAMS[0] &&
+                strcmp(mode, ediaVALUE_MODE_LATENCYHISTOGRAMS) == 0)
+    {
+        execMode = execMode_LATENCYHISTOGRAMS;
+    }
     // Invalid request type
     else
     {
@@ -2326,6 +2558,20 @@ XAPI int32_t WARN_CHECKRC ism_engine_diagnostics(
                                        pDiagnosticsOutput,
                                        pContext, contextLength, pCallbackFn);
             break;
+        case execMode_JOBQUEUESTATS:
+            rc = edia_modeJobQueueStats(pThreadData,
+                                        mode,
+                                        args,
+                                        pDiagnosticsOutput,
+                                        pContext, contextLength, pCallbackFn);
+            break;
+        case execMode_LATENCYHISTOGRAMS:
+            rc = edia_modeLatencyHistograms(pThreadData,
+                                            mode,
+                                            args,
+                                            pDiagnosticsOutput,
+                                            pContext, contextLength, pCallbackFn);
+            break;
         default:
             assert(false);
             rc = ISMRC_InvalidOperation;
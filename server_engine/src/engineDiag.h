@@ -47,6 +47,8 @@ typedef struct tag_ediaEchoAsyncData_t
 #define ediaVALUE_MODE_RESOURCESETREPORT     "ResourceSetReport"
 #define ediaVALUE_MODE_MEMORYTRIM            "MemoryTrim"
 #define ediaVALUE_MODE_ASYNCCBSTATS          "AsyncCBStats"
+#define ediaVALUE_MODE_JOBQUEUESTATS         "JobQueueStats"
+#define ediaVALUE_MODE_LATENCYHISTOGRAMS     "LatencyHistograms"
 
 #define ediaVALUE_FILTER_CLIENTID            "ClientId"
 #define ediaVALUE_FILTER_SUBNAME             "SubName"
@@ -60,6 +60,7 @@ typedef struct tag_iettSubsNode_t                *iettSubsNodeHandle_t;
 typedef struct tag_iettTopicNode_t               *iettTopicNodeHandle_t;               // defined in topicTreeInternal.h
 typedef struct tag_iettTopic_t                   *iettTopicHandle_t;                   // defined in topicTreeInternal.h
 typedef struct tag_iettSubscriberList_t          *iettSubscriberListHandle_t;          // defined in topicTree.h
+typedef struct tag_iettSelectionIndex_t          *iettSelectionIndexHandle_t;          // defined in topicTree.h
 typedef struct tag_iesqQueue_t                   *iesqSimpleQHandle_t;                 // defined in simpQ.h
 typedef struct tag_ieiqQueue_t                   *ieiqInterQHandle_t;                  // defined in intermediateQ.h
 typedef struct ismEngine_Queue_t                 *ismQHandle_t;                        // defined in queueCommon.h
@@ -191,6 +192,36 @@ typedef struct tag_ieutThreadStats_t
 #endif
 } ieutThreadStats_t;
 
+//*********************************************************************
+/// @brief  Points on the messaging path at which latencies are recorded
+//*********************************************************************
+typedef enum tag_ieutLatencyPoint_t
+{
+    ieutLATENCY_PUBLISH = 0,       ///< Time spent in ieds_publish
+    ieutLATENCY_STORE_COMMIT,      ///< Async store commit to completion callback
+    ieutLATENCY_PUT_TO_DELIVERY,   ///< Message creation to its first delivery to a consumer
+    ieutLATENCY_DELIVERY_TO_ACK,   ///< Delivery of a message to the consumer acking it
+    ieutLATENCY_POINT_COUNT        // Add new entries above this
+} ieutLatencyPoint_t;
+
+// Latency histograms are log-linear (HDR-style): each power of two of nanoseconds is
+// split into 2^ieutLATENCY_SUBBUCKET_BITS buckets, so values are recorded to within
+// ~12% from single nanoseconds up to 2^ieutLATENCY_MAX_BITS ns (about 73 minutes).
+#define ieutLATENCY_SUBBUCKET_BITS 3
+#define ieutLATENCY_MAX_BITS       42
+#define ieutLATENCY_BUCKETS        ((ieutLATENCY_MAX_BITS - ieutLATENCY_SUBBUCKET_BITS + 1) << ieutLATENCY_SUBBUCKET_BITS)
+
+//*********************************************************************
+/// @brief  Latency histogram for one latency point
+//*********************************************************************
+typedef struct tag_ieutLatencyHistogram_t
+{
+    uint64_t count;                          ///< Number of latencies recorded
+    uint64_t totalNanos;                     ///< Sum of latencies recorded
+    uint64_t maxNanos;                       ///< Largest latency recorded
+    uint64_t buckets[ieutLATENCY_BUCKETS];   ///< Count of latencies in each bucket
+} ieutLatencyHistogram_t;
+
 //*********************************************************************
 /// @brief The type of config callback the current thread is processing.
 /// expect this to be mostly 'NoConfigCallback'.
@@ -254,6 +285,7 @@ typedef struct ieutThreadData_t
     ieutHashTableHandle_t           sublistCache;                         ///< Hash table containing cached subscriber lists
     iettSubscriberListHandle_t      sublist;                              ///< Per-thread sublist (contains last sublist used on this thread)
     size_t                          topicStringBufferSize;                ///< Length of the topic string buffer pointed to by the per-thread sublist
+    iettSelectionIndexHandle_t      selectionIndex;                       ///< Per-thread index of the last sublist's subscriptions by selection key
     ieutThreadStats_t               stats;                                ///< Statistics generated on this thread (only make sense when summed across all threads)
     bool                            closeStream;                          ///< Whether we should close the store stream during threadTerm
     uint8_t                         isStoreCritical;                      ///< Whether the store stream was initialised as critical (high performance)
@@ -275,6 +307,7 @@ typedef struct ieutThreadData_t
     uint64_t                        entryCount;                           ///< Count of entries in this thread's job queue
     iejqJobQueueHandle_t            jobQueue;                             ///< Job queue of work this thread should perform next time it calls the engine
     uint64_t                        processedJobs;                        ///< How many times this thread processed jobs on entry
+    ieutLatencyHistogram_t          latency[ieutLATENCY_POINT_COUNT];     ///< Latency histograms recorded on this thread (only make sense when merged across all threads)
 #ifndef NDEBUG
     int                             tid;                                  ///< Operating system TID
 #endif
@@ -300,6 +333,7 @@ typedef struct ieutThreadData_t
     iedm_describeMember(ieutHashTable_t *,        sublistCache);\
     iedm_describeMember(iettSubscriberList_t *,   sublist);\
     iedm_describeMember(size_t,                   topicStringBufferSize);\
+    iedm_describeMember(iettSelectionIndex_t *,   selectionIndex);\
     iedm_describeMember(ieutThreadStats_t,        stats);\
     iedm_describeMember(uint8_t,                  isStoreCritical);\
     iedm_describeMember(uint8_t,                  componentTrcLevel);\
@@ -380,14 +414,20 @@ typedef struct ismEngine_Server_t
     ieutThreadData_t                      *threadDataHead;                          ///< Head of chain of thread data structures
     uint32_t                               threadIdCounter;                         ///< Human friendly number that distinguishes the threads
     ieutThreadStats_t                      endedThreadStats;                        ///< Thread stats from all ended threads
+    ieutLatencyHistogram_t                 endedThreadLatency[ieutLATENCY_POINT_COUNT]; ///< Latency histograms from all ended threads
+    bool                                   latencyHistogramsEnabled;                ///< Whether per-thread latency histograms are being recorded
     ism_config_t                          *configCallbackHandle;                    ///< Handle to the configuration callback registration
     uint32_t                               mqttMsgIdRange;                          ///< Number of unacked messages allowed per mqtt client
     uint32_t                               multiConsumerBatchSize;                  ///< Number of messages given to a consumer before cycling to next consumer in round-robin
+    uint32_t                               sharedSubDeliveryClaim;                  ///< Number of messages a shared subscription consumer claims from the get cursor at once
+    uint32_t                               selectionIndexMinimum;                   ///< Number of subscribers on a topic before selection keys are indexed (0 = never)
     uint32_t                               retainedForwardingDelay;                 ///< Number of seconds to delay before requesting forwarding of retained msgs
     uint32_t                               policiesWithDefaultSelection;            ///< Number of policies which have default selection defined
     ismEngine_MessageSelectionCallback_t   selectionFn;                             ///< Message selection callback
     ismEngine_RetainedForwardingCallback_t retainedForwardingFn;                    ///< Retained message forwarding callback function
     ismEngine_DeliveryFailureCallback_t    deliveryFailureFn;                       ///< Called when we fail to deliver messages
+    ismEngine_MessageCallback_t            messageBatchReplacedFn;                  ///< Message-delivery callback that has a batch counterpart
+    ismEngine_MessageBatchCallback_t       messageBatchFn;                          ///< Message-batch delivery callback used in place of messageBatchReplacedFn
     ismEngineRunPhase_t                    runPhase;                                ///< Run phase of the engine
     ismEngineComponentStatus_t             componentStatus[ismENGINE_STATUS_COUNT]; ///< Status of engine components
     volatile uint64_t                      totalSubsCount;                          ///< Overall count of the subscriptions in the maintree
@@ -452,14 +492,20 @@ typedef struct ismEngine_Server_t
     iedm_describeMember(pthread_mutex_t,                        threadDataMutex);\
     iedm_describeMember(ieutThreadData_t *,                     threadDataHead);\
     iedm_describeMember(ieutThreadStats_t,                      endedThreadStats);\
+    iedm_describeMember(ieutLatencyHistogram_t [4],             endedThreadLatency);\
+    iedm_describeMember(bool,                                   latencyHistogramsEnabled);\
     iedm_describeMember(ism_config_t *,                         configCallbackHandle);\
     iedm_describeMember(uint32_t,                               mqttMsgIdRange);\
     iedm_describeMember(uint32_t,                               multiConsumerBatchSize);\
+    iedm_describeMember(uint32_t,                               sharedSubDeliveryClaim);\
+    iedm_describeMember(uint32_t,                               selectionIndexMinimum);\
     iedm_describeMember(uint32_t,                               retainedForwardingDelay);\
     iedm_describeMember(uint32_t,                               policiesWithDefaultSelection);\
     iedm_describeMember(ismEngine_MessageSelectionCallback_t,   selectionFn);\
     iedm_describeMember(ismEngine_RetainedForwardingCallback_t, retainedForwardingFn);\
     iedm_describeMember(ismEngine_DeliveryFailureCallback_t,    deliveryFailureFn);\
+    iedm_describeMember(ismEngine_MessageCallback_t,            messageBatchReplacedFn);\
+    iedm_describeMember(ismEngine_MessageBatchCallback_t,       messageBatchFn);\
     iedm_describeMember(ismEngineRunPhase_t,                    runPhase);\
     iedm_describeMember(uint64_t,                               totalSubsCount);\
     iedm_describeMember(uint64_t,                               totalDCNTopicSubs);\
@@ -911,6 +957,7 @@ typedef struct ismEngine_Subscription_t
     size_t                           flatSubPropertiesLength;    ///< Length of the subscription properties
     ismRule_t                       *selectionRule;              ///< Pointer to compiled selection string
     uint32_t                         selectionRuleLen;           ///< Selection string length
+    ismRule_t                       *selectionCode;              ///< Selection code compiled from the selection rule (NULL if none)
     uint32_t                         clientIdHash;               ///< Hash of the clientId for this subscription
     uint32_t                         subNameHash;                ///< Hash of the subscription name (0 for no subname)
     ismEngine_SubId_t                subId;                      ///< SubId associated with this subscription (0 for none)
@@ -938,6 +985,7 @@ typedef struct ismEngine_Subscription_t
     iedm_describeMember(size_t,                         flatSubPropertiesLength);\
     iedm_describeMember(ismRule_t *,                    selectionRule);\
     iedm_describeMember(uint32_t,                       selectionRuleLen);\
+    iedm_describeMember(ismRule_t *,                    selectionCode);\
     iedm_describeMember(uint32_t,                       clientIdHash);\
     iedm_describeMember(uint32_t,                       subNameHash);\
     iedm_describeMember(ismEngine_SubId_t,              subId);\
@@ -1187,6 +1235,8 @@ typedef struct ismEngine_Consumer_t
     volatile ismEngine_ConsumerCounts_t   counts;                    ///< Number of uses of this consumer - must not deallocate when any > 0
     void                                 *pMsgCallbackContext;       ///< Context for message-delivery callback
     ismEngine_MessageCallback_t           pMsgCallbackFn;            ///< Function pointer for message-delivery callback
+    ismEngine_MessageBatchCallback_t      pMsgBatchCallbackFn;       ///< Function pointer for message-batch delivery callback (may be NULL)
+    uint32_t                              msgBatchSize;              ///< Current adaptive size of batches given to pMsgBatchCallbackFn
     void                                 *pPendingDestroyContext;    ///< Context for completion of destroy operation
     ismEngine_CompletionCallback_t        pPendingDestroyCallbackFn; ///< Function pointer for completion callback of destroy operation
     void                                 *engineObject;              ///< Ptr to associated engine object (subscription or named queue)
@@ -1237,6 +1287,8 @@ typedef struct ismEngine_Consumer_t
     iedm_describeMember(ismEngine_ConsumerCounts_t,      counts);\
     iedm_describeMember(void *,                          pMsgCallbackContext);\
     iedm_describeMember(ismEngine_MessageCallback_t,     pMsgCallbackFn);\
+    iedm_describeMember(ismEngine_MessageBatchCallback_t, pMsgBatchCallbackFn);\
+    iedm_describeMember(uint32_t,                        msgBatchSize);\
     iedm_describeMember(void *,                          pPendingDestroyContext);\
     iedm_describeMember(ismEngine_CompletionCallback_t,  pPendingDestroyCallbackFn);\
     iedm_describeMember(void *,                          engineObject);\
@@ -1781,6 +1833,15 @@ static inline void ismEngine_DisplayProperties(ism_prop_t *props)
 #define ismENGINE_CFGPROP_MULTICONSUMER_MESSAGE_BATCH   "Engine.MultiConsumerMessageBatchSize"
 #define ismENGINE_DEFAULT_MULTICONSUMER_MESSAGE_BATCH   3  ///< Deliver (at most) this many messages to a consumer before round-robining to next one
 
+#define ismENGINE_CFGPROP_SHARED_SUB_DELIVERY_CLAIM     "Engine.SharedSubDeliveryClaimSize"
+#define ismENGINE_DEFAULT_SHARED_SUB_DELIVERY_CLAIM     1  ///< Messages a shared sub consumer claims per visit to the queue's get cursor (1 = strict queue order)
+
+#define ismENGINE_CFGPROP_SELECTION_INDEX_MINIMUM       "Engine.SelectionIndexMinimum"
+#define ismENGINE_DEFAULT_SELECTION_INDEX_MINIMUM       64 ///< Subscribers on a topic before publish indexes their selection keys (0 = never)
+
+#define ismENGINE_CFGPROP_LATENCY_HISTOGRAMS            "Engine.LatencyHistograms"
+#define ismENGINE_DEFAULT_LATENCY_HISTOGRAMS            false ///< Whether per-thread latency histograms are recorded on the messaging path
+
 #define ismENGINE_CFGPROP_FREE_MEM_RESERVED_MB  "Engine.FreeMemReservedMB" ///< On a small machine, ignore ("reserve") this much free memory for non MemManager use
 #define ismENGINE_DEFAULT_FREE_MEM_RESERVED_MB  300                        ///< On a small machine, ignore ("reserve") this much free memory for non MemManager use
 
@@ -2044,6 +2105,69 @@ static inline uint64_t ism_engine_fastTimeUInt64(void)
 #endif
 }
 
+//****************************************************************************
+/// @brief  Latency measurement helpers
+///
+/// Durations measured within a single call use ieut_latencyTimeNanos. Where the
+/// start of the interval has to be remembered in a message, queue node or async
+/// data, a 32-bit microsecond timestamp from ieut_latencyTimestamp is kept instead
+/// (it wraps every ~71 minutes, which is fine for a latency). A timestamp of 0
+/// means 'not recorded' and is returned when histograms are disabled.
+//****************************************************************************
+static inline uint64_t ieut_latencyTimeNanos(void)
+{
+    return (uint64_t)(ism_common_readTSC() * 1000000000.0);
+}
+
+static inline uint32_t ieut_latencyTimestamp(void)
+{
+    if (!ismEngine_serverGlobal.latencyHistogramsEnabled) return 0;
+
+    uint32_t timestamp = (uint32_t)(uint64_t)(ism_common_readTSC() * 1000000.0);
+
+    return (timestamp == 0) ? 1 : timestamp;
+}
+
+static inline uint32_t ieut_latencyBucket(uint64_t nanos)
+{
+    if (nanos < (1UL << ieutLATENCY_SUBBUCKET_BITS)) return (uint32_t)nanos;
+
+    uint32_t msb = 63 - __builtin_clzl(nanos);
+
+    if (msb >= ieutLATENCY_MAX_BITS) return ieutLATENCY_BUCKETS - 1;
+
+    uint32_t subBucket = (uint32_t)(nanos >> (msb - ieutLATENCY_SUBBUCKET_BITS)) & ((1 << ieutLATENCY_SUBBUCKET_BITS) - 1);
+
+    return ((msb - ieutLATENCY_SUBBUCKET_BITS + 1) << ieutLATENCY_SUBBUCKET_BITS) | subBucket;
+}
+
+static inline void ieut_recordLatency(ieutThreadData_t *pThreadData,
+                                      ieutLatencyPoint_t point,
+                                      uint64_t nanos)
+{
+    ieutLatencyHistogram_t *histogram = &(pThreadData->latency[point]);
+
+    histogram->count++;
+    histogram->totalNanos += nanos;
+    if (nanos > histogram->maxNanos) histogram->maxNanos = nanos;
+    histogram->buckets[ieut_latencyBucket(nanos)]++;
+}
+
+static inline void ieut_recordLatencySince(ieutThreadData_t *pThreadData,
+                                           ieutLatencyPoint_t point,
+                                           uint32_t timestamp)
+{
+    if (timestamp != 0)
+    {
+        uint32_t nowTimestamp = ieut_latencyTimestamp();
+
+        if (nowTimestamp != 0)
+        {
+            ieut_recordLatency(pThreadData, point, (uint64_t)(uint32_t)(nowTimestamp - timestamp) * 1000);
+        }
+    }
+}
+
 // The current definition of the values that are put into the ID_ServerTime property for retained messages
 #define ism_engine_retainedServerTime()  ism_common_currentTimeNanos()
 
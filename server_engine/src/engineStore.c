@@ -629,6 +629,7 @@ int32_t iest_rehydrateMessage( ieutThreadData_t *pThreadData
     {
         ismEngine_SetStructId(pMessage->StrucId, ismENGINE_MESSAGE_STRUCID);
         pMessage->MsgLength = MsgLength;
+        pMessage->putTimestamp = 0;
         pMessage->resourceSet = iereNO_RESOURCE_SET;
         pMessage->fullMemSize = (int64_t)iere_full_size(iemem_messageBody, pMessage);
 
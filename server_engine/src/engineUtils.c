@@ -253,6 +253,12 @@ XAPI void ism_engine_threadTerm(uint8_t closeStoreStream)
                sizeof(ismEngine_threadData->stats.resourceSetMemBytes));
 #endif
 
+        for (uint32_t point = 0; point < ieutLATENCY_POINT_COUNT; point++)
+        {
+            ieut_mergeLatencyHistogram(&ismEngine_serverGlobal.endedThreadLatency[point],
+                                       &ismEngine_threadData->latency[point]);
+        }
+
 #if (ieutTRACEHISTORY_SAVEDTHREADS > 0)
 #if (ieutTRACEHISTORY_BUFFERSIZE > 0)
         //We also want to preserve the per-thread trace data for the thread
@@ -587,6 +593,24 @@ void ieut_enumerateThreadData(ieutThreadData_EnumCallback_t  callback,
     osrc = pthread_mutex_lock(&ismEngine_serverGlobal.threadDataMutex);
     assert(osrc == 0);
 
+    ieut_enumerateThreadDataLocked(callback, context);
+
+    osrc = pthread_mutex_unlock(&ismEngine_serverGlobal.threadDataMutex);
+    assert(osrc == 0);
+}
+
+//****************************************************************************
+/// @brief  Enumerate all of the thread data structures in the global list
+///         calling a callback for each, with the thread chain already locked.
+///
+/// @param[in]     callback  Function to call with each thread data structure
+/// @param[in]     context   Context information used by the callback routine
+///
+/// @remark The caller must hold ismEngine_serverGlobal.threadDataMutex.
+//****************************************************************************
+void ieut_enumerateThreadDataLocked(ieutThreadData_EnumCallback_t  callback,
+                                    void *context)
+{
     ieutThreadData_t *pThreadData = ismEngine_serverGlobal.threadDataHead;
 
     while(pThreadData != NULL)
@@ -596,9 +620,117 @@ void ieut_enumerateThreadData(ieutThreadData_EnumCallback_t  callback,
 
         pThreadData = pThreadData->next;
     }
+}
+
+//****************************************************************************
+/// @brief  Add the values recorded in one latency histogram into another
+///
+/// @param[in,out] target    Histogram to add to
+/// @param[in]     source    Histogram whose values are added
+//****************************************************************************
+void ieut_mergeLatencyHistogram(ieutLatencyHistogram_t *target,
+                                ieutLatencyHistogram_t *source)
+{
+    if (source->count == 0) return;
+
+    target->count += source->count;
+    target->totalNanos += source->totalNanos;
+    if (source->maxNanos > target->maxNanos) target->maxNanos = source->maxNanos;
+
+    for (uint32_t i = 0; i < ieutLATENCY_BUCKETS; i++)
+    {
+        target->buckets[i] += source->buckets[i];
+    }
+}
+
+static void ieut_mergeThreadLatencyCallback(ieutThreadData_t *pThreadData,
+                                            void *context)
+{
+    ieutLatencyHistogram_t *histograms = (ieutLatencyHistogram_t *)context;
+
+    for (uint32_t point = 0; point < ieutLATENCY_POINT_COUNT; point++)
+    {
+        ieut_mergeLatencyHistogram(&histograms[point], &pThreadData->latency[point]);
+    }
+}
+
+//****************************************************************************
+/// @brief  Get the latency histograms merged across all threads
+///
+/// @param[in]     pThreadData  Thread data of the caller
+/// @param[out]    histograms   Array of ieutLATENCY_POINT_COUNT histograms to fill in
+///
+/// @remark The per-thread histograms are read without stopping the threads
+/// updating them, so the result is a close approximation rather than an
+/// exact snapshot.
+//****************************************************************************
+void ieut_getLatencyHistograms(ieutThreadData_t *pThreadData,
+                               ieutLatencyHistogram_t *histograms)
+{
+    ieutTRACEL(pThreadData, histograms, ENGINE_FNC_TRACE, FUNCTION_ENTRY "\n", __func__);
+
+    // Hold the thread chain lock so that a thread ending part way through
+    // is counted exactly once, either in the ended totals or in its own data
+    DEBUG_ONLY int osrc;
+    osrc = pthread_mutex_lock(&ismEngine_serverGlobal.threadDataMutex);
+    assert(osrc == 0);
+
+    memcpy(histograms, ismEngine_serverGlobal.endedThreadLatency,
+           sizeof(ieutLatencyHistogram_t) * ieutLATENCY_POINT_COUNT);
+
+    ieut_enumerateThreadDataLocked(ieut_mergeThreadLatencyCallback, histograms);
 
     osrc = pthread_mutex_unlock(&ismEngine_serverGlobal.threadDataMutex);
     assert(osrc == 0);
+
+    ieutTRACEL(pThreadData, histograms[ieutLATENCY_PUBLISH].count, ENGINE_FNC_TRACE, FUNCTION_EXIT "\n", __func__);
+}
+
+//****************************************************************************
+/// @brief  Return the lowest latency (in nanoseconds) counted in a bucket
+//****************************************************************************
+uint64_t ieut_latencyBucketLowerBound(uint32_t bucket)
+{
+    if (bucket < (1 << ieutLATENCY_SUBBUCKET_BITS)) return bucket;
+
+    uint32_t shift = (bucket >> ieutLATENCY_SUBBUCKET_BITS) - 1;
+    uint64_t subBucket = bucket & ((1 << ieutLATENCY_SUBBUCKET_BITS) - 1);
+
+    return ((1UL << ieutLATENCY_SUBBUCKET_BITS) | subBucket) << shift;
+}
+
+//****************************************************************************
+/// @brief  Return the latency (in nanoseconds) below which the specified
+///         percentage of the values in a histogram lie
+//****************************************************************************
+uint64_t ieut_latencyPercentile(ieutLatencyHistogram_t *histogram,
+                                double percentile)
+{
+    uint64_t result = 0;
+
+    if (histogram->count != 0)
+    {
+        uint64_t target = (uint64_t)((percentile / 100.0) * histogram->count);
+        uint64_t counted = 0;
+
+        if (target >= histogram->count) target = histogram->count - 1;
+
+        for (uint32_t i = 0; i < ieutLATENCY_BUCKETS; i++)
+        {
+            counted += histogram->buckets[i];
+
+            if (counted > target)
+            {
+                //Report the top of the bucket (the start of the next one)
+                result = (i < ieutLATENCY_BUCKETS-1) ? ieut_latencyBucketLowerBound(i+1) : histogram->maxNanos;
+                break;
+            }
+        }
+
+        if (result > histogram->maxNanos) result = histogram->maxNanos;
+    }
+
+    return result;
 }
 
 #if (ieutTRACEHISTORY_BUFFERSIZE > 0)
@@ -39,6 +39,21 @@ void ieut_createFullThreadDataForAllThreads(void);
 // Enumerate the global list of thread data structures calling a callback function for each
 void ieut_enumerateThreadData(ieutThreadData_EnumCallback_t *callback, void *context);
 
+// Enumerate the global list of thread data structures when the caller already holds threadDataMutex
+void ieut_enumerateThreadDataLocked(ieutThreadData_EnumCallback_t *callback, void *context);
+
+// Add the values in one latency histogram into another
+void ieut_mergeLatencyHistogram(ieutLatencyHistogram_t *target, ieutLatencyHistogram_t *source);
+
+// Get the latency histograms merged across all threads (array of ieutLATENCY_POINT_COUNT)
+void ieut_getLatencyHistograms(ieutThreadData_t *pThreadData, ieutLatencyHistogram_t *histograms);
+
+// Lowest latency (in nanoseconds) counted in a latency histogram bucket
+uint64_t ieut_latencyBucketLowerBound(uint32_t bucket);
+
+// Latency (in nanoseconds) below which a percentage of the values in a histogram lie
+uint64_t ieut_latencyPercentile(ieutLatencyHistogram_t *histogram, double percentile);
+
 // Wait for up to x minutes for a uint32_t counter to get to 0
 int32_t ieut_waitForRemainingActions(ieutThreadData_t *pThreadData,
                                      volatile uint32_t *remainingActions,
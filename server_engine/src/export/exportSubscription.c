@@ -973,7 +973,7 @@ int32_t ieie_doImportSubscription(ieutThreadData_t *pThreadData,
 
                         ismEngine_AsyncData_t asyncData = {ismENGINE_ASYNCDATA_STRUCID,
                                                            clientInfo.owningClient,
-                                                           IEAD_MAXARRAYENTRIES, 2, 0, true,  0, 0, asyncArray};
+                                                           IEAD_MAXARRAYENTRIES, 2, 0, true,  0, 0, 0, asyncArray};
 
                         rc = iett_createSubscription(pThreadData,
                                                      &clientInfo,
@@ -2624,7 +2624,7 @@ static inline void ieiq_destroyMessageBatch(  ieutThreadData_t *pThreadData
         ismEngine_AsyncDataEntry_t asyncArray[IEAD_MAXARRAYENTRIES] = {
                 {ismENGINE_ASYNCDATAENTRY_STRUCID, ieiqQueueDestroyMessageBatch1,  discardNodes,  batchSize*sizeof(ieiqQNode_t *), NULL, {.internalFn = ieiq_asyncDestroyMessageBatch } },
                 {ismENGINE_ASYNCDATAENTRY_STRUCID, ieiqQueueDestroyMessageBatch2,  &asyncBatchData,   sizeof(asyncBatchData),     NULL, {.internalFn = ieiq_asyncDestroyMessageBatch }}};
-        ismEngine_AsyncData_t asyncData = {ismENGINE_ASYNCDATA_STRUCID, NULL, IEAD_MAXARRAYENTRIES, 2, 0, true,  0, 0, asyncArray};
+        ismEngine_AsyncData_t asyncData = {ismENGINE_ASYNCDATA_STRUCID, NULL, IEAD_MAXARRAYENTRIES, 2, 0, true,  0, 0, 0, asyncArray};
 
         if (storeOpsCount > 0)
         {
@@ -3093,6 +3093,9 @@ int32_t ieiq_acknowledge( ieutThreadData_t *pThreadData
                     , NULL );
         }
 
+        ieut_recordLatencySince(pThreadData, ieutLATENCY_DELIVERY_TO_ACK, pnode->deliveryTimestamp);
+        pnode->deliveryTimestamp = 0;
+
         if (Q->hMsgDelInfo == NULL)
         {
             // If we don't yet have the delivery information handle, get it now
@@ -4119,7 +4122,7 @@ static inline int32_t ieiq_postTranPutWork( ieutThreadData_t *pThreadData
 
         ismEngine_AsyncData_t asyncData = {ismENGINE_ASYNCDATA_STRUCID
                                           , (pTran->pSession!= NULL) ? pTran->pSession->pClient : NULL
-                                          , IEAD_MAXARRAYENTRIES, 2, 0, true, 0, 0, asyncArray};
+                                          , IEAD_MAXARRAYENTRIES, 2, 0, true, 0, 0, 0, asyncArray};
 
         if (pAsyncData == NULL)
         {
@@ -5612,6 +5615,7 @@ static void ieiq_completePreparingMessage( ieutThreadData_t      *pThreadData
 
         // Identify the message as having been delivered
         pnode->msgState = newMsgState;
+        pnode->deliveryTimestamp = ieut_latencyTimestamp();
 
         ieutTRACEL(pThreadData, pnode, ENGINE_HIFREQ_FNC_TRACE, FUNCTION_IDENT "Setting node %p to %u\n",
                               __func__, pnode, newMsgState);
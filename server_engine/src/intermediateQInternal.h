@@ -52,6 +52,7 @@ typedef struct tag_ieiqQNode_t
    uint8_t                         msgFlags;          ///< Message flags
    bool                            hasMDR;            ///< Has MDR in store
    bool                            inStore;           ///< Persisted in store
+   uint32_t                        deliveryTimestamp; ///< Latency timestamp of last delivery (0 if not recorded)
    uint64_t                        orderId;           ///< Order id
    ismEngine_Message_t             *msg;              ///< Pointer to msg
    ismStore_Handle_t               hMsgRef;           ///< Store reference to msg on queue
@@ -14,6 +14,16 @@
 //****************************************************************************
 /// @file  jobQueue.c
 /// @brief Code for queues of work being queued between threads
+///
+/// Each queue is a bounded multi-producer/single-consumer ring. Producers
+/// claim a slot by compare-and-swap on putPos and publish the job by
+/// advancing the slot's sequence number, so no lock is needed to add a job.
+/// The consumer (whoever holds the getLock) removes jobs in batches.
+///
+/// If the ring is full, jobs are pushed onto a lock-free overflow list
+/// instead of being rejected. While the overflow list is non-empty all
+/// producers use it, and the consumer only takes the list once the ring
+/// is empty, so jobs from a given producer are always processed in order.
 //****************************************************************************
 #define TRACE_COMP Engine
 
@@ -21,117 +31,140 @@
 #include "memHandler.h"
 #include "jobQueue.h"
 
-typedef struct tag_iejqJob_t {
+#define IEJQ_JOB_MASK (IEJQ_JOB_MAX-1)
+
+typedef struct tag_iejqSlot_t {
+    volatile uint64_t seq;  ///< pos+1 when slot pos is ready to get, pos+IEJQ_JOB_MAX when free for the next lap
     void *func;
     void *args;
-} iejqJob_t;
+    double putTime;         ///< TSC when the job was added
+} iejqSlot_t;
 
-void *iejqNullJob =  NULL;
-void *iejqJobSeperator = (void *)0x1; //0x01 = illegal value for func ptr
+typedef struct tag_iejqOverflowJob_t {
+    struct tag_iejqOverflowJob_t *next;
+    void *func;
+    void *args;
+    double putTime;
+} iejqOverflowJob_t;
 
 typedef struct tag_iejqJobQueue_t {
-#ifdef IEJQ_JOBQUEUE_PUTLOCK
-    pthread_spinlock_t putLock;
-#endif
-    uint64_t  putPos;
-    volatile iejqJob_t jobArr[IEJQ_JOB_MAX];
-    pthread_spinlock_t getLock; //Separate in memory from putlock to avoud cacheline contention
+    //Written by producers
+    volatile uint64_t putPos;
+    iejqOverflowJob_t * volatile overflowHead; //Most recently added overflow job first
+    volatile uint64_t overflowedJobs;
+    //Written by the consumer... on a separate cacheline to avoid contention with producers
+    pthread_spinlock_t getLock CACHELINE_ALIGNED;
     uint64_t  getPos;
+    iejqOverflowJob_t *overflowDrain; //Overflow jobs taken by the consumer, oldest first
     bool ownerBlocked; //Has the self declared owner complained they couldn't get the get lock
+    iejqJobQueueStats_t stats;
+    iejqSlot_t jobArr[IEJQ_JOB_MAX] CACHELINE_ALIGNED;
 } iejqJobQueue_t;
 
-#ifdef IEJQ_JOBQUEUE_PUTLOCK
-static inline void iejq_takePutLockInternal(ieutThreadData_t *pThreadData, iejqJobQueue_t *jq)
+static inline uint32_t iejq_histogramBucket(uint64_t value)
 {
-    int os_rc = pthread_spin_lock(&(jq->putLock));
+    uint32_t bucket = (value == 0) ? 0 : (64 - __builtin_clzll(value));
 
-    if (UNLIKELY(os_rc != 0))
-    {
-        ieutTRACE_FFDC( ieutPROBE_001, true
-                , "failed taking put lock.", os_rc
-                , "JQ", jq, sizeof(iejqJobQueue_t)
-                , NULL );
-    }
+    return (bucket < IEJQ_HISTOGRAM_BUCKETS) ? bucket : (IEJQ_HISTOGRAM_BUCKETS-1);
 }
-static inline void iejq_releasePutLockInternal(ieutThreadData_t *pThreadData, iejqJobQueue_t *jq)
-{
-    int os_rc = pthread_spin_unlock(&(jq->putLock));
 
-    if (UNLIKELY(os_rc != 0))
-    {
-        ieutTRACE_FFDC( ieutPROBE_001, true
-                , "failed releasing put lock.", os_rc
-                , "JQ", jq, sizeof(iejqJobQueue_t)
-                , NULL );
-    }
-}
-void iejq_takePutLock(ieutThreadData_t *pThreadData, iejqJobQueueHandle_t jqh)
+static inline void iejq_recordLatency(iejqJobQueue_t *jq, double now, double putTime)
 {
-    iejqJobQueue_t *jq = (iejqJobQueue_t *)jqh;
-    return iejq_takePutLockInternal(pThreadData, jq);
+    double latencyMicros = (now - putTime) * 1000000.0;
+
+    jq->stats.latencyHistogram[iejq_histogramBucket(latencyMicros > 0 ? (uint64_t)latencyMicros : 0)]++;
 }
-void iejq_releasePutLock(ieutThreadData_t *pThreadData, iejqJobQueueHandle_t jqh)
+
+static int32_t iejq_addOverflowJob( ieutThreadData_t *pThreadData
+                                  , iejqJobQueue_t *jq
+                                  , void *func
+                                  , void *args
+                                  , double putTime)
 {
-    iejqJobQueue_t *jq = (iejqJobQueue_t *)jqh;
-    return iejq_releasePutLockInternal(pThreadData, jq);
+    int32_t rc = OK;
+    iejqOverflowJob_t *job = (iejqOverflowJob_t *)iemem_malloc( pThreadData
+                                                              , IEMEM_PROBE(iemem_jobQueues, 4)
+                                                              , sizeof(iejqOverflowJob_t));
+
+    if (job != NULL)
+    {
+        job->func = func;
+        job->args = args;
+        job->putTime = putTime;
+
+        iejqOverflowJob_t *oldHead;
+
+        do
+        {
+            oldHead = jq->overflowHead;
+            job->next = oldHead;
+        }
+        while(!__sync_bool_compare_and_swap(&(jq->overflowHead), oldHead, job));
+
+        __sync_fetch_and_add(&(jq->overflowedJobs), 1);
+    }
+    else
+    {
+        //Callers treat this like the queue having been full
+        rc = ISMRC_DestinationFull;
+    }
+
+    return rc;
 }
-#endif
 
 int32_t iejq_addJob( ieutThreadData_t *pThreadData
                    , iejqJobQueueHandle_t jqh
                    , void *func
-                   , void *args
-#ifdef IEJQ_JOBQUEUE_PUTLOCK
-                   , bool takeLock)
-#else
-                   )
-#endif
+                   , void *args)
 {
     int32_t rc = ISMRC_OK;
     iejqJobQueue_t *jq = (iejqJobQueue_t *)jqh;
+    double putTime = ism_common_readTSC();
 
-#ifdef IEJQ_JOBQUEUE_PUTLOCK
-    if (takeLock)
+    //Once jobs are overflowing, keep overflowing until the consumer has caught up
+    //so that jobs are not reordered
+    if (jq->overflowHead != NULL)
     {
-        iejq_takePutLock(pThreadData, jq);
+        rc = iejq_addOverflowJob(pThreadData, jq, func, args, putTime);
+        goto mod_exit;
     }
-#endif
-    uint64_t curPos = jq->putPos;
 
-    //printf("put - curPos: %lu, func: %lu, args %lu, nulljob %lu\n",
-    //          curPos, (uint64_t)(jq->jobArr[curPos].func),
-    //                  (uint64_t)(jq->jobArr[curPos].args),
-    //                  (uint64_t)iejqNullJob);
+    uint64_t curPos = jq->putPos;
 
-    if(jq->jobArr[curPos].func == iejqNullJob)
-    {
-       jq->jobArr[curPos].args = args; //Do args before func,  have write barrier between then on non x86-64
-       ismEngine_WriteMemoryBarrier();
-       jq->jobArr[curPos].func       = func;
-
-       if (jq->putPos < (IEJQ_JOB_MAX-1))
-       {
-           jq->putPos++;
-       }
-       else
-       {
-           jq->putPos = 0;
-       }
-    }
-    else
+    while (true)
     {
-        rc = ISMRC_DestinationFull;
-    }
+        iejqSlot_t *slot = &(jq->jobArr[curPos & IEJQ_JOB_MASK]);
+        int64_t diff = (int64_t)(slot->seq - curPos);
 
-#ifdef IEJQ_JOBQUEUE_PUTLOCK
-    if(takeLock)
-    {
-        iejq_releasePutLock(pThreadData, jq);
+        if (diff == 0)
+        {
+            //Slot is free - try and claim it
+            if (__sync_bool_compare_and_swap(&(jq->putPos), curPos, curPos+1))
+            {
+                slot->func = func;
+                slot->args = args;
+                slot->putTime = putTime;
+                ismEngine_WriteMemoryBarrier(); //Job must be visible before it is published
+                slot->seq = curPos+1;
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            //Ring is full
+            rc = iejq_addOverflowJob(pThreadData, jq, func, args, putTime);
+            break;
+        }
+
+        //Someone else claimed the slot, try again from the current position
+        curPos = jq->putPos;
     }
-#endif
+
+mod_exit:
 
     return rc;
 }
+
 static inline void iejq_takeGetLockInternal(ieutThreadData_t *pThreadData, iejqJobQueue_t *jq)
 {
     int os_rc = pthread_spin_lock(&(jq->getLock));
@@ -193,6 +226,95 @@ void iejq_releaseGetLock(ieutThreadData_t *pThreadData, iejqJobQueueHandle_t jqh
     return iejq_releaseGetLockInternal(pThreadData, jq);
 }
 
+//Move the overflow list to the consumer's drain list, reversing it so the
+//oldest job comes first. Called with the getLock held and the ring empty.
+static inline bool iejq_takeOverflowJobs(iejqJobQueue_t *jq)
+{
+    assert(jq->overflowDrain == NULL);
+
+    iejqOverflowJob_t *job = __sync_lock_test_and_set(&(jq->overflowHead), NULL);
+
+    while (job != NULL)
+    {
+        iejqOverflowJob_t *next = job->next;
+        job->next = jq->overflowDrain;
+        jq->overflowDrain = job;
+        job = next;
+    }
+
+    return (jq->overflowDrain != NULL);
+}
+
+//****************************************************************************
+/// @brief Remove a batch of jobs from the queue
+///
+/// @param[in]     jqh              Job queue (getLock must be held by the caller)
+/// @param[out]    jobs             Array to receive the jobs
+/// @param[in]     maxJobs          Size of the jobs array
+///
+/// @return Number of jobs returned
+//****************************************************************************
+uint32_t iejq_getJobs( ieutThreadData_t *pThreadData
+                     , iejqJobQueueHandle_t jqh
+                     , iejqJob_t *jobs
+                     , uint32_t maxJobs)
+{
+    iejqJobQueue_t *jq = (iejqJobQueue_t *)jqh;
+    uint32_t found = 0;
+    uint64_t curPos = jq->getPos;
+    uint64_t ringDepth = jq->putPos - curPos;
+    double now = ism_common_readTSC();
+
+    while (found < maxJobs)
+    {
+        //Jobs taken from the overflow list are older than anything now in the ring
+        if (jq->overflowDrain != NULL)
+        {
+            iejqOverflowJob_t *job = jq->overflowDrain;
+
+            jobs[found].func = job->func;
+            jobs[found].args = job->args;
+            iejq_recordLatency(jq, now, job->putTime);
+            found++;
+
+            jq->overflowDrain = job->next;
+            iemem_free(pThreadData, iemem_jobQueues, job);
+            continue;
+        }
+
+        iejqSlot_t *slot = &(jq->jobArr[curPos & IEJQ_JOB_MASK]);
+
+        if (slot->seq == curPos+1)
+        {
+            ismEngine_ReadMemoryBarrier();
+            jobs[found].func = slot->func;
+            jobs[found].args = slot->args;
+            iejq_recordLatency(jq, now, slot->putTime);
+            found++;
+
+            //Free the slot for the next time round the ring
+            slot->seq = curPos+IEJQ_JOB_MAX;
+            curPos++;
+        }
+        else if (curPos != jq->putPos || !iejq_takeOverflowJobs(jq))
+        {
+            //Either a producer is part way through publishing the next slot (we'll
+            //pick it up next time) or there is nothing left
+            break;
+        }
+    }
+
+    if (found != 0)
+    {
+        jq->stats.drains++;
+        jq->stats.processedJobs += found;
+        jq->stats.depthHistogram[iejq_histogramBucket(ringDepth)]++;
+        jq->getPos = curPos;
+    }
+
+    return found;
+}
+
 int32_t iejq_getJob( ieutThreadData_t *pThreadData
                    , iejqJobQueueHandle_t jqh
                    , void **pFunc
@@ -201,48 +323,18 @@ int32_t iejq_getJob( ieutThreadData_t *pThreadData
 {
     int32_t rc = ISMRC_NoMsgAvail;
     iejqJobQueue_t *jq = (iejqJobQueue_t *)jqh;
+    iejqJob_t job;
 
     if (takeLock)
     {
         iejq_takeGetLock(pThreadData, jq);
     }
 
-    uint64_t curPos = jq->getPos;
-
-    //printf("get - curPos: %lu, func: %lu, args %lu, nulljob %lu\n",
-    //         curPos, (uint64_t)(jq->jobArr[curPos].func),
-    //                 (uint64_t)(jq->jobArr[curPos].args),
-    //                (uint64_t)iejqNullJob);
-
-    void *func = jq->jobArr[curPos].func;
-
-    if(func != iejqNullJob) {
-       *pFunc = func;
-       ismEngine_ReadMemoryBarrier();
-       *pArgs = jq->jobArr[curPos].args;
-       rc = ISMRC_OK;
-
-       //Work out current separator pos and update get pos;
-       uint64_t curSeparator;
-
-       if (curPos == 0)
-       {
-           curSeparator = IEJQ_JOB_MAX - 1;
-           jq->getPos   = 1;
-       }
-       else if (curPos == (IEJQ_JOB_MAX-1))
-       {
-           curSeparator = curPos - 1;
-           jq->getPos   = 0;
-       }
-       else
-       {
-           curSeparator = curPos - 1;
-           jq->getPos +=1;
-       }
-       //Set the slot we got from to the separator and clear the existing sepator
-       jq->jobArr[curPos].func       = iejqJobSeperator;
-       jq->jobArr[curSeparator].func = iejqNullJob;
+    if (iejq_getJobs(pThreadData, jq, &job, 1) == 1)
+    {
+        *pFunc = job.func;
+        *pArgs = job.args;
+        rc = ISMRC_OK;
     }
 
     if(takeLock)
@@ -253,8 +345,6 @@ int32_t iejq_getJob( ieutThreadData_t *pThreadData
     return rc;
 }
 
-
-
 int32_t iejq_createJobQueue(ieutThreadData_t *pThreadData, iejqJobQueueHandle_t *pJQH)
 {
     int32_t rc = OK;
@@ -264,37 +354,24 @@ int32_t iejq_createJobQueue(ieutThreadData_t *pThreadData, iejqJobQueueHandle_t
 
     if (jq != NULL)
     {
-        #ifdef IEJQ_JOBQUEUE_PUTLOCK
-        int os_rc = pthread_spin_init(&(jq->putLock), PTHREAD_PROCESS_PRIVATE);
+        int os_rc = pthread_spin_init(&(jq->getLock), PTHREAD_PROCESS_PRIVATE);
 
         if (UNLIKELY(os_rc != 0))
         {
             ieutTRACE_FFDC( ieutPROBE_001, true
-                    , "failed creating put lock.", os_rc
+                    , "failed creating get lock.", os_rc
                     , "JQ", jq, sizeof(iejqJobQueue_t)
                     , NULL );
         }
-        #else
-        int os_rc;
-        #endif
 
-        os_rc = pthread_spin_init(&(jq->getLock), PTHREAD_PROCESS_PRIVATE);
-
-        if (UNLIKELY(os_rc != 0))
+        //Each slot starts out free for the first lap round the ring
+        for (uint64_t i = 0; i < IEJQ_JOB_MAX; i++)
         {
-            ieutTRACE_FFDC( ieutPROBE_001, true
-                    , "failed get put lock.", os_rc
-                    , "JQ", jq, sizeof(iejqJobQueue_t)
-                    , NULL );
+            jq->jobArr[i].seq = i;
         }
 
-        //Set the 0th position in the array to a "separator" that stops the putter
-        //looping around and overwriting entries that haven't been got
-        jq->jobArr[0].func = iejqJobSeperator;
-
-        //Positions for both put and get set to 1
-        jq->putPos = 1;
-        jq->getPos = 1;
+        jq->putPos = 0;
+        jq->getPos = 0;
         jq->ownerBlocked = false;
 
         *pJQH = jq;
@@ -311,28 +388,33 @@ void iejq_freeJobQueue(ieutThreadData_t *pThreadData, iejqJobQueueHandle_t jqh)
 {
     iejqJobQueue_t *jq = (iejqJobQueue_t *)jqh;
 
-    #ifdef IEJQ_JOBQUEUE_PUTLOCK
-    int32_t os_rc = pthread_spin_destroy(&(jq->putLock));
+    int32_t os_rc = pthread_spin_destroy(&(jq->getLock));
 
     if (UNLIKELY(os_rc != 0))
     {
         ieutTRACE_FFDC( ieutPROBE_001, true
-                , "failed destroying put lock.", os_rc
+                , "failed destroying get lock.", os_rc
                 , "JQ", jq, sizeof(iejqJobQueue_t)
                 , NULL );
     }
-    #else
-    int32_t os_rc;
-    #endif
 
-    os_rc = pthread_spin_destroy(&(jq->getLock));
+    //Free any overflow jobs that were never processed
+    iejqOverflowJob_t *job = jq->overflowDrain;
 
-    if (UNLIKELY(os_rc != 0))
+    while (job != NULL)
     {
-        ieutTRACE_FFDC( ieutPROBE_001, true
-                , "failed destroying put lock.", os_rc
-                , "JQ", jq, sizeof(iejqJobQueue_t)
-                , NULL );
+        iejqOverflowJob_t *next = job->next;
+        iemem_free(pThreadData, iemem_jobQueues, job);
+        job = next;
+    }
+
+    job = jq->overflowHead;
+
+    while (job != NULL)
+    {
+        iejqOverflowJob_t *next = job->next;
+        iemem_free(pThreadData, iemem_jobQueues, job);
+        job = next;
     }
 
     iemem_free(pThreadData, iemem_jobQueues, jq);
@@ -359,3 +441,19 @@ void iejq_recordOwnerBlocked(ieutThreadData_t *pThreadData, iejqJobQueueHandle_t
     jq->ownerBlocked = true;
 }
 
+//****************************************************************************
+/// @brief Take a copy of the statistics for a job queue
+///
+/// The statistics are updated by the consumer without locking, so the copy
+/// may be slightly inconsistent if the queue is being drained.
+///
+/// @param[in]     jqh              Job queue
+/// @param[out]    pStats           Copy of the statistics
+//****************************************************************************
+void iejq_getStats(iejqJobQueueHandle_t jqh, iejqJobQueueStats_t *pStats)
+{
+    iejqJobQueue_t *jq = (iejqJobQueue_t *)jqh;
+
+    *pStats = jq->stats;
+    pStats->overflowedJobs = jq->overflowedJobs;
+}
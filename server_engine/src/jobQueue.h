@@ -28,6 +28,31 @@ extern "C" {
 
 #include "engineInternal.h"
 
+//Number of slots in the lock-free ring, must be a power of 2. Jobs that don't fit
+//in the ring are added to a (growable) overflow list rather than being rejected.
+#define IEJQ_JOB_MAX 16384
+
+//Maximum number of jobs removed from a queue in one batched drain
+#define IEJQ_JOB_BATCH_MAX 64
+
+//Number of buckets in the depth and latency histograms. Bucket 0 counts
+//zero values, bucket i counts values in [2^(i-1), 2^i), and the last bucket
+//counts everything above that.
+#define IEJQ_HISTOGRAM_BUCKETS 16
+
+typedef struct tag_iejqJob_t {
+    void *func;
+    void *args;
+} iejqJob_t;
+
+typedef struct tag_iejqJobQueueStats_t {
+    uint64_t drains;                                   ///< Batched drains that found work
+    uint64_t processedJobs;                            ///< Jobs removed from the queue
+    uint64_t overflowedJobs;                           ///< Jobs that did not fit in the ring
+    uint64_t depthHistogram[IEJQ_HISTOGRAM_BUCKETS];   ///< Jobs waiting at the start of each drain
+    uint64_t latencyHistogram[IEJQ_HISTOGRAM_BUCKETS]; ///< Microseconds between put and get of each job
+} iejqJobQueueStats_t;
+
 int32_t iejq_createJobQueue(ieutThreadData_t *pThreadData, iejqJobQueueHandle_t *pJQH);
 void iejq_freeJobQueue(ieutThreadData_t *pThreadData, iejqJobQueueHandle_t jqh);
 
@@ -37,31 +62,22 @@ int32_t iejq_getJob( ieutThreadData_t *pThreadData
                    , void **pFunc
                    , void **pArgs
                    , bool takeLock);
+uint32_t iejq_getJobs( ieutThreadData_t *pThreadData
+                     , iejqJobQueueHandle_t jqh
+                     , iejqJob_t *jobs
+                     , uint32_t maxJobs);
 void iejq_takeGetLock(ieutThreadData_t *pThreadData, iejqJobQueueHandle_t jqh);
 void iejq_releaseGetLock(ieutThreadData_t *pThreadData, iejqJobQueueHandle_t jqh);
 bool iejq_tryTakeGetLock(ieutThreadData_t *pThreadData, iejqJobQueueHandle_t jqh);
 int32_t iejq_addJob( ieutThreadData_t *pThreadData
                    , iejqJobQueueHandle_t jqh
                    , void *func
-                   , void *args
-#ifdef IEJQ_JOBQUEUE_PUTLOCK
-                   , bool takeLock);
-#else
-                   );
-#endif
-
-#ifdef IEJQ_JOBQUEUE_PUTLOCK
-void iejq_takePutLock(ieutThreadData_t *pThreadData, iejqJobQueueHandle_t jqh);
-void iejq_releasePutLock(ieutThreadData_t *pThreadData, iejqJobQueueHandle_t jqh);
-#endif
+                   , void *args);
 
 bool iejq_ownerBlocked(iejqJobQueueHandle_t jqh, bool resetBlockedFlag);
 void iejq_recordOwnerBlocked(ieutThreadData_t *pThreadData, iejqJobQueueHandle_t jqh);
 
-
-//Can't actually use all jobs (1 reserved for separator)
-#define IEJQ_JOB_MAX 32768
-
+void iejq_getStats(iejqJobQueueHandle_t jqh, iejqJobQueueStats_t *pStats);
 
 #ifdef __cplusplus
 }
@@ -70,5 +86,5 @@ void iejq_recordOwnerBlocked(ieutThreadData_t *pThreadData, iejqJobQueueHandle_t
 #endif /* __ISM_ENGINE_JOBQUEUE_DEFINED */
 
 /*********************************************************************/
-/* End of intermediateQ.h                                            */
+/* End of jobQueue.h                                                 */
 /*********************************************************************/
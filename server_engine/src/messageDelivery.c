@@ -36,39 +36,17 @@
 static void scheduleRestartMessageDelivery( ieutThreadData_t *pThreadData
                                           , ismEngine_Session_t *pSession);
 
-// Callback from destination when a message is being delivered
-bool ism_engine_deliverMessage(ieutThreadData_t *pThreadData,
-                               ismEngine_Consumer_t *pConsumer,
-                               void *pDelivery,
-                               ismEngine_Message_t *pMessage,
-                               ismMessageHeader_t *pMsgHdr,
-                               ismMessageState_t messageState,
-                               uint32_t deliveryId,
-                               ismEngine_DelivererContext_t * delivererContext)
+//Do a basic expiry check before we call the protocol layer. We only expire messages that have never
+//been delivered as some protocols (e.g. MQTT) are forward only and once we have sent it, it should
+//not be expired before the client says so. For other protocols (JMS) where we can expire messages
+//that have previously been delivered we need to do the expiry in the protocol
+//Returns true if the message had expired (and so has been dealt with)
+static inline bool expireUndeliveredMessage(ieutThreadData_t *pThreadData,
+                                            ismEngine_Consumer_t *pConsumer,
+                                            void *pDelivery,
+                                            ismEngine_Message_t *pMessage,
+                                            ismMessageHeader_t *pMsgHdr)
 {
-    bool reenableWaiter = true;
-    ismEngine_DeliveryHandle_t hDeliveryHandle;
-
-    ieutTRACEL(pThreadData, pDelivery, ENGINE_CEI_TRACE, FUNCTION_ENTRY "(hConsumer %p, hDelivery %p, hMessage %p, Reliability %d, messageState %d, deliveryId %u, Length=%ld)\n",
-               __func__, pConsumer, pDelivery, pMessage, pMessage->Header.Reliability, messageState, deliveryId, pMessage->MsgLength);
-
-#if 0
-    for (int i=0; i < pMessage->AreaCount; i++)
-    {
-        ieutTRACEL(pThreadData, pMessage->AreaLengths[i], ENGINE_HIGH_TRACE,
-                   "MSGDETAILS(deliver): Area(%d) Type(%d) Length(%ld) Data(%.*s)\n",
-                   i,
-                   pMessage->AreaTypes[i],
-                   pMessage->AreaLengths[i],
-                   (pMessage->AreaLengths[i] > 100)?100:pMessage->AreaLengths[i],
-                   (pMessage->AreaTypes[i] == ismMESSAGE_AREA_PAYLOAD)?pMessage->pAreaData[i]:"");
-    }
-#endif
-
-    //Do a basic expiry check before we call the protocol layer. We only expire messages that have never
-    //been delivered as some protocols (e.g. MQTT) are forward only and once we have sent it, it should
-    //not be expired before the client says so. For other protocols (JMS) where we can expire messages
-    //that have previously been delivered we need to do the expiry in the protocol
     bool expired =  (    (pMsgHdr->Expiry != 0)
                       && (pMsgHdr->RedeliveryCount == 0)
                       && (pMsgHdr->Expiry < ism_common_nowExpire()));
@@ -101,23 +79,75 @@ bool ism_engine_deliverMessage(ieutThreadData_t *pThreadData,
                               , pConsumer->queueHandle);
         }
         ism_engine_releaseMessage((ismEngine_MessageHandle_t)pMessage);
-        return true;
+    }
+
+    return expired;
+}
+
+//Record how long the message took to get from its creation to its first delivery
+static inline void recordPutToDeliveryLatency(ieutThreadData_t *pThreadData,
+                                              ismEngine_Message_t *pMessage,
+                                              ismMessageHeader_t *pMsgHdr)
+{
+    if (pMsgHdr->RedeliveryCount == 0)
+    {
+        ieut_recordLatencySince(pThreadData, ieutLATENCY_PUT_TO_DELIVERY, pMessage->putTimestamp);
+    }
+}
+
+static inline ismEngine_DeliveryHandle_t makeDeliveryHandle(ismEngine_Consumer_t *pConsumer,
+                                                            void *pDelivery)
+{
+    ismEngine_DeliveryHandle_t hDeliveryHandle;
+
+    if (pDelivery)
+    {
+        ismEngine_DeliveryInternal_t hTempHandle = { .Parts = { pConsumer->queueHandle, pDelivery } };
+
+        hDeliveryHandle = hTempHandle.Full;
     }
     else
     {
-        if (pDelivery)
-        {
-            ismEngine_DeliveryInternal_t hTempHandle = { .Parts = { pConsumer->queueHandle, pDelivery } };
+        hDeliveryHandle = ismENGINE_NULL_DELIVERY_HANDLE;
+    }
 
-            hDeliveryHandle = hTempHandle.Full;
-        }
-        else
-        {
-            hDeliveryHandle = ismENGINE_NULL_DELIVERY_HANDLE;
-        }
+    return hDeliveryHandle;
+}
+
+// Callback from destination when a message is being delivered
+bool ism_engine_deliverMessage(ieutThreadData_t *pThreadData,
+                               ismEngine_Consumer_t *pConsumer,
+                               void *pDelivery,
+                               ismEngine_Message_t *pMessage,
+                               ismMessageHeader_t *pMsgHdr,
+                               ismMessageState_t messageState,
+                               uint32_t deliveryId,
+                               ismEngine_DelivererContext_t * delivererContext)
+{
+    bool reenableWaiter = true;
+
+    ieutTRACEL(pThreadData, pDelivery, ENGINE_CEI_TRACE, FUNCTION_ENTRY "(hConsumer %p, hDelivery %p, hMessage %p, Reliability %d, messageState %d, deliveryId %u, Length=%ld)\n",
+               __func__, pConsumer, pDelivery, pMessage, pMessage->Header.Reliability, messageState, deliveryId, pMessage->MsgLength);
+
+#if 0
+    for (int i=0; i < pMessage->AreaCount; i++)
+    {
+        ieutTRACEL(pThreadData, pMessage->AreaLengths[i], ENGINE_HIGH_TRACE,
+                   "MSGDETAILS(deliver): Area(%d) Type(%d) Length(%ld) Data(%.*s)\n",
+                   i,
+                   pMessage->AreaTypes[i],
+                   pMessage->AreaLengths[i],
+                   (pMessage->AreaLengths[i] > 100)?100:pMessage->AreaLengths[i],
+                   (pMessage->AreaTypes[i] == ismMESSAGE_AREA_PAYLOAD)?pMessage->pAreaData[i]:"");
+    }
+#endif
+
+    if (!expireUndeliveredMessage(pThreadData, pConsumer, pDelivery, pMessage, pMsgHdr))
+    {
+        recordPutToDeliveryLatency(pThreadData, pMessage, pMsgHdr);
 
         reenableWaiter = pConsumer->pMsgCallbackFn(pConsumer,
-                                                   hDeliveryHandle,
+                                                   makeDeliveryHandle(pConsumer, pDelivery),
                                                    (ismEngine_MessageHandle_t)pMessage,
                                                    deliveryId,
                                                    messageState,
@@ -136,6 +166,102 @@ bool ism_engine_deliverMessage(ieutThreadData_t *pThreadData,
     return reenableWaiter;
 }
 
+// Choose how many messages to collect before calling the consumer's batch callback
+uint32_t ism_engine_chooseMessageBatchSize(ieutThreadData_t *pThreadData,
+                                           ismEngine_Consumer_t *pConsumer)
+{
+    uint32_t batchSize = pConsumer->msgBatchSize;
+
+    assert(batchSize > 0 && batchSize <= ismENGINE_MAX_MESSAGE_BATCH_SIZE);
+
+    //Don't build a batch bigger than the client has room for before it needs
+    //to ack some messages - as acks come back faster the headroom (and hence
+    //the batch) grows again.
+    if (pConsumer->fAcking && pConsumer->hMsgDelInfo != NULL)
+    {
+        uint32_t headroom = iecs_getInflightHeadroom(pConsumer->hMsgDelInfo);
+
+        if (headroom < batchSize)
+        {
+            batchSize = (headroom == 0) ? 1 : headroom;
+        }
+    }
+
+    return batchSize;
+}
+
+// Add a message to a batch being built for the consumer's batch callback
+bool ism_engine_addMessageToBatch(ieutThreadData_t *pThreadData,
+                                  ismEngine_Consumer_t *pConsumer,
+                                  void *pDelivery,
+                                  ismEngine_Message_t *pMessage,
+                                  ismMessageHeader_t *pMsgHdr,
+                                  ismMessageState_t messageState,
+                                  uint32_t deliveryId,
+                                  ismEngine_DeliveredMessage_t *pBatchEntry)
+{
+    ieutTRACEL(pThreadData, pDelivery, ENGINE_HIFREQ_FNC_TRACE, FUNCTION_IDENT "(hConsumer %p, hDelivery %p, hMessage %p, messageState %d, deliveryId %u)\n",
+               __func__, pConsumer, pDelivery, pMessage, messageState, deliveryId);
+
+    if (expireUndeliveredMessage(pThreadData, pConsumer, pDelivery, pMessage, pMsgHdr))
+    {
+        return false;
+    }
+
+    recordPutToDeliveryLatency(pThreadData, pMessage, pMsgHdr);
+
+    pBatchEntry->hDelivery    = makeDeliveryHandle(pConsumer, pDelivery);
+    pBatchEntry->hMessage     = (ismEngine_MessageHandle_t)pMessage;
+    pBatchEntry->deliveryId   = deliveryId;
+    pBatchEntry->state        = messageState;
+    pBatchEntry->msgHeader    = *pMsgHdr;
+    pBatchEntry->msgAreaCount = pMessage->AreaCount;
+    pBatchEntry->areaTypes    = pMessage->AreaTypes;
+    pBatchEntry->areaLengths  = pMessage->AreaLengths;
+    pBatchEntry->pAreaData    = pMessage->pAreaData;
+
+    return true;
+}
+
+// Give a batch of messages to the consumer's batch callback and adapt the
+// size of the next batch based on whether it wants more
+bool ism_engine_deliverMessageBatch(ieutThreadData_t *pThreadData,
+                                    ismEngine_Consumer_t *pConsumer,
+                                    uint32_t messageCount,
+                                    ismEngine_DeliveredMessage_t *pMessages,
+                                    ismEngine_DelivererContext_t * delivererContext)
+{
+    ieutTRACEL(pThreadData, messageCount, ENGINE_CEI_TRACE, FUNCTION_ENTRY "(hConsumer %p, messageCount %u, msgBatchSize %u)\n",
+               __func__, pConsumer, messageCount, pConsumer->msgBatchSize);
+
+    assert(messageCount > 0 && messageCount <= ismENGINE_MAX_MESSAGE_BATCH_SIZE);
+
+    bool reenableWaiter = pConsumer->pMsgBatchCallbackFn(pConsumer,
+                                                         pConsumer->DestinationOptions,
+                                                         messageCount,
+                                                         pMessages,
+                                                         pConsumer->pMsgCallbackContext,
+                                                         delivererContext);
+
+    //The consumer is locked (delivering) so we are the only updater of msgBatchSize
+    if (!reenableWaiter)
+    {
+        //Protocol pushed back (e.g. the send queue is full) - back off quickly
+        pConsumer->msgBatchSize = (pConsumer->msgBatchSize > 1) ? pConsumer->msgBatchSize >> 1 : 1;
+    }
+    else if (messageCount >= pConsumer->msgBatchSize)
+    {
+        //A full batch went through without any pushback - try a bigger one
+        pConsumer->msgBatchSize = (pConsumer->msgBatchSize < (ismENGINE_MAX_MESSAGE_BATCH_SIZE >> 1))
+                                         ? pConsumer->msgBatchSize << 1 : ismENGINE_MAX_MESSAGE_BATCH_SIZE;
+    }
+
+    ieutTRACEL(pThreadData, reenableWaiter, ENGINE_CEI_TRACE,
+               FUNCTION_EXIT "reenableWaiter='%s' msgBatchSize=%u\n", __func__,
+               reenableWaiter ? "true" : "false", pConsumer->msgBatchSize);
+    return reenableWaiter;
+}
+
 
 
 // Callback from destination when delivery status changes, such as
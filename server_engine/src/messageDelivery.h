@@ -43,6 +43,28 @@ bool ism_engine_deliverMessage(ieutThreadData_t *pThreadData,
                                uint32_t deliveryId,
                                ismEngine_DelivererContext_t * delivererContext );
 
+// Choose how many messages to collect before calling the consumer's batch callback
+uint32_t ism_engine_chooseMessageBatchSize(ieutThreadData_t *pThreadData,
+                                           ismEngine_Consumer_t *pConsumer);
+
+// Add a message to a batch being built for the consumer's batch callback,
+// returns false if the message had expired (and so was not added)
+bool ism_engine_addMessageToBatch(ieutThreadData_t *pThreadData,
+                                  ismEngine_Consumer_t *pConsumer,
+                                  void *pDelivery,
+                                  ismEngine_Message_t *pMessage,
+                                  ismMessageHeader_t *pMsgHdr,
+                                  ismMessageState_t messageState,
+                                  uint32_t deliveryId,
+                                  ismEngine_DeliveredMessage_t *pBatchEntry);
+
+// Callback from destination when a batch of messages is being delivered
+bool ism_engine_deliverMessageBatch(ieutThreadData_t *pThreadData,
+                                    ismEngine_Consumer_t *pConsumer,
+                                    uint32_t messageCount,
+                                    ismEngine_DeliveredMessage_t *pMessages,
+                                    ismEngine_DelivererContext_t * delivererContext);
+
 // Callback from destination when delivery status changes, such as
 // an empty destination or disabling a waiter
 void ism_engine_deliverStatus(ieutThreadData_t *pThreadData,
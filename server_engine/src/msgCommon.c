@@ -240,6 +240,7 @@ int32_t iem_createMessageCopy(ieutThreadData_t *pThreadData,
         pNewMessage->AreaCount = pMessage->AreaCount;
         pNewMessage->Flags = pMessage->Flags & ~ismENGINE_MSGFLAGS_ALLOCTYPE_1;
         pNewMessage->MsgLength = NewMessageLength;
+        pNewMessage->putTimestamp = pMessage->putTimestamp;
         pNewMessage->resourceSet = iereNO_RESOURCE_SET;
         pNewMessage->fullMemSize = (int64_t)iere_full_size(iemem_messageBody, pNewMessage);
         for (int32_t i = 0; i < pMessage->AreaCount; i++)
@@ -287,6 +287,32 @@ iemqCursor_t IEMQ_GETCURSOR_SEARCHING = { .c = { IEMQ_ORDERID_PAST_TAIL, NULL }
 // find any of this allocation type and update the stats to include them.
 #define IEMQ_MESSAGE_BYTES(_pMsg) (((_pMsg)->Flags & ismENGINE_MSGFLAGS_ALLOCTYPE_1) ? 0 : (_pMsg)->MsgLength)
 
+///////////////////////////////////////////////////////////////////////////////
+///  @brief
+///    Choose how many nodes a getter claims per trip through the getlock
+///  @remarks
+///    Consumers on shared subscriptions don't need strict ordering across
+///    consumers, so they can claim several messages each time they move the
+///    get cursor (Engine.SharedSubDeliveryClaimSize).
+///
+///  @param[in]  QOptions          - Options of the queue
+///  @return                       - The claim size (1 = strict queue order)
+///////////////////////////////////////////////////////////////////////////////
+static inline uint32_t iemq_chooseDeliveryClaimSize(ieqOptions_t QOptions)
+{
+    uint32_t claimSize = 1;
+
+    if (   ((QOptions & ieqOptions_SUBSCRIPTION_QUEUE) != 0)
+        && ((QOptions & ieqOptions_SINGLE_CONSUMER_ONLY) == 0)
+        && (ismEngine_serverGlobal.sharedSubDeliveryClaim > 1))
+    {
+        claimSize = (ismEngine_serverGlobal.sharedSubDeliveryClaim < IEMQ_MAXDELIVERYCLAIM_SIZE)
+                          ? ismEngine_serverGlobal.sharedSubDeliveryClaim : IEMQ_MAXDELIVERYCLAIM_SIZE;
+    }
+
+    return claimSize;
+}
+
 /// @{
 /// @name External Functions
 
@@ -564,6 +590,8 @@ int32_t iemq_createQ( ieutThreadData_t *pThreadData
     Q->preDeleteCount = 1; //The initial +1 is decremented when delete is requested....
     Q->checkWaitersVal = 1; // Force all consumers to initially assume msgs are available
 
+    Q->deliveryClaimSize = iemq_chooseDeliveryClaimSize(QOptions);
+
     //Need to update acklist if messages can have acks and the
     //queue won't be destroyed when the consumer disconnects...
     if (   ((QOptions & (ieqOptions_IN_RECOVERY|ieqOptions_IMPORTING)) == 0)
@@ -5140,7 +5168,7 @@ static inline void iemq_destroyMessageBatch( ieutThreadData_t *pThreadData,
         ismEngine_AsyncDataEntry_t asyncArray[IEAD_MAXARRAYENTRIES] = {
                 {ismENGINE_ASYNCDATAENTRY_STRUCID, iemqQueueDestroyMessageBatch1,  discardNodes,  batchSize*sizeof(iemqQNode_t *), NULL, {.internalFn = iemq_asyncDestroyMessageBatch } },
                 {ismENGINE_ASYNCDATAENTRY_STRUCID, iemqQueueDestroyMessageBatch2,  &asyncBatchData,   sizeof(asyncBatchData),     NULL, {.internalFn = iemq_asyncDestroyMessageBatch }}};
-        ismEngine_AsyncData_t asyncData = {ismENGINE_ASYNCDATA_STRUCID, NULL, IEAD_MAXARRAYENTRIES, 2, 0, true,  0, 0, asyncArray};
+        ismEngine_AsyncData_t asyncData = {ismENGINE_ASYNCDATA_STRUCID, NULL, IEAD_MAXARRAYENTRIES, 2, 0, true,  0, 0, 0, asyncArray};
 
         // We need to commit the removal of the reference before we can call iest_unstoreMessage (in case we reduce the usage
         // count to 1, some else decreases it to 0 and commits but we don't commit our transaction. On restart we'd point to a message
@@ -6604,6 +6632,9 @@ void  iemq_prepareAck( ieutThreadData_t *pThreadData
     {
         if (options == ismENGINE_CONFIRM_OPTION_CONSUMED)
         {
+            ieut_recordLatencySince(pThreadData, ieutLATENCY_DELIVERY_TO_ACK, pnode->deliveryTimestamp);
+            pnode->deliveryTimestamp = 0;
+
             iemq_prepareConsumeAck( pThreadData
                                   , Q
                                   , pSession
@@ -7854,7 +7885,7 @@ static inline int32_t iemq_postTranPutWork( ieutThreadData_t *pThreadData
          };
          ismEngine_AsyncData_t asyncData = {ismENGINE_ASYNCDATA_STRUCID
                  , (pTran->pSession!= NULL) ? pTran->pSession->pClient : NULL
-                         , IEAD_MAXARRAYENTRIES, 2, 0, true, 0, 0, asyncArray};
+                         , IEAD_MAXARRAYENTRIES, 2, 0, true, 0, 0, 0, asyncArray};
 
 #if 0
          //Adjust Tran so this SLE is not called again in this phase if we go async
@@ -8295,6 +8326,7 @@ int32_t iemq_updateProperties( ieutThreadData_t *pThreadData
         }
 
         Q->QOptions = QOptions;
+        Q->deliveryClaimSize = iemq_chooseDeliveryClaimSize(QOptions);
     }
 
     // If the queue store information has changed, update the QPR in the store.
@@ -9619,15 +9651,21 @@ mod_exit:
 ///    the next message to be delivered (according to the get cursor) and updates
 ///    the cursor to point at the next message.
 ///
+///    If pClaimed->claimLimit is non-zero, up to that many subsequent gettable
+///    nodes are also marked delivered and returned in pClaimed so that the
+///    caller can use them without coming back to the getlock.
+///
 ///  @param[in]  Q                 - Queue to get the message from
 ///  @param[in]  pConsumer         - Receiver for the message
 ///  @param[out] ppnode            - On successful completion, a pointer to
+///  @param[out] pClaimed          - Additional nodes claimed for the consumer
 ///  @return                       - OK on success or an ISMRC error code
 ///////////////////////////////////////////////////////////////////////////////
 static inline int32_t iemq_locateMessageForGetter( ieutThreadData_t *pThreadData
                                                  , iemqQueue_t *Q
                                                  , ismEngine_Consumer_t *pConsumer
-                                                 , iemqQNode_t **ppnode)
+                                                 , iemqQNode_t **ppnode
+                                                 , iemqClaimedNodes_t *pClaimed)
 {
     int32_t rc = OK;
     int32_t os_rc = 0;
@@ -9722,6 +9760,40 @@ static inline int32_t iemq_locateMessageForGetter( ieutThreadData_t *pThreadData
             // We succesfully updates the get cursor, which means we can
             // return the node to the caller.
             *ppnode = node;
+
+            //Whilst we have the getlock, claim any immediately following
+            //messages the caller has room for - exactly as if they'd called
+            //us again, but without the trip through the getlock
+            assert(pClaimed->nextNode == pClaimed->numNodes);
+            pClaimed->numNodes = 0;
+            pClaimed->nextNode = 0;
+
+            while (pClaimed->numNodes < pClaimed->claimLimit)
+            {
+                iemqQNode_t *claimNode = subsequentNode;
+
+                if (iemq_markMessageIfGettable( pThreadData, Q, claimNode, &subsequentNode) != OK)
+                {
+                    break;
+                }
+
+                if (!iemq_updateGetCursor(pThreadData, Q, claimNode->orderId, subsequentNode))
+                {
+                    //The get cursor has been rewound, let this one go and stop claiming
+                    //(whoever rewound it will call checkWaiters)
+                    claimNode->msgState = ismMESSAGE_STATE_AVAILABLE;
+                    break;
+                }
+
+                pClaimed->nodes[pClaimed->numNodes++] = claimNode;
+            }
+
+            if (pClaimed->numNodes != 0)
+            {
+                ieutTRACEL(pThreadData, pClaimed->numNodes, ENGINE_HIFREQ_FNC_TRACE,
+                           "Q %u claimed %u further messages after oId %lu\n",
+                           Q->qId, pClaimed->numNodes, node->orderId);
+            }
         }
         else
         {
@@ -10655,6 +10727,8 @@ static inline int32_t iemq_initialPrepareMessageForDelivery( ieutThreadData_t
         if (   (newMsgState == ismMESSAGE_STATE_DELIVERED)
             || (newMsgState == ismMESSAGE_STATE_RECEIVED))
         {
+            pnode->deliveryTimestamp = ieut_latencyTimestamp();
+
             //If this consumer wants a 16bit deliveryid unique in client scope (a la MQTT) assign it now
             if (pConsumer->fShortDeliveryIds)
             {
@@ -10900,6 +10974,7 @@ static inline int32_t iemq_locateMessage(
     ieutThreadData_t *pThreadData,
     iemqQueue_t *Q,
     ismEngine_Consumer_t *pConsumer,
+    iemqClaimedNodes_t *pClaimed,
     iemqQNode_t **ppNode,
     ismMessageState_t *pOrigMsgState)
 {
@@ -10949,9 +11024,15 @@ static inline int32_t iemq_locateMessage(
             {
                 rc = iemq_locateMessageForSelector(pThreadData, Q, pConsumer, &pnode);
             }
+            else if (pClaimed->nextNode < pClaimed->numNodes)
+            {
+                //Use a node we claimed last time we had the getlock
+                pnode = pClaimed->nodes[pClaimed->nextNode++];
+                rc = OK;
+            }
             else
             {
-                rc = iemq_locateMessageForGetter(pThreadData, Q, pConsumer, &pnode);
+                rc = iemq_locateMessageForGetter(pThreadData, Q, pConsumer, &pnode, pClaimed);
             }
             if (rc == OK)
             {
@@ -11379,6 +11460,11 @@ static uint32_t iemq_deliverMessages( ieutThreadData_t *pThreadData
 
     bool wantsMoreMessages = true;
 
+    //If the consumer takes messages in batches, we collect them here and hand
+    //them over whenever the batch is full or we are about to leave the loop below
+    bool fBatchDelivery = (pConsumer->pMsgBatchCallbackFn != NULL);
+    ismEngine_DeliveredMessage_t msgBatch[ismENGINE_MAX_MESSAGE_BATCH_SIZE];
+
     do
     {
         loopAgain = false;
@@ -11388,6 +11474,9 @@ static uint32_t iemq_deliverMessages( ieutThreadData_t *pThreadData
         bool completeWaiterActions = false;
         bool needStoreCommit       = false;
 
+        uint32_t msgBatchCount = 0;
+        uint32_t msgBatchLimit = fBatchDelivery ? ism_engine_chooseMessageBatchSize(pThreadData, pConsumer) : 1;
+
         while (wantsMoreMessages &&  !needStoreCommit && (msgsDelivered <  pDeliveryData->usedNodes))
         {
             iemqQNode_t *pnode =  pDeliveryData->perNodeInfo[msgsDelivered].node;
@@ -11413,15 +11502,57 @@ static uint32_t iemq_deliverMessages( ieutThreadData_t *pThreadData
             assert(
                   ((pConsumer->iemqWaiterStatus) & (IEWS_WAITERSTATUSMASK_LOCKED & (~(IEWS_WAITERSTATUS_GETTING|IEWS_WAITERSTATUS_DISABLED_LOCKEDWAIT)))) != 0);
 
-            wantsMoreMessages = ism_engine_deliverMessage(
-                                          pThreadData,
-                                          pConsumer,
-                                          pnodeDelivery,
-                                          hmsg,
-                                          &msgHdr,
-                                          newState,
-                                          deliveryId,
-                                          delivererContext);
+            if (fBatchDelivery)
+            {
+                if (ism_engine_addMessageToBatch( pThreadData
+                                                , pConsumer
+                                                , pnodeDelivery
+                                                , hmsg
+                                                , &msgHdr
+                                                , newState
+                                                , deliveryId
+                                                , &msgBatch[msgBatchCount]))
+                {
+                    msgBatchCount++;
+                }
+            }
+            else
+            {
+                wantsMoreMessages = ism_engine_deliverMessage(
+                                              pThreadData,
+                                              pConsumer,
+                                              pnodeDelivery,
+                                              hmsg,
+                                              &msgHdr,
+                                              newState,
+                                              deliveryId,
+                                              delivererContext);
+            }
+
+            msgsDelivered++;
+
+            if (pThreadData->numLazyMsgs == ieutMAXLAZYMSGS)
+            {
+                needStoreCommit = true;
+            }
+
+            //Hand over the batch if it is full or this is the last time round the loop
+            //(we only stop wanting messages as a result of handing over a batch)
+            if (    (msgBatchCount != 0)
+                 && (    (msgBatchCount == msgBatchLimit)
+                      || needStoreCommit
+                      || (msgsDelivered == pDeliveryData->usedNodes)))
+            {
+                wantsMoreMessages = ism_engine_deliverMessageBatch(
+                                              pThreadData,
+                                              pConsumer,
+                                              msgBatchCount,
+                                              msgBatch,
+                                              delivererContext);
+
+                msgBatchCount = 0;
+                msgBatchLimit = ism_engine_chooseMessageBatchSize(pThreadData, pConsumer);
+            }
 
             if (!wantsMoreMessages)
             {
@@ -11434,15 +11565,10 @@ static uint32_t iemq_deliverMessages( ieutThreadData_t *pThreadData
                 //We need to call delivery callback etc...
                 completeWaiterActions = true;
             }
-
-            msgsDelivered++;
-
-            if (pThreadData->numLazyMsgs == ieutMAXLAZYMSGS)
-            {
-                needStoreCommit = true;
-            }
         }
 
+        assert(msgBatchCount == 0);
+
         if (wantsMoreMessages && (msgsDelivered == pDeliveryData->usedNodes))
         {
 
@@ -11896,9 +12022,6 @@ static bool iemq_scheduleOnJobThreadIfPoss(ieutThreadData_t *pThreadData,
                                     , pJobThread->jobQueue
                                     , iemq_jobDiscardExpiryCheckWaiters
                                     , jobData
-#ifdef IEJQ_JOBQUEUE_PUTLOCK
-                                    , true
-#endif
                                     );
 
             if (rc == OK)
@@ -12042,6 +12165,8 @@ static inline uint32_t iemq_chooseDeliveryBatchSizeFromMaxInflight(uint32_t maxI
 ///  @param[inout] msgsLeftInBatch - On input:  1 if this is the last message in this batch
 ///                                  On output: Set to 0 if this should be the last message in batc
 ///                                             (otherwise 1 less than the input value)
+///  @param[out] pPutBackNodes     - Set to true if messages claimed but not delivered were put
+///                                  back on the queue (otherwise unchanged)
 ///
 ///  @return OK
 ///          or ISMRC_NoMsgAvail (no more messages are available for any waiter)
@@ -12051,7 +12176,8 @@ static inline int32_t iemq_locateAndDeliverMessageBatchToWaiter(
                                   ieutThreadData_t *pThreadData,
                                   iemqQueue_t *Q,
                                   ismEngine_Consumer_t *pConsumer,
-                                  ismEngine_AsyncData_t *asyncInfo)
+                                  ismEngine_AsyncData_t *asyncInfo,
+                                  bool *pPutBackNodes)
 {
 
     //waiter should be in getting (or other threads can have added flags)
@@ -12090,7 +12216,8 @@ static inline int32_t iemq_locateAndDeliverMessageBatchToWaiter(
         goto mod_exit;
     }
 
-    uint32_t maxBatchSize = 32;
+    //Consumers that take messages in batches are given enough nodes to fill their largest batch
+    uint32_t maxBatchSize = (pConsumer->pMsgBatchCallbackFn != NULL) ? ismENGINE_MAX_MESSAGE_BATCH_SIZE : 32;
     uint32_t perClientLimit = pConsumer->pSession->pClient->maxInflightLimit;
 
     if (perClientLimit != 0)
@@ -12098,11 +12225,24 @@ static inline int32_t iemq_locateAndDeliverMessageBatchToWaiter(
         maxBatchSize = iemq_chooseDeliveryBatchSizeFromMaxInflight(perClientLimit);
     }
 
+    iemqClaimedNodes_t claimedNodes;
+    claimedNodes.numNodes = 0;
+    claimedNodes.nextNode = 0;
+
     do
     {
+        //Don't claim more nodes than will fit in this batch
+        uint32_t claimLimit = Q->deliveryClaimSize;
+        if (claimLimit > maxBatchSize - deliveryData.usedNodes)
+        {
+            claimLimit = maxBatchSize - deliveryData.usedNodes;
+        }
+        claimedNodes.claimLimit = (claimLimit > 0) ? (claimLimit - 1) : 0;
+
         rc = iemq_locateMessage( pThreadData
                                , Q
                                , pConsumer
+                               , &claimedNodes
                                , &(deliveryData.perNodeInfo[deliveryData.usedNodes].node)
                                , &(deliveryData.perNodeInfo[deliveryData.usedNodes].origMsgState));
 
@@ -12156,6 +12296,13 @@ static inline int32_t iemq_locateAndDeliverMessageBatchToWaiter(
     }
     while(rc == OK  && continueBatch && deliveryData.usedNodes < maxBatchSize);
 
+    //Put back any nodes we claimed but didn't get to use
+    while (claimedNodes.nextNode < claimedNodes.numNodes)
+    {
+        iemq_abortDelivery(pThreadData, Q, pConsumer,
+                           claimedNodes.nodes[claimedNodes.nextNode++]);
+        *pPutBackNodes = true;
+    }
 
     ieutTRACE_HISTORYBUF(pThreadData, rc);
 
@@ -12650,6 +12797,7 @@ int32_t iemq_checkWaiters( ieutThreadData_t *pThreadData
     do
     {
         loopAgain = true;
+        bool putBackNodes = false;
         ismEngine_Consumer_t *pConsumer = NULL;
 
         rc = iemq_lockWillingWaiter(pThreadData, Q,
@@ -12685,7 +12833,8 @@ int32_t iemq_checkWaiters( ieutThreadData_t *pThreadData
              rc = iemq_locateAndDeliverMessageBatchToWaiter( pThreadData
                                                            , Q
                                                            , pConsumer
-                                                           , asyncInfo);
+                                                           , asyncInfo
+                                                           , &putBackNodes);
 
             if (rc == ISMRC_NoMsgAvail)
             {
@@ -12693,6 +12842,17 @@ int32_t iemq_checkWaiters( ieutThreadData_t *pThreadData
                 loopAgain = false;
                 rc = OK;
             }
+
+            //Messages the consumer claimed but didn't use are available again, but other waiters
+            //may have looked at the queue whilst they were claimed, so check the waiters again
+            if (putBackNodes)
+            {
+                if ((Q->numBrowsingWaiters > 0) || (Q->numSelectingWaiters > 0))
+                {
+                    __sync_add_and_fetch(&(Q->checkWaitersVal), 1);
+                }
+                loopAgain = true;
+            }
         }
         else if (rc == ISMRC_NoAvailWaiter)
         {
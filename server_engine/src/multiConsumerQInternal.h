@@ -51,6 +51,7 @@ typedef struct tag_iemqQNode_t
    uint8_t                         msgFlags;          ///< Message flags
    bool                            inStore;           ///< Persisted in store
    bool                            deleteAckInFlight; ///< We are processing an ack for this node after queue has been deleted
+   uint32_t                        deliveryTimestamp; ///< Latency timestamp of last delivery (0 if not recorded)
    uint64_t                        orderId;           ///< Order id
    ismEngine_Message_t             *msg;              ///< Pointer to msg
    ismStore_Handle_t               hMsgRef;           ///< Store reference to msg on queue
@@ -156,6 +157,7 @@ typedef struct tag_iemqQueue_t
     bool deletionRemovesStoreObjects;                 ///< When we complete deletion, should we remove it from the store
     bool deletionCompleted;                           ///< Has completeDeletion been called for this queue
     uint32_t freezeHeadCleanupOps;                    ///< How many things are in progress that prevent us freeing pages from the queue
+    uint32_t deliveryClaimSize;                       ///< Max nodes a getter claims per trip through the getlock (1 = strict queue order)
 
     //  Queue Head - Pointers to the oldest message on the queue
     // To access these values then the 'headlock' spinlock must be owned
@@ -230,6 +232,7 @@ typedef struct tag_iemqQueue_t
     iedm_describeMember(bool,                    isDeleted);\
     iedm_describeMember(bool,                    deletionRemovesStoreObjects);\
     iedm_describeMember(bool,                    deletionCompleted);\
+    iedm_describeMember(uint32_t,                deliveryClaimSize);\
     iedm_describeMember(pthread_rwlock_t,        headlock);\
     iedm_describeMember(iemqQNodePage_t *,       headPage);\
     iedm_describeMember(uint64_t,                deletedStoreRefCount);\
@@ -311,6 +314,16 @@ typedef struct tag_iemqAsyncMessageDeliveryInfoPerNode_t {
     ismMessageState_t    origMsgState;
 } iemqAsyncMessageDeliveryInfoPerNode_t;
 
+/// @brief Nodes claimed by a getter in one trip through the getlock that
+///        have not yet been added to its delivery batch
+#define IEMQ_MAXDELIVERYCLAIM_SIZE 64
+typedef struct tag_iemqClaimedNodes_t {
+    uint32_t              claimLimit;   ///< How many extra nodes the next locate may claim
+    uint32_t              numNodes;     ///< Number of nodes claimed
+    uint32_t              nextNode;     ///< Next claimed node to hand out
+    iemqQNode_t          *nodes[IEMQ_MAXDELIVERYCLAIM_SIZE];
+} iemqClaimedNodes_t;
+
 #define IEMQ_MAXDELIVERYBATCH_SIZE 2048
 typedef struct tag_iemqAsyncMessageDeliveryInfo_t {
     char                   StructId[4];
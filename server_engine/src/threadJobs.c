@@ -35,7 +35,7 @@ void *ietj_scavengerThread(void *arg, void * context, int value);
 /// @param[in]     queueOwner       Is this being called by the owner of the queue?
 ///                                   (If the owner can't get the lock, we ask the scavenger not to check so often)
 /// @param[in]     mustDo           Whether we must do the work
-/// @param[in]     maxJobs          Max jobs we'll process before retr
+/// @param[in]     maxJobs          Max jobs we'll process before returning (0 = no limit)
 ///
 /// @return Whether any jobs were found
 //****************************************************************************
@@ -82,26 +82,33 @@ static bool ietj_processJobQueue_internal(ieutThreadData_t *pThreadData,
         }
     }
 
-    ietjCallback_t callbackFunction;
-    void *callbackArgs;
+    iejqJob_t jobs[IEJQ_JOB_BATCH_MAX];
+    uint32_t jobsFound;
 
     uint8_t prevTrcLevel = pThreadData->componentTrcLevel;
 
-    while(iejq_getJob(pThreadData,
-                      jobQueue,
-                      (void **)&callbackFunction,
-                      (void **)&callbackArgs,
-                      false) == OK)
+    do
     {
-        callbackFunction(pThreadData, callbackArgs);
-        callsMade++;
+        uint32_t batchSize = IEJQ_JOB_BATCH_MAX;
 
-        if (    (maxJobs != 0)
-             && (callsMade >= maxJobs))
+        if ((maxJobs != 0) && (maxJobs - callsMade < batchSize))
         {
-            break;
+            batchSize = (uint32_t)(maxJobs - callsMade);
         }
+
+        jobsFound = iejq_getJobs(pThreadData, jobQueue, jobs, batchSize);
+
+        for (uint32_t i = 0; i < jobsFound; i++)
+        {
+            ietjCallback_t callbackFunction = (ietjCallback_t)jobs[i].func;
+
+            callbackFunction(pThreadData, jobs[i].args);
+        }
+
+        callsMade += jobsFound;
     }
+    while (   (jobsFound != 0)
+           && ((maxJobs == 0) || (callsMade < maxJobs)));
 
     pThreadData->componentTrcLevel = prevTrcLevel;
 
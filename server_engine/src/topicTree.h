@@ -68,6 +68,41 @@ typedef struct tag_iettSubscriberList_t
     bool                       requestSelection;       ///< Subscribers are using some form of selection (NO_LOCAL or MESSAGE_SELECTION)
 } iettSubscriberList_t;
 
+//****************************************************************************
+/// @brief A subscription value in a selection index
+//****************************************************************************
+typedef struct tag_iettSelectionKey_t
+{
+    uint32_t                   hash;                   ///< Hash of the value
+    uint32_t                   valueLength;            ///< Length of the value
+    const char                *value;                  ///< The value (points into the subscription's selection rule)
+    ismEngine_Subscription_t  *subscription;           ///< Subscription whose selector requires this value
+} iettSelectionKey_t;
+
+//****************************************************************************
+/// @brief Per-thread index of the subscriptions in a subscriber list
+///
+/// Subscriptions whose selector requires a message property to have one of a set
+/// of string values are indexed by those values, so that a publish only evaluates
+/// the selectors of subscriptions which could match the message.
+//****************************************************************************
+typedef struct tag_iettSelectionIndex_t
+{
+    char                       StrucId[4];             ///< Eye catcher 'ETSX'
+    uint32_t                   subscriberCount;        ///< Count of subscribers in the indexed sublist
+    uint64_t                   publishSUV;             ///< The publishSUV of the indexed sublist
+    char                      *topicString;            ///< The topic string of the indexed sublist
+    size_t                     topicStringBufferSize;  ///< Length of the topic string buffer
+    const char                *propertyName;           ///< The property which is indexed (NULL if no index)
+    ismEngine_Subscription_t **unkeyed;                ///< Subscriptions which are not indexed
+    uint32_t                   unkeyedCount;           ///< Count of subscriptions which are not indexed
+    iettSelectionKey_t        *keys;                   ///< Indexed values sorted by hash
+    uint32_t                   keyCount;               ///< Count of indexed values
+    ismEngine_Subscription_t **candidates;             ///< NULL terminated array of candidates for a message
+} iettSelectionIndex_t;
+
+#define iettSELECTION_INDEX_STRUCID "ETSX"
+
 //****************************************************************************
 /// @brief Soft Log Entry for releasing nodes used in a transaction
 //****************************************************************************
@@ -1377,6 +1412,31 @@ void iett_updateCachedArrays(ieutThreadData_t *pThreadData,
                              iettSubscriberList_t *pSublist,
                              int32_t rc);
 
+//****************************************************************************
+/// @brief Get the subscribers which could select a message
+///
+/// @param[in]     pSublist         The subscriber list being published to
+/// @param[in]     pMessage         The message being published
+/// @param[out]    pCandidateCount  The count of candidate subscribers
+///
+/// @remark The subscriptions in the list whose selector requires a property to
+///         have a string value are indexed on this thread the first time the
+///         list is used, and again whenever the subscriptions change. Only
+///         subscriptions which are not indexed, and those indexed by the value
+///         in the message, are candidates.
+///
+///         This should be called between ism_common_startSelectCache and
+///         ism_common_endSelectCache for the message so that its properties are
+///         decoded once for the index and the selectors of the candidates.
+///
+/// @return NULL terminated array of candidate subscribers, or NULL if the whole
+///         subscriber list needs to be used.
+//****************************************************************************
+ismEngine_Subscription_t **iett_getSelectionCandidates(ieutThreadData_t *pThreadData,
+                                                       iettSubscriberList_t *pSublist,
+                                                       ismEngine_Message_t *pMessage,
+                                                       uint32_t *pCandidateCount);
+
 //****************************************************************************
 /// @brief Activate statistics gathering on the specified topic string
 ///
@@ -184,7 +184,8 @@ int32_t iett_putRetainedMessagesToSubscription(ieutThreadData_t *pThreadData,
     {
         // Need to honour selection if the subscription is using it or the policy it's using has
         // a default selection rule.
-        ismRule_t *selectionRule = subscription->selectionRule;
+        ismRule_t *selectionRule = subscription->selectionCode ? subscription->selectionCode
+                                                               : subscription->selectionRule;
         size_t selectionRuleLen = (size_t)(subscription->selectionRuleLen);
         const uint32_t subOptions = subscription->subOptions;
 
@@ -482,7 +483,8 @@ int32_t iett_putRetainedMessageToNewSubs(ieutThreadData_t *pThreadData,
 
                     // Honour selection either explicitly from the subscription, or via a default
                     // selection rule.
-                    ismRule_t *selectionRule = pSubscription->selectionRule;
+                    ismRule_t *selectionRule = pSubscription->selectionCode ? pSubscription->selectionCode
+                                                                            : pSubscription->selectionRule;
                     bool cacheThisSelectionResult;
                     size_t selectionRuleLen;
 
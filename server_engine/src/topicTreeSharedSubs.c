@@ -634,7 +634,7 @@ int32_t iett_createAdminSharedSubscription(ieutThreadData_t *pThreadData,
 
         ismEngine_AsyncData_t asyncData = {ismENGINE_ASYNCDATA_STRUCID,
                                            NULL,
-                                           IEAD_MAXARRAYENTRIES, 2, 0, true,  0, 0, asyncArray};
+                                           IEAD_MAXARRAYENTRIES, 2, 0, true,  0, 0, 0, asyncArray};
 
         rc = iett_createSubscription(pThreadData,
                                      &clientInfo,
@@ -422,6 +422,15 @@ int32_t iett_allocateSubscription(ieutThreadData_t *pThreadData,
                 ism_common_freeSelectRule(pSelectionRule);
             }
         }
+
+        /*******************************************************************/
+        /* Compile the selection rule to selection code which is used when */
+        /* publishing. If it cannot be compiled the rule is used.          */
+        /*******************************************************************/
+        if (subscription->selectionRule != NULL)
+        {
+            (void)ism_common_compileSelectCode(&subscription->selectionCode, subscription->selectionRule);
+        }
      }
 
     *ppSubscription = subscription;
@@ -716,6 +725,7 @@ mod_exit:
 
                 assert(pInfo->subscription->resourceSet == pInfo->resourceSet);
                 iere_primeThreadCache(pThreadData, resourceSet);
+                ism_common_freeSelectCode(pInfo->subscription->selectionCode);
                 iere_free(pThreadData, resourceSet, iemem_subsTree, pInfo->subscription->flatSubProperties);
                 iere_freeStruct(pThreadData, resourceSet, iemem_subsTree, pInfo->subscription, pInfo->subscription->StrucId);
             }
@@ -1505,7 +1515,7 @@ XAPI int32_t WARN_CHECKRC ism_engine_createSubscription(
 
     ismEngine_AsyncData_t asyncData = {ismENGINE_ASYNCDATA_STRUCID,
                                        pRequestingClient,
-                                       IEAD_MAXARRAYENTRIES, 2, 0, true,  0, 0, asyncArray};
+                                       IEAD_MAXARRAYENTRIES, 2, 0, true,  0, 0, 0, asyncArray};
 
     // Decide if we are creating an anonymously shared subscription or not
     if (createSubInfo.subOptions & ismENGINE_SUBSCRIPTION_OPTION_SHARED)
@@ -4299,7 +4309,8 @@ void iett_freeSubscription(ieutThreadData_t *pThreadData,
         pthread_spin_destroy(&sharedSubData->lock);
     }
 
-    // Tidy up flattened subscription properties
+    // Tidy up flattened subscription properties and selection code
+    ism_common_freeSelectCode(subscription->selectionCode);
     iere_free(pThreadData, resourceSet, iemem_subsTree, subscription->flatSubProperties);
     iere_freeStruct(pThreadData, resourceSet, iemem_subsTree, subscription, subscription->StrucId);
 
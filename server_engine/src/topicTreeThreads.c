@@ -28,6 +28,10 @@
 #include "engineInternal.h"
 #include "topicTree.h"
 #include "topicTreeInternal.h"
+#include "selector.h"
+
+static void iett_freeSelectionIndexArrays(ieutThreadData_t *pThreadData,
+                                          iettSelectionIndex_t *index);
 
 //****************************************************************************
 /// @brief Initialize the topic tree values in the per thread data structure
@@ -96,6 +100,20 @@ void iett_destroyThreadData(ieutThreadData_t *pThreadData)
         ism_common_free(ism_memory_engine_misc,pThreadData->sublist);
     }
 
+    // Free the selection index
+    if (NULL != pThreadData->selectionIndex)
+    {
+        iett_freeSelectionIndexArrays(pThreadData, pThreadData->selectionIndex);
+
+        if (NULL != pThreadData->selectionIndex->topicString)
+        {
+            iemem_free(pThreadData, iemem_subsQuery, pThreadData->selectionIndex->topicString);
+        }
+
+        iemem_free(pThreadData, iemem_subsQuery, pThreadData->selectionIndex);
+        pThreadData->selectionIndex = NULL;
+    }
+
     // Free the sublist cache hash table
     if (NULL != pThreadData->sublistCache)
     {
@@ -299,6 +317,14 @@ void iett_updateCachedArrays(ieutThreadData_t *pThreadData,
 
             pThreadData->topicStringBufferSize = 0;
 
+            // Empty the selection index
+            if (NULL != pThreadData->selectionIndex)
+            {
+                iett_freeSelectionIndexArrays(pThreadData, pThreadData->selectionIndex);
+                pThreadData->selectionIndex->subscriberCount = 0;
+                pThreadData->selectionIndex->publishSUV = 0;
+            }
+
             // Destroy the sublist cache hash table
             if (NULL != pThreadData->sublistCache)
             {
@@ -326,3 +352,355 @@ void iett_updateCachedArrays(ieutThreadData_t *pThreadData,
         }
     }
 }
+
+//****************************************************************************
+/// @brief Release the arrays of a selection index
+///
+/// @param[in]     index  The selection index
+//****************************************************************************
+static void iett_freeSelectionIndexArrays(ieutThreadData_t *pThreadData,
+                                          iettSelectionIndex_t *index)
+{
+    if (NULL != index->unkeyed)
+    {
+        iemem_free(pThreadData, iemem_subsQuery, index->unkeyed);
+        index->unkeyed = NULL;
+    }
+
+    if (NULL != index->keys)
+    {
+        iemem_free(pThreadData, iemem_subsQuery, index->keys);
+        index->keys = NULL;
+    }
+
+    if (NULL != index->candidates)
+    {
+        iemem_free(pThreadData, iemem_subsQuery, index->candidates);
+        index->candidates = NULL;
+    }
+
+    index->propertyName = NULL;
+    index->unkeyedCount = 0;
+    index->keyCount = 0;
+}
+
+//****************************************************************************
+/// @brief Generate a hash value for a selection key value
+///
+/// @param[in]     value        The value
+/// @param[in]     valueLength  The length of the value
+///
+/// @remark This is a version of the xor djb2 hashing algorithm
+///
+/// @return The hash value
+//****************************************************************************
+static inline uint32_t iett_generateSelectionKeyHash(const char *value, uint32_t valueLength)
+{
+    uint32_t keyHash = 5381;
+
+    while(valueLength-- > 0)
+    {
+        keyHash = (keyHash * 33) ^ (uint32_t)(uint8_t)*value++;
+    }
+
+    return keyHash;
+}
+
+//****************************************************************************
+/// @brief Compare two selection keys by hash (qsort callback)
+//****************************************************************************
+static int iett_compareSelectionKeys(const void *key1, const void *key2)
+{
+    uint32_t hash1 = ((const iettSelectionKey_t *)key1)->hash;
+    uint32_t hash2 = ((const iettSelectionKey_t *)key2)->hash;
+
+    return (hash1 < hash2) ? -1 : ((hash1 > hash2) ? 1 : 0);
+}
+
+#define iettMAX_SELECTION_KEY_VALUES 255 // Values in an IN list are counted in a byte
+#define iettMAX_SELECTION_KEY_NAMES  8   // Distinct property names considered for an index
+
+//****************************************************************************
+/// @brief Build the selection index for a subscriber list
+///
+/// @param[in]     index     The selection index to build
+/// @param[in]     pSublist  The subscriber list to index
+///
+/// @remark The property which most of the selectors require to have a string
+///         value is indexed. Subscriptions using any other selector, or using
+///         no selector of their own, are not indexed and are always candidates.
+///
+/// @return OK or an ISMRC_ value.
+//****************************************************************************
+static int32_t iett_buildSelectionIndex(ieutThreadData_t *pThreadData,
+                                        iettSelectionIndex_t *index,
+                                        iettSubscriberList_t *pSublist)
+{
+    int32_t rc = OK;
+    const char *values[iettMAX_SELECTION_KEY_VALUES];
+    int valueLengths[iettMAX_SELECTION_KEY_VALUES];
+    const char *names[iettMAX_SELECTION_KEY_NAMES];
+    uint32_t nameSubs[iettMAX_SELECTION_KEY_NAMES];
+    uint32_t nameValues[iettMAX_SELECTION_KEY_NAMES];
+    uint32_t nameCount = 0;
+    uint32_t bestName = 0;
+    const char *name;
+    ismEngine_Subscription_t *subscription;
+    uint32_t i;
+
+    iett_freeSelectionIndexArrays(pThreadData, index);
+
+    // Find the property most of the selectors require a value for
+    for(i=0; i<pSublist->subscriberCount; i++)
+    {
+        subscription = pSublist->subscribers[i];
+
+        if (subscription->selectionRule == NULL) continue;
+
+        int valueCount = ism_common_getSelectKey(subscription->selectionRule, NULL, &name,
+                                                 values, valueLengths, iettMAX_SELECTION_KEY_VALUES);
+
+        if (valueCount == 0) continue;
+
+        uint32_t n;
+        for(n=0; n<nameCount; n++)
+        {
+            if (strcmp(names[n], name) == 0) break;
+        }
+
+        if (n == nameCount)
+        {
+            if (nameCount == iettMAX_SELECTION_KEY_NAMES) continue;
+            names[n] = name;
+            nameSubs[n] = 0;
+            nameValues[n] = 0;
+            nameCount++;
+        }
+
+        nameSubs[n]++;
+        nameValues[n] += (uint32_t)valueCount;
+
+        if (nameSubs[n] > nameSubs[bestName]) bestName = n;
+    }
+
+    // No selectors can be indexed
+    if (nameCount == 0) goto mod_exit;
+
+    index->unkeyed = iemem_malloc(pThreadData, IEMEM_PROBE(iemem_subsQuery, 13),
+                                  (pSublist->subscriberCount+1) * sizeof(ismEngine_Subscription_t *));
+    index->candidates = iemem_malloc(pThreadData, IEMEM_PROBE(iemem_subsQuery, 14),
+                                     (pSublist->subscriberCount+1) * sizeof(ismEngine_Subscription_t *));
+    index->keys = iemem_malloc(pThreadData, IEMEM_PROBE(iemem_subsQuery, 15),
+                               nameValues[bestName] * sizeof(iettSelectionKey_t));
+
+    if (index->unkeyed == NULL || index->candidates == NULL || index->keys == NULL)
+    {
+        iett_freeSelectionIndexArrays(pThreadData, index);
+        rc = ISMRC_AllocateError;
+        ism_common_setError(rc);
+        goto mod_exit;
+    }
+
+    // Index the subscriptions by the values of the chosen property
+    for(i=0; i<pSublist->subscriberCount; i++)
+    {
+        int valueCount = 0;
+
+        subscription = pSublist->subscribers[i];
+
+        if (subscription->selectionRule != NULL)
+        {
+            valueCount = ism_common_getSelectKey(subscription->selectionRule, names[bestName], &name,
+                                                 values, valueLengths, iettMAX_SELECTION_KEY_VALUES);
+        }
+
+        if (valueCount == 0)
+        {
+            index->unkeyed[index->unkeyedCount++] = subscription;
+            continue;
+        }
+
+        for(int v=0; v<valueCount; v++)
+        {
+            // An IN list can name the same value twice, only index it once
+            int prev;
+            for(prev=0; prev<v; prev++)
+            {
+                if (valueLengths[prev] == valueLengths[v] &&
+                    memcmp(values[prev], values[v], valueLengths[v]) == 0) break;
+            }
+
+            if (prev < v) continue;
+
+            assert(index->keyCount < nameValues[bestName]);
+
+            iettSelectionKey_t *key = &index->keys[index->keyCount++];
+            key->value = values[v];
+            key->valueLength = (uint32_t)valueLengths[v];
+            key->hash = iett_generateSelectionKeyHash(key->value, key->valueLength);
+            key->subscription = subscription;
+        }
+    }
+
+    index->unkeyed[index->unkeyedCount] = NULL;
+
+    qsort(index->keys, index->keyCount, sizeof(iettSelectionKey_t), iett_compareSelectionKeys);
+
+    index->propertyName = names[bestName];
+
+mod_exit:
+
+    ieutTRACEL(pThreadData, index->keyCount, ENGINE_HIFREQ_FNC_TRACE,
+               FUNCTION_IDENT "topicString='%s' subscriberCount=%u propertyName='%s' keyCount=%u unkeyedCount=%u rc=%d\n",
+               __func__, pSublist->topicString, pSublist->subscriberCount,
+               index->propertyName ? index->propertyName : "", index->keyCount, index->unkeyedCount, rc);
+
+    return rc;
+}
+
+//****************************************************************************
+/// @brief Get the subscribers which could select a message
+///
+/// @param[in]     pSublist         The subscriber list being published to
+/// @param[in]     pMessage         The message being published
+/// @param[out]    pCandidateCount  The count of candidate subscribers
+///
+/// @return NULL terminated array of candidate subscribers, or NULL if the whole
+///         subscriber list needs to be used.
+//****************************************************************************
+ismEngine_Subscription_t **iett_getSelectionCandidates(ieutThreadData_t *pThreadData,
+                                                       iettSubscriberList_t *pSublist,
+                                                       ismEngine_Message_t *pMessage,
+                                                       uint32_t *pCandidateCount)
+{
+    iettSelectionIndex_t *index = pThreadData->selectionIndex;
+    ismEngine_Subscription_t **candidates = NULL;
+
+    // Only the sublist cached on this thread is indexed, and only if it is big enough
+    if (pSublist->usingCachedArrays == false ||
+        pSublist->publishSUV == 0 ||
+        ismEngine_serverGlobal.selectionIndexMinimum == 0 ||
+        pSublist->subscriberCount < ismEngine_serverGlobal.selectionIndexMinimum)
+    {
+        goto mod_exit;
+    }
+
+    if (index == NULL)
+    {
+        index = iemem_calloc(pThreadData, IEMEM_PROBE(iemem_subsQuery, 16), 1, sizeof(iettSelectionIndex_t));
+
+        if (index == NULL) goto mod_exit;
+
+        ismEngine_SetStructId(index->StrucId, iettSELECTION_INDEX_STRUCID);
+        pThreadData->selectionIndex = index;
+    }
+
+    // Rebuild the index if the subscriptions have changed or this is a different topic
+    if (index->publishSUV != pSublist->publishSUV ||
+        index->subscriberCount != pSublist->subscriberCount ||
+        index->topicString == NULL ||
+        strcmp(index->topicString, pSublist->topicString) != 0)
+    {
+        size_t topicStringLength = strlen(pSublist->topicString)+1;
+
+        if (topicStringLength > index->topicStringBufferSize)
+        {
+            char *newTopicString = iemem_realloc(pThreadData,
+                                                 IEMEM_PROBE(iemem_subsQuery, 17),
+                                                 index->topicString,
+                                                 topicStringLength);
+
+            if (newTopicString == NULL)
+            {
+                iett_freeSelectionIndexArrays(pThreadData, index);
+                index->publishSUV = 0;
+                goto mod_exit;
+            }
+
+            index->topicString = newTopicString;
+            index->topicStringBufferSize = topicStringLength;
+        }
+
+        memcpy(index->topicString, pSublist->topicString, topicStringLength);
+        index->publishSUV = pSublist->publishSUV;
+        index->subscriberCount = pSublist->subscriberCount;
+
+        (void)iett_buildSelectionIndex(pThreadData, index, pSublist);
+    }
+
+    if (index->propertyName == NULL) goto mod_exit;
+
+    ism_field_t field;
+
+    (void)ism_common_getSelectProperty(&pMessage->Header,
+                                       pMessage->AreaCount,
+                                       pMessage->AreaTypes,
+                                       pMessage->AreaLengths,
+                                       pMessage->pAreaData,
+                                       index->propertyName,
+                                       &field);
+
+    // Without the property no indexed selector can select the message
+    if (field.type == VT_Null)
+    {
+        candidates = index->unkeyed;
+        *pCandidateCount = index->unkeyedCount;
+    }
+    // A property which is not a string might still be selected by a conversion
+    else if (field.type == VT_String && field.val.s != NULL)
+    {
+        uint32_t valueLength = (uint32_t)strlen(field.val.s);
+        uint32_t hash = iett_generateSelectionKeyHash(field.val.s, valueLength);
+        uint32_t low = 0;
+        uint32_t high = index->keyCount;
+
+        // Find the first key with this hash
+        while (low < high)
+        {
+            uint32_t mid = low + (high-low)/2;
+
+            if (index->keys[mid].hash < hash)
+            {
+                low = mid+1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+
+        uint32_t candidateCount = index->unkeyedCount;
+
+        for(; low < index->keyCount && index->keys[low].hash == hash; low++)
+        {
+            iettSelectionKey_t *key = &index->keys[low];
+
+            if (key->valueLength == valueLength && memcmp(key->value, field.val.s, valueLength) == 0)
+            {
+                // Only copy the unkeyed subscriptions when there is a keyed one to add
+                if (candidateCount == index->unkeyedCount)
+                {
+                    memcpy(index->candidates, index->unkeyed, index->unkeyedCount * sizeof(ismEngine_Subscription_t *));
+                }
+
+                index->candidates[candidateCount++] = key->subscription;
+            }
+        }
+
+        if (candidateCount == index->unkeyedCount)
+        {
+            candidates = index->unkeyed;
+        }
+        else
+        {
+            index->candidates[candidateCount] = NULL;
+            candidates = index->candidates;
+        }
+
+        *pCandidateCount = candidateCount;
+    }
+
+mod_exit:
+
+    return candidates;
+}
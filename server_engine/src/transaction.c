@@ -1658,9 +1658,6 @@ static int32_t ietr_addJobCallback(ieutThreadData_t *pThreadData,
                             , pTran->pJobThread->jobQueue
                             , ietr_jobCallback
                             , pAsyncTranData
-#ifdef IEJQ_JOBQUEUE_PUTLOCK
-                            , true
-#endif
                             );
 
     if (rc == OK)
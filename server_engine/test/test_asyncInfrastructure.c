@@ -78,7 +78,7 @@ void test_PushAndPopCallbacks(void)
     };
 
     ismEngine_AsyncData_t asyncData = {ismENGINE_ASYNCDATA_STRUCID,
-                                       NULL, IEAD_MAXARRAYENTRIES, 3, 0, true,  0, 0, asyncArray};
+                                       NULL, IEAD_MAXARRAYENTRIES, 3, 0, true,  0, 0, 0, asyncArray};
 
     // Try pushing an entry while it's on the stack
     ismEngine_AsyncDataEntry_t newEntry = {ismENGINE_ASYNCDATAENTRY_STRUCID, 3, &dataArea, 50, &callArray, {.internalFn = test_asyncInternalCallback}};
@@ -38,6 +38,7 @@
 #include "engineDiag.h"
 #include "engineStore.h"
 #include "engineTraceDump.h"
+#include "engineUtils.h"
 
 // Function to call if the checking of a diagnostics file failed
 static void checkFailFunc(const char *function, int lineNumber, unsigned long int info)
@@ -277,6 +278,87 @@ void test_memoryDetails(void)
     ism_engine_freeDiagnosticsOutput(outputString);
 }
 
+// -----------------------------------------------------------------
+// Test the latency histograms and their reporting
+// -----------------------------------------------------------------
+void test_latencyHistograms(void)
+{
+    int32_t rc;
+    char *outputString = NULL;
+    ieutThreadData_t *pThreadData = ieut_getThreadData();
+
+    // Check that every value lands in a bucket whose bounds contain it
+    for (uint64_t nanos = 0; nanos < (1UL << 40); nanos = (nanos * 3) + 1)
+    {
+        uint32_t bucket = ieut_latencyBucket(nanos);
+
+        TEST_ASSERT_GREATER_THAN(ieutLATENCY_BUCKETS, bucket);
+        TEST_ASSERT_GREATER_THAN_OR_EQUAL_FORMAT(nanos, ieut_latencyBucketLowerBound(bucket), "%lu");
+        TEST_ASSERT_GREATER_THAN_FORMAT(ieut_latencyBucketLowerBound(bucket+1), nanos, "%lu");
+    }
+
+    // Percentiles should be reported to within the precision of a bucket
+    ieutLatencyHistogram_t histogram = {0};
+
+    for (uint64_t nanos = 1; nanos <= 1000; nanos++)
+    {
+        histogram.count++;
+        histogram.totalNanos += nanos * 1000;
+        histogram.maxNanos = nanos * 1000;
+        histogram.buckets[ieut_latencyBucket(nanos * 1000)]++;
+    }
+
+    uint64_t p50 = ieut_latencyPercentile(&histogram, 50.0);
+    TEST_ASSERT_GREATER_THAN_OR_EQUAL_FORMAT(p50, 500000UL, "%lu");
+    TEST_ASSERT_GREATER_THAN_FORMAT(500000UL + (500000UL >> ieutLATENCY_SUBBUCKET_BITS), p50, "%lu");
+    TEST_ASSERT_EQUAL_FORMAT(ieut_latencyPercentile(&histogram, 100.0), 1000000UL, "%lu");
+
+    // Record some values on this thread and check they are reported
+    ieutLatencyHistogram_t *before = calloc(ieutLATENCY_POINT_COUNT, sizeof(ieutLatencyHistogram_t));
+    ieutLatencyHistogram_t *after = calloc(ieutLATENCY_POINT_COUNT, sizeof(ieutLatencyHistogram_t));
+    TEST_ASSERT_PTR_NOT_NULL(before);
+    TEST_ASSERT_PTR_NOT_NULL(after);
+
+    ieut_getLatencyHistograms(pThreadData, before);
+    ieut_recordLatency(pThreadData, ieutLATENCY_DELIVERY_TO_ACK, 12345);
+    ieut_recordLatency(pThreadData, ieutLATENCY_DELIVERY_TO_ACK, 54321);
+    ieut_getLatencyHistograms(pThreadData, after);
+
+    TEST_ASSERT_EQUAL_FORMAT(after[ieutLATENCY_DELIVERY_TO_ACK].count, before[ieutLATENCY_DELIVERY_TO_ACK].count + 2, "%lu");
+    TEST_ASSERT_EQUAL_FORMAT(after[ieutLATENCY_DELIVERY_TO_ACK].totalNanos, before[ieutLATENCY_DELIVERY_TO_ACK].totalNanos + 12345 + 54321, "%lu");
+    TEST_ASSERT_GREATER_THAN_OR_EQUAL_FORMAT(after[ieutLATENCY_DELIVERY_TO_ACK].maxNanos, 54321UL, "%lu");
+
+    free(before);
+    free(after);
+
+    rc =  ism_engine_diagnostics(ediaVALUE_MODE_LATENCYHISTOGRAMS,
+                                 NULL,
+                                 &outputString,
+                                 NULL, 0, NULL);
+    TEST_ASSERT_EQUAL(rc, OK);
+    TEST_ASSERT_PTR_NOT_NULL(outputString);
+
+    // Check that it's parsable
+    ism_json_parse_t parseObj;
+    ism_json_entry_t ents[100];
+
+    memset(&parseObj, 0, sizeof(parseObj));
+
+    parseObj.ent = ents;
+    parseObj.ent_alloc = (int)(sizeof(ents)/sizeof(ents[0]));
+    parseObj.source = strdup(outputString);
+    parseObj.src_len = strlen(parseObj.source);
+
+    rc = ism_json_parse(&parseObj);
+    TEST_ASSERT_EQUAL(rc, OK);
+    TEST_ASSERT_PTR_NOT_NULL(strstr(outputString, "\"DeliveryToAck\""));
+
+    if (parseObj.free_ent) ism_common_free(ism_memory_utils_parser,parseObj.ent);
+    free(parseObj.source);
+
+    ism_engine_freeDiagnosticsOutput(outputString);
+}
+
 // -----------------------------------------------------------------
 // Test the counting of durable owner objects
 // -----------------------------------------------------------------
@@ -834,6 +916,7 @@ CU_TestInfo ISM_Diagnostics_CUnit_test_Basic[] =
     { "testInvalid", test_invalid },
     { "testEcho", test_echo },
     { "testMemoryDetails", test_memoryDetails },
+    { "testLatencyHistograms", test_latencyHistograms },
     { "testDumpClientStates", test_dumpClientStates },
     { "testDiagFileActions", test_diagFileActions },
     { "testInMemoryTraceDump", test_dumpTraceHistory },
@@ -78,9 +78,9 @@ void test_ismEngine_Message_t(void)
     pos = offsetof(ismEngine_Message_t, futureField2);
     size = sizeof(msg.futureField2);
     fprintf(dbgFile, "futureField2(%lu) %lu-%lu\n", size, pos, pos+size);
-    pos = offsetof(ismEngine_Message_t, futureField3);
-    size = sizeof(msg.futureField3);
-    fprintf(dbgFile, "futureField3(%lu) %lu-%lu\n", size, pos, pos+size);
+    pos = offsetof(ismEngine_Message_t, putTimestamp);
+    size = sizeof(msg.putTimestamp);
+    fprintf(dbgFile, "putTimestamp(%lu) %lu-%lu\n", size, pos, pos+size);
     pos = offsetof(ismEngine_Message_t, AreaTypes);
     size = sizeof(msg.AreaTypes);
     fprintf(dbgFile, "AreaTypes(%lu) %lu-%lu\n", size, pos, pos+size);
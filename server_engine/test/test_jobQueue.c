@@ -40,11 +40,12 @@ void test_JobQueueBasic1(void)
     int32_t rc = iejq_createJobQueue(pThreadData, &jqh);
     TEST_ASSERT_EQUAL(rc, OK);
 
-    uint32_t maxPuttableJobs = IEJQ_JOB_MAX-1; //One for barrier
+    uint32_t ringJobs = IEJQ_JOB_MAX;
     //Fill and empty the queue a few times... interspersed with just putting a few messages
-    for (uint64_t fill = 0; fill < 5; fill++)
+    //and with overflowing the ring
+    for (uint64_t fill = 0; fill < 6; fill++)
     {
-        uint64_t jobsToPut = maxPuttableJobs;
+        uint64_t jobsToPut = ringJobs;
         uint64_t jobsAdded = 0;
         uint64_t jobsGot = 0;
 
@@ -52,37 +53,19 @@ void test_JobQueueBasic1(void)
         {
             jobsToPut = 5;
         }
+        else if (fill >= 4)
+        {
+            jobsToPut = (ringJobs * 2) + 7;
+        }
 
         test_log(testLOGLEVEL_TESTPROGRESS, "Starting fill %lu...", fill);
-#ifdef IEJQ_JOBQUEUE_PUTLOCK
-        iejq_takePutLock(pThreadData, jqh);
-#endif
         for (uint64_t i = 0; i < jobsToPut; i++)
         {
-#ifdef IEJQ_JOBQUEUE_PUTLOCK
-            rc = iejq_addJob(pThreadData, jqh, test_JobQueueBasic1, (void *)i, false);
-#else
             rc = iejq_addJob(pThreadData, jqh, test_JobQueueBasic1, (void *)i);
-#endif
             TEST_ASSERT_EQUAL(rc, OK);
             jobsAdded++;
         }
 
-        //If it should be full now...check
-        if (jobsAdded == maxPuttableJobs)
-        {
-#ifdef IEJQ_JOBQUEUE_PUTLOCK
-            rc = iejq_addJob(pThreadData, jqh, test_JobQueueBasic1, (void *)1, false);
-#else
-            rc = iejq_addJob(pThreadData, jqh, test_JobQueueBasic1, (void *)1);
-#endif
-            TEST_ASSERT_EQUAL(rc, ISMRC_DestinationFull);
-        }
-
-#ifdef IEJQ_JOBQUEUE_PUTLOCK
-        iejq_releasePutLock(pThreadData, jqh);
-#endif
-
         void *args;
         void *func;
 
@@ -102,13 +85,79 @@ void test_JobQueueBasic1(void)
         TEST_ASSERT_EQUAL(rc, ISMRC_NoMsgAvail);
     }
 
+    iejqJobQueueStats_t stats;
+    iejq_getStats(jqh, &stats);
+
+    TEST_ASSERT_EQUAL(stats.overflowedJobs, (uint64_t)((ringJobs + 7) * 2));
+    TEST_ASSERT_EQUAL(stats.processedJobs, (uint64_t)((ringJobs * 3) + 5 + ((ringJobs * 2) + 7) * 2));
+
+    uint64_t latencyTotal = 0;
+    for (uint32_t i = 0; i < IEJQ_HISTOGRAM_BUCKETS; i++)
+    {
+        latencyTotal += stats.latencyHistogram[i];
+    }
+    TEST_ASSERT_EQUAL(latencyTotal, stats.processedJobs);
+
     iejq_freeJobQueue(pThreadData, jqh);
 }
 
+void test_JobQueueBatch(void)
+{
+    test_log(testLOGLEVEL_TESTNAME, "Starting %s...\n", __func__);
+    ieutThreadData_t *pThreadData = ieut_getThreadData();
+
+    iejqJobQueueHandle_t jqh = NULL;
+
+    int32_t rc = iejq_createJobQueue(pThreadData, &jqh);
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    //Put enough to overflow, then drain in batches checking order is preserved
+    uint64_t jobsToPut = IEJQ_JOB_MAX + (IEJQ_JOB_BATCH_MAX * 3) + 1;
+
+    for (uint64_t i = 0; i < jobsToPut; i++)
+    {
+        rc = iejq_addJob(pThreadData, jqh, test_JobQueueBatch, (void *)i);
+        TEST_ASSERT_EQUAL(rc, OK);
+    }
+
+    iejqJob_t jobs[IEJQ_JOB_BATCH_MAX];
+    uint64_t jobsGot = 0;
+    uint32_t found;
+
+    iejq_takeGetLock(pThreadData, jqh);
+    do
+    {
+        found = iejq_getJobs(pThreadData, jqh, jobs, IEJQ_JOB_BATCH_MAX);
+        TEST_ASSERT(found <= IEJQ_JOB_BATCH_MAX, ("found %u", found));
+
+        for (uint32_t i = 0; i < found; i++)
+        {
+            TEST_ASSERT_EQUAL(jobs[i].func, test_JobQueueBatch);
+            TEST_ASSERT_EQUAL(jobs[i].args, (void *)jobsGot);
+            jobsGot++;
+        }
+    }
+    while (found != 0);
+    iejq_releaseGetLock(pThreadData, jqh);
+
+    TEST_ASSERT_EQUAL(jobsGot, jobsToPut);
+
+    //Free the queue with jobs still on the overflow list
+    for (uint64_t i = 0; i < IEJQ_JOB_MAX + 10; i++)
+    {
+        rc = iejq_addJob(pThreadData, jqh, test_JobQueueBatch, (void *)i);
+        TEST_ASSERT_EQUAL(rc, OK);
+    }
+
+    iejq_freeJobQueue(pThreadData, jqh);
+}
+
+#define TEST_FLOW_NUM_PUTTERS 4
+
 typedef struct tag_testFlowPutterInfo_t {
+    uint64_t putterId;
     uint64_t numMessagesToPut;
     iejqJobQueueHandle_t jqh;
-    uint64_t timesHitQueueFull;
 } testFlowPutterInfo_t;
 
 void *test_flowPutter(void * args)
@@ -116,7 +165,7 @@ void *test_flowPutter(void * args)
     testFlowPutterInfo_t *pPutterInfo = (testFlowPutterInfo_t *)args;
 
     char tname[20];
-    sprintf(tname, "flowPutter");
+    sprintf(tname, "flowPutter%lu", pPutterInfo->putterId);
     prctl (PR_SET_NAME, (unsigned long)(uintptr_t)&tname);
 
     ism_engine_threadInit(0);
@@ -125,21 +174,11 @@ void *test_flowPutter(void * args)
 
     while (numMessagesPut < pPutterInfo->numMessagesToPut)
     {
-#ifdef IEJQ_JOBQUEUE_PUTLOCK
-        int32_t rc = iejq_addJob(pThreadData, pPutterInfo->jqh, test_flowPutter, (void *)numMessagesPut, true);
-#else
-        int32_t rc = iejq_addJob(pThreadData, pPutterInfo->jqh, test_flowPutter, (void *)numMessagesPut);
-#endif
-
-        if (rc == ISMRC_DestinationFull)
-        {
-            (pPutterInfo->timesHitQueueFull)++;
-        }
-        else
-        {
-            TEST_ASSERT_EQUAL(rc, OK);
-            numMessagesPut++;
-        }
+        //Each job records which putter it came from and its sequence for that putter
+        int32_t rc = iejq_addJob(pThreadData, pPutterInfo->jqh, test_flowPutter,
+                                 (void *)((pPutterInfo->putterId << 48) | numMessagesPut));
+        TEST_ASSERT_EQUAL(rc, OK);
+        numMessagesPut++;
     }
 
     ism_engine_threadTerm(1);
@@ -157,16 +196,22 @@ void test_JobQueueFlow(void)
     int32_t rc = iejq_createJobQueue(pThreadData, &jqh);
     TEST_ASSERT_EQUAL(rc, OK);
 
+    pthread_t putterThreadId[TEST_FLOW_NUM_PUTTERS];
+    testFlowPutterInfo_t putterInfo[TEST_FLOW_NUM_PUTTERS];
+    uint64_t nextExpected[TEST_FLOW_NUM_PUTTERS] = {0};
 
-    pthread_t putterThreadId;
-
-    uint64_t jobsToPut = ((IEJQ_JOB_MAX-1)*11)+17;
-
+    uint64_t jobsPerPutter = ((IEJQ_JOB_MAX-1)*3)+17;
+    uint64_t jobsToPut = jobsPerPutter * TEST_FLOW_NUM_PUTTERS;
 
-    testFlowPutterInfo_t putterInfo = {jobsToPut, jqh, 0};
+    for (uint64_t i = 0; i < TEST_FLOW_NUM_PUTTERS; i++)
+    {
+        putterInfo[i].putterId = i;
+        putterInfo[i].numMessagesToPut = jobsPerPutter;
+        putterInfo[i].jqh = jqh;
 
-    rc = test_task_startThread(&(putterThreadId),test_flowPutter, (void *)&putterInfo,"test_flowPutter");
-    TEST_ASSERT_EQUAL(rc, OK);
+        rc = test_task_startThread(&(putterThreadId[i]),test_flowPutter, (void *)&putterInfo[i],"test_flowPutter");
+        TEST_ASSERT_EQUAL(rc, OK);
+    }
 
     void *args;
     void *func;
@@ -192,9 +237,15 @@ void test_JobQueueFlow(void)
         else
         {
             TEST_ASSERT_EQUAL(rc, OK);
-
             TEST_ASSERT_EQUAL(func, test_flowPutter);
-            TEST_ASSERT_EQUAL(args, (void *)jobsGot);
+
+            //Jobs from each putter must arrive in the order they were put
+            uint64_t putterId = ((uint64_t)args) >> 48;
+            uint64_t putterSeq = ((uint64_t)args) & 0xFFFFFFFFFFFFUL;
+
+            TEST_ASSERT(putterId < TEST_FLOW_NUM_PUTTERS, ("putterId %lu", putterId));
+            TEST_ASSERT_EQUAL(putterSeq, nextExpected[putterId]);
+            nextExpected[putterId]++;
 
             jobsGot++;
         }
@@ -205,13 +256,19 @@ void test_JobQueueFlow(void)
     rc = iejq_getJob(pThreadData, jqh, &func, &args, true);
     TEST_ASSERT_EQUAL(rc, ISMRC_NoMsgAvail);
 
-    rc = pthread_join(putterThreadId, NULL);
-    TEST_ASSERT_EQUAL(rc, OK);
+    for (uint64_t i = 0; i < TEST_FLOW_NUM_PUTTERS; i++)
+    {
+        rc = pthread_join(putterThreadId[i], NULL);
+        TEST_ASSERT_EQUAL(rc, OK);
+    }
+
+    iejqJobQueueStats_t stats;
+    iejq_getStats(jqh, &stats);
 
     iejq_freeJobQueue(pThreadData, jqh);
 
-    test_log(testLOGLEVEL_TESTPROGRESS, "Put and got %lu jobs...Hit Full queue %lu times and Empty queue %u times",
-                       jobsToPut, putterInfo.timesHitQueueFull, timesHitEmptyQ);
+    test_log(testLOGLEVEL_TESTPROGRESS, "Put and got %lu jobs...Overflowed %lu jobs and hit Empty queue %lu times",
+                       jobsToPut, stats.overflowedJobs, timesHitEmptyQ);
 }
 
 int initSuite(void)
@@ -232,6 +289,7 @@ int termSuite(void)
 CU_TestInfo ISM_JobQueue_CUnit_test_Basic[] =
 {
     { "test_JobQueueBasic1", test_JobQueueBasic1 },
+    { "test_JobQueueBatch",  test_JobQueueBatch },
     { "test_JobQueueFlow",   test_JobQueueFlow },
     CU_TEST_INFO_NULL
 };
@@ -1153,6 +1153,402 @@ void test_DrainQueue(void)
     TEST_ASSERT_EQUAL(rc, OK);
 }
 
+typedef struct tag_batchDeliveryContext_t
+{
+    uint32_t msgsReceived;
+    uint32_t batchesReceived;
+    uint32_t largestBatch;
+    uint32_t pushbackAfter;  ///< Return false once this many messages have arrived (0 = never)
+} batchDeliveryContext_t;
+
+bool BatchDeliveryMsgCallback(
+        ismEngine_ConsumerHandle_t      hConsumer,
+        uint32_t                        destinationOptions,
+        uint32_t                        messageCount,
+        ismEngine_DeliveredMessage_t *  pMessages,
+        void *                          pConsumerContext,
+        ismEngine_DelivererContext_t *  _delivererContext)
+{
+    batchDeliveryContext_t *context = *(batchDeliveryContext_t **)pConsumerContext;
+    bool wantMore = true;
+
+    TEST_ASSERT_GREATER_THAN(messageCount, 0);
+    TEST_ASSERT_GREATER_THAN_OR_EQUAL(ismENGINE_MAX_MESSAGE_BATCH_SIZE, messageCount);
+
+    for (uint32_t i = 0; i < messageCount; i++)
+    {
+        //Check that the messages arrive in order
+        testMessage_t *msg = pMessages[i].pAreaData[1];
+        TEST_ASSERT_EQUAL(msg->msgNum, context->msgsReceived);
+        context->msgsReceived++;
+
+        int32_t rc = ism_engine_confirmMessageDelivery( ((ismEngine_Consumer_t *)hConsumer)->pSession
+                , NULL
+                , pMessages[i].hDelivery
+                , ismENGINE_CONFIRM_OPTION_CONSUMED
+                , NULL
+                , 0
+                , NULL );
+        TEST_ASSERT_EQUAL(rc, OK);
+
+        ism_engine_releaseMessage(pMessages[i].hMessage);
+    }
+
+    context->batchesReceived++;
+    if (messageCount > context->largestBatch) context->largestBatch = messageCount;
+
+    if (context->pushbackAfter != 0 && context->msgsReceived >= context->pushbackAfter)
+    {
+        context->pushbackAfter = 0;
+        wantMore = false;
+    }
+
+    return wantMore;
+}
+
+//Check that messages are given to a consumer with a registered batch callback in
+//batches that grow while it keeps up and shrink when it pushes back
+void test_BatchDelivery(void)
+{
+    ieutThreadData_t *pThreadData = ieut_getThreadData();
+    int32_t rc;
+
+    ismEngine_ClientStateHandle_t hClient=NULL;
+    ismEngine_SessionHandle_t hSession=NULL;
+    ismEngine_ConsumerHandle_t hConsumer=NULL;
+    batchDeliveryContext_t context = {0};
+    batchDeliveryContext_t *pContext = &context;
+
+    uint32_t numMessages = 1000;
+
+    test_log(testLOGLEVEL_TESTNAME, "Starting %s...", __func__);
+
+    ismEngine_MessageCallback_t origReplacedFn = ismEngine_serverGlobal.messageBatchReplacedFn;
+    ismEngine_MessageBatchCallback_t origBatchFn = ismEngine_serverGlobal.messageBatchFn;
+
+    ism_engine_registerMessageBatchCallback(receivedMsgCallback, BatchDeliveryMsgCallback);
+
+    rc = ism_engine_createClientState("batchDelivery",
+                                      testDEFAULT_PROTOCOL_ID,
+                                      ismENGINE_CREATE_CLIENT_OPTION_NONE,
+                                      NULL, NULL,
+                                      NULL,
+                                      &hClient,
+                                      NULL, 0, NULL);
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    rc = ism_engine_createSession(hClient,
+                                  ismENGINE_CREATE_SESSION_OPTION_NONE,
+                                  &hSession,
+                                  NULL, 0, NULL);
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    rc = ism_engine_startMessageDelivery(hSession,
+                                         ismENGINE_START_DELIVERY_OPTION_NONE,
+                                         NULL, 0, NULL);
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    char *qName = "test_BatchDelivery";
+    rc = ieqn_createQueue(pThreadData,
+                          qName,
+                          multiConsumer,
+                          ismQueueScope_Server, NULL,
+                          NULL,
+                          NULL,
+                          NULL);
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    //Put messages carrying their sequence number so the order of the batches can be checked
+    uint32_t actionsRemaining = 0;
+    uint32_t *pActionsRemaining = &actionsRemaining;
+
+    test_incrementActionsRemaining(pActionsRemaining, numMessages);
+    for (uint32_t i = 0; i < numMessages; i++)
+    {
+        ismEngine_MessageHandle_t hMessage = createMessage(hSession, 0, i);
+
+        rc = ism_engine_putMessageOnDestination(hSession,
+                                                ismDESTINATION_QUEUE,
+                                                qName,
+                                                NULL,
+                                                hMessage,
+                                                &pActionsRemaining,
+                                                sizeof(pActionsRemaining),
+                                                test_decrementActionsRemaining);
+        if (rc == OK) test_decrementActionsRemaining(rc, NULL, &pActionsRemaining);
+        else TEST_ASSERT_EQUAL(rc, ISMRC_AsyncCompletion);
+    }
+
+    test_waitForRemainingActions(pActionsRemaining);
+
+    //Push back part way through so we can check the batch size is reduced
+    context.pushbackAfter = numMessages/2;
+
+    rc = ism_engine_createConsumer(hSession,
+                                   ismDESTINATION_QUEUE,
+                                   qName,
+                                   ismENGINE_SUBSCRIPTION_OPTION_NONE,
+                                   NULL,
+                                   &pContext,
+                                   sizeof(pContext),
+                                   receivedMsgCallback,
+                                   NULL,
+                                   ismENGINE_CONSUMER_OPTION_ACK | ismENGINE_CONSUMER_OPTION_PAUSE,
+                                   &hConsumer,
+                                   NULL, 0, NULL);
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    ismEngine_Consumer_t *pConsumer = (ismEngine_Consumer_t *)hConsumer;
+    TEST_ASSERT_EQUAL_FORMAT(pConsumer->pMsgBatchCallbackFn, BatchDeliveryMsgCallback, "%p");
+    TEST_ASSERT_EQUAL(pConsumer->msgBatchSize, 1);
+
+    rc = ism_engine_resumeMessageDelivery(hConsumer, ismENGINE_RESUME_DELIVERY_OPTION_NONE, NULL, 0, NULL);
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    //We pushed back after a growing set of batches...
+    TEST_ASSERT_EQUAL(context.pushbackAfter, 0);
+    TEST_ASSERT_GREATER_THAN_OR_EQUAL(context.msgsReceived, numMessages/2);
+    TEST_ASSERT_GREATER_THAN(numMessages, context.msgsReceived);
+    TEST_ASSERT_EQUAL(context.largestBatch, ismENGINE_MAX_MESSAGE_BATCH_SIZE);
+    TEST_ASSERT_EQUAL(pConsumer->msgBatchSize, ismENGINE_MAX_MESSAGE_BATCH_SIZE/2);
+
+    rc = ism_engine_resumeMessageDelivery(hConsumer, ismENGINE_RESUME_DELIVERY_OPTION_NONE, NULL, 0, NULL);
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    TEST_ASSERT_EQUAL(context.msgsReceived, numMessages);
+    TEST_ASSERT_GREATER_THAN(numMessages/10, context.batchesReceived);
+
+    //Consumers using other callbacks don't get batches
+    ismEngine_ConsumerHandle_t hOtherConsumer=NULL;
+    rc = ism_engine_createConsumer(hSession,
+                                   ismDESTINATION_QUEUE,
+                                   qName,
+                                   ismENGINE_SUBSCRIPTION_OPTION_NONE,
+                                   NULL,
+                                   NULL,
+                                   0,
+                                   MultiBrowseTestMsgCallback,
+                                   NULL,
+                                   ismENGINE_CONSUMER_OPTION_NONE,
+                                   &hOtherConsumer,
+                                   NULL, 0, NULL);
+    TEST_ASSERT_EQUAL(rc, OK);
+    TEST_ASSERT_PTR_NULL(((ismEngine_Consumer_t *)hOtherConsumer)->pMsgBatchCallbackFn);
+
+    rc = ism_engine_destroyConsumer(hOtherConsumer, NULL, 0, NULL);
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    rc = ism_engine_destroyConsumer(hConsumer, NULL, 0, NULL);
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    rc = ieqn_destroyQueue(pThreadData, qName, ieqnDiscardMessages, false);
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    rc = ism_engine_destroyClientState(hClient, ismENGINE_DESTROY_CLIENT_OPTION_NONE, NULL, 0, NULL);
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    ism_engine_registerMessageBatchCallback(origReplacedFn, origBatchFn);
+}
+
+typedef struct tag_claimedDeliveryContext_t
+{
+    uint32_t msgsReceived;
+    uint32_t firstMsgNum;
+    uint32_t lastMsgNum;
+    uint32_t pauseAfter;     ///< Return false once this many messages have arrived (0 = never)
+    uint8_t *pMsgsSeen;      ///< Shared between consumers, count of times each message was seen
+} claimedDeliveryContext_t;
+
+bool ClaimedDeliveryMsgCallback(
+        ismEngine_ConsumerHandle_t      hConsumer,
+        ismEngine_DeliveryHandle_t      hDelivery,
+        ismEngine_MessageHandle_t       hMessage,
+        uint32_t                        deliveryId,
+        ismMessageState_t               state,
+        uint32_t                        destinationOptions,
+        ismMessageHeader_t *            pMsgDetails,
+        uint8_t                         areaCount,
+        ismMessageAreaType_t            areaTypes[areaCount],
+        size_t                          areaLengths[areaCount],
+        void *                          pAreaData[areaCount],
+        void *                          pConsumerContext,
+        ismEngine_DelivererContext_t *  _delivererContext)
+{
+    claimedDeliveryContext_t *context = *(claimedDeliveryContext_t **)pConsumerContext;
+    bool wantMore = true;
+
+    testMessage_t *msg = pAreaData[1];
+
+    //Each consumer must see its messages in order
+    if (context->msgsReceived == 0)
+    {
+        context->firstMsgNum = msg->msgNum;
+    }
+    else
+    {
+        TEST_ASSERT_GREATER_THAN(msg->msgNum, context->lastMsgNum);
+    }
+    context->lastMsgNum = msg->msgNum;
+    context->pMsgsSeen[msg->msgNum]++;
+    context->msgsReceived++;
+
+    int32_t rc = ism_engine_confirmMessageDelivery( ((ismEngine_Consumer_t *)hConsumer)->pSession
+            , NULL
+            , hDelivery
+            , ismENGINE_CONFIRM_OPTION_CONSUMED
+            , NULL
+            , 0
+            , NULL );
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    ism_engine_releaseMessage(hMessage);
+
+    if (context->pauseAfter != 0 && context->msgsReceived >= context->pauseAfter)
+    {
+        context->pauseAfter = 0;
+        wantMore = false;
+    }
+
+    return wantMore;
+}
+
+//Check that when shared subscription consumers claim runs of messages, claims that
+//are not used are handed back so that another consumer receives every message exactly once
+void test_ClaimedDelivery(void)
+{
+    int32_t rc;
+
+    ismEngine_ClientStateHandle_t hClient=NULL;
+    ismEngine_SessionHandle_t hSession=NULL;
+    ismEngine_ConsumerHandle_t hConsumer[2]={NULL, NULL};
+    claimedDeliveryContext_t context[2] = {{0}};
+    claimedDeliveryContext_t *pContext[2] = {&context[0], &context[1]};
+
+    uint32_t numMessages = 1000;
+    uint8_t msgsSeen[numMessages];
+
+    char *subName = "test_ClaimedDelivery";
+    char *topicString = "/topic/ClaimedDelivery";
+
+    test_log(testLOGLEVEL_TESTNAME, "Starting %s...", __func__);
+
+    memset(msgsSeen, 0, sizeof(msgsSeen));
+
+    //Have shared subscription consumers claim 16 messages at a time
+    ism_field_t f;
+    f.type = VT_Integer;
+    f.val.i = 16;
+    rc = ism_common_setProperty(ism_common_getConfigProperties(),
+                                ismENGINE_CFGPROP_SHARED_SUB_DELIVERY_CLAIM, &f);
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    rc = test_bounceEngine();
+    TEST_ASSERT_EQUAL(rc, OK);
+    TEST_ASSERT_EQUAL(ismEngine_serverGlobal.sharedSubDeliveryClaim, 16);
+
+    rc = test_createClientAndSession("claimedDelivery",
+                                     NULL,
+                                     ismENGINE_CREATE_CLIENT_OPTION_NONE,
+                                     ismENGINE_CREATE_SESSION_OPTION_NONE,
+                                     &hClient, &hSession, true);
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    ismEngine_SubscriptionAttributes_t subAttrs = { ismENGINE_SUBSCRIPTION_OPTION_SHARED |
+                                                    ismENGINE_SUBSCRIPTION_OPTION_AT_LEAST_ONCE };
+
+    rc = sync_ism_engine_createSubscription(hClient,
+                                            subName,
+                                            NULL,
+                                            ismDESTINATION_TOPIC,
+                                            topicString,
+                                            &subAttrs,
+                                            NULL); // Owning client same as requesting client
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    for (uint32_t i = 0; i < numMessages; i++)
+    {
+        ismEngine_MessageHandle_t hMessage = createMessage(hSession, 0, i);
+
+        rc = ism_engine_putMessageOnDestination(hSession,
+                                                ismDESTINATION_TOPIC,
+                                                topicString,
+                                                NULL,
+                                                hMessage,
+                                                NULL, 0, NULL);
+        TEST_ASSERT_EQUAL(rc, OK);
+    }
+
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        context[i].pMsgsSeen = msgsSeen;
+
+        rc = ism_engine_createConsumer(hSession,
+                                       ismDESTINATION_SUBSCRIPTION,
+                                       subName,
+                                       NULL,
+                                       NULL,
+                                       &pContext[i],
+                                       sizeof(pContext[i]),
+                                       ClaimedDeliveryMsgCallback,
+                                       NULL,
+                                       ismENGINE_CONSUMER_OPTION_ACK | ismENGINE_CONSUMER_OPTION_PAUSE,
+                                       &hConsumer[i],
+                                       NULL, 0, NULL);
+        TEST_ASSERT_EQUAL(rc, OK);
+    }
+
+    //The claim size comes from the config for a shared subscription queue
+    iemqQueue_t *Q = (iemqQueue_t *)(hConsumer[0]->queueHandle);
+    TEST_ASSERT_EQUAL(Q->QOptions & (ieqOptions_SUBSCRIPTION_QUEUE |
+                                     ieqOptions_SINGLE_CONSUMER_ONLY), ieqOptions_SUBSCRIPTION_QUEUE);
+    TEST_ASSERT_EQUAL(Q->deliveryClaimSize, 16);
+
+    //First consumer stops part way through a claimed run...
+    context[0].pauseAfter = 10;
+
+    rc = ism_engine_resumeMessageDelivery(hConsumer[0], ismENGINE_RESUME_DELIVERY_OPTION_NONE, NULL, 0, NULL);
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    TEST_ASSERT_EQUAL(context[0].pauseAfter, 0);
+    TEST_ASSERT_GREATER_THAN_OR_EQUAL(context[0].msgsReceived, 10);
+    TEST_ASSERT_GREATER_THAN(numMessages, context[0].msgsReceived);
+    TEST_ASSERT_EQUAL(context[0].firstMsgNum, 0);
+    TEST_ASSERT_EQUAL(context[0].lastMsgNum, context[0].msgsReceived-1);
+
+    //...and the second picks up exactly where it left off
+    rc = ism_engine_resumeMessageDelivery(hConsumer[1], ismENGINE_RESUME_DELIVERY_OPTION_NONE, NULL, 0, NULL);
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    TEST_ASSERT_EQUAL(context[1].firstMsgNum, context[0].msgsReceived);
+    TEST_ASSERT_EQUAL(context[0].msgsReceived + context[1].msgsReceived, numMessages);
+
+    for (uint32_t i = 0; i < numMessages; i++)
+    {
+        TEST_ASSERT_EQUAL(msgsSeen[i], 1);
+    }
+
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        rc = ism_engine_destroyConsumer(hConsumer[i], NULL, 0, NULL);
+        TEST_ASSERT_EQUAL(rc, OK);
+    }
+
+    rc = ism_engine_destroySubscription(hClient, subName, hClient, NULL, 0, NULL);
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    rc = test_destroyClientAndSession(hClient, hSession, false);
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    //Go back to the default claim size for the remaining tests
+    rc = ism_common_setProperty(ism_common_getConfigProperties(),
+                                ismENGINE_CFGPROP_SHARED_SUB_DELIVERY_CLAIM, NULL);
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    rc = test_bounceEngine();
+    TEST_ASSERT_EQUAL(rc, OK);
+    TEST_ASSERT_EQUAL(ismEngine_serverGlobal.sharedSubDeliveryClaim, ismENGINE_DEFAULT_SHARED_SUB_DELIVERY_CLAIM);
+}
+
 typedef struct tag_multiBrowseUncommittedPutterContext_t
 {
     char *qName;
@@ -4507,6 +4903,8 @@ CU_TestInfo ISM_Engine_CUnit_MultiConsumerQ_Basic[] = {
     { "NackOnSessionClose",  NackOnSessionClose },
     { "DurableSubReconnect", DurableSubReconnect },
     { "DrainQueue",          test_DrainQueue },
+    { "BatchDelivery",       test_BatchDelivery },
+    { "ClaimedDelivery",     test_ClaimedDelivery },
     { "TestBasicBrowse",     test_BasicBrowse },
     { "TestMultiBrowse",     test_MultiBrowse },
     { "TestBasicSelection",  test_BasicSelection },
@@ -4452,11 +4452,197 @@ void test_capability_Sub_Selects_Reliability(void)
     pSelectionExpected = NULL;
 }
 
+//****************************************************************************
+// This test verifies that when enough subscriptions select on the value of
+// a string property, publish indexes them by value and each subscription
+// still receives the messages its selector matches.
+#define SELECT_INDEXED_TOPIC "TEST/SELECT/INDEXED"
+
+void test_capability_Sub_Selects_Indexed(void)
+{
+    uint32_t rc;
+    const uint32_t subCount = 100;
+    const uint32_t colourCount = 9;
+    uint32_t messageCount = 0;
+    ismEngine_ClientStateHandle_t hClient;
+    ismEngine_SessionHandle_t hSession;
+    ismEngine_ConsumerHandle_t hConsumer[subCount];
+    genericMsgCbContext_t ConsumerContext[subCount];
+    genericMsgCbContext_t *pConsumerContext[subCount];
+    char selectorString[64];
+    char colourText[16];
+    char payload[128];
+
+    test_selectionCallback_t expectSelection = {SELECT_INDEXED_TOPIC};
+
+    pSelectionExpected = &expectSelection;
+
+    TEST_ASSERT(subCount >= ismEngine_serverGlobal.selectionIndexMinimum, ("subCount too small to index"));
+
+    printf("Starting %s...\n", __func__);
+
+    /* Create our clients and sessions */
+    rc = test_createClientAndSession(__func__,
+                                     NULL,
+                                     ismENGINE_CREATE_CLIENT_OPTION_NONE,
+                                     ismENGINE_CREATE_SESSION_OPTION_NONE,
+                                     &hClient, &hSession, true);
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    printf("  ...create\n");
+
+    // Every 10th subscription selects on size alone, the others select on colour
+    ismEngine_SubscriptionAttributes_t subAttrs = { ismENGINE_SUBSCRIPTION_OPTION_AT_MOST_ONCE |
+                                                    ismENGINE_SUBSCRIPTION_OPTION_MESSAGE_SELECTION };
+
+    for(uint32_t i=0; i<subCount; i++)
+    {
+        ism_prop_t *properties = ism_common_newProperties(1);
+        TEST_ASSERT_PTR_NOT_NULL(properties);
+
+        if (i%10 == 9)
+        {
+            strcpy(selectorString, "Size > 0");
+        }
+        else if (i%2 == 0)
+        {
+            sprintf(selectorString, "Colour = 'C%u' AND Size > 0", i%colourCount);
+        }
+        else
+        {
+            sprintf(selectorString, "Colour IN ('C%u', 'NONE')", i%colourCount);
+        }
+
+        ism_field_t SelectorField = {VT_String, 0, {.s = selectorString }};
+        rc = ism_common_setProperty(properties, ismENGINE_PROPERTY_SELECTOR, &SelectorField);
+        TEST_ASSERT_EQUAL(rc, OK);
+
+        memset(&ConsumerContext[i], 0, sizeof(ConsumerContext[i]));
+        ConsumerContext[i].hSession = hSession;
+        pConsumerContext[i] = &ConsumerContext[i];
+
+        rc = ism_engine_createConsumer(hSession,
+                                       ismDESTINATION_TOPIC,
+                                       SELECT_INDEXED_TOPIC,
+                                       &subAttrs,
+                                       NULL, // Unused for TOPIC
+                                       &pConsumerContext[i],
+                                       sizeof(genericMsgCbContext_t *),
+                                       genericMessageCallback,
+                                       properties,
+                                       ismENGINE_CONSUMER_OPTION_NONE,
+                                       &hConsumer[i],
+                                       NULL, 0, NULL);
+        TEST_ASSERT_EQUAL(rc, OK);
+
+        // The selection rule is also compiled to selection code which is used to publish
+        ismEngine_Subscription_t *subscription = (ismEngine_Subscription_t *)(hConsumer[i]->engineObject);
+        TEST_ASSERT_PTR_NOT_NULL(subscription->selectionRule);
+        TEST_ASSERT_PTR_NOT_NULL(subscription->selectionCode);
+        TEST_ASSERT_EQUAL(subscription->selectionCode->op, SELRULE_Code);
+
+        ism_common_freeProperties(properties);
+    }
+
+    // Publish one message for each colour, one without a colour and one with a numeric colour
+    for(int32_t i=0; i<colourCount+2; i++)
+    {
+        ismMessageHeader_t header = ismMESSAGE_HEADER_DEFAULT;
+        ismMessageAreaType_t areaTypes[2];
+        size_t areaLengths[2];
+        void *areas[2];
+        concat_alloc_t FlatProperties = { NULL };
+        char localPropBuffer[1024];
+
+        FlatProperties.buf = localPropBuffer;
+        FlatProperties.len = 1024;
+
+        ism_prop_t *msgProperties = ism_common_newProperties(2);
+        TEST_ASSERT_PTR_NOT_NULL(msgProperties);
+
+        ism_field_t SizeField = {VT_Integer, 0, {.i = 1 }};
+        rc = ism_common_setProperty(msgProperties, "Size", &SizeField);
+        TEST_ASSERT_EQUAL(rc, OK);
+
+        if (i < colourCount)
+        {
+            sprintf(colourText, "C%d", i);
+            ism_field_t ColourField = {VT_String, 0, {.s = colourText }};
+            rc = ism_common_setProperty(msgProperties, "Colour", &ColourField);
+            TEST_ASSERT_EQUAL(rc, OK);
+        }
+        else if (i == colourCount+1)
+        {
+            ism_field_t ColourField = {VT_Integer, 0, {.i = 3 }};
+            rc = ism_common_setProperty(msgProperties, "Colour", &ColourField);
+            TEST_ASSERT_EQUAL(rc, OK);
+        }
+
+        rc = ism_common_serializeProperties(msgProperties, &FlatProperties);
+        TEST_ASSERT_EQUAL(rc, OK);
+        ism_common_freeProperties(msgProperties);
+
+        sprintf(payload, "Message - %d.", i);
+
+        areaTypes[0] = ismMESSAGE_AREA_PROPERTIES;
+        areaLengths[0] = FlatProperties.used;
+        areas[0] = FlatProperties.buf;
+        areaTypes[1] = ismMESSAGE_AREA_PAYLOAD;
+        areaLengths[1] = strlen(payload) +1;
+        areas[1] = (void *)payload;
+
+        header.Persistence = ismMESSAGE_PERSISTENCE_NONPERSISTENT;
+        header.Reliability = ismMESSAGE_RELIABILITY_AT_LEAST_ONCE;
+
+        ismEngine_MessageHandle_t hMessage = NULL;
+        rc = ism_engine_createMessage(&header,
+                                      2,
+                                      areaTypes,
+                                      areaLengths,
+                                      areas,
+                                      &hMessage);
+        TEST_ASSERT_EQUAL(rc, OK);
+        TEST_ASSERT_PTR_NOT_NULL(hMessage);
+
+        rc = ism_engine_putMessageOnDestination(hSession,
+                                                ismDESTINATION_TOPIC,
+                                                SELECT_INDEXED_TOPIC,
+                                                NULL,
+                                                hMessage,
+                                                NULL, 0, NULL);
+        TEST_ASSERT_EQUAL(rc, OK);
+        messageCount++;
+    }
+
+    // The subscriptions were indexed by colour on this thread
+    ieutThreadData_t *pThreadData = ieut_getThreadData();
+    TEST_ASSERT_PTR_NOT_NULL(pThreadData->selectionIndex);
+    TEST_ASSERT_PTR_NOT_NULL(pThreadData->selectionIndex->propertyName);
+    TEST_ASSERT_STRINGS_EQUAL(pThreadData->selectionIndex->propertyName, "Colour");
+    TEST_ASSERT_EQUAL(pThreadData->selectionIndex->unkeyedCount, subCount/10);
+
+    for(uint32_t i=0; i<subCount; i++)
+    {
+        TEST_ASSERT_EQUAL(ConsumerContext[i].received, (i%10 == 9) ? messageCount : 1);
+
+        rc = ism_engine_destroyConsumer(hConsumer[i], NULL, 0, NULL);
+        TEST_ASSERT_EQUAL(rc, OK);
+    }
+
+    printf("  ...disconnect\n");
+
+    rc = test_destroyClientAndSession(hClient, hSession, true);
+    TEST_ASSERT_EQUAL(rc, OK);
+
+    pSelectionExpected = NULL;
+}
+
 CU_TestInfo ISM_TopicTree_CUnit_test_capability_Selection_SubOnly[] =
 {
     { "SingleSubscriberSelectsSome", test_capability_Sub_Selects_Some },
     { "SingleSubscriberSelectsSomeCompiled", test_capability_Sub_Selects_SomeCompiled },
     { "SelectOnReliability", test_capability_Sub_Selects_Reliability },
+    { "SelectIndexed", test_capability_Sub_Selects_Indexed },
     CU_TEST_INFO_NULL
 };
 
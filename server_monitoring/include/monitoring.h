@@ -48,7 +48,8 @@ typedef enum {
 	ismMON_STAT_Transaction   = 14,
 	ismMON_STAT_Cluster       = 15,
 	ismMON_STAT_Forwarder     = 16,
-	ismMON_STAT_ResourceSet   = 17
+	ismMON_STAT_ResourceSet   = 17,
+	ismMON_STAT_Latency       = 18
 } ismMonitoringStatType_t;
 
 XAPI int ism_monitoring_getSecurityStats(char * action, ism_json_parse_t * inputJSONObj, concat_alloc_t * outputBuffer);
@@ -43,6 +43,22 @@ extern pthread_key_t monitoring_localekey;
 
 static ism_time_t lastime=0, currenttime=0;
 
+/*
+ * Size the output buffer for the rest of an array of monitoring results.
+ *
+ * The length of the first serialized result is used as the estimate with some room
+ * for longer strings, so a large response is allocated once rather than growing
+ * by doubling as each result is added.
+ */
+static void reserveMonResults(concat_alloc_t * outputBuffer, int firstlen, uint32_t resultCount) {
+    if (resultCount > 1) {
+        int64_t need = (int64_t)(firstlen + 1) * (resultCount - 1);
+        need += need/8 + 2;
+        if (need < INT32_MAX/2)
+            ism_common_allocBufferReserve(outputBuffer, (int)need);
+    }
+}
+
 
 /*
  * Holding monitoring data for each snap shot of memory
@@ -845,7 +861,10 @@ static int32_t ism_monitoring_getSubscriptionStats (
         }
 
         /* Serialize data */
+        int startlen = outputBuffer->used;
         ism_common_serializeMonJson(XismEngine_SubscriptionMonitor_t, (void *)subsMonEngine, outputBuffer->buf, 2500, &iSerData );
+        if (i == 0)
+            reserveMonResults(outputBuffer, outputBuffer->used - startlen, resultCount);
 
         subsMonEngine++;
         addNext = 1;
@@ -1131,7 +1150,10 @@ static int32_t ism_monitoring_getResourceSetStats (
         }
 
         /* Serialize data */
+        int startlen = outputBuffer->used;
         ism_common_serializeMonJson(outputType, (void *)resourceSetMonEngine, outputBuffer->buf, 2500, &iSerData );
+        if (i == 0)
+            reserveMonResults(outputBuffer, outputBuffer->used - startlen, resultCount);
 
         resourceSetMonEngine++;
         addNext = 1;
@@ -1352,7 +1374,10 @@ XAPI int32_t ism_monitoring_getQueueStats (
         }
 
         /* Serialize data */
+        int startlen = outputBuffer->used;
         ism_common_serializeMonJson(XismEngine_QueueMonitor_t, (void *)queueMonEngine, outputBuffer->buf, 2500, &iSerData );
+        if (i == 0)
+            reserveMonResults(outputBuffer, outputBuffer->used - startlen, resultCount);
 
         queueMonEngine++;
         addNext = 1;
@@ -1578,7 +1603,10 @@ XAPI int32_t ism_monitoring_getTopicStats (
         }
 
         /* Serialize data */
+        int startlen = outputBuffer->used;
         ism_common_serializeMonJson(XismEngine_TopicMonitor_t, (void *)topicMonEngine, outputBuffer->buf, 2500, &iSerData );
+        if (i == 0)
+            reserveMonResults(outputBuffer, outputBuffer->used - startlen, resultCount);
 
         topicMonEngine++;
         addNext = 1;
@@ -1803,7 +1831,10 @@ XAPI int32_t ism_monitoring_getMQTTClientStats (
         }
 
         /* Serialize data */
+        int startlen = outputBuffer->used;
         ism_common_serializeMonJson(XismEngine_ClientStateMonitor_t, (void *)clientMonEngine, outputBuffer->buf, 2500, &iSerData );
+        if (i == 0)
+            reserveMonResults(outputBuffer, outputBuffer->used - startlen, resultCount);
 
         clientMonEngine++;
         addNext = 1;
@@ -2062,7 +2093,10 @@ XAPI int32_t ism_monitoring_getTransactionStats (
         }
 
         /* Serialize data */
+        int startlen = outputBuffer->used;
         ism_common_serializeMonJson(XismEngine_TransactionMonitor_t, (void *)transactionMonEngine, outputBuffer->buf, 2500, &iSerData );
+        if (i == 0)
+            reserveMonResults(outputBuffer, outputBuffer->used - startlen, resultCount);
 
         transactionMonEngine++;
         addNext = 1;
@@ -2377,6 +2411,31 @@ XAPI int32_t ism_monitoring_getDetailedMemoryStats (
     ism_common_allocBufferCopyLen(outputBuffer,rbuf,strlen(rbuf));
     return rc;
 }
+
+/**
+ * Messaging path latency monitoring data action handler
+ *
+ * The latency histograms are maintained per-thread by the Engine, which
+ * merges them and reports them through its LatencyHistograms diagnostics.
+ */
+XAPI int32_t ism_monitoring_getLatencyStats (
+        char               * action,
+        ism_json_parse_t   * inputJSONObj,
+        concat_alloc_t     * outputBuffer )
+{
+    char *latencyOutput = NULL;
+    char rbuf[256];
+    int rc = ism_engine_diagnostics("LatencyHistograms", "", &latencyOutput, NULL, 0, NULL);
+    if ( rc != ISMRC_OK ) {
+        TRACE(5, "%s: failed to query the latency statistics. rc=%d\n", __FUNCTION__, rc);
+        sprintf(rbuf, "{ \"RC\":\"%d\", \"ErrorString\":\"Failed to query the latency statistics.\" }", rc);
+        ism_common_allocBufferCopyLen(outputBuffer,rbuf,strlen(rbuf));
+    } else {
+        ism_common_allocBufferCopyLen(outputBuffer,latencyOutput,strlen(latencyOutput));
+        ism_engine_freeDiagnosticsOutput(latencyOutput);
+    }
+    return rc;
+}
 /*******************************************************SNAPSHOT OF MEMORY***********************/
 
 
@@ -103,6 +103,17 @@ XAPI int32_t ism_monitoring_getDetailedMemoryStats (
         ism_json_parse_t   * inputJSONObj,
         concat_alloc_t     * outputBuffer );
 
+/**
+ * Messaging path latency monitoring data action handler
+ *
+ * Returns the latency histograms and percentiles recorded by the Engine
+ * for each measured point on the messaging path.
+ */
+XAPI int32_t ism_monitoring_getLatencyStats (
+        char               * action,
+        ism_json_parse_t   * inputJSONObj,
+        concat_alloc_t     * outputBuffer );
+
 
 #ifdef __cplusplus
 }
@@ -714,6 +714,12 @@ XAPI int ism_process_monitoring_action(ism_transport_t *transport, const char *i
             break;
         }
 
+        case ismMON_STAT_Latency:
+        {
+            *rc = ism_monitoring_getLatencyStats(action, &parseobj, output_buffer);
+            break;
+        }
+
         default:
         {
             *rc = ISMRC_NotFound;
@@ -405,6 +405,8 @@ int ism_monitoring_getStatType(char *actionString) {
         return ismMON_STAT_Forwarder;
     else if ( !strcasecmp(actionString, "ResourceSet"))
         return ismMON_STAT_ResourceSet;
+    else if ( !strcasecmp(actionString, "Latency"))
+        return ismMON_STAT_Latency;
     return ismMON_STAT_None;
 }
 
@@ -699,6 +701,7 @@ int ism_monitoring_restapi_stateQuery(ism_http_t *http, ism_rest_api_cb callback
 		case ismMON_STAT_DestinationMappingRule:
 		case ismMON_STAT_Security:
 		case ismMON_STAT_Cluster:
+		case ismMON_STAT_Latency:
 		case ismMON_STAT_Store:
 		case ismMON_STAT_HA:
 		case ismMON_STAT_Memory:
@@ -37,9 +37,11 @@
 /*
  * Server version:
  * 2.0.0.0 Is the original version
+ * 2.1.0.0 Adds stream connections
  */
 int fwd_Version2_0       = MkVersion(2,0,0,0);
-int fwd_Version_Current  = MkVersion(2,0,0,0);
+int fwd_Version2_1       = MkVersion(2,1,0,0);
+int fwd_Version_Current  = MkVersion(2,1,0,0);
 
 /*
  * Dummpy endpoint so we do not segfault
@@ -73,6 +75,7 @@ uint64_t fwd_flowCount = 100;
 uint64_t fwd_flowSize = 1048576;
 uint32_t fwd_maxXA = 100;
 uint32_t fwd_minXA = 2;
+int      fwd_streams = 1;
 
 /*
  * Global variables
@@ -85,6 +88,8 @@ struct ssl_ctx_st * fwd_tlsCTX = NULL;     /* TLS context  */
 volatile int  fwd_stopping = 0;
 int fwd_commit_time = 100;
 int fwd_commit_count = 1000;
+int fwd_commit_latency = 0;       /* Target batching latency in milliseconds, 0=use a fixed commit count */
+int fwd_commit_max = 10000;       /* Largest adaptive commit count */
 ism_timer_t fwd_commit_timer = NULL;
 int fwd_enabled = 1;
 
@@ -342,6 +347,67 @@ static void putQueueStats(concat_alloc_t * buf, char * xbuf, const char * name,
 }
 
 
+/*
+ * Put out stats for the reliable streams of a channel
+ */
+static void putStreamStats(concat_alloc_t * buf, char * xbuf, ism_fwd_channel_t * channel) {
+    int  i;
+    ism_json_putBytes(buf, ",\n    \"Streams\": [");
+    for (i=0; i<channel->stream_count; i++) {
+        fwd_stream_t * stream = channel->stream+i;
+        int sendrate = calcRate(channel, stream->write_msg, stream->old_write);
+        sprintf(xbuf, "%s\n      { \"Stream\":%d, \"SentMsgs\":%lu, \"SentBytes\":%lu, \"MsgSendRate\":%u, \"Suspend\":%lu }",
+            i ? "," : "", i, stream->write_msg, stream->write_bytes, sendrate, stream->suspend);
+        ism_json_putBytes(buf, xbuf);
+    }
+    ism_json_putBytes(buf, " ]");
+}
+
+
+/*
+ * Put out the commit batching stats for the incoming connections of a channel.
+ * The rate and counts are summed over the streams, and the commit count and time are averaged.
+ */
+static void putBatchStats(concat_alloc_t * buf, char * xbuf, ism_fwd_channel_t * channel) {
+    uint64_t batches = 0;
+    uint64_t timed = 0;
+    uint64_t target = 0;
+    double   rate = 0.0;
+    double   rtt = 0.0;
+    int      count = 0;
+    int      i;
+
+    pthread_mutex_lock(&channel->lock);
+    if (channel->in_state == CHST_Open) {
+        for (i=0; i<FWD_MAX_STREAMS; i++) {
+            ism_transport_t * transport = i ? channel->stream[i].in_stream : channel->in_channel;
+            if (transport) {
+                ismFwdPobj_t * pobj = transport->pobj;
+                pthread_spin_lock(&pobj->sessionlock);
+                batches += pobj->commitBatches;
+                timed   += pobj->commitTimed;
+                target  += pobj->commitTarget;
+                rate    += pobj->msgRate;
+                rtt     += pobj->commitRTT;
+                pthread_spin_unlock(&pobj->sessionlock);
+                count++;
+            }
+        }
+    }
+    pthread_mutex_unlock(&channel->lock);
+    if (count) {
+        target /= count;
+        rtt /= count;
+    }
+    sprintf(xbuf, ",\n"
+        "    \"Batching\": { \"Adaptive\":%s, \"LatencyTarget\":%d, \"CommitCount\":%lu, \"MsgArrivalRate\":%u,\n"
+        "        \"CommitTime\":%.3f, \"Transactions\":%lu, \"TimedTransactions\":%lu }",
+        fwd_commit_latency ? "true" : "false", fwd_commit_latency, count ? target : (uint64_t)fwd_commit_count,
+        (uint32_t)rate, rtt * 1000.0, batches, timed);
+    ism_json_putBytes(buf, xbuf);
+}
+
+
 /*
  * Output on forwarder channel stat
  */
@@ -406,6 +472,9 @@ static void channelStat(concat_alloc_t * buf, ism_fwd_channel_t * channel, ism_t
     /* Put out the queue stats */
     putQueueStats(buf, xbuf, "Reliable",   1, channel, &rs_stat.q1, channel->suspend1);
     putQueueStats(buf, xbuf, "Unreliable", 0, channel, &rs_stat.q0, channel->suspend0);
+    if (channel->stream_count > 1)
+        putStreamStats(buf, xbuf, channel);
+    putBatchStats(buf, xbuf, channel);
     ism_json_putBytes(buf, "\n  }");
 }
 
@@ -414,6 +483,9 @@ static void channelStat(concat_alloc_t * buf, ism_fwd_channel_t * channel, ism_t
  * Periodic update of rate info
  */
 static void updateChannelRates(ism_fwd_channel_t * channel) {
+    int  i;
+    for (i=0; i<FWD_MAX_STREAMS; i++)
+        channel->stream[i].old_write = channel->stream[i].write_msg;
     if (channel->engineHandle) {
         ismEngine_RemoteServerStatistics_t rs_stat = {{0}};
         xUNUSED int zrc = ism_engine_getRemoteServerStatistics(channel->engineHandle, &rs_stat);
@@ -566,6 +638,11 @@ int ism_protocol_initForwarder(void) {
         fwd_minXA = fwd_maxXA-1;
     if (fwd_maxXA < 1)
         fwd_maxXA = 1;
+    fwd_streams   = ism_common_getIntConfig("ForwarderStreams",   fwd_streams);
+    if (fwd_streams < 1)
+        fwd_streams = 1;
+    if (fwd_streams > FWD_MAX_STREAMS)
+        fwd_streams = FWD_MAX_STREAMS;
 
     rc = ism_cluster_registerProtocolEventCallback(ism_fwd_cluster_notification, NULL);
     if (rc) {
@@ -586,6 +663,12 @@ int ism_protocol_initForwarder(void) {
         fwd_commit_time = 20;
     if (fwd_commit_count < 1)
         fwd_commit_count = 1;
+    fwd_commit_latency = ism_common_getIntConfig("ForwarderCommitLatency", fwd_commit_latency);
+    fwd_commit_max   = ism_common_getIntConfig("ForwarderCommitMax",   fwd_commit_count*10);
+    if (fwd_commit_latency < 0)
+        fwd_commit_latency = 0;
+    if (fwd_commit_max < fwd_commit_count)
+        fwd_commit_max = fwd_commit_count;
 
     return 0;
 }
@@ -801,8 +884,11 @@ int ism_fwd_startMessaging(void) {
     /*
      * Start the commit timer
      */
+    int commit_period = fwd_commit_time;
+    if (fwd_commit_latency && fwd_commit_latency/2 < commit_period)
+        commit_period = fwd_commit_latency/2 < 5 ? 5 : fwd_commit_latency/2;
     fwd_commit_timer = ism_common_setTimerRate(ISM_TIMER_LOW, ism_fwd_commitTimeCheck, NULL,
-            fwd_commit_time*5, fwd_commit_time, TS_MILLISECONDS);
+            fwd_commit_time*5, commit_period, TS_MILLISECONDS);
 
     /*
      * Start channels
@@ -1197,8 +1283,9 @@ int ism_fwd_receive(ism_transport_t * transport, char * buf, int buflen, int com
             sync = 1;
             break;
 
-        case FwdAction_Connect:        /* h0=version, h1=timestamp, h2=name, h3=uid  */
-            rc = ism_fwd_doConnect(&action, hdr[0].val.i, hdr[1].val.l, hdr[2].val.s, hdr[3].val.s);
+        case FwdAction_Connect:        /* h0=version, h1=timestamp, h2=name, h3=uid, h4=stream */
+            rc = ism_fwd_doConnect(&action, hdr[0].val.i, hdr[1].val.l, hdr[2].val.s, hdr[3].val.s,
+                    (action.hdrcount > 4 && hdr[4].type == VT_Integer) ? hdr[4].val.i : 0);
             break;
 
         case FwdAction_ConnectReply:     /* h0=version, h1=timestamp, h2=rc, h3=flags */
@@ -1377,6 +1464,31 @@ int ism_fwd_closeConnection(ism_transport_t * transport, int rc, const char * re
     return 0;
 }
 
+/*
+ * Close the other outgoing connections of a channel which uses streams.
+ * The primary connection owns the engine objects so the channel is recovered as a whole.
+ */
+static void closeStreams(ism_fwd_channel_t * channel, ism_transport_t * transport, int rc) {
+    ism_transport_t * tlist[FWD_MAX_STREAMS];
+    int  count = 0;
+    int  i;
+
+    pthread_mutex_lock(&channel->lock);
+    if (channel->stream_count || transport->pobj->stream || transport->pobj->streamsStarted) {
+        channel->stream_count = 0;
+        if (channel->out_channel && channel->out_channel != transport)
+            tlist[count++] = channel->out_channel;
+        for (i=1; i<FWD_MAX_STREAMS; i++) {
+            if (channel->stream[i].out_stream && channel->stream[i].out_stream != transport)
+                tlist[count++] = channel->stream[i].out_stream;
+        }
+    }
+    pthread_mutex_unlock(&channel->lock);
+    for (i=0; i<count; i++) {
+        tlist[i]->close(tlist[i], rc ? rc : ISMRC_ClosedByServer, 0, "Forwarder stream connection closed");
+    }
+}
+
 /*
  * The connection is closing.
  */
@@ -1398,6 +1510,11 @@ int ism_fwd_closing(ism_transport_t * transport, int rc, int clean, const char *
     pobj->closing = 1;
     pthread_spin_unlock(&pobj->sessionlock);
 
+    /* Closing any connection of a channel which uses streams closes all of them */
+    if (transport->originated && pobj->channel) {
+        closeStreams(pobj->channel, transport, rc);
+    }
+
     /* Subtract the "in progress" indicator. If it becomes negative,
      * no actions are in progress, so it is safe to clean up protocol data
      * and close the connection. If it is non-negative, there are
@@ -1440,6 +1557,9 @@ void ism_fwd_replyDoneConnection(int32_t rc, void * handle, void * vaction) {
         		((channel->out_state == CHST_Open) && (channel->out_channel == transport)))
             ism_cluster_remoteServerDisconnected(channel->clusterHandle);
         if (transport->originated) {
+            if (pobj->stream && channel->stream[pobj->stream].out_stream == transport) {
+                channel->stream[pobj->stream].out_stream = NULL;
+            }
             if (channel->out_channel == transport) {
                 channel->out_state = CHST_Closed;
                 channel->status_time = ism_common_currentTimeNanos();
@@ -1463,6 +1583,9 @@ void ism_fwd_replyDoneConnection(int32_t rc, void * handle, void * vaction) {
                channel->status_time = ism_common_currentTimeNanos();
                channel->in_channel = NULL;
             }
+            if (pobj->stream && channel->stream[pobj->stream].in_stream == transport) {
+                channel->stream[pobj->stream].in_stream = NULL;
+            }
         }
         pthread_mutex_unlock(&channel->lock);
     }
@@ -1586,7 +1709,8 @@ int ism_fwd_disconnectChannel(ism_fwd_channel_t * channel) {
 int ism_fwd_commitTimeCheck(ism_timer_t key, ism_time_t timestamp, void * userdata) {
     ism_fwd_channel_t * channel;
     double now = ism_common_readTSC();
-    double check_time = now - 0.05;   /* If the transaction is more than 50 milliseconds old */
+    /* If the transaction is older than the latency target, or 50 milliseconds for a fixed commit count */
+    double check_time = now - (fwd_commit_latency ? fwd_commit_latency / 1000.0 : 0.05);
     pthread_mutex_lock(&fwd_configLock);
     if (fwd_startMessaging && !fwd_stopping) {
         channel = fwd_channelList;
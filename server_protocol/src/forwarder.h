@@ -58,6 +58,13 @@
  *
  * If the sender terminates before a transaction is prepared, all un-ACKed messages should be marked
  * for redelivery.
+ *
+ * Starting with version 2.1 the sender can spread reliable messages over additional stream
+ * connections.  A stream connection sends a Connect with a stream index and is opened only after
+ * recovery on the primary connection is complete.  The receiver gives each stream its own
+ * transaction pipeline, and the sender selects the stream by a hash of the topic so messages for
+ * a topic stay in order.  The engine objects are owned by the primary connection, and closing
+ * any connection of the channel closes all of them so that recovery is done on the primary.
  */
 
 /*
@@ -74,7 +81,7 @@ enum FwdAction_e {
     FwdAction_CommitReply  = 0x08,   /* h0=xid h1=rc */
     FwdAction_RollbackReply= 0x09,   /* h0=xid */
     /* Sent as first message on the forwarding channel, expects ConnectReply */
-    FwdAction_Connect      = 0x0E,   /* h0=version, h1=time, h2=name, h3=uid h4=xids p=config */
+    FwdAction_Connect      = 0x0E,   /* h0=version, h1=time, h2=name, h3=uid h4=stream p=config */
 
     /* Receiver to Sender */
     FwdAction_ConnectReply = 0x11,   /* h0=version, h2=time, h3=rc, h4=xids */
@@ -94,6 +101,20 @@ enum FwdAction_e {
     FwdAction_Disconnect   = 0x23,   /* h0=rc, h1=reason */
 };
 
+#define FWD_MAX_STREAMS 16
+
+/*
+ * Forwarding stream.  Stream 0 is the primary connection.
+ */
+typedef struct fwd_stream_t {
+    ism_transport_t * out_stream;     /* Outgoing stream connection */
+    ism_transport_t * in_stream;      /* Incoming stream connection */
+    uint64_t     write_msg;           /* Reliable messages sent on this stream */
+    uint64_t     write_bytes;         /* Reliable bytes sent on this stream */
+    uint64_t     old_write;           /* Previous send count */
+    uint64_t     suspend;             /* Count of suspends for this stream */
+} fwd_stream_t;
+
 /*
  * Define channel object
  */
@@ -146,6 +167,9 @@ struct ismProtocol_RemoteServer_t {
     struct ismEngine_RemoteServer_t *  engineHandle;
     struct fmd_xa_t *  xa;
     ism_timer_t  retry_timer;         /* The timer object for the retry timer */
+    uint32_t     stream_count;        /* Active outgoing streams, 0 when only the primary is used */
+    uint32_t     resvi3;
+    fwd_stream_t stream[FWD_MAX_STREAMS];
 };
 typedef struct ismProtocol_RemoteServer_t ism_fwd_channel_t;
 
@@ -179,6 +203,7 @@ typedef struct fwd_xa_t {
     uint8_t prepared;
     uint8_t commit;
     uint8_t resv[2];
+    double  prepare_time;             /* Time the prepare was sent (receiver only) */
 } fwd_xa_t;
 
 typedef struct fwd_xa_info_t {
@@ -191,6 +216,7 @@ typedef struct fwd_xa_info_t {
     int                    seqcount;          /* Number of messages in current transaction */
     int                    seqmax;            /* Allocated size of sequence number table */
     int                    readyMsgCounter;
+    int                    commitCount;       /* Message count at which the transaction is prepared */
 } fwd_xa_info_t;
 
 
@@ -241,7 +267,17 @@ typedef struct ism_protobj_t {
     uint32_t                preparedXA;        /* Count of prepared transactions */
     uint16_t                xaInfoListSize;
     uint8_t                 closing;
+    uint8_t                 stream;            /* Stream index, 0 for the primary connection */
+    uint8_t                 streamWait;        /* Streams not yet connected (primary only) */
+    uint8_t                 startPending;      /* Start delivery when the streams are connected */
+    uint8_t                 streamsStarted;    /* Streams have been requested (primary only) */
     uint8_t                 resv;
+    uint32_t                commitTarget;      /* Adaptive commit count for new transactions */
+    double                  batchStart;        /* Time the current transaction was started */
+    double                  msgRate;           /* Smoothed reliable message arrival rate */
+    double                  commitRTT;         /* Smoothed time from prepare to commit */
+    uint64_t                commitBatches;     /* Count of transactions prepared */
+    uint64_t                commitTimed;       /* Count of transactions prepared by the commit timer */
 } ism_protobj_t;
 
 typedef struct ism_protobj_t   ismFwdPobj_t;
@@ -337,13 +373,17 @@ extern uint64_t fwd_flowCount;
 extern uint64_t fwd_flowSize;
 extern int      fwd_unit_test;
 extern int      fwd_Version2_0;
+extern int      fwd_Version2_1;
 extern int      fwd_Version_Current;
 extern pthread_mutex_t fwd_configLock;
 extern int fwd_commit_count;
 extern int fwd_commit_time;
+extern int fwd_commit_latency;
+extern int fwd_commit_max;
 
 extern uint32_t fwd_maxXA;
 extern uint32_t fwd_minXA;
+extern int      fwd_streams;
 
 
 /*
@@ -396,11 +436,26 @@ int ism_fwd_disconnectChannel(ism_fwd_channel_t * channel);
  */
 int ism_fwd_startChannel(ism_fwd_channel_t * channel);
 
+/*
+ * Start an additional stream connection for a channel
+ */
+int ism_fwd_startStream(ism_fwd_channel_t * channel, int stream);
+
+/*
+ * Resume the primary connection when a stream connection resumes
+ */
+int ism_fwd_resumeStream(ism_transport_t * transport, void * userdata);
+
+/*
+ * Initialize the adaptive commit state of a receiver connection
+ */
+void ism_fwd_initBatching(ismFwdPobj_t * pobj);
+
 /*
  * Handle a Connection action
  */
 int ism_fwd_doConnect(ism_fwd_act_t * action, uint32_t version, uint64_t timest,
-        const char * name, const char * uid);
+        const char * name, const char * uid, int stream);
 
 /*
  * Handle a Message action
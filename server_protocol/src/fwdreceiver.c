@@ -48,16 +48,17 @@ ism_fwd_channel_t * ism_fwd_newChannel(const char * serverUID, const char * serv
 int  ism_fwd_listDeliveryHandle(ism_fwd_channel_t * channel, uint64_t * seqn, ismEngine_DeliveryHandle_t * deliveryh, int count);
 void ism_fwd_replyCloseClient(ism_transport_t * transport);
 static void replyEngineCommit(int32_t rc, void * handle, void * vaction);
-static void fwdCreateXA(ism_transport_t * transport);
+static void fwdCreateXA(ism_transport_t * transport, int timed);
 static void fwdReliableACK(fwd_msgact_t * action);
 /*
  * Sequence for the global transactions
  */
 static uint64_t fwd_xid_seqn = 0;
 
-static fwd_xa_info_t * createXAInfo(const char * gtrid, void * handle, uint64_t sequence) {
-    fwd_xa_info_t * xaInfo = ism_common_malloc(ISM_MEM_PROBE(ism_memory_protocol_misc,229),sizeof(fwd_xa_info_t)+(2*fwd_commit_count*sizeof(uint64_t)));
-    xaInfo->seqmax = 2*fwd_commit_count;
+static fwd_xa_info_t * createXAInfo(const char * gtrid, void * handle, uint64_t sequence, int commitCount) {
+    fwd_xa_info_t * xaInfo = ism_common_malloc(ISM_MEM_PROBE(ism_memory_protocol_misc,229),sizeof(fwd_xa_info_t)+(2*commitCount*sizeof(uint64_t)));
+    xaInfo->seqmax = 2*commitCount;
+    xaInfo->commitCount = commitCount;
     xaInfo->seqnum = (uint64_t*)(xaInfo+1);
     xaInfo->seqcount = 0;
     strcpy(xaInfo->gtrid, gtrid);
@@ -69,6 +70,67 @@ static fwd_xa_info_t * createXAInfo(const char * gtrid, void * handle, uint64_t
     return xaInfo;
 }
 
+/*
+ * Initialize the adaptive commit state of a receiver connection
+ */
+void ism_fwd_initBatching(ismFwdPobj_t * pobj) {
+    pobj->commitTarget = fwd_commit_count;
+    pobj->batchStart = ism_common_readTSC();
+    pobj->msgRate = 0.0;
+    pobj->commitRTT = 0.0;
+}
+
+/*
+ * Adapt the commit count when a transaction is closed.  This is called with the session lock held.
+ *
+ * A message waits for the transaction to fill and then for the prepare and commit round trip,
+ * so the commit count is the arrival rate times the part of the latency target left after the
+ * round trip.  At least a quarter of the target is used for filling so that a slow commit
+ * results in larger rather than smaller transactions.
+ */
+static void adaptCommitCount(ismFwdPobj_t * pobj, int count, int timed, double now) {
+    double elapsed = now - pobj->batchStart;
+    double target;
+    double fill;
+
+    pobj->commitBatches++;
+    if (timed)
+        pobj->commitTimed++;
+    pobj->batchStart = now;
+    if (!fwd_commit_latency || elapsed <= 0.0)
+        return;
+
+    /* Smooth the arrival rate */
+    if (pobj->msgRate == 0.0)
+        pobj->msgRate = count / elapsed;
+    else
+        pobj->msgRate = 0.75 * pobj->msgRate + 0.25 * (count / elapsed);
+
+    target = fwd_commit_latency / 1000.0;
+    fill = target - pobj->commitRTT;
+    if (fill < target / 4)
+        fill = target / 4;
+    fill *= pobj->msgRate;
+    if (fill < 1.0)
+        pobj->commitTarget = 1;
+    else if (fill > fwd_commit_max)
+        pobj->commitTarget = fwd_commit_max;
+    else
+        pobj->commitTarget = (uint32_t)fill;
+}
+
+/*
+ * Record the time from prepare to commit of a receiver transaction
+ */
+static void adaptCommitTime(ismFwdPobj_t * pobj, double rtt) {
+    pthread_spin_lock(&pobj->sessionlock);
+    if (pobj->commitRTT == 0.0)
+        pobj->commitRTT = rtt;
+    else
+        pobj->commitRTT = 0.75 * pobj->commitRTT + 0.25 * rtt;
+    pthread_spin_unlock(&pobj->sessionlock);
+}
+
 static void destroyXAInfo(fwd_xa_info_t * xaInfo) {
     if(xaInfo){
         if(xaInfo->seqnum != ((uint64_t*)(xaInfo+1)))
@@ -269,14 +331,16 @@ static void replyConnect(int32_t rc, void * handle, void * vaction) {
                 transport->clientID, transport->index, rc);
         if (action->rc == 0) {
             pobj->session_handle = handle;
-            if (pobj->channel->receiver_xa == NULL && pobj->channel->sender_xa == NULL) {
+            /* A stream is only opened after recovery so it always starts its own transaction */
+            if (pobj->stream || (pobj->channel->receiver_xa == NULL && pobj->channel->sender_xa == NULL)) {
                 char gtrid[64];
                 uint64_t sequence = ism_fwd_newGtrid(gtrid, pobj->channel->uid);
                 fwd_xa_t * xa = ism_fwd_makeXA(gtrid, 'R', sequence);
                 ism_fwd_linkXA(pobj->channel, xa, 0, 1);
-                fwd_xa_info_t * xaInfo = createXAInfo(gtrid, NULL, sequence);
+                fwd_xa_info_t * xaInfo = createXAInfo(gtrid, NULL, sequence, pobj->commitTarget);
                 pthread_spin_lock(&pobj->sessionlock);
                 pobj->currentXA = xaInfo;
+                pobj->batchStart = ism_common_readTSC();
                 pthread_spin_unlock(&pobj->sessionlock);
                 action->action = Action_reply;
                 pobj->channel->start_xa = ism_common_readTSC();
@@ -361,22 +425,34 @@ static int fwdCloseConnectionTimer(ism_timer_t key, ism_time_t timestamp, void *
 /*
  * Process a connect action.
  * Look up the channel and if found attach this connection as the incomming connection.
+ * A non-zero stream attaches the connection as an additional stream of the channel.
  */
 int ism_fwd_doConnect(ism_fwd_act_t * action, uint32_t version, uint64_t timest,
-        const char * name, const char * uid) {
+        const char * name, const char * uid, int stream) {
     ism_fwd_channel_t * channel;
     ism_transport_t * transport = action->transport;
     fwd_conact_t act = {0};
-    char clientid[32];
+    char clientid[48];
 
+    if (stream < 0 || stream >= FWD_MAX_STREAMS) {
+        action->rc = ISMRC_BadClientData;
+        ism_common_setError(action->rc);
+        return 0;
+    }
 
     if (!name)
         name = "";
     transport->name = ism_transport_putString(transport, name);
     strcpy(clientid, "__Receiver_");
     ism_common_strlcat(clientid, uid, sizeof(clientid));
+    if (stream) {
+        char sbuf[16];
+        sprintf(sbuf, ".%d", stream);
+        ism_common_strlcat(clientid, sbuf, sizeof(clientid));
+    }
     transport->clientID = ism_transport_putString(transport, clientid);
     transport->ready = 2;
+    ism_fwd_initBatching(transport->pobj);
 
     pthread_mutex_lock(&fwd_configLock);
     channel = ism_fwd_findChannel(uid);
@@ -391,6 +467,34 @@ int ism_fwd_doConnect(ism_fwd_act_t * action, uint32_t version, uint64_t timest,
     }
     pthread_mutex_lock(&channel->lock);
 
+    /*
+     * Attach a stream connection.  The primary connection does the recovery for the channel.
+     */
+    if (stream) {
+        ism_transport_t * prev = channel->stream[stream].in_stream;
+        if (prev) {
+            TRACE(3, "Submit job to close the previous incoming stream: index=%u stream=%d ServerName=%s ServerUID=%s\n",
+                    prev->index, stream, channel->name, channel->uid);
+            ism_transport_submitAsyncJobRequest(prev, fwdHandleClientIdReuse, "Close previous incoming stream", ISMRC_ClientIDReused);
+            ism_common_setTimerOnce(ISM_TIMER_LOW, (ism_attime_t) fwdCloseConnectionTimer, transport, 1000000000);
+            pthread_mutex_unlock(&channel->lock);
+            pthread_mutex_unlock(&fwd_configLock);
+            return 0;
+        }
+        channel->stream[stream].in_stream = transport;
+        transport->pobj->channel = channel;
+        transport->pobj->stream = stream;
+        act.action = Action_createConnection;
+        act.transport = transport;
+        act.timestamp = timest;
+        act.version = version;
+        pthread_mutex_unlock(&channel->lock);
+        pthread_mutex_unlock(&fwd_configLock);
+
+        replyConnect(0, NULL, &act);
+        return 0;
+    }
+
     if (channel->in_channel && channel->in_state == CHST_Open) {
         TRACE(3, "Submit job to close the previous incoming channel: index=%u ServerName=%s ServerUID=%s\n",
                 channel->in_channel->index, channel->name, channel->uid);
@@ -552,7 +656,7 @@ int ism_fwd_doMessage(ism_fwd_act_t * action, uint64_t seqnum, int msgtype,
             act.transport = transport;
             if(action->action == FwdAction_RMessage) {
                 pthread_spin_lock(&pobj->sessionlock);
-                if(addMessageToXA(transport, pobj->currentXA, seqnum) == fwd_commit_count)
+                if(addMessageToXA(transport, pobj->currentXA, seqnum) == pobj->currentXA->commitCount)
                     createXA = 1;
                 htran = pobj->currentXA->handle;
                 act.xaHandle = htran;
@@ -568,12 +672,12 @@ int ism_fwd_doMessage(ism_fwd_act_t * action, uint64_t seqnum, int msgtype,
                       rc = ISMRC_OK;
                 };
                 if((rc == ISMRC_OK) && createXA) {
-                    fwdCreateXA(transport);
+                    fwdCreateXA(transport, 0);
                 }
                 fwdReplyPublish(rc, NULL, &act);
             } else {
                 if(createXA)
-                    fwdCreateXA(transport);
+                    fwdCreateXA(transport, 0);
             }
         }
         /* For an unreliable message without a processed response, just send it to engine */
@@ -685,6 +789,16 @@ static void replyDoPrepare(int rc, void * handle, void * vaction) {
 static void sendPrepareXA(ism_transport_t * transport, fwd_xa_info_t * xaInfo) {
     char xbuf[10240];
     concat_alloc_t buf = {xbuf, sizeof xbuf, 6};
+    ism_fwd_channel_t * channel = transport->pobj->channel;
+    fwd_xa_t * xa;
+
+    /* Keep the prepare time for the adaptive commit count */
+    pthread_mutex_lock(&channel->lock);
+    xa = ism_fwd_findXA(channel, xaInfo->gtrid, 0, 0);
+    if (xa)
+        xa->prepare_time = ism_common_readTSC();
+    pthread_mutex_unlock(&channel->lock);
+
     /* Send prepare to sender */
     ism_protocol_putStringValue(&buf, xaInfo->gtrid);
     ism_protocol_putIntValue(&buf, xaInfo->seqcount);
@@ -728,7 +842,7 @@ static void replyCreateXA(int rc, void * handle, void * vaction) {
         return;
     }
     pobj->transaction = handle;
-    xaInfo = createXAInfo(action->gtrid, handle, action->sequence);
+    xaInfo = createXAInfo(action->gtrid, handle, action->sequence, pobj->commitTarget);
     pthread_spin_lock(&pobj->sessionlock);
     xaInfo2prepare = pobj->currentXA;
     pobj->currentXA = xaInfo;
@@ -757,12 +871,20 @@ static void replyCreateXA(int rc, void * handle, void * vaction) {
 }
 
 
-static void fwdCreateXA(ism_transport_t * transport) {
+/*
+ * Start a new global transaction and prepare the current one when all of its messages are published.
+ * The timed indicator is set when the transaction is closed by the commit timer.
+ */
+static void fwdCreateXA(ism_transport_t * transport, int timed) {
     ism_protobj_t * pobj = transport->pobj;
     ismEngine_TransactionHandle_t transh;
     fwd_xatr_t act = {0};
     fwd_xa_t * xa;
     int ipcount = __sync_fetch_and_add(&transport->pobj->inprogress, 1);
+    pthread_spin_lock(&pobj->sessionlock);
+    if (pobj->currentXA)
+        adaptCommitCount(pobj, pobj->currentXA->seqcount, timed, ism_common_readTSC());
+    pthread_spin_unlock(&pobj->sessionlock);
     act.sequence = ism_fwd_newGtrid(act.gtrid, transport->pobj->channel->uid);
     act.transport = transport;
     xa = ism_fwd_makeXA(act.gtrid, 'R', act.sequence);
@@ -949,11 +1071,12 @@ static void replyRecover(int32_t rc, void * handle, void * vaction) {
         uint64_t sequence = ism_fwd_newGtrid(gtrid, pobj->channel->uid);
         xa = ism_fwd_makeXA(gtrid, 'R', sequence);
         ism_fwd_linkXA(pobj->channel, xa, 0, 1);
-        fwd_xa_info_t * xaInfo = createXAInfo(gtrid, NULL, sequence);
+        fwd_xa_info_t * xaInfo = createXAInfo(gtrid, NULL, sequence, pobj->commitTarget);
         pthread_spin_lock(&pobj->sessionlock);
         if(pobj->currentXA)
             destroyXAInfo(pobj->currentXA);
         pobj->currentXA = xaInfo;
+        pobj->batchStart = ism_common_readTSC();
         pthread_spin_unlock(&pobj->sessionlock);
         action->action = Action_reply;
         pobj->channel->start_xa = ism_common_readTSC();
@@ -1062,6 +1185,7 @@ static void replyEngineCommit(int32_t rc, void * handle, void * vaction) {
     ism_fwd_channel_t * channel = transport->pobj->channel;
     fwd_xa_t * xa;
     int forget = 0;
+    double rtt = 0.0;
 
     if (rc == ISMRC_HeuristicallyCommitted)
         rc = 0;
@@ -1078,6 +1202,8 @@ static void replyEngineCommit(int32_t rc, void * handle, void * vaction) {
     pthread_mutex_lock(&channel->lock);
     xa = ism_fwd_findXA(channel, action->gtrid, 0, 0);
     if (xa) {
+        if (!rc && xa->prepare_time)
+            rtt = ism_common_readTSC() - xa->prepare_time;
         if (++xa->commit > 1) {
             ism_fwd_unlinkXA(channel, xa, 0, 0);
             forget = 1;
@@ -1087,6 +1213,8 @@ static void replyEngineCommit(int32_t rc, void * handle, void * vaction) {
             action->gtrid, transport->index, transport->name);
     }
     pthread_mutex_unlock(&channel->lock);
+    if (rtt > 0.0)
+        adaptCommitTime(transport->pobj, rtt);
     if (forget) {
         xUNUSED int zrc = ism_engine_forgetGlobalTransaction(&xa->xid, NULL, 0, NULL);
         TRACE(6, "Forwarder complete transaction: xid=fwd:R:%s index=%u name=%s\n",
@@ -1387,22 +1515,39 @@ uint64_t ism_fwd_newGtrid(char * gtrid, const char * sender) {
  */
 int ism_fwd_timedCommit(ism_timer_t key, ism_time_t timestamp, void * userdata) {
     ism_fwd_channel_t * channel = (ism_fwd_channel_t *) userdata;
+    ism_transport_t * tlist[FWD_MAX_STREAMS];
+    int  count = 0;
+    int  i;
 
 	ism_common_cancelTimer(key);
+
+    /*
+     * Find the incoming connections of the channel which are not closing
+     */
     pthread_mutex_lock(&channel->lock);
     if (channel->in_state == CHST_Open) {
-        ism_transport_t * transport = channel->in_channel;
-        ism_protobj_t * pobj = transport->pobj;
-        int ipcount = __sync_fetch_and_add(&transport->pobj->inprogress, 1);
-        pthread_mutex_unlock(&channel->lock);
-        if(ipcount < 0) {
-            __sync_fetch_and_sub(&transport->pobj->inprogress, 1);
-            return 0;
+        for (i=0; i<FWD_MAX_STREAMS; i++) {
+            ism_transport_t * transport = i ? channel->stream[i].in_stream : channel->in_channel;
+            if (transport) {
+                int ipcount = __sync_fetch_and_add(&transport->pobj->inprogress, 1);
+                if (ipcount < 0) {
+                    __sync_fetch_and_sub(&transport->pobj->inprogress, 1);
+                } else {
+                    tlist[count++] = transport;
+                }
+            }
         }
+    }
+    pthread_mutex_unlock(&channel->lock);
+
+    for (i=0; i<count; i++) {
+        ism_transport_t * transport = tlist[i];
+        ism_protobj_t * pobj = transport->pobj;
+        int ipcount;
         pthread_spin_lock(&pobj->sessionlock);
         if (pobj->currentXA && pobj->currentXA->seqcount) {
             pthread_spin_unlock(&pobj->sessionlock);
-            fwdCreateXA(transport);
+            fwdCreateXA(transport, 1);
         } else {
             pthread_spin_unlock(&pobj->sessionlock);
         }
@@ -1412,7 +1557,6 @@ int ism_fwd_timedCommit(ism_timer_t key, ism_time_t timestamp, void * userdata)
             ism_fwd_replyCloseClient(transport);
         }
     }
-    pthread_mutex_unlock(&channel->lock);
     return 0;
 }
 
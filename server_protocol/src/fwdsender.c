@@ -42,6 +42,7 @@ int ism_fwd_sendRecover(ism_transport_t * transport);
 int  ism_fwd_listDeliveryHandle(ism_fwd_channel_t * channel, uint64_t * seqn, ismEngine_DeliveryHandle_t * deliveryh, int incount);
 int  ism_fwd_addDeliveryHandle(ism_fwd_channel_t * channel, uint64_t seqn, ismEngine_DeliveryHandle_t deliveryh);
 ism_fwd_channel_t * ism_fwd_findChannel(const char * uid);
+int ism_fwd_resume(ism_transport_t * transport, void * userdata);
 
 /*
  * Outgoing connection connected callback.
@@ -59,7 +60,16 @@ int  ism_fwd_connected(ism_transport_t * transport, int rc) {
     /*
      * There is a TCP connection for the channel
      */
-    if (rc == 0) {
+    if (rc == 0 && pobj->stream) {
+        /* A stream connection does not change the channel state */
+        pthread_mutex_lock(&channel->lock);
+        if ((channel->stream[pobj->stream].out_stream != transport) || (channel->out_state != CHST_Open)) {
+            pthread_mutex_unlock(&channel->lock);
+            transport->close(transport, ISMRC_Error, 1, "Outgoing stream is in invalid state");
+            return 0;
+        }
+        pthread_mutex_unlock(&channel->lock);
+    } else if (rc == 0) {
         /* Set the state */
         pthread_mutex_lock(&fwd_configLock);
         pthread_mutex_lock(&channel->lock);
@@ -88,7 +98,9 @@ int  ism_fwd_connected(ism_transport_t * transport, int rc) {
         channel->dhalloc  = 0;             /* The allocated slots in the table */
         channel->dhextra  = 0;
         pthread_mutex_unlock(&channel->dhlock);
+    }
 
+    if (rc == 0) {
         pthread_spin_lock(&transport->lock);
         transport->ready = 1;
         channel->retry = 1;
@@ -104,7 +116,12 @@ int  ism_fwd_connected(ism_transport_t * transport, int rc) {
             ism_protocol_putStringValue(&buf, ism_common_getServerName());
             ism_protocol_putStringValue(&buf, ism_common_getServerUID());
         }
-        transport->send(transport, buf.buf+6, buf.used-6, (FwdAction_Connect<<8)+4, SFLAG_FRAMESPACE);
+        if (pobj->stream) {
+            ism_protocol_putIntValue(&buf, pobj->stream);
+            transport->send(transport, buf.buf+6, buf.used-6, (FwdAction_Connect<<8)+5, SFLAG_FRAMESPACE);
+        } else {
+            transport->send(transport, buf.buf+6, buf.used-6, (FwdAction_Connect<<8)+4, SFLAG_FRAMESPACE);
+        }
         ism_common_freeAllocBuffer(&buf);
     }
 
@@ -118,6 +135,105 @@ int  ism_fwd_connected(ism_transport_t * transport, int rc) {
 }
 
 
+/*
+ * Start message delivery on the primary connection.
+ *
+ * When the remote server supports streams the stream connections are opened the first time
+ * delivery is started, which is after recovery is complete.  Delivery starts when all streams
+ * are connected so that messages for a topic are never moved between connections.
+ */
+static int fwdStartPrimary(ism_transport_t * transport) {
+    ismFwdPobj_t * pobj = transport->pobj;
+    ism_fwd_channel_t * channel = pobj->channel;
+    int  startStreams = 0;
+    int  i;
+
+    if (pobj->stream)
+        return 0;
+    pthread_mutex_lock(&channel->lock);
+    if (!pobj->streamsStarted && fwd_streams > 1 && channel->version >= fwd_Version2_1) {
+        pobj->streamsStarted = 1;
+        startStreams = 1;
+    }
+    pthread_mutex_unlock(&channel->lock);
+
+    pthread_spin_lock(&pobj->sessionlock);
+    if (startStreams)
+        pobj->streamWait = fwd_streams-1;
+    if (pobj->streamWait) {
+        pobj->startPending = 1;
+        pthread_spin_unlock(&pobj->sessionlock);
+        if (startStreams) {
+            TRACE(5, "Start forwarding streams: name=%s count=%d\n", channel->name, fwd_streams);
+            for (i=1; i<fwd_streams; i++)
+                ism_fwd_startStream(channel, i);
+        }
+        return 0;
+    }
+    pthread_spin_unlock(&pobj->sessionlock);
+    return ism_engine_startMessageDelivery(pobj->session_handle,
+            ismENGINE_START_DELIVERY_OPTION_NONE, NULL, 0, NULL);
+}
+
+
+/*
+ * On ConnectReply for a stream connection, attach the stream to the primary connection.
+ * The stream uses the session of the primary for its transactions.
+ */
+static void fwdStreamReady(ism_transport_t * transport, int rc) {
+    ismFwdPobj_t * pobj = transport->pobj;
+    ism_fwd_channel_t * channel = pobj->channel;
+    ism_transport_t * primary;
+    ismFwdPobj_t * ppobj;
+    void * sessionh = NULL;
+    int  start = 0;
+    int  i;
+
+    pthread_mutex_lock(&channel->lock);
+    primary = channel->out_channel;
+    if (!rc && (!primary || channel->stream[pobj->stream].out_stream != transport))
+        rc = ISMRC_Closed;
+    if (!rc) {
+        ppobj = primary->pobj;
+        pthread_spin_lock(&ppobj->sessionlock);
+        pthread_spin_lock(&pobj->sessionlock);
+        pobj->session_handle = ppobj->session_handle;
+        pthread_spin_unlock(&pobj->sessionlock);
+        if (ppobj->streamWait && --ppobj->streamWait == 0) {
+            /* All streams are connected, use them for reliable messages */
+            for (i=0; i<fwd_streams; i++) {
+                channel->stream[i].write_msg = 0;
+                channel->stream[i].write_bytes = 0;
+                channel->stream[i].old_write = 0;
+                channel->stream[i].suspend = 0;
+            }
+            channel->stream_count = fwd_streams;
+            start = ppobj->startPending;
+            ppobj->startPending = 0;
+            sessionh = ppobj->session_handle;
+        }
+        pthread_spin_unlock(&ppobj->sessionlock);
+    }
+    pthread_mutex_unlock(&channel->lock);
+
+    if (start && sessionh) {
+        TRACE(5, "Forwarding streams connected: name=%s count=%d\n", channel->name, fwd_streams);
+        xUNUSED int zrc = ism_engine_startMessageDelivery(sessionh,
+                ismENGINE_START_DELIVERY_OPTION_NONE, NULL, 0, NULL);
+    }
+
+    if (rc) {
+        transport->close(transport, rc, 0, "Unable to create forwarding stream");
+    }
+
+    int32_t ipcount = __sync_sub_and_fetch(&pobj->inprogress, 1);
+    TRACE(8, "Leave fwdStreamReady, index=%u inprogress=%d\n", transport->index, ipcount);
+    if (UNLIKELY(ipcount < 0)) {
+        ism_fwd_replyCloseClient(transport);
+    }
+}
+
+
 /*
  * On ConnectReply, create engine objects for a sender forwarding channel.
  * This is restartable as an engine reply. If the engine functions return synchronously,
@@ -247,8 +363,7 @@ static void fwdConnectReplyAction(int32_t rc, void * handle, void * vaction) {
                 }
                 ism_fwd_sendRecover(transport);
             } else {
-                rc = ism_engine_startMessageDelivery(pobj->session_handle,
-                    ismENGINE_START_DELIVERY_OPTION_NONE, NULL, 0, NULL);
+                rc = fwdStartPrimary(transport);
                 if (rc == ISMRC_AsyncCompletion)
                     rc = 0;
                 action->rc = rc;
@@ -277,6 +392,12 @@ static void fwdConnectReplyAction(int32_t rc, void * handle, void * vaction) {
  * All of the work is handled in replyAction
  */
 int ism_fwd_doConnectReply(ism_fwd_act_t * action, int rc, int version, uint64_t tstamp, int flags) {
+    ismFwdPobj_t * pobj = action->transport->pobj;
+    if (pobj->stream) {
+        fwdStreamReady(action->transport, rc);
+        return 0;
+    }
+    pobj->channel->version = version;
     action->options = flags;
     action->paction = Action_createConnection;
     fwdConnectReplyAction(rc, NULL, action);
@@ -378,15 +499,138 @@ int ism_fwd_startChannel(ism_fwd_channel_t * channel) {
 }
 
 
+/*
+ * Start an additional stream connection for a channel.
+ * The stream has no engine objects of its own and is closed with the primary connection.
+ */
+int ism_fwd_startStream(ism_fwd_channel_t * channel, int stream) {
+    ismFwdPobj_t * pobj;
+    struct ssl_ctx_st * tlsCTX = NULL;
+    char clientid[48];
+    char sbuf[16];
+    int  rc;
+    ism_transport_t * transport = ism_transport_newOutgoing(ism_fwd_getOutEndpoint(), 1);
+    if (!transport) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&channel->lock);
+    if (channel->stream[stream].out_stream || !channel->out_channel || (channel->cc_state != CHST_Open)) {
+        ism_transport_freeTransport(transport);
+        pthread_mutex_unlock(&channel->lock);
+        return 0;
+    }
+    TRACE(6, "Start forwarding stream: name=%s uid=%s stream=%d\n", channel->name, channel->uid, stream);
+    channel->stream[stream].out_stream = transport;
+    pthread_mutex_unlock(&channel->lock);
+
+    /*
+     * Create outgoing connection
+     */
+    ism_security_create_context(ismSEC_POLICY_CONNECTION, transport, &transport->security_context);
+    transport->protocol = "fwd";
+    ism_fwd_connection(transport);
+    pobj = transport->pobj;
+    transport->connected = ism_fwd_connected;   /* Callback when connected */
+    transport->closing = ism_fwd_closing;
+    transport->resume = ism_fwd_resumeStream;
+    pobj->channel = channel;
+    pobj->stream = stream;
+    if (channel->secure) {
+        tlsCTX = fwd_tlsCTX;
+    }
+    transport->ready = 0;
+
+    transport->name = ism_transport_putString(transport, channel->name);
+    strcpy(clientid, "__Sender_");
+    ism_common_strlcat(clientid, channel->uid, sizeof(clientid));
+    sprintf(sbuf, ".%d", stream);
+    ism_common_strlcat(clientid, sbuf, sizeof(clientid));
+    transport->clientID = ism_transport_putString(transport, clientid);
+    transport->userid = "";
+
+    /*
+     * Do the connect, this completes in ism_fwd_connected()
+     */
+    transport->ready = 3;
+    rc = ism_transport_connect(transport, NULL, channel->ipaddr, channel->port, tlsCTX);
+    if (rc) {
+        char xbuf[256];
+        ism_common_formatLastError(xbuf, sizeof xbuf);
+        transport->close(transport, rc, 0, xbuf);
+    }
+    return rc;
+}
+
+
+/*
+ * Resume the primary connection when a stream connection can send again.
+ * Message delivery for all streams is done by the consumers of the primary connection.
+ */
+int ism_fwd_resumeStream(ism_transport_t * transport, void * userdata) {
+    ism_fwd_channel_t * channel = transport->pobj->channel;
+    ism_transport_t * primary;
+
+    pthread_mutex_lock(&channel->lock);
+    primary = channel->out_channel;
+    if (primary && primary->pobj->suspended) {
+        ism_fwd_resume(primary, userdata);
+    }
+    pthread_mutex_unlock(&channel->lock);
+    return 0;
+}
+
+
+/*
+ * Select the connection for a reliable message.
+ * The stream is selected by the hash of the topic so that the messages for a topic stay in order.
+ * The in progress count of the selected stream is incremented, and the primary connection
+ * is used if the streams are not active.
+ */
+static ism_transport_t * fwdSelectStream(ism_transport_t * transport, char * propp, uint32_t proplen, int * which) {
+    ism_fwd_channel_t * channel = transport->pobj->channel;
+    ism_transport_t * stransport = NULL;
+    int  stream_count = channel->stream_count;
+    int  stream;
+
+    *which = 0;
+    if (stream_count > 1 && proplen) {
+        ism_field_t f = {0};
+        concat_alloc_t pbuf = {propp, proplen, proplen};
+        ism_findPropertyNameIndex(&pbuf, ID_Topic, &f);
+        if (f.type != VT_String)
+            return transport;
+        stream = ism_strhash_fnv1a_32(f.val.s) % stream_count;
+        if (stream == 0)
+            return transport;
+        pthread_mutex_lock(&channel->lock);
+        if (channel->stream_count == stream_count) {
+            stransport = channel->stream[stream].out_stream;
+            if (stransport) {
+                int32_t ipcount = __sync_fetch_and_add(&stransport->pobj->inprogress, 1);
+                if (ipcount < 0) {
+                    __sync_fetch_and_sub(&stransport->pobj->inprogress, 1);
+                    stransport = NULL;
+                }
+            }
+        }
+        pthread_mutex_unlock(&channel->lock);
+        if (stransport) {
+            *which = stream;
+            return stransport;
+        }
+    }
+    return transport;
+}
+
+
 /*
  * Handle a start action
  */
 int ism_fwd_doStart(ism_fwd_act_t * action) {
     ism_transport_t * transport = action->transport;
-    ismFwdPobj_t * pobj = (ismFwdPobj_t *) transport->pobj;
 
-    xUNUSED int zrc = ism_engine_startMessageDelivery(pobj->session_handle,
-        ismENGINE_START_DELIVERY_OPTION_NONE, NULL, 0, NULL);
+    xUNUSED int zrc = fwdStartPrimary(transport);
     int32_t ipcount = __sync_sub_and_fetch(&transport->pobj->inprogress, 1);
     TRACE(8, "Leave ism_fwd_doStart, index=%u inprogress=%d\n", transport->index, ipcount);
     if (ipcount < 0) { /* BEAM suppression: constant condition */
@@ -419,11 +663,14 @@ bool ism_fwd_replyMessage(ismEngine_ConsumerHandle_t consumerh,
     uint64_t sqnum = 0;
 
     ism_transport_t * transport = NULL;
+    ism_transport_t * stransport;
     ism_protobj_t * pobj = NULL;
     int actionType;
+    int stream = 0;
 
     consumer = (ism_fwd_cons_t *) vaction;
     transport = consumer->transport;
+    stransport = transport;
     pobj = transport->pobj;
 
     flags = qos;
@@ -448,17 +695,23 @@ bool ism_fwd_replyMessage(ismEngine_ConsumerHandle_t consumerh,
 
     /*
      * QoS>0
+     * When streams are active the message is sent on the stream for its topic, and the
+     * flow control uses the prepared transactions of that stream.
      */
     if (qos) {
         assert(deliveryh);
         actionType = (FwdAction_RMessage<<8)+5;
         sqnum = pobj->sqnum++;
         ism_fwd_addDeliveryHandle(pobj->channel, sqnum, deliveryh);
+        stransport = fwdSelectStream(transport, propp, proplen, &stream);
+        pobj->channel->stream[stream].write_msg++;
+        pobj->channel->stream[stream].write_bytes += (proplen+bodylen);
         pthread_spin_lock(&pobj->sessionlock);
-        if (pobj->preparedXA > fwd_maxXA) {
+        if (stransport->pobj->preparedXA > fwd_maxXA) {
             if (!pobj->suspended) {
                 consumer->suspended = 1;
                 pobj->channel->suspend1++;
+                pobj->channel->stream[stream].suspend++;
                 TRACE(7, "Suspend fwd qos0 name=%s count=%lu\n", transport->name, pobj->flowControlAcks);
                 ism_engine_suspendMessageDelivery(consumerh, ismENGINE_SUSPEND_DELIVERY_OPTION_NONE);
                 returncode = false;
@@ -523,7 +776,7 @@ bool ism_fwd_replyMessage(ismEngine_ConsumerHandle_t consumerh,
     /*
      * Send the message
      */
-    int rc = transport->send(transport, buf.buf+6, buf.used-6, actionType, SFLAG_FRAMESPACE);
+    int rc = stransport->send(stransport, buf.buf+6, buf.used-6, actionType, SFLAG_FRAMESPACE);
     if (UNLIKELY(rc == SRETURN_SUSPEND)) {
         TRACE(7, "Suspend fwd transport: %s\n", transport->name);
 
@@ -540,6 +793,14 @@ bool ism_fwd_replyMessage(ismEngine_ConsumerHandle_t consumerh,
     pthread_spin_unlock(&pobj->sessionlock);
 
 
+    /* Release the stream */
+    if (stransport != transport) {
+        int32_t ipcount = __sync_sub_and_fetch(&stransport->pobj->inprogress, 1);
+        if (UNLIKELY(ipcount < 0)) {
+            ism_fwd_replyCloseClient(stransport);
+        }
+    }
+
     if (buf.inheap)
         ism_common_freeAllocBuffer(&buf);
     ism_engine_releaseMessage(msgh);
@@ -768,6 +1029,7 @@ void replyCommit(int rc, void * handle, void * vaction) {
     char xbuf[1024];
     concat_alloc_t buf = {xbuf, sizeof xbuf, 6};
     fwd_xa_t * xa;
+    int  resume = 0;
 
     pthread_mutex_lock(&channel->lock);
     xa = ism_fwd_findXA(channel, action->gtrid, 1, 0);
@@ -782,11 +1044,13 @@ void replyCommit(int rc, void * handle, void * vaction) {
     if(transport->pobj->preparedXA) {
         transport->pobj->preparedXA--;
         if (transport->pobj->preparedXA <= fwd_minXA) {
-            if (transport->pobj->suspended)
-                transport->resume(transport, NULL);
+            if (transport->pobj->suspended || transport->pobj->stream)
+                resume = 1;
         }
     }
     pthread_spin_unlock(&transport->pobj->sessionlock);
+    if (resume)
+        transport->resume(transport, NULL);
 
     /* Reply to the commit */
     ism_protocol_putStringValue(&buf, action->gtrid);
@@ -841,6 +1105,7 @@ static void replyRollbackPrepared(int32_t rc, void * handle, void * vaction) {
     char xbuf [512];
     concat_alloc_t buf = {xbuf, sizeof xbuf, 6};
     fwd_xa_t * xa;
+    int  resume = 0;
 
     pthread_mutex_lock(&channel->lock);
     xa = ism_fwd_findXA(channel, action->gtrid, 1, 0);
@@ -853,11 +1118,13 @@ static void replyRollbackPrepared(int32_t rc, void * handle, void * vaction) {
     if(transport->pobj->preparedXA) {
         transport->pobj->preparedXA--;
         if (transport->pobj->preparedXA <= fwd_minXA) {
-            if (transport->pobj->suspended)
-                transport->resume(transport, NULL);
+            if (transport->pobj->suspended || transport->pobj->stream)
+                resume = 1;
         }
     }
     pthread_spin_unlock(&transport->pobj->sessionlock);
+    if (resume)
+        transport->resume(transport, NULL);
     if (action->op == 'R') {
         ism_fwd_sendRecover(transport);
     }
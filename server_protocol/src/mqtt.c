@@ -249,6 +249,9 @@ HOT bool ism_mqtt_replyMessage(ismEngine_ConsumerHandle_t consumerh,
         ismMessageHeader_t * hdr, uint8_t areas,
         ismMessageAreaType_t areatype[areas], size_t areasize[areas],
         void * areaptr[areas], void * vaction, ismEngine_DelivererContext_t * delivererContext);
+HOT bool ism_mqtt_replyMessageBatch(ismEngine_ConsumerHandle_t consumerh, uint32_t options,
+        uint32_t count, ismEngine_DeliveredMessage_t * msgs, void * vaction,
+        ismEngine_DelivererContext_t * delivererContext);
 static int packetLength(int buflen) ;
 const char * ism_common_getErrorRepl(int which);
 
@@ -6845,6 +6848,29 @@ HOT bool ism_mqtt_replyMessage(ismEngine_ConsumerHandle_t consumerh,
 }
 
 
+/*
+ * Reply with a batch of received messages.  This is the engine batch callback from the message consumer.
+ * Each message is sent as in ism_mqtt_replyMessage.  As the transport appends consecutive frames to the
+ * tail of the send queue, the whole batch normally goes out in the same send buffer.  Every message in
+ * the batch must be processed even if the transport suspends us part way through.
+ */
+HOT bool ism_mqtt_replyMessageBatch(ismEngine_ConsumerHandle_t consumerh, uint32_t options,
+        uint32_t count, ismEngine_DeliveredMessage_t * msgs, void * vaction,
+        ismEngine_DelivererContext_t * delivererContext) {
+    bool returncode = true;
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        ismEngine_DeliveredMessage_t * msg = msgs + i;
+        if (!ism_mqtt_replyMessage(consumerh, msg->hDelivery, msg->hMessage, msg->deliveryId, msg->state,
+                options, &msg->msgHeader, msg->msgAreaCount, msg->areaTypes, msg->areaLengths,
+                msg->pAreaData, vaction, delivererContext))
+            returncode = false;
+    }
+    return returncode;
+}
+
+
 /*
  * Convert the JMS map or stream message to a JSON payload
  */
@@ -8083,6 +8109,14 @@ int ism_mqtt_connection(ism_transport_t * transport) {
 #undef TRACE_DOMAIN
 #define TRACE_DOMAIN ism_defaultTrace
 
+/*
+ * Start the MQTT protocol
+ */
+int ism_protocol_startMQTT(void) {
+    ism_engine_registerMessageBatchCallback(ism_mqtt_replyMessage, ism_mqtt_replyMessageBatch);
+    return 0;
+}
+
 /*
  * Initialize the MQTT protocol
  */
@@ -441,9 +441,10 @@ typedef struct ism_msgid_list_t ism_msgid_list_t;
  */
 typedef struct ism_msgid_info_t {
     __uint128_t handle; /* Saved handle            */
-    struct ism_msgid_info_t * next; /* Next entry or next free */
     uint16_t msgid; /* Message ID              */
     uint16_t state; /* Message state           */
+    uint8_t  inuse; /* The entry is in use     */
+    uint8_t  resv[3];
     int      pending;
 } ism_msgid_info_t;
 
@@ -16,65 +16,40 @@
 #undef TRACE_COMP
 #endif
 #define TRACE_COMP Mqtt
-static int g_numMsgIdMaps;
-static int g_msgIdMapCapacity;
-static ismHashMap **g_msgIdsMapTx;
-static ismHashMap **g_msgIdsMapRx;
-static struct drand48_data randBuffer;
+/*
+ * The message IDs in flight are kept in a table owned by each connection.
+ * All uses of the table are done holding the msgid lock of the connection so
+ * there are no global locks.
+ */
 void ism_msgid_init(void) {
-    int i;
-    g_numMsgIdMaps = ism_common_getIntConfig("NumMsgIdMaps", 10);
-    g_msgIdMapCapacity = ism_common_getIntConfig("MsgIdMapCapacity", 128 * 1024);
-
-    g_msgIdsMapTx 	= ism_common_calloc(ISM_MEM_PROBE(ism_memory_protocol_misc,62),g_numMsgIdMaps, sizeof(ismHashMap *));
-    g_msgIdsMapRx  	= ism_common_calloc(ISM_MEM_PROBE(ism_memory_protocol_misc,63),g_numMsgIdMaps, sizeof(ismHashMap *));
-
-    for (i = 0; i < g_numMsgIdMaps; i++) {
-        g_msgIdsMapTx[i] = ism_common_createHashMap(g_msgIdMapCapacity, HASH_INT64);
-        g_msgIdsMapRx[i] = ism_common_createHashMap(g_msgIdMapCapacity, HASH_INT64);
-    }
-    srand48_r(time(NULL), &randBuffer);
-
-    TRACE(5, "Initializing %d global Rx and Tx msgid hashmaps of size %d\n", g_numMsgIdMaps, g_msgIdMapCapacity);
+    TRACE(5, "Initializing the per connection msgid tables\n");
 }
 
 /*
  * Message ID list.
  * There is one list for each session which uses assigned message ID.
- * There are a set of slots and each one is the head of a chain.
- * Since we use the next available msgid, it should be common to
- * only use the slots as long as there are a small number of
- * outstanding messages.
+ * The in flight message IDs are kept in an open addressed table with linear probing
+ * and the message ID is its own hash.  As message IDs are normally assigned in order,
+ * the entries for a window of message IDs which fits in the table do not collide.
+ * The table is allocated on the first use and grows when it is half full, so a
+ * connection with no messages in flight has no table.
  */
 struct ism_msgid_list_t {
-    ism_msgid_info_t * freeList;
-    ismHashMap * idsMap;
+    ism_msgid_info_t * table;      /* Table of entries or NULL if not allocated */
     ism_transport_t * transport;
-    uint64_t client_uid;
-    uint16_t inUseCount;
-    uint16_t freeCount;
+    uint32_t size;                 /* Size of the table as a power of 2         */
+    uint32_t inUseCount;           /* Count of entries in use                   */
     uint16_t range;
     uint16_t rsrv;
 };
 
-#define COMPUTE_KEY(k,m,c)  \
-  k = (c);                  \
-  k <<=16;                  \
-  k = k | (m);
+#define MSGID_TABLE_MIN   16       /* Initial size of the table                  */
+#define MSGID_TABLE_KEEP  64       /* Largest table kept when it becomes empty   */
 
 ism_msgid_list_t * ism_create_msgid_list(ism_transport_t *transport, int isRX, uint16_t range) {
     ism_msgid_list_t * mlist;
-    mqttProtoObj_t * pobj = (mqttProtoObj_t*) transport->pobj;
-    int mapIdx;
     mlist = ism_common_calloc(ISM_MEM_PROBE(ism_memory_protocol_misc,64),1, sizeof(*mlist));
     mlist->transport = transport;
-    mlist->client_uid = pobj->client_uid;
-    mapIdx = mlist->client_uid % g_numMsgIdMaps;
-    if (isRX){
-        mlist->idsMap = g_msgIdsMapRx[mapIdx];
-    } else {
-        mlist->idsMap = g_msgIdsMapTx[mapIdx];
-    }
     mlist->range = range;
     return mlist;
 }
@@ -84,66 +59,101 @@ ism_msgid_list_t * ism_create_msgid_list(ism_transport_t *transport, int isRX, u
  */
 void ism_msgid_freelist(struct ism_msgid_list_t * mlist) {
     if (mlist) {
-        ism_msgid_info_t * entry;
-        while (mlist->freeList) {
-            entry = mlist->freeList;
-            mlist->freeList = entry->next;
-            ism_common_free(ism_memory_protocol_misc,entry);
-        }
-        if (mlist->inUseCount) {
-            uint16_t msgid;
-            ism_common_HashMapLock(mlist->idsMap);
-            for (msgid = 1; (mlist->inUseCount && (msgid <= 0xFFFF)); msgid++) {
-                uint64_t key;
-                COMPUTE_KEY(key,msgid,mlist->client_uid);
-                entry = ism_common_removeHashMapElement(mlist->idsMap, &key, sizeof(key));
-                if (entry) {
-                    ism_common_free(ism_memory_protocol_misc,entry);
-                    mlist->inUseCount--;
-                }
-            }
-            ism_common_HashMapUnlock(mlist->idsMap);
-        }
+        if (mlist->table)
+            ism_common_free(ism_memory_protocol_misc,mlist->table);
         ism_common_free(ism_memory_protocol_misc,mlist);
     }
 }
 
 /*
- * Free a message ID
+ * Find the entry for a message ID
+ */
+static inline ism_msgid_info_t * findMsgInfo(ism_msgid_list_t * mlist, uint16_t msgid) {
+    uint32_t mask = mlist->size - 1;
+    uint32_t slot = msgid & mask;
+    if (!mlist->table)
+        return NULL;
+    for (;;) {
+        ism_msgid_info_t * entry = mlist->table + slot;
+        if (!entry->inuse)
+            return NULL;
+        if (entry->msgid == msgid)
+            return entry;
+        slot = (slot + 1) & mask;
+    }
+}
+
+/*
+ * Get the free entry for a message ID which is not in the table
+ */
+static inline ism_msgid_info_t * freeSlot(ism_msgid_info_t * table, uint32_t size, uint16_t msgid) {
+    uint32_t slot = msgid & (size - 1);
+    while (table[slot].inuse)
+        slot = (slot + 1) & (size - 1);
+    return table + slot;
+}
+
+/*
+ * Double the size of the table, or allocate it when there is none
+ */
+static void growMsgInfo(ism_msgid_list_t * mlist) {
+    uint32_t newsize = mlist->table ? mlist->size * 2 : MSGID_TABLE_MIN;
+    ism_msgid_info_t * table = ism_common_calloc(ISM_MEM_PROBE(ism_memory_protocol_misc,69), newsize, sizeof(ism_msgid_info_t));
+    uint32_t i;
+    if (mlist->table) {
+        for (i = 0; i < mlist->size; i++) {
+            if (mlist->table[i].inuse)
+                *freeSlot(table, newsize, mlist->table[i].msgid) = mlist->table[i];
+        }
+        ism_common_free(ism_memory_protocol_misc,mlist->table);
+    }
+    mlist->table = table;
+    mlist->size = newsize;
+}
+
+/*
+ * Free a message ID.
+ * The following entries which would not be found across the empty slot are moved back
+ * so that no deleted markers are needed.
  */
 static void freeMsgInfo(ism_msgid_list_t * mlist, ism_msgid_info_t * entry) {
-    if (entry) {
-        mlist->inUseCount--;
-        if (mlist->freeCount < mlist->range){
-            mlist->freeCount++;
-            entry->handle = 0;
-            entry->next = mlist->freeList;
-            mlist->freeList = entry;
-        } else {
-            ism_common_free(ism_memory_protocol_misc,entry);
+    uint32_t mask = mlist->size - 1;
+    uint32_t slot = entry - mlist->table;
+    uint32_t next = slot;
+    for (;;) {
+        next = (next + 1) & mask;
+        ism_msgid_info_t * nentry = mlist->table + next;
+        if (!nentry->inuse)
+            break;
+        if (((next - (nentry->msgid & mask)) & mask) >= ((next - slot) & mask)) {
+            mlist->table[slot] = *nentry;
+            slot = next;
         }
     }
+    memset(mlist->table + slot, 0, sizeof(ism_msgid_info_t));
+    mlist->inUseCount--;
+
+    /* Give back a large table when the burst of messages is done */
+    if (mlist->inUseCount == 0 && mlist->size > MSGID_TABLE_KEEP) {
+        ism_common_free(ism_memory_protocol_misc,mlist->table);
+        mlist->table = NULL;
+        mlist->size = 0;
+    }
 }
 
 int  ism_msgid_addMsgIdInfo(ism_msgid_list_t * mlist, __uint128_t handle, uint16_t msgid, uint16_t state) {
-    ism_msgid_info_t * entry;
-    uint64_t key;
-    COMPUTE_KEY(key,msgid,mlist->client_uid);
-    if (mlist->freeList){
-        entry = mlist->freeList;
-        mlist->freeList = entry->next;
-        entry->next = NULL;
-        mlist->freeCount--;
-    } else {
-        entry = ism_common_calloc(ISM_MEM_PROBE(ism_memory_protocol_misc,69),1, sizeof(ism_msgid_info_t));
+    ism_msgid_info_t * entry = findMsgInfo(mlist, msgid);
+    if (!entry) {
+        if ((mlist->inUseCount + 1) * 2 > mlist->size)
+            growMsgInfo(mlist);
+        entry = freeSlot(mlist->table, mlist->size, msgid);
+        entry->msgid = msgid;
+        entry->inuse = 1;
+        mlist->inUseCount++;
     }
-    entry->msgid = msgid;
     entry->handle = handle;
     entry->state = state;
     entry->pending = 1;
-    ism_common_putHashMapElementLock(mlist->idsMap, &key, sizeof(key), entry, NULL);
-    mlist->inUseCount++;
-
     return 0;
 }
 
@@ -152,10 +162,8 @@ int  ism_msgid_addMsgIdInfo(ism_msgid_list_t * mlist, __uint128_t handle, uint16
  */
 __uint128_t ism_msgid_delMsgIdInfo(ism_msgid_list_t * mlist, uint16_t msgid, int *pPending) {
     ism_msgid_info_t * entry;
-    uint64_t key;
     __uint128_t result = 0;
-    COMPUTE_KEY(key,msgid,mlist->client_uid);
-    entry = ism_common_removeHashMapElementLock(mlist->idsMap, &key, sizeof(key));
+    entry = findMsgInfo(mlist, msgid);
     if(entry) {
         result = entry->handle;
         if(pPending)
@@ -167,11 +175,8 @@ __uint128_t ism_msgid_delMsgIdInfo(ism_msgid_list_t * mlist, uint16_t msgid, int
 
 /*
  * Check if the message id is in the list.
+ * The entry is only valid until the message ID list is next changed.
  */
 ism_msgid_info_t * ism_msgid_getMsgIdInfo(ism_msgid_list_t * mlist, uint16_t msgid) {
-    ism_msgid_info_t * entry;
-    uint64_t key;
-    COMPUTE_KEY(key,msgid,mlist->client_uid);
-    entry = ism_common_getHashMapElementLock(mlist->idsMap, &key, sizeof(key));
-    return entry;
+    return findMsgInfo(mlist, msgid);
 }
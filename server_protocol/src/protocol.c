@@ -33,6 +33,7 @@ extern int ism_protocol_initPlugin(void);
 extern int ism_protocol_initRestMsg(void);
 extern int ism_protocol_initMux(void);
 extern int ism_protocol_startPlugin(void);
+extern int ism_protocol_startMQTT(void);
 extern int ism_protocol_termJMS(void);
 extern int ism_protocol_printJMSStats(void);
 extern int ism_protocol_initForwarder(void);
@@ -264,6 +265,7 @@ void * ism_protocol_getSharedClient(int durable) {
 int ism_protocol_start(void) {
     ism_engine_registerSelectionCallback(ism_protocol_selectMessage);
     ism_engine_registerDeliveryFailureCallback(ism_protocol_deliveryFailure);
+    ism_protocol_startMQTT();
     ism_protocol_startPlugin();
     ism_protocol_startForwarder();
     return 0;
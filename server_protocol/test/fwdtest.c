@@ -24,6 +24,8 @@ void testfwdverify(void);
 void xalink_test(void);
 void recover_test(void);
 void dhmap_test(void);
+void commitcount_test(void);
+void stream_test(void);
 
 
 /**
@@ -39,6 +41,8 @@ CU_TestInfo ISM_Protocol_CUnit_Fwd[] = {
     {"FwdRecover",     recover_test  },
 #endif
     {"FwdDHMap           ",       dhmap_test    },
+    {"FwdCommitCount     ",       commitcount_test },
+    {"FwdStreams         ",       stream_test },
     CU_TEST_INFO_NULL
 };
 
@@ -530,3 +534,218 @@ void dhmap_test(void) {
     }
     CU_ASSERT(err == 0);
 }
+
+/*
+ * Test the adaptive commit count of a receiver connection
+ */
+void commitcount_test(void) {
+    ismFwdPobj_t xpobj = {0};
+    ismFwdPobj_t * pobj = &xpobj;
+    int save_latency = fwd_commit_latency;
+    int save_max = fwd_commit_max;
+
+    /* With no latency target the fixed commit count is used */
+    fwd_commit_latency = 0;
+    ism_fwd_initBatching(pobj);
+    CU_ASSERT(pobj->commitTarget == fwd_commit_count);
+    pobj->batchStart = 10.0;
+    adaptCommitCount(pobj, 5000, 0, 11.0);
+    CU_ASSERT(pobj->commitTarget == fwd_commit_count);
+    CU_ASSERT(pobj->msgRate == 0.0);
+    CU_ASSERT(pobj->batchStart == 11.0);
+    CU_ASSERT(pobj->commitBatches == 1);
+    CU_ASSERT(pobj->commitTimed == 0);
+
+    /* The first sample sets the rate and the count fills the whole target */
+    fwd_commit_latency = 50;
+    fwd_commit_max = 10000;
+    adaptCommitCount(pobj, 1010, 1, 12.0);
+    CU_ASSERT(pobj->msgRate == 1010.0);
+    CU_ASSERT(pobj->commitTarget == 50);
+    CU_ASSERT(pobj->commitBatches == 2);
+    CU_ASSERT(pobj->commitTimed == 1);
+
+    /* Later samples are smoothed and the commit time is taken from the target */
+    pobj->commitRTT = 0.02;
+    adaptCommitCount(pobj, 3010, 0, 13.0);
+    CU_ASSERT(pobj->msgRate == 1510.0);
+    CU_ASSERT(pobj->commitTarget == 45);
+
+    /* A commit time longer than the target still leaves a quarter of it for filling */
+    pobj->commitRTT = 0.1;
+    adaptCommitCount(pobj, 1510, 0, 14.0);
+    CU_ASSERT(pobj->msgRate == 1510.0);
+    CU_ASSERT(pobj->commitTarget == 18);
+
+    /* No time has passed so the rate and count are not changed */
+    adaptCommitCount(pobj, 100, 0, 14.0);
+    CU_ASSERT(pobj->msgRate == 1510.0);
+    CU_ASSERT(pobj->commitTarget == 18);
+    CU_ASSERT(pobj->commitBatches == 5);
+
+    /* The count is at least one and at most the maximum */
+    ism_fwd_initBatching(pobj);
+    pobj->batchStart = 20.0;
+    adaptCommitCount(pobj, 1, 1, 30.0);
+    CU_ASSERT(pobj->commitTarget == 1);
+    ism_fwd_initBatching(pobj);
+    pobj->batchStart = 40.0;
+    adaptCommitCount(pobj, 5000000, 0, 41.0);
+    CU_ASSERT(pobj->commitTarget == fwd_commit_max);
+
+    fwd_commit_latency = save_latency;
+    fwd_commit_max = save_max;
+}
+
+static int stream_sends;
+static int stream_sendAction;
+static int stream_resumes;
+
+static int streamSend(ism_transport_t * transport, char * buf, int len, int frame, int flags) {
+    stream_sends++;
+    stream_sendAction = frame;
+    return 0;
+}
+
+static int streamResume(ism_transport_t * transport, void * userdata) {
+    stream_resumes++;
+    return 0;
+}
+
+/*
+ * Make the properties of a forwarded message with a topic
+ */
+static uint32_t streamTopicProps(char * xbuf, int len, const char * topic) {
+    concat_alloc_t buf = {xbuf, len};
+    ism_protocol_putNameIndex(&buf, ID_Topic);
+    ism_protocol_putStringValue(&buf, topic);
+    CU_ASSERT(buf.inheap == 0);
+    return buf.used;
+}
+
+/*
+ * Commit a prepared transaction on a connection and return whether the connection was resumed
+ */
+static int streamCommit(ism_transport_t * transport) {
+    fwd_xa_action_t act = {0};
+    int resumes = stream_resumes;
+    act.op = 'C';
+    act.transport = transport;
+    strcpy(act.gtrid, "otherserver_streamserver_1");
+    stream_sends = 0;
+    transport->pobj->inprogress = 1;
+    replyCommit(0, NULL, &act);
+    CU_ASSERT(stream_sends == 1);
+    CU_ASSERT(stream_sendAction == (FwdAction_CommitReply<<8)+2);
+    CU_ASSERT(transport->pobj->inprogress == 0);
+    return stream_resumes - resumes;
+}
+
+/*
+ * Test the selection of the stream for a reliable message and the commit bookkeeping of a stream
+ */
+void stream_test(void) {
+    ism_fwd_channel_t * channel = ism_fwd_newChannel("streamserver", "StreamServer");
+    ism_transport_t * transport [4];
+    ism_transport_t * stransport;
+    char xbuf [256];
+    char topic [32];
+    int  hits [4] = {0};
+    uint32_t proplen;
+    int  which;
+    int  i;
+
+    for (i=0; i<4; i++) {
+        transport[i] = calloc(1, sizeof(ism_transport_t));
+        transport[i]->pobj = calloc(1, sizeof(ismFwdPobj_t));
+        pthread_spin_init(&transport[i]->pobj->sessionlock, 0);
+        transport[i]->pobj->channel = channel;
+        transport[i]->pobj->stream = i;
+        transport[i]->send = streamSend;
+        transport[i]->resume = streamResume;
+        if (i)
+            channel->stream[i].out_stream = transport[i];
+    }
+    channel->out_channel = transport[0];
+
+    /* Without streams every message uses the primary connection */
+    proplen = streamTopicProps(xbuf, sizeof xbuf, "topic/3");
+    CU_ASSERT(fwdSelectStream(transport[0], xbuf, proplen, &which) == transport[0]);
+    CU_ASSERT(which == 0);
+
+    /* The stream is selected by the topic hash and holds the stream while the message is sent */
+    channel->stream_count = 4;
+    for (i=0; i<40; i++) {
+        int expected;
+        sprintf(topic, "topic/%d", i);
+        expected = ism_strhash_fnv1a_32(topic) % 4;
+        proplen = streamTopicProps(xbuf, sizeof xbuf, topic);
+        stransport = fwdSelectStream(transport[0], xbuf, proplen, &which);
+        CU_ASSERT(which == expected);
+        CU_ASSERT(stransport == transport[expected]);
+        CU_ASSERT(stransport->pobj->inprogress == (expected ? 1 : 0));
+        if (stransport != transport[0])
+            stransport->pobj->inprogress--;
+
+        /* The same topic always uses the same stream */
+        CU_ASSERT(fwdSelectStream(transport[0], xbuf, proplen, &which) == stransport);
+        if (stransport != transport[0])
+            stransport->pobj->inprogress--;
+        hits[which]++;
+    }
+    for (i=0; i<4; i++) {
+        CU_ASSERT(hits[i] > 0);
+    }
+
+    /* A message without a topic uses the primary connection */
+    CU_ASSERT(fwdSelectStream(transport[0], NULL, 0, &which) == transport[0]);
+    CU_ASSERT(which == 0);
+
+    /* A stream which is closing or gone is not used */
+    for (i=0; i<40; i++) {
+        sprintf(topic, "topic/%d", i);
+        if (ism_strhash_fnv1a_32(topic) % 4 == 2)
+            break;
+    }
+    proplen = streamTopicProps(xbuf, sizeof xbuf, topic);
+    transport[2]->pobj->inprogress = -1;
+    CU_ASSERT(fwdSelectStream(transport[0], xbuf, proplen, &which) == transport[0]);
+    CU_ASSERT(which == 0);
+    CU_ASSERT(transport[2]->pobj->inprogress == -1);
+    transport[2]->pobj->inprogress = 0;
+    channel->stream[2].out_stream = NULL;
+    CU_ASSERT(fwdSelectStream(transport[0], xbuf, proplen, &which) == transport[0]);
+    channel->stream[2].out_stream = transport[2];
+
+    /* A commit on a stream counts down its own prepared transactions */
+    transport[1]->pobj->preparedXA = fwd_minXA+2;
+    transport[0]->pobj->preparedXA = fwd_minXA+2;
+    CU_ASSERT(streamCommit(transport[1]) == 0);
+    CU_ASSERT(transport[1]->pobj->preparedXA == fwd_minXA+1);
+    CU_ASSERT(transport[0]->pobj->preparedXA == fwd_minXA+2);
+
+    /* At the low water mark a stream resumes the primary even if the stream is not suspended */
+    CU_ASSERT(streamCommit(transport[1]) == 1);
+    CU_ASSERT(transport[1]->pobj->preparedXA == fwd_minXA);
+
+    /* The primary only resumes when it is suspended */
+    transport[0]->pobj->preparedXA = fwd_minXA+1;
+    CU_ASSERT(streamCommit(transport[0]) == 0);
+    CU_ASSERT(transport[0]->pobj->preparedXA == fwd_minXA);
+    transport[0]->pobj->suspended = 1;
+    CU_ASSERT(streamCommit(transport[0]) == 1);
+    CU_ASSERT(transport[0]->pobj->preparedXA == fwd_minXA-1);
+
+    /* With no prepared transactions the count stays at zero */
+    transport[1]->pobj->preparedXA = 0;
+    CU_ASSERT(streamCommit(transport[1]) == 0);
+    CU_ASSERT(transport[1]->pobj->preparedXA == 0);
+
+    channel->stream_count = 0;
+    for (i=0; i<4; i++) {
+        channel->stream[i].out_stream = NULL;
+        free(transport[i]->pobj);
+        free(transport[i]);
+    }
+    channel->out_channel = NULL;
+}
@@ -118,7 +118,69 @@ void msgid_test(void) {
     ism_msgid_freelist(pobjx.msgids);
 }
 
+/*
+ * Test message IDs which use the same slot in the message ID table
+ */
+void msgid_collide_test(void) {
+    int  i;
+    ism_transport_t trans = {0};
+    mqttProtoObj_t pobjx = {0};
+    ism_transport_t * transport = &trans;
+    ism_msgid_info_t * info;
+    transport->pobj = &pobjx;
+    pobjx.msgids = ism_create_msgid_list(transport,0,0xFFFF);
+
+    /* No table until a message ID is used */
+    CU_ASSERT(pobjx.msgids->table == NULL);
+    CU_ASSERT(ism_msgid_getMsgIdInfo(pobjx.msgids, 1) == NULL);
+
+    /* These all have the same home slot in the initial table */
+    for (i=0; i<6; i++) {
+        ism_msgid_addMsgIdInfo(pobjx.msgids, 100+i, (uint16_t)(3 + i*MSGID_TABLE_MIN), ISM_MQTT_PUBLISH);
+    }
+    CU_ASSERT(pobjx.msgids->inUseCount == 6);
+    CU_ASSERT(pobjx.msgids->size == MSGID_TABLE_MIN);
+
+    /* Adding a message ID again replaces it */
+    ism_msgid_addMsgIdInfo(pobjx.msgids, 200, 3 + MSGID_TABLE_MIN, ISM_MQTT_PUBREL);
+    CU_ASSERT(pobjx.msgids->inUseCount == 6);
+    info = ism_msgid_getMsgIdInfo(pobjx.msgids, 3 + MSGID_TABLE_MIN);
+    CU_ASSERT(info != NULL && info->handle == 200 && info->state == ISM_MQTT_PUBREL);
+    ism_msgid_addMsgIdInfo(pobjx.msgids, 101, 3 + MSGID_TABLE_MIN, ISM_MQTT_PUBLISH);
+
+    /* Remove from the middle of the chain and find the others */
+    CU_ASSERT(ism_msgid_delMsgIdInfo(pobjx.msgids, 3 + 2*MSGID_TABLE_MIN, NULL) == 102);
+    CU_ASSERT(ism_msgid_delMsgIdInfo(pobjx.msgids, 3, NULL) == 100);
+    CU_ASSERT(ism_msgid_delMsgIdInfo(pobjx.msgids, 3, NULL) == 0);
+    for (i=0; i<6; i++) {
+        info = ism_msgid_getMsgIdInfo(pobjx.msgids, (uint16_t)(3 + i*MSGID_TABLE_MIN));
+        if (i==0 || i==2) {
+            CU_ASSERT(info == NULL);
+        } else {
+            CU_ASSERT(info != NULL && info->handle == 100+i);
+        }
+    }
+    CU_ASSERT(pobjx.msgids->inUseCount == 4);
+
+    /* Grow the table and then give it back when it is empty */
+    for (i=1; i<=1000; i++) {
+        ism_msgid_addMsgIdInfo(pobjx.msgids, i, (uint16_t)(i*7), ISM_MQTT_PUBLISH);
+    }
+    CU_ASSERT(pobjx.msgids->size >= 2048);
+    for (i=1; i<=1000; i++) {
+        CU_ASSERT(ism_msgid_delMsgIdInfo(pobjx.msgids, (uint16_t)(i*7), NULL) == i);
+    }
+    for (i=1; i<6; i++) {
+        if (i != 2)
+            ism_msgid_delMsgIdInfo(pobjx.msgids, (uint16_t)(3 + i*MSGID_TABLE_MIN), NULL);
+    }
+    CU_ASSERT(pobjx.msgids->inUseCount == 0);
+    CU_ASSERT(pobjx.msgids->table == NULL);
+    ism_msgid_freelist(pobjx.msgids);
+}
+
 CU_TestInfo ISM_Protocol_CUnit_Msgid[] = {
     {"MsgidTest          ", msgid_test },
+    {"MsgidCollideTest   ", msgid_collide_test },
     CU_TEST_INFO_NULL
 };
@@ -30,15 +30,29 @@
 #define BILLION        1000000000L
 
 /**
- * This table will keep the gwKnowDeviceMap object and the key is
- * the Gateway Client ID
+ * One shard of the Gateway Device Cache.
+ * The key is org:devtype:devid and the value is a dev_info_t object.
+ * Each shard has its own lock so that connects for different devices
+ * do not serialize on a single mutex.
  */
-static ismHashMap *       g_deviceCache;
+typedef struct dev_cache_shard_t {
+    pthread_mutex_t    lock;
+    ismHashMap *       map;
+    uint64_t           hits;
+    uint64_t           misses;
+    uint64_t           contended;       /* Lock was held when we tried to take it */
+    uint64_t           evicted;         /* Removed because it was idle longer than the TTL */
+    char               resv[16];
+} dev_cache_shard_t;
 
 /**
- * Lock for the global Gateway Device Cache
+ * The global Gateway Device Cache, sharded by the hash of the key
  */
-static pthread_mutex_t g_deviceCacheLock ;
+static dev_cache_shard_t * g_deviceCache;
+static int                 g_deviceCacheShards;      /* Power of 2 */
+static int                 g_deviceCacheTTL;         /* Idle seconds before eviction, 0=never */
+static int                 g_deviceCacheSweep;       /* Next shard to check for idle entries */
+static volatile int        g_deviceCacheTimer;
 
 static int authInited=0;
 extern int g_authenticator;
@@ -492,8 +506,6 @@ int ism_proxy_completeAuthorize(void * correlate, int rc, const char * reason) {
     return 0;
 }
 
-const char * ism_tenant_getTenantAlias(const char * org, const char * deviceID);
-
 /*
  * Check if the tenant is valid including doing the alias lookup
  */
@@ -501,15 +513,12 @@ ism_tenant_t * ism_proxy_getValidTenant(ism_transport_t * transport) {
     if (transport->tenant == NULL) {
         const char * org = (transport->org) ? transport->org : "";
         ism_tenant_t * tenant;
+        const char * alias;
 
-        ism_tenant_lock();
-        tenant = ism_tenant_getTenant(org);
-        /* Check Alias. If any, use the alias to get the org/tenant */
-		const char * alias = ism_tenant_getTenantAlias(transport->org, transport->deviceID);
+        /* Find the tenant without locking. If there is an alias, use the alias to get the org/tenant */
+        tenant = ism_tenant_findTenant(org, transport->deviceID, &alias);
 		if (alias) {
 			char * pos;
-			tenant = ism_tenant_getTenant(alias);
-			ism_tenant_unlock();
 			if (tenant) {
 				TRACE(5, "Tenant alias used: connect=%d ClientID=%s old=%s new=%s\n", transport->index, transport->name?transport->name:"", org, alias);
 				pos = strstr(transport->name, org);
@@ -520,8 +529,6 @@ ism_tenant_t * ism_proxy_getValidTenant(ism_transport_t * transport) {
 				TRACE(4, "Tenant alias cannot be used because the new tenant is not known: connect=%d ClientID=%s old=%s new=%s\n",
 				        transport->index, transport->name?transport->name:"", org, alias);
 			}
-		} else {
-			ism_tenant_unlock();
 		}
 		if (!tenant) {
 			TRACE(5, "Unknown organization: org=\"%s\" clientID=\"%s\" client_addr=%s connect=%u\n",
@@ -642,6 +649,20 @@ static inline int generateGWkey(char * buf, int buflen, const char * org, const
     return snprintf(buf, buflen, "%s:%s:%s", ((org) ? org : ""), ((devtype) ? devtype : ""), ((devid) ? devid : ""));
 }
 
+/*
+ * Find and lock the cache shard for a key
+ */
+static dev_cache_shard_t * lockShard(const char * key, int keyLen) {
+    dev_cache_shard_t * shard = g_deviceCache + (ism_common_computeHashCode(key, keyLen) & (g_deviceCacheShards-1));
+    if (pthread_mutex_trylock(&shard->lock)) {
+        __sync_add_and_fetch(&shard->contended, 1);
+        pthread_mutex_lock(&shard->lock);
+    }
+    return shard;
+}
+
+static int deviceCacheTimer(ism_timer_t key, ism_time_t timestamp, void * userdata);
+
 /*Get Gateway Device Info. The device info object will be locked when returned
  *Need to use ism_proxy_unlockDeviceInfo to return the device info
  * */
@@ -658,9 +679,9 @@ dev_info_t *  ism_proxy_getDeviceAuthInfo(const char * org, const char * devtype
 			keyLen = generateGWkey(key, (keyLen + 32), org, devtype, devid);
 		}
 
-		pthread_mutex_lock(&g_deviceCacheLock);
-		if(g_deviceCache){
-			deviceInfo = ism_common_getHashMapElement(g_deviceCache, key, keyLen);
+		dev_cache_shard_t * shard = lockShard(key, keyLen);
+		if (shard->map) {
+			deviceInfo = ism_common_getHashMapElement(shard->map, key, keyLen);
 
 			if(deviceInfo){
 				TRACE(6, "getDeviceInfo. deviceInfo=%p org=%s devtype=%s devid=%s\n",deviceInfo, org, devtype, devid );
@@ -670,9 +691,13 @@ dev_info_t *  ism_proxy_getDeviceAuthInfo(const char * org, const char * devtype
 				 * to unlock the object
 				 */
 				pthread_spin_lock(&deviceInfo->lock);
+				deviceInfo->lastUseTime = ism_common_currentTimeNanos();
+				shard->hits++;
+			} else {
+				shard->misses++;
 			}
 		}
-		pthread_mutex_unlock(&g_deviceCacheLock);
+		pthread_mutex_unlock(&shard->lock);
 
 
 	}
@@ -694,22 +719,23 @@ int  ism_proxy_setDeviceAuthInfo(const char * org, const char * devtype, const c
 			key = alloca(keyLen + 32);
 			keyLen = generateGWkey(key, (keyLen + 32), org, devtype, devid);
 		}
-		pthread_mutex_lock(&g_deviceCacheLock);
-		if(g_deviceCache){
-			deviceInfo = ism_common_getHashMapElement(g_deviceCache, key, keyLen);
+		dev_cache_shard_t * shard = lockShard(key, keyLen);
+		if (shard->map) {
+			deviceInfo = ism_common_getHashMapElement(shard->map, key, keyLen);
 			if(!deviceInfo){
 				deviceInfo = ism_common_calloc(ISM_MEM_PROBE(ism_memory_proxy_device_auth,1),1, sizeof(dev_info_t));
 
 				 //This table contains the link list of async object for each transport
 				deviceInfo->pendingAuthRequestTable = ism_common_createHashMap(128,HASH_STRING);
 				pthread_spin_init(&deviceInfo->lock, 0);
-				ism_common_putHashMapElement(g_deviceCache, key, keyLen, deviceInfo, NULL);
+				ism_common_putHashMapElement(shard->map, key, keyLen, deviceInfo, NULL);
 				deviceInfo->devid = ism_common_strdup(ISM_MEM_PROBE(ism_memory_proxy_device_auth,1000),devid);
 				deviceInfo->devtype = ism_common_strdup(ISM_MEM_PROBE(ism_memory_proxy_device_auth,1000),devtype);
 				TRACE(6, "setDeviceInfo. deviceInfo=%p org=%s devtype=%s devid=%s\n", deviceInfo, org, devtype, devid );
 			}else{
 				TRACE(6, "setDeviceInfo. Device Info is already existed. deviceInfo=%p org=%s devtype=%s devid=%s\n", deviceInfo, org, devtype, devid);
 			}
+			deviceInfo->lastUseTime = ism_common_currentTimeNanos();
 			if(outDevInfo!=NULL){
 				pthread_spin_lock(&deviceInfo->lock);
 				*outDevInfo = deviceInfo;
@@ -717,8 +743,15 @@ int  ism_proxy_setDeviceAuthInfo(const char * org, const char * devtype, const c
 		}else{
 			rc=1;
 		}
-		pthread_mutex_unlock(&g_deviceCacheLock);
-
+		pthread_mutex_unlock(&shard->lock);
+
+		/* Start the idle eviction timer with the first cached device */
+		if (g_deviceCacheTTL && !g_deviceCacheTimer && __sync_bool_compare_and_swap(&g_deviceCacheTimer, 0, 1)) {
+		    int period = (g_deviceCacheTTL * 1000) / g_deviceCacheShards;
+		    if (period < 100)
+		        period = 100;
+		    ism_common_setTimerRate(ISM_TIMER_LOW, deviceCacheTimer, NULL, period, period, TS_MILLISECONDS);
+		}
 
 	}else{
 		return 1;
@@ -739,22 +772,93 @@ int ism_proxy_deleteDeviceAuthInfo(const char * org, const char * devtype, const
 			key = alloca(keyLen + 32);
 			keyLen = generateGWkey(key, (keyLen + 32), org, devtype, devid);
 		}
-		pthread_mutex_lock(&g_deviceCacheLock);
-		if(g_deviceCache){
-			dev_info_t * deviceInfo = ism_common_getHashMapElement(g_deviceCache, key, keyLen);
+		dev_cache_shard_t * shard = lockShard(key, keyLen);
+		if (shard->map) {
+			dev_info_t * deviceInfo = ism_common_getHashMapElement(shard->map, key, keyLen);
 			if(deviceInfo!=NULL){
 				TRACE(5, "deleteDeviceAuthInfo: deviceInfo=%p org=%s devtype=%s devid=%s\n", deviceInfo, org, devtype, devid );
 				//Remove from the table.
-				ism_common_removeHashMapElement(g_deviceCache, key, keyLen);
+				ism_common_removeHashMapElement(shard->map, key, keyLen);
 				destroyDeviceInfo(deviceInfo);
 			}
 		}
 
-		pthread_mutex_unlock(&g_deviceCacheLock);
+		pthread_mutex_unlock(&shard->lock);
 	}
 	return 0;
 }
 
+/*
+ * Evict idle devices from one shard of the device cache.
+ * Each timer pop checks the next shard, so every shard is checked
+ * once per TTL without walking the whole cache at once.
+ * A device which is locked or has auth requests in progress is kept.
+ */
+static int deviceCacheTimer(ism_timer_t key, ism_time_t timestamp, void * userdata) {
+    if (!authInited || !g_deviceCache) {
+        if (key)
+            ism_common_cancelTimer(key);
+        g_deviceCacheTimer = 0;
+        return 0;
+    }
+    ism_time_t now = ism_common_currentTimeNanos();
+    ism_time_t ttl = ((ism_time_t)g_deviceCacheTTL) * 1000000000L;
+    dev_cache_shard_t * shard = g_deviceCache + (g_deviceCacheSweep++ & (g_deviceCacheShards-1));
+    int evicted = 0;
+
+    pthread_mutex_lock(&shard->lock);
+    if (shard->map && ism_common_getHashMapNumElements(shard->map)) {
+        ismHashMapEntry ** array = ism_common_getHashMapEntriesArray(shard->map);
+        int i;
+        for (i = 0; array[i] != ((void*)-1); i++) {
+            dev_info_t * deviceInfo = (dev_info_t *)array[i]->value;
+            if (deviceInfo->lastUseTime + ttl > now)
+                continue;
+            if (pthread_spin_trylock(&deviceInfo->lock))
+                continue;
+            if (ism_common_getHashMapNumElements(deviceInfo->pendingAuthRequestTable)) {
+                pthread_spin_unlock(&deviceInfo->lock);
+                continue;
+            }
+            ism_common_removeHashMapElement(shard->map, array[i]->key, array[i]->key_len);
+            /* No one can find it now, so it is safe to destroy */
+            pthread_spin_unlock(&deviceInfo->lock);
+            destroyDeviceInfo(deviceInfo);
+            evicted++;
+        }
+        ism_common_freeHashMapEntriesArray(array);
+        shard->evicted += evicted;
+    }
+    pthread_mutex_unlock(&shard->lock);
+    if (evicted)
+        TRACE(7, "deviceCacheTimer: shard=%d evicted=%d\n", (int)(shard - g_deviceCache), evicted);
+    return 1;
+}
+
+/*
+ * Get the device cache stats.
+ * The counters are since the last call, entries is the current count.
+ */
+int ism_proxy_getDeviceCacheStats(px_devcache_stats_t * stats) {
+    int i;
+    memset(stats, 0, sizeof(px_devcache_stats_t));
+    if (!g_deviceCache)
+        return 0;
+    for (i = 0; i < g_deviceCacheShards; i++) {
+        dev_cache_shard_t * shard = g_deviceCache + i;
+        pthread_mutex_lock(&shard->lock);
+        if (shard->map)
+            stats->entries += ism_common_getHashMapNumElements(shard->map);
+        stats->hits += shard->hits;
+        stats->misses += shard->misses;
+        stats->evicted += shard->evicted;
+        shard->hits = shard->misses = shard->evicted = 0;
+        pthread_mutex_unlock(&shard->lock);
+        stats->contended += __sync_lock_test_and_set(&shard->contended, 0);
+    }
+    return 0;
+}
+
 XAPI int ism_proxy_setDeviceAuthPendingRequest(dev_info_t * deviceInfo, asyncauth_t * async, const char * name)
 {
 	int rc = 0;
@@ -820,14 +924,31 @@ int ism_proxy_initAuth(void)
 
 	if (!authInited){
 
-		pthread_mutex_init(&g_deviceCacheLock, 0);
-		g_deviceCache = ism_common_createHashMap(128,HASH_STRING);
+		int i;
+		int shards = ism_common_getIntConfig("DeviceCacheShards", 64);
+		if (shards < 1)
+		    shards = 1;
+		if (shards > 4096)
+		    shards = 4096;
+		g_deviceCacheShards = 1;
+		while (g_deviceCacheShards < shards)
+		    g_deviceCacheShards <<= 1;
+		g_deviceCacheTTL = ism_common_getIntConfig("DeviceCacheTTL", 3600);
+		if (g_deviceCacheTTL < 0)
+		    g_deviceCacheTTL = 0;
+		dev_cache_shard_t * cache = ism_common_calloc(ISM_MEM_PROBE(ism_memory_proxy_device_auth,3),
+		        g_deviceCacheShards, sizeof(dev_cache_shard_t));
+		for (i = 0; i < g_deviceCacheShards; i++) {
+		    pthread_mutex_init(&cache[i].lock, 0);
+		    cache[i].map = ism_common_createHashMap(128,HASH_STRING);
+		}
+		g_deviceCache = cache;
 
 		disconnectDeletedDevice = ism_common_getIntConfig("DisconnectDeletedDevice", 1);
 
 		authInited=1;
 
-		TRACE(5, "Proxy Auth is initialized.\n");
+		TRACE(5, "Proxy Auth is initialized: DeviceCacheShards=%d DeviceCacheTTL=%d\n", g_deviceCacheShards, g_deviceCacheTTL);
 	}
 	return 0;
 }
@@ -860,11 +981,14 @@ int ism_proxy_termAuth(void) {
 	if (authInited) {
 		authInited=0;
 
-		pthread_mutex_lock(&g_deviceCacheLock);
-
-		ism_common_destroyHashMapAndFreeValues(g_deviceCache, destroyDeviceInfo);
-
-		pthread_mutex_unlock(&g_deviceCacheLock);
+		int i;
+		for (i = 0; i < g_deviceCacheShards; i++) {
+		    dev_cache_shard_t * shard = g_deviceCache + i;
+		    pthread_mutex_lock(&shard->lock);
+		    ism_common_destroyHashMapAndFreeValues(shard->map, destroyDeviceInfo);
+		    shard->map = NULL;
+		    pthread_mutex_unlock(&shard->lock);
+		}
 
 
 		TRACE(5, "Proxy Auth is terminated.\n");
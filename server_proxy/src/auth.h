@@ -59,6 +59,20 @@ typedef struct px_auth_stats_t {
 
 XAPI int ism_proxy_getAuthStats(px_auth_stats_t * stats);
 
+/*
+ * Device auth cache statistics.
+ * entries is the current count, the other counters are since the last call.
+ */
+typedef struct px_devcache_stats_t {
+    uint64_t             entries;
+    uint64_t             hits;
+    uint64_t             misses;
+    uint64_t             contended;
+    uint64_t             evicted;
+} px_devcache_stats_t;
+
+XAPI int ism_proxy_getDeviceCacheStats(px_devcache_stats_t * stats);
+
 /*
  * Extended authorization types.
  * Note: These values must match values defined in
@@ -44,6 +44,8 @@ static px_server_stats_t * serverStats = NULL;
 static int serverStatsAllocated = 0;
 static px_mux_stats_t * muxStats = NULL;
 static int muxStatsAllocated = 0;
+static px_mux_link_stats_t * muxLinkStats = NULL;
+static int muxLinkStatsAllocated = 0;
 
 extern int g_useKafkaIMMessaging;
 static px_kafka_messaging_stat_t   kafkaIMMessagingStats[2];
@@ -183,6 +185,49 @@ static void updateMUXStats(void) {
 		statsd_prepare(pStatsdLink, counterName, value, "g", 1.0, prepBuff, sizeof(prepBuff),1);
 		strcat(sendBuffer,prepBuff);
 
+		/* Stats for each physical link which has been started, when there can be more than one */
+		int links = 1;
+		int linkCount = muxLinkStatsAllocated;
+		while (ism_proxy_getMuxLinkStats(muxLinkStats, &linkCount, &links)) {
+			muxLinkStatsAllocated = linkCount;
+			void * statptr = ism_common_realloc(ISM_MEM_PROBE(ism_memory_proxy_mux_stats,4),muxLinkStats, muxLinkStatsAllocated*sizeof(px_mux_link_stats_t));
+			if(!statptr) {
+				ism_common_free(ism_memory_proxy_mux_stats,muxLinkStats);
+				muxLinkStats=NULL;
+				muxLinkStatsAllocated = 0;
+				linkCount = 0;
+				break;
+			}
+			muxLinkStats = statptr;
+		}
+		for (i = 0; links > 1 && i < linkCount; i++) {
+			px_mux_link_stats_t * lstat = &muxLinkStats[i];
+			if (!lstat->opened)
+				continue;
+			snprintf(counterName, sizeof(counterName),"mux.iop%d.link%d.streams", i/links, i%links);
+			statsd_prepare(pStatsdLink, counterName, lstat->streams, "g", 1.0, prepBuff, sizeof(prepBuff),1);
+			strcat(sendBuffer,prepBuff);
+			snprintf(counterName, sizeof(counterName),"mux.iop%d.link%d.sendQueue", i/links, i%links);
+			statsd_prepare(pStatsdLink, counterName, lstat->sendQueue, "g", 1.0, prepBuff, sizeof(prepBuff),1);
+			strcat(sendBuffer,prepBuff);
+			snprintf(counterName, sizeof(counterName),"mux.iop%d.link%d.bytesSent", i/links, i%links);
+			statsd_prepare(pStatsdLink, counterName, lstat->bytesSent, "g", 1.0, prepBuff, sizeof(prepBuff),1);
+			strcat(sendBuffer,prepBuff);
+			snprintf(counterName, sizeof(counterName),"mux.iop%d.link%d.paused", i/links, i%links);
+			statsd_prepare(pStatsdLink, counterName, lstat->paused, "g", 1.0, prepBuff, sizeof(prepBuff),1);
+			strcat(sendBuffer,prepBuff);
+			snprintf(counterName, sizeof(counterName),"mux.iop%d.link%d.opened", i/links, i%links);
+			statsd_prepare(pStatsdLink, counterName, lstat->opened, "g", 1.0, prepBuff, sizeof(prepBuff),1);
+			strcat(sendBuffer,prepBuff);
+
+			j = strlen(sendBuffer) - 1;
+			if(j > 16384) {
+				sendBuffer[j] = '\0';
+				statsd_send(pStatsdLink, sendBuffer);
+				sendBuffer[0] = '\0';
+			}
+		}
+
 
 		if(sendBuffer[0]){
 			i = strlen(sendBuffer) - 1;
@@ -759,8 +804,10 @@ static void updateStats(void) {
     double currTime = ism_common_readTSC();
     double sampleRate = currTime - lastUpdateTime;
     uint8_t currStatIndex = !lastStatIndex;
+    px_devcache_stats_t devCacheStats;
 
     ism_proxy_getAuthStats(&authStats[currStatIndex]);
+    ism_proxy_getDeviceCacheStats(&devCacheStats);
     ism_proxy_getMQTTStats(&mqttStats[currStatIndex]);
     ism_proxy_getHTTPStats(&httpStats[currStatIndex]);
     ism_proxy_getTCPStats(&tcpStats[currStatIndex]);
@@ -1029,6 +1076,16 @@ static void updateStats(void) {
     strcat(updateBuffer,prepBuff);
     statsd_prepare(pStatsdLink, "authentication.avgResponseTimeMs", avgAuthenticationResponseTime, "g", 1.0, prepBuff, sizeof(prepBuff),1);
     strcat(updateBuffer,prepBuff);
+    statsd_prepare(pStatsdLink, "deviceCache.entries", devCacheStats.entries, "g", 1.0, prepBuff, sizeof(prepBuff),1);
+    strcat(updateBuffer,prepBuff);
+    statsd_prepare(pStatsdLink, "deviceCache.hits", devCacheStats.hits, "c", sampleRate, prepBuff, sizeof(prepBuff),1);
+    strcat(updateBuffer,prepBuff);
+    statsd_prepare(pStatsdLink, "deviceCache.misses", devCacheStats.misses, "c", sampleRate, prepBuff, sizeof(prepBuff),1);
+    strcat(updateBuffer,prepBuff);
+    statsd_prepare(pStatsdLink, "deviceCache.contended", devCacheStats.contended, "c", sampleRate, prepBuff, sizeof(prepBuff),1);
+    strcat(updateBuffer,prepBuff);
+    statsd_prepare(pStatsdLink, "deviceCache.evicted", devCacheStats.evicted, "c", sampleRate, prepBuff, sizeof(prepBuff),1);
+    strcat(updateBuffer,prepBuff);
 
     //memory
     // Note this doesn't have to be a nested for loop, statsd doesn't care which order the stats are added
@@ -585,9 +585,7 @@ int checkDisableCRL(ima_transport_info_t * transporti) {
     ism_tenant_t * tenant = NULL;
     if (!transport || !transport->tenant) {
         if (transport->sniName) {
-            ism_tenant_lock();
-            tenant = ism_tenant_getTenant(transport->sniName);
-            ism_tenant_unlock();
+            tenant = ism_tenant_findTenant(transport->sniName, NULL, NULL);
         }
     }
     return tenant ? (tenant->disableCRL==1) : 0;
@@ -22,6 +22,9 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netdb.h>
+#include <zlib.h>
+#include <lz4frame.h>
+#include <zstd.h>
 #include <pxkafka.h>
 #include <pxrouting.h>
 #include <pxmqtt.h>
@@ -185,6 +188,7 @@ float g_msproxies_count = 1;
 static int                kafka_api_version = 0;
 static uint16_t           kafka_produce_version = 0;
 static uint16_t           kafka_metadata_version = 0;
+static int                kafka_compression = KAFKA_COMPRESS_NONE;  /* Metering record batch compression */
 #endif
 static uint8_t            kafka_message_version = 0;
 #ifndef NO_PROXY
@@ -215,6 +219,12 @@ int ism_kafka_metering_init(int useKafka, int useTLS) {
     kafka_batch_size = ism_common_getIntConfig("KafkaMeteringBatchSize", kafka_batch_size);
     if (kafka_batch_size < 1)
         kafka_batch_size = 1;
+    kafka_compression = ism_kafka_compressionValue(ism_common_getStringConfig("KafkaMeteringCompression"));
+    if (kafka_compression < 0)
+        kafka_compression = KAFKA_COMPRESS_NONE;
+    /* The metering produce request is before version 7 which is required for zstd */
+    if (kafka_compression == KAFKA_COMPRESS_ZSTD)
+        kafka_compression = KAFKA_COMPRESS_GZIP;
     host = ism_common_getHostnameInfo();
     if (!host)
         host = "imaproxy";
@@ -239,8 +249,9 @@ int ism_kafka_metering_init(int useKafka, int useTLS) {
         }
     }
     if (g_useKafka) {
-        TRACE(3, "Initialize kafka metering: useKafka=%u useTLS=%u kafkaAPIVersion=%d topic=%s batch=%u time=%usec\n",
-                g_useKafka, g_useKafkaTLS, kafka_api_version, kafka_metering_topic, kafka_batch_size, kafka_batch_seconds);
+        TRACE(3, "Initialize kafka metering: useKafka=%u useTLS=%u kafkaAPIVersion=%d topic=%s batch=%u time=%usec compression=%s\n",
+                g_useKafka, g_useKafkaTLS, kafka_api_version, kafka_metering_topic, kafka_batch_size, kafka_batch_seconds,
+                ism_kafka_compressionName(kafka_compression));
         kafka_timer = ism_common_setTimerRate(ISM_TIMER_LOW, kafkaProduceTimer, NULL, 2100, 900, TS_MILLISECONDS);
     }
     if (g_useKafkaTLS)
@@ -510,7 +521,7 @@ int ism_kafka_addMeteringRecordBatch(ism_transport_t * transport, concat_alloc_t
     ism_kafka_putInt4(buf, 0);        /* partitionLeaderEpoch: not set on produce */
     ism_kafka_putInt1(buf, kafka_message_version);        /* magic */
     crcpos = ism_protocol_reserveBuffer(buf, 4);
-    ism_kafka_putInt2(buf, 0);        /* attributes: no compress, client timestamp, no transaction  */
+    ism_kafka_putInt2(buf, 0);        /* attributes: compression set later, client timestamp, no transaction  */
     tsloc = ism_protocol_reserveBuffer(buf, 20);
     ism_kafka_putInt8(buf, -1L);        /* producerId: must set to use exactly once */
     ism_kafka_putInt2(buf, -1);        /* producerEpoch: must set to use exactly once */
@@ -556,6 +567,8 @@ int ism_kafka_addMeteringRecordBatch(ism_transport_t * transport, concat_alloc_t
     ism_kafka_putInt8At(buf, tsloc+4, mintime);
     ism_kafka_putInt8At(buf, tsloc+12, maxtime);
     ism_kafka_putInt4At(buf, recordcount, count);
+    if (kafka_compression)
+        ism_kafka_compressRecords(buf, crcpos+4, recordcount+4, kafka_compression);
     uint32_t crc = ism_common_crc32c(0, buf->buf+crcpos+4, buf->used-crcpos-4);
     ism_kafka_putInt4At(buf, crcpos, crc);                   /* Fill in CRC */
     ism_kafka_putInt4At(buf, batchsize, buf->used-batchsize-4);  /* Fill in message size */
@@ -4239,3 +4252,199 @@ void ism_kafka_putVarLong(concat_alloc_t * buf, int64_t ilen) {
 }
 
 
+
+/*
+ * Kafka record batch compression.
+ *
+ * The records section of a record batch (everything after the record count)
+ * can be compressed as a whole.  The codec is put in the low three bits of the
+ * record batch attributes and the record count is left as the uncompressed count.
+ * The CRC is calculated after compression.
+ */
+static ism_enumList enum_compression [] = {
+    { "Compression", 4,                     },
+    { "none",        KAFKA_COMPRESS_NONE,   },
+    { "gzip",        KAFKA_COMPRESS_GZIP,   },
+    { "lz4",         KAFKA_COMPRESS_LZ4,    },
+    { "zstd",        KAFKA_COMPRESS_ZSTD,   },
+};
+
+/*
+ * Return the codec for a compression name, or -1 if it is not known
+ */
+int ism_kafka_compressionValue(const char * name) {
+    int codec;
+    if (!name || !*name)
+        return KAFKA_COMPRESS_NONE;
+    codec = ism_common_enumValue(enum_compression, name);
+    return codec == INVALID_ENUM ? -1 : codec;
+}
+
+/*
+ * Return the name of a compression codec
+ */
+const char * ism_kafka_compressionName(int codec) {
+    const char * name = ism_common_enumName(enum_compression, codec);
+    return name ? name : "none";
+}
+
+/*
+ * Compress using gzip
+ */
+static int compressGzip(const char * in, int inlen, concat_alloc_t * out) {
+    z_stream strm = {0};
+    int rc;
+    if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15+16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return -1;
+    int maxlen = deflateBound(&strm, inlen);
+    ism_protocol_ensureBuffer(out, maxlen);
+    strm.next_in = (Bytef *)in;
+    strm.avail_in = inlen;
+    strm.next_out = (Bytef *)(out->buf + out->used);
+    strm.avail_out = maxlen;
+    rc = deflate(&strm, Z_FINISH);
+    if (rc == Z_STREAM_END)
+        out->used += strm.total_out;
+    deflateEnd(&strm);
+    return rc == Z_STREAM_END ? 0 : -1;
+}
+
+/*
+ * Compress using the LZ4 frame format.
+ * Kafka requires independent blocks of at most 64KB.
+ */
+static int compressLZ4(const char * in, int inlen, concat_alloc_t * out) {
+    LZ4F_preferences_t prefs;
+    memset(&prefs, 0, sizeof prefs);
+    prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+    prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+    size_t maxlen = LZ4F_compressFrameBound(inlen, &prefs);
+    ism_protocol_ensureBuffer(out, (int)maxlen);
+    size_t len = LZ4F_compressFrame(out->buf + out->used, maxlen, in, inlen, &prefs);
+    if (LZ4F_isError(len))
+        return -1;
+    out->used += (int)len;
+    return 0;
+}
+
+/*
+ * Compress using zstd
+ */
+static int compressZstd(const char * in, int inlen, concat_alloc_t * out) {
+    size_t maxlen = ZSTD_compressBound(inlen);
+    ism_protocol_ensureBuffer(out, (int)maxlen);
+    size_t len = ZSTD_compress(out->buf + out->used, maxlen, in, inlen, 3);
+    if (ZSTD_isError(len))
+        return -1;
+    out->used += (int)len;
+    return 0;
+}
+
+/*
+ * Compress the records of a record batch in place.
+ *
+ * If the codec fails gzip is used instead, and if the data does not get smaller it
+ * is left uncompressed.
+ *
+ * @param buf     The buffer containing the record batch
+ * @param attrpos The location of the attributes in the record batch
+ * @param recpos  The location of the first record
+ * @param codec   The compression codec
+ * @return The codec used
+ */
+int ism_kafka_compressRecords(concat_alloc_t * buf, int attrpos, int recpos, int codec) {
+    char xbuf[16*1024];
+    concat_alloc_t cbuf = {xbuf, sizeof xbuf};
+    int inlen = buf->used - recpos;
+    int rc;
+
+    if (codec == KAFKA_COMPRESS_NONE || inlen <= 0)
+        return KAFKA_COMPRESS_NONE;
+    switch (codec) {
+    case KAFKA_COMPRESS_LZ4:  rc = compressLZ4(buf->buf+recpos, inlen, &cbuf);   break;
+    case KAFKA_COMPRESS_ZSTD: rc = compressZstd(buf->buf+recpos, inlen, &cbuf);  break;
+    default:                  rc = -1;                                           break;
+    }
+    if (rc) {
+        if (codec != KAFKA_COMPRESS_GZIP)
+            TRACE(5, "Kafka compression failed, using gzip: codec=%s\n", ism_kafka_compressionName(codec));
+        codec = KAFKA_COMPRESS_GZIP;
+        cbuf.used = 0;
+        rc = compressGzip(buf->buf+recpos, inlen, &cbuf);
+    }
+    if (rc || cbuf.used >= inlen) {
+        codec = KAFKA_COMPRESS_NONE;
+    } else {
+        buf->used = recpos;
+        ism_common_allocBufferCopyLen(buf, cbuf.buf, cbuf.used);
+        buf->buf[attrpos+1] = (char)(buf->buf[attrpos+1] | codec);     /* attributes: low byte */
+    }
+    if (cbuf.inheap)
+        ism_common_freeAllocBuffer(&cbuf);
+    return codec;
+}
+
+/*
+ * Decompress the records of a record batch.
+ * This is the inverse of ism_kafka_compressRecords() and is used in test.
+ *
+ * @param codec  The compression codec from the attributes
+ * @param in     The compressed records
+ * @param inlen  The length of the compressed records
+ * @param out    The output buffer.  The records are appended.
+ * @return A return code, 0=good
+ */
+int ism_kafka_decompressRecords(int codec, const char * in, int inlen, concat_alloc_t * out) {
+    switch (codec & KAFKA_COMPRESS_MASK) {
+    case KAFKA_COMPRESS_NONE:
+        ism_common_allocBufferCopyLen(out, in, inlen);
+        return 0;
+    case KAFKA_COMPRESS_GZIP: {
+        z_stream strm = {0};
+        int rc;
+        if (inflateInit2(&strm, 15+16) != Z_OK)
+            return -1;
+        strm.next_in = (Bytef *)in;
+        strm.avail_in = inlen;
+        do {
+            ism_protocol_ensureBuffer(out, inlen*4 + 1024);
+            strm.next_out = (Bytef *)(out->buf + out->used);
+            strm.avail_out = out->len - out->used;
+            rc = inflate(&strm, Z_NO_FLUSH);
+            out->used = out->len - strm.avail_out;
+        } while (rc == Z_OK);
+        inflateEnd(&strm);
+        return rc == Z_STREAM_END ? 0 : -1;
+    }
+    case KAFKA_COMPRESS_LZ4: {
+        LZ4F_dctx * dctx;
+        size_t rc;
+        if (LZ4F_isError(LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION)))
+            return -1;
+        do {
+            size_t srclen = inlen;
+            size_t dstlen;
+            ism_protocol_ensureBuffer(out, inlen*4 + 1024);
+            dstlen = out->len - out->used;
+            rc = LZ4F_decompress(dctx, out->buf + out->used, &dstlen, in, &srclen, NULL);
+            out->used += (int)dstlen;
+            in += srclen;
+            inlen -= (int)srclen;
+        } while (!LZ4F_isError(rc) && rc != 0 && inlen > 0);
+        LZ4F_freeDecompressionContext(dctx);
+        return (LZ4F_isError(rc) || rc != 0) ? -1 : 0;
+    }
+    case KAFKA_COMPRESS_ZSTD: {
+        unsigned long long outlen = ZSTD_getFrameContentSize(in, inlen);
+        if (outlen == ZSTD_CONTENTSIZE_ERROR || outlen == ZSTD_CONTENTSIZE_UNKNOWN)
+            return -1;
+        ism_protocol_ensureBuffer(out, (int)outlen);
+        size_t len = ZSTD_decompress(out->buf + out->used, (size_t)outlen, in, inlen);
+        if (ZSTD_isError(len))
+            return -1;
+        out->used += (int)len;
+        return 0;
+    }
+    }
+    return -1;
+}
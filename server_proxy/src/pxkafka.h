@@ -43,6 +43,10 @@ extern "C" {
 #define	KAFKA_ERROR_NETWORKEXCEPTION					13
 #define KAFKA_ERROR_NOTENOUGHREPLICAS				19
 #define	KAFKA_ERROR_NOTENOUGHREPLICASAFTERAPPEND		20
+#define KAFKA_ERROR_OUTOFORDERSEQUENCE				45
+#define KAFKA_ERROR_DUPLICATESEQUENCE				46
+#define KAFKA_ERROR_INVALIDPRODUCEREPOCH				47
+#define KAFKA_ERROR_UNKNOWNPRODUCERID				59
 
 
 
@@ -75,6 +79,50 @@ typedef struct kafka_produce_msg_t {
     uint64_t  				waitID;
 } kafka_produce_msg_t;
 
+/*
+ * Kafka record batch compression codecs.
+ * These are the values in the low bits of the record batch attributes.
+ */
+#define KAFKA_COMPRESS_NONE     0
+#define KAFKA_COMPRESS_GZIP     1
+#define KAFKA_COMPRESS_SNAPPY   2     /* Not supported for produce */
+#define KAFKA_COMPRESS_LZ4      3
+#define KAFKA_COMPRESS_ZSTD     4     /* Requires produce version 7 */
+#define KAFKA_COMPRESS_MASK     7
+
+/*
+ * Return the compression codec for a name (none, gzip, lz4, zstd).
+ * @param name  The codec name. A null or empty name is none.
+ * @return The codec or -1 if the name is not known
+ */
+XAPI int ism_kafka_compressionValue(const char * name);
+
+/*
+ * Return the name of a compression codec
+ */
+XAPI const char * ism_kafka_compressionName(int codec);
+
+/*
+ * Compress the records of a record batch in place and set the codec in the attributes.
+ * gzip is used if the codec fails, and the records are left uncompressed if they do not get smaller.
+ * @param buf     The buffer containing the record batch
+ * @param attrpos The location of the attributes in the buffer
+ * @param recpos  The location of the first record in the buffer
+ * @param codec   The compression codec
+ * @return The codec used
+ */
+XAPI int ism_kafka_compressRecords(concat_alloc_t * buf, int attrpos, int recpos, int codec);
+
+/*
+ * Decompress the records of a record batch.
+ * @param codec  The codec from the record batch attributes
+ * @param in     The compressed records
+ * @param inlen  The length of the compressed records
+ * @param out    The output buffer.  The uncompressed records are appended.
+ * @return A return code, 0=good
+ */
+XAPI int ism_kafka_decompressRecords(int codec, const char * in, int inlen, concat_alloc_t * out);
+
 #define    KAFKA_PARTITION_CONN_OPEN   		0x1
 #define    KAFKA_PARTITION_CONN_OPENING   	0x2
 #define    KAFKA_PARTITION_CONN_CLOSING   	0x4
@@ -124,8 +124,11 @@ static int mhubReceiveMetadata(ism_transport_t * transport, char * inbuf, int bu
 static void freeKafkaEvent(kafka_produce_msg_t * msg);
 static void mhubMetadataRequest(ism_mhub_t * mhub, ism_transport_t * transport);
 int ism_mhub_message_produce(ism_transport_t * transport, ism_mhub_t * mhub, mhub_part_t * mhub_part,
-        kafka_produce_msg_t * msgs, int * producedMsgsCount, int isResend);
-static kafka_produce_msg_t *  checkMHubEventBatch(ism_mhub_t * mhub, mhub_part_t * mhub_part, ism_time_t now, int closing) ;
+        kafka_produce_msg_t * msgs, int * producedMsgsCount, int isResend, mhub_batch_t * batch);
+kafka_produce_msg_t *  ism_mhub_checkEventBatch(ism_mhub_t * mhub, mhub_part_t * mhub_part, ism_time_t now, int closing,
+        mhub_batch_t * * pbatch) ;
+static void requeueAckWait(mhub_part_t * mhub_part);
+static void mhubInitProducerIdRequest(ism_mhub_t * mhub, ism_transport_t * transport);
 static int mhubPartitionProduceTimer(ism_timer_t timer, ism_time_t timestamp, void * userdata) ;
 int ism_mqtt_propgen(ism_prop_t * xprops, ism_emsg_t * emsg, const char * name, ism_field_t * f, void * extra, ismMessageSelectionLockStrategy_t * lockStrategy);
 static int needMHubBatch(ism_mhub_t * mhub, mhub_part_t * mhub_part, ism_time_t now);
@@ -152,6 +155,8 @@ int ism_mqtt_mpropSet(mqtt_prop_ctx_t * ctx, void * userdata, mqtt_prop_field_t
 static int mhubBatchTimeMillis = 250;
 static int mhubBatchSize = 100;   //100 msgs max
 static int mhubBatchSizeBytes = 250000;  //Maximum number of bytes per produce
+static int mhubCompression = KAFKA_COMPRESS_NONE;  //Default record batch compression
+static int mhubMaxInFlight = 1;   //Produce requests in flight per partition
 static const char * mhubCiphers = "ECDHE-RSA-AES128-GCM-SHA256:DHE-DSS-AES128-SHA";
 static const char * mhubTLS = "TLSv1.2";
 static int  mhubACKs = 1;
@@ -189,6 +194,14 @@ int ism_mhub_init(void) {
     mhubBatchTimeMillis = ism_common_getIntConfig("MessageHubBatchTimeMillis", mhubBatchTimeMillis);
     mhubBatchSize = ism_common_getIntConfig("MessageHubBatchSize", mhubBatchSize);
     mhubBatchSizeBytes = ism_common_getIntConfig("MessageHubBatchSizeBytes", mhubBatchSizeBytes);
+    mhubCompression = ism_kafka_compressionValue(ism_common_getStringConfig("MessageHubCompression"));
+    if (mhubCompression < 0)
+        mhubCompression = KAFKA_COMPRESS_NONE;
+    mhubMaxInFlight = ism_common_getIntConfig("MessageHubMaxInFlight", mhubMaxInFlight);
+    if (mhubMaxInFlight < 1)
+        mhubMaxInFlight = 1;
+    if (mhubMaxInFlight > MHUB_MAX_INFLIGHT)
+        mhubMaxInFlight = MHUB_MAX_INFLIGHT;
 
 #ifndef NO_PROXY
     const char * prop;
@@ -1020,6 +1033,7 @@ static mhub_topic_t * changePartitions(ism_mhub_t * mhub, mhub_topic_t * mtopic,
 
     		//Process Message in the WaitACK Queue & Regular Msg Queue
     		total_msg_transferred = partitionMsgsTransfer(ret, old_part->kafka_ackwait_msg_first);
+		total_msg_transferred+= partitionMsgsTransfer(ret, old_part->kafka_resend_msg_first);
 		total_msg_transferred+= partitionMsgsTransfer(ret, old_part->kafka_msg_first);
 
     		pthread_mutex_unlock(&old_part->lock);
@@ -1474,6 +1488,8 @@ static int makeKafkaCon(ism_json_parse_t * parseobj, int where, ism_tenant_t * t
     int  need = 0;
     int  needlog = 1;
     int  maxBytesSet = 0;
+    int  compressionSet = 0;
+    int  maxInFlightSet = 0;
 
     if (!parseobj || where > parseobj->ent_count)
         return 1;
@@ -1591,6 +1607,16 @@ static int makeKafkaCon(ism_json_parse_t * parseobj, int where, ism_tenant_t * t
                 ism_common_setErrorData(ISMRC_BadPropertyValue, "%s%s", "MaxBatchTimeMS", ism_json_getJsonValue(ent));
                 rc = ISMRC_BadPropertyValue;
             }
+        } else if (!strcmp(ent->name, "Compression")) {
+            if ((ent->objtype != JSON_String || ism_kafka_compressionValue(ent->value) < 0) && ent->objtype != JSON_Null) {
+                ism_common_setErrorData(ISMRC_BadPropertyValue, "%s%s", "Compression", ism_json_getJsonValue(ent));
+                rc = ISMRC_BadPropertyValue;
+            }
+        } else if (!strcmp(ent->name, "MaxInFlight")) {
+            if ((ent->objtype != JSON_Integer || ent->count < 1 || ent->count > MHUB_MAX_INFLIGHT) && ent->objtype != JSON_Null) {
+                ism_common_setErrorData(ISMRC_BadPropertyValue, "%s%s", "MaxInFlight", ism_json_getJsonValue(ent));
+                rc = ISMRC_BadPropertyValue;
+            }
         } else if (!strcmp(ent->name, "TimeZone")) {
             if (ent->objtype != JSON_String && ent->objtype != JSON_Null) {
                 ism_common_setErrorData(ISMRC_BadPropertyValue, "%s%s", ent->name, ism_json_getJsonValue(ent));
@@ -1735,6 +1761,18 @@ static int makeKafkaCon(ism_json_parse_t * parseobj, int where, ism_tenant_t * t
                 if (mhub->maxBatchTimeMS != ent->count)
                     need |= 1;
                 mhub->maxBatchTimeMS = ent->count;
+            } else if (!strcmp(ent->name, "Compression")) {
+                if (ent->objtype != JSON_Null) {
+                    mhub->compression = ism_kafka_compressionValue(ent->value);
+                    compressionSet = 1;
+                }
+            } else if (!strcmp(ent->name, "MaxInFlight")) {
+                if (ent->objtype != JSON_Null) {
+                    if (mhub->maxInFlight != ent->count)
+                        need |= 1;
+                    mhub->maxInFlight = ent->count;
+                    maxInFlightSet = 1;
+                }
             } else if (!strcmp(ent->name, "RoutingRule")) {
                 int rulecount = ent->count;
                 if (ent->objtype == JSON_Null) {
@@ -1820,6 +1858,10 @@ static int makeKafkaCon(ism_json_parse_t * parseobj, int where, ism_tenant_t * t
         if(!maxBytesSet){
         		mhub->maxBatchBytes=mhubBatchSizeBytes;
         }
+        if (!compressionSet)
+            mhub->compression = mhubCompression;
+        if (!maxInFlightSet)
+            mhub->maxInFlight = mhubMaxInFlight;
         //Set default maximum limits
         if(!mhub->maxBatchMsgs)
              mhub->maxBatchMsgs=mhubBatchSize;
@@ -1880,6 +1922,10 @@ void ism_mhub_getKafkaConnectionJson(ism_json_t * jobj, ism_mhub_t * mhub, const
         ism_json_putIntegerItem(jobj, "MaxBatchSize", mhub->maxBatchBytes);
      if (mhub->maxBatchTimeMS > 0)
         ism_json_putIntegerItem(jobj, "MaxBatchTimeMS", mhub->maxBatchTimeMS);
+    if (mhub->compression)
+        ism_json_putStringItem(jobj, "Compression", ism_kafka_compressionName(mhub->compression));
+    if (mhub->maxInFlight > 1)
+        ism_json_putIntegerItem(jobj, "MaxInFlight", mhub->maxInFlight);
     const char * tzname = ism_common_getTimeZoneName(mhub->timezone);
     if (tzname)
         ism_json_putStringItem(jobj, "TimeZone", tzname);
@@ -2118,6 +2164,8 @@ static ism_mhub_t * makeMhub(ism_json_parse_t * parseobj, int where, ism_tenant_
         mhub->maxBatchMsgs=mhubBatchSize;
         mhub->maxBatchBytes=mhubBatchSizeBytes;
         mhub->maxBatchTimeMS = mhubBatchTimeMillis;
+        mhub->compression = mhubCompression;
+        mhub->maxInFlight = mhubMaxInFlight;
 
         ism_mhub_unlock(mhub);
     }
@@ -2210,11 +2258,13 @@ static int closeConnections(ism_mhub_t * mhub) {
 				pthread_mutex_lock(&mhub_part->lock);
 
 				//Discard msgs
-				if(mhub_part->kafka_ackwait_msg_first){
-					kafka_produce_msg_t * msgs = mhub_part->kafka_ackwait_msg_first;
-					mhub_part->kafka_ackwait_msg_first=NULL;
-					mhub_part->kafka_ackwait_msg_last=NULL;
-					mhub_part->hasackwait=0;
+				requeueAckWait(mhub_part);
+				mhub_part->resend = 0;
+				mhub_part->inflight_discard = 0;
+				mhub_part->batch_head = 0;
+				if(mhub_part->kafka_resend_msg_first){
+					kafka_produce_msg_t * msgs = mhub_part->kafka_resend_msg_first;
+					mhub_part->kafka_resend_msg_first=NULL;
 					int msgcnt=0;
 					while (msgs) {
 						kafka_produce_msg_t * msg;
@@ -2698,6 +2748,27 @@ char * ism_mhub_toString(ism_mhub_t * mhub) {
     return ret;
 }
 
+/*
+ * zstd compressed record batches are only accepted in produce version 7 (Kafka 2.1) and later.
+ * Use that version when the broker supports it.  Otherwise zstd is replaced by gzip when
+ * the batch is built.
+ */
+static void setCompressProduceVersion(ism_mhub_t * mhub) {
+    if (mhub->compression == KAFKA_COMPRESS_ZSTD && mhub->messageVersion >= 2 &&
+            mhub->versionKnown && mhub->verProduce >= 7) {
+        mhub->produceVersion = 7;
+    }
+}
+
+/*
+ * Return the compression codec to use for a record batch
+ */
+static int getCompressCodec(ism_mhub_t * mhub) {
+    if (mhub->compression == KAFKA_COMPRESS_ZSTD && mhub->produceVersion < 7)
+        return KAFKA_COMPRESS_GZIP;
+    return mhub->compression;
+}
+
 /*
  * Map from a single API version to the other versions to use
  */
@@ -2722,6 +2793,9 @@ void ism_mhub_mapKafkaVersion(ism_mhub_t * mhub, int version) {
          mhub->produceVersion = 1;
          break;
      }
+     setCompressProduceVersion(mhub);
+     /* Get the producer ID again for the new produce version */
+     mhub->producerIdValid = 0;
 }
 
 
@@ -2917,10 +2991,14 @@ static int needMetadata(ism_mhub_t * mhub)
  * @param partrc    The part return code
  * @param offset    The returned offset of the produce
  * @param timestamp The returned timestamp of the produce (v2 and above only)
+ * @param corrid    The correlation ID of the produce request
  * @return 1 if we need to request metadata
  */
-static int produceResponse(ism_mhub_t * mhub, const char * topicn, int topiclen, int partid, int partrc, uint64_t offset, int64_t timestamp) {
+int ism_mhub_produceResponse(ism_mhub_t * mhub, const char * topicn, int topiclen, int partid, int partrc, uint64_t offset,
+        int64_t timestamp, int corrid) {
 	int needmetadata=0;
+	int needproduce=0;
+	int tindex=0;
 	char * topic = (char * )alloca(topiclen+1);
 	memcpy(topic, topicn, topiclen);
 	topic[topiclen] = '\0';
@@ -2938,6 +3016,7 @@ static int produceResponse(ism_mhub_t * mhub, const char * topicn, int topiclen,
 		mhub_topic_t * mhub_topic = mhub->topics[tcount];
 		if (!strcmp(mhub_topic->name, topic)) {
 			partition = (mhub_part_t *)&mhub_topic->partitions[partid];
+			tindex = tcount;
 			break;
 		}
 	}
@@ -2952,11 +3031,33 @@ static int produceResponse(ism_mhub_t * mhub, const char * topicn, int topiclen,
 	pthread_spin_unlock(&g_mhubStatLock);
 
 	pthread_mutex_lock(&partition->lock);
-	
+
+	/*
+	 * After a produce error the requests which were in flight behind the failed one
+	 * are sent again, so ignore their responses.
+	 */
+	if (partition->inflight_discard) {
+		partition->inflight_discard--;
+		TRACE(7, "produceResponse discarded: topic=%s partid=%d partrc=%d corrid=%d\n", topic, partid, partrc, corrid);
+		pthread_mutex_unlock(&partition->lock);
+		return 0;
+	}
+
+	/* The response is for the oldest batch in flight */
+	mhub_batch_t * batch = partition->inflight ? partition->batches + partition->batch_head : NULL;
+	if (batch && batch->corrid != (uint16_t)corrid && partrc == KAFKA_ERROR_NOERROR) {
+		TRACE(4, "produceResponse out of order: topic=%s partid=%d corrid=%d expected=%u\n", topic, partid, corrid, batch->corrid);
+		partrc = KAFKA_ERROR_UNKNOW;
+	}
+	/* An idempotent batch which was already written is complete */
+	if (partrc == KAFKA_ERROR_DUPLICATESEQUENCE && batch && batch->baseSequence >= 0)
+		partrc = KAFKA_ERROR_NOERROR;
+
 	if (partrc == KAFKA_ERROR_NOERROR) {
 		kafka_produce_msg_t * msgs = partition->kafka_ackwait_msg_first;
 		int msgcnt=0;
-		while (msgs) {
+		int ackcnt = batch ? batch->msgcount : INT32_MAX;
+		while (msgs && msgcnt < ackcnt) {
 			kafka_produce_msg_t * msg;
 			msg = msgs;
 			msgs = msgs->next;
@@ -2967,9 +3068,17 @@ static int produceResponse(ism_mhub_t * mhub, const char * topicn, int topiclen,
 			freeKafkaEvent(msg);
 
 		}
-		partition->kafka_ackwait_msg_first=NULL;
-		partition->kafka_ackwait_msg_last=NULL;
-		partition->hasackwait=0;
+		partition->kafka_ackwait_msg_first=msgs;
+		if (!msgs)
+			partition->kafka_ackwait_msg_last=NULL;
+		if (batch) {
+			partition->batch_head = (partition->batch_head + 1) % MHUB_MAX_INFLIGHT;
+			partition->inflight--;
+		}
+
+		/* Send the next batch now if one is ready rather than waiting for the timer */
+		if (batch && partition->transport && needMHubBatch(mhub, partition, currTimeInNanos) > 0)
+			needproduce = 1;
 
 		/* Reset produceErrorCount */
 		partition->produceErrorCount=0;
@@ -2994,6 +3103,9 @@ static int produceResponse(ism_mhub_t * mhub, const char * topicn, int topiclen,
         partition->produceErrorCount++;
         partition->produceErrorTotalCount++;
         partition->needreproduce=1; //Need to reproduce if any
+        /* The requests in flight after this one will fail or be duplicates so they are sent again */
+        if (partition->inflight > 1)
+            partition->inflight_discard = partition->inflight - 1;
 		TRACE(6, "produceResponse Error: topic=%s partid=%d partrc=%d pendMsgs=%d totalProduceErrors=%llu\n", topic, partid, partrc,
 												partition->kafka_msg_count, (ULL) mhubMessagingStats.kakfaTotalBatchProduceAckErrorCount );
 
@@ -3015,6 +3127,16 @@ static int produceResponse(ism_mhub_t * mhub, const char * topicn, int topiclen,
 			needmetadata=1;
 		}
 
+		/*
+		 * The broker no longer accepts the idempotent sequence.  Get a new producer ID
+		 * with the metadata and send the batches again with new sequences.
+		 */
+		if (partrc==KAFKA_ERROR_OUTOFORDERSEQUENCE || partrc==KAFKA_ERROR_INVALIDPRODUCEREPOCH ||
+				partrc==KAFKA_ERROR_UNKNOWNPRODUCERID) {
+			mhub->producerIdValid = 0;
+			needmetadata=1;
+		}
+
 	    /*
 		 * Disable MHub if certain amount of error reached.
 		 * Check if there is maximum allowed time for Error before Shutdown
@@ -3032,6 +3154,8 @@ static int produceResponse(ism_mhub_t * mhub, const char * topicn, int topiclen,
 
 	partition->produceLastRC=partrc;
 
+	if (needproduce)
+		ism_transport_submitAsyncJobRequest(partition->transport, mhubProduceJob, (void *)mhub, (((uint64_t)tindex)<<32) + partid);
 	pthread_mutex_unlock(&partition->lock);
 
 	if (shutdown_mhub) {
@@ -3228,7 +3352,10 @@ static int mhubReceiveKafka(ism_transport_t * transport, char * inbuf, int bufle
             if (mhub->produceVersion >= 2) {
                 timestamp = ism_kafka_getInt8(buf);
             }
-            needmetadata += produceResponse(mhub, topicname, topiclen, partid, partrc, offset, timestamp);
+            if (mhub->produceVersion >= 5) {
+                ism_kafka_getInt8(buf);                /* log_start_offset: not used */
+            }
+            needmetadata += ism_mhub_produceResponse(mhub, topicname, topiclen, partid, partrc, offset, timestamp, corrid);
         }
     }
     if (mhub->produceVersion >= 1) {
@@ -3455,6 +3582,7 @@ static int receiveApiVersions(ism_transport_t * transport, concat_alloc_t * buf)
                  mhubver = 2;
              ism_mhub_mapKafkaVersion(mhub, mhubver);
          }
+         setCompressProduceVersion(mhub);
          ism_mhub_unlock(mhub);
          TRACE(4, "Kafka version %s: mhub=%s produce=%u fetch=%u metadata=%u saslHandshake=%u saslAuthenticate=%u\n",
                  kver, mhub->id, mhub->verProduce, mhub->verFetch, mhub->verMetadata, mhub->verSaslHandshake, mhub->verSaslAuthenticate);
@@ -3715,6 +3843,30 @@ static int mhubReceiveMetadata(ism_transport_t * transport, char * inbuf, int bu
         return receiveSASL(transport, inbuf, buflen, kind);
     }
 
+    /*
+     * InitProducerId Response (Version: 0) => throttle_time_ms error_code producer_id producer_epoch
+     */
+    if (corrid == 0x20016) {
+        ism_kafka_getInt4(buf);                    /* throttle_time_ms */
+        int krc = ism_kafka_getInt2(buf);
+        int64_t producerId = ism_kafka_getInt8(buf);
+        int producerEpoch = ism_kafka_getInt2(buf);
+        if (krc || ism_kafka_more(buf) < 0) {
+            TRACE(4, "MessageHub InitProducerId failed, produce is not idempotent: mhub=%s rc=%d\n", mhub->id, krc);
+        } else {
+            ism_mhub_lock(mhub);
+            mhub->producerId = producerId;
+            mhub->producerEpoch = (int16_t)producerEpoch;
+            if (mhub->produceVersion < 3)
+                mhub->produceVersion = 3;
+            mhub->producerIdValid = 1;
+            ism_mhub_unlock(mhub);
+            TRACE(5, "MessageHub idempotent produce: mhub=%s producerId=%lld epoch=%d maxInFlight=%u\n",
+                    mhub->id, (long long)producerId, producerEpoch, mhub->maxInFlight);
+        }
+        return 0;
+    }
+
     LOG(INFO, Server, 982, "%u%s%s%u%s", "Mhub Metadata received: connect={0} name={1} server_addr={2} server_port={3} broker={4}",
     				transport->index, transport->name, transport->server_addr, transport->serverport,
     							(mhub->trybroker>0)?mhub->brokers[mhub->trybroker-1]:mhub->brokers[0]);
@@ -3788,6 +3940,8 @@ static int mhubReceiveMetadata(ism_transport_t * transport, char * inbuf, int bu
         LOG(INFO, Server, 984, "%u%s%s%u%s",  "Mhub Metadata processing is completed: connect={0} name={1} server_addr={2} server_port={3} broker={4}",
         		transport->index, transport->name, transport->server_addr, transport->serverport,
 				(mhub->trybroker>0)?mhub->brokers[mhub->trybroker-1]:mhub->brokers[0]);
+        if (!mhub->producerIdValid)
+            mhubInitProducerIdRequest(mhub, transport);
     }
     return 0;
 }
@@ -4014,6 +4168,33 @@ static void mhubMetadataRequest(ism_mhub_t * mhub, ism_transport_t * transport)
     transport->send(transport, buf->buf+4, buf->used-4, 0, SFLAG_FRAMESPACE);
 }
 
+/*
+ * Make the InitProducerId request to get a producer ID for idempotent produce.
+ *
+ * Idempotent produce lets more than one produce request be in flight for a partition
+ * while keeping the messages in order.  The broker requires acks=all for this.
+ *
+ * InitProducerId Request (Version: 0) => transactional_id transaction_timeout_ms
+ */
+static void mhubInitProducerIdRequest(ism_mhub_t * mhub, ism_transport_t * transport) {
+    char xbuf [256];
+    concat_alloc_t cbuf = {xbuf, sizeof xbuf, 4};
+    concat_alloc_t * buf = &cbuf;
+
+    if (g_shuttingDown || mhub->maxInFlight <= 1 || mhub->mhubACK != -1 || mhub->messageVersion < 2 ||
+            !mhub->versionKnown || mhub->verProduce < 3 || mhub->verInitProducerId == 0xff)
+        return;
+
+    ism_kafka_putInt2(buf, InitProducerIdRequest);  /* Api key */
+    ism_kafka_putInt2(buf, 0);                      /* InitProducerId version */
+    ism_kafka_putInt4(buf, 0x20016);                /* CorrID */
+    ism_kafka_putString(buf, transport->name, -1);
+    ism_kafka_putInt2(buf, -1);                     /* transactional_id: null */
+    ism_kafka_putInt4(buf, 60000);                  /* transaction_timeout_ms: not used */
+    TRACE(6, "MessageHub InitProducerId request: connect=%u mhub=%s\n", transport->index, mhub->id);
+    transport->send(transport, buf->buf+4, buf->used-4, 0, SFLAG_FRAMESPACE);
+}
+
 /*
  * Make the DescribeConfigs request
  * DescribeConfigs Request (Version: 0) => [resources]
@@ -4079,6 +4260,7 @@ static int moreConnected(ism_transport_t * transport) {
                 pthread_mutex_lock(&part->lock);
                 part->open = 1;
                 part->needreproduce=1;
+                part->inflight_discard = 0;   /* Responses on the old connection are lost */
                 pthread_mutex_unlock(&part->lock);
                 mhub->open +=1;
                 mhub->notopen -=1;
@@ -4661,15 +4843,40 @@ static int ism_mhub_addMsgToAckWaitList(mhub_part_t * mhub_part, kafka_produce_m
 	return 0;
 }
 
+/*
+ * Set the idempotent producer fields of a batch.
+ *
+ * A batch sent again keeps its sequence unless the producer ID has changed.  A new producer ID
+ * or epoch starts the partition sequence again at zero.
+ */
+static void setBatchSequence(ism_mhub_t * mhub, mhub_part_t * mhub_part, mhub_batch_t * batch, int count) {
+    if (!mhub->producerIdValid) {
+        batch->producerId = -1;
+        batch->producerEpoch = -1;
+        batch->baseSequence = -1;
+    } else if (batch->baseSequence < 0 || batch->producerId != mhub->producerId || batch->producerEpoch != mhub->producerEpoch) {
+        if (mhub_part->seqProducerId != mhub->producerId || mhub_part->seqProducerEpoch != mhub->producerEpoch) {
+            mhub_part->seqProducerId = mhub->producerId;
+            mhub_part->seqProducerEpoch = mhub->producerEpoch;
+            mhub_part->sequence = 0;
+        }
+        batch->producerId = mhub->producerId;
+        batch->producerEpoch = mhub->producerEpoch;
+        batch->baseSequence = mhub_part->sequence;
+        mhub_part->sequence = (mhub_part->sequence + count) & 0x7fffffff;
+    }
+}
+
 /*
  * Add a kafka record batch which is the message data for v2
  * @param connRecord The kafka connection record
  * @param buf        The output buffer
  * @param msgs       The linked list of messages to write
  * @param msgcnt     (output) the count of messages produced
+ * @param batch      The batch in flight, or NULL if the batch is not acknowledged
  */
 int ism_mhub_addEventRecordBatch(ism_transport_t * transport, ism_mhub_t * mhub, mhub_part_t * mhub_part,
-        concat_alloc_t * buf, kafka_produce_msg_t * msgs, int * msgcnt) {
+        concat_alloc_t * buf, kafka_produce_msg_t * msgs, int * msgcnt, mhub_batch_t * batch) {
     int  startused = buf->used;
     int  batchsize;
     int  crcpos;
@@ -4691,7 +4898,7 @@ int ism_mhub_addEventRecordBatch(ism_transport_t * transport, ism_mhub_t * mhub,
     ism_kafka_putInt4(buf, 0);        /* partitionLeaderEpoch: not set on produce */
     ism_kafka_putInt1(buf, mhub->messageVersion);        /* magic */
     crcpos = ism_protocol_reserveBuffer(buf, 4);
-    ism_kafka_putInt2(buf, 0);        /* attributes: no compress, client timestamp, no transaction  */
+    ism_kafka_putInt2(buf, 0);        /* attributes: compression set later, client timestamp, no transaction  */
     tsloc = ism_protocol_reserveBuffer(buf, 20);
     ism_kafka_putInt8(buf, -1L);       /* producerId: must set to use exactly once */
     ism_kafka_putInt2(buf, -1);        /* producerEpoch: must set to use exactly once */
@@ -4750,8 +4957,17 @@ int ism_mhub_addEventRecordBatch(ism_transport_t * transport, ism_mhub_t * mhub,
     ism_kafka_putInt8At(buf, tsloc+4, mintime);
     ism_kafka_putInt8At(buf, tsloc+12, maxtime);
     ism_kafka_putInt4At(buf, recordcount, count);
+    if (batch && count) {
+        setBatchSequence(mhub, mhub_part, batch, count);
+        ism_kafka_putInt8At(buf, tsloc+20, batch->producerId);
+        buf->buf[tsloc+28] = (char)(batch->producerEpoch >> 8);
+        buf->buf[tsloc+29] = (char)batch->producerEpoch;
+        ism_kafka_putInt4At(buf, tsloc+30, batch->baseSequence);
+    }
     if (msgcnt)
         *msgcnt = count;
+    if (mhub->compression)
+        ism_kafka_compressRecords(buf, crcpos+4, recordcount+4, getCompressCodec(mhub));
     uint32_t crc = ism_common_crc32c(0, buf->buf+crcpos+4, buf->used-crcpos-4);
     ism_kafka_putInt4At(buf, crcpos, crc);                   /* Fill in CRC */
     ism_kafka_putInt4At(buf, batchsize, buf->used-batchsize-4);  /* Fill in message size */
@@ -4808,6 +5024,52 @@ int mhubPartitionProduceTimer(ism_timer_t timer, ism_time_t timestamp, void * us
 }
 
 
+/*
+ * Return the number of produce requests which can be in flight for a partition.
+ *
+ * More than one is only allowed for idempotent produce as otherwise a failed
+ * request which is sent again would be out of order.
+ */
+static int partMaxInFlight(ism_mhub_t * mhub, mhub_part_t * mhub_part) {
+    if (!mhub->producerIdValid || mhub->maxInFlight <= 1)
+        return 1;
+    /* A batch sent before the producer ID was known must complete first */
+    if (mhub_part->inflight && mhub_part->batches[mhub_part->batch_head].baseSequence < 0)
+        return 1;
+    return mhub->maxInFlight;
+}
+
+/*
+ * Return how long the first message waits for a batch to fill.
+ *
+ * The wait is shortened as the backlog grows so that a partition with a backlog
+ * keeps the produce requests flowing rather than waiting on a fixed timer.
+ */
+static ism_time_t batchLinger(ism_mhub_t * mhub, mhub_part_t * mhub_part) {
+    ism_time_t linger = mhub->maxBatchTimeMS * MILLION;
+    if (mhub->maxBatchMsgs > 0 && mhub_part->kafka_msg_count < mhub->maxBatchMsgs)
+        linger -= linger * mhub_part->kafka_msg_count / mhub->maxBatchMsgs;
+    else
+        linger = 0;
+    return linger;
+}
+
+/*
+ * Move the messages waiting for an ACK in front of any messages to send again.
+ * The batches keep their order and sequence so they can be sent again as they were.
+ * This is called holding the mhub_part lock
+ */
+static void requeueAckWait(mhub_part_t * mhub_part) {
+    if (mhub_part->kafka_ackwait_msg_first) {
+        mhub_part->kafka_ackwait_msg_last->next = mhub_part->kafka_resend_msg_first;
+        mhub_part->kafka_resend_msg_first = mhub_part->kafka_ackwait_msg_first;
+        mhub_part->kafka_ackwait_msg_first = NULL;
+        mhub_part->kafka_ackwait_msg_last = NULL;
+    }
+    mhub_part->resend += mhub_part->inflight;
+    mhub_part->inflight = 0;
+}
+
 /*
  * Check if we need to produce a batch
  *
@@ -4820,14 +5082,20 @@ static int needMHubBatch(ism_mhub_t * mhub, mhub_part_t * mhub_part, ism_time_t
 	if (mhub_part->needreproduce) {
 		return 3;
 	}
+    /* Wait for the responses of the failed requests before sending again */
+    if (mhub_part->inflight_discard)
+        return -1;
     /* If we are waiting for ACKs, do not produce */
-    if (mhub->mhubACK && mhub_part->hasackwait)
+    if (mhub->mhubACK && mhub_part->inflight >= partMaxInFlight(mhub, mhub_part))
         return -1;
+    /* Send the batches which failed */
+    if (mhub_part->resend)
+        return 3;
     /* If a batch is full complete produce */
     if (mhub_part->kafka_msg_first && (mhub_part->kafka_msg_count > mhub->maxBatchMsgs))
         return 1;
     /* If time is exceeded produce */
-    if (mhub_part->kafka_msg_first && (now - mhub_part->kafka_msg_first_time) > (mhub->maxBatchTimeMS*MILLION) )
+    if (mhub_part->kafka_msg_first && (now - mhub_part->kafka_msg_first_time) > batchLinger(mhub, mhub_part))
         return 2;
     /* Otherwise do not produce */
     return 0;
@@ -4836,32 +5104,65 @@ static int needMHubBatch(ism_mhub_t * mhub, mhub_part_t * mhub_part, ism_time_t
 /*
  * Check to see if a im messaging batch is full, and return the batch if it is.
  * This is called both when we send a message and when start a kafka connection.
+ *
+ * When produce is acknowledged the batch is put in flight and returned in pbatch.
+ * A batch which failed is sent again with the same messages before any new batch.
  */
-static kafka_produce_msg_t *  checkMHubEventBatch(ism_mhub_t * mhub, mhub_part_t * mhub_part, ism_time_t now, int closing) {
+kafka_produce_msg_t *  ism_mhub_checkEventBatch(ism_mhub_t * mhub, mhub_part_t * mhub_part, ism_time_t now, int closing,
+        mhub_batch_t * * pbatch) {
 	kafka_produce_msg_t * doProduce = NULL;
 	kafka_produce_msg_t * produce_msg_first = NULL;
+	mhub_batch_t * batch;
+
+	*pbatch = NULL;
 
 	/*If need to reproduce, send the wait queue for reproduce if any*/
 	if (mhub_part->needreproduce) {
 		mhub_part->needreproduce=0;
-		doProduce = mhub_part->kafka_ackwait_msg_first;
-		if(!closing && mhub->mhubACK && doProduce!=NULL){
-			mhub_part->hasackwait = 1;
+		requeueAckWait(mhub_part);
+	}
+
+	if (mhub_part->kafka_resend_msg_first) {
+		if (closing) {
+			/* Send all of the failed batches at close without waiting for ACKs */
+			doProduce = mhub_part->kafka_resend_msg_first;
+			mhub_part->kafka_resend_msg_first = NULL;
+			mhub_part->resend = 0;
+			mhub_part->inflight_discard = 0;
+			return doProduce;
+		}
+		if (mhub_part->inflight_discard || mhub_part->inflight >= partMaxInFlight(mhub, mhub_part))
+			return NULL;
+
+		/* Send the oldest failed batch again with the same messages */
+		batch = mhub_part->batches + (mhub_part->batch_head + mhub_part->inflight) % MHUB_MAX_INFLIGHT;
+		kafka_produce_msg_t * msg = doProduce = mhub_part->kafka_resend_msg_first;
+		int count = 1;
+		while (msg->next && (mhub_part->resend <= 1 || count < batch->msgcount)) {
+			msg = msg->next;
+			count++;
 		}
-		mhub_part->kafka_ackwait_msg_first=NULL;
-		mhub_part->kafka_ackwait_msg_last=NULL;
+		mhub_part->kafka_resend_msg_first = msg->next;
+		msg->next = NULL;
+		if (mhub_part->resend)
+			mhub_part->resend--;
+		if (!mhub_part->kafka_resend_msg_first)
+			mhub_part->resend = 0;
+		mhub_part->inflight++;
+		*pbatch = batch;
 		return doProduce;
 	}
+	mhub_part->resend = 0;
 
 	if ( closing || (mhub_part->kafka_msg_first!=NULL && (mhub_part->kafka_msg_count > mhub->maxBatchMsgs ||
-        (now - mhub_part->kafka_msg_first_time) > (mhub->maxBatchTimeMS*MILLION) ) )) {
+        (now - mhub_part->kafka_msg_first_time) > batchLinger(mhub, mhub_part) ) )) {
 	    int count = 0;
 
         /*
-         * If there is a message list that is in waiting for ACK state. Use that first
-         * There is ackwait msgs. No need to produce further until he ackwait msgs are cleared
+         * If the partition already has as many produce requests waiting for ACK as it allows,
+         * there is no need to produce further until one of them is acknowledged
          */
-        if (!closing && mhub->mhubACK && mhub_part->hasackwait) {
+        if (!closing && mhub->mhubACK && (mhub_part->inflight_discard || mhub_part->inflight >= partMaxInFlight(mhub, mhub_part))) {
             doProduce = NULL;
         } else {
             /* Need to support the case the queue had millions of messages. batch every batch size allow */
@@ -4892,8 +5193,15 @@ static kafka_produce_msg_t *  checkMHubEventBatch(ism_mhub_t * mhub, mhub_part_t
 				mhub_part->kafka_msg_count =0;
 			}
             	doProduce = produce_msg_first;
-            	if(!closing && mhub->mhubACK){
-            		mhub_part->hasackwait = 1;
+            	if(!closing && mhub->mhubACK && doProduce){
+            		/* Put the new batch in flight.  The count and sequence are set when it is built */
+            		batch = mhub_part->batches + (mhub_part->batch_head + mhub_part->inflight) % MHUB_MAX_INFLIGHT;
+            		memset(batch, 0, sizeof(mhub_batch_t));
+            		batch->baseSequence = -1;
+            		batch->producerId = -1;
+            		batch->producerEpoch = -1;
+            		mhub_part->inflight++;
+            		*pbatch = batch;
             	}
 
 
@@ -4938,7 +5246,7 @@ int ism_mhub_addKafkaBufferMessage(ism_mhub_t * mhub, concat_alloc_t * buf, kafk
  * Send a set of messages to kafka
  */
 int ism_mhub_message_produce(ism_transport_t * transport, ism_mhub_t * mhub, mhub_part_t * mhub_part,
-        kafka_produce_msg_t * msgs, int * producedMsgsCount, int isResend) {
+        kafka_produce_msg_t * msgs, int * producedMsgsCount, int isResend, mhub_batch_t * batch) {
     int msgcnt = 0;
     int msgsize = 0;
     int rc=0;
@@ -4955,8 +5263,16 @@ int ism_mhub_message_produce(ism_transport_t * transport, ism_mhub_t * mhub, mhu
 
     ism_kafka_putInt2(buf, ProduceRequest);         /* Api key */
     ism_kafka_putInt2(buf, mhub->produceVersion);  /* produce version */
-    ism_kafka_putInt4(buf, 1);                      /* CorrID   */
+    /* A batch in flight uses its own correlation ID so the response can be matched to it */
+    if (batch) {
+        if (++mhub_part->corrid == 0)
+            mhub_part->corrid = 1;
+        batch->corrid = mhub_part->corrid;
+    }
+    ism_kafka_putInt4(buf, batch ? batch->corrid : 1);  /* CorrID   */
     ism_kafka_putString(buf, transport->name, -1);
+    if (mhub->produceVersion >= 3)
+        ism_kafka_putInt2(buf, -1);                 /* transactional_id: null */
 
     /*
      * Set Produce Ack.
@@ -4986,7 +5302,7 @@ int ism_mhub_message_produce(ism_transport_t * transport, ism_mhub_t * mhub, mhu
      * This also defines headers which is where to put properties.
      */
     if (mhub->messageVersion >= 2) {
-        msgsize += ism_mhub_addEventRecordBatch(transport, mhub, mhub_part, buf, msgs, &msgcnt);
+        msgsize += ism_mhub_addEventRecordBatch(transport, mhub, mhub_part, buf, msgs, &msgcnt, batch);
     } else {
         /* Implement message versions 0 and 1 */
         while (msgs) {
@@ -5027,6 +5343,8 @@ int ism_mhub_message_produce(ism_transport_t * transport, ism_mhub_t * mhub, mhu
     	pthread_spin_unlock(&g_mhubStatLock);
     }
 
+    if (batch)
+        batch->msgcount = msgcnt;
     int sendBytesSize = buf->used-setsize-4;
     ism_kafka_putInt4At(buf, setsize, sendBytesSize);
     rc = transport->send(transport, buf->buf+4, buf->used-4, 0, SFLAG_FRAMESPACE);
@@ -5075,6 +5393,7 @@ int ism_mhub_message_produce(ism_transport_t * transport, ism_mhub_t * mhub, mhu
  */
 static int  mhubProduceJob(ism_transport_t * transport, void * param1, uint64_t param2) {
     kafka_produce_msg_t * doProduce;
+    mhub_batch_t * batch;
     ism_mhub_t * mhub = (ism_mhub_t *)param1;
     uint32_t topic_ix = (uint32_t)(param2>>32);
     uint32_t partition = (uint32_t)param2;
@@ -5091,20 +5410,30 @@ static int  mhubProduceJob(ism_transport_t * transport, void * param1, uint64_t
     int which = mhub_topic->partcount > 1 ? partition % mhub_topic->partcount : 0;
     mhub_part_t * mhub_part = (mhub_part_t *)&mhub_topic->partitions[which];
 
-    pthread_mutex_lock(&mhub_part->lock);
-    isResend = mhub_part->needreproduce;
-    doProduce = checkMHubEventBatch(mhub, mhub_part, ism_common_currentTimeNanos(), closing);
-    pthread_mutex_unlock(&mhub_part->lock);
-
-    /* If we have a batch to send, do the kafka produce now */
-    if (doProduce) {
-        ism_mhub_message_produce(transport, mhub, mhub_part, doProduce, &producedMsgsCount, isResend);
+    /*
+     * Send batches until there are none ready or the partition has as many
+     * produce requests in flight as it allows.
+     */
+    for (;;) {
+        int msgcnt = 0;
+        pthread_mutex_lock(&mhub_part->lock);
+        isResend = mhub_part->needreproduce || mhub_part->resend;
+        doProduce = ism_mhub_checkEventBatch(mhub, mhub_part, ism_common_currentTimeNanos(), closing, &batch);
+        pthread_mutex_unlock(&mhub_part->lock);
+
+        /* If we have a batch to send, do the kafka produce now */
+        if (!doProduce)
+            break;
+        ism_mhub_message_produce(transport, mhub, mhub_part, doProduce, &msgcnt, isResend, batch);
+        producedMsgsCount += msgcnt;
         if (!mhub->mhubACK) {
 				pthread_spin_lock(&g_mhubStatLock);
-				mhubMessagingStats.kakfaTotalPendingMsgsCount -= producedMsgsCount;
+				mhubMessagingStats.kakfaTotalPendingMsgsCount -= msgcnt;
 				pthread_spin_unlock(&g_mhubStatLock);
-				transport->write_msg += producedMsgsCount;
+				transport->write_msg += msgcnt;
         }
+        if (!batch && !closing)
+            break;
     }
     if (closing) {
         TRACE(3, "Flush messages at closing: name=%s mhub=%s msgcount=%d\n",
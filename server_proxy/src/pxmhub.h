@@ -24,6 +24,26 @@ extern "C" {
 
 
 struct mhub_topic_t ;
+
+/*
+ * The maximum number of produce requests in flight for a partition.
+ * Kafka only keeps idempotent produce ordered for up to 5 in flight requests.
+ */
+#define MHUB_MAX_INFLIGHT 5
+
+/*
+ * A produce request which is waiting for a response or is to be sent again.
+ * A batch is sent again with the same messages and sequence.
+ */
+typedef struct mhub_batch_t {
+    int        msgcount;        /* Count of messages in the record batch */
+    int32_t    baseSequence;    /* Idempotent sequence of the first record, -1=not idempotent */
+    int64_t    producerId;      /* Producer ID the sequence belongs to */
+    int16_t    producerEpoch;   /* Producer epoch the sequence belongs to */
+    uint16_t   corrid;          /* Correlation ID of the last produce of this batch */
+    int        resv;
+} mhub_batch_t;
+
 /*
  * Define a single MessageHub partition
  *
@@ -44,7 +64,10 @@ typedef struct mhub_part_t {
     int						kafka_msg_count;
     int                     resvi;
     ism_time_t				kafka_msg_first_time;
-    uint8_t    				hasackwait;
+    uint8_t    				inflight;            /* Count of produce requests waiting for a response */
+    uint8_t                 inflight_discard;    /* Count of responses to ignore as the batch is sent again */
+    uint8_t                 resend;              /* Count of batches to send again */
+    uint8_t                 batch_head;          /* Index in batches of the oldest unacknowledged batch */
     kafka_produce_msg_t	* 	kafka_ackwait_msg_first;
     kafka_produce_msg_t	* 	kafka_ackwait_msg_last;
     double	 				lastProduceTime;
@@ -52,6 +75,12 @@ typedef struct mhub_part_t {
     int						produceErrorTotalCount;
     int						produceLastRC;
     ism_time_t				produceErrorFirstTimeInNanos;
+    kafka_produce_msg_t *   kafka_resend_msg_first;   /* Messages to send again in batch order */
+    int32_t                 sequence;            /* Next idempotent sequence */
+    uint16_t                corrid;              /* Last produce correlation ID */
+    int16_t                 seqProducerEpoch;    /* Producer epoch the sequence belongs to */
+    int64_t                 seqProducerId;       /* Producer ID the sequence belongs to */
+    mhub_batch_t            batches [MHUB_MAX_INFLIGHT];  /* Unacknowledged batches starting at batch_head */
 } mhub_part_t;
 
 
@@ -150,7 +179,8 @@ struct ism_mhub_t {
     uint8_t          messageVersion;
 
     uint8_t			 describeConfigsVersion;
-    uint8_t          resvi [3];
+    uint8_t          compression;    /* Record batch compression codec: KAFKA_COMPRESS_* */
+    uint8_t          resvi [2];
     uint8_t          mhubSASL;       /* 0=noSASL 1=PLAIN */
     int8_t           mhubACK;        /* ACL count (-1, 0, 1) */
     uint8_t          moreLogs;       /* Do additional logging */
@@ -183,7 +213,9 @@ struct ism_mhub_t {
     const char *     serverName;
     const char *     partitionMap;   /* The partition map (null use default) */
     int              partitionPart;  /* The partition part */
-    uint8_t          resvxx[3];
+    uint8_t          maxInFlight;    /* Maximum produce requests in flight per partition */
+    uint8_t          producerIdValid; /* The producer ID is set and produce is idempotent */
+    uint8_t          resvxx[1];
     uint8_t          use_keymap;    /* 0=internal keymap, 1=specified keymap */
     const char *     keymap;
     const char *     trustCerts;
@@ -192,6 +224,9 @@ struct ism_mhub_t {
     //SASL Mechanism
     ism_sasl_machanism_e     sasl_mechanism;  /*Support PLAIN, SCRAM-SHA-256, SCRAM-SHA-512*/
 
+    int64_t          producerId;     /* Idempotent producer ID from InitProducerId */
+    int16_t          producerEpoch;  /* Idempotent producer epoch from InitProducerId */
+
 };
 
 
@@ -89,6 +89,7 @@ int ism_transport_frameMqtt(ism_transport_t * transport, char * buffer, int pos,
 int ism_transport_addMqttFrame(ism_transport_t * transport, char * buf, int len, int command);
 int ism_transport_connectStream(ism_transport_t * transport, ism_transport_t * ctransport, ism_tenant_t * tenant);
 ism_transport_t * ism_mux_createVirtualConnection(ism_server_t * server, int tid, int * pRC, char * errMsg);
+int ism_mux_getFairSharePause(void);
 int ism_transport_closeWS(ism_transport_t * transport, int rc);
 
 #ifndef NO_PROXY
@@ -3059,6 +3060,13 @@ int ism_mqtt_receive(ism_transport_t * transport, char * inbuf, int buflen, int
                         if (LIKELY(pobj->server_transport != NULL)) {
 
                             rc = pobj->server_transport->send(pobj->server_transport, buf.buf+16, buf.used-16, kind, SFLAG_FRAMESPACE);
+                            /* The mux link is congested and this connection is over its share of it */
+                            if (rc == SRETURN_SUSPEND) {
+                                if (transport->fairuse)
+                                    transport->fairuse(transport, FUR_Pause, ism_mux_getFairSharePause(), 0);
+                                throttle = 1;
+                                rc = 0;
+                            }
 
                             if(command == MT_PUBLISH){
                                 __sync_add_and_fetch(&mqttStats.mqttP2SMsgsSent, 1);
@@ -43,6 +43,7 @@ typedef struct ism_protobj_t {
     uint8_t                 closed;
     int                     rc;
     const char *            reason;
+    px_mux_share_t          share;       /* Fair share of the link */
 } ism_protobj_t;
 
 typedef ism_protobj_t mux_pobj_t;
@@ -55,12 +56,25 @@ typedef ism_protobj_t mux_pobj_t;
 typedef struct vcInfo_t {
     ism_transport_t *   transport;
     uint8_t             state;
+    px_mux_share_t      share;          /* Bytes of the link's fair share used by the stream */
 } vcInfo_t;
 
 /*
  * Stats
  */
 static px_mux_stats_t * muxStats=NULL;  //MUX Stats per IoP
+static px_mux_link_stats_t * muxLinkStats=NULL;  //MUX Stats per link
+
+/*
+ * Each IOP has up to muxMaxLinks physical links to a server.  The first link is
+ * always active and the others are started and stopped based on load.
+ */
+#define MUX_MAX_LINKS 16
+static int muxMaxLinks = 1;
+static int muxLinkStreams = 2000;      /* Streams on a link before another link is started */
+static int muxLinkHighWater = 32;      /* Send queue depth at which a link is congested */
+static int muxFairSharePause = 10;     /* Milliseconds a stream over its fair share stops reading */
+#define MUX_IOP(index) ((index) / muxMaxLinks)
 
 
 static const char * instanceID = NULL;
@@ -100,8 +114,40 @@ XAPI void ism_transport_muxInit(int usemux) {
     sprintf(proxyInfo,"%s %s %s", ism_common_getVersion(), ism_common_getBuildLabel(), ism_common_getBuildTime());
     proxyInfoLength = strlen(proxyInfo);
 
+    muxMaxLinks = ism_common_getIntConfig("MuxMaxLinks", muxMaxLinks);
+    if (muxMaxLinks < 1)
+        muxMaxLinks = 1;
+    if (muxMaxLinks > MUX_MAX_LINKS)
+        muxMaxLinks = MUX_MAX_LINKS;
+    muxLinkStreams = ism_common_getIntConfig("MuxLinkStreams", muxLinkStreams);
+    if (muxLinkStreams < 1)
+        muxLinkStreams = 1;
+    muxLinkHighWater = ism_common_getIntConfig("MuxLinkHighWater", muxLinkHighWater);
+    if (muxLinkHighWater < 1)
+        muxLinkHighWater = 1;
+    muxFairSharePause = ism_common_getIntConfig("MuxFairSharePause", muxFairSharePause);
+    if (muxFairSharePause < 0 || muxFairSharePause > 1000)
+        muxFairSharePause = 10;
+    TRACE(4, "Mux links: maxLinks=%d linkStreams=%d highWater=%d fairSharePause=%d\n",
+            muxMaxLinks, muxLinkStreams, muxLinkHighWater, muxFairSharePause);
+
     /*Initialize Stats object*/
     muxStats = ism_common_calloc(ISM_MEM_PROBE(ism_memory_proxy_mux_stats,1),numOfIOPs, sizeof(px_mux_stats_t));
+    muxLinkStats = ism_common_calloc(ISM_MEM_PROBE(ism_memory_proxy_mux_stats,3),numOfIOPs*muxMaxLinks, sizeof(px_mux_link_stats_t));
+}
+
+/*
+ * Return the number of mux link entries to allocate for a server
+ */
+int ism_mux_getLinkCount(void) {
+    return ism_tcp_getIOPcount() * muxMaxLinks;
+}
+
+/*
+ * Return the time in milliseconds a connection stops reading when it is over its fair share
+ */
+int ism_mux_getFairSharePause(void) {
+    return muxFairSharePause;
 }
 
 extern int ism_transport_createMuxConnection(ism_transport_t * transport);
@@ -118,6 +164,7 @@ static int closeRequestJob(ism_transport_t * transport, void * param1, uint64_t
             if (vcInfo) {
                 if (vcInfo->state & VC_CLOSED_BY_CLIENT) {
                     ism_common_removeArrayElement(transport->pobj->vcArray, i);
+                    __sync_sub_and_fetch(&muxLinkStats[transport->pobj->index].streams, 1);
                     ism_common_free(ism_memory_proxy_mux_virtual_connection,vcInfo);
                 } else {
                     int rc = transport->pobj->rc;
@@ -215,8 +262,12 @@ static int muxConnectionComplete(ism_transport_t * transport, int rc) {
         char * buff;
         char * ptr;
         int totalLen, nameLen, len;
-        char * name = alloca(strlen(instanceID)+16);
-        sprintf(name,"%s.%d",instanceID, transport->tid);
+        char * name = alloca(strlen(instanceID)+32);
+        int link = transport->pobj->index % muxMaxLinks;
+        if (link)
+            sprintf(name,"%s.%d.%d",instanceID, transport->tid, link);
+        else
+            sprintf(name,"%s.%d",instanceID, transport->tid);
         nameLen = strlen(name);
         totalLen = proxyInfoLength + nameLen + 5;
         buff = alloca(totalLen+16);
@@ -316,7 +367,7 @@ int ism_mux_serverConnect(conReq_t * pReq) {
     transport->pobj = pobj;
     transport->receive = muxReceive;
     transport->actionname = muxCommand;
-    transport->tid = index;
+    transport->tid = MUX_IOP(index);
     transport->connected = muxConnectionComplete;
     transport->closing = muxClosing;
     pthread_spin_lock(&server->lock);
@@ -333,7 +384,8 @@ int ism_mux_serverConnect(conReq_t * pReq) {
     transport->name = ism_transport_putString(transport, temp);
     transport->clientID = transport->name;
 
-    __sync_add_and_fetch(&muxStats[pReq->index].physicalConnectionsTotal, 1);
+    __sync_add_and_fetch(&muxStats[MUX_IOP(pReq->index)].physicalConnectionsTotal, 1);
+    __sync_add_and_fetch(&muxLinkStats[pReq->index].opened, 1);
 //    TRACE(7, "Make outgoing connection to server=%s transport=%p\n", server->name, transport);
     if(ism_transport_createMuxConnection(transport))
         completePhysicalConnectionClose(transport);
@@ -344,29 +396,173 @@ int ism_mux_serverConnect(conReq_t * pReq) {
 static int startMuxConnectionTimer(ism_timer_t timer, ism_time_t timestamp, void * userdata) {
     conReq_t * pReq = ((conReq_t*) userdata);
     ism_server_t * server = pReq->server;
-    if(!server->mux[pReq->index].disabled)
-        ism_mux_serverConnect(pReq);
+    serverConnection_t * pSC = &server->mux[pReq->index];
     ism_common_cancelTimer(timer);
+    /* A link which was drained is not restarted unless it was made active again */
+    if (__sync_bool_compare_and_swap(&pSC->linkState, MUXL_Draining, MUXL_Idle)) {
+        TRACE(5, "Mux link is stopped: server=%s index=%d\n", server->name, pReq->index);
+        ism_common_free(ism_memory_proxy_mux_connection, pReq);
+        return 0;
+    }
+    if(!pSC->disabled)
+        ism_mux_serverConnect(pReq);
     return 0;
 }
 
 static void handlePhysicalConnectionClose(conReq_t * pReq, ism_time_t delay) {
-	__sync_sub_and_fetch(&muxStats[pReq->index].physicalConnectionsTotal, 1);
+	__sync_sub_and_fetch(&muxStats[MUX_IOP(pReq->index)].physicalConnectionsTotal, 1);
 	ism_common_setTimerOnce(ISM_TIMER_HIGH, startMuxConnectionTimer, (void*) pReq, delay);
 }
 
+/*
+ * Start an additional physical link
+ */
+static void startMuxLink(ism_server_t * server, int index, ism_time_t delay) {
+    conReq_t * pReq = ism_common_malloc(ISM_MEM_PROBE(ism_memory_proxy_mux_connection,2),sizeof(conReq_t));
+    if (pReq) {
+        pReq->server = server;
+        pReq->index = index;
+        ism_common_setTimerOnce(ISM_TIMER_HIGH, startMuxConnectionTimer, (void*) pReq, delay);
+    } else {
+        server->mux[index].linkState = MUXL_Idle;
+    }
+}
 
 int ism_transport_startMuxConnections(ism_server_t * server) {
     int i;
     for(i = 0; i < numOfIOPs; i++) {
-        conReq_t * pReq = ism_common_malloc(ISM_MEM_PROBE(ism_memory_proxy_mux_connection,1),sizeof(conReq_t));
-        pReq->server = server;
-        pReq->index = i;
-        ism_common_setTimerOnce(ISM_TIMER_HIGH, startMuxConnectionTimer, (void*) pReq, 1000000000);
+        server->mux[i*muxMaxLinks].linkState = MUXL_Active;
+        startMuxLink(server, i*muxMaxLinks, 1000000000);
     }
     return 0;
 }
 
+/*
+ * Close a draining link when its last stream is gone
+ */
+static void checkLinkDrained(ism_transport_t * transport) {
+    serverConnection_t * pSC = &transport->server->mux[transport->pobj->index];
+    if (pSC->linkState == MUXL_Draining && !transport->pobj->closed &&
+            ism_common_getArrayNumElements(transport->pobj->vcArray) == 0) {
+        TRACE(5, "Close mux link which is not needed: connect=%u name=%s\n", transport->index, transport->name);
+        transport->close(transport, 0, 0, "The multiplex link is not needed");
+    }
+}
+
+/*
+ * Choose the link of an IOP for a new stream.
+ *
+ * The active link with the smallest send queue is used, and then the one with the fewest streams.
+ * When all active links are loaded another link is started.  When the load is low the
+ * last active link is drained and closes when its last stream is closed.  Link 0 is never drained.
+ * @param load    The load of each of the muxMaxLinks links of the IOP
+ * @param pStart  Returns the link to start, or -1
+ * @param pDrain  Returns the link to drain, or -1
+ * @return The link to use
+ */
+int ism_mux_chooseLink(const px_mux_link_load_t * load, int * pStart, int * pDrain) {
+    int best = -1;
+    int bestQueue = 0;
+    int bestStreams = 0;
+    int totalStreams = 0;
+    int active = 0;
+    int last = -1;
+    int start = -1;
+    int i;
+
+    *pStart = -1;
+    *pDrain = -1;
+    for (i = 0; i < muxMaxLinks; i++) {
+        if (load[i].linkState != MUXL_Active) {
+            /* Prefer a draining link as it may still be connected */
+            if (start < 0 || (load[i].linkState == MUXL_Draining && load[start].linkState == MUXL_Idle))
+                start = i;
+            continue;
+        }
+        active++;
+        last = i;
+        if (load[i].connected) {
+            totalStreams += load[i].streams;
+            if (best < 0 || load[i].sendQueue < bestQueue ||
+                    (load[i].sendQueue == bestQueue && load[i].streams < bestStreams)) {
+                best = i;
+                bestQueue = load[i].sendQueue;
+                bestStreams = load[i].streams;
+            }
+        }
+    }
+    if (best < 0)
+        best = 0;
+
+    if (bestQueue >= muxLinkHighWater || bestStreams >= muxLinkStreams) {
+        /* All links are loaded so add a link */
+        *pStart = start;
+    } else if (active > 1 && last != 0 && bestQueue < muxLinkHighWater/4 &&
+            totalStreams < (active-1) * muxLinkStreams / 2) {
+        /* The remaining links can take the streams so drain the last one */
+        *pDrain = last;
+    }
+    return best;
+}
+
+/*
+ * Select the physical link for a new stream.
+ * This is called in the IOP thread of the links.
+ */
+static ima_pxtransport_t * muxSelectServerConnection(ism_server_t * server, int tid) {
+    px_mux_link_load_t load[MUX_MAX_LINKS];
+    int base = tid * muxMaxLinks;
+    int best;
+    int start;
+    int drain;
+    int i;
+
+    if (muxMaxLinks == 1)
+        return muxGetServerConnection(server, base);
+
+    for (i = 0; i < muxMaxLinks; i++) {
+        serverConnection_t * pSC = &server->mux[base+i];
+        memset(&load[i], 0, sizeof(px_mux_link_load_t));
+        load[i].linkState = pSC->linkState;
+        if (load[i].linkState != MUXL_Active)
+            continue;
+        pthread_spin_lock(&pSC->lock);
+        if (pSC->transport && pSC->state == PROTOCOL_CONNECTED) {
+            load[i].connected = 1;
+            load[i].sendQueue = pSC->transport->sendQueueSize;
+            load[i].streams = ism_common_getArrayNumElements(pSC->transport->pobj->vcArray);
+        }
+        pthread_spin_unlock(&pSC->lock);
+    }
+    best = ism_mux_chooseLink(load, &start, &drain);
+
+    if (start >= 0) {
+        int state = load[start].linkState;
+        if (__sync_bool_compare_and_swap(&server->mux[base+start].linkState, state, MUXL_Active)) {
+            TRACE(5, "Mux link is started: server=%s index=%d queue=%d streams=%d\n", server->name, base+start,
+                    load[best].sendQueue, load[best].streams);
+            if (state == MUXL_Idle)
+                startMuxLink(server, base+start, 1000000);
+        }
+    } else if (drain >= 0) {
+        if (__sync_bool_compare_and_swap(&server->mux[base+drain].linkState, MUXL_Active, MUXL_Draining)) {
+            TRACE(5, "Mux link is draining: server=%s index=%d streams=%d\n", server->name, base+drain, load[drain].streams);
+            if (best == drain)
+                best = 0;
+            ima_pxtransport_t * transport = muxGetServerConnection(server, base+drain);
+            if (transport) {
+                checkLinkDrained(transport);
+                muxFreeServerConnection(transport);
+            }
+        }
+    }
+
+    ima_pxtransport_t * transport = muxGetServerConnection(server, base+best);
+    if (!transport && best != 0)
+        transport = muxGetServerConnection(server, base);
+    return transport;
+}
+
 static int muxReceive(ism_transport_t * transport, char * data, int datalen, int kind) {
     ism_muxHdr_t hdr = {0};
     int cmd;
@@ -434,9 +630,11 @@ static int muxReceive(ism_transport_t * transport, char * data, int datalen, int
                 if(vcInfo->state & VC_CLOSED_BY_CLIENT) {
                     ism_common_removeArrayElement(pobj->vcArray, stream);
                     __sync_sub_and_fetch(&muxStats[transport->tid].virtualConnectionsTotal, 1);
+                    __sync_sub_and_fetch(&muxLinkStats[pobj->index].streams, 1);
                     TRACE(8, "MuxCloseStream:  transport_index=%u transport_name=%s transport->tid=%d VirtualConnectionsTotal=%lu\n",
                                                 transport->index, transport->name, transport->tid, muxStats[transport->tid].virtualConnectionsTotal);
                     ism_common_free(ism_memory_proxy_mux_virtual_connection,vcInfo);
+                    checkLinkDrained(transport);
                 }
             }
         } else {
@@ -541,6 +739,7 @@ static int vcCloseJob(ism_transport_t * transport, void * param1, uint64_t param
         } else {
         	ism_common_removeArrayElement(mxTran->pobj->vcArray, vcTran->virtualSid);
         	__sync_sub_and_fetch(&muxStats[transport->tid].virtualConnectionsTotal, 1);
+        	__sync_sub_and_fetch(&muxLinkStats[mxTran->pobj->index].streams, 1);
             TRACE(8, "vcCloseJob: after removal: transport_index=%u transport_name=%s transport->tid=%d VirtualConnectionsTotal=%lu\n",
                         transport->index, transport->name, transport->tid, muxStats[transport->tid].virtualConnectionsTotal);
         	ism_common_free(ism_memory_proxy_mux_virtual_connection,vcInfo);
@@ -553,6 +752,8 @@ static int vcCloseJob(ism_transport_t * transport, void * param1, uint64_t param
             if(ism_common_getArrayNumElements(mxTran->pobj->vcArray) == 0) {
                 completePhysicalConnectionClose(mxTran);
             }
+        } else {
+            checkLinkDrained(mxTran);
         }
     }
     return 0;
@@ -587,6 +788,7 @@ static  ism_transport_t * createVirtualConnection(ism_transport_t * transport, i
             if(vtransport) {
                 vcInfo->state = VC_OPEN;
                 vcInfo->transport = vtransport;
+                memset(&vcInfo->share, 0, sizeof(px_mux_share_t));
                 vtransport->tobj = (struct ism_transobj *) transport;
                 vtransport->virtualSid = streamID;
                 vtransport->close = vcClose;
@@ -604,6 +806,7 @@ static  ism_transport_t * createVirtualConnection(ism_transport_t * transport, i
                 vtransport->originated = 1;
                 sendCreateStream(transport, streamID);
                 __sync_add_and_fetch(&muxStats[transport->tid].virtualConnectionsTotal, 1);
+                __sync_add_and_fetch(&muxLinkStats[pobj->index].streams, 1);
                 TRACE(8, "createVirtualConnection: transport_index=%u transport_name=%s transport->tid=%d virtualConnectionsTotal=%lu\n",
                                     transport->index, transport->name, transport->tid, muxStats[transport->tid].virtualConnectionsTotal);
                 return vtransport;
@@ -628,7 +831,7 @@ static  ism_transport_t * createVirtualConnection(ism_transport_t * transport, i
 
 XAPI  ism_transport_t * ism_mux_createVirtualConnection(ism_server_t * server, int tid, int * pRC, char * errMsg) {
     ism_transport_t * vcTran = NULL;
-    ism_transport_t * mxTran = muxGetServerConnection(server, tid);
+    ism_transport_t * mxTran = muxSelectServerConnection(server, tid);
     if(mxTran) {
         vcTran = createVirtualConnection(mxTran, pRC, errMsg);
         muxFreeServerConnection(mxTran);
@@ -640,14 +843,77 @@ XAPI  ism_transport_t * ism_mux_createVirtualConnection(ism_server_t * server, i
 }
 
 
+/*
+ * Apply the fair share of a link to a stream.
+ *
+ * When the send queue of the link is over the high water mark, a stream which has sent
+ * more than its share of the link in the current window is asked to stop reading.
+ * This is only done when there can be more than one link, so a single link is not paused.
+ * @param link    The fair share of the link
+ * @param stream  The fair share of the stream
+ * @param stats   The stats of the link
+ * @param window  The current fair share window
+ * @param queue   The send queue depth of the link
+ * @param len     The bytes sent
+ * @return SRETURN_SUSPEND if the stream is over its fair share, otherwise SRETURN_OK
+ */
+int ism_mux_fairShare(px_mux_share_t * link, px_mux_share_t * stream, px_mux_link_stats_t * stats,
+        uint32_t window, int queue, int len) {
+    if (muxMaxLinks == 1)
+        return SRETURN_OK;
+
+    __sync_add_and_fetch(&stats->bytesSent, len);
+    stats->sendQueue = queue;
+
+    if (link->window != window) {
+        link->window = window;
+        link->streams = 0;
+        link->bytes = 0;
+    }
+    if (stream->window != window) {
+        stream->window = window;
+        stream->bytes = 0;
+        link->streams++;
+    }
+    stream->bytes += len;
+    link->bytes += len;
+    if (queue >= muxLinkHighWater && link->streams > 1 && stream->bytes > link->bytes / link->streams) {
+        __sync_add_and_fetch(&stats->paused, 1);
+        return SRETURN_SUSPEND;
+    }
+    return SRETURN_OK;
+}
+
+static int muxFairShare(ism_transport_t * mxTran, ism_transport_t * transport, int len) {
+    mux_pobj_t * pobj = mxTran->pobj;
+    int rc = SRETURN_OK;
+
+    vcInfo_t * vcInfo = ism_common_getArrayElement(pobj->vcArray, transport->virtualSid);
+    if (vcInfo) {
+        uint32_t window = (uint32_t)(ism_common_readTSC() * 10);    /* 100ms window */
+        rc = ism_mux_fairShare(&pobj->share, &vcInfo->share, &muxLinkStats[pobj->index],
+                window, mxTran->sendQueueSize, len);
+        if (rc == SRETURN_SUSPEND) {
+            TRACE(9, "Mux stream over fair share: connect=%u sid=%u bytes=%llu linkBytes=%llu streams=%u queue=%d\n",
+                    transport->index, transport->virtualSid, (ULL)vcInfo->share.bytes, (ULL)pobj->share.bytes,
+                    pobj->share.streams, mxTran->sendQueueSize);
+        }
+    }
+    return rc;
+}
+
 /*
  * Send bytes in a virtual
  * This is set on the virtual transport object
+ *
+ * The data is always sent.  SRETURN_SUSPEND is returned when the stream should stop
+ * sending for a short time as it is over its fair share of a congested link.
  */
 static int muxSend(ism_transport_t * transport, char * buf, int len, int protval, int flags) {
     if(transport->virtualSid) {
         ism_transport_t * mxTran =  ism_transport_getPhysicalTransport(transport);
         char * freePtr = NULL;
+        int rc;
         ism_muxHdr_t hdr = {0};
         hdr.hdr.cmd = MuxData;
         hdr.hdr.stream = transport->virtualSid;
@@ -678,11 +944,12 @@ static int muxSend(ism_transport_t * transport, char * buf, int len, int protval
             len += flen;
         }
         mxTran->send(mxTran, buf, len, hdr.iValue, SFLAG_FRAMESPACE);
+        rc = muxFairShare(mxTran, transport, len);
 
         if (UNLIKELY(freePtr != NULL))
             ism_common_free(ism_memory_proxy_utils,freePtr);
         __sync_add_and_fetch(&transport->write_bytes, len);
-        return SRETURN_OK;
+        return rc;
     }
     return SRETURN_BAD_STATE;
 }
@@ -705,19 +972,38 @@ int ism_proxy_getMuxStats(px_mux_stats_t * stats, int * pCount) {
 }
 
 
+/**
+ *Get MUX stats for each link
+ */
+int ism_proxy_getMuxLinkStats(px_mux_link_stats_t * stats, int * pCount, int * pLinks) {
+    int count = numOfIOPs * muxMaxLinks;
+    *pLinks = muxMaxLinks;
+    if (*pCount < count) {
+        *pCount = count;
+        return 1;
+    }
+    memcpy(stats, muxLinkStats, count * sizeof(px_mux_link_stats_t));
+    *pCount = count;
+    return 0;
+}
+
+
 /**
  * Check if Server Connection is available
  * @param server
- * @param index
+ * @param index  The IOP
  * @return 1 for Server Connection is available. 0 is not
  */
 int ism_mux_checkServerConnection(ism_server_t * server, int index) {
     int retValue=0;
-    pthread_spin_lock(&server->mux[index].lock);
-    if(LIKELY(server->mux[index].transport && (server->mux[index].state == PROTOCOL_CONNECTED))) {
-        retValue=1;
+    int i;
+    for (i = index*muxMaxLinks; !retValue && i < (index+1)*muxMaxLinks; i++) {
+        pthread_spin_lock(&server->mux[i].lock);
+        if(LIKELY(server->mux[i].transport && (server->mux[i].state == PROTOCOL_CONNECTED))) {
+            retValue=1;
+        }
+        pthread_spin_unlock(&server->mux[i].lock);
     }
-    pthread_spin_unlock(&server->mux[index].lock);
     TRACE(8, "ism_proxy_muxCheckServerConnection: index=%d available=%d\n", index, retValue);
     return retValue;
 }
@@ -101,6 +101,7 @@ void ism_route_routerule_destroy(void * inrouteRule)
 		ism_routing_rule_t * routeRule = (ism_routing_rule_t *) inrouteRule;
 		if(routeRule->name) ism_common_free(ism_memory_proxy_routing,routeRule->name);
 		if(routeRule->routeNames) ism_common_free(ism_memory_proxy_routing,routeRule->routeNames);
+		if(routeRule->selectorStr) ism_common_free(ism_memory_proxy_routing,routeRule->selectorStr);
 		if(routeRule->routes) ism_common_destroyArray(routeRule->routes);
 		if (routeRule->selector) ism_common_freeSelectRule(routeRule->selector);
 		if(routeRule->userProperties){
@@ -117,6 +118,470 @@ void ism_route_routerule_destroy(void * inrouteRule)
 }
 
 
+/*
+ * The routing rules are compiled into an index when the rules are changed.
+ *
+ * The index is a tree where each level of the tree is a level of the topic.
+ * A rule is put in the node for the topic levels which its selector requires,
+ * and a level without a required value uses the wildcard child.  Finding the
+ * rules for a message is a walk of the tree for the levels of the topic.
+ *
+ * The topic levels required by a selector are found when the selector is only
+ * a set of conditions joined by AND.  When every condition is a topic level
+ * equal to a string the index decides the rule and the selector is not run.
+ */
+#define ROUTE_INDEX_LEVELS 10
+
+typedef struct route_inode_t {
+    const char *             value;       /* Topic level value */
+    int                      value_len;
+    int                      childcount;
+    int                      childalloc;
+    int                      rulecount;
+    int                      rulealloc;
+    int                      resv;
+    struct route_inode_t * * child;       /* Children sorted by value */
+    struct route_inode_t *   wild;        /* Child for any value */
+    ism_routing_rule_t * *   rules;
+    uint8_t *                exact;       /* The rule is decided by the index */
+} route_inode_t;
+
+typedef struct ism_route_index_t {
+    int                      rulecount;
+    int                      nodecount;
+    route_inode_t *          root;
+} ism_route_index_t;
+
+/*
+ * The topic levels required by a selector
+ */
+typedef struct route_selinfo_t {
+    const char *  value[ROUTE_INDEX_LEVELS];
+    int           value_len[ROUTE_INDEX_LEVELS];
+    int           exact;
+} route_selinfo_t;
+
+enum route_tok_e {
+    RTOK_End     = 0,
+    RTOK_Name    = 1,
+    RTOK_String  = 2,
+    RTOK_Equal   = 3,
+    RTOK_Paren   = 4,
+    RTOK_Other   = 5
+};
+
+/*
+ * Get the next token from a selector.
+ * The token is copied to out and strings have the quotes removed.
+ */
+static int routeToken(const char * * pos, char * out) {
+    const char * sp = *pos;
+    int  tok;
+
+    while (*sp == ' ' || *sp == '\t' || *sp == '\r' || *sp == '\n')
+        sp++;
+    if (!*sp) {
+        tok = RTOK_End;
+    } else if (*sp == '\'') {
+        sp++;
+        while (*sp) {
+            if (*sp == '\'') {
+                if (sp[1] != '\'')
+                    break;
+                sp++;
+            }
+            *out++ = *sp++;
+        }
+        if (*sp)
+            sp++;
+        tok = RTOK_String;
+    } else if (*sp == '(' || *sp == ')') {
+        *out++ = *sp++;
+        tok = RTOK_Paren;
+    } else if (*sp == '=') {
+        *out++ = *sp++;
+        tok = RTOK_Equal;
+    } else if ((*sp >= 'A' && *sp <= 'Z') || (*sp >= 'a' && *sp <= 'z') || *sp == '_' || *sp == '$') {
+        while ((*sp >= 'A' && *sp <= 'Z') || (*sp >= 'a' && *sp <= 'z') || (*sp >= '0' && *sp <= '9') ||
+               *sp == '_' || *sp == '$' || *sp == '.') {
+            *out++ = *sp++;
+        }
+        tok = RTOK_Name;
+    } else {
+        if ((*sp == '<' || *sp == '>' || *sp == '!') && (sp[1] == '=' || sp[1] == '>'))
+            *out++ = *sp++;
+        *out++ = *sp++;
+        tok = RTOK_Other;
+    }
+    *out = 0;
+    *pos = sp;
+    return tok;
+}
+
+/*
+ * Return the topic level selected by a name, or -1 if it is not a topic level
+ */
+static int routeTopicLevel(const char * name) {
+    if (!strcmp(name, "Org"))
+        return 1;
+    if (!strcmp(name, "Type"))
+        return 3;
+    if (!strcmp(name, "ID"))
+        return 5;
+    if (!strcmp(name, "Event"))
+        return 7;
+    if (!strcmp(name, "Fmt"))
+        return 9;
+    if (!memcmp(name, "Topic", 5) && name[5] >= '0' && name[5] <= '9' && !name[6])
+        return name[5] - '0';
+    return -1;
+}
+
+/*
+ * Set a topic level required by a selector
+ */
+static void setRouteLevel(route_selinfo_t * sel, int level, const char * value, int value_len) {
+    if (level < 0 || level >= ROUTE_INDEX_LEVELS || value_len == 0) {
+        sel->exact = 0;
+        return;
+    }
+    if (sel->value[level]) {
+        /* Two values for the same level are decided by the selector */
+        sel->exact = 0;
+        return;
+    }
+    sel->value[level] = value;
+    sel->value_len[level] = value_len;
+}
+
+/*
+ * Set the topic levels required by a topic or the literal start of a topic pattern.
+ * Only complete levels are used from a pattern.
+ */
+static void setRouteTopic(route_selinfo_t * sel, char * topic, int isPattern) {
+    char * tp = topic;
+    char * endp;
+    int    level = 0;
+
+    if (isPattern) {
+        endp = tp;
+        while (*endp && *endp != '%' && *endp != '_')
+            endp++;
+        *endp = 0;
+    }
+    while (level < ROUTE_INDEX_LEVELS) {
+        endp = strchr(tp, '/');
+        if (!endp && isPattern)
+            break;
+        if (endp)
+            *endp = 0;
+        if (*tp)
+            setRouteLevel(sel, level, tp, (int)strlen(tp));
+        if (!endp)
+            break;
+        tp = endp+1;
+        level++;
+    }
+    sel->exact = 0;
+}
+
+/*
+ * Find the topic levels required by a selector.
+ *
+ * A selector which is not only conditions joined by AND is not indexed.
+ * The values point into buf which must be twice the length of the selector.
+ */
+static void analyzeRouteSelector(const char * selector, route_selinfo_t * sel, char * buf) {
+    const char * pos = selector;
+    char * tokv[3];
+    int    tokt[3];
+    int    ntok = 0;
+    int    tok;
+
+    memset(sel, 0, sizeof(route_selinfo_t));
+    sel->exact = 1;
+    if (!selector)
+        return;
+
+    for (;;) {
+        char * out = buf;
+        tok = routeToken(&pos, out);
+        buf += strlen(out) + 1;
+        if (tok == RTOK_Paren ||
+            (tok == RTOK_Name && (!strcmpi(out, "OR") || !strcmpi(out, "BETWEEN")))) {
+            memset(sel, 0, sizeof(route_selinfo_t));
+            return;
+        }
+        if (tok == RTOK_End || (tok == RTOK_Name && !strcmpi(out, "AND"))) {
+            /* The condition is complete */
+            if (ntok == 3 && tokt[1] == RTOK_Equal && tokt[0] == RTOK_Name && tokt[2] == RTOK_String) {
+                if (!strcmp(tokv[0], "Topic"))
+                    setRouteTopic(sel, tokv[2], 0);
+                else
+                    setRouteLevel(sel, routeTopicLevel(tokv[0]), tokv[2], (int)strlen(tokv[2]));
+            } else if (ntok == 3 && tokt[1] == RTOK_Equal && tokt[0] == RTOK_String && tokt[2] == RTOK_Name) {
+                if (!strcmp(tokv[2], "Topic"))
+                    setRouteTopic(sel, tokv[0], 0);
+                else
+                    setRouteLevel(sel, routeTopicLevel(tokv[2]), tokv[0], (int)strlen(tokv[0]));
+            } else if (ntok == 3 && tokt[0] == RTOK_Name && !strcmp(tokv[0], "Topic") &&
+                       tokt[1] == RTOK_Name && !strcmpi(tokv[1], "LIKE") && tokt[2] == RTOK_String) {
+                setRouteTopic(sel, tokv[2], 1);
+            } else {
+                sel->exact = 0;
+            }
+            if (tok == RTOK_End)
+                break;
+            ntok = 0;
+        } else {
+            if (ntok < 3) {
+                tokv[ntok] = out;
+                tokt[ntok] = tok;
+            }
+            ntok++;
+        }
+    }
+}
+
+/*
+ * Find a child of an index node with a linear search while the index is built
+ */
+static route_inode_t * findBuildChild(route_inode_t * node, const char * value, int value_len) {
+    int  i;
+    for (i=0; i<node->childcount; i++) {
+        route_inode_t * child = node->child[i];
+        if (child->value_len == value_len && !memcmp(child->value, value, value_len))
+            return child;
+    }
+    return NULL;
+}
+
+/*
+ * Create an index node
+ */
+static route_inode_t * newRouteINode(ism_route_index_t * index, const char * value, int value_len) {
+    route_inode_t * node = ism_common_calloc(ISM_MEM_PROBE(ism_memory_proxy_routing,7),1, sizeof(route_inode_t) + value_len + 1);
+    char * vp = (char *)(node+1);
+    memcpy(vp, value, value_len);
+    vp[value_len] = 0;
+    node->value = vp;
+    node->value_len = value_len;
+    index->nodecount++;
+    return node;
+}
+
+/*
+ * Add a rule to the index
+ */
+static void addRouteIndexRule(ism_route_index_t * index, ism_routing_rule_t * routeRule, route_selinfo_t * sel) {
+    route_inode_t * node = index->root;
+    route_inode_t * child;
+    int  depth = -1;
+    int  level;
+
+    for (level=0; level<ROUTE_INDEX_LEVELS; level++) {
+        if (sel->value[level])
+            depth = level;
+    }
+    for (level=0; level<=depth; level++) {
+        if (sel->value[level]) {
+            child = findBuildChild(node, sel->value[level], sel->value_len[level]);
+            if (!child) {
+                if (node->childcount == node->childalloc) {
+                    node->childalloc = node->childalloc ? node->childalloc*2 : 8;
+                    node->child = ism_common_realloc(ISM_MEM_PROBE(ism_memory_proxy_routing,8),node->child,
+                            node->childalloc * sizeof(route_inode_t *));
+                }
+                child = newRouteINode(index, sel->value[level], sel->value_len[level]);
+                node->child[node->childcount++] = child;
+            }
+        } else {
+            if (!node->wild)
+                node->wild = newRouteINode(index, "", 0);
+            child = node->wild;
+        }
+        node = child;
+    }
+    if (node->rulecount == node->rulealloc) {
+        node->rulealloc = node->rulealloc ? node->rulealloc*2 : 4;
+        node->rules = ism_common_realloc(ISM_MEM_PROBE(ism_memory_proxy_routing,9),node->rules,
+                node->rulealloc * sizeof(ism_routing_rule_t *));
+        node->exact = ism_common_realloc(ISM_MEM_PROBE(ism_memory_proxy_routing,10),node->exact, node->rulealloc);
+    }
+    node->rules[node->rulecount] = routeRule;
+    node->exact[node->rulecount] = (uint8_t)sel->exact;
+    node->rulecount++;
+    index->rulecount++;
+}
+
+/*
+ * Compare topic level values
+ */
+static int compareRouteValue(const char * v1, int len1, const char * v2, int len2) {
+    int rc = memcmp(v1, v2, len1 < len2 ? len1 : len2);
+    return rc ? rc : len1 - len2;
+}
+
+static int compareRouteINode(const void * n1, const void * n2) {
+    const route_inode_t * node1 = *(const route_inode_t * const *)n1;
+    const route_inode_t * node2 = *(const route_inode_t * const *)n2;
+    return compareRouteValue(node1->value, node1->value_len, node2->value, node2->value_len);
+}
+
+/*
+ * Sort the children of the index nodes so they can be found by a binary search
+ */
+static void sortRouteINode(route_inode_t * node) {
+    int  i;
+    if (node->childcount > 1)
+        qsort(node->child, node->childcount, sizeof(route_inode_t *), compareRouteINode);
+    for (i=0; i<node->childcount; i++)
+        sortRouteINode(node->child[i]);
+    if (node->wild)
+        sortRouteINode(node->wild);
+}
+
+/*
+ * Free an index node and its children
+ */
+static void freeRouteINode(route_inode_t * node) {
+    int  i;
+    for (i=0; i<node->childcount; i++)
+        freeRouteINode(node->child[i]);
+    if (node->wild)
+        freeRouteINode(node->wild);
+    if (node->child)
+        ism_common_free(ism_memory_proxy_routing,node->child);
+    if (node->rules)
+        ism_common_free(ism_memory_proxy_routing,node->rules);
+    if (node->exact)
+        ism_common_free(ism_memory_proxy_routing,node->exact);
+    ism_common_free(ism_memory_proxy_routing,node);
+}
+
+static void freeRouteIndex(ism_route_index_t * index) {
+    if (index) {
+        freeRouteINode(index->root);
+        ism_common_free(ism_memory_proxy_routing,index);
+    }
+}
+
+/*
+ * Compile the routing rules into a new index and replace the current index.
+ * The index is not changed after it is built.
+ * This is called holding the routing config write lock.
+ */
+static void buildRouteIndex(ism_routing_config_t * routeConfig) {
+    ismHashMapEntry ** array;
+    ism_route_index_t * index;
+    ism_route_index_t * oldindex;
+    route_selinfo_t sel;
+    int  i = 0;
+
+    index = ism_common_calloc(ISM_MEM_PROBE(ism_memory_proxy_routing,11),1, sizeof(ism_route_index_t));
+    index->root = newRouteINode(index, "", 0);
+    array = ism_common_getHashMapEntriesArray(routeConfig->routerulemap);
+    while (array[i] != ((void*)-1)) {
+        ism_routing_rule_t * routeRule = (ism_routing_rule_t *)array[i]->value;
+        int   len = routeRule->selectorStr ? (int)strlen(routeRule->selectorStr) : 0;
+        char * buf = ism_common_malloc(ISM_MEM_PROBE(ism_memory_proxy_routing,12),2*len + 2);
+        analyzeRouteSelector(routeRule->selectorStr, &sel, buf);
+        addRouteIndexRule(index, routeRule, &sel);
+        ism_common_free(ism_memory_proxy_routing,buf);
+        i++;
+    }
+    ism_common_freeHashMapEntriesArray(array);
+    sortRouteINode(index->root);
+
+    oldindex = routeConfig->index;
+    routeConfig->index = index;
+    freeRouteIndex(oldindex);
+    TRACE(6, "Proxy Routing: Rule index built: rules=%d nodes=%d\n", index->rulecount, index->nodecount);
+}
+
+/*
+ * Walk the index for the levels of a topic and return the candidate rules
+ */
+static int walkRouteIndex(route_inode_t * node, int level, const char * * part, int * part_len, int partcount,
+        ism_routing_rule_t * * rules, uint8_t * exact, int count, int found) {
+    int  i;
+    for (i=0; i<node->rulecount && found<count; i++) {
+        rules[found] = node->rules[i];
+        exact[found] = node->exact[i];
+        found++;
+    }
+    if (level < partcount) {
+        int low = 0;
+        int high = node->childcount - 1;
+        while (low <= high) {
+            int mid = (low + high) >> 1;
+            route_inode_t * child = node->child[mid];
+            int rc = compareRouteValue(part[level], part_len[level], child->value, child->value_len);
+            if (rc == 0) {
+                found = walkRouteIndex(child, level+1, part, part_len, partcount, rules, exact, count, found);
+                break;
+            }
+            if (rc < 0)
+                high = mid - 1;
+            else
+                low = mid + 1;
+        }
+        if (node->wild)
+            found = walkRouteIndex(node->wild, level+1, part, part_len, partcount, rules, exact, count, found);
+    }
+    return found;
+}
+
+/*
+ * Select the routing rules which match a message
+ */
+int ism_route_selectRules(ism_routing_config_t * routeConfig, const char * topic, int qos,
+        ism_routing_rule_t * * rules, int count) {
+    ism_route_index_t * index = routeConfig->index;
+    const char * part [ROUTE_INDEX_LEVELS];
+    int    part_len [ROUTE_INDEX_LEVELS];
+    int    partcount = 0;
+    const char * tp = topic;
+    uint8_t * exact;
+    int    found;
+    int    selcount = 0;
+    int    i;
+
+    if (!index || count <= 0)
+        return 0;
+
+    /* Split the topic into levels */
+    while (partcount < ROUTE_INDEX_LEVELS) {
+        const char * endp = strchr(tp, '/');
+        part[partcount] = tp;
+        part_len[partcount] = endp ? (int)(endp-tp) : (int)strlen(tp);
+        partcount++;
+        if (!endp)
+            break;
+        tp = endp+1;
+    }
+
+    exact = alloca(count);
+    found = walkRouteIndex(index->root, 0, part, part_len, partcount, rules, exact, count, 0);
+
+    for (i=0; i<found; i++) {
+        int selected = SELECT_TRUE;
+        if (!exact[i]) {
+            ismMessageHeader_t         hdr = {0L, 0, 0, 4, 0, 0, 0, 0};
+            ismMessageAreaType_t       areatype[2] = { ismMESSAGE_AREA_PROPERTIES, ismMESSAGE_AREA_PAYLOAD};
+            size_t                     areasize[2] = {0, 0};
+            void *                     areaptr[2] = {NULL, NULL};
+
+            hdr.Reliability = qos;
+            selected = ism_common_selectMessage(&hdr, 2, areatype, areasize, areaptr, topic, rules[i]->selector, 0, NULL);
+        }
+        TRACE(9, "ism_route_selectRules: topic=%s rule=%s exact=%u selected=%d\n", topic, rules[i]->name, exact[i], selected);
+        if (selected == SELECT_TRUE)
+            rules[selcount++] = rules[i];
+    }
+    return selcount;
+}
+
 int ism_route_config_init(ism_routing_config_t * routeConfig)
 {
 	if(routeConfig){
@@ -147,6 +612,8 @@ int ism_route_config_destroy(ism_routing_config_t * routeConfig)
 		if(routeConfig->routemap){
 			ism_common_destroyHashMapAndFreeValues(routeConfig->routemap, ism_route_route_destroy);
 		}
+		freeRouteIndex(routeConfig->index);
+		routeConfig->index = NULL;
 		pthread_rwlock_unlock(&routeConfig->lock);
 		pthread_rwlock_destroy(&routeConfig->lock);
 		ism_common_free(ism_memory_proxy_routing,routeConfig);
@@ -526,7 +993,7 @@ int makeRouteRule(ism_json_parse_t * parseobj, int where, const char * name, ism
 	ism_routing_rule_t * routeRule =  ism_common_getHashMapElement(routeConfig->routerulemap, name, strlen(name));
 	if(routeRule==NULL){
 		 if (ent->objtype == JSON_Object) {
-			 routeRule = ism_common_calloc(ISM_MEM_PROBE(ism_memory_proxy_routing,2),1, sizeof(ism_routing_route_t));
+			 routeRule = ism_common_calloc(ISM_MEM_PROBE(ism_memory_proxy_routing,2),1, sizeof(ism_routing_rule_t));
 			 routeRule->name = ism_common_strdup(ISM_MEM_PROBE(ism_memory_proxy_routing,1000),name);
 			 routeRule->name_len = strlen(name);
 			 routeRule->routes = ism_common_createArray(32);
@@ -582,10 +1049,21 @@ int makeRouteRule(ism_json_parse_t * parseobj, int where, const char * name, ism
 			if (!strcmpi(ent->name, "Selector")) {
 
 				int ruleLen;
+				if (routeRule->selector) {
+					ism_common_freeSelectRule(routeRule->selector);
+					routeRule->selector = NULL;
+				}
+				if (routeRule->selectorStr) {
+					ism_common_free(ism_memory_proxy_routing,routeRule->selectorStr);
+					routeRule->selectorStr = NULL;
+				}
 				rc = ism_common_compileSelectRuleOpt(&routeRule->selector,
 				                                              (int *)&ruleLen,
 															  ent->value, SELOPT_Internal);
 				TRACE(8, "Proxy Routing: Rule: Selector: %s compileRC=%d ruleLen=%d\n", ent->value, rc, ruleLen);
+				/* Only a selector which compiled is indexed, as a rule without a selector selects all */
+				if (rc == 0)
+					routeRule->selectorStr = ism_common_strdup(ISM_MEM_PROBE(ism_memory_proxy_routing,1000),ent->value);
 
 			} else if (!strcmpi(ent->name, "Routes")) {
 				routeRule->routeNames = ism_common_strdup(ISM_MEM_PROBE(ism_memory_proxy_routing,1000),ent->value);
@@ -643,6 +1121,8 @@ int makeRouteRule(ism_json_parse_t * parseobj, int where, const char * name, ism
 				where++;
 		}
 	}
+	if (routeRule)
+		buildRouteIndex(routeConfig);
 	pthread_rwlock_unlock(&routeConfig->lock);
 	return rc;
 }
@@ -848,7 +1328,6 @@ static int messageRoutingInternal(ism_transport_t * transport, const char * buf,
         int *sendMQTT, ism_routing_config_t * routeConfig)
 {
 	int i=0;
-	ismHashMapEntry ** array;
 	ism_routing_rule_t * routeRule;
 	int sent=0;
 	int rulesMatched = 0;
@@ -883,78 +1362,64 @@ static int messageRoutingInternal(ism_transport_t * transport, const char * buf,
 
 	if(routeConfig && routeConfig->inited){
 		pthread_rwlock_rdlock(&routeConfig->lock);
-		array = ism_common_getHashMapEntriesArray(routeConfig->routerulemap);
-		while(array[i] != ((void*)-1)){
-			routeRule = (ism_routing_rule_t *)array[i]->value;
-			ismMessageHeader_t         hdr = {0L, 0, 0, 4, 0, 0, 0, 0};
-			ismMessageAreaType_t       areatype[2] = { ismMESSAGE_AREA_PROPERTIES, ismMESSAGE_AREA_PAYLOAD};
-			size_t                     areasize[2] = {0, 0};
-			void *                     areaptr[2] = {NULL, NULL};
-			int                        selected;
-			char                       xbuf [1024];
-			concat_alloc_t             props = {xbuf, sizeof(xbuf)};
-
-			hdr.Reliability = qos;
-			areasize[0] = props.used;
-			areaptr[0] = props.buf;
-
-			selected = ism_common_selectMessage(&hdr, 2, areatype, areasize, areaptr, (const char*)topic, routeRule->selector, 0, NULL);
-			TRACE(7, "ism_route_routeMessage: Selection topic=%s qos=%d selected=%d\n", topic, qos, selected );
-			if(selected==SELECT_TRUE){
-				rulesMatched++;
-				//Route the Message Based on the Rule and Route
-				if(routeRule->routes ){
-					int numRoute = ism_common_getArrayNumElements(routeRule->routes);
-					int which =0;
-
-					for(which=0; which < numRoute; which++){
-						ism_routing_route_t * route =  ism_common_getArrayElement(routeRule->routes, which+1);
-						__sync_add_and_fetch(&route->stats.C2PMsgsTotalReceived, 1);
-						if(route->route_type == ROUTE_TYPE_KAFKA){
-							TRACE(7, "ism_route_routeMessage: Publish to Kafka topic=%s qos=%d  selected=%d\n", topic, qos, selected );
-							char xxbuf[512];
-							concat_alloc_t keybuf = {xxbuf, sizeof xxbuf,0};
-							int rc = constructKafkaEventKey(transport, &keybuf , pmsg.topic, pmsg.topic_len);
-							if (rc==0) {
-							    /* TODO: check RC */
-							    int keylen = keybuf.used;
-							    int hdrcount=0;
-							    if (pmsg.prop_len || routeRule->sysProperties || routeRule->userProperties) {
-							        hdrcount = ism_kafka_makeKafkaHeaders(transport, &keybuf, &pmsg,
-							                routeRule->sysProperties, routeRule->userProperties, -1);
-							    }
-								ism_kafka_publishEvent(transport, &pmsg, route->kafka_topic, keybuf.buf, keylen,
-								        hdrcount, keybuf.buf+keylen, keybuf.used-keylen);
-								sent=1;
-							} else {
-								TRACE(7, "ism_route_routeMessage: Failed to create the Kafka Key. topic=%s qos=%d  selected=%d \n", topic, qos, selected );
-							}
-							if (keybuf.inheap)
-								ism_common_freeAllocBuffer(&keybuf);
-
-						}else if(route->route_type == ROUTE_TYPE_MQTT){
-							//Send to MQTT Broker
-							if(route->send_mqtt && sendMQTT!=NULL){
-								if(sendMQTT!=NULL)
-									*sendMQTT=1;
-							}else{
-								if(sendMQTT!=NULL)
-									*sendMQTT=0;
-							}
+		/* Find the rules from the compiled rule index */
+		int ruleCount = routeConfig->index ? routeConfig->index->rulecount : 0;
+		ism_routing_rule_t * * rules = alloca((ruleCount+1) * sizeof(ism_routing_rule_t *));
+		int selCount = ism_route_selectRules(routeConfig, topic, qos, rules, ruleCount);
+		for (i=0; i<selCount; i++) {
+			routeRule = rules[i];
+			TRACE(7, "ism_route_routeMessage: Selection topic=%s qos=%d rule=%s\n", topic, qos, routeRule->name);
+			rulesMatched++;
+			//Route the Message Based on the Rule and Route
+			if(routeRule->routes ){
+				int numRoute = ism_common_getArrayNumElements(routeRule->routes);
+				int which =0;
+
+				for(which=0; which < numRoute; which++){
+					ism_routing_route_t * route =  ism_common_getArrayElement(routeRule->routes, which+1);
+					__sync_add_and_fetch(&route->stats.C2PMsgsTotalReceived, 1);
+					if(route->route_type == ROUTE_TYPE_KAFKA){
+						TRACE(7, "ism_route_routeMessage: Publish to Kafka topic=%s qos=%d rule=%s\n", topic, qos, routeRule->name );
+						char xxbuf[512];
+						concat_alloc_t keybuf = {xxbuf, sizeof xxbuf,0};
+						int rc = constructKafkaEventKey(transport, &keybuf , pmsg.topic, pmsg.topic_len);
+						if (rc==0) {
+						    /* TODO: check RC */
+						    int keylen = keybuf.used;
+						    int hdrcount=0;
+						    if (pmsg.prop_len || routeRule->sysProperties || routeRule->userProperties) {
+						        hdrcount = ism_kafka_makeKafkaHeaders(transport, &keybuf, &pmsg,
+						                routeRule->sysProperties, routeRule->userProperties, -1);
+						    }
+							ism_kafka_publishEvent(transport, &pmsg, route->kafka_topic, keybuf.buf, keylen,
+							        hdrcount, keybuf.buf+keylen, keybuf.used-keylen);
+							sent=1;
+						} else {
+							TRACE(7, "ism_route_routeMessage: Failed to create the Kafka Key. topic=%s qos=%d rule=%s\n", topic, qos, routeRule->name );
 						}
+						if (keybuf.inheap)
+							ism_common_freeAllocBuffer(&keybuf);
+
+					}else if(route->route_type == ROUTE_TYPE_MQTT){
+						//Send to MQTT Broker
+						if(route->send_mqtt && sendMQTT!=NULL){
+							if(sendMQTT!=NULL)
+								*sendMQTT=1;
+						}else{
+							if(sendMQTT!=NULL)
+								*sendMQTT=0;
+						}
+					}
 
-						if(sent)
-						    __sync_add_and_fetch(&route->stats.C2PMsgsTotalSent, 1);
-						TRACE(7, "ism_route_routeMessage: Route stats: routeName=%s msgReceived=%llu msgSent=%llu\n",
-									route->name, (ULL)route->stats.C2PMsgsTotalReceived, (ULL)route->stats.C2PMsgsTotalSent );
+					if(sent)
+					    __sync_add_and_fetch(&route->stats.C2PMsgsTotalSent, 1);
+					TRACE(7, "ism_route_routeMessage: Route stats: routeName=%s msgReceived=%llu msgSent=%llu\n",
+								route->name, (ULL)route->stats.C2PMsgsTotalReceived, (ULL)route->stats.C2PMsgsTotalSent );
 
-					}
 				}
 			}
-			i++;
 		}
 		pthread_rwlock_unlock(&routeConfig->lock);
-		ism_common_freeHashMapEntriesArray(array);
 	}
 
 
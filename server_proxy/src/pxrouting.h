@@ -92,8 +92,11 @@ typedef  struct ism_routing_rule_t {
     ismArray_t 					routes;   			//Array of ism_route_route_t objects
     concat_alloc_t *				userProperties;
     concat_alloc_t *				sysProperties;
+    char *						selectorStr;		//Selector source used to index the rule
 } ism_routing_rule_t;
 
+struct ism_route_index_t;
+
 /**
  * Routing rule object
  */
@@ -104,6 +107,7 @@ typedef  struct ism_routing_config_t {
 	pthread_rwlock_t	   lock;
 	ismHashMap *       routemap;
 	ismHashMap *       routerulemap;
+	struct ism_route_index_t * index;  /* Compiled rule index, replaced as a whole when a rule changes */
 } ism_routing_config_t;
 
 
@@ -131,6 +135,22 @@ int ism_proxy_route_json(ism_json_parse_t * parseobj, int where, ism_routing_con
 int ism_proxy_parseRouteConfig(const char * routing_config, ism_routing_config_t * routeConfig);
 
 
+/**
+ * Select the routing rules which match a message.
+ *
+ * The candidate rules are found from the compiled rule index and the selector is
+ * only run for the rules which the index does not decide.
+ * This is called holding the routing config lock.
+ * @param routeConfig  The routing config
+ * @param topic        The null terminated topic name
+ * @param qos          The QoS of the message
+ * @param rules        The array to return the selected rules
+ * @param count        The size of the rules array
+ * @return the count of selected rules returned
+ */
+int ism_route_selectRules(ism_routing_config_t * routeConfig, const char * topic, int qos,
+        ism_routing_rule_t * * rules, int count);
+
 /**
  * Route Message function
  */
@@ -127,6 +127,7 @@ typedef struct ism_transobj {
 
     /* Throttle values - This is all handled in the IOP thread so no lock or atomics are required */
     double             restart_time;       /* The time to resume reading from the connection */
+    double             pause_time;         /* The time to resume reading after a fair share pause */
     double             reset_time;         /* Start of current 1 second window (zero is not yet set) */
     double             pending_time;       /* Pending count update if message comes before this time */
     double             con_mups;           /* message units per second */
@@ -2565,9 +2566,11 @@ HOT static int processIORequest(ism_connection_t * con, ioProcessorThread iopth,
      * Normal read processing
      */
     if (CAN_READ(state)) {
-        if (con->restart_time && currTime < con->restart_time) {
+        if ((con->restart_time && currTime < con->restart_time) ||
+                (con->pause_time && currTime < con->pause_time)) {
             rc1 = -9;   /* throttle */
         } else {
+            con->pause_time = 0.0;
             if (con->rcvBuffer && con->needBytes == 0) {
                 rc1 = processData(con, NULL);
                 if (rc1 < 0 && rc1 != -9) {
@@ -3672,6 +3675,18 @@ static int ism_tcp_fairuse(ism_transport_t * transport, int request, int val1, i
             }
         }
         break;
+
+    /*
+     * Stop reading for val1 milliseconds.
+     * This is used when the connection is over its share of a congested outgoing link.
+     */
+    case FUR_Pause:
+        if (val1 > 0) {
+            double restart = ism_common_readTSC() + (val1 / 1000.0);
+            if (restart > con->pause_time)
+                con->pause_time = restart;
+        }
+        break;
     }
     return rc;
 }
@@ -131,6 +131,47 @@ typedef struct px_mux_stats_t {
 } px_mux_stats_t;
 XAPI int ism_proxy_getMuxStats(px_mux_stats_t * stats, int * pCount);
 
+/*
+ * Stats for each physical mux link.  There are MuxMaxLinks links for each IOP.
+ */
+typedef struct px_mux_link_stats_t {
+    volatile uint64_t streams;            /* Virtual connections on the link */
+    volatile uint64_t bytesSent;          /* Bytes sent on the link */
+    volatile uint64_t paused;             /* Times a stream was paused as it was over its fair share */
+    volatile uint32_t opened;             /* Times the link was started */
+    volatile int      sendQueue;          /* Send queue depth at the last send */
+} px_mux_link_stats_t;
+XAPI int ism_proxy_getMuxLinkStats(px_mux_link_stats_t * stats, int * pCount, int * pLinks);
+
+/*
+ * Mux link states
+ */
+#define    MUXL_Idle                0    /* The link is not started */
+#define    MUXL_Active              1    /* The link is used for new streams */
+#define    MUXL_Draining            2    /* The link is closed when its last stream closes */
+
+/*
+ * The load of a mux link when the link for a new stream is chosen
+ */
+typedef struct px_mux_link_load_t {
+    int               linkState;          /* MUXL_* */
+    int               connected;          /* The link is connected */
+    int               sendQueue;          /* Send queue depth */
+    int               streams;            /* Virtual connections on the link */
+} px_mux_link_load_t;
+int ism_mux_chooseLink(const px_mux_link_load_t * load, int * pStart, int * pDrain);
+
+/*
+ * Bytes sent on a mux link, or on one of its streams, in the current fair share window
+ */
+typedef struct px_mux_share_t {
+    uint32_t          window;             /* Fair share window */
+    uint32_t          streams;            /* Streams which sent in the window (link only) */
+    uint64_t          bytes;              /* Bytes sent in the window */
+} px_mux_share_t;
+int ism_mux_fairShare(px_mux_share_t * link, px_mux_share_t * stream, px_mux_link_stats_t * stats,
+        uint32_t window, int queue, int len);
+
 #ifdef __cplusplus
 }
 #endif
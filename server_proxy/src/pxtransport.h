@@ -204,6 +204,7 @@ typedef int (* ism_fairuse_t)(ism_transport_t * transport, int request, int val1
 #define FUR_SetMaxMUPS   1   /* val1=mups, val2=multiplier */
 #define FUR_SetUnitSize  2   /* val1=unit size */
 #define FUR_Message      3   /* val1=count  val2=size */
+#define FUR_Pause        4   /* val1=milliseconds */
 
 /**
  * Notify the protocol that the transport is closing.
@@ -50,6 +50,8 @@ xUNUSED static int httpProxyEnabled;
 ism_tenant_t * ismTenants [g_tenant_buckets] = {0};
 ism_user_t *   ismUsers [g_user_buckets] = {0};
 ism_server_t * ismServers = NULL;
+static int     tenantSnapDirty = 0;
+static void    publishTenantSnap(void);
 xUNUSED static int     ismServersCount = 0;
 extern int g_need_dyn_write;
 
@@ -58,6 +60,7 @@ extern int ism_server_startServerConnection(ism_server_t * server);
 struct ssl_ctx_st * ism_transport_clientTlsContext(const char * name, const char * tlsversion, const char * cipher);
 int  ism_monitor_startServerMonitoring(ism_server_t * server);
 int  ism_transport_startMuxConnections(ism_server_t * server);
+int  ism_mux_getLinkCount(void);
 int ism_transport_crlVerify(int gppd, X509StoreCtx * ctx);
 void ism_proxy_changeMsgRouting(ism_tenant_t * tenant, int old_msgRouting);
 int ism_proxy_parseFairUse(tenant_fairuse_t * fairuse, const char * fairUsePolicy, const char * tenant);
@@ -227,6 +230,7 @@ void ism_tenant_init(void) {
   	linkTenant(&meterTenant);
 
 #endif
+    publishTenantSnap();
 }
 
 void ism_tenant_term(void) {
@@ -254,6 +258,8 @@ void ism_tenant_lock_int(const char * file, int line) {
  */
 void ism_tenant_unlock(void) {
     // TRACE(8, "Unlock tenant\n");
+    if (tenantSnapDirty)
+        publishTenantSnap();
     pthread_mutex_unlock(&tenantlock);
 }
 
@@ -370,6 +376,7 @@ static void linkTenant(ism_tenant_t * rtenant) {
     rtenant->hash = ism_proxy_hash(rtenant->name);
     bucket = rtenant->hash % g_tenant_buckets;
     rtenant->next = NULL;
+    tenantSnapDirty = 1;
     if (!ismTenants[bucket]) {
         ismTenants[bucket] = rtenant;
     } else {
@@ -418,6 +425,7 @@ static void unlinkTenant(ism_tenant_t * rtenant) {
     int bucket = rtenant->hash % g_tenant_buckets;
     if (ismTenants[bucket] == NULL)
         return;
+    tenantSnapDirty = 1;
     if (ismTenants[bucket] == rtenant) {
         ismTenants[bucket] = ismTenants[bucket]->next;
     } else {
@@ -474,7 +482,7 @@ int ism_proxy_setTenantAlias(const char * str) {
         ism_common_free(ism_memory_proxy_tenant,g_tenant_alias);
         g_tenant_alias = NULL;
         g_tenant_alias_count=0;
-        /* Do not free the string as we return a pointer into it */
+        /* Do not free the string as we return a pointer into it, and the tenant snapshot points to it */
     }
     if (count) {
         g_tenant_alias_str = ism_common_strdup(ISM_MEM_PROBE(ism_memory_proxy_tenant,1000),str);
@@ -536,6 +544,7 @@ int ism_proxy_setTenantAlias(const char * str) {
         }
         g_tenant_alias_count = count;
     }
+    tenantSnapDirty = 1;
 
     ism_tenant_unlock();
     return rc;
@@ -617,6 +626,187 @@ void unlinkServer(ism_server_t * rserver) {
 }
 #endif
 
+/*
+ * The tenant names and aliases are published as a snapshot so that a connection
+ * can find its tenant without the tenant lock.  A new snapshot is published when
+ * the tenant lock is released after a tenant is linked or unlinked or the aliases
+ * change.  The tenant objects are not freed once linked so the snapshot only needs
+ * to point to them.  A replaced snapshot is kept for a while as a connection might
+ * still be reading it.
+ */
+typedef struct tenant_snapent_t {
+    uint32_t         hash;
+    int              resv;
+    const char *     name;
+    ism_tenant_t *   tenant;
+} tenant_snapent_t;
+
+typedef struct tenant_snapalias_t {
+    const char *     org;
+    const char *     alias;
+    const char *     devid;             /* DeviceID prefix or NULL */
+    int              devid_len;
+    uint32_t         hash;              /* Hash of the org */
+} tenant_snapalias_t;
+
+typedef struct tenant_snap_t {
+    struct tenant_snap_t * next;        /* Next replaced snapshot */
+    ism_time_t       replaced;
+    int              count;
+    int              alias_count;
+    tenant_snapalias_t * alias;
+    uint32_t         bucket [g_tenant_buckets+1];   /* Start of each bucket in ents */
+    tenant_snapent_t ents [];
+} tenant_snap_t;
+
+static tenant_snap_t * volatile tenantSnap = NULL;
+static tenant_snap_t * tenantSnapReplaced = NULL;
+
+#define TENANT_SNAP_KEEP 30     /* Seconds to keep a replaced snapshot */
+
+/*
+ * Free a snapshot
+ */
+static void freeTenantSnap(tenant_snap_t * snap) {
+    if (snap->alias)
+        ism_common_free(ism_memory_proxy_tenant,snap->alias);
+    ism_common_free(ism_memory_proxy_tenant,snap);
+}
+
+/*
+ * Publish a new snapshot of the tenants and aliases.
+ * This is called holding the tenantlock.
+ */
+static void publishTenantSnap(void) {
+    tenant_snap_t * snap;
+    tenant_snap_t * old;
+    tenant_snap_t * * prev;
+    ism_tenant_t * tenant;
+    ism_time_t now = ism_common_currentTimeNanos();
+    int  count = 0;
+    int  pos = 0;
+    int  i;
+
+    tenantSnapDirty = 0;
+    for (i=0; i<g_tenant_buckets; i++) {
+        for (tenant = ismTenants[i]; tenant; tenant = tenant->next)
+            count++;
+    }
+    snap = ism_common_calloc(ISM_MEM_PROBE(ism_memory_proxy_tenant,20),1, sizeof(tenant_snap_t) + count*sizeof(tenant_snapent_t));
+    for (i=0; i<g_tenant_buckets; i++) {
+        snap->bucket[i] = pos;
+        for (tenant = ismTenants[i]; tenant; tenant = tenant->next) {
+            snap->ents[pos].hash = tenant->hash;
+            snap->ents[pos].name = tenant->name;
+            snap->ents[pos].tenant = tenant;
+            pos++;
+        }
+    }
+    snap->bucket[g_tenant_buckets] = pos;
+    snap->count = count;
+#ifndef NO_PROXY
+    if (g_tenant_alias_count) {
+        snap->alias = ism_common_calloc(ISM_MEM_PROBE(ism_memory_proxy_tenant,21),g_tenant_alias_count, sizeof(tenant_snapalias_t));
+        for (i=0; i<g_tenant_alias_count; i++) {
+            snap->alias[i].org   = g_tenant_alias[i*3];
+            snap->alias[i].alias = g_tenant_alias[i*3+1];
+            snap->alias[i].devid = g_tenant_alias[i*3+2];
+            snap->alias[i].devid_len = snap->alias[i].devid ? (int)strlen(snap->alias[i].devid) : 0;
+            snap->alias[i].hash  = ism_proxy_hash(snap->alias[i].org);
+        }
+        snap->alias_count = g_tenant_alias_count;
+    }
+#endif
+
+    /* Make the snapshot content visible before the snapshot */
+    __sync_synchronize();
+    old = tenantSnap;
+    tenantSnap = snap;
+
+    /* Keep the old snapshot and free the ones which have been replaced long enough */
+    prev = &tenantSnapReplaced;
+    while (*prev) {
+        if (now - (*prev)->replaced > TENANT_SNAP_KEEP * 1000000000LL) {
+            tenant_snap_t * freesnap = *prev;
+            *prev = freesnap->next;
+            freeTenantSnap(freesnap);
+        } else {
+            prev = &(*prev)->next;
+        }
+    }
+    if (old) {
+        old->replaced = now;
+        old->next = tenantSnapReplaced;
+        tenantSnapReplaced = old;
+    }
+    TRACE(7, "Publish tenant snapshot: tenants=%d aliases=%d\n", snap->count, snap->alias_count);
+}
+
+/*
+ * Find a tenant by name in a snapshot
+ */
+static ism_tenant_t * findSnapTenant(tenant_snap_t * snap, const char * name) {
+    uint32_t hash = ism_proxy_hash(name);
+    uint32_t bucket = hash % g_tenant_buckets;
+    uint32_t i;
+    for (i=snap->bucket[bucket]; i<snap->bucket[bucket+1]; i++) {
+        if (snap->ents[i].hash == hash && !strcmp(name, snap->ents[i].name))
+            return snap->ents[i].tenant;
+    }
+    return NULL;
+}
+
+/*
+ * Find the tenant for a connection without the tenant lock.
+ * This uses the same rules as ism_tenant_getTenant and ism_tenant_getTenantAlias.
+ */
+ism_tenant_t * ism_tenant_findTenant(const char * name, const char * deviceID, const char * * alias) {
+    tenant_snap_t * snap = tenantSnap;
+    ism_tenant_t * tenant;
+    const char * aliasname = NULL;
+    int  i;
+
+    if (alias)
+        *alias = NULL;
+    if (!name)
+        return NULL;
+
+    /* Before the first snapshot is published use the lock */
+    if (!snap) {
+        ism_tenant_lock();
+#ifndef NO_PROXY
+        if (alias)
+            aliasname = ism_tenant_getTenantAlias(name, deviceID);
+#endif
+        tenant = ism_tenant_getTenant(aliasname ? aliasname : name);
+        ism_tenant_unlock();
+        if (alias)
+            *alias = aliasname;
+        return tenant;
+    }
+
+    if (alias && snap->alias_count) {
+        uint32_t hash = ism_proxy_hash(name);
+        for (i=0; i<snap->alias_count; i++) {
+            tenant_snapalias_t * ap = snap->alias + i;
+            if (ap->hash == hash && !strcmp(name, ap->org)) {
+                if (ap->devid && deviceID) {
+                    /* Filter by deviceID prefix as well */
+                    if (!strncmp(deviceID, ap->devid, ap->devid_len)) {
+                        aliasname = ap->alias;
+                        break;
+                    }
+                } else {
+                    aliasname = ap->alias;
+                    break;
+                }
+            }
+        }
+        *alias = aliasname;
+    }
+    return findSnapTenant(snap, aliasname ? aliasname : name);
+}
+
 
 /*
  * Compute SHA256.
@@ -2230,9 +2420,9 @@ int ism_tenant_makeServer(ism_json_parse_t * parseobj, int where, const char * n
                             ism_monitor_startServerMonitoring(server);
                         if (ism_common_getIntConfig("MqttUseMux", 1)) {
                             int i;
-                            int iopCount = ism_tcp_getIOPcount();
-                            server->mux = ism_common_calloc(ISM_MEM_PROBE(ism_memory_proxy_tenant,15),iopCount, sizeof(serverConnection_t));
-                            for(i = 0; i < iopCount; i++)
+                            int linkCount = ism_mux_getLinkCount();
+                            server->mux = ism_common_calloc(ISM_MEM_PROBE(ism_memory_proxy_tenant,15),linkCount, sizeof(serverConnection_t));
+                            for(i = 0; i < linkCount; i++)
                                 pthread_spin_init(&server->mux[i].lock,0);
                             ism_transport_startMuxConnections(server);
                         }
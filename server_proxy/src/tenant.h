@@ -170,9 +170,10 @@ typedef struct serverConnection_t {
     pthread_spinlock_t          lock;
     ism_serverConnection_State  state;
     uint8_t                     useCount;
-    uint8_t                     index;
+    uint8_t                     linkState;   /* Mux link state: 0=idle, 1=active, 2=draining */
+    uint16_t                    index;
     volatile uint8_t            disabled;
-    uint8_t                     rsrv[5];
+    uint8_t                     rsrv[3];
 } serverConnection_t;
 
 typedef struct ima_pxtransport_t ism_transport_t;
@@ -349,6 +350,13 @@ struct ism_topicrule_t {
  */
 XAPI ism_tenant_t * ism_tenant_getTenant(const char * name);
 
+/*
+ * Find the tenant by name without the tenant lock.
+ * This is used when a connection starts.  If alias is not NULL, the tenant alias
+ * is checked and the alias used is returned in alias.
+ */
+XAPI ism_tenant_t * ism_tenant_findTenant(const char * name, const char * deviceID, const char * * alias);
+
 /*
  * Lock the tenant config
  */
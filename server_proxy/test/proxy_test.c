@@ -108,6 +108,10 @@ void stopCrlTest(void);
 void test_kafkaConnection_parse(void);
 void test_mhub_mapper(void);
 void test_mhub_mapper_perf(void);
+void pxkafka_compress_test(void);
+void pxkafka_inflight_test(void);
+void pxmux_link_test(void);
+void pxmux_fairshare_test(void);
 void tenantTest(void) ;
 void iotrest_nonSecure(void);
 ism_tenant_t* createTestTenant(void);
@@ -154,6 +158,10 @@ CU_TestInfo convert_tests[] = {
 	{ "--- Testing mhub_kafkaConnection      ---", test_kafkaConnection_parse },
 	{ "--- Testing mhub_mapper               ---", test_mhub_mapper },
 	{ "--- Testing mhub_mapper_perf          ---", test_mhub_mapper_perf },
+	{ "--- Testing kafka compression         ---", pxkafka_compress_test },
+	{ "--- Testing kafka produce in flight   ---", pxkafka_inflight_test },
+	{ "--- Testing mux link selection        ---", pxmux_link_test },
+	{ "--- Testing mux fair share            ---", pxmux_fairshare_test },
 	CU_TEST_INFO_NULL
 };
 
@@ -1349,6 +1357,15 @@ void testTenantAlias(void) {
 	CU_ASSERT(ism_tenant_getTenantAlias("zab", "WTR") != NULL);
 	CU_ASSERT(ism_tenant_getTenantAlias("zab", NULL) != NULL);
 
+	//Test the alias is the same when found without the lock
+	const char * falias;
+	ism_tenant_findTenant("def", "WTR123445", &falias);
+	CU_ASSERT(falias != NULL && !strcmp(falias, "ghi"));
+	ism_tenant_findTenant("def", "W", &falias);
+	CU_ASSERT(falias == NULL);
+	ism_tenant_findTenant("zab", NULL, &falias);
+	CU_ASSERT(falias != NULL && !strcmp(falias, "baz"));
+
 	//Test Empty String for Alias
 	CU_ASSERT(ism_proxy_setTenantAlias("") == 0);
 	CU_ASSERT(ism_tenant_getTenantAlias("zab", "123") == NULL);
@@ -2914,6 +2931,9 @@ ism_tenant_t* createTestTenant(void) {
         CU_ASSERT(tenant->allow_anon == 1);
         CU_ASSERT(tenant->allow_systopic == 0);
         CU_ASSERT(tenant->allow_shared == 0);
+
+        //The tenant is found without the lock once the config is done
+        CU_ASSERT(ism_tenant_findTenant("quickstart", NULL, NULL) == tenant);
     }
     return tenant;
 }
@@ -2988,6 +3008,12 @@ void TestUnlinkTenant(ism_tenant_t * tenant) {
     //Get Tenant with Empty Name
     tenant = ism_tenant_getTenant("");
     CU_ASSERT(tenant == NULL);
+
+    //The unlink is published when the tenant lock is released
+    ism_tenant_lock();
+    ism_tenant_unlock();
+    CU_ASSERT(ism_tenant_findTenant("quickstart", NULL, NULL) == NULL);
+    CU_ASSERT(ism_tenant_findTenant(NULL, NULL, NULL) == NULL);
 }
 
 void iotrest_nonSecure(void) {
@@ -3244,6 +3270,8 @@ void updateStatsTest(void) {
 
 #include "pxmqtt_test.c"
 #include "pxrouting_test.c"
+#include "pxkafka_test.c"
+#include "pxmux_test.c"
 /*
  * Main entry point
  */
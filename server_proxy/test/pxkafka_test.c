@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) 2017-2021 Contributors to the Eclipse Foundation
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+/*
+ * Test record batch compression.
+ *
+ * The record batch is built by the MessageHub producer and then received by
+ * a minimal stand-in for the Kafka broker which checks the record batch header
+ * and CRC, decompresses the records, and parses each record.
+ */
+int ism_mhub_addEventRecordBatch(ism_transport_t * transport, ism_mhub_t * mhub, mhub_part_t * mhub_part,
+        concat_alloc_t * buf, kafka_produce_msg_t * msgs, int * msgcnt, mhub_batch_t * batch);
+kafka_produce_msg_t *  ism_mhub_checkEventBatch(ism_mhub_t * mhub, mhub_part_t * mhub_part, ism_time_t now, int closing,
+        mhub_batch_t * * pbatch);
+int ism_mhub_produceResponse(ism_mhub_t * mhub, const char * topicn, int topiclen, int partid, int partrc, uint64_t offset,
+        int64_t timestamp, int corrid);
+
+#define KTEST_MSGS 50
+
+/*
+ * Get an unsigned kafka varint as used for non-negative values
+ */
+static int ktestGetVarInt(concat_alloc_t * buf) {
+    uint32_t val = 0;
+    int shift = 0;
+    while (buf->pos < buf->used) {
+        uint8_t b = (uint8_t)buf->buf[buf->pos++];
+        val |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            break;
+        shift += 7;
+    }
+    return (int)(val >> 1);
+}
+
+/*
+ * Create a device event like the ones sent to MessageHub
+ */
+static kafka_produce_msg_t * ktestMakeEvent(int i) {
+    char body [256];
+    char key [32];
+    int bodylen = snprintf(body, sizeof body,
+        "{\"d\":{\"temperature\":%d,\"humidity\":%d,\"status\":\"ok\"},\"ts\":\"2024-01-01T00:00:%02d.000Z\"}",
+        20 + (i % 5), 40 + (i % 7), i % 60);
+    int keylen = snprintf(key, sizeof key, "org1:type1:dev%d", i % 8);
+    kafka_produce_msg_t * msg = ism_common_calloc(ISM_MEM_PROBE(ism_memory_proxy_eventstreams,1000), 1,
+            sizeof(kafka_produce_msg_t) + bodylen + keylen);
+    msg->buf = (char *)(msg + 1);
+    memcpy(msg->buf, body, bodylen);
+    msg->buflen = bodylen;
+    msg->key = msg->buf + bodylen;
+    memcpy(msg->key, key, keylen);
+    msg->key_len = keylen;
+    msg->time = ism_common_currentTimeNanos();
+    return msg;
+}
+
+/*
+ * Kafka broker stand-in.
+ * Receive a record batch and check the records against the events which were sent.
+ * @return the compression codec in the record batch
+ */
+static int ktestReceiveBatch(concat_alloc_t * batch, int expected) {
+    char xbuf [16*1024];
+    concat_alloc_t records = {xbuf, sizeof xbuf};
+    int i;
+
+    batch->pos = 0;
+    ism_kafka_getInt8(batch);                        /* baseOffset */
+    int batchlen = ism_kafka_getInt4(batch);
+    CU_ASSERT(batchlen == batch->used - 12);
+    ism_kafka_getInt4(batch);                        /* partitionLeaderEpoch */
+    CU_ASSERT(ism_kafka_getInt1(batch) == 2);        /* magic */
+    uint32_t crc = (uint32_t)ism_kafka_getInt4(batch);
+    CU_ASSERT(crc == ism_common_crc32c(0, batch->buf + batch->pos, batch->used - batch->pos));
+    int attributes = ism_kafka_getInt2(batch);
+    int lastOffsetDelta = ism_kafka_getInt4(batch);
+    CU_ASSERT(lastOffsetDelta == expected-1);
+    ism_kafka_getInt8(batch);                        /* firstTimestamp */
+    ism_kafka_getInt8(batch);                        /* maxTimestamp */
+    ism_kafka_getInt8(batch);                        /* producerId */
+    ism_kafka_getInt2(batch);                        /* producerEpoch */
+    ism_kafka_getInt4(batch);                        /* baseSequence */
+    int count = ism_kafka_getInt4(batch);
+    CU_ASSERT(count == expected);
+
+    int rc = ism_kafka_decompressRecords(attributes & KAFKA_COMPRESS_MASK, batch->buf + batch->pos,
+            batch->used - batch->pos, &records);
+    CU_ASSERT(rc == 0);
+    if (rc == 0) {
+        records.pos = 0;
+        for (i = 0; i < count; i++) {
+            char * body;
+            int reclen = ktestGetVarInt(&records);
+            int endpos = records.pos + reclen;
+            records.pos++;                           /* attributes */
+            ktestGetVarInt(&records);                /* timestampDelta */
+            CU_ASSERT(ktestGetVarInt(&records) == i); /* offsetDelta */
+            int keylen = ktestGetVarInt(&records);
+            records.pos += keylen;
+            int bodylen = ktestGetVarInt(&records);
+            body = records.buf + records.pos;
+            records.pos += bodylen;
+            ktestGetVarInt(&records);                /* header count */
+            CU_ASSERT(records.pos == endpos);
+
+            kafka_produce_msg_t * msg = ktestMakeEvent(i);
+            CU_ASSERT(bodylen == msg->buflen && !memcmp(body, msg->buf, bodylen));
+            ism_common_free(ism_memory_proxy_eventstreams, msg);
+            records.pos = endpos;
+        }
+        CU_ASSERT(records.pos == records.used);
+    }
+    if (records.inheap)
+        ism_common_freeAllocBuffer(&records);
+    return attributes & KAFKA_COMPRESS_MASK;
+}
+
+/*
+ * Produce a record batch with the specified compression and receive it
+ */
+static int ktestProduce(int compression, int produceVersion, int * batchsize) {
+    ism_mhub_t xmhub = {{0}};
+    ism_mhub_t * mhub = &xmhub;
+    ism_transport_t xtransport = {0};
+    ism_transport_t * transport = &xtransport;
+    struct ism_protobj_t xpobj = {0};
+    mhub_part_t xmhub_part = {0};
+    char xbuf [16*1024];
+    concat_alloc_t buf = {xbuf, sizeof xbuf};
+    kafka_produce_msg_t * msgs = NULL;
+    kafka_produce_msg_t * last = NULL;
+    int msgcnt = 0;
+    int i;
+
+    transport->pobj = &xpobj;
+    mhub->messageVersion = 2;
+    mhub->produceVersion = produceVersion;
+    mhub->maxBatchBytes = 1000000;
+    mhub->compression = compression;
+    for (i = 0; i < KTEST_MSGS; i++) {
+        kafka_produce_msg_t * msg = ktestMakeEvent(i);
+        if (last)
+            last->next = msg;
+        else
+            msgs = msg;
+        last = msg;
+    }
+    ism_mhub_addEventRecordBatch(transport, mhub, &xmhub_part, &buf, msgs, &msgcnt, NULL);
+    CU_ASSERT(msgcnt == KTEST_MSGS);
+    int codec = ktestReceiveBatch(&buf, KTEST_MSGS);
+    *batchsize = buf.used;
+    if (g_verbose)
+        printf("\ncompression=%s codec=%s size=%d\n", ism_kafka_compressionName(compression),
+                ism_kafka_compressionName(codec), buf.used);
+    if (buf.inheap)
+        ism_common_freeAllocBuffer(&buf);
+    return codec;
+}
+
+void pxkafka_compress_test(void) {
+    int rawsize;
+    int size;
+
+    CU_ASSERT(ism_kafka_compressionValue(NULL) == KAFKA_COMPRESS_NONE);
+    CU_ASSERT(ism_kafka_compressionValue("LZ4") == KAFKA_COMPRESS_LZ4);
+    CU_ASSERT(ism_kafka_compressionValue("zstd") == KAFKA_COMPRESS_ZSTD);
+    CU_ASSERT(ism_kafka_compressionValue("snappy") == -1);
+
+    CU_ASSERT(ktestProduce(KAFKA_COMPRESS_NONE, 1, &rawsize) == KAFKA_COMPRESS_NONE);
+    CU_ASSERT(ktestProduce(KAFKA_COMPRESS_GZIP, 1, &size) == KAFKA_COMPRESS_GZIP);
+    CU_ASSERT(size < rawsize/2);
+    CU_ASSERT(ktestProduce(KAFKA_COMPRESS_LZ4, 1, &size) == KAFKA_COMPRESS_LZ4);
+    CU_ASSERT(size < rawsize/2);
+    CU_ASSERT(ktestProduce(KAFKA_COMPRESS_ZSTD, 7, &size) == KAFKA_COMPRESS_ZSTD);
+    CU_ASSERT(size < rawsize/2);
+
+    /* zstd is not allowed before produce version 7 so gzip is used */
+    CU_ASSERT(ktestProduce(KAFKA_COMPRESS_ZSTD, 1, &size) == KAFKA_COMPRESS_GZIP);
+}
+
+#define KTEST_BATCHES     3
+#define KTEST_BATCH_MSGS  5
+#define KTEST_TSLOC       23     /* Offset of lastOffsetDelta in the record batch */
+
+/*
+ * Build the record batch for a batch in flight as ism_mhub_message_produce does,
+ * and return the idempotent producer fields patched in at tsloc+20.
+ */
+static int ktestSendBatch(ism_transport_t * transport, ism_mhub_t * mhub, mhub_part_t * mhub_part,
+        kafka_produce_msg_t * msgs, mhub_batch_t * batch, char * producer) {
+    char xbuf [16*1024];
+    concat_alloc_t buf = {xbuf, sizeof xbuf};
+    int msgcnt = 0;
+
+    if (++mhub_part->corrid == 0)
+        mhub_part->corrid = 1;
+    batch->corrid = mhub_part->corrid;
+    ism_mhub_addEventRecordBatch(transport, mhub, mhub_part, &buf, msgs, &msgcnt, batch);
+    batch->msgcount = msgcnt;
+    memcpy(producer, buf.buf+KTEST_TSLOC+20, 14);
+    if (buf.inheap)
+        ism_common_freeAllocBuffer(&buf);
+    return msgcnt;
+}
+
+/*
+ * Check the messages of a batch are the expected ones in order
+ */
+static int ktestBatchMsgs(kafka_produce_msg_t * msgs, kafka_produce_msg_t * * sent, int first) {
+    int count = 0;
+    while (msgs) {
+        if (first+count > KTEST_BATCHES*KTEST_BATCH_MSGS || msgs != sent[first+count])
+            return -1;
+        msgs = msgs->next;
+        count++;
+    }
+    return count;
+}
+
+/*
+ * Test idempotent produce with more than one request in flight.
+ *
+ * Three batches are sent before any response.  The middle one fails so it and the batch
+ * behind it are sent again in order with the same producer ID, epoch, and sequence, before
+ * any new batch.  The broker already has the middle batch so it answers DUPLICATE_SEQUENCE
+ * which completes it.
+ */
+void pxkafka_inflight_test(void) {
+    ism_mhub_t xmhub = {{0}};
+    ism_mhub_t * mhub = &xmhub;
+    ism_transport_t xtransport = {0};
+    ism_transport_t * transport = &xtransport;
+    struct ism_protobj_t xpobj = {0};
+    mhub_topic_t * topic;
+    mhub_part_t * part;
+    mhub_batch_t * batch;
+    mhub_batch_t * batches [KTEST_BATCHES];
+    kafka_produce_msg_t * sent [KTEST_BATCHES*KTEST_BATCH_MSGS+1];
+    kafka_produce_msg_t * msgs;
+    char producer [KTEST_BATCHES][14];
+    char reproducer [14];
+    int corrid [KTEST_BATCHES+1];
+    ism_time_t now;
+    int i;
+
+    transport->pobj = &xpobj;
+    topic = ism_common_calloc(ISM_MEM_PROBE(ism_memory_proxy_eventstreams,1000), 1, sizeof(mhub_topic_t));
+    topic->name = "ktest";
+    topic->partcount = 1;
+    part = topic->partitions;
+    part->topic = topic;
+    pthread_mutex_init(&part->lock, NULL);
+    mhub->topics = &topic;
+    mhub->topiccount = 1;
+    mhub->messageVersion = 2;
+    mhub->produceVersion = 3;
+    mhub->maxBatchBytes = 1000000;
+    mhub->maxBatchMsgs = KTEST_BATCH_MSGS;
+    mhub->maxBatchTimeMS = 1000;
+    mhub->mhubACK = -1;
+    mhub->maxInFlight = KTEST_BATCHES;
+    mhub->producerIdValid = 1;
+    mhub->producerId = 1234;
+    mhub->producerEpoch = 3;
+
+    for (i = 0; i <= KTEST_BATCHES*KTEST_BATCH_MSGS; i++) {
+        sent[i] = ktestMakeEvent(i);
+        if (part->kafka_msg_last)
+            part->kafka_msg_last->next = sent[i];
+        else
+            part->kafka_msg_first = sent[i];
+        part->kafka_msg_last = sent[i];
+        part->kafka_msg_count++;
+    }
+    part->kafka_msg_first_time = sent[0]->time;
+    now = ism_common_currentTimeNanos() + 2*mhub->maxBatchTimeMS*1000000L;    /* Past the batch linger time */
+
+    /* Send as many batches as are allowed in flight without waiting for a response */
+    for (i = 0; i < KTEST_BATCHES; i++) {
+        msgs = ism_mhub_checkEventBatch(mhub, part, now, 0, &batch);
+        CU_ASSERT_FATAL(msgs != NULL && batch != NULL);
+        CU_ASSERT(ktestBatchMsgs(msgs, sent, i*KTEST_BATCH_MSGS) == KTEST_BATCH_MSGS);
+        CU_ASSERT(ktestSendBatch(transport, mhub, part, msgs, batch, producer[i]) == KTEST_BATCH_MSGS);
+        CU_ASSERT(batch->producerId == 1234 && batch->producerEpoch == 3);
+        CU_ASSERT(batch->baseSequence == i*KTEST_BATCH_MSGS);
+        batches[i] = batch;
+        corrid[i] = batch->corrid;
+    }
+    CU_ASSERT(part->inflight == KTEST_BATCHES);
+    CU_ASSERT(ism_mhub_checkEventBatch(mhub, part, now, 0, &batch) == NULL);
+    CU_ASSERT(part->kafka_msg_first == sent[KTEST_BATCHES*KTEST_BATCH_MSGS]);
+
+    /* The first completes and the middle one fails */
+    CU_ASSERT(ism_mhub_produceResponse(mhub, "ktest", 5, 0, KAFKA_ERROR_NOERROR, 0, 0, corrid[0]) == 0);
+    CU_ASSERT(part->inflight == KTEST_BATCHES-1);
+    CU_ASSERT(part->kafka_ackwait_msg_first == sent[KTEST_BATCH_MSGS]);
+    CU_ASSERT(ism_mhub_produceResponse(mhub, "ktest", 5, 0, KAFKA_ERROR_NOTENOUGHREPLICAS, 0, 0, corrid[1]) == 1);
+    CU_ASSERT(part->needreproduce == 1);
+    CU_ASSERT(part->inflight_discard == 1);
+
+    /* The response of the last is ignored as it is sent again */
+    CU_ASSERT(ism_mhub_produceResponse(mhub, "ktest", 5, 0, KAFKA_ERROR_NOERROR, 0, 0, corrid[2]) == 0);
+    CU_ASSERT(part->inflight_discard == 0);
+    CU_ASSERT(part->kafka_ackwait_msg_first == sent[KTEST_BATCH_MSGS]);
+
+    /* The failed batch and the one behind it are sent again in order, unchanged */
+    for (i = 1; i < KTEST_BATCHES; i++) {
+        msgs = ism_mhub_checkEventBatch(mhub, part, now, 0, &batch);
+        CU_ASSERT_FATAL(msgs != NULL && batch != NULL);
+        CU_ASSERT(batch == batches[i]);
+        CU_ASSERT(ktestBatchMsgs(msgs, sent, i*KTEST_BATCH_MSGS) == KTEST_BATCH_MSGS);
+        CU_ASSERT(ktestSendBatch(transport, mhub, part, msgs, batch, reproducer) == KTEST_BATCH_MSGS);
+        CU_ASSERT(!memcmp(reproducer, producer[i], sizeof reproducer));
+        CU_ASSERT(batch->baseSequence == i*KTEST_BATCH_MSGS);
+        corrid[i] = batch->corrid;
+    }
+    CU_ASSERT(part->inflight == KTEST_BATCHES-1);
+    CU_ASSERT(part->resend == 0 && part->kafka_resend_msg_first == NULL);
+
+    /* A new batch follows the ones sent again and continues the sequence */
+    msgs = ism_mhub_checkEventBatch(mhub, part, now, 0, &batch);
+    CU_ASSERT_FATAL(msgs != NULL && batch != NULL);
+    CU_ASSERT(ktestBatchMsgs(msgs, sent, KTEST_BATCHES*KTEST_BATCH_MSGS) == 1);
+    CU_ASSERT(ktestSendBatch(transport, mhub, part, msgs, batch, reproducer) == 1);
+    CU_ASSERT(batch->baseSequence == KTEST_BATCHES*KTEST_BATCH_MSGS);
+    corrid[KTEST_BATCHES] = batch->corrid;
+    CU_ASSERT(part->inflight == KTEST_BATCHES);
+
+    /* The broker already has the middle batch */
+    CU_ASSERT(ism_mhub_produceResponse(mhub, "ktest", 5, 0, KAFKA_ERROR_DUPLICATESEQUENCE, 0, 0, corrid[1]) == 0);
+    CU_ASSERT(part->inflight == KTEST_BATCHES-1);
+    CU_ASSERT(part->kafka_ackwait_msg_first == sent[2*KTEST_BATCH_MSGS]);
+    CU_ASSERT(part->produceErrorTotalCount == 0);
+    CU_ASSERT(ism_mhub_produceResponse(mhub, "ktest", 5, 0, KAFKA_ERROR_NOERROR, 0, 0, corrid[2]) == 0);
+    CU_ASSERT(part->kafka_ackwait_msg_first == sent[KTEST_BATCHES*KTEST_BATCH_MSGS]);
+    CU_ASSERT(ism_mhub_produceResponse(mhub, "ktest", 5, 0, KAFKA_ERROR_NOERROR, 0, 0, corrid[KTEST_BATCHES]) == 0);
+    CU_ASSERT(part->inflight == 0);
+    CU_ASSERT(part->kafka_ackwait_msg_first == NULL && part->kafka_ackwait_msg_last == NULL);
+
+    pthread_mutex_destroy(&part->lock);
+    ism_common_free(ism_memory_proxy_eventstreams, topic);
+}
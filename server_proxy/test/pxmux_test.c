@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2017-2021 Contributors to the Eclipse Foundation
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+/*
+ * Test the choice of mux link for a new stream, and the fair share of a
+ * congested mux link.
+ */
+
+/*
+ * Set the mux link config and apply it
+ */
+static void mtestSetLinks(int maxLinks, int linkStreams, int highWater) {
+    ism_field_t f;
+    f.type = VT_Integer;
+    f.val.i = maxLinks;
+    ism_common_setProperty(ism_common_getConfigProperties(), "MuxMaxLinks", &f);
+    f.val.i = linkStreams;
+    ism_common_setProperty(ism_common_getConfigProperties(), "MuxLinkStreams", &f);
+    f.val.i = highWater;
+    ism_common_setProperty(ism_common_getConfigProperties(), "MuxLinkHighWater", &f);
+    ism_transport_muxInit(1);
+}
+
+/*
+ * Set the load of a link
+ */
+static void mtestLoad(px_mux_link_load_t * load, int linkState, int connected, int sendQueue, int streams) {
+    load->linkState = linkState;
+    load->connected = connected;
+    load->sendQueue = sendQueue;
+    load->streams = streams;
+}
+
+void pxmux_link_test(void) {
+    px_mux_link_load_t load[4];
+    int start;
+    int drain;
+
+    /* 4 links, another link at 10 streams or 8 queued buffers */
+    mtestSetLinks(4, 10, 8);
+    memset(load, 0, sizeof load);
+
+    /* Only link 0 is active and it is not loaded */
+    mtestLoad(&load[0], MUXL_Active, 1, 5, 3);
+    CU_ASSERT(ism_mux_chooseLink(load, &start, &drain) == 0);
+    CU_ASSERT(start == -1);
+    CU_ASSERT(drain == -1);
+
+    /* Link 0 is congested so link 1 is started */
+    mtestLoad(&load[0], MUXL_Active, 1, 8, 3);
+    CU_ASSERT(ism_mux_chooseLink(load, &start, &drain) == 0);
+    CU_ASSERT(start == 1);
+    CU_ASSERT(drain == -1);
+
+    /* Link 0 has too many streams so link 1 is started */
+    mtestLoad(&load[0], MUXL_Active, 1, 0, 10);
+    CU_ASSERT(ism_mux_chooseLink(load, &start, &drain) == 0);
+    CU_ASSERT(start == 1);
+
+    /* A draining link is started before an idle one as it may still be connected */
+    mtestLoad(&load[0], MUXL_Active, 1, 8, 3);
+    mtestLoad(&load[2], MUXL_Draining, 1, 0, 1);
+    CU_ASSERT(ism_mux_chooseLink(load, &start, &drain) == 0);
+    CU_ASSERT(start == 2);
+    mtestLoad(&load[2], MUXL_Idle, 0, 0, 0);
+
+    /* The link with the smallest send queue is used */
+    mtestLoad(&load[0], MUXL_Active, 1, 7, 3);
+    mtestLoad(&load[1], MUXL_Active, 1, 4, 6);
+    CU_ASSERT(ism_mux_chooseLink(load, &start, &drain) == 1);
+    CU_ASSERT(start == -1);
+    CU_ASSERT(drain == -1);
+
+    /* and then the one with the fewest streams */
+    mtestLoad(&load[0], MUXL_Active, 1, 4, 3);
+    CU_ASSERT(ism_mux_chooseLink(load, &start, &drain) == 0);
+    mtestLoad(&load[0], MUXL_Active, 1, 4, 7);
+    CU_ASSERT(ism_mux_chooseLink(load, &start, &drain) == 1);
+
+    /* An active link which is not connected is not used */
+    mtestLoad(&load[1], MUXL_Active, 0, 0, 0);
+    CU_ASSERT(ism_mux_chooseLink(load, &start, &drain) == 0);
+
+    /* Every active link is loaded so link 2 is started */
+    mtestLoad(&load[0], MUXL_Active, 1, 9, 3);
+    mtestLoad(&load[1], MUXL_Active, 1, 8, 3);
+    CU_ASSERT(ism_mux_chooseLink(load, &start, &drain) == 1);
+    CU_ASSERT(start == 2);
+
+    /* The load is low so the last active link is drained */
+    mtestLoad(&load[0], MUXL_Active, 1, 1, 2);
+    mtestLoad(&load[1], MUXL_Active, 1, 0, 2);
+    CU_ASSERT(ism_mux_chooseLink(load, &start, &drain) == 1);
+    CU_ASSERT(start == -1);
+    CU_ASSERT(drain == 1);
+
+    /* Not when the other links could not take its streams */
+    mtestLoad(&load[1], MUXL_Active, 1, 0, 4);
+    CU_ASSERT(ism_mux_chooseLink(load, &start, &drain) == 1);
+    CU_ASSERT(drain == -1);
+
+    /* Link 0 is never drained */
+    mtestLoad(&load[0], MUXL_Active, 1, 0, 0);
+    mtestLoad(&load[1], MUXL_Idle, 0, 0, 0);
+    CU_ASSERT(ism_mux_chooseLink(load, &start, &drain) == 0);
+    CU_ASSERT(drain == -1);
+
+    mtestSetLinks(1, 2000, 32);
+}
+
+void pxmux_fairshare_test(void) {
+    px_mux_share_t link = {0};
+    px_mux_share_t s1 = {0};
+    px_mux_share_t s2 = {0};
+    px_mux_link_stats_t stats = {0};
+    ism_transport_t * transport;
+    ism_connection_t * con;
+    double now;
+
+    /* With one link a stream is never paused */
+    mtestSetLinks(1, 2000, 8);
+    CU_ASSERT(ism_mux_fairShare(&link, &s1, &stats, 1, 100, 1000) == SRETURN_OK);
+    CU_ASSERT(ism_mux_fairShare(&link, &s2, &stats, 1, 100, 10) == SRETURN_OK);
+    CU_ASSERT(ism_mux_fairShare(&link, &s1, &stats, 1, 100, 1000) == SRETURN_OK);
+    CU_ASSERT(stats.paused == 0);
+    CU_ASSERT(stats.bytesSent == 0);
+
+    mtestSetLinks(4, 2000, 8);
+
+    /* The link is not congested */
+    CU_ASSERT(ism_mux_fairShare(&link, &s1, &stats, 2, 4, 1000) == SRETURN_OK);
+    CU_ASSERT(ism_mux_fairShare(&link, &s2, &stats, 2, 4, 10) == SRETURN_OK);
+    CU_ASSERT(ism_mux_fairShare(&link, &s1, &stats, 2, 7, 1000) == SRETURN_OK);
+    CU_ASSERT(link.streams == 2);
+    CU_ASSERT(link.bytes == 2010);
+    CU_ASSERT(stats.bytesSent == 2010);
+
+    /* The link is congested: the stream over its share is paused, the other is not */
+    CU_ASSERT(ism_mux_fairShare(&link, &s1, &stats, 2, 8, 1000) == SRETURN_SUSPEND);
+    CU_ASSERT(ism_mux_fairShare(&link, &s2, &stats, 2, 8, 10) == SRETURN_OK);
+    CU_ASSERT(stats.paused == 1);
+    CU_ASSERT(stats.sendQueue == 8);
+
+    /* A single stream has the whole link */
+    CU_ASSERT(ism_mux_fairShare(&link, &s1, &stats, 3, 20, 1000) == SRETURN_OK);
+    CU_ASSERT(link.streams == 1);
+    CU_ASSERT(link.bytes == 1000);
+    CU_ASSERT(s2.bytes == 20);      /* Not yet reset for the new window */
+    CU_ASSERT(ism_mux_fairShare(&link, &s2, &stats, 3, 20, 10) == SRETURN_OK);
+    CU_ASSERT(s2.bytes == 10);
+    CU_ASSERT(ism_mux_fairShare(&link, &s1, &stats, 3, 20, 1000) == SRETURN_SUSPEND);
+    CU_ASSERT(stats.paused == 2);
+
+    /*
+     * The pause stops reading from the connection without changing the message rate throttle
+     */
+    transport = calloc(1, sizeof(ism_transport_t));
+    con = calloc(1, sizeof(ism_connection_t));
+    transport->tobj = (struct ism_transobj *)con;
+    con->con_mups = 5.0;
+    con->con_mups_max = 10.0;
+    now = ism_common_readTSC();
+    CU_ASSERT(ism_tcp_fairuse(transport, FUR_Pause, 0, 0) == 0);
+    CU_ASSERT(con->pause_time == 0.0);
+    CU_ASSERT(ism_tcp_fairuse(transport, FUR_Pause, 10, 0) == 0);
+    CU_ASSERT(con->pause_time >= now + 0.01);
+    CU_ASSERT(con->pause_time < now + 1.0);
+    CU_ASSERT(con->restart_time == 0.0);
+    CU_ASSERT(con->con_mups == 5.0);
+
+    /* A shorter pause does not end a longer one */
+    now = con->pause_time;
+    CU_ASSERT(ism_tcp_fairuse(transport, FUR_Pause, 1, 0) == 0);
+    CU_ASSERT(con->pause_time == now);
+    free(con);
+    free(transport);
+
+    mtestSetLinks(1, 2000, 32);
+}
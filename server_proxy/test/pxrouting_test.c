@@ -319,6 +319,122 @@ void pxrouting_test_parseRouteOnly(void){
 
 }
 
+#define RTEST_RULES  500
+#define RTEST_TOPICS 100
+
+/*
+ * Select the rules with a linear scan of all rules as was done before the rule index
+ */
+static int rtestScanRules(ism_routing_config_t * routeConfig, const char * topic, int qos, ism_routing_rule_t * * rules) {
+    ismHashMapEntry ** array = ism_common_getHashMapEntriesArray(routeConfig->routerulemap);
+    int count = 0;
+    int i = 0;
+    while (array[i] != ((void*)-1)) {
+        ism_routing_rule_t * routeRule = (ism_routing_rule_t *)array[i]->value;
+        ismMessageHeader_t         hdr = {0L, 0, 0, 4, 0, 0, 0, 0};
+        ismMessageAreaType_t       areatype[2] = { ismMESSAGE_AREA_PROPERTIES, ismMESSAGE_AREA_PAYLOAD};
+        size_t                     areasize[2] = {0, 0};
+        void *                     areaptr[2] = {NULL, NULL};
+        hdr.Reliability = qos;
+        if (ism_common_selectMessage(&hdr, 2, areatype, areasize, areaptr, topic, routeRule->selector, 0, NULL) == SELECT_TRUE)
+            rules[count++] = routeRule;
+        i++;
+    }
+    ism_common_freeHashMapEntriesArray(array);
+    return count;
+}
+
+/*
+ * Check the rule index selects the same rules as the selectors, and compare the time
+ * for a synthetic set of rules.
+ */
+void pxrouting_test_ruleIndex(void) {
+    ism_routing_config_t * routeConfig;
+    ism_routing_rule_t * scanrules [RTEST_RULES];
+    ism_routing_rule_t * indexrules [RTEST_RULES];
+    char topics [RTEST_TOPICS][128];
+    int  qos;
+    int  i;
+    int  j;
+    int  k;
+    int  mismatch = 0;
+    int  matched = 0;
+    char xbuf [8192];
+    concat_alloc_t buf = {xbuf, sizeof xbuf};
+
+    /* Make rules which are exact, indexed with a selector, a topic prefix, and not indexed */
+    ism_common_allocBufferCopy(&buf, "{\"RouteConfig\":{\"RouteRule\":{");
+    for (i=0; i<RTEST_RULES; i++) {
+        char rbuf [256];
+        const char * selector;
+        char sbuf [200];
+        switch (i%5) {
+        case 0:  selector = "Org='org%d' and Type='type%d' and Event='evt%d'";   break;
+        case 1:  selector = "Org='org%d' and QoS>0 and Event='evt%d'";           break;
+        case 2:  selector = "Topic like 'iot-2/org%d/type/type%d/%%'";           break;
+        case 3:  selector = "Org='org%d' or Event='evt%d'";                      break;
+        default: selector = "Type like 'type%d%%' and Fmt='json' and ID<>'x%d'"; break;
+        }
+        snprintf(sbuf, sizeof sbuf, selector, i%20, i%10, i%7);
+        snprintf(rbuf, sizeof rbuf, "%s\"Rule%d\":{\"Selector\":\"%s\"}", i ? "," : "", i, sbuf);
+        ism_common_allocBufferCopy(&buf, rbuf);
+    }
+    ism_common_allocBufferCopyLen(&buf, "}}}", 4);
+
+    routeConfig = ism_common_calloc(ISM_MEM_PROBE(ism_memory_proxy_routing,204),1, sizeof(ism_routing_config_t));
+    ism_route_config_init(routeConfig);
+    ism_proxy_parseRouteConfig(buf.buf, routeConfig);
+    CU_ASSERT(ism_common_getHashMapNumElements(routeConfig->routerulemap) == RTEST_RULES);
+    if (buf.inheap)
+        ism_common_freeAllocBuffer(&buf);
+
+    for (i=0; i<RTEST_TOPICS; i++) {
+        snprintf(topics[i], sizeof topics[i], "iot-2/org%d/type/type%d/id/dev%d/evt/evt%d/fmt/%s",
+                i%20, (i*3)%10, i, (i*7)%9, (i%4) ? "json" : "text");
+    }
+
+    /* Check the index selects the same rules */
+    for (qos=0; qos<2; qos++) {
+        for (i=0; i<RTEST_TOPICS; i++) {
+            int scancount = rtestScanRules(routeConfig, topics[i], qos, scanrules);
+            int indexcount = ism_route_selectRules(routeConfig, topics[i], qos, indexrules, RTEST_RULES);
+            if (scancount != indexcount)
+                mismatch++;
+            for (j=0; j<indexcount; j++) {
+                for (k=0; k<scancount; k++) {
+                    if (indexrules[j] == scanrules[k])
+                        break;
+                }
+                if (k == scancount)
+                    mismatch++;
+            }
+            matched += indexcount;
+        }
+    }
+    CU_ASSERT(mismatch == 0);
+    CU_ASSERT(matched > 0);
+
+    /* Compare the time */
+    int loops = 20;
+    ism_time_t start1 = ism_common_currentTimeNanos();
+    for (j=0; j<loops; j++) {
+        for (i=0; i<RTEST_TOPICS; i++)
+            rtestScanRules(routeConfig, topics[i], 1, scanrules);
+    }
+    ism_time_t end1 = ism_common_currentTimeNanos();
+    for (j=0; j<loops; j++) {
+        for (i=0; i<RTEST_TOPICS; i++)
+            ism_route_selectRules(routeConfig, topics[i], 1, indexrules, RTEST_RULES);
+    }
+    ism_time_t end2 = ism_common_currentTimeNanos();
+    double scantime = (end1-start1) / (double)(loops * RTEST_TOPICS);
+    double indextime = (end2-end1) / (double)(loops * RTEST_TOPICS);
+    printf("\nrules=%d matched=%d scan=%0.0f ns/msg index=%0.0f ns/msg\n", RTEST_RULES, matched, scantime, indextime);
+    CU_ASSERT(indextime < scantime);
+
+    ism_route_config_destroy(routeConfig);
+}
+
 /*
  * Run the MQTTv5 tests
  */
@@ -330,6 +446,7 @@ void pxrouting_test(void) {
     pxrouting_test_parseRouteRuleOnly();
     pxrouting_test_parseRouteRuleOnlyFalseSelection();
     pxrouting_test_parseRouteAll();
+    pxrouting_test_ruleIndex();
 
 
 }
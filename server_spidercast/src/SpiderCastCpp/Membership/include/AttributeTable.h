@@ -65,6 +65,12 @@ private:
 
 	const static String rebuttalKey_;
 
+	/*
+	 * Values received at least this long share the storage of the incoming
+	 * message rather than being copied out of it.
+	 */
+	static const int32_t SharedValueMinLength = 4096;
+
 	uint64_t version_;
 	uint64_t version_sent_;
 
@@ -102,6 +102,18 @@ int32_t AttributeTable::writeEntriesToMessage(uint64_t newerThan, SCMessage_SPtr
 	std::size_t val_size = 0;
 	std::size_t val_size_written = 0;
 
+	//size the buffer once; key (len+chars), version, length, value
+	std::size_t bytes_needed = 0;
+	for (AttributeTableMap::const_iterator it = map_.begin();
+			it != map_.end(); ++it)
+	{
+		if (it->second.version > newerThan)
+		{
+			bytes_needed += (4 + it->first.size() + 8 + 4 + (it->second.length>0 ? it->second.length : 0));
+		}
+	}
+	buffer.reserve(bytes_needed);
+
 	//write entries
 	for (AttributeTableMap::const_iterator it = map_.begin();
 			it != map_.end(); ++it)
@@ -221,16 +233,24 @@ int32_t AttributeTable::mergeEntriesFromMessage(SCMessage_SPtr inReply)
 			buffer->invoke();
 		}
 
-		if (value.length > 0)
+		if (value.version <= version_)
 		{
-			value.bufferSPtr.reset(
-					allocateAndCopy(value.length, buffer));
-			//TODO just skip in case (value.version <= version_)
+			if (value.length > 0)
+			{
+				buffer.setPosition(buffer.getPosition()+value.length); //skip value
+			}
+			continue;
 		}
 
-		if (value.version <= version_)
+		if (value.length >= SharedValueMinLength)
 		{
-			continue;
+			//refer to the message storage instead of copying large values
+			value.bufferSPtr = buffer.readSharedByteArray(value.length).getBuffer();
+		}
+		else if (value.length > 0)
+		{
+			value.bufferSPtr.reset(
+					allocateAndCopy(value.length, buffer));
 		}
 
 		if (max_version < value.version)
@@ -485,6 +505,15 @@ void AttributeTable::writeMapEntriesToMessage(SCMessage_SPtr outReply) const
 {
 	ByteBuffer& buffer = *(outReply->getBuffer());
 	int32_t num_entries = map_.size();
+
+	std::size_t bytes_needed = 4;
+	for (AttributeTableMap::const_iterator it = map_.begin();
+			it != map_.end(); ++it)
+	{
+		bytes_needed += (4 + it->first.size() + 4 + (it->second.length>0 ? it->second.length : 0));
+	}
+	buffer.reserve(bytes_needed);
+
 	buffer.writeInt(num_entries);
 
 	//write entries
@@ -22,6 +22,7 @@
 
 #include <boost/cstdint.hpp>
 #include <boost/tuple/tuple.hpp>
+#include <boost/shared_array.hpp>
 
 #include "Definitions.h"
 #include "NodeVersion.h"
@@ -30,6 +31,7 @@
 #include "StreamIDImpl.h"
 #include "SpiderCastLogicError.h"
 #include "SpiderCastRuntimeError.h"
+#include "ConstSharedBuffer.h"
 
 namespace spdr
 {
@@ -62,8 +64,15 @@ private:
 	size_t      _capacity;
 	bool        _readOnly;
 
+	/*
+	 * Owns the storage _buffer points to. Slices handed out by
+	 * readSharedByteArray() share it, so the storage outlives the
+	 * ByteBuffer (or a reallocation) until the last slice is released.
+	 */
+	boost::shared_array<char> _storage;
 
 	void    checkSpace4Write(size_t index, size_t dataLength);
+	void    reallocate(size_t newCapacity);
 	void    checkSpace4Read(size_t index, size_t dataLength) const;
 	void    writeGenObject(size_t& index, const char *source, size_t length);
 	void    readGenObject(size_t& index, char *target, size_t length) const;
@@ -311,6 +320,21 @@ public:
 
     size_t      	readByteArray(char* ba, size_t length);
 
+    /**
+     * Read a byte array without copying it.
+     *
+     * The returned buffer points into the storage of this ByteBuffer and
+     * keeps that storage alive, so it stays valid after the ByteBuffer is
+     * destroyed or reallocated. Since the whole storage is retained, use it
+     * for values that make up a large part of the buffer.
+     *
+     * @param length number of bytes to read
+     * @return a shared, read-only view of the next 'length' bytes
+     *
+     * @throw  IndexOutOfBoundsException if less than 'length' bytes remain.
+     */
+    ConstSharedBuffer	readSharedByteArray(size_t length);
+
     NodeVersion 	readNodeVersion();
 
     NodeIDImpl_SPtr readNodeID();
@@ -373,6 +397,19 @@ public:
 	 */
 	void reset(void);
 
+	/**
+	 * Make room for 'length' more bytes after the current position.
+	 *
+	 * Lets a writer that knows the size of what it is about to serialize
+	 * allocate once, instead of growing the buffer as it goes.
+	 *
+	 * @param length number of bytes that will be written
+	 *
+	 * @throw  BufferNotWriteableException if the buffer is read only.
+	 * @throw  OutOfMemoryException if storage reallocation fails.
+	 */
+	void reserve(size_t length);
+
 	/**
 	 * Set position.
 	 *
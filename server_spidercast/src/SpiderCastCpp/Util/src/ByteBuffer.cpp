@@ -87,7 +87,7 @@ inline static void orderConvert(char* target, const char *source, size_t length)
  */
 ByteBuffer::~ByteBuffer() { 
     //CLASS_INIT_SPY("ByteBuffer", CLASS_INIT_SPY_EXIT);
-    delete []_buffer;
+    _storage.reset();
     _buffer = NULL; 
 } 
 
@@ -152,6 +152,7 @@ StringSetSPtr ByteBuffer::readStringSet() {
 ByteBuffer::ByteBuffer(size_t capacity) 
         : _buffer(new char[capacity]) { 
     //CLASS_INIT_SPY("ByteBuffer", CLASS_INIT_SPY_ENTRY);
+    _storage.reset(_buffer);
     if(_buffer == NULL) { 
         delete this; 
         _capacity = 0; 
@@ -181,6 +182,7 @@ ByteBuffer::ByteBuffer(const char* buffer, size_t length, bool readOnly, bool wr
 	{
 		_buffer = const_cast<char*>(buffer);
 	}
+	_storage.reset(_buffer);
     //_virtualBase = _buffer;
     _capacity = length; 
     //_origCapacity = _capacity;
@@ -210,11 +212,22 @@ void ByteBuffer::checkSpace4Write(size_t index, size_t dataLength)
 		//There is enough space in the buffer
 		return;
 	}
-	//Need to realloc
-
+	//Need to realloc.
+	//Grow geometrically, so that serializing a large value (e.g. a Bloom
+	//filter attribute) costs amortized O(1) copies per byte rather than
+	//one reallocation per KB.
 	int rem = ((index+dataLength) % 1024 > 0 ? 1 : 0);
 	size_t newCapacity = (((index+dataLength)/1024) + rem)*1024;
+	if (newCapacity < 2*_capacity)
+	{
+		newCapacity = 2*_capacity;
+	}
+	reallocate(newCapacity);
+	return;
+}
 
+void ByteBuffer::reallocate(size_t newCapacity)
+{
 	//Allocate new buffer
 	char *newBuffer = new char[newCapacity];
 	if (newBuffer == NULL)
@@ -227,10 +240,9 @@ void ByteBuffer::checkSpace4Write(size_t index, size_t dataLength)
 
 	_capacity = newCapacity;
 	//_origCapacity = _capacity; //YT
-	delete[] _buffer;
+	_storage.reset(newBuffer);
 	_buffer = newBuffer;
 	//_virtualBase = _buffer;
-	return;
 }
 
 /* @name    ByteBuffer::checkSpace4Read
@@ -760,6 +772,19 @@ size_t ByteBuffer::readByteArray(char* ba, size_t length)
     return rc;
 } 
 
+ConstSharedBuffer ByteBuffer::readSharedByteArray(size_t length)
+{
+	checkSpace4Read(_position, length);
+	if (length == 0)
+	{
+		return ConstSharedBuffer();
+	}
+
+	boost::shared_array<const char> slice(_storage, _buffer + _position);
+	_position += length;
+	return ConstSharedBuffer(static_cast<uint32_t>(length), slice);
+}
+
 NodeVersion ByteBuffer::readNodeVersion()
 {
 	int64_t incarnationNum = readLong();
@@ -837,6 +862,20 @@ void ByteBuffer::setPosition(size_t pos)
 	_position = pos;
 }
 
+void ByteBuffer::reserve(size_t length)
+{
+	if (_readOnly)
+		throw BufferNotWriteableException();
+
+	if (_buffer == NULL)
+		throw NullPointerException("ByteBuffer::reserve _buffer is NULL");
+
+	if (_position + length > _capacity)
+	{
+		reallocate(_position + length);
+	}
+}
+
 
 //Depricated
 //void ByteBuffer::slice(size_t start, size_t length)
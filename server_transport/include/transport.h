@@ -355,7 +355,11 @@ typedef struct ism_endstat_t {
     uint64_t     connect_active;    /* Currently active connections           */
     uint64_t     connect_count;     /* Connection count since reset           */
     uint64_t     bad_connect_count; /* Count of connections which have failed to connect since reset */
-    uint64_t     resv;
+    uint64_t     sendq_bytes;       /* Send buffer memory currently queued on connections */
+    uint64_t     tls_handshake_count;  /* Incoming TLS handshakes completed since reset */
+    uint64_t     tls_resumed_count;    /* Incoming TLS handshakes which resumed a session */
+    uint64_t     tls_handshake_time;   /* Total time of the completed TLS handshakes in nanoseconds */
+    uint64_t     tls_handshake_reject; /* TLS handshakes rejected as the handshake queue is full */
     msg_stat_t   count[MAX_STAT_THREADS]; /* Per io thread message statistics */
 } ism_endstat_t;
 
@@ -548,6 +552,7 @@ struct ism_transport_t {
     /* Statistics */
     int               sendQueueSize;
     int               suspended;
+    uint64_t          sendQueueBytes;    /**< The bytes queued to send and not yet written    */
     ism_time_t        reset_time;        /**< The time of the last statistics reset          */
     uint64_t          read_bytes;        /**< The bytes read since reset                     */
     uint64_t          read_msg;          /**< The messages read since reset                  */
@@ -879,6 +884,10 @@ typedef struct ism_endpoint_mon_t {
     uint64_t     read_bytes_count;  /**< Bytes count since reset      */
     uint64_t     write_msg_count;   /**< Message count since reset    */
     uint64_t     write_bytes_count; /**< Bytes count since reset      */
+    uint64_t     tls_handshake_count;  /**< Incoming TLS handshakes completed since reset */
+    uint64_t     tls_resumed_count;    /**< Incoming TLS handshakes which resumed a session since reset */
+    uint64_t     tls_handshake_time;   /**< Total time of the completed TLS handshakes in nanoseconds */
+    uint64_t     tls_handshake_reject; /**< TLS handshakes rejected as the handshake queue is full */
 } ism_endpoint_mon_t;
 
 typedef struct ism_endpoint_mon_t ism_listener_mon_t;
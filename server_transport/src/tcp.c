@@ -102,6 +102,12 @@ typedef struct ism_transobj {
     char *                bio1DataPtr;
     asyncJobRequest_t   * asyncJobRequestsHead;
     asyncJobRequest_t   * asyncJobRequestsTail;
+    struct ism_transobj * hsNext;              /* Next in the TLS handshake queue             */
+    ism_time_t            hsStart;             /* Time the TLS handshake started              */
+    volatile int          hsBusy;              /* A TLS handshake thread has the connection   */
+    uint8_t               hsPool;              /* Use the TLS handshake threads               */
+    uint8_t               hsPending;           /* IO events arrived during the handshake step */
+    volatile uint8_t      hsResult;            /* Result of the last handshake step           */
 } ism_transobj;
 
 typedef ism_transobj ism_connection_t;
@@ -177,6 +183,30 @@ typedef struct ioConnectionThread_t {
 
 typedef struct epoll_event epoll_event;
 
+/*
+ * Define the TLS handshake threads.
+ * When configured the full TLS handshakes of incoming connections are done in these
+ * threads so that the key exchange does not delay the other connections on an IOP thread.
+ */
+typedef struct tlsHandshakePool_t {
+    pthread_mutex_t      mutex;
+    pthread_cond_t       cond;
+    ism_connection_t *   head;             /* Connections waiting for a handshake thread */
+    ism_connection_t *   tail;
+    int                  count;
+    int                  stopped;
+    ism_threadh_t *      threads;
+} tlsHandshakePool_t;
+
+/*
+ * Results of a handshake step in a TLS handshake thread
+ */
+#define HS_NONE    0
+#define HS_WANT    1
+#define HS_DONE    2
+#define HS_CLOSED  3
+#define HS_ERROR   4
+
 /*
  * Structure for each possible connection indexed by socket number
  */
@@ -221,6 +251,8 @@ static int                 numOfIOProcs = 0;
 static ism_delivery_t *    delivery;              /* The delivery object                  */
 static volatile int        g_stopped = 1;
 static uint64_t            maxPoolSizeBytes;
+static uint64_t            g_sendQueueMemoryMax = 0;   /* Budget for send buffer memory on all connections, 0=none */
+static volatile uint64_t   g_sendQueueMemory = 0;      /* Send buffer memory queued on all connections          */
 static ism_timer_t         cleanup_timer = NULL;
 static ism_timer_t         ddos_timer = NULL;
 static ism_timer_t         chkRcvBuffTimer = NULL;
@@ -228,6 +260,9 @@ static int                 g_conciseLog = 0;
 static int                 g_ctxPerThread = 0;
 static uint32_t            g_nolog_list [64];
 static uint32_t            g_nolog_count = 0;
+static tlsHandshakePool_t  hsPool = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+static int                 hsThreads = 0;              /* Count of TLS handshake threads, 0=handshake in IOP */
+static int                 hsQueueMax = 0;             /* Maximum connections waiting for a handshake thread */
 
 /*
  * Forward declarations
@@ -606,6 +641,7 @@ static int increaseSockBufSize(int sock, int bufType) {
 #define SHUTDOWN_REQUEST 0x0000000100000000
 #define CLEANUP_REQUEST  0x0000000200000000
 #define SHUTDOWN_FORCE   0x0000000400000000
+#define HANDSHAKE_DONE   0x0000000800000000
 
 
 /*
@@ -672,6 +708,10 @@ static int addConnectionToIOThread(ism_connection_t * con) {
     if (!con->outgoing) {
         con->state = (con->secured ? ISM_TRANSPORT_HANDSHAKE_IN_PROCESS : (ISM_TRANSPORT_CONNECTED | ISM_TRANSPORT_CAN_READ
                 | ISM_TRANSPORT_CAN_WRITE));
+        if (con->secured) {
+            con->hsStart = ism_common_currentTimeNanos();
+            con->hsPool = hsThreads > 0;
+        }
     }
     con->isProcessing = 0;
     if (epoll_ctl(ioListener->efd, EPOLL_CTL_ADD, con->socket, &event) == -1) {
@@ -1428,6 +1468,29 @@ static void * conListenerProc(void * parm, void * context, int value) {
 #define CAN_WRITE(STATE)        ((((STATE) & ISM_TRANSPORT_STATE_WR) && ((STATE) & ISM_TRANSPORT_CAN_READ)) || ((STATE) & ISM_TRANSPORT_CAN_WRITE))
 #define SEND_BUFFER_SIZE        128*1024
 
+/*
+ * Account for send buffer memory being queued on (positive bytes) or released
+ * from (negative bytes) a connection.  The global total is checked against the
+ * send queue memory budget and the endpoint total is kept for problem determination.
+ */
+static inline void sendQueueMemoryUpdate(ism_transport_t * transport, int64_t bytes) {
+    __sync_add_and_fetch(&g_sendQueueMemory, bytes);
+    __sync_add_and_fetch(&transport->listener->stats->sendq_bytes, bytes);
+}
+
+/*
+ * Release a send buffer which has been completely written
+ */
+static inline void returnSendBuffer(ism_connection_t * con, ism_byteBuffer sendBuff) {
+    int64_t allocated = sendBuff->allocated;
+    sendBuff->putPtr = sendBuff->buf;
+    sendBuff->getPtr = sendBuff->buf;
+    sendBuff->used = 0;
+    ism_common_returnBuffer(sendBuff, __FILE__, __LINE__);
+    con->sendBuffer = NULL;
+    sendQueueMemoryUpdate(con->transport, -allocated);
+}
+
 /*
  * Write data without security
  */
@@ -1443,12 +1506,9 @@ HOT static int writeDataTCP(ism_connection_t * con) {
         assert(toWrite > 0);
         if (rc > 0) {
             sendBuff->getPtr += rc;
+            __sync_sub_and_fetch(&con->transport->sendQueueBytes, rc);
             if (LIKELY((sendBuff->getPtr - sendBuff->buf) == sendBuff->used)) {
-                sendBuff->putPtr = sendBuff->buf;
-                sendBuff->getPtr = sendBuff->buf;
-                sendBuff->used = 0;
-                ism_common_returnBuffer(sendBuff, __FILE__, __LINE__);
-                con->sendBuffer = NULL;
+                returnSendBuffer(con, sendBuff);
             }
             if (!con->transport->nostats) {
                 con->transport->write_bytes += rc;
@@ -1506,12 +1566,9 @@ HOT static int writeDataSSL(ism_connection_t *con) {
         case SSL_ERROR_NONE:
             if (rc > 0) {
                 sendBuff->getPtr += rc;
+                __sync_sub_and_fetch(&con->transport->sendQueueBytes, rc);
                 if (LIKELY((sendBuff->getPtr - sendBuff->buf) == sendBuff->used)) {
-                    sendBuff->putPtr = sendBuff->buf;
-                    sendBuff->getPtr = sendBuff->buf;
-                    sendBuff->used = 0;
-                    ism_common_returnBuffer(sendBuff, __FILE__, __LINE__);
-                    con->sendBuffer = NULL;
+                    returnSendBuffer(con, sendBuff);
                 }
                 con->transport->write_bytes += rc;
                 con->transport->listener->stats->count[con->transport->tid].write_bytes += rc;
@@ -1942,14 +1999,17 @@ static int connectionCloseComplete(ism_connection_t * con) {
         con->rcvBuffer = NULL;
     }
     if (con->sendBuffer){
+        sendQueueMemoryUpdate(transport, -(int64_t)con->sendBuffer->allocated);
         ism_common_returnBuffer(con->sendBuffer, __FILE__, __LINE__);
         con->sendBuffer = NULL;
     }
     while (con->sndQueueHead) {
         ism_byteBuffer bb = con->sndQueueHead;
         con->sndQueueHead = bb->next;
+        sendQueueMemoryUpdate(transport, -(int64_t)bb->allocated);
         ism_common_returnBuffer(bb, __FILE__, __LINE__);
     }
+    transport->sendQueueBytes = 0;
 
     /* Destroy the Security Context */
     if (con->transport->security_context) {
@@ -1973,26 +2033,20 @@ static int connectionCloseComplete(ism_connection_t * con) {
 
 
 /*
- * Close the connection during an SSL/TLS handshake
+ * Do one step of the SSL/TLS handshake.
+ * This does not change the connection state so it can be run in a TLS handshake thread.
+ * @return 1=complete, 0=needs more data, -1=closed by the partner, -2=handshake error
  */
-static int sslHandshake(ism_connection_t * con) {
+static int sslHandshakeStep(ism_connection_t * con) {
     int   rc;
-    char err[2048];
     ism_transport_t * transport = con->transport;
 
-    if (con->state & ISM_TRANSPORT_ERROR){
-        ism_common_setError(ISMRC_ClosedTLSHandshake);
-        transport->close(transport, ISMRC_ClosedTLSHandshake, 0, "Connection closed during TLS handshake");
-        return -1;
-    }
     if (transport->originated) {
         rc = SSL_connect(con->ssl);
     } else {
         rc = SSL_accept(con->ssl);
     }
     if (rc == 0) {
-        ism_common_setError(ISMRC_ClosedTLSHandshake);
-        transport->close(transport, ISMRC_ClosedTLSHandshake, 0, "Connection closed during TLS handshake");
         sslTraceErr(transport, 0, __FILE__, __LINE__);
         return -1;
     }
@@ -2014,119 +2068,277 @@ static int sslHandshake(ism_connection_t * con) {
             return 0;
         default:
             sslTraceErr(transport, ec, __FILE__, __LINE__);
-            con->state |= ISM_TRANSPORT_ERROR;
-            if (transport->originated) {
-                con->transport->write_bytes += con->transport->tlsWriteBytes;
-                con->transport->read_bytes += con->transport->tlsReadBytes;
-                if (con->transport->connected) {
-                    con->transport->connected(con->transport, ISMRC_ServerNotAvailable);
-                }
-                ism_common_setError(ISMRC_ServerNotAvailable);
-                transport->close(transport, ISMRC_ServerNotAvailable, 0, "Server not available");
-            } else {
-                ism_common_setError(ISMRC_ClosedTLSHandshake);
-                transport->close(transport, ISMRC_ClosedTLSHandshake, 0, "Connection closed during TLS handshake");
-            }
-            return -1;
+            return -2;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Close the connection when the SSL/TLS handshake fails
+ * @param rc  The return from sslHandshakeStep
+ */
+static int sslHandshakeFailed(ism_connection_t * con, int rc) {
+    ism_transport_t * transport = con->transport;
+
+    if (rc == -1) {
+        ism_common_setError(ISMRC_ClosedTLSHandshake);
+        transport->close(transport, ISMRC_ClosedTLSHandshake, 0, "Connection closed during TLS handshake");
+        return -1;
+    }
+    con->state |= ISM_TRANSPORT_ERROR;
+    if (transport->originated) {
+        con->transport->write_bytes += con->transport->tlsWriteBytes;
+        con->transport->read_bytes += con->transport->tlsReadBytes;
+        if (con->transport->connected) {
+            con->transport->connected(con->transport, ISMRC_ServerNotAvailable);
         }
+        ism_common_setError(ISMRC_ServerNotAvailable);
+        transport->close(transport, ISMRC_ServerNotAvailable, 0, "Server not available");
     } else {
-        /*
-         * On a completed TLS outgoing connection
-         */
-        if (transport->originated) {
-            uint64_t active = __sync_add_and_fetch(&transport->listener->stats->connect_active, 1);
-            uint64_t count = __sync_add_and_fetch(&transport->listener->stats->connect_count, 1);
-            TRACE(9, "Increment count for outgoing secure connections: connect=%u name=%s count=%lu active=%lu\n",
-                    transport->index, transport->name, count, active);
-            transport->write_bytes += transport->tlsWriteBytes;
-            transport->read_bytes += transport->tlsReadBytes;
-            if (transport->connected) {
-                transport->connected(transport, 0);
-            }
-            /* TODO: for self-signed, verify that this is ours */
-            X509 * cert = SSL_get_peer_certificate(con->ssl);
+        ism_common_setError(ISMRC_ClosedTLSHandshake);
+        transport->close(transport, ISMRC_ClosedTLSHandshake, 0, "Connection closed during TLS handshake");
+    }
+    return -1;
+}
 
-            rc = SSL_get_verify_result(con->ssl);
-            if ((rc != X509_V_OK) && (rc != X509_V_ERR_DEPTH_ZERO_SELF_SIGNED_CERT)) {
-                const char * sslErr = X509_verify_cert_error_string(rc);
-                sprintf(err,"Server certificate verification failed: %s", sslErr);
-                X509_free(cert);
-                if (SHOULD_TRACE(4)) {
-                    BUF_MEM* certInfo = ism_ssl_getPeerCertInfo(con->ssl,
-                            (TRACE_DOMAIN->trcComponentLevels[TRACECOMP_Transport] > 7), 1);
-                    TRACE(4, "Certificate verification failed: From=%s:%d connect=%u error=%s\n%s\n",
-                             transport->client_addr, transport->clientport, transport->index, sslErr,
-                             certInfo->data);
-                    BUF_MEM_free(certInfo);
-                }
-                ism_common_setError(ISMRC_CertificateNotValid);
-                transport->close(transport, ISMRC_CertificateNotValid, 0, "Certificate not valid");
-                return -1;
-            }
-            X509_NAME * name = X509_get_subject_name(cert);
-            char commonName [64];
-            if (X509_NAME_get_text_by_NID(name, NID_commonName, commonName, sizeof(commonName)) != -1) {
-                transport->cert_name = ism_transport_putString(transport, commonName);
-            }
+/*
+ * Complete the SSL/TLS handshake.
+ * Check the certificates and set the connection state to connected.
+ */
+static int sslHandshakeComplete(ism_connection_t * con) {
+    int   rc;
+    char err[2048];
+    ism_transport_t * transport = con->transport;
+
+    /*
+     * On a completed TLS outgoing connection
+     */
+    if (transport->originated) {
+        uint64_t active = __sync_add_and_fetch(&transport->listener->stats->connect_active, 1);
+        uint64_t count = __sync_add_and_fetch(&transport->listener->stats->connect_count, 1);
+        TRACE(9, "Increment count for outgoing secure connections: connect=%u name=%s count=%lu active=%lu\n",
+                transport->index, transport->name, count, active);
+        transport->write_bytes += transport->tlsWriteBytes;
+        transport->read_bytes += transport->tlsReadBytes;
+        if (transport->connected) {
+            transport->connected(transport, 0);
+        }
+        /* TODO: for self-signed, verify that this is ours */
+        X509 * cert = SSL_get_peer_certificate(con->ssl);
+
+        rc = SSL_get_verify_result(con->ssl);
+        if ((rc != X509_V_OK) && (rc != X509_V_ERR_DEPTH_ZERO_SELF_SIGNED_CERT)) {
+            const char * sslErr = X509_verify_cert_error_string(rc);
+            sprintf(err,"Server certificate verification failed: %s", sslErr);
             X509_free(cert);
+            if (SHOULD_TRACE(4)) {
+                BUF_MEM* certInfo = ism_ssl_getPeerCertInfo(con->ssl,
+                        (TRACE_DOMAIN->trcComponentLevels[TRACECOMP_Transport] > 7), 1);
+                TRACE(4, "Certificate verification failed: From=%s:%d connect=%u error=%s\n%s\n",
+                         transport->client_addr, transport->clientport, transport->index, sslErr,
+                         certInfo->data);
+                BUF_MEM_free(certInfo);
+            }
+            ism_common_setError(ISMRC_CertificateNotValid);
+            transport->close(transport, ISMRC_CertificateNotValid, 0, "Certificate not valid");
+            return -1;
         }
+        X509_NAME * name = X509_get_subject_name(cert);
+        char commonName [64];
+        if (X509_NAME_get_text_by_NID(name, NID_commonName, commonName, sizeof(commonName)) != -1) {
+            transport->cert_name = ism_transport_putString(transport, commonName);
+        }
+        X509_free(cert);
+    }
 
-        /*
-         * On a completed TLS incoming connection
-         */
-        else {
-            if (con->listener->useClientCert && !transport->usePSK){
-                X509 * cert = SSL_get_peer_certificate(con->ssl);
-                if (cert) {
-                    X509_NAME * name;
-                    rc = SSL_get_verify_result(con->ssl);
-                    if (rc != X509_V_OK) {
-                        const char *sslErr = X509_verify_cert_error_string(rc);
-                        sprintf(err,"Client certificate verification failed: %s", sslErr);
-                        X509_free(cert);
-                        if (SHOULD_TRACE(4)) {
-                            BUF_MEM* certInfo = ism_ssl_getPeerCertInfo(con->ssl,
-                                    (TRACE_DOMAIN->trcComponentLevels[TRACECOMP_Transport] > 7), 1);
-                            TRACE(4, "Certificate verification failed: From=%s:%d connect=%u error=%s\n%s\n",
-                                    transport->client_addr, transport->clientport, transport->index, sslErr,
-                                    certInfo->data);
-                            BUF_MEM_free(certInfo);
-                        }
-                        ism_common_setError(ISMRC_CertificateNotValid);
-                        transport->close(transport, ISMRC_CertificateNotValid, 0, "Certificate not valid");
-                        return -1;
-                    }
-                    name = X509_get_subject_name(cert);
-                    if (name) {
-                        char commonName [1024];
-                        if (X509_NAME_get_text_by_NID(name, NID_commonName, commonName, sizeof(commonName)) != -1) {
-                            transport->cert_name = ism_transport_putString(transport, commonName);
-                        } else {
-                            transport->cert_name = "";
-                        }
-                    }
+    /*
+     * On a completed TLS incoming connection
+     */
+    else {
+        if (con->listener->useClientCert && !transport->usePSK){
+            X509 * cert = SSL_get_peer_certificate(con->ssl);
+            if (cert) {
+                X509_NAME * name;
+                rc = SSL_get_verify_result(con->ssl);
+                if (rc != X509_V_OK) {
+                    const char *sslErr = X509_verify_cert_error_string(rc);
+                    sprintf(err,"Client certificate verification failed: %s", sslErr);
                     X509_free(cert);
-                } else {
-                    if (con->listener->useClientCert != 2) {
-                        ism_common_setError(ISMRC_NoCertificate);
-                        transport->close(transport, ISMRC_NoCertificate, 0, "Certificate missing");
-                        return -1;
+                    if (SHOULD_TRACE(4)) {
+                        BUF_MEM* certInfo = ism_ssl_getPeerCertInfo(con->ssl,
+                                (TRACE_DOMAIN->trcComponentLevels[TRACECOMP_Transport] > 7), 1);
+                        TRACE(4, "Certificate verification failed: From=%s:%d connect=%u error=%s\n%s\n",
+                                transport->client_addr, transport->clientport, transport->index, sslErr,
+                                certInfo->data);
+                        BUF_MEM_free(certInfo);
                     }
+                    ism_common_setError(ISMRC_CertificateNotValid);
+                    transport->close(transport, ISMRC_CertificateNotValid, 0, "Certificate not valid");
+                    return -1;
+                }
+                name = X509_get_subject_name(cert);
+                if (name) {
+                    char commonName [1024];
+                    if (X509_NAME_get_text_by_NID(name, NID_commonName, commonName, sizeof(commonName)) != -1) {
+                        transport->cert_name = ism_transport_putString(transport, commonName);
+                    } else {
+                        transport->cert_name = "";
+                    }
+                }
+                X509_free(cert);
+            } else {
+                if (con->listener->useClientCert != 2) {
+                    ism_common_setError(ISMRC_NoCertificate);
+                    transport->close(transport, ISMRC_NoCertificate, 0, "Certificate missing");
+                    return -1;
                 }
-            }
-            if (transport->usePSK) {
-                const char* identity = SSL_get_psk_identity(con->ssl);
-                int len = strlen(identity) + 1;
-                transport->cert_name = (const char *)ism_transport_allocBytes(transport, len, 0);
-                memcpy((char *)transport->cert_name,identity,len);
             }
         }
-        con->state = (ISM_TRANSPORT_CONNECTED | ISM_TRANSPORT_CAN_READ | ISM_TRANSPORT_CAN_WRITE);
+        if (transport->usePSK) {
+            const char* identity = SSL_get_psk_identity(con->ssl);
+            int len = strlen(identity) + 1;
+            transport->cert_name = (const char *)ism_transport_allocBytes(transport, len, 0);
+            memcpy((char *)transport->cert_name,identity,len);
+        }
+    }
+    /*
+     * Count the incoming handshakes and the sessions resumed from a ticket or the session cache
+     */
+    if (!transport->originated) {
+        ism_endstat_t * stats = con->listener->stats;
+        __sync_add_and_fetch(&stats->tls_handshake_count, 1);
+        if (SSL_session_reused(con->ssl))
+            __sync_add_and_fetch(&stats->tls_resumed_count, 1);
+        if (con->hsStart)
+            __sync_add_and_fetch(&stats->tls_handshake_time, ism_common_currentTimeNanos() - con->hsStart);
+    }
+    con->state = (ISM_TRANSPORT_CONNECTED | ISM_TRANSPORT_CAN_READ | ISM_TRANSPORT_CAN_WRITE);
+    return 0;
+}
+
+/*
+ * Do the SSL/TLS handshake in the IOP thread
+ */
+static int sslHandshake(ism_connection_t * con) {
+    int   rc;
+    ism_transport_t * transport = con->transport;
+
+    if (con->state & ISM_TRANSPORT_ERROR){
+        ism_common_setError(ISMRC_ClosedTLSHandshake);
+        transport->close(transport, ISMRC_ClosedTLSHandshake, 0, "Connection closed during TLS handshake");
+        return -1;
+    }
+    rc = sslHandshakeStep(con);
+    if (rc == 0)
         return 0;
+    if (rc < 0)
+        return sslHandshakeFailed(con, rc);
+    return sslHandshakeComplete(con);
+}
+
+/*
+ * TLS handshake thread.
+ * Run a handshake step for each connection in the queue and send the result back
+ * to the IOP thread of the connection.
+ */
+static void * tlsHandshakeThreadProc(void * parm, void * context, int value) {
+    ism_connection_t * con;
+    int rc;
+
+    for (;;) {
+        pthread_mutex_lock(&hsPool.mutex);
+        while (!hsPool.head && !hsPool.stopped)
+            pthread_cond_wait(&hsPool.cond, &hsPool.mutex);
+        if (hsPool.stopped) {
+            pthread_mutex_unlock(&hsPool.mutex);
+            break;
+        }
+        con = hsPool.head;
+        hsPool.head = con->hsNext;
+        if (!hsPool.head)
+            hsPool.tail = NULL;
+        hsPool.count--;
+        pthread_mutex_unlock(&hsPool.mutex);
+        con->hsNext = NULL;
+
+        ism_common_going2work();
+        while (ERR_get_error());
+        rc = sslHandshakeStep(con);
+        con->hsResult = (rc == 1) ? HS_DONE : (rc == 0) ? HS_WANT : (rc == -1) ? HS_CLOSED : HS_ERROR;
+        /* The IOP thread clears hsBusy when it gets this job, do not touch the connection after it */
+        addJob4Processing(con, HANDSHAKE_DONE);
+        ism_common_backHome();
+    }
+    return NULL;
+}
+
+/*
+ * Queue a connection to the TLS handshake threads.
+ * This is called in the IOP thread of the connection.
+ * @return 0=queued, -1=the queue is full
+ */
+static int submitHandshake(ism_connection_t * con) {
+    pthread_mutex_lock(&hsPool.mutex);
+    if (hsPool.count >= hsQueueMax) {
+        pthread_mutex_unlock(&hsPool.mutex);
+        return -1;
     }
+    con->hsPending = 0;
+    con->hsBusy = 1;
+    con->hsNext = NULL;
+    if (hsPool.tail)
+        hsPool.tail->hsNext = con;
+    else
+        hsPool.head = con;
+    hsPool.tail = con;
+    hsPool.count++;
+    pthread_mutex_unlock(&hsPool.mutex);
+    pthread_cond_signal(&hsPool.cond);
     return 0;
 }
 
+/*
+ * Do the SSL/TLS handshake using the TLS handshake threads.
+ * This is called in the IOP thread when no handshake thread has the connection.
+ * Act on the result of the last handshake step, and queue another step when the
+ * handshake needs more data and IO events arrived since the last step started.
+ * @return 0=complete, 1=wait for the handshake thread or IO, -1=closed
+ */
+static int sslHandshakePool(ism_connection_t * con) {
+    ism_transport_t * transport = con->transport;
+    int result = con->hsResult;
+
+    con->hsResult = HS_NONE;
+    if (con->state & ISM_TRANSPORT_ERROR){
+        ism_common_setError(ISMRC_ClosedTLSHandshake);
+        transport->close(transport, ISMRC_ClosedTLSHandshake, 0, "Connection closed during TLS handshake");
+        return -1;
+    }
+    switch (result) {
+    case HS_DONE:
+        return sslHandshakeComplete(con);
+    case HS_CLOSED:
+        return sslHandshakeFailed(con, -1);
+    case HS_ERROR:
+        return sslHandshakeFailed(con, -2);
+    case HS_WANT:
+        if (!con->hsPending)
+            return 1;
+        /* fall thru */
+    default:
+        if (submitHandshake(con)) {
+            __sync_add_and_fetch(&con->listener->stats->tls_handshake_reject, 1);
+            TRACE(5, "Reject TLS handshake as the handshake queue is full: connect=%u from=%s:%u endpoint=%s\n",
+                    transport->index, transport->client_addr, transport->clientport, transport->endpoint_name);
+            ism_common_setError(ISMRC_ClosedTLSHandshake);
+            transport->close(transport, ISMRC_ClosedTLSHandshake, 0, "TLS handshake queue is full");
+            return -1;
+        }
+        return 1;
+    }
+}
+
 
 /*
  * Return the SSL object from a transport object
@@ -2200,6 +2412,11 @@ HOT static int processIORequest(ism_connection_t * con, ioProcessorThread iopth)
         return 1;
     }
 
+    /* A TLS handshake thread has the connection.  It is processed again when the step completes */
+    if (UNLIKELY(con->hsBusy)) {
+        return 1;
+    }
+
     /* Clear any openSSL errors which might pertain to other connections */
     if (con->secured) {
         while (ERR_get_error());
@@ -2281,7 +2498,9 @@ HOT static int processIORequest(ism_connection_t * con, ioProcessorThread iopth)
 
     if (UNLIKELY(state & ISM_TRANSPORT_HANDSHAKE_IN_PROCESS)) {
         /* SSL handshake is required */
-        rc1 = sslHandshake(con);
+        rc1 = con->hsPool ? sslHandshakePool(con) : sslHandshake(con);
+        if (rc1 > 0)
+            return 1;
         if (rc1 == 0)
             return 0;
         rc1 = writeData(con);
@@ -2419,6 +2638,24 @@ static void * ioListenerProc(void * parm, void * context, int value) {
     return NULL;
 }
 
+/*
+ * Check whether the send queue memory budget is exceeded and this connection is
+ * one of those holding it.  Connections which are keeping up with their sends
+ * rarely have more than a buffer queued, so only the connections with a backlog
+ * are suspended, and they are resumed as usual when their send queue drains.
+ */
+static inline int overSendQueueBudget(ism_transport_t * transport) {
+    if (g_sendQueueMemoryMax == 0 || g_sendQueueMemory <= g_sendQueueMemoryMax)
+        return 0;
+    if (transport->sendQueueBytes <= (uint64_t)sendSize)
+        return 0;
+    if (!transport->suspended) {
+        TRACEL(6, transport->trclevel, "Connection suspended by send queue memory budget: connect=%u sendQueueBytes=%llu totalBytes=%llu maxBytes=%llu\n",
+                transport->index, (ULL)transport->sendQueueBytes, (ULL)g_sendQueueMemory, (ULL)g_sendQueueMemoryMax);
+    }
+    return 1;
+}
+
 /*
  * Send bytes on output
  */
@@ -2434,6 +2671,7 @@ HOT static int sendBytes(ism_transport_t * transport, char * buf, int len, int p
     int addJob = 0;
     ism_connection_t * con = transport->tobj;
     int counter = 0;
+    int64_t bufferBytes = 0;
     int rc = SRETURN_OK;
     int state = con->state & (ISM_TRANSPORT_ERROR | ISM_TRANSPORT_DISCONNECTED | ISM_TRANSPORT_SHUTDOWN_IN_PROCESS);
     if (UNLIKELY(state))
@@ -2453,6 +2691,7 @@ HOT static int sendBytes(ism_transport_t * transport, char * buf, int len, int p
         }
     }
     buflen = len + flen;
+    __sync_add_and_fetch(&transport->sendQueueBytes, buflen);
     if (LIKELY(con->doNotBatch == 0)) {
         pthread_spin_lock(&con->slock);
         sndBuffer = con->sndQueueTail;
@@ -2467,6 +2706,8 @@ HOT static int sendBytes(ism_transport_t * transport, char * buf, int len, int p
             memcpy(sndBuffer->putPtr, buf, len);
             sndBuffer->putPtr += len;
             sndBuffer->used += len;
+            if (UNLIKELY(overSendQueueBudget(transport)))
+                __sync_bool_compare_and_swap(&transport->suspended,0,1);
             if (UNLIKELY(con->transport->suspended))
                 rc = SRETURN_SUSPEND;
             pthread_spin_unlock(&con->slock);
@@ -2501,6 +2742,7 @@ HOT static int sendBytes(ism_transport_t * transport, char * buf, int len, int p
             }
 //            assert(sndBuffer->putPtr == (sndBuffer->buf + sndBuffer->used));
 //            assert(sndBuffer->used <= sndBuffer->allocated);
+            bufferBytes += sndBuffer->allocated;
             counter++;
             if (UNLIKELY(buflen))
                 continue;
@@ -2511,6 +2753,7 @@ HOT static int sendBytes(ism_transport_t * transport, char * buf, int len, int p
             continue;
         break;
     } while (1);
+    sendQueueMemoryUpdate(transport, bufferBytes);
     pthread_spin_lock(&con->slock);
     if (UNLIKELY(force))
         __sync_bool_compare_and_swap(&transport->suspended,0,1);
@@ -2525,6 +2768,8 @@ HOT static int sendBytes(ism_transport_t * transport, char * buf, int len, int p
     transport->sendQueueSize += counter;
     if (transport->sendQueueSize > 128)
         __sync_bool_compare_and_swap(&transport->suspended,0,1);
+    if (UNLIKELY(overSendQueueBudget(transport)))
+        __sync_bool_compare_and_swap(&transport->suspended,0,1);
     if (UNLIKELY(transport->suspended)) {
         rc = SRETURN_SUSPEND;
 #ifdef DEBUG
@@ -2563,6 +2808,63 @@ extern void ism_engine_threadInit(uint8_t isStoreCrit);
 #undef TRACE_DOMAIN
 #define TRACE_DOMAIN ism_defaultTrace
 
+/*
+ * Apply the events of a job to the connection.
+ * This is called in the IOP thread of the connection.
+ */
+static void applyJobEvents(ism_connection_t * con, uint64_t events) {
+    if (events & 0xFFFFFFFF) {
+#if EPOLL_DEBUG
+        ism_transport_t * transport = con->transport;
+#endif
+//            int state = con->state;
+        if (events & EPOLLIN) {
+            con->state |= ISM_TRANSPORT_CAN_READ;
+        }
+        if (con->hsPool) {
+            con->hsPending = 1;
+        }
+        if (events & EPOLLOUT)   {
+            con->state |= ISM_TRANSPORT_CAN_WRITE;
+#if EPOLL_DEBUG
+            if(transport->name[0]) {
+                TRACE(5, "ioProc() : EPOLLOUT for: con=%p connect=%u name=%s sock=%d from %s:%u\n", con,
+                    transport->index, transport->name, con->socket, transport->client_addr, transport->clientport );
+            }
+#endif
+        }
+        if (events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+            ism_transport_t * transport = con->transport;
+            if(transport->originated && (con->state & ISM_TRANSPORT_CONNECT_IN_PROCESS)) {
+                TRACE(4, "ioProc() : Set error state for connection in process: con=%p transport=%p connect=%u name=%s sock=%d events=0x%llx\n",
+                        con, transport, transport->index, transport->name, con->socket, (ULL)events);
+            }
+            __sync_fetch_and_or(&con->state, (ISM_TRANSPORT_ERROR | ISM_TRANSPORT_CAN_READ) );
+        }
+//            fprintf(stderr,"ism_tcp_ioProcessorThreadProc: tobj=%p oldState=0x%x state=0x%x\n", con, state, con->state);
+    } else {
+        if (events == SHUTDOWN_REQUEST)
+            con->state |= ISM_TRANSPORT_SHUTDOWN_IN_PROCESS;
+        else if (events == SHUTDOWN_FORCE)
+            con->state |= (ISM_TRANSPORT_SHUTDOWN_IN_PROCESS | ISM_TRANSPORT_SHUTDOWN_FORCE);
+        else if (events == HANDSHAKE_DONE)
+            con->hsBusy = 0;
+        else
+            con->state |= ISM_TRANSPORT_DISCONNECTED;
+    }
+}
+
+
+/*
+ * Check if a connection which is no longer processing can complete its close.
+ * While a TLS handshake thread has the connection the close is deferred until the
+ * HANDSHAKE_DONE job for the step is processed.
+ */
+static inline int connectionCanClose(ism_connection_t * con) {
+    return (con->state & ISM_TRANSPORT_DISCONNECTED) && !con->hsBusy;
+}
+
+
 /*
  * IO Processor thread
  */
@@ -2619,42 +2921,8 @@ HOT static void * ism_tcp_ioProcessorThreadProc(void * parm, void * context, int
             ioProcJob * job = currentJobsList->jobs + i;
             ism_connection_t * con = job->con;
             uint64_t events = job->events;
-            if (events) {
-                if (events & 0xFFFFFFFF) {
-#if EPOLL_DEBUG
-                    ism_transport_t * transport = con->transport;
-#endif
-//                    int state = con->state;
-                    if (events & EPOLLIN) {
-                        con->state |= ISM_TRANSPORT_CAN_READ;
-                    }
-                    if (events & EPOLLOUT)   {
-                        con->state |= ISM_TRANSPORT_CAN_WRITE;
-#if EPOLL_DEBUG
-                        if(transport->name[0]) {
-	                        TRACE(5, "ioProc() : EPOLLOUT for: con=%p connect=%u name=%s sock=%d from %s:%u\n", con,
-                                transport->index, transport->name, con->socket, transport->client_addr, transport->clientport );
-                        }
-#endif
-                    }
-                    if (events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
-                        ism_transport_t * transport = con->transport;
-                        if(transport->originated && (con->state & ISM_TRANSPORT_CONNECT_IN_PROCESS)) {
-                            TRACE(4, "ioProc() : Set error state for connection in process: con=%p transport=%p connect=%u name=%s sock=%d events=0x%llx\n",
-                                    con, transport, transport->index, transport->name, con->socket, (ULL)events);
-                        }
-                        __sync_fetch_and_or(&con->state, (ISM_TRANSPORT_ERROR | ISM_TRANSPORT_CAN_READ) );
-                    }
-//                    fprintf(stderr,"ism_tcp_ioProcessorThreadProc: tobj=%p oldState=0x%x state=0x%x\n", con, state, con->state);
-                } else {
-                    if (events == SHUTDOWN_REQUEST)
-                        con->state |= ISM_TRANSPORT_SHUTDOWN_IN_PROCESS;
-                    else if (events == SHUTDOWN_FORCE)
-                        con->state |= (ISM_TRANSPORT_SHUTDOWN_IN_PROCESS | ISM_TRANSPORT_SHUTDOWN_FORCE);
-                    else
-                        con->state |= ISM_TRANSPORT_DISCONNECTED;
-                }
-            }
+            if (events)
+                applyJobEvents(con, events);
             if (!con->isProcessing) {
                 if (nextSize == currentAllocated) {
                     currentAllocated *= 2;
@@ -2677,7 +2945,7 @@ HOT static void * ism_tcp_ioProcessorThreadProc(void * parm, void * context, int
                     current[nextSize++] = con;
                 } else {
                     con->isProcessing = 0;
-                    if (con->state & ISM_TRANSPORT_DISCONNECTED) {
+                    if (connectionCanClose(con)) {
                         connectionCloseComplete(con);
                     }
                 }
@@ -2906,10 +3174,18 @@ int ism_transport_initTCP(void) {
 
     maxPoolSizeBytes =  ((maxPoolSizeMB*1024*1024) / (numOfIOProcs + 1));
 
+    /*
+     * Set the budget for memory held in send queues across all connections.
+     * When it is exceeded the connections with a backlog are suspended.
+     * The default of 0 leaves the send queues unlimited.
+     */
+    g_sendQueueMemoryMax = (uint64_t)ism_common_getIntConfig("TcpMaxSendQueueMemoryMB", 0) * 1024 * 1024;
+
     iopDelay = ism_common_getIntConfig("TcpIOPThreadDelayMicro", -1);
     tobjFromPool = ism_common_getBooleanConfig("TcpGetTobjFromPool", 1);
     disableMonitoring = ism_common_getIntConfig("TcpDisableMonitoring", 0);
-    TRACE(4, "Initialize the TCP transport: threads=%d poolsize=%uMB\n", numOfIOProcs + 1, (uint32_t)maxPoolSizeMB);
+    TRACE(4, "Initialize the TCP transport: threads=%d poolsize=%uMB sendqmax=%uMB\n", numOfIOProcs + 1, (uint32_t)maxPoolSizeMB,
+            (uint32_t)(g_sendQueueMemoryMax / (1024 * 1024)));
 
     /*
      * Start a timer for cleanup
@@ -2944,6 +3220,20 @@ int ism_transport_initTCP(void) {
     useSpinLocks = ism_common_getBooleanConfig("UseSpinLocks", 0);
     g_ctxPerThread = ism_common_getBooleanConfig("TlsContextPerThread", 0);
 
+    /*
+     * When TlsHandshakeThreads is set, the TLS handshakes of incoming connections are done in
+     * these threads.  At most TlsHandshakeQueue connections wait for a handshake thread, and
+     * when the queue is full new connections are closed.
+     */
+    hsThreads = ism_common_getIntConfig("TlsHandshakeThreads", 0);
+    if (hsThreads < 0)
+        hsThreads = 0;
+    if (hsThreads > 64)
+        hsThreads = 64;
+    hsQueueMax = ism_common_getIntConfig("TlsHandshakeQueue", 10000);
+    if (hsQueueMax < 16)
+        hsQueueMax = 16;
+
     /*
      * NoLogAddres is an IPv4 address and scope such as "127.0.0.0/24".
      * The scope can be between 8 and 30.  If no score is given, a single
@@ -3224,6 +3514,20 @@ int ism_transport_startTCP(void) {
         ioProcessors[i] = createIOPThread(threadname, ioListener);
     }
 
+    /*
+     * Start the TLS handshake threads
+     */
+    if (hsThreads > 0) {
+        hsPool.stopped = 0;
+        hsPool.threads = ism_common_calloc(ISM_MEM_PROBE(ism_memory_transportBuffers, 31), hsThreads, sizeof(ism_threadh_t));
+        for (i = 0; i < hsThreads; i++) {
+            sprintf(threadname, "tlshs.%u", (uint16_t)i);
+            ism_common_startThread(&hsPool.threads[i], tlsHandshakeThreadProc, NULL, NULL, 0, ISM_TUSAGE_NORMAL, 0, threadname,
+                    "TLS handshake");
+        }
+        TRACE(4, "Start TLS handshake threads: threads=%d queue=%d\n", hsThreads, hsQueueMax);
+    }
+
     g_stopped = 0;
 
     return 0;
@@ -3379,6 +3683,17 @@ int ism_transport_termTCP(void) {
     stopIOLThread(ioListener);
 
     /* Stop threads */
+    if (hsPool.threads) {
+        pthread_mutex_lock(&hsPool.mutex);
+        hsPool.stopped = 1;
+        pthread_mutex_unlock(&hsPool.mutex);
+        pthread_cond_broadcast(&hsPool.cond);
+        for (i = 0; i < hsThreads; i++) {
+            ism_common_joinThread(hsPool.threads[i], NULL);
+        }
+        ism_common_free(ism_memory_transportBuffers, hsPool.threads);
+        hsPool.threads = NULL;
+    }
     for (i = 0; i < numOfIOProcs; i++) {
         stopIOPThread(ioProcessors[i]);
     }
@@ -3488,6 +3488,10 @@ XAPI int ism_transport_getEndpointMonitor(ism_endpoint_mon_t * * monlis, const c
             endpmon->write_bytes_count = write_bytes;               /* Write bytes count since reset    */
             endpmon->lost_msg_count    = lost_msg;                  /* Lost message count since reset   */
             endpmon->warn_msg_count    = warn_msg;                  /* Partially successful message publish count since reset   */
+            endpmon->tls_handshake_count  = endpoint->stats->tls_handshake_count;  /* TLS handshakes completed  */
+            endpmon->tls_resumed_count    = endpoint->stats->tls_resumed_count;    /* TLS sessions resumed      */
+            endpmon->tls_handshake_time   = endpoint->stats->tls_handshake_time;   /* TLS handshake time        */
+            endpmon->tls_handshake_reject = endpoint->stats->tls_handshake_reject; /* TLS handshakes rejected   */
             endpmon++;
         }
         *monlis = (ism_endpoint_mon_t *)(ret+1);
@@ -3770,13 +3774,14 @@ void ism_transport_dumpTransport(int level, ism_transport_t * transport, const c
           "Transport %s index=%u name=%s addr=%p\n"
           "    client_addr=%s client_port=%u server_addr=%s server_port=%u\n"
           "    protocol=%s userid=%s clientID=%s cert_name=%s\n"
-          "    readbytes=%llu readmsg=%llu writebytes=%llu writemsg=%llu sendQueueSize=%d\n",
+          "    readbytes=%llu readmsg=%llu writebytes=%llu writemsg=%llu sendQueueSize=%d sendQueueBytes=%llu\n",
           where, transport->index, transport->name, transport,
           transport->client_addr, transport->clientport, transport->server_addr, transport->serverport,
           transport->protocol, transport->userid ? transport->userid : "", transport->clientID,
           transport->cert_name?transport->cert_name:"",
           (ULL)transport->read_bytes, (ULL)transport->read_msg,
-          (ULL)transport->write_bytes, (ULL)transport->write_msg, transport->sendQueueSize);
+          (ULL)transport->write_bytes, (ULL)transport->write_msg, transport->sendQueueSize,
+          (ULL)transport->sendQueueBytes);
 }
 
 
@@ -3816,7 +3821,8 @@ void ism_transport_dumpEndpoint(int level, ism_endpoint_t * endpoint, const char
           "Endpoint %s name=%s enabled=%u rc=%d ipaddr=%s port=%u transport=%s addr=%p need=%d\n"
           "    hub=%s secure=%u secprof=%s conpolicies=%s topicpolicies=%s qpolicies=%s subpolicies=%s\n"
           "    protomask=%lx transmask=%x sock=%p maxsize=%u active=%llu count=%llu failed=%llu\n"
-          "    read_msg=%s read_bytes=%s write_msg=%s write_msg=%s lost_msg=%llu warn_msg=%llu\n",
+          "    read_msg=%s read_bytes=%s write_msg=%s write_msg=%s lost_msg=%llu warn_msg=%llu sendq_bytes=%llu\n"
+          "    tls_handshakes=%llu tls_resumed=%llu tls_handshake_time=%llu tls_rejected=%llu\n",
             where, endpoint->name, endpoint->enabled, endpoint->rc, endpoint->ipaddr ? endpoint->ipaddr : "(null)",
             endpoint->port, endpoint->transport_type, endpoint, endpoint->needed,
             endpoint->msghub ? endpoint->msghub : "", endpoint->secure, endpoint->secprof ? endpoint->secprof : "",
@@ -3824,7 +3830,10 @@ void ism_transport_dumpEndpoint(int level, ism_endpoint_t * endpoint, const char
             endpoint->qpolicies ? endpoint->qpolicies : "", endpoint->subpolicies ? endpoint->subpolicies : "",
             endpoint->protomask, endpoint->transmask,
             (void *)(uintptr_t)endpoint->sock, endpoint->maxMsgSize, (ULL)endpoint->stats->connect_active, (ULL)endpoint->stats->connect_count,
-            (ULL)endpoint->stats->bad_connect_count, rmsgcnt, rbytecnt, wmsgcnt, wbytecnt, (ULL)lost_msg, (ULL)warn_msg);
+            (ULL)endpoint->stats->bad_connect_count, rmsgcnt, rbytecnt, wmsgcnt, wbytecnt, (ULL)lost_msg, (ULL)warn_msg,
+            (ULL)endpoint->stats->sendq_bytes, (ULL)endpoint->stats->tls_handshake_count,
+            (ULL)endpoint->stats->tls_resumed_count, (ULL)endpoint->stats->tls_handshake_time,
+            (ULL)endpoint->stats->tls_handshake_reject);
 }
 
 /*
@@ -33,6 +33,8 @@ CU_TestInfo ISM_tcp_tests[] = {
         { "--- Testing handshake processing       ---", testHandshake },
   //    { "--- Testing TCP start and term         ---", testStartStop },
         { "--- Testing multiple port support      ---", testMultiplePorts },
+        { "--- Testing send queue memory          ---", testSendQueueMemory },
+        { "--- Testing TLS handshake threads      ---", testHandshakePool },
         CU_TEST_INFO_NULL
 };
 
@@ -1003,3 +1005,225 @@ void testMultiplePorts(void) {
     ism_transport_term();
 
 }
+
+/*
+ * Make a connection for the send queue tests which writes to one end of a
+ * socket pair, with its own IO processor thread structure to queue the job on.
+ */
+static ism_connection_t * makeSendQueueConnection(ism_transport_t * transport, ioProcessorThread_t * iop, int * sv) {
+    ism_connection_t * con = calloc(1, sizeof(struct ism_transobj));
+    CU_ASSERT_FATAL(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+    memset(iop, 0, sizeof(*iop));
+    pthread_spin_init(&iop->lock, 0);
+    pthread_mutex_init(&iop->mutex, NULL);
+    pthread_cond_init(&iop->cond, NULL);
+    iop->jobsList[0].allocated = 8;
+    iop->jobsList[0].jobs = calloc(8, sizeof(ioProcJob));
+    iop->currentJobsList = &iop->jobsList[0];
+    iop->bufferPool = ism_common_createBufferPool(1024, 8, 64, "SendQueueTest");
+    pthread_spin_init(&con->slock, 0);
+    con->transport = transport;
+    con->socket = sv[0];
+    con->maxSendSize = 1024 * 1024;
+    con->iopth = iop;
+    transport->tobj = con;
+    transport->nostats = 1;
+    transport->resume = emptyResume;
+    return con;
+}
+
+/*
+ * Write everything queued on the connection and read it at the other end
+ */
+static int drainSendQueue(ism_connection_t * con, int sock) {
+    char buf[4096];
+    int count = 0;
+    while (con->sendBuffer || con->sndQueueHead) {
+        writeData(con);
+        count += read(sock, buf, sizeof buf);
+    }
+    return count;
+}
+
+/*
+ * Test the accounting of send queue memory as buffers are queued and written,
+ * and that connections with a backlog are suspended when the budget is exceeded.
+ */
+void testSendQueueMemory(void) {
+    char data[3000];
+    int sv[2];
+    ioProcessorThread_t iop;
+    int64_t allocated;
+    int saveSendSize = sendSize;
+    uint64_t saveMax = g_sendQueueMemoryMax;
+    uint64_t startMemory = g_sendQueueMemory;
+
+    ism_listener_t * listener = calloc(1, sizeof(ism_listener_t) + sizeof(ism_endstat_t));
+    listener->stats = (ism_endstat_t *)(listener+1);
+    listener->name = "sendq";
+    ism_transport_t * transport = ism_transport_newTransport(listener, 0, 0);
+    ism_connection_t * con = makeSendQueueConnection(transport, &iop, sv);
+    memset(data, 'x', sizeof data);
+    sendSize = 1024;
+    g_sendQueueMemoryMax = 0;
+
+    /* The first send queues a buffer and counts all of it */
+    CU_ASSERT(sendBytes(transport, data, 100, 0, SFLAG_HASFRAME) == SRETURN_OK);
+    CU_ASSERT_FATAL(con->sndQueueHead != NULL);
+    allocated = con->sndQueueHead->allocated;
+    CU_ASSERT(g_sendQueueMemory == startMemory + allocated);
+    CU_ASSERT(listener->stats->sendq_bytes == allocated);
+    CU_ASSERT(transport->sendQueueBytes == 100);
+
+    /* A send which fits in the last buffer adds no memory */
+    CU_ASSERT(sendBytes(transport, data, 100, 0, SFLAG_HASFRAME) == SRETURN_OK);
+    CU_ASSERT(g_sendQueueMemory == startMemory + allocated);
+    CU_ASSERT(transport->sendQueueBytes == 200);
+
+    /* A large send takes three more buffers, with no budget it is not suspended */
+    CU_ASSERT(sendBytes(transport, data, 3000, 0, SFLAG_HASFRAME) == SRETURN_OK);
+    CU_ASSERT(g_sendQueueMemory == startMemory + 4 * allocated);
+    CU_ASSERT(listener->stats->sendq_bytes == 4 * allocated);
+    CU_ASSERT(transport->suspended == 0);
+
+    /* Writing the queue releases all of it and resumes nothing as nothing was suspended */
+    transportResumed = 0;
+    CU_ASSERT(drainSendQueue(con, sv[1]) == 3200);
+    CU_ASSERT(g_sendQueueMemory == startMemory);
+    CU_ASSERT(listener->stats->sendq_bytes == 0);
+    CU_ASSERT(transport->sendQueueBytes == 0);
+    CU_ASSERT(transportResumed == 0);
+
+    /* Over the budget a connection with a backlog is suspended */
+    g_sendQueueMemoryMax = startMemory + 2 * allocated;
+    CU_ASSERT(sendBytes(transport, data, 1000, 0, SFLAG_HASFRAME) == SRETURN_OK);
+    CU_ASSERT(sendBytes(transport, data, 3000, 0, SFLAG_HASFRAME) == SRETURN_SUSPEND);
+    CU_ASSERT(transport->suspended == 1);
+    CU_ASSERT(g_sendQueueMemory > g_sendQueueMemoryMax);
+
+    /* and is resumed when its queue is written */
+    CU_ASSERT(drainSendQueue(con, sv[1]) == 4000);
+    CU_ASSERT(g_sendQueueMemory == startMemory);
+    CU_ASSERT(transport->suspended == 0);
+    CU_ASSERT(transportResumed == 1);
+
+    /* A connection without a backlog is not suspended when others exceed the budget */
+    __sync_add_and_fetch(&g_sendQueueMemory, 4 * allocated);
+    CU_ASSERT(sendBytes(transport, data, 100, 0, SFLAG_HASFRAME) == SRETURN_OK);
+    CU_ASSERT(transport->suspended == 0);
+    __sync_sub_and_fetch(&g_sendQueueMemory, 4 * allocated);
+    CU_ASSERT(drainSendQueue(con, sv[1]) == 100);
+    CU_ASSERT(g_sendQueueMemory == startMemory);
+
+    sendSize = saveSendSize;
+    g_sendQueueMemoryMax = saveMax;
+    close(sv[0]);
+    close(sv[1]);
+    transport->tobj = NULL;
+    free(iop.jobsList[0].jobs);
+    ism_common_destroyBufferPool(iop.bufferPool);
+    free(con);
+    ism_transport_freeTransport(transport);
+    free(listener);
+}
+
+
+static int handshakeCloseRC;
+
+static int handshakeClose(ism_transport_t * transport, int rc, int clean, const char * reason) {
+    handshakeCloseRC = rc;
+    return 0;
+}
+
+/*
+ * Remove a connection from the TLS handshake queue as no handshake thread runs in the test
+ */
+static void takeHandshake(ism_connection_t * con) {
+    pthread_mutex_lock(&hsPool.mutex);
+    CU_ASSERT(hsPool.head == con);
+    hsPool.head = con->hsNext;
+    if (!hsPool.head)
+        hsPool.tail = NULL;
+    hsPool.count--;
+    pthread_mutex_unlock(&hsPool.mutex);
+}
+
+/*
+ * Test the handling in the IOP thread of a connection whose TLS handshake runs in the
+ * handshake threads: the HANDSHAKE_DONE resubmit, the close deferral while a handshake
+ * thread has the connection, and the rejection when the handshake queue is full.
+ */
+void testHandshakePool(void) {
+    int saveQueueMax = hsQueueMax;
+    ism_listener_t * listener = calloc(1, sizeof(ism_listener_t) + sizeof(ism_endstat_t));
+    listener->stats = (ism_endstat_t *)(listener+1);
+    listener->name = "handshake";
+    ism_transport_t * transport = ism_transport_newTransport(listener, 0, 0);
+    ism_connection_t * con = calloc(1, sizeof(struct ism_transobj));
+    con->transport = transport;
+    con->listener = listener;
+    con->hsPool = 1;
+    transport->tobj = con;
+    transport->nostats = 1;
+    transport->close = handshakeClose;
+    hsQueueMax = 16;
+    CU_ASSERT_FATAL(hsPool.count == 0);
+
+    /* The step wants more data and no events arrived so it waits for IO */
+    con->hsResult = HS_WANT;
+    CU_ASSERT(sslHandshakePool(con) == 1);
+    CU_ASSERT(con->hsBusy == 0);
+    CU_ASSERT(con->hsResult == HS_NONE);
+    CU_ASSERT(hsPool.count == 0);
+
+    /* An IO event makes the HANDSHAKE_DONE processing queue another step */
+    applyJobEvents(con, EPOLLIN);
+    CU_ASSERT(con->hsPending == 1);
+    CU_ASSERT((con->state & ISM_TRANSPORT_CAN_READ) != 0);
+    con->hsResult = HS_WANT;
+    CU_ASSERT(sslHandshakePool(con) == 1);
+    CU_ASSERT(con->hsBusy == 1);
+    CU_ASSERT(con->hsPending == 0);
+    CU_ASSERT(hsPool.count == 1);
+    CU_ASSERT(hsPool.tail == con);
+
+    /* While the handshake thread has the connection it is not processed */
+    CU_ASSERT(processIORequest(con, NULL) == 1);
+
+    /* and a close is deferred until the step completes */
+    applyJobEvents(con, CLEANUP_REQUEST);
+    CU_ASSERT((con->state & ISM_TRANSPORT_DISCONNECTED) != 0);
+    CU_ASSERT(connectionCanClose(con) == 0);
+    takeHandshake(con);
+    applyJobEvents(con, HANDSHAKE_DONE);
+    CU_ASSERT(con->hsBusy == 0);
+    CU_ASSERT(connectionCanClose(con) == 1);
+    CU_ASSERT(listener->stats->tls_handshake_reject == 0);
+
+    /* When the handshake queue is full the connection is closed and counted */
+    con->state = 0;
+    con->hsResult = HS_NONE;
+    hsQueueMax = 0;
+    handshakeCloseRC = 0;
+    CU_ASSERT(sslHandshakePool(con) == -1);
+    CU_ASSERT(handshakeCloseRC == ISMRC_ClosedTLSHandshake);
+    CU_ASSERT(con->hsBusy == 0);
+    CU_ASSERT(hsPool.count == 0);
+    CU_ASSERT(listener->stats->tls_handshake_reject == 1);
+
+    /* A connection in error is closed rather than queued */
+    con->state = ISM_TRANSPORT_ERROR;
+    con->hsResult = HS_WANT;
+    con->hsPending = 1;
+    hsQueueMax = 16;
+    handshakeCloseRC = 0;
+    CU_ASSERT(sslHandshakePool(con) == -1);
+    CU_ASSERT(handshakeCloseRC == ISMRC_ClosedTLSHandshake);
+    CU_ASSERT(hsPool.count == 0);
+
+    hsQueueMax = saveQueueMax;
+    transport->tobj = NULL;
+    free(con);
+    ism_transport_freeTransport(transport);
+    free(listener);
+}
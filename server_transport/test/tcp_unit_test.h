@@ -23,6 +23,8 @@ void testSendReceiveBytesMulti(void);
 void testStartStop(void);
 void testSaveArea(void);
 void testMultiplePorts(void);
+void testSendQueueMemory(void);
+void testHandshakePool(void);
 
 /**
  * Test array for simple tcp tests.
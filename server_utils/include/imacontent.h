@@ -443,6 +443,21 @@ XAPI int ism_findPropertyName(ism_actionbuf_t * action, const char * name, ism_f
  */
 XAPI int ism_findPropertyNameIndex(ism_actionbuf_t * action, int index, ism_field_t * f);
 
+/**
+ * Find all named properties.
+ *
+ * Decode the named properties and return the name and value of each in the order
+ * they occur.  Only the first count properties are returned, but the return value
+ * is the total number of named properties.
+ *
+ * @param action  The map or properties buffer
+ * @param names   The array of names to return
+ * @param fields  The array of fields to return
+ * @param count   The size of the names and fields arrays
+ * @return The number of named properties
+ */
+XAPI int ism_findPropertyNames(ism_actionbuf_t * action, const char * * names, ism_field_t * fields, int count);
+
 /*
  * Convert a properties object to a serialized properties map.
  *
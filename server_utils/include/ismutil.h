@@ -908,6 +908,18 @@ XAPI char * ism_common_allocAllocBuffer(concat_alloc_t * buf, int len, int align
  */
 XAPI char * ism_common_allocAllocBufferOnHeap(concat_alloc_t * buf, int len);
 
+/**
+ * Make room for more data in an allocation buffer.
+ *
+ * This is used when the size of the data is known or can be estimated so that the
+ * buffer is allocated once at the needed size instead of growing as the data is added.
+ * The used length of the buffer is not changed.
+ * @param buf   The allocation buffer
+ * @param len   The length of the data to be added
+ * @return A return code, 0=good
+ */
+XAPI int ism_common_allocBufferReserve(concat_alloc_t * buf, int len);
+
 
 /* ********************************************************************
  *
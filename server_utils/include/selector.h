@@ -96,6 +96,7 @@ enum BaseRules {
     SELRULE_TopicPart   = 0x19,  /* Internal Topic component        kind=which      */
     SELRULE_QoS         = 0x1A,  /* Internal Load QoS               kind=unused     */
     SELRULE_SmallInt    = 0x1B,  /* Internal Load one byte int      kind=value      */
+    SELRULE_Code        = 0x1C,  /* Selection code (header only)    kind=unused     */
 };
 
 
@@ -172,6 +173,71 @@ XAPI int ism_common_selectMessage(
         size_t                     rulelen,
         ismMessageSelectionLockStrategy_t * lockStrategy);
 
+/**
+ * Start a selection cache.
+ *
+ * When one message is selected against a number of rules the properties of the message
+ * are decoded on first use and kept until the cache is ended.  Calls to
+ * ism_common_selectMessage() and ism_common_getSelectProperty() on this thread for this
+ * message use the decoded properties.  The message must not be freed until the cache is
+ * ended.  There is one selection cache per thread, so starting a cache ends any cache
+ * for another message.
+ *
+ * @param area     The message area count
+ * @param areatype The array of area types
+ * @param areasize The array of area sizes
+ * @parma areaptr  The array of area ponters
+ */
+XAPI void ism_common_startSelectCache(uint8_t areas, ismMessageAreaType_t areatype[areas],
+        size_t areasize[areas], void * areaptr[areas]);
+
+/**
+ * End a selection cache.
+ */
+XAPI void ism_common_endSelectCache(void);
+
+/**
+ * Get the index key of a selection rule.
+ *
+ * A rule can be indexed when one of its top level AND terms compares a property for
+ * equality with a string constant, or checks it is IN a list of string constants.
+ * The rule cannot select a message unless that property is a string equal to one of
+ * the returned values.  Properties whose names start with JMS are not used.
+ *
+ * @param rule    The compiled selection rule
+ * @param want    The property name to find, or NULL to find the first one
+ * @param name    The property name is returned here
+ * @param values  The values are returned here (these point into the rule and are not null terminated)
+ * @param lens    The lengths of the values are returned here
+ * @param max     The size of the values and lens arrays
+ * @return The number of values, or 0 if the rule has no index key
+ */
+XAPI int ism_common_getSelectKey(ismRule_t * rule, const char * want, const char * * name,
+        const char * * values, int * lens, int max);
+
+/**
+ * Get a message property for a selection index.
+ *
+ * This uses the decoded properties when in a selection cache.
+ *
+ * @param hdr      The message header
+ * @param area     The message area count
+ * @param areatype The array of area types
+ * @param areasize The array of area sizes
+ * @parma areaptr  The array of area ponters
+ * @param name     The property name
+ * @param field    The field to return.  This is a null field if the property is not found.
+ * @return A return code 0=found, 1=not found
+ */
+XAPI int ism_common_getSelectProperty(
+        ismMessageHeader_t *       hdr,
+        uint8_t                    areas,
+        ismMessageAreaType_t       areatype[areas],
+        size_t                     areasize[areas],
+        void *                     areaptr[areas],
+        const char *               name,
+        ism_field_t *              field);
+
 /**
  * Compute the length of the match string.
  * This allows the creator of a match string to allocate the space for the
@@ -328,6 +394,26 @@ typedef int (* property_gen_t)(ism_prop_t * props, ism_emsg_t * emsg, const char
  */
 XAPI int ism_common_filter(ismRule_t * rule, ism_prop_t * props, property_gen_t generator, ism_emsg_t * emsg, ismMessageSelectionLockStrategy_t * lockStrategy);
 
+/**
+ * Compile a selection rule to selection code.
+ *
+ * Selection code is a second compile of the rule which runs faster than the rule.
+ * It can be used in place of the rule in ism_common_filter() and ism_common_selectMessage(),
+ * but not in the other functions which take a rule.  The code does not refer to the rule,
+ * and cannot be copied.  The code must be freed using ism_common_freeSelectCode().
+ *
+ * @param xcode   The output selection code
+ * @param rule    The compiled selection rule
+ * @return A return code: 0=good
+ */
+XAPI int ism_common_compileSelectCode(ismRule_t * * xcode, ismRule_t * rule);
+
+/**
+ * Free selection code
+ * @param code  The selection code
+ */
+XAPI void ism_common_freeSelectCode(ismRule_t * code);
+
 
 
 
@@ -335,7 +421,7 @@ XAPI int ism_common_filter(ismRule_t * rule, ism_prop_t * props, property_gen_t
 /*
  * Base SEL rule names (used for dump)
  */
-char * BaseRuleName [29] = {
+char * BaseRuleName [30] = {
     "End",
     "Begin",
     "In",
@@ -364,6 +450,7 @@ char * BaseRuleName [29] = {
     "TopicPart",
     "QoS",
     "SmallInt",
+    "Code",
     NULL
 };
 #endif
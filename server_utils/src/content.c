@@ -612,6 +612,68 @@ int ism_findPropertyNameIndex(ism_actionbuf_t * props, int index, ism_field_t *
 }
 
 
+/*
+ * Find all named properties.
+ *
+ * This decodes the properties once so that a number of lookups by name can be
+ * made without scanning the properties for each one.
+ */
+int ism_findPropertyNames(ism_actionbuf_t * props, const char * * names, ism_field_t * fields, int count) {
+    int   otype;
+    int   xtype;
+    int   found = 0;
+    concat_alloc_t action;
+    ism_field_t field;
+    char * fname;
+
+    if (!props || !props->buf)
+        return 0;
+    action = *props;
+    action.pos = 0;
+
+    while (action.pos < action.used) {
+        otype = (uint8_t)action.buf[action.pos++];
+        xtype = FieldTypes[otype];
+        switch (xtype) {
+        case STYPE_Bad:
+            return found;
+        case STYPE_Name:
+        case STYPE_NameLen:
+            fname = (char *)ism_protocol_getNameValue(&action, otype);
+            if (!fname)
+                return found;
+            if (found < count) {
+                names[found] = fname;
+                ism_protocol_getObjectValue(&action, fields+found);
+            } else {
+                ism_protocol_getObjectValue(&action, &field);
+            }
+            found++;
+            break;
+        case STYPE_StrLen:
+            ism_protocol_getStringValue(&action, otype);
+            break;
+        case STYPE_BArray:
+            ism_protocol_getByteArrayValue(&action, &field, otype);
+            break;
+        case STYPE_Map:
+            ism_protocol_getMapValue(&action, &field, otype);
+            break;
+        case STYPE_Xid:
+            ism_protocol_getXidValue(&action, &field);
+            break;
+        case STYPE_User:
+            ism_protocol_getUserValue(&action, &field, otype);
+            break;
+        default:
+            action.pos += FieldLen[otype]-1;
+            break;
+        }
+    }
+    return found;
+}
+
+
 /*
  * Put out a null value.
  */
@@ -1831,7 +1831,6 @@ XAPI void ism_config_autotune(void){
 	int crit,hotrsrv;
 	int numIOP, numSec, numAP, numHATX;
 	cpu_set_t *assignedCPUSet;
-	int maxConn;
 	char assignedCPUMapStr[CPU_SETSIZE]={0}, hotCPUMapStr[CPU_SETSIZE]={0}, hotRsrvCPUMapStr[CPU_SETSIZE]={0};
 
 	int nrcpu = sysconf(_SC_NPROCESSORS_CONF);
@@ -1930,24 +1929,13 @@ XAPI void ism_config_autotune(void){
 	 * MessageSight configuration that should be scaled based on Memory resources
 	 */
 	// we support 4K concurrent connections per GB of allocated memory. double the max connection limit in case of large reconnect event
-	maxConn = ism_config_autotune_setATProp("TcpMaxConnections",(g_ismTotalMemMB/1024)*2*4000);
+	ism_config_autotune_setATProp("TcpMaxConnections",(g_ismTotalMemMB/1024)*2*4000);
 
 	/* Transport and OpenSSL buffer pools*/
 	ism_config_autotune_setATProp("TcpMaxTransportPoolSizeMB",g_ismTotalMemMB/16);
 	ism_config_autotune_setATProp("SslUseBuffersPool", 0);  /* Disable TLS buffer pool by default, pool lock adds too much lock contention, getting much better performance using glibc malloc/free */
     pthread_mutex_unlock(&g_utillock);
 
-    /* Protocol msgid hashmaps sized based on TcpMaxConnections
-     * g_ismTotalMemMB(GB)	MsgId Map Mem(GB)
-     * 16					0.25
-     * 32					0.5
-     * 64					1
-     * 128					2
-     * 256					4
-     * */
-    ism_config_autotune_setATProp("NumMsgIdMaps", MAX(10, (maxConn/1000)));
-    ism_config_autotune_setATProp("MsgIdMapCapacity", 128 * 1024);
-
     /*
      * MessageSight configuration that should be scaled based on Disk resources
      */
@@ -27,6 +27,9 @@ static int  calc_var(ism_field_t * var1, ism_field_t * var2, int op);
 static int  in_hash(ism_field_t * var1, ism_field_t * var2, int op);
 static int  checkACL(ism_field_t * f, const char * extra, ismMessageSelectionLockStrategy_t * lockStrategy);
 static int  topicpart(const char * topic, const char * * part, int which);
+typedef struct ism_selcode_t ism_selcode_t;
+static int  runSelectCode(ism_selcode_t * code, ism_prop_t * props, property_gen_t generator, ism_emsg_t * emsg,
+        ismMessageSelectionLockStrategy_t * lockStrategy);
 
 #define CHECK_LEVEL(n) if (level<(n)) return SELECT_UNKNOWN
 
@@ -68,115 +71,275 @@ XAPI void ism_common_setSelectorDebug(int val) {
 
 
 /*
- * Generate properties from the message
+ * Decoded message properties for a selection cache.
+ * When one message is selected against many rules the named properties are decoded
+ * once and each rule finds its properties in this table.
  */
-static int propgen(ism_prop_t * xprops, ism_emsg_t * emsg, const char * name, ism_field_t * f, void * extra, ismMessageSelectionLockStrategy_t * lockStrategy) {
-    ism_actionbuf_t props = {0};
-    props.buf = (char *)emsg->props;
-    props.len = emsg->proplen;
-    props.used = emsg->proplen;
+#define SELPROPS_MAX 32
+typedef struct {
+    const char * props;                  /* The properties of the cached message       */
+    int          proplen;
+    int          count;                  /* Count of named properties or -1 if not set */
+    const char * name  [SELPROPS_MAX];
+    uint32_t     hash  [SELPROPS_MAX];
+    ism_field_t  field [SELPROPS_MAX];
+} selprops_t;
+static __thread selprops_t selprops = {NULL, 0, -1};
 
-    /*
-     * Check for JMS special properties
-     */
+
+/*
+ * Start a selection cache
+ */
+XAPI void ism_common_startSelectCache(uint8_t areas, ismMessageAreaType_t areatype[areas],
+        size_t areasize[areas], void * areaptr[areas]) {
+    int  i;
+    selprops.props = NULL;
+    selprops.proplen = 0;
+    selprops.count = -1;
+    for (i=0; i<areas; i++) {
+        if (areatype[i] == ismMESSAGE_AREA_PROPERTIES) {
+            selprops.props = (const char *)areaptr[i];
+            selprops.proplen = (int)areasize[i];
+            break;
+        }
+    }
+}
+
+
+/*
+ * End a selection cache
+ */
+XAPI void ism_common_endSelectCache(void) {
+    selprops.props = NULL;
+    selprops.proplen = 0;
+    selprops.count = -1;
+}
+
+
+/*
+ * Hash a property name.
+ * Selection code computes this when it is compiled.
+ */
+static uint32_t selectHash(const char * name) {
+    uint32_t hash = 5381;
+    while (*name)
+        hash = (hash * 33) ^ (uint8_t)*name++;
+    return hash;
+}
+
+
+/*
+ * Find a named property.
+ * The properties of the message in the selection cache are decoded on first use.
+ */
+static int findSelectProperty(ism_actionbuf_t * props, const char * name, uint32_t hash, ism_field_t * f) {
+    int  i;
+    int  count;
+
+    if (selprops.props && selprops.props == props->buf && selprops.proplen == props->used) {
+        if (selprops.count < 0) {
+            selprops.count = ism_findPropertyNames(props, selprops.name, selprops.field, SELPROPS_MAX);
+            count = selprops.count < SELPROPS_MAX ? selprops.count : SELPROPS_MAX;
+            for (i=0; i<count; i++)
+                selprops.hash[i] = selectHash(selprops.name[i]);
+        }
+        count = selprops.count < SELPROPS_MAX ? selprops.count : SELPROPS_MAX;
+        for (i=0; i<count; i++) {
+            if (selprops.hash[i] == hash && !strcmp(selprops.name[i], name)) {
+                *f = selprops.field[i];
+                return 0;
+            }
+        }
+        /* If there are more properties than fit in the table, search for the rest */
+        if (selprops.count <= SELPROPS_MAX) {
+            memset(f, 0, sizeof(ism_field_t));
+            return 1;
+        }
+    }
+    return ism_findPropertyName(props, name, f);
+}
+
+/*
+ * JMS special properties.
+ * Names starting JMS (but not JMSX) are reserved, and are resolved to one of these.
+ */
+enum selspecial_e {
+    SP_None            = 0,     /* Not a special property      */
+    SP_Unknown         = 1,     /* Reserved name which is not known */
+    SP_Topic,
+    SP_ACLCheck,
+    SP_Retain,
+    SP_QoS,
+    SP_PayloadFormat,
+    SP_ContentType,
+    SP_CorrelationID,
+    SP_DeliveryMode,
+    SP_Destination,
+    SP_Expiration,
+    SP_MessageID,
+    SP_Priority,
+    SP_ReplyTo,
+    SP_Redelivered,
+    SP_Type,
+    SP_Timestamp,
+};
+
+
+/*
+ * Resolve a property name to a JMS special property
+ */
+static int specialPropID(const char * name) {
     if (name[0] == 'J' && name[1] == 'M' && name[2] == 'S' && name[3] != 'X') {
         switch (name[3]) {
         case '_':
             switch(name[4]) {
             case 'T':
-                if (!strcmp(name+4, "Topic")) {
-                    int xrc = ism_findPropertyNameIndex(&props, ID_Topic, f);
-                    return xrc;
-                }
+                if (!strcmp(name+4, "Topic"))
+                    return SP_Topic;
                 break;
             case 'A':
-                if (!strcmp(name+4, "ACLCheck")) {
-                    return checkACL(f, (const char *)extra, lockStrategy);
-                }
+                if (!strcmp(name+4, "ACLCheck"))
+                    return SP_ACLCheck;
                 break;
             case 'I':
-                if (!strcmp(name+4, "IBM_Retain")) {
-                    f->type = VT_Integer;
-                    f->val.i = !!(emsg->hdr->Flags&ismMESSAGE_FLAGS_RETAINED);
-                    return 0;
-                }
+                if (!strcmp(name+4, "IBM_Retain"))
+                    return SP_Retain;
                 break;
             case 'Q':
-                if (!strcmp(name+4, "QoS")) {
-                    f->type = VT_Integer;
-                    f->val.i = emsg->hdr->Reliability;
-                    return 0;
-                }
+                if (!strcmp(name+4, "QoS"))
+                    return SP_QoS;
                 break;
             case 'P':
-                if (!strcmp(name+4, "PayloadFormat")) {
-                    f->type = VT_Integer;
-                    f->val.i = emsg->hdr->MessageType == MTYPE_MQTT_Text ||
-                               emsg->hdr->MessageType == MTYPE_TextMessage ? 1 : 0;
-                    return 0;
-                }
+                if (!strcmp(name+4, "PayloadFormat"))
+                    return SP_PayloadFormat;
                 break;
             case 'C':
-                if (!strcmp(name+4, "ContentType")) {
-                    return ism_findPropertyNameIndex(&props, ID_ContentType, f);
-                }
+                if (!strcmp(name+4, "ContentType"))
+                    return SP_ContentType;
                 break;
             }
+            break;
+
         case 'C':
             if (!strcmp(name, "JMSCorrelationID"))
-                return ism_findPropertyNameIndex(&props, ID_CorrID, f);
+                return SP_CorrelationID;
             break;
 
         case 'D':
-            if (!strcmp(name, "JMSDeliveryMode")) {
-                f->type  = VT_String;
-                f->val.s = emsg->hdr->Persistence == ismMESSAGE_PERSISTENCE_PERSISTENT ?
-                            "PERSISTENT" : "NON_PERSISTENT";
-                return 0;
-            }
+            if (!strcmp(name, "JMSDeliveryMode"))
+                return SP_DeliveryMode;
             if (!strcmp(name, "JMSDestination"))
-                return ism_findPropertyNameIndex(&props, ID_Topic, f);
+                return SP_Destination;
             break;
 
         case 'E':
             if (!strcmp(name, "JMSExpiration"))
-                 return ism_findPropertyNameIndex(&props, ID_Expire, f);
+                return SP_Expiration;
             break;
 
         case 'M':
             if (!strcmp(name, "JMSMessageID"))
-                return ism_findPropertyNameIndex(&props, ID_MsgID, f);
+                return SP_MessageID;
             break;
 
         case 'P':
-            if (!strcmp(name, "JMSPriority")) {
-                f->type  = VT_Integer;
-                f->val.i = emsg->hdr->Priority;
-                return 0;
-            }
+            if (!strcmp(name, "JMSPriority"))
+                return SP_Priority;
             break;
 
         case 'R':
             if (!strcmp(name, "JMSReplyTo"))
-                 return ism_findPropertyNameIndex(&props, ID_ReplyToT, f);
-            if (!strcmp(name, "JMSRedelivered")) {
-                f->type  = VT_Boolean;
-                f->val.i = emsg->hdr->RedeliveryCount != 0;
-                return 0;
-            }
+                return SP_ReplyTo;
+            if (!strcmp(name, "JMSRedelivered"))
+                return SP_Redelivered;
             break;
 
         case 'T':
             if (!strcmp(name, "JMSType"))
-                return ism_findPropertyNameIndex(&props, ID_JMSType, f);
+                return SP_Type;
             if (!strcmp(name, "JMSTimestamp"))
-                return ism_findPropertyNameIndex(&props, ID_Timestamp, f);
+                return SP_Timestamp;
             break;
         }
-        f->type = VT_Null;
-        return 1;
+        return SP_Unknown;
+    }
+    return SP_None;
+}
+
+
+/*
+ * Generate a JMS special property from the message
+ */
+static int specialProp(ism_actionbuf_t * props, ism_emsg_t * emsg, int which, ism_field_t * f, void * extra,
+        ismMessageSelectionLockStrategy_t * lockStrategy) {
+    switch (which) {
+    case SP_Topic:
+    case SP_Destination:
+        return ism_findPropertyNameIndex(props, ID_Topic, f);
+    case SP_ACLCheck:
+        return checkACL(f, (const char *)extra, lockStrategy);
+    case SP_Retain:
+        f->type = VT_Integer;
+        f->val.i = !!(emsg->hdr->Flags&ismMESSAGE_FLAGS_RETAINED);
+        return 0;
+    case SP_QoS:
+        f->type = VT_Integer;
+        f->val.i = emsg->hdr->Reliability;
+        return 0;
+    case SP_PayloadFormat:
+        f->type = VT_Integer;
+        f->val.i = emsg->hdr->MessageType == MTYPE_MQTT_Text ||
+                   emsg->hdr->MessageType == MTYPE_TextMessage ? 1 : 0;
+        return 0;
+    case SP_ContentType:
+        return ism_findPropertyNameIndex(props, ID_ContentType, f);
+    case SP_CorrelationID:
+        return ism_findPropertyNameIndex(props, ID_CorrID, f);
+    case SP_DeliveryMode:
+        f->type  = VT_String;
+        f->val.s = emsg->hdr->Persistence == ismMESSAGE_PERSISTENCE_PERSISTENT ?
+                    "PERSISTENT" : "NON_PERSISTENT";
+        return 0;
+    case SP_Expiration:
+        return ism_findPropertyNameIndex(props, ID_Expire, f);
+    case SP_MessageID:
+        return ism_findPropertyNameIndex(props, ID_MsgID, f);
+    case SP_Priority:
+        f->type  = VT_Integer;
+        f->val.i = emsg->hdr->Priority;
+        return 0;
+    case SP_ReplyTo:
+        return ism_findPropertyNameIndex(props, ID_ReplyToT, f);
+    case SP_Redelivered:
+        f->type  = VT_Boolean;
+        f->val.i = emsg->hdr->RedeliveryCount != 0;
+        return 0;
+    case SP_Type:
+        return ism_findPropertyNameIndex(props, ID_JMSType, f);
+    case SP_Timestamp:
+        return ism_findPropertyNameIndex(props, ID_Timestamp, f);
     }
-    ism_findPropertyName(&props, name, f);
+    f->type = VT_Null;
+    return 1;
+}
+
+
+/*
+ * Generate properties from the message
+ */
+static int propgen(ism_prop_t * xprops, ism_emsg_t * emsg, const char * name, ism_field_t * f, void * extra, ismMessageSelectionLockStrategy_t * lockStrategy) {
+    ism_actionbuf_t props = {0};
+    props.buf = (char *)emsg->props;
+    props.len = emsg->proplen;
+    props.used = emsg->proplen;
+
+    /*
+     * Check for JMS special properties
+     */
+    int which = specialPropID(name);
+    if (which)
+        return specialProp(&props, emsg, which, f, extra, lockStrategy);
+    findSelectProperty(&props, name, selectHash(name), f);
     return 0;
 }
 
@@ -225,6 +388,113 @@ int ism_common_selectMessage(
 }
 
 
+/*
+ * Check if one top level AND term of a rule is an index key.
+ * The term is either Var String Compare(EQ), String Var Compare(EQ), or Var In.
+ */
+static int selectKeyTerm(ismRule_t * * term, int ops, const char * want, const char * * name,
+        const char * * values, int * lens, int max) {
+    const char * vname = NULL;
+    const char * value = NULL;
+    int count = 0;
+
+    if (ops == 3 && term[2]->op == SELRULE_Compare && term[2]->kind == CMP_EQ) {
+        if (term[0]->op == SELRULE_Var && term[1]->op == SELRULE_String) {
+            vname = (const char *)(term[0]+1);
+            value = (const char *)(term[1]+1);
+        } else if (term[0]->op == SELRULE_String && term[1]->op == SELRULE_Var) {
+            vname = (const char *)(term[1]+1);
+            value = (const char *)(term[0]+1);
+        }
+        if (vname && max > 0) {
+            values[0] = value;
+            lens[0] = (int)strlen(value);
+            count = 1;
+        }
+    } else if (ops == 2 && term[0]->op == SELRULE_Var && term[1]->op == SELRULE_In && term[1]->kind <= max) {
+        const uint8_t * match = (const uint8_t *)(term[1]+1);
+        vname = (const char *)(term[0]+1);
+        for (count = 0; count < term[1]->kind; count++) {
+            lens[count] = *match++;
+            values[count] = (const char *)match;
+            match += lens[count];
+        }
+    }
+    if (!count || !strncmp(vname, "JMS", 3) || (want && strcmp(vname, want)))
+        return 0;
+    *name = vname;
+    return count;
+}
+
+
+/*
+ * Get the index key of a selection rule.
+ *
+ * The top level terms of the rule are separated by AND operators at level 0.
+ * If there is an OR at level 0 the rule has no index key.
+ */
+int ism_common_getSelectKey(ismRule_t * rule, const char * want, const char * * name,
+        const char * * values, int * lens, int max) {
+    char *      rp = (char *)rule;
+    ismRule_t * term [3];
+    int         ops = 0;
+    int         count = 0;
+    uint16_t    rlen;
+
+    if (!rule)
+        return 0;
+    for (;;) {
+        rule = (ismRule_t *)rp;
+        memcpy(&rlen, &rule->len, 2);
+        if (rule->kind == 0 && (rule->op == SELRULE_And || rule->op == SELRULE_End)) {
+            if (!count)
+                count = selectKeyTerm(term, ops, want, name, values, lens, max);
+            if (rule->op == SELRULE_End)
+                return count;
+            ops = 0;
+        } else if (rule->op == SELRULE_Or && rule->kind == 0) {
+            return 0;
+        } else if (rule->op != SELRULE_Internal) {
+            if (ops < 3)
+                term[ops] = rule;
+            ops++;
+        }
+        if (rlen < sizeof(ismRule_t))
+            return 0;
+        rp += rlen;
+    }
+}
+
+
+/*
+ * Get a message property for a selection index
+ */
+int ism_common_getSelectProperty(
+        ismMessageHeader_t *       hdr,
+        uint8_t                    areas,
+        ismMessageAreaType_t       areatype[areas],
+        size_t                     areasize[areas],
+        void *                     areaptr[areas],
+        const char *               name,
+        ism_field_t *              field) {
+    ism_actionbuf_t props = {0};
+    int  i;
+
+    for (i=0; i<areas; i++) {
+        if (areatype[i] == ismMESSAGE_AREA_PROPERTIES) {
+            props.buf = (char *)areaptr[i];
+            props.len = props.used = (int)areasize[i];
+            break;
+        }
+    }
+    if (!props.buf) {
+        memset(field, 0, sizeof(ism_field_t));
+        return 1;
+    }
+    return findSelectProperty(&props, name, selectHash(name), field);
+}
+
+
 /*
  * Do a generic match using an asterisk wildcard which matches 0 or more characters.
  *
@@ -919,6 +1189,8 @@ int ism_common_filter(ismRule_t * rule, ism_prop_t * props, property_gen_t gener
 
     if (!rule || rule->op == SELRULE_End)
         return 0;
+    if (rule->op == SELRULE_Code)
+        return runSelectCode((ism_selcode_t *)rule, props, generator, emsg, lockStrategy);
 
     next = 0;
     for (;;) {
@@ -1240,6 +1512,700 @@ int ism_common_filter(ismRule_t * rule, ism_prop_t * props, property_gen_t gener
 }
 
 
+/*
+ * Selection code.
+ *
+ * A selection rule can be compiled a second time into an array of instructions each of
+ * which has the function which runs it.  The instructions are run by calling each function
+ * which returns the next instruction to run, or NULL at the end.  This removes the decode
+ * and switch of the rule, and lets the work which depends only on the rule be done once:
+ * constant operands are folded, property names are hashed and JMS special properties are
+ * resolved, the short circuit target of AND and OR is found, and the common comparison of
+ * a property to a constant is done by a single instruction.
+ *
+ * The code contains a copy of the rule so that the operands of IN, LIKE, and ACLCheck
+ * and the string constants do not depend on the original rule.
+ */
+typedef struct selctx_t  selctx_t;
+typedef struct selinst_t selinst_t;
+typedef selinst_t * (* selop_f)(selctx_t * ctx, selinst_t * ip);
+
+struct selinst_t {
+    selop_f       op;           /* The function which runs the instruction   */
+    ismRule_t *   rule;         /* The source rule in the copy               */
+    const char *  name;         /* The property name                         */
+    selinst_t *   jump;         /* The short circuit target of AND and OR    */
+    uint32_t      hash;         /* The hash of the property name             */
+    uint8_t       which;        /* The JMS special property                  */
+    uint8_t       kind;         /* The kind from the rule                    */
+    uint8_t       label;        /* This is the target of a jump              */
+    uint8_t       resv;
+    ism_field_t   val;          /* The constant value                        */
+};
+
+struct ism_selcode_t {
+    ismRule_t     hdr;          /* op=SELRULE_Code                           */
+    int           count;        /* Count of instructions                     */
+    int           depth;        /* Maximum depth of the stack                */
+    int           topicparts;   /* Count of topic part instructions          */
+    int           rulelen;      /* Length of the copy of the rule            */
+    ismRule_t *   rule;         /* The copy of the rule                      */
+    selinst_t     inst [];
+};
+
+struct selctx_t {
+    ism_field_t *  sp;          /* The next free stack entry                 */
+    ism_field_t *  stack;
+    ism_prop_t *   props;
+    property_gen_t generator;
+    ism_emsg_t *   emsg;
+    ismMessageSelectionLockStrategy_t * lockStrategy;
+    ism_actionbuf_t actbuf;     /* The message properties for propgen        */
+    const char *   topic;
+    int            topicset;
+    char *         partbuf;     /* Space for topic parts                     */
+    int            result;
+};
+
+
+/*
+ * Get the topic for the topic instructions
+ */
+static const char * selTopic(selctx_t * ctx) {
+    if (!ctx->topicset) {
+        ctx->topicset = 1;
+        if (ctx->emsg)
+            ctx->topic = ctx->emsg->topic;
+        if (!ctx->topic && ctx->generator) {
+            ism_field_t tf;
+            ctx->generator(ctx->props, ctx->emsg, "JMS_Topic", &tf, NULL, ctx->lockStrategy);
+            if (tf.type == VT_String)
+                ctx->topic = tf.val.s;
+        }
+    }
+    return ctx->topic;
+}
+
+
+/*
+ * Load a property.
+ * When the generator is the one for messages, the property is found directly.
+ */
+static inline void selVar(selctx_t * ctx, selinst_t * ip, ism_field_t * f) {
+    if (ctx->generator == propgen) {
+        if (ip->which)
+            specialProp(&ctx->actbuf, ctx->emsg, ip->which, f, NULL, ctx->lockStrategy);
+        else
+            findSelectProperty(&ctx->actbuf, ip->name, ip->hash, f);
+    } else if (ctx->generator) {
+        ctx->generator(ctx->props, ctx->emsg, ip->name, f, NULL, ctx->lockStrategy);
+    } else {
+        ism_common_getProperty(ctx->props, ip->name, f);
+    }
+}
+
+/* End of rule */
+static selinst_t * selop_End(selctx_t * ctx, selinst_t * ip) {
+    ctx->result = getResult(ctx->stack);
+    return NULL;
+}
+
+/* Load a constant */
+static selinst_t * selop_Const(selctx_t * ctx, selinst_t * ip) {
+    *ctx->sp++ = ip->val;
+    return ip+1;
+}
+
+/* Load the QoS */
+static selinst_t * selop_QoS(selctx_t * ctx, selinst_t * ip) {
+    ctx->sp->type = VT_Integer;
+    ctx->sp->val.i = ctx->emsg ? ctx->emsg->hdr->Reliability : 0;
+    ctx->sp++;
+    return ip+1;
+}
+
+/* Load a property */
+static selinst_t * selop_Var(selctx_t * ctx, selinst_t * ip) {
+    selVar(ctx, ip, ctx->sp);
+    ctx->sp++;
+    return ip+1;
+}
+
+/* Compare a property to a constant */
+static selinst_t * selop_VarCompare(selctx_t * ctx, selinst_t * ip) {
+    ism_field_t * f = ctx->sp;
+    ism_field_t cval;
+    int result;
+    selVar(ctx, ip, f);
+    if (f->type == VT_String && ip->val.type == VT_String && f->val.s) {
+        int cmp = strcmp(f->val.s, ip->val.val.s);
+        switch (ip->kind) {
+        case CMP_EQ: result = !(cmp == 0);  break;
+        case CMP_NE: result = !(cmp != 0);  break;
+        case CMP_GT: result = !(cmp > 0);   break;
+        case CMP_LT: result = !(cmp < 0);   break;
+        case CMP_GE: result = !(cmp >= 0);  break;
+        default:     result = !(cmp <= 0);  break;
+        }
+    } else if (f->type == VT_Integer && ip->val.type == VT_Integer) {
+        int32_t v = f->val.i;
+        int32_t c = ip->val.val.i;
+        switch (ip->kind) {
+        case CMP_EQ: result = !(v == c);  break;
+        case CMP_NE: result = !(v != c);  break;
+        case CMP_GT: result = !(v > c);   break;
+        case CMP_LT: result = !(v < c);   break;
+        case CMP_GE: result = !(v >= c);  break;
+        default:     result = !(v <= c);  break;
+        }
+    } else {
+        cval = ip->val;
+        result = compare_var(ctx->props, f, &cval, ip->kind);
+    }
+    setResult(f, result);
+    ctx->sp++;
+    return ip+1;
+}
+
+/* Check a property is in a set of strings */
+static selinst_t * selop_VarIn(selctx_t * ctx, selinst_t * ip) {
+    ism_field_t * f = ctx->sp;
+    selVar(ctx, ip, f);
+    setResult(f, selectIn(f, ip->rule));
+    ctx->sp++;
+    return ip+1;
+}
+
+/* Compare */
+static selinst_t * selop_Compare(selctx_t * ctx, selinst_t * ip) {
+    ism_field_t * sp = ctx->sp;
+    int result = compare_var(ctx->props, sp-2, sp-1, ip->kind);
+    setResult(sp-2, result);
+    ctx->sp--;
+    return ip+1;
+}
+
+/* IN */
+static selinst_t * selop_In(selctx_t * ctx, selinst_t * ip) {
+    setResult(ctx->sp-1, selectIn(ctx->sp-1, ip->rule));
+    return ip+1;
+}
+
+/* LIKE */
+static selinst_t * selop_Like(selctx_t * ctx, selinst_t * ip) {
+    setResult(ctx->sp-1, selectLike(ctx->sp-1, ip->rule));
+    return ip+1;
+}
+
+/* BETWEEN */
+static selinst_t * selop_Between(selctx_t * ctx, selinst_t * ip) {
+    ism_field_t * sp = ctx->sp;
+    int result = compare_var(ctx->props, sp-3, sp-2, CMP_GE);
+    if (result == SELECT_TRUE)
+        result = compare_var(ctx->props, sp-3, sp-1, CMP_LE);
+    setResult(sp-3, result);
+    ctx->sp -= 2;
+    return ip+1;
+}
+
+/* IS [NOT] NULL, TRUE, FALSE */
+static selinst_t * selop_Is(selctx_t * ctx, selinst_t * ip) {
+    ism_field_t * var = ctx->sp-1;
+    int result = SELECT_TRUE;
+    switch (ip->kind & 0x3F) {
+    case TT_Null:
+        switch (var->type) {
+        case VT_Null:       result = SELECT_TRUE;                       break;
+        case VT_String:
+        case VT_ByteArray:  result = (var->val.s && *var->val.s);       break;
+        default:            result = SELECT_FALSE;                      break;
+        }
+        break;
+    case TT_True:
+        result = var->type == VT_Boolean ? !var->val.i : SELECT_FALSE;
+        break;
+    case TT_False:
+        result = var->type == VT_Boolean ? !!var->val.i : SELECT_FALSE;
+        break;
+    }
+    if (ip->kind & 0x40)
+        result = !result;
+    setResult(var, result);
+    return ip+1;
+}
+
+/* AND.  If the left side is not true skip the right side */
+static selinst_t * selop_And(selctx_t * ctx, selinst_t * ip) {
+    if (getResult(ctx->sp-1) != SELECT_TRUE)
+        return ip->jump;
+    ctx->sp--;
+    return ip+1;
+}
+
+/* OR.  If the left side is true skip the right side */
+static selinst_t * selop_Or(selctx_t * ctx, selinst_t * ip) {
+    if (getResult(ctx->sp-1) == SELECT_TRUE)
+        return ip->jump;
+    ctx->sp--;
+    return ip+1;
+}
+
+/* Unary minus */
+static selinst_t * selop_Negative(selctx_t * ctx, selinst_t * ip) {
+    ism_field_t * var = ctx->sp-1;
+    switch (var->type) {
+    case VT_Integer:    var->val.i = -var->val.i;   break;
+    case VT_Byte:       var->val.i = (int)(int8_t)-var->val.i;    break;
+    case VT_Short:      var->val.i = (int)(int16_t)-var->val.i;   break;
+    case VT_Long:       var->val.l = -var->val.l;   break;
+    case VT_Float:      var->val.f = -var->val.f;   break;
+    case VT_Double:     var->val.d = -var->val.d;   break;
+    default:
+        var->type = VT_Null;
+        break;
+    };
+    return ip+1;
+}
+
+/* NOT */
+static selinst_t * selop_Not(selctx_t * ctx, selinst_t * ip) {
+    ism_field_t * var = ctx->sp-1;
+    if (var->type == VT_Boolean)
+        var->val.i = !var->val.i;
+    else
+        var->type = VT_Null;
+    return ip+1;
+}
+
+/* Numeric operator */
+static selinst_t * selop_Calc(selctx_t * ctx, selinst_t * ip) {
+    calc_var(ctx->sp-2, ctx->sp-1, ip->kind);
+    ctx->sp--;
+    return ip+1;
+}
+
+/* ACL check */
+static selinst_t * selop_ACLCheck(selctx_t * ctx, selinst_t * ip) {
+    int result = selectACLCheck(ctx->sp-1, ip->rule, ctx->props, ctx->generator, ctx->emsg, ctx->lockStrategy);
+    setResult(ctx->sp-1, result);
+    return ip+1;
+}
+
+/* Hash check */
+static selinst_t * selop_InHash(selctx_t * ctx, selinst_t * ip) {
+    int result = in_hash(ctx->sp-2, ctx->sp-1, ip->kind);
+    ctx->sp--;
+    setResult(ctx->sp-1, result);
+    return ip+1;
+}
+
+/* Load the topic */
+static selinst_t * selop_Topic(selctx_t * ctx, selinst_t * ip) {
+    const char * topic = selTopic(ctx);
+    ctx->sp->type = topic ? VT_String : VT_Null;
+    ctx->sp->val.s = (char *)topic;
+    ctx->sp++;
+    return ip+1;
+}
+
+/* Load a part of the topic */
+static selinst_t * selop_TopicPart(selctx_t * ctx, selinst_t * ip) {
+    const char * pp;
+    int pplen = topicpart(selTopic(ctx), &pp, ip->kind);
+    if (pp) {
+        ctx->sp->val.s = ctx->partbuf;
+        memcpy(ctx->partbuf, pp, pplen);
+        ctx->partbuf[pplen] = 0;
+        ctx->partbuf += pplen+1;
+        ctx->sp->type = VT_String;
+    } else {
+        ctx->sp->type = VT_Null;
+    }
+    ctx->sp++;
+    return ip+1;
+}
+
+
+/*
+ * Run selection code
+ */
+static int runSelectCode(ism_selcode_t * code, ism_prop_t * props, property_gen_t generator, ism_emsg_t * emsg,
+        ismMessageSelectionLockStrategy_t * lockStrategy) {
+    selctx_t ctx;
+    selinst_t * ip;
+
+    ctx.stack = ctx.sp = alloca((code->depth+1) * sizeof(ism_field_t));
+    ctx.props = props;
+    ctx.generator = generator;
+    ctx.emsg = emsg;
+    ctx.lockStrategy = lockStrategy;
+    ctx.topic = NULL;
+    ctx.topicset = 0;
+    ctx.partbuf = NULL;
+    ctx.result = SELECT_TRUE;
+    if (generator == propgen) {
+        memset(&ctx.actbuf, 0, sizeof ctx.actbuf);
+        ctx.actbuf.buf = (char *)emsg->props;
+        ctx.actbuf.len = ctx.actbuf.used = emsg->proplen;
+    }
+
+    /* Each topic part is no longer than the topic */
+    if (code->topicparts) {
+        const char * topic = selTopic(&ctx);
+        if (!topic)
+            topic = "";
+        ctx.partbuf = alloca(code->topicparts * (strlen(topic)+1));
+    }
+
+    ip = code->inst;
+    while (ip)
+        ip = ip->op(&ctx, ip);
+    return ctx.result;
+}
+
+
+/*
+ * Return the stack effect of a rule, and the depth it requires
+ */
+static int selectStackUse(ismRule_t * rule, int * need) {
+    *need = 0;
+    switch (rule->op) {
+    case SELRULE_Int:
+    case SELRULE_Boolean:
+    case SELRULE_Long:
+    case SELRULE_Float:
+    case SELRULE_Double:
+    case SELRULE_String:
+    case SELRULE_SmallInt:
+    case SELRULE_QoS:
+    case SELRULE_Var:
+    case SELRULE_Topic:
+    case SELRULE_TopicPart:
+        return 1;
+    case SELRULE_In:
+    case SELRULE_Like:
+    case SELRULE_Negative:
+    case SELRULE_Not:
+    case SELRULE_Is:
+    case SELRULE_ACLCheck:
+        *need = 1;
+        return 0;
+    case SELRULE_And:
+    case SELRULE_Or:
+        *need = 1;
+        return -1;
+    case SELRULE_Compare:
+    case SELRULE_Calc:
+    case SELRULE_InHash:
+        *need = 2;
+        return -1;
+    case SELRULE_Between:
+        *need = 3;
+        return -2;
+    }
+    return 0;
+}
+
+
+/*
+ * Generate the instruction for a constant.
+ * @return 1 if the rule is a constant
+ */
+static int selectConst(selinst_t * inst, ismRule_t * rule) {
+    switch (rule->op) {
+    case SELRULE_Int:
+        inst->val.type = VT_Integer;
+        inst->val.val.i = *(uint32_t *)(rule+1);
+        break;
+    case SELRULE_Boolean:
+        inst->val.type = (int8_t)rule->kind < 0 ? VT_Null : VT_Boolean;
+        inst->val.val.i = (int8_t)rule->kind;
+        break;
+    case SELRULE_Long:
+        inst->val.type = VT_Long;
+        memcpy(&inst->val.val.l, rule+1, sizeof(int64_t));
+        break;
+    case SELRULE_Float:
+        inst->val.type = VT_Float;
+        memcpy(&inst->val.val.f, rule+1, sizeof(float));
+        break;
+    case SELRULE_Double:
+        inst->val.type = VT_Double;
+        memcpy(&inst->val.val.d, rule+1, sizeof(double));
+        break;
+    case SELRULE_String:
+        inst->val.type = VT_String;
+        inst->val.val.s = (char *)(rule+1);
+        break;
+    case SELRULE_SmallInt:
+        inst->val.type = VT_Integer;
+        inst->val.val.i = rule->kind;
+        break;
+    default:
+        return 0;
+    }
+    inst->op = selop_Const;
+    return 1;
+}
+
+
+/*
+ * Check if two constants can be folded.
+ * Integer division by zero is left to run time.
+ */
+static int canFold(selinst_t * inst1, selinst_t * inst2, int op) {
+    if (inst1->op != selop_Const || inst2->op != selop_Const || inst2->label)
+        return 0;
+    if (op == '/') {
+        switch (inst2->val.type) {
+        case VT_Byte:
+        case VT_Short:
+        case VT_Integer:  return inst2->val.val.i != 0;
+        case VT_Long:     return inst2->val.val.l != 0;
+        default:          break;
+        }
+    }
+    return 1;
+}
+
+
+/*
+ * Compile a selection rule to selection code
+ */
+int ism_common_compileSelectCode(ismRule_t * * xcode, ismRule_t * xrule) {
+    ism_selcode_t * code;
+    ismRule_t * rule;
+    ismRule_t * * rules;
+    int * ruleinst;
+    char * rp;
+    uint16_t rlen;
+    int  rulelen = 0;
+    int  count = 0;
+    int  ninst = 0;
+    int  level = 0;
+    int  depth = 0;
+    int  label = 0;
+    int  i;
+    int  j;
+
+    *xcode = NULL;
+    if (!xrule || xrule->op == SELRULE_End || xrule->op == SELRULE_Code)
+        return ISMRC_ArgNotValid;
+
+    /*
+     * Find the length of the rule and check the stack use.
+     * The rule from the compiler always ends with an End of level 0.
+     */
+    rp = (char *)xrule;
+    for (;;) {
+        int need;
+        rule = (ismRule_t *)rp;
+        memcpy(&rlen, &rule->len, 2);
+        if (rlen < sizeof(ismRule_t))
+            return ISMRC_ArgNotValid;
+        switch (rule->op) {
+        case SELRULE_End:
+        case SELRULE_Begin:
+        case SELRULE_Internal:
+        case SELRULE_Int:
+        case SELRULE_Boolean:
+        case SELRULE_Long:
+        case SELRULE_Float:
+        case SELRULE_Double:
+        case SELRULE_String:
+        case SELRULE_SmallInt:
+        case SELRULE_QoS:
+        case SELRULE_Var:
+        case SELRULE_Topic:
+        case SELRULE_TopicPart:
+        case SELRULE_In:
+        case SELRULE_Like:
+        case SELRULE_Negative:
+        case SELRULE_Not:
+        case SELRULE_Is:
+        case SELRULE_ACLCheck:
+        case SELRULE_And:
+        case SELRULE_Or:
+        case SELRULE_Compare:
+        case SELRULE_Calc:
+        case SELRULE_InHash:
+        case SELRULE_Between:
+            break;
+        default:
+            return ISMRC_ArgNotValid;
+        }
+        int effect = selectStackUse(rule, &need);
+        if (level < need)
+            return ISMRC_ArgNotValid;
+        level += effect;
+        if (level > depth)
+            depth = level;
+        rulelen += rlen;
+        count++;
+        if (rule->op == SELRULE_End && rule->kind == 0)
+            break;
+        rp += rlen;
+    }
+
+    /*
+     * Allocate the code with the work areas and the copy of the rule following the instructions
+     */
+    code = ism_common_calloc(ISM_MEM_PROBE(ism_memory_utils_selector,119), 1,
+            sizeof(ism_selcode_t) + count*sizeof(selinst_t) + rulelen + count*(sizeof(ismRule_t *)+sizeof(int)));
+    if (!code)
+        return ISMRC_AllocateError;
+    rules = (ismRule_t * *)(code->inst + count);
+    ruleinst = (int *)(rules + count);
+    code->rule = (ismRule_t *)(ruleinst + count);
+    memcpy(code->rule, xrule, rulelen);
+    code->hdr.op = SELRULE_Code;
+    code->depth = depth;
+    code->rulelen = rulelen;
+
+    rp = (char *)code->rule;
+    for (i=0; i<count; i++) {
+        rules[i] = (ismRule_t *)rp;
+        memcpy(&rlen, &rules[i]->len, 2);
+        rp += rlen;
+    }
+
+    /*
+     * Generate the instructions
+     */
+    for (i=0; i<count; i++) {
+        selinst_t * inst = code->inst + ninst;
+        rule = rules[i];
+        ruleinst[i] = ninst;
+        inst->rule = rule;
+        inst->kind = rule->kind;
+        switch (rule->op) {
+        /* The end of a level is the target of a jump but needs no instruction */
+        case SELRULE_End:
+            if (rule->kind) {
+                label = 1;
+                continue;
+            }
+            inst->op = selop_End;
+            break;
+        case SELRULE_Begin:
+        case SELRULE_Internal:
+            continue;
+
+        case SELRULE_Int:
+        case SELRULE_Boolean:
+        case SELRULE_Long:
+        case SELRULE_Float:
+        case SELRULE_Double:
+        case SELRULE_String:
+        case SELRULE_SmallInt:
+            selectConst(inst, rule);
+            break;
+        case SELRULE_QoS:
+            inst->op = selop_QoS;
+            break;
+        case SELRULE_Topic:
+            inst->op = selop_Topic;
+            break;
+        case SELRULE_TopicPart:
+            inst->op = selop_TopicPart;
+            code->topicparts++;
+            break;
+
+        /*
+         * Resolve the property name.  A property compared to a constant or checked
+         * against a set of values is done by one instruction.
+         */
+        case SELRULE_Var:
+            inst->op = selop_Var;
+            inst->name = (const char *)(rule+1);
+            inst->hash = selectHash(inst->name);
+            inst->which = specialPropID(inst->name);
+            if (i+2 < count && rules[i+2]->op == SELRULE_Compare && selectConst(inst, rules[i+1])) {
+                ruleinst[++i] = ninst;
+                ruleinst[++i] = ninst;
+                inst->kind = rules[i]->kind;
+                inst->op = selop_VarCompare;
+            } else if (i+1 < count && rules[i+1]->op == SELRULE_In) {
+                ruleinst[++i] = ninst;
+                inst->rule = rules[i];
+                inst->op = selop_VarIn;
+            }
+            break;
+
+        case SELRULE_In:        inst->op = selop_In;        break;
+        case SELRULE_Like:      inst->op = selop_Like;      break;
+        case SELRULE_Is:        inst->op = selop_Is;        break;
+        case SELRULE_ACLCheck:  inst->op = selop_ACLCheck;  break;
+        case SELRULE_And:       inst->op = selop_And;       break;
+        case SELRULE_Or:        inst->op = selop_Or;        break;
+        case SELRULE_Compare:   inst->op = selop_Compare;   break;
+        case SELRULE_InHash:    inst->op = selop_InHash;    break;
+        case SELRULE_Between:   inst->op = selop_Between;   break;
+
+        /*
+         * Fold the constant operators
+         */
+        case SELRULE_Negative:
+        case SELRULE_Not:
+            inst->op = rule->op == SELRULE_Not ? selop_Not : selop_Negative;
+            if (ninst > 0 && inst[-1].op == selop_Const && !label) {
+                selctx_t ctx = {0};
+                ism_field_t f = inst[-1].val;
+                ctx.sp = &f + 1;
+                inst->op(&ctx, inst);
+                inst[-1].val = f;
+                memset(inst, 0, sizeof(selinst_t));
+                continue;
+            }
+            break;
+
+        case SELRULE_Calc:
+            inst->op = selop_Calc;
+            if (ninst > 1 && !label && canFold(inst-2, inst-1, rule->kind)) {
+                calc_var(&inst[-2].val, &inst[-1].val, rule->kind);
+                memset(inst-1, 0, 2*sizeof(selinst_t));
+                ninst--;
+                continue;
+            }
+            break;
+        }
+        inst->label = label;
+        label = 0;
+        ninst++;
+    }
+    code->count = ninst;
+
+    /*
+     * Set the jump targets.  AND and OR skip to the end of their level.
+     */
+    for (i=0; i<count; i++) {
+        rule = rules[i];
+        if (rule->op == SELRULE_And || rule->op == SELRULE_Or) {
+            for (j=i+1; j<count; j++) {
+                if (rules[j]->op == SELRULE_End && rules[j]->kind <= rule->kind)
+                    break;
+            }
+            if (j >= count || ruleinst[j] >= ninst) {
+                ism_common_free(ism_memory_utils_selector, code);
+                return ISMRC_ArgNotValid;
+            }
+            code->inst[ruleinst[i]].jump = code->inst + ruleinst[j];
+        }
+    }
+    *xcode = (ismRule_t *)code;
+    return 0;
+}
+
+
+/*
+ * Free selection code
+ */
+void ism_common_freeSelectCode(ismRule_t * code) {
+    if (code && code->op == SELRULE_Code)
+        ism_common_free(ism_memory_utils_selector, code);
+}
+
+
 /*
  * Return a part of a topic
  */
@@ -2743,6 +2743,32 @@ char * ism_common_allocAllocBufferOnHeap(concat_alloc_t * buf, int len)
 
 }
 
+/*
+ * Make room for more data in an allocation buffer.
+ * Unlike ism_common_allocAllocBuffer this does not round up the size.
+ */
+int ism_common_allocBufferReserve(concat_alloc_t * buf, int len) {
+    int newsize = buf->used + len + 7;
+    if (len < 0 || newsize < 0)
+        return ISMRC_ArgNotValid;
+    if (newsize > buf->len) {
+        char * tmp;
+        if (buf->inheap) {
+            tmp = ism_common_realloc(ISM_MEM_PROBE(ism_memory_alloc_buffer,6),buf->buf, newsize);
+        } else {
+            tmp = ism_common_malloc(ISM_MEM_PROBE(ism_memory_alloc_buffer,7),newsize);
+            if (tmp && buf->used)
+                memcpy(tmp, buf->buf, buf->used > buf->len ? buf->len : buf->used);
+        }
+        if (!tmp)
+            return ISMRC_AllocateError;
+        buf->buf = tmp;
+        buf->inheap = 1;
+        buf->len = newsize;
+    }
+    return 0;
+}
+
 /*
  * Allocate space in an allocation buffer
  */
@@ -15,6 +15,9 @@
 #include <ismjson.h>
 #include <imacontent.h>
 #include <limits.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 /*
  * Tokens returned by the JSON tokenizer
@@ -54,9 +57,10 @@ static int jsonToken(ism_json_t * jobj, char * * data);
 static int jsonKeyword(ism_json_t * jobj, int otype, const char * match, int len);
 static int jsonString(ism_json_t * jobj);
 static int jsonNumber(ism_json_t * jobj);
-static int jsonExtra(const char * str);
 static int jsonExtraLen(const char * str, int len);
 static void jsonEscape(char * to, const char * from, int len);
+static int jsonPlainLen(const char * str, int len);
+static int jsonNoEscapeLen(const char * str, int len);
 
 /*
  * Check if this is JSON.
@@ -534,6 +538,91 @@ static int hexValue(char ch) {
 }
 
 
+/*
+ * Bytes which end a run of plain string bytes: the double quote, backslash, control
+ * characters, and bytes which are not ASCII
+ */
+#define JSON_ONES   0x0101010101010101ULL
+#define JSON_HIGH   0x8080808080808080ULL
+#define JSON_ZERO(w) (((w) - JSON_ONES) & ~(w) & JSON_HIGH)
+
+/*
+ * Return the count of plain string bytes at the start of a string.
+ * This checks 8 bytes at a time without vector instructions.  A word containing
+ * a byte which is not plain is checked one byte at a time so this does not depend
+ * on the byte order.  If multibyte is set, bytes which are not ASCII are plain.
+ */
+static int jsonPlainLenScalar(const char * str, int len, int multibyte) {
+    uint64_t high = multibyte ? 0 : JSON_HIGH;
+    int pos = 0;
+    while (pos + 8 <= len) {
+        uint64_t w;
+        memcpy(&w, str+pos, 8);
+        if (JSON_ZERO(w ^ (JSON_ONES*'"')) | JSON_ZERO(w ^ (JSON_ONES*'\\')) |
+            ((w - JSON_ONES*0x20) & ~w & JSON_HIGH) | (w & high))
+            break;
+        pos += 8;
+    }
+    while (pos < len) {
+        uint8_t ch = (uint8_t)str[pos];
+        if (ch == '"' || ch == '\\' || ch < 0x20 || (ch >= 0x80 && !multibyte))
+            break;
+        pos++;
+    }
+    return pos;
+}
+
+
+/*
+ * Return the count of plain string bytes at the start of a string.
+ * When SSE2 is available this checks 32 bytes at a time.  As a signed byte, a
+ * control character or a byte which is not ASCII is less than 0x20.  When bytes
+ * which are not ASCII are plain, control characters are found with an unsigned
+ * compare instead.
+ */
+static inline int jsonPlainScan(const char * str, int len, int multibyte) {
+#ifdef __SSE2__
+    int pos = 0;
+    const __m128i quote  = _mm_set1_epi8('"');
+    const __m128i bslash = _mm_set1_epi8('\\');
+    const __m128i space  = _mm_set1_epi8(0x20);
+    const __m128i ctl    = _mm_set1_epi8(0x1f);
+    while (pos + 32 <= len) {
+        __m128i v1 = _mm_loadu_si128((const __m128i *)(str+pos));
+        __m128i v2 = _mm_loadu_si128((const __m128i *)(str+pos+16));
+        __m128i c1 = multibyte ? _mm_cmpeq_epi8(_mm_min_epu8(v1, ctl), v1) : _mm_cmplt_epi8(v1, space);
+        __m128i c2 = multibyte ? _mm_cmpeq_epi8(_mm_min_epu8(v2, ctl), v2) : _mm_cmplt_epi8(v2, space);
+        __m128i m1 = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v1, quote), _mm_cmpeq_epi8(v1, bslash)), c1);
+        __m128i m2 = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v2, quote), _mm_cmpeq_epi8(v2, bslash)), c2);
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(m1) | ((uint32_t)_mm_movemask_epi8(m2) << 16);
+        if (mask)
+            return pos + __builtin_ctz(mask);
+        pos += 32;
+    }
+    return pos + jsonPlainLenScalar(str+pos, len-pos, multibyte);
+#else
+    return jsonPlainLenScalar(str, len, multibyte);
+#endif
+}
+
+
+/*
+ * Return the count of plain string bytes at the start of a string when parsing
+ */
+static int jsonPlainLen(const char * str, int len) {
+    return jsonPlainScan(str, len, 0);
+}
+
+
+/*
+ * Return the count of bytes at the start of a string which do not need a JSON escape.
+ * Multibyte characters are not escaped.
+ */
+static int jsonNoEscapeLen(const char * str, int len) {
+    return jsonPlainScan(str, len, 1);
+}
+
+
 /*
  * Match a string
  * A string is any number of bytes ending with an unescaped double quote.
@@ -549,6 +638,17 @@ static int jsonString(ism_json_t * jobj) {
     int    needcheck = 0;
 
     while (left > 0) {
+        /* Move over the bytes which need no checking.  These do not need to move until there is an escape */
+        int plain = jsonPlainLen(ip, left);
+        if (plain) {
+            if (op != ip)
+                memmove(op, ip, plain);
+            ip += plain;
+            op += plain;
+            left -= plain;
+            if (left <= 0)
+                break;
+        }
         char ch = *ip++;
         if (ch == '"') {
             *op = 0;
@@ -918,48 +1018,20 @@ void ism_json_put(concat_alloc_t * buf, const char * name, ism_field_t * value,
 
 
 /*
- * Compute the extra length needed for JSON escapes of a string.
+ * Compute the extra length needed for JSON escapes of a byte array.
  * Control characters and the quote and backslash are escaped.
  * No mulitbyte characters are escaped.
  */
-static int jsonExtra(const char * str) {
-    int extra = 0;
-    while (*str) {
-        uint8_t ch = (uint8_t)*str++;
-        if (ch >= ' ') {                 /* Normal characters */
-            if (ch=='"' || ch=='\\')
-                extra++;
-        } else {
-            switch (ch) {                /* Control characters */
-            case '\n':
-            case '\r':
-            case 0x08:    /* BS */
-            case 0x09:    /* HT */
-            case 0x0c:    /* FF */
-                extra++;
-                break;
-            default:
-                extra += 5;              /* unicode escape */
-                break;
-            }
-        }
-    }
-    return extra;
-}
-
-
-/*
- * Compute the extra length needed for JSON escapes of a byte array.
- * This is the same as jsonExtra, but takes a length instead of a null terminator.
- */
 static int jsonExtraLen(const char * str, int len) {
     int  extra = 0;
-    int  i;
-    for (i=0; i<len; i++) {
-        uint8_t ch = (uint8_t)*str++;
-        if (ch >= ' ') {                /* Normal character */
-            if (ch=='"' || ch=='\\')
-                extra++;
+    int  i = 0;
+    for (;;) {
+        i += jsonNoEscapeLen(str+i, len-i);    /* Skip the run of normal characters */
+        if (i >= len)
+            break;
+        uint8_t ch = (uint8_t)str[i++];
+        if (ch >= ' ') {                /* Quote or backslash */
+            extra++;
         } else {                        /* Control characters */
             switch (ch) {
             case '\n':
@@ -986,15 +1058,19 @@ static char * hexChar = "0123456789ABCDEF";
  * Do not escape any multibyte character.
  */
 static void jsonEscape(char * to, const char * from, int len) {
-    int i;
-    for (i=0; i<len; i++) {
+    const char * endp = from + len;
+    for (;;) {
+        int plain = jsonNoEscapeLen(from, (int)(endp-from));
+        memcpy(to, from, plain);         /* Copy the run of normal characters */
+        to += plain;
+        from += plain;
+        if (from >= endp)
+            break;
         uint8_t ch = (uint8_t)*from++;
-        if (ch >= ' ') {
-            if (ch=='"' || ch=='\\')
-                *to++ = '\\';
+        *to++ = '\\';
+        if (ch >= ' ') {                 /* Quote or backslash */
             *to++ = ch;
         } else {
-            *to++ = '\\';
             switch (ch) {
             case '\n':  *to++ = 'n';    break;
             case '\r':  *to++ = 'r';    break;
@@ -1024,15 +1100,8 @@ void ism_json_putString(concat_alloc_t * buf, const char * str) {
     if (!str) {
         ism_common_allocBufferCopy(buf, "null");
     } else {
-        int extra = jsonExtra(str);
         ism_json_putBytes(buf, "\"");    /* starting quote */
-        if (extra == 0) {
-            ism_common_allocBufferCopyLen(buf, str, (int)strlen(str));
-        } else {
-            int len = (int)strlen(str);
-            char * tp = ism_common_allocAllocBuffer(buf, len+extra, 0);
-            jsonEscape(tp, str, len);
-        }
+        ism_json_putEscapeBytes(buf, str, (int)strlen(str));
         ism_json_putBytes(buf, "\"");    /* ending quote   */
     }
 }
@@ -1069,12 +1138,17 @@ void ism_json_putNull(concat_alloc_t * buf) {
  * @param len   The length of the bytes to write
  */
 void ism_json_putEscapeBytes(concat_alloc_t * buf, const char * str, int len) {
-    int extra = jsonExtraLen(str, len);
-    if (extra == 0) {
+    int plain = jsonNoEscapeLen(str, len);
+    if (plain == len) {
         ism_common_allocBufferCopyLen(buf, str, len);
     } else {
+        /* Only the bytes after the first one needing an escape are checked again */
+        int extra = jsonExtraLen(str+plain, len-plain);
         char * tp = ism_common_allocAllocBuffer(buf, len+extra, 0);
-        jsonEscape(tp, str, len);
+        if (tp) {
+            memcpy(tp, str, plain);
+            jsonEscape(tp+plain, str+plain, len-plain);
+        }
     }
 }
 
@@ -28,6 +28,12 @@
 #include <openssl/safestack.h>
 #include <openssl/x509v3.h>
 #include <openssl/x509_vfy.h>
+#include <openssl/rand.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#else
+#include <openssl/hmac.h>
+#endif
 
 #include <dirent.h>
 #include <sys/stat.h>
@@ -1327,6 +1333,164 @@ void ism_common_setDisableCRLCallback(int (* callback)(ima_transport_info_t *))
     getDisableCRL = callback;
 }
 
+/*
+ * TLS session ticket keys.
+ *
+ * When TlsTicketKeyFile is set the session tickets are protected with the keys in this file
+ * rather than with random keys in each context, so a ticket issued by any server sharing the
+ * file resumes the session on all of them.  Each line of the file which is not empty and does
+ * not start with '#' is a key of 160 hex digits: a 16 byte key name, a 32 byte HMAC-SHA256 key,
+ * and a 32 byte AES-256 key.  The first key issues tickets and all keys are accepted, so the keys
+ * are rotated by adding a new key at the start and later removing the last one.
+ * The file is checked for changes once a minute.
+ */
+#define TICKET_KEY_MAX    16
+#define TICKET_KEY_CHECK  (60 * 1000000000LL)
+
+typedef struct ticketkey_t {
+    uint8_t  name [16];
+    uint8_t  hmac [32];
+    uint8_t  aes  [32];
+} ticketkey_t;
+
+typedef struct ticketkeys_t {
+    struct ticketkeys_t * retired;       /* The previous keys which are freed at the next load */
+    int          count;
+    ticketkey_t  key [TICKET_KEY_MAX];
+} ticketkeys_t;
+
+static const char *             g_ticketKeyFile = NULL;
+static ticketkeys_t * volatile  g_ticketKeys = NULL;
+static time_t                   g_ticketKeyTime = 0;
+static volatile uint64_t        g_ticketKeyCheck = 0;
+static pthread_mutex_t          ticketKeyLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Load the ticket keys if the key file has changed.
+ * If the file has no valid keys the current keys are kept.
+ * This is called holding the ticketKeyLock.
+ */
+static int loadTicketKeys(void) {
+    struct stat st;
+    char   line [512];
+    ticketkeys_t * keys;
+    FILE * f;
+
+    if (stat(g_ticketKeyFile, &st)) {
+        TRACE(3, "Unable to access the TLS ticket key file: file=%s errno=%d\n", g_ticketKeyFile, errno);
+        return -1;
+    }
+    if (g_ticketKeys && st.st_mtime == g_ticketKeyTime)
+        return 0;
+    f = fopen(g_ticketKeyFile, "rb");
+    if (!f) {
+        TRACE(3, "Unable to open the TLS ticket key file: file=%s errno=%d\n", g_ticketKeyFile, errno);
+        return -1;
+    }
+    keys = ism_common_calloc(ISM_MEM_PROBE(ism_memory_utils_sslutils,98), 1, sizeof(ticketkeys_t));
+    while (fgets(line, sizeof line, f) && keys->count < TICKET_KEY_MAX) {
+        char * cp = line;
+        int    len;
+        while (*cp == ' ' || *cp == '\t')
+            cp++;
+        len = strlen(cp);
+        while (len > 0 && (cp[len-1] == '\n' || cp[len-1] == '\r' || cp[len-1] == ' '))
+            cp[--len] = 0;
+        if (len == 0 || *cp == '#')
+            continue;
+        if (len != 2 * sizeof(ticketkey_t) || ism_common_fromHexString(cp, NULL) != sizeof(ticketkey_t)) {
+            TRACE(3, "The TLS ticket key is not valid: file=%s key=%d\n", g_ticketKeyFile, keys->count);
+            continue;
+        }
+        ism_common_fromHexString(cp, (char *)(keys->key + keys->count));
+        keys->count++;
+    }
+    fclose(f);
+    memset(line, 0, sizeof line);
+    if (keys->count == 0) {
+        TRACE(3, "The TLS ticket key file has no valid keys: file=%s\n", g_ticketKeyFile);
+        ism_common_free(ism_memory_utils_sslutils, keys);
+        return -1;
+    }
+
+    /* Keep the current keys until the next load as a handshake might be using them */
+    keys->retired = g_ticketKeys;
+    if (keys->retired && keys->retired->retired) {
+        memset(keys->retired->retired, 0, sizeof(ticketkeys_t));
+        ism_common_free(ism_memory_utils_sslutils, keys->retired->retired);
+        keys->retired->retired = NULL;
+    }
+    __sync_synchronize();
+    g_ticketKeys = keys;
+    g_ticketKeyTime = st.st_mtime;
+    TRACE(4, "Load the TLS ticket keys: file=%s count=%d\n", g_ticketKeyFile, keys->count);
+    return 0;
+}
+
+/*
+ * Check the ticket key file for changes at most once a minute
+ */
+static void checkTicketKeys(void) {
+    uint64_t next = g_ticketKeyCheck;
+    uint64_t now = (uint64_t)ism_common_currentTimeNanos();
+    if (now >= next && __sync_bool_compare_and_swap(&g_ticketKeyCheck, next, now + TICKET_KEY_CHECK)) {
+        pthread_mutex_lock(&ticketKeyLock);
+        loadTicketKeys();
+        pthread_mutex_unlock(&ticketKeyLock);
+    }
+}
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+static int setTicketHmac(EVP_MAC_CTX * hctx, uint8_t * key) {
+    OSSL_PARAM params [3];
+    params[0] = OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, key, 32);
+    params[1] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, "SHA256", 0);
+    params[2] = OSSL_PARAM_construct_end();
+    return EVP_MAC_CTX_set_params(hctx, params);
+}
+#define TICKET_HMAC_CTX EVP_MAC_CTX
+#else
+static int setTicketHmac(HMAC_CTX * hctx, uint8_t * key) {
+    return HMAC_Init_ex(hctx, key, 32, EVP_sha256(), NULL);
+}
+#define TICKET_HMAC_CTX HMAC_CTX
+#endif
+
+/*
+ * Session ticket key callback.
+ * On encrypt use the first key.  On decrypt find the key by name, and ask for a new ticket
+ * when the ticket was issued with an older key.
+ * @return 1=use the key, 2=use the key and renew the ticket, 0=no ticket or full handshake, -1=error
+ */
+static int ticketKeyCallback(SSL * ssl, unsigned char * keyname, unsigned char * iv,
+        EVP_CIPHER_CTX * ectx, TICKET_HMAC_CTX * hctx, int enc) {
+    ticketkeys_t * keys;
+    int  i;
+
+    checkTicketKeys();
+    keys = g_ticketKeys;
+    if (!keys)
+        return 0;
+    if (enc) {
+        ticketkey_t * key = keys->key;
+        if (RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) <= 0)
+            return -1;
+        memcpy(keyname, key->name, sizeof key->name);
+        if (!EVP_EncryptInit_ex(ectx, EVP_aes_256_cbc(), NULL, key->aes, iv) || !setTicketHmac(hctx, key->hmac))
+            return -1;
+        return 1;
+    }
+    for (i = 0; i < keys->count; i++) {
+        ticketkey_t * key = keys->key + i;
+        if (!memcmp(keyname, key->name, sizeof key->name)) {
+            if (!setTicketHmac(hctx, key->hmac) || !EVP_DecryptInit_ex(ectx, EVP_aes_256_cbc(), NULL, key->aes, iv))
+                return -1;
+            return i ? 2 : 1;
+        }
+    }
+    return 0;
+}
+
 /*
  * Initialize SSL/TLS processing
  */
@@ -1434,6 +1598,20 @@ XAPI void ism_ssl_init(int useFips, int useBufferPool) {
         ism_ssl_applyPSKfile(pskFileName, 0);
     }
 
+    /*
+     * Load the TLS session ticket keys shared with other servers
+     */
+    g_ticketKeyFile = ism_common_getStringConfig("TlsTicketKeyFile");
+    if (g_ticketKeyFile && *g_ticketKeyFile) {
+        TRACE(7, "TlsTicketKeyFile = %s\n", g_ticketKeyFile);
+        pthread_mutex_lock(&ticketKeyLock);
+        loadTicketKeys();
+        pthread_mutex_unlock(&ticketKeyLock);
+        g_ticketKeyCheck = (uint64_t)ism_common_currentTimeNanos() + TICKET_KEY_CHECK;
+    } else {
+        g_ticketKeyFile = NULL;
+    }
+
     /* Set the disable CRL */
     ism_common_setDisableCRL(ism_common_getIntConfig("DisableCRL", g_disableCRL));
 }
@@ -1450,6 +1628,14 @@ void ism_ssl_cleanup(void) {
 	pthread_rwlock_unlock(&pskMapLock);
 	if (map)
 		freePSKMap(map);
+    pthread_mutex_lock(&ticketKeyLock);
+    while (g_ticketKeys) {
+        ticketkeys_t * keys = g_ticketKeys;
+        g_ticketKeys = keys->retired;
+        memset(keys->key, 0, sizeof keys->key);
+        ism_common_free(ism_memory_utils_sslutils, keys);
+    }
+    pthread_mutex_unlock(&ticketKeyLock);
     ERR_free_strings();
     EVP_cleanup();
     CRYPTO_cleanup_all_ex_data();
@@ -1855,6 +2041,13 @@ SSL_CTX * ism_common_create_ssl_ctxpw(const char * objname, const char * methodN
                 SSL_CTX_set_session_id_context(ctx, (uint8_t *)"\x02imaproxy", 9);
             if (ism_common_isBridge())
                 SSL_CTX_set_session_id_context(ctx, (uint8_t *)"\x03imabridge", 10);
+            if (g_ticketKeyFile) {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+                SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, ticketKeyCallback);
+#else
+                SSL_CTX_set_tlsext_ticket_key_cb(ctx, ticketKeyCallback);
+#endif
+            }
         } else {
 
 #ifdef HAS_BRIDGE
@@ -2053,9 +2246,13 @@ static uint32_t pskServerCallback(SSL * ssl, const char * identity, uint8_t * ps
 	uint32_t rc = 0;
 	ima_transport_info_t * transport = SSL_get_app_data(ssl);
 	if (transport) {
+	    /*
+	     * Copy the key while holding the lock as the map and its keys are freed
+	     * when the PSK file is replaced, which can be concurrent with handshakes
+	     * running in the TLS handshake threads.
+	     */
 	    pthread_rwlock_rdlock(&pskMapLock);
 	    char * ba = (char *)ism_common_getHashMapElement(pskMap, identity, 0);
-	    pthread_rwlock_unlock(&pskMapLock);
 	    if (LIKELY(ba != NULL)) {
 	        rc = (uint8_t)ba[0] + 1;
 	        if (LIKELY(rc <= maxPSKLen)) {
@@ -2063,6 +2260,7 @@ static uint32_t pskServerCallback(SSL * ssl, const char * identity, uint8_t * ps
 	            memcpy(psk, ba+1, rc);
 	        }
 	    }
+	    pthread_rwlock_unlock(&pskMapLock);
 	}
 	return rc;
 }
@@ -30,10 +30,13 @@
 
 #include <ismutil.h>
 #include <ismuints.h>
+#include <selector.h>
+#include <imacontent.h>
 #include "testFilterCUnit.h"
 
 //defined in ismutil.c
 void ism_common_initUtil2(int type);
+extern int g_verbose;
 
 /**
  * Perform initialization for filter test suite.
@@ -160,6 +163,262 @@ static void CUint_acl_upgradeReadLock_test(void) {
     ism_common_unlockACLList(); 
 }
 
+/*
+ * Get the index key of a selection rule as a string
+ */
+static int selectKey(const char * selector, const char * want, char * out) {
+    ismRule_t * rule = NULL;
+    const char * name = NULL;
+    const char * values [8];
+    int  lens [8];
+    int  i;
+    int  count = 0;
+    int  compsize;
+
+    *out = 0;
+    if (ism_common_compileSelectRule(&rule, &compsize, selector) == 0) {
+        count = ism_common_getSelectKey(rule, want, &name, values, lens, 8);
+        if (count) {
+            strcpy(out, name);
+            for (i=0; i<count; i++)
+                sprintf(out+strlen(out), "%s%.*s", i ? "," : "=", lens[i], values[i]);
+        }
+        ism_common_freeSelectRule(rule);
+    }
+    return count;
+}
+
+static void CUnit_select_key_test(void) {
+    char out [256];
+
+    CU_ASSERT(selectKey("deviceId = 'd1'", NULL, out) == 1);
+    CU_ASSERT_STRING_EQUAL(out, "deviceId=d1");
+    CU_ASSERT(selectKey("'d1' = deviceId", NULL, out) == 1);
+    CU_ASSERT_STRING_EQUAL(out, "deviceId=d1");
+    CU_ASSERT(selectKey("temp > 5 AND type IN ('a', 'bb', 'c')", NULL, out) == 3);
+    CU_ASSERT_STRING_EQUAL(out, "type=a,bb,c");
+    CU_ASSERT(selectKey("a = 'x' AND b = 'y'", "b", out) == 1);
+    CU_ASSERT_STRING_EQUAL(out, "b=y");
+    CU_ASSERT(selectKey("a = 'x' AND (b = 'y' OR c = 1)", NULL, out) == 1);
+    CU_ASSERT_STRING_EQUAL(out, "a=x");
+
+    /* These can select a message without the property having a particular string value */
+    CU_ASSERT(selectKey("a = 'x' AND b = 'y'", "c", out) == 0);
+    CU_ASSERT(selectKey("a = 'x' OR b = 'y'", NULL, out) == 0);
+    CU_ASSERT(selectKey("NOT a = 'x'", NULL, out) == 0);
+    CU_ASSERT(selectKey("a <> 'x'", NULL, out) == 0);
+    CU_ASSERT(selectKey("a = 1", NULL, out) == 0);
+    CU_ASSERT(selectKey("a NOT IN ('x')", NULL, out) == 0);
+    CU_ASSERT(selectKey("JMSType = 'x'", NULL, out) == 0);
+    CU_ASSERT(selectKey("a IN ('1','2','3','4','5','6','7','8','9')", NULL, out) == 0);
+}
+
+/*
+ * Select a message with properties
+ */
+static int selectProps(ism_actionbuf_t * props, const char * selector) {
+    ismMessageHeader_t hdr = {0};
+    ismMessageAreaType_t areatype [1] = { ismMESSAGE_AREA_PROPERTIES };
+    size_t areasize [1] = { props->used };
+    void * areaptr [1] = { props->buf };
+    ismRule_t * rule = NULL;
+    int  compsize;
+    int  rc = -2;
+
+    if (ism_common_compileSelectRule(&rule, &compsize, selector) == 0) {
+        rc = ism_common_selectMessage(&hdr, 1, areatype, areasize, areaptr, "t/1", rule, compsize, NULL);
+        ism_common_freeSelectRule(rule);
+    }
+    return rc;
+}
+
+static void CUnit_select_cache_test(void) {
+    char xbuf [1024];
+    ism_actionbuf_t props = {xbuf, sizeof xbuf};
+    ismMessageHeader_t hdr = {0};
+    ismMessageAreaType_t areatype [1] = { ismMESSAGE_AREA_PROPERTIES };
+    size_t areasize [1];
+    void * areaptr [1] = { xbuf };
+    ism_field_t f;
+    char name [16];
+    int  cached;
+    int  i;
+
+    ism_protocol_putNameValue(&props, "deviceId");
+    ism_protocol_putStringValue(&props, "d1");
+    ism_protocol_putNameValue(&props, "temp");
+    ism_protocol_putIntValue(&props, 20);
+    /* More properties than are kept in the decoded table */
+    for (i=0; i<40; i++) {
+        sprintf(name, "p%d", i);
+        ism_protocol_putNameValue(&props, name);
+        ism_protocol_putIntValue(&props, i);
+    }
+    areasize[0] = props.used;
+
+    for (cached = 0; cached < 2; cached++) {
+        if (cached)
+            ism_common_startSelectCache(1, areatype, areasize, areaptr);
+
+        CU_ASSERT(ism_common_getSelectProperty(&hdr, 1, areatype, areasize, areaptr, "deviceId", &f) == 0);
+        CU_ASSERT(f.type == VT_String && !strcmp(f.val.s, "d1"));
+        CU_ASSERT(ism_common_getSelectProperty(&hdr, 1, areatype, areasize, areaptr, "p39", &f) == 0);
+        CU_ASSERT(f.type == VT_Integer && f.val.i == 39);
+        CU_ASSERT(ism_common_getSelectProperty(&hdr, 1, areatype, areasize, areaptr, "missing", &f) == 1);
+        CU_ASSERT(f.type == VT_Null);
+
+        CU_ASSERT(selectProps(&props, "deviceId = 'd1' AND temp > 10") == SELECT_TRUE);
+        CU_ASSERT(selectProps(&props, "deviceId IN ('d2', 'd3')") == SELECT_FALSE);
+        CU_ASSERT(selectProps(&props, "p3 = 3 AND p38 = 38") == SELECT_TRUE);
+        CU_ASSERT(selectProps(&props, "missing = 'x'") == SELECT_UNKNOWN);
+
+        if (cached)
+            ism_common_endSelectCache();
+    }
+}
+
+/*
+ * Selectors of the kinds used by applications
+ */
+static const char * selectCorpus [] = {
+    "deviceId = 'd1'",
+    "deviceId = 'd7' AND temp > 30",
+    "deviceType IN ('sensor', 'gateway', 'meter') AND status <> 'offline'",
+    "temp BETWEEN 10 AND 25 OR humidity > 80",
+    "temp > 20 + 5",
+    "temp * 2 >= -10 AND NOT (status = 'ok')",
+    "region LIKE 'eu-%' AND priority >= 4",
+    "(deviceId = 'd1' OR deviceId = 'd2') AND (temp > 20 OR humidity < 40)",
+    "alarm IS NULL",
+    "alarm IS NOT NULL OR level = 3.5",
+    "JMSPriority > 4 OR JMSDeliveryMode = 'PERSISTENT'",
+    "JMS_Topic = 't/d1/event'",
+    "JMS_QoS = 1 AND JMS_IBM_Retain = 0",
+    "'d3' = deviceId",
+    "rate / 4 > 5 AND rate - 2 * 3 < 30",
+    "(temp > 20) = TRUE",
+    "-(temp) < -20",
+    "missing = 1 OR missing IS NULL",
+};
+
+/*
+ * Make the properties of a message
+ */
+static void selectMessage(ism_actionbuf_t * props, int i) {
+    char xbuf [32];
+    static const char * types [] = { "sensor", "gateway", "meter", "camera" };
+    props->used = 0;
+    sprintf(xbuf, "d%d", i % 10);
+    ism_protocol_putNameValue(props, "deviceId");
+    ism_protocol_putStringValue(props, xbuf);
+    ism_protocol_putNameValue(props, "deviceType");
+    ism_protocol_putStringValue(props, types[i % 4]);
+    ism_protocol_putNameValue(props, "status");
+    ism_protocol_putStringValue(props, i % 3 ? "ok" : "offline");
+    ism_protocol_putNameValue(props, "temp");
+    ism_protocol_putIntValue(props, i % 40);
+    ism_protocol_putNameValue(props, "humidity");
+    ism_protocol_putIntValue(props, (i * 7) % 100);
+    ism_protocol_putNameValue(props, "region");
+    ism_protocol_putStringValue(props, i % 2 ? "eu-west" : "us-east");
+    ism_protocol_putNameValue(props, "priority");
+    ism_protocol_putIntValue(props, i % 6);
+    ism_protocol_putNameValue(props, "rate");
+    ism_protocol_putIntValue(props, i);
+    if (i % 5 == 0) {
+        ism_protocol_putNameValue(props, "alarm");
+        ism_protocol_putStringValue(props, "high");
+    }
+    ism_protocol_putNameValue(props, "level");
+    ism_protocol_putDoubleValue(props, (i % 8) / 2.0);
+}
+
+/*
+ * Check that selection code gives the same result as the selection rule, and
+ * show the evaluations per second of each.
+ */
+static void CUnit_select_code_test(void) {
+    char xbuf [1024];
+    ism_actionbuf_t props = {xbuf, sizeof xbuf};
+    ismMessageHeader_t hdr = {0};
+    ismMessageAreaType_t areatype [1] = { ismMESSAGE_AREA_PROPERTIES };
+    size_t areasize [1];
+    void * areaptr [1] = { xbuf };
+    char topic [32];
+    int  count = sizeof selectCorpus / sizeof selectCorpus[0];
+    ismRule_t * rule [count];
+    ismRule_t * code [count];
+    int  i;
+    int  j;
+    int  loop;
+    int  rc;
+
+    for (j=0; j<count; j++) {
+        rc = ism_common_compileSelectRule(&rule[j], NULL, selectCorpus[j]);
+        CU_ASSERT(rc == 0);
+        rc = ism_common_compileSelectCode(&code[j], rule[j]);
+        CU_ASSERT(rc == 0);
+        CU_ASSERT(code[j] && code[j]->op == SELRULE_Code);
+    }
+
+    for (i=0; i<40; i++) {
+        selectMessage(&props, i);
+        areasize[0] = props.used;
+        hdr.Priority = i % 10;
+        hdr.Reliability = i % 3;
+        hdr.Persistence = i % 2;
+        sprintf(topic, "t/d%d/event", i % 10);
+        for (j=0; j<count; j++) {
+            int rrc = ism_common_selectMessage(&hdr, 1, areatype, areasize, areaptr, topic, rule[j], 0, NULL);
+            int crc = ism_common_selectMessage(&hdr, 1, areatype, areasize, areaptr, topic, code[j], 0, NULL);
+            if (rrc != crc)
+                printf("\nselector=\"%s\" message=%d rule=%d code=%d\n", selectCorpus[j], i, rrc, crc);
+            CU_ASSERT(rrc == crc);
+        }
+    }
+
+    /* Code which is not from the rule compiler is not compiled */
+    CU_ASSERT(ism_common_compileSelectCode(&code[0], code[0]) != 0);
+    CU_ASSERT(ism_common_compileSelectCode(&code[0], NULL) != 0);
+    CU_ASSERT(code[0] == NULL);
+    ism_common_compileSelectCode(&code[0], rule[0]);
+
+    /* Evaluations per second of the rule and the code */
+    if (g_verbose) {
+        static char msgs [20][512];
+        size_t msglen [20];
+        for (i=0; i<20; i++) {
+            ism_actionbuf_t mprops = {msgs[i], sizeof msgs[i]};
+            selectMessage(&mprops, i);
+            msglen[i] = mprops.used;
+        }
+        for (loop=0; loop<2; loop++) {
+            ismRule_t * * which = loop ? code : rule;
+            int evals = 0;
+            ism_time_t start = ism_common_currentTimeNanos();
+            for (i=0; i<2000; i++) {
+                areasize[0] = msglen[i%20];
+                areaptr[0] = msgs[i%20];
+                ism_common_startSelectCache(1, areatype, areasize, areaptr);
+                for (j=0; j<count; j++) {
+                    ism_common_selectMessage(&hdr, 1, areatype, areasize, areaptr, "t/d1/event", which[j], 0, NULL);
+                    evals++;
+                }
+                ism_common_endSelectCache();
+            }
+            ism_time_t elapsed = ism_common_currentTimeNanos() - start;
+            printf("\n%s: %d evaluations in %.3f ms = %.0f per second", loop ? "code" : "rule",
+                    evals, elapsed / 1000000.0, evals * 1000000000.0 / (elapsed ? elapsed : 1));
+        }
+        printf("\n");
+    }
+
+    for (j=0; j<count; j++) {
+        ism_common_freeSelectCode(code[j]);
+        ism_common_freeSelectRule(rule[j]);
+    }
+}
+
 /*
  * Array of hash map tests for server_utils APIs to CUnit framework.
  */
@@ -171,6 +430,9 @@ CU_TestInfo ISM_Util_CUnit_Filter[] =
         { "ACLPersistRead",      CUint_acl_persistRead_test },
         { "ACLDontPersistWrite", CUint_acl_dontPersistWrite_test },
         { "ACLUpgradeRead",      CUint_acl_upgradeReadLock_test },
+        { "SelectKey",           CUnit_select_key_test },
+        { "SelectCache",         CUnit_select_cache_test },
+        { "SelectCode",          CUnit_select_code_test },
        CU_TEST_INFO_NULL
   };
 
@@ -19,6 +19,7 @@
 #endif
 #include <ssl.c>
 #include <tls.c>
+#include <utime.h>
 extern int g_verbose;
 void snitest(void);
 
@@ -28,6 +29,7 @@ CU_TestInfo ISM_Util_CUnit_TLS[] = {
     { "timeTest", timetest },
     { "crlTest", crltest },
     { "sniTest", snitest },
+    { "ticketKeyTest", ticketkeytest },
     CU_TEST_INFO_NULL
 };
 
@@ -326,3 +328,144 @@ xUNUSED void snitest(void) {
         ism_common_setTraceLevel(2);
 }
 
+/*
+ * Write a TLS ticket key file where each key has all bytes of the key name, HMAC key,
+ * and AES key set to one value.  A zero value is written as a key which is not valid.
+ */
+static void writeTicketKeys(const char * fileName, time_t mtime, int count, const int * values) {
+    struct utimbuf times;
+    FILE * f = fopen(fileName, "wb");
+    int    i, j;
+    fprintf(f, "# TLS ticket keys\n");
+    for (i = 0; i < count; i++) {
+        for (j = 0; j < sizeof(ticketkey_t); j++) {
+            if (values[i])
+                fprintf(f, "%02x", values[i]);
+            else
+                fprintf(f, "zz");
+        }
+        fprintf(f, "\n");
+    }
+    fclose(f);
+    /* Set the modification time as the file is changed more than once a second */
+    times.actime = mtime;
+    times.modtime = mtime;
+    utime(fileName, &times);
+}
+
+/*
+ * Call the ticket key callback with a key name of all one byte value
+ */
+static int callTicketKey(int value, uint8_t * keyname, int enc) {
+    uint8_t iv [EVP_MAX_IV_LENGTH];
+    EVP_CIPHER_CTX * ectx = EVP_CIPHER_CTX_new();
+    int    rc;
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    EVP_MAC * mac = EVP_MAC_fetch(NULL, "HMAC", NULL);
+    EVP_MAC_CTX * hctx = EVP_MAC_CTX_new(mac);
+#else
+    HMAC_CTX * hctx = HMAC_CTX_new();
+#endif
+    memset(iv, 0, sizeof iv);
+    if (!enc)
+        memset(keyname, value, 16);
+    rc = ticketKeyCallback(NULL, keyname, iv, ectx, hctx, enc);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    EVP_MAC_CTX_free(hctx);
+    EVP_MAC_free(mac);
+#else
+    HMAC_CTX_free(hctx);
+#endif
+    EVP_CIPHER_CTX_free(ectx);
+    return rc;
+}
+
+/*
+ * Test the TLS session ticket keys and their rotation
+ */
+void ticketkeytest(void) {
+    const char * fileName = "ticketkeys.test";
+    uint8_t keyname [16];
+    uint8_t expname [16];
+    time_t  mtime = time(NULL) - 100;
+    int     rc;
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+    printf("Skipping ticket key test due to openssl <1.1\n");
+    return;
+#endif
+
+    /* No keys are loaded so the default ticket handling is used */
+    g_ticketKeyCheck = (uint64_t)ism_common_currentTimeNanos() + TICKET_KEY_CHECK;
+    CU_ASSERT(callTicketKey(0, keyname, 1) == 0);
+
+    writeTicketKeys(fileName, mtime, 2, (int []){0x11, 0x22});
+    g_ticketKeyFile = fileName;
+    pthread_mutex_lock(&ticketKeyLock);
+    rc = loadTicketKeys();
+    pthread_mutex_unlock(&ticketKeyLock);
+    CU_ASSERT(rc == 0);
+    CU_ASSERT_FATAL(g_ticketKeys != NULL);
+    CU_ASSERT(g_ticketKeys->count == 2);
+    CU_ASSERT(g_ticketKeys->retired == NULL);
+
+    /* The first key issues tickets and all keys are accepted, a ticket from an older key is renewed */
+    CU_ASSERT(callTicketKey(0, keyname, 1) == 1);
+    memset(expname, 0x11, sizeof expname);
+    CU_ASSERT(!memcmp(keyname, expname, sizeof expname));
+    CU_ASSERT(callTicketKey(0x11, keyname, 0) == 1);
+    CU_ASSERT(callTicketKey(0x22, keyname, 0) == 2);
+    CU_ASSERT(callTicketKey(0x33, keyname, 0) == 0);
+
+    /* A new key is added at the start and the last one removed, which is seen at the next check */
+    ticketkeys_t * oldKeys = g_ticketKeys;
+    writeTicketKeys(fileName, mtime + 10, 2, (int []){0x33, 0x11});
+    CU_ASSERT(callTicketKey(0, keyname, 1) == 1);
+    CU_ASSERT(!memcmp(keyname, expname, sizeof expname));
+    g_ticketKeyCheck = 0;
+    CU_ASSERT(callTicketKey(0, keyname, 1) == 1);
+    memset(expname, 0x33, sizeof expname);
+    CU_ASSERT(!memcmp(keyname, expname, sizeof expname));
+    CU_ASSERT(g_ticketKeyCheck > (uint64_t)ism_common_currentTimeNanos());
+    CU_ASSERT(g_ticketKeys->retired == oldKeys);
+    CU_ASSERT(callTicketKey(0x33, keyname, 0) == 1);
+    CU_ASSERT(callTicketKey(0x11, keyname, 0) == 2);
+    CU_ASSERT(callTicketKey(0x22, keyname, 0) == 0);
+
+    /* Invalid keys are skipped and a file without valid keys keeps the current keys */
+    writeTicketKeys(fileName, mtime + 20, 3, (int []){0, 0x44, 0});
+    pthread_mutex_lock(&ticketKeyLock);
+    rc = loadTicketKeys();
+    pthread_mutex_unlock(&ticketKeyLock);
+    CU_ASSERT(rc == 0);
+    CU_ASSERT(g_ticketKeys->count == 1);
+    CU_ASSERT(g_ticketKeys->retired->retired == NULL);
+    CU_ASSERT(callTicketKey(0x44, keyname, 0) == 1);
+    CU_ASSERT(callTicketKey(0x33, keyname, 0) == 0);
+
+    writeTicketKeys(fileName, mtime + 30, 1, (int []){0});
+    pthread_mutex_lock(&ticketKeyLock);
+    rc = loadTicketKeys();
+    pthread_mutex_unlock(&ticketKeyLock);
+    CU_ASSERT(rc == -1);
+    CU_ASSERT(callTicketKey(0x44, keyname, 0) == 1);
+
+    unlink(fileName);
+    pthread_mutex_lock(&ticketKeyLock);
+    rc = loadTicketKeys();
+    pthread_mutex_unlock(&ticketKeyLock);
+    CU_ASSERT(rc == -1);
+    CU_ASSERT(callTicketKey(0x44, keyname, 0) == 1);
+
+    /* Free the keys as in ism_ssl_cleanup() */
+    pthread_mutex_lock(&ticketKeyLock);
+    while (g_ticketKeys) {
+        ticketkeys_t * keys = g_ticketKeys;
+        g_ticketKeys = keys->retired;
+        ism_common_free(ism_memory_utils_sslutils, keys);
+    }
+    pthread_mutex_unlock(&ticketKeyLock);
+    g_ticketKeyFile = NULL;
+    g_ticketKeyTime = 0;
+    g_ticketKeyCheck = 0;
+}
@@ -19,6 +19,7 @@ void csvtest(void);
 void psktest(void);
 void timetest(void);
 void crltest(void);
+void ticketkeytest(void);
 extern CU_TestInfo ISM_Util_CUnit_TLS[];
 
 #endif
@@ -1127,3 +1127,239 @@ void testValidNumber(void) {
     CU_ASSERT(ism_json_isValidNumber(" 123") == 0);
     CU_ASSERT(ism_json_isValidNumber("+123") == 0);
 }
+
+/*
+ * Find the plain string bytes one byte at a time
+ */
+static int plainLen(const char * str, int len) {
+    int pos;
+    for (pos = 0; pos < len; pos++) {
+        uint8_t ch = (uint8_t)str[pos];
+        if (ch == '"' || ch == '\\' || ch < 0x20 || ch >= 0x80)
+            break;
+    }
+    return pos;
+}
+
+/*
+ * Parse a single string value and return the parse rc
+ */
+static int jsonParseValue(const char * json, char * value) {
+    ism_json_parse_t pobj = {0};
+    ism_json_entry_t ents[10];
+    int  len = (int)strlen(json);
+    int  rc;
+
+    pobj.ent_alloc = 10;
+    pobj.ent = ents;
+    pobj.source = malloc(len+1);
+    pobj.src_len = len;
+    memcpy(pobj.source, json, len+1);
+    rc = ism_json_parse(&pobj);
+    *value = 0;
+    if (rc == 0 && pobj.ent_count == 2 && pobj.ent[1].objtype == JSON_String)
+        strcpy(value, pobj.ent[1].value);
+    free(pobj.source);
+    return rc;
+}
+
+/*
+ * Make a device list update such as is sent to the proxy, or an admin configuration
+ */
+static int jsonPayload(concat_alloc_t * buf, int which, int count) {
+    char xbuf [512];
+    int  i;
+    buf->used = 0;
+    if (which == 0) {
+        ism_common_allocBufferCopyLen(buf, "{\"Device\":[", 11);
+        for (i=0; i<count; i++) {
+            int len = sprintf(xbuf, "%s{\"Org\":\"org%04d\",\"Type\":\"thermostat-v2\",\"ID\":\"device-%08d\","
+                    "\"Token\":\"a9f8e7d6c5b4a3928170f6e5d4c3b2a1\",\"Metadata\":\"Building 7, floor %d, \\\"east\\\" wing\","
+                    "\"Enabled\":true,\"Retry\":%d}", i ? "," : "", i%100, i, i%12, i%5);
+            ism_common_allocBufferCopyLen(buf, xbuf, len);
+        }
+        ism_common_allocBufferCopyLen(buf, "]}", 2);
+    } else {
+        ism_common_allocBufferCopyLen(buf, "{\n  \"Endpoint\": {\n", 18);
+        for (i=0; i<count; i++) {
+            int len = sprintf(xbuf, "%s    \"Endpoint%d\": {\n      \"Port\": %d,\n      \"Interface\": \"*\",\n"
+                    "      \"Protocol\": \"JMS,MQTT\",\n      \"Description\": \"Endpoint for the messaging clients of site %d\",\n"
+                    "      \"MessageHub\": \"DemoHub\",\n      \"Enabled\": true\n    }", i ? ",\n" : "", i, 16000+i, i);
+            ism_common_allocBufferCopyLen(buf, xbuf, len);
+        }
+        ism_common_allocBufferCopyLen(buf, "\n  }\n}\n", 7);
+    }
+    return buf->used;
+}
+
+/*
+ * Test the scan for plain string bytes and parse strings with special bytes at every position
+ */
+void jsonScanTest(void) {
+    static const char special [] = { '"', '\\', 0x01, 0x1f, (char)0x80, (char)0xc3, (char)0xff, 'a' };
+    char xbuf [128];
+    char json [160];
+    char value [160];
+    char expect [160];
+    int  i;
+    int  j;
+    int  len;
+    int  start;
+
+    /* Every special byte at every position and alignment */
+    for (i=0; i<sizeof special; i++) {
+        for (start=0; start<8; start++) {
+            for (len=0; len<100; len++) {
+                memset(xbuf, 'x', sizeof xbuf);
+                for (j=0; j<=len; j++) {
+                    xbuf[start+j] = special[i];
+                    CU_ASSERT(jsonPlainLen(xbuf+start, len) == plainLen(xbuf+start, len));
+                    CU_ASSERT(jsonPlainLenScalar(xbuf+start, len, 0) == plainLen(xbuf+start, len));
+                    xbuf[start+j] = 'x';
+                }
+            }
+        }
+    }
+
+    /* Escapes at every position of a string value */
+    memset(xbuf, 'v', sizeof xbuf);
+    for (len=0; len<80; len++) {
+        for (j=0; j<=len; j++) {
+            sprintf(json, "{\"n\":\"%.*s\\n%.*s\\\"\\u00e9\"}", j, xbuf, len-j, xbuf);
+            sprintf(expect, "%.*s\n%.*s\"\xc3\xa9", j, xbuf, len-j, xbuf);
+            CU_ASSERT(jsonParseValue(json, value) == 0);
+            CU_ASSERT(!strcmp(value, expect));
+
+            /* A control character is not allowed */
+            sprintf(json, "{\"n\":\"%.*s\t%.*s\"}", j, xbuf, len-j, xbuf);
+            CU_ASSERT(jsonParseValue(json, value) != 0);
+
+            /* A string which does not end */
+            sprintf(json, "{\"n\":\"%.*s", j, xbuf);
+            CU_ASSERT(jsonParseValue(json, value) != 0);
+        }
+    }
+    CU_ASSERT(jsonParseValue("{\"n\":\"caf\xc3\xa9 au lait, an everyday drink in France\"}", value) == 0);
+    CU_ASSERT(!strcmp(value, "caf\xc3\xa9 au lait, an everyday drink in France"));
+    CU_ASSERT(jsonParseValue("{\"n\":\"an invalid UTF-8 byte \xff in a long string value\"}", value) != 0);
+
+    /* Parse rate of a device update and an admin configuration */
+    for (i=0; i<2; i++) {
+        concat_alloc_t buf = {0};
+        ism_json_parse_t pobj = {0};
+        int  payloadlen = jsonPayload(&buf, i, i ? 2000 : 20000);
+        char * source = malloc(payloadlen);
+        int  loops = 10;
+        int  rc = 0;
+
+        uint64_t starttime = ism_common_currentTimeNanos();
+        for (j=0; j<loops; j++) {
+            memcpy(source, buf.buf, payloadlen);
+            memset(&pobj, 0, sizeof pobj);
+            pobj.source = source;
+            pobj.src_len = payloadlen;
+            rc |= ism_json_parse(&pobj);
+            if (pobj.free_ent)
+                ism_common_free(ism_memory_utils_parser, pobj.ent);
+        }
+        uint64_t elapsed = ism_common_currentTimeNanos() - starttime;
+        CU_ASSERT(rc == 0);
+        CU_ASSERT(pobj.ent_count == (i ? 2+2000*7 : 2+20000*8));
+        if (g_verbose)
+            printf("\n%s: %d bytes parsed %d times at %.1f MB/s", i ? "admin" : "device", payloadlen, loops,
+                    (double)payloadlen * loops * 1000.0 / (elapsed ? elapsed : 1));
+        free(source);
+        ism_common_freeAllocBuffer(&buf);
+    }
+    if (g_verbose)
+        printf("\n");
+}
+
+/*
+ * Escape a byte array one byte at a time
+ */
+static int escapeBytes(char * to, const char * from, int len) {
+    char * start = to;
+    int  i;
+    for (i=0; i<len; i++) {
+        uint8_t ch = (uint8_t)from[i];
+        if (ch == '"' || ch == '\\') {
+            *to++ = '\\';
+            *to++ = ch;
+        } else if (ch == '\n') {
+            to += sprintf(to, "\\n");
+        } else if (ch == '\r') {
+            to += sprintf(to, "\\r");
+        } else if (ch == 0x08) {
+            to += sprintf(to, "\\b");
+        } else if (ch == 0x09) {
+            to += sprintf(to, "\\t");
+        } else if (ch == 0x0c) {
+            to += sprintf(to, "\\f");
+        } else if (ch < 0x20) {
+            to += sprintf(to, "\\u%04X", ch);
+        } else {
+            *to++ = ch;
+        }
+    }
+    return (int)(to-start);
+}
+
+/*
+ * Test JSON string escapes with special bytes at every position
+ */
+void jsonEscapeTest(void) {
+    static const char special [] = { '"', '\\', '\n', 0x01, 0x1f, (char)0x80, (char)0xc3, (char)0xff, 'a' };
+    char xbuf [128];
+    char expect [1024];
+    char obuf [1024];
+    concat_alloc_t buf = {obuf, sizeof obuf};
+    int  i;
+    int  j;
+    int  len;
+    int  start;
+    int  explen;
+
+    for (i=0; i<sizeof special; i++) {
+        for (start=0; start<8; start++) {
+            for (len=0; len<100; len++) {
+                memset(xbuf, 'x', sizeof xbuf);
+                for (j=0; j<=len; j++) {
+                    xbuf[start+j] = special[i];
+                    explen = escapeBytes(expect, xbuf+start, len);
+                    buf.used = 0;
+                    ism_json_putEscapeBytes(&buf, xbuf+start, len);
+                    CU_ASSERT(buf.used == explen && !memcmp(buf.buf, expect, explen));
+                    CU_ASSERT(jsonPlainLenScalar(xbuf+start, len, 1) == jsonNoEscapeLen(xbuf+start, len));
+                    xbuf[start+j] = 'x';
+                }
+            }
+        }
+    }
+
+    buf.used = 0;
+    ism_json_putString(&buf, "caf\xc3\xa9 \"au\" lait\\\t\x01");
+    CU_ASSERT(buf.used == 29 && !memcmp(buf.buf, "\"caf\xc3\xa9 \\\"au\\\" lait\\\\\\t\\u0001\"", 29));
+
+    /* Reserve space without changing the used length */
+    buf.used = 10;
+    CU_ASSERT(ism_common_allocBufferReserve(&buf, 100) == 0);
+    CU_ASSERT(buf.buf == obuf && buf.inheap == 0);
+    CU_ASSERT(ism_common_allocBufferReserve(&buf, 100000) == 0);
+    CU_ASSERT(buf.inheap == 1 && buf.used == 10 && buf.len >= 100010);
+    CU_ASSERT(!memcmp(buf.buf, "\"caf\xc3\xa9 \\\"au", 10));
+
+    /* Rate of writing string values such as those in a monitoring response */
+    if (g_verbose) {
+        int loops = 200000;
+        uint64_t starttime = ism_common_currentTimeNanos();
+        buf.used = 0;
+        for (j=0; j<loops; j++) {
+            ism_json_putString(&buf, "/iot-2/type/thermostat-v2/id/device-00001234/evt/status/fmt/json");
+            ism_json_putString(&buf, "__Shared_Subscription_For_Analytics_Application");
+        }
+        uint64_t elapsed = ism_common_currentTimeNanos() - starttime;
+        printf("\nstrings: %d bytes written at %.1f MB/s\n", buf.used, (double)buf.used * 1000.0 / (elapsed ? elapsed : 1));
+    }
+    ism_common_freeAllocBuffer(&buf);
+}
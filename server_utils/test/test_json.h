@@ -25,6 +25,8 @@ CU_TestInfo ISM_Utils_CUnit_JsonBasic[] = {
     { "Match", testMatch },
     { "Regex", testRegex },
     { "JsonNumber" , testValidNumber },
+    { "JsonScan", jsonScanTest },
+    { "JsonEscape", jsonEscapeTest },
     CU_TEST_INFO_NULL
 };
 